@@ -1,3 +1,4 @@
+#include "core/led_control.h"
 #include "core/powerSave.h"
 #include <bq27220.h>
 #include <globals.h>
@@ -173,6 +174,7 @@ void InputHandler(void) {
         posDifference--;
 #ifdef HAS_ENCODER_LED
         EncoderLedChange = -1;
+        ledEffectsUpdate();
 #endif
         tm2 = millis();
     }
@@ -181,6 +183,7 @@ void InputHandler(void) {
         posDifference++;
 #ifdef HAS_ENCODER_LED
         EncoderLedChange = 1;
+        ledEffectsUpdate();
 #endif
         tm2 = millis();
     }
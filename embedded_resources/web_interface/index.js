@@ -440,6 +440,65 @@ async function fetchSystemInfo() {
   Dialog.loading.hide();
 }
 
+// Refreshed once per profiler sample while the dialog is open
+function kb(bytes) {
+  return `${(bytes / 1024).toFixed(1)} KB`;
+}
+
+function renderProfiler(info) {
+  const heap = info.heap;
+  $("#profiler-uptime").textContent = `${Math.floor(info.uptime / 1000)} s, ${info.cpuMhz} MHz`;
+  let heapText = `Heap ${kb(heap.free)} free of ${kb(heap.total)}, largest block ${kb(heap.largest)}, ` +
+    `${heap.frag}% fragmented, lowest ${kb(heap.min)}`;
+  if (heap.psramTotal > 0)
+    heapText += ` | PSRAM ${kb(heap.psramFree)} free of ${kb(heap.psramTotal)}, ${heap.psramFrag}% fragmented`;
+  $("#profiler-heap").textContent = heapText;
+
+  const history = heap.history;
+  const top = Math.max(heap.total, 1);
+  $("#profiler-history").setAttribute("viewBox", `0 0 ${Math.max(history.length - 1, 1)} 20`);
+  $("#profiler-history polyline").setAttribute("points",
+    history.map((free, i) => `${i},${(20 - free * 20 / top).toFixed(2)}`).join(" "));
+
+  const tasks = info.tasks.sort((a, b) => (b.cpu ?? -1) - (a.cpu ?? -1));
+  $("#profiler-tasks").innerHTML = "";
+  for (const task of tasks) {
+    const row = $("#profiler-tasks").insertRow();
+    const used = task.stackSize ? `${task.stackSize - task.stackFree} / ${task.stackSize}` : `${task.stackFree} free`;
+    for (const text of [task.name, task.cpu === undefined ? "n/a" : `${task.cpu.toFixed(1)}%`, used,
+      task.priority, task.core < 0 ? "-" : task.core])
+      row.insertCell().textContent = text;
+  }
+
+  $("#profiler-tags").innerHTML = "";
+  for (const tag of info.tagging.tags) {
+    const row = $("#profiler-tags").insertRow();
+    for (const text of [tag.name, tag.calls, tag.retained, tag.peak])
+      row.insertCell().textContent = text;
+  }
+  $(".act-profiler-tagging").textContent = info.tagging.enabled ? "Stop Tagging" : "Tag Modules";
+  $(".act-profiler-tagging").setAttribute("data-enabled", info.tagging.enabled ? "1" : "0");
+}
+
+let PROFILER_TIMER = null;
+async function refreshProfiler() {
+  clearTimeout(PROFILER_TIMER);
+  PROFILER_TIMER = null;
+  if (!$(".dialog.profiler:not(.hidden)")) return;
+  try {
+    const info = JSON.parse(await requestGet("/profiler"));
+    renderProfiler(info);
+    PROFILER_TIMER = setTimeout(refreshProfiler, info.periodMs);
+  } catch (err) {
+    console.error("Profiler:", err);
+  }
+}
+
+function openProfiler() {
+  Dialog.show('profiler');
+  refreshProfiler();
+}
+
 async function saveEditorFile(runFile = false) {
   Dialog.loading.show('Saving...');
   let editor = $(".dialog.editor .file-content");
@@ -471,12 +530,18 @@ function isModified(target) {
 
 async function openNavigator() {
   Dialog.show('navigator');
+  openScreenSocket();
   await reloadScreen();
   autoReloadScreen();
 }
 
 let SCREEN_NAVIGATING = false;
 async function runNavigation(direction) {
+  if (screenLive()) {
+    // the screen changes come back over the socket, no reload needed
+    SCREEN_SOCKET.send(`nav ${direction.toLowerCase()}`);
+    return;
+  }
   if (SCREEN_NAVIGATING) return;
   SCREEN_NAVIGATING = true;
   try {
@@ -516,7 +581,7 @@ let AUTO_RELOAD_SCREEN = null;
 async function taskReloader() {
   let timer = parseInt(eConfigAutoReload.value);
   let navigatorOpen = $(".dialog.navigator:not(.hidden)");
-  if (timer <= 0 || !navigatorOpen) {
+  if (timer <= 0 || !navigatorOpen || screenLive()) {
     if (AUTO_RELOAD_SCREEN) {
       clearTimeout(AUTO_RELOAD_SCREEN);
       AUTO_RELOAD_SCREEN = null;
@@ -541,10 +606,73 @@ async function autoReloadScreen() {
   if (timer > 0) taskReloader();
 }
 
+/// LIVE SCREEN
+// The device pushes screen changes over a WebSocket while the navigator is open.
+// Without it (older firmware, proxy, lost connection) the navigator polls /getscreen as before.
+const eNavigatorStats = $("#navigator-stats");
+let SCREEN_SOCKET = null;
+let SCREEN_RENDER = Promise.resolve();
+let SCREEN_PING = null;
+let SCREEN_RTT = null;
+
+function screenLive() {
+  return SCREEN_SOCKET !== null && SCREEN_SOCKET.readyState === WebSocket.OPEN;
+}
+
+function openScreenSocket() {
+  if (SCREEN_SOCKET || !window.WebSocket) return;
+  const proto = location.protocol === "https:" ? "wss:" : "ws:";
+  const socket = new WebSocket(`${proto}//${location.host}${IS_DEV ? "/bruce" : ""}/ws`);
+  socket.binaryType = "arraybuffer";
+  SCREEN_SOCKET = socket;
+
+  socket.onopen = () => {
+    SCREEN_PING = setInterval(() => {
+      if (!$(".dialog.navigator:not(.hidden)")) {
+        socket.close();
+        return;
+      }
+      socket.send(`ping ${performance.now()}`);
+    }, 2000);
+  };
+  socket.onmessage = (e) => {
+    if (typeof e.data !== "string") {
+      // keep frames in order; a keyframe starts with SCREEN_INFO (99) and repaints the whole screen
+      const frame = new Uint8Array(e.data);
+      SCREEN_RENDER = SCREEN_RENDER.then(() => renderTFT(frame, frame[2] !== 99)).catch(console.error);
+    } else if (e.data.startsWith("pong ")) {
+      SCREEN_RTT = performance.now() - parseFloat(e.data.substring(5));
+    } else if (e.data.startsWith("stats ")) {
+      showScreenStats(JSON.parse(e.data.substring(6)));
+    } else if (e.data.startsWith("error ")) {
+      console.warn("Navigator:", e.data.substring(6));
+    }
+  };
+  socket.onclose = () => {
+    clearInterval(SCREEN_PING);
+    SCREEN_PING = null;
+    SCREEN_RTT = null;
+    if (SCREEN_SOCKET === socket) SCREEN_SOCKET = null;
+    eNavigatorStats.textContent = "";
+    autoReloadScreen();
+  };
+}
+
+function showScreenStats(stats) {
+  let text = `${stats.fps.toFixed(0)} fps`;
+  if (SCREEN_RTT !== null) text += ` | ${SCREEN_RTT.toFixed(0)} ms`;
+  eNavigatorStats.textContent = text;
+  eNavigatorStats.title =
+    `frames ${stats.frames} (keyframes ${stats.keyframes}, skipped ${stats.skipped}), ` +
+    `${stats.kbps.toFixed(1)} kbit/s, ${stats.clients} client(s)\n` +
+    `round trip ${SCREEN_RTT === null ? "-" : SCREEN_RTT.toFixed(1)} ms, ` +
+    `key press queued ${stats.inputLatency.toFixed(1)} ms (max ${stats.inputLatencyMax} ms)`;
+}
+
 /// TFT RENDER
 let loadingDrawn = false;
 const imageCache = {}; // global
-async function renderTFT(data) {
+async function renderTFT(data, incremental = false) {
   loadingDrawn = false;
   const canvas = $("#navigator-screen");
   const ctx = canvas.getContext("2d");
@@ -656,7 +784,7 @@ async function renderTFT(data) {
   }
 
   let offset = 0;
-  ctx.clearRect(0, 0, canvas.width, canvas.height);
+  if (!incremental) ctx.clearRect(0, 0, canvas.width, canvas.height);
   while (offset < data.length) {
     ctx.beginPath();
     if (data[offset] !== 0xAA) {
@@ -1008,6 +1136,12 @@ $(".dialog-background").addEventListener("click", async (e) => {
   }
 });
 
+$(".act-profiler-tagging").addEventListener("click", async (e) => {
+  const enable = e.target.getAttribute("data-enabled") !== "1";
+  await runCommand(`profiler tags ${enable ? "on" : "off"}`);
+  refreshProfiler();
+});
+
 $(".act-save-oinput-file").addEventListener("click", async (e) => {
   let dialog = $(".dialog.oinput");
   let fileInput = $("#oinput-input");
@@ -13,6 +13,7 @@
 #include "core/USBSerial/USBSerial.h"
 #include "core/config.h"
 #include "core/configPins.h"
+#include "core/input_events.h"
 #include "core/serial_commands/cli.h"
 #include "core/startup_app.h"
 #include <Arduino.h>
@@ -216,28 +217,8 @@ extern volatile int EncoderLedChange;
 #endif
 
 extern TaskHandle_t xHandle;
-extern inline bool check(volatile bool &btn) {
-
-#ifndef USE_TFT_eSPI_TOUCH
-    if (!btn) return false;
-    vTaskSuspend(xHandle);
-    btn = false;
-    AnyKeyPress = false;
-    SerialCmdPress = false;
-    delay(10);
-    vTaskResume(xHandle);
-    return true;
-#else
-
-    InputHandler();
-    if (!btn) return false;
-    btn = false;
-    AnyKeyPress = false;
-    SerialCmdPress = false;
-    return true;
-
-#endif
-}
+// True once per press of btn, from the input event queue (core/input_events.h)
+extern inline bool check(volatile bool &btn) { return inputTake(btn); }
 
 extern gpio_num_t mic_bclk_pin; // used to configure Cardputer ADV Microphone
 
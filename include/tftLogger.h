@@ -1,5 +1,6 @@
 #ifndef __DISPLAY_LOGER
 #define __DISPLAY_LOGER
+#include <atomic>
 #ifdef HAS_SCREEN
 #include <TFT_eSPI.h>
 #define BRUCE_TFT_DRIVER TFT_eSPI
@@ -56,6 +57,9 @@ private:
     TaskHandle_t asyncSerialTask = NULL;
     QueueHandle_t asyncSerialQueue = NULL;
     static void asyncSerialTaskFunc(void *pv);
+    std::atomic<QueueHandle_t> streamQueue{NULL};
+    std::atomic<int> streamSenders{0}; // drawing tasks between reading streamQueue and sending to it
+    volatile bool streamOverflow = false;
 
 public:
     tft_logger(int16_t w = TFT_WIDTH, int16_t h = TFT_HEIGHT);
@@ -69,6 +73,13 @@ public:
     void inline setSleepMode(bool mode) { isSleeping = mode; }
 
     void getBinLog(uint8_t *outBuffer, size_t &outSize);
+    // Wire form of a log entry (image slot replaced by its path), returns its size
+    uint8_t getLogPacket(const tftLog &entry, uint8_t *outBuffer);
+    // New log entries are also sent to this queue, used by the WebUI to stream screen changes.
+    // Entries that don't fit are dropped and reported once by takeStreamOverflow().
+    // Returns once no task is sending to the previous queue anymore, so it can then be deleted.
+    void setStreamQueue(QueueHandle_t queue);
+    bool takeStreamOverflow();
     bool removeLogEntriesInsideRect(int rx, int ry, int rw, int rh);
     void removeOverlappedImages(int x, int y, int center, int ms);
 
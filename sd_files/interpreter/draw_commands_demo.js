@@ -0,0 +1,74 @@
+// Bouncing balls rendered with display.drawCommands() and sprite.present().
+// The whole frame is packed into one Int16Array and drawn by a single native call,
+// then frameStats() reports FPS and where the frame time went. Press ESC to exit.
+var display = require('display');
+var keyboard = require('keyboard');
+
+var CMD = display.CMD;
+var width = display.width();
+var height = display.height();
+var sprite = display.createSprite();
+
+var BALLS = 40;
+var balls = [];
+for (var i = 0; i < BALLS; i++) {
+  balls.push({
+    x: Math.random() * (width - 20) + 10,
+    y: Math.random() * (height - 20) + 10,
+    dx: Math.random() * 4 - 2,
+    dy: Math.random() * 4 - 2,
+    r: 3 + Math.floor(Math.random() * 6),
+    color: display.color(
+      64 + Math.floor(Math.random() * 192),
+      64 + Math.floor(Math.random() * 192),
+      64 + Math.floor(Math.random() * 192)
+    ),
+  });
+}
+
+// FILL(2) + one FILL_CIRCLE(5) per ball + TEXT_COLOR(3) + TEXT(4) for the stats line
+var frame = new Int16Array(2 + BALLS * 5 + 3 + 4);
+var strings = [''];
+var black = display.color(0, 0, 0);
+var white = display.color(255, 255, 255);
+
+while (!keyboard.getEscPress()) {
+  var n = 0;
+  frame[n++] = CMD.FILL;
+  frame[n++] = black;
+
+  for (var i = 0; i < BALLS; i++) {
+    var b = balls[i];
+    b.x += b.dx;
+    b.y += b.dy;
+    if (b.x < b.r || b.x > width - b.r) b.dx = -b.dx;
+    if (b.y < b.r || b.y > height - b.r) b.dy = -b.dy;
+    frame[n++] = CMD.FILL_CIRCLE;
+    frame[n++] = b.x;
+    frame[n++] = b.y;
+    frame[n++] = b.r;
+    frame[n++] = b.color;
+  }
+
+  var stats = display.frameStats();
+  strings[0] =
+    stats.fps.toFixed(1) +
+    ' fps  draw ' +
+    stats.drawTime.toFixed(1) +
+    'ms  push ' +
+    stats.presentTime.toFixed(1) +
+    'ms' +
+    (stats.dma ? ' dma' : '');
+  frame[n++] = CMD.TEXT_COLOR;
+  frame[n++] = white;
+  frame[n++] = black;
+  frame[n++] = CMD.TEXT;
+  frame[n++] = 2;
+  frame[n++] = 2;
+  frame[n++] = 0;
+
+  sprite.drawCommands(frame, strings);
+  sprite.present();
+}
+
+sprite.deleteSprite();
@@ -0,0 +1,59 @@
+// Several event sources in one script without busy-waiting:
+// a clock redrawn every second, keyboard polling every 30 ms, serial lines read in the background
+// and an async HTTP request once WiFi is up. The loop sleeps whenever nothing is due. ESC exits.
+var display = require('display');
+var keyboard = require('keyboard');
+var serialApi = require('serial');
+var wifi = require('wifi');
+
+var running = true;
+var state = { seconds: 0, keys: 0, serial: '-', http: wifi.connected() ? 'fetching...' : 'no wifi' };
+
+function redraw() {
+  display.fill(BRUCE_BGCOLOR);
+  display.setTextColor(BRUCE_PRICOLOR);
+  display.setTextSize(1);
+  display.drawString('uptime  ' + state.seconds + ' s', 4, 4);
+  display.drawString('keys    ' + state.keys, 4, 16);
+  display.drawString('serial  ' + state.serial, 4, 28);
+  display.drawString('http    ' + state.http, 4, 40);
+  display.drawString('ESC to exit', 4, 64);
+}
+
+var clock = setInterval(function () {
+  state.seconds++;
+  redraw();
+}, 1000);
+
+var input = setInterval(function () {
+  if (keyboard.getEscPress()) {
+    running = false;
+    clearInterval(clock);
+    clearInterval(input);
+    return;
+  }
+  if (keyboard.getNextPress() || keyboard.getPrevPress() || keyboard.getSelPress()) {
+    state.keys++;
+    redraw();
+  }
+}, 30);
+
+function readSerial() {
+  serialApi.readln(1000, function (error, line) {
+    if (!running) return;
+    if (line) state.serial = line;
+    redraw();
+    readSerial();
+  });
+}
+readSerial();
+
+if (wifi.connected()) {
+  wifi.httpFetch('http://example.com', { method: 'GET' }, function (error, response) {
+    if (!running) return;
+    state.http = error ? error : response.status + ', ' + response.body.length + ' bytes';
+    redraw();
+  });
+}
+
+redraw();
@@ -0,0 +1,49 @@
+// Streaming HTTP: connection reuse, downloads straight to a file and chunked reads into one buffer.
+// Timings are printed to serial; the second request to the same host should show reused: true
+// and no dns/connect/tls time.
+var wifi = require('wifi');
+var serialApi = require('serial');
+var display = require('display');
+
+var URL = 'https://example.com/';
+
+function timing(t) {
+  return (
+    'dns ' + t.dns.toFixed(1) +
+    ' connect ' + t.connect.toFixed(1) +
+    ' tls ' + t.tls.toFixed(1) +
+    ' firstByte ' + t.firstByte.toFixed(1) +
+    ' total ' + t.total.toFixed(1) +
+    (t.reused ? ' (reused)' : '')
+  );
+}
+
+// 1. Plain fetch, twice, to see what keep-alive saves
+for (var i = 0; i < 2; i++) {
+  var res = wifi.httpFetch(URL);
+  serialApi.println('fetch #' + (i + 1) + ' ' + res.status + ' ' + res.length + ' bytes');
+  serialApi.println('  ' + timing(res.timing));
+}
+
+// 2. Download to a file without holding the body in memory
+var saved = wifi.httpFetch(URL, { saveTo: '/example.html' });
+serialApi.println('saved ' + saved.length + ' bytes to ' + saved.file);
+
+// 3. Read the body in 1 KB pieces into a buffer that is reused for every chunk
+var stream = wifi.httpOpen(URL);
+var buffer = new Uint8Array(1024);
+var total = 0;
+var chunks = 0;
+var n;
+while ((n = stream.read(buffer)) > 0) {
+  total += n;
+  chunks++;
+}
+stream.close();
+serialApi.println('streamed ' + total + ' bytes in ' + chunks + ' reads, status ' + stream.status);
+
+display.fill(BRUCE_BGCOLOR);
+display.setTextColor(BRUCE_PRICOLOR);
+display.drawString('HTTP stream demo done', 4, 4);
+display.drawString('see serial for timings', 4, 16);
+delay(2000);
@@ -0,0 +1,63 @@
+// Storage throughput benchmark for the storage.open() file handle API.
+// Writes a test file in 4 KB blocks, reads it back into one reusable buffer, then times
+// readLine() and find() over it. Results are shown on screen and printed to serial.
+var display = require('display');
+var keyboard = require('keyboard');
+var storage = require('storage');
+var serialApi = require('serial');
+
+var FILE_SIZE = 1024 * 1024; // 1 MB
+var BLOCK = 4096;
+var path = { fs: 'sd', path: '/bench.bin' };
+if (!storage.spaceSDCard().total) path.fs = 'littlefs';
+
+var lines = [];
+function report(text) {
+    lines.push(text);
+    serialApi.println(text);
+    display.fill(BRUCE_BGCOLOR);
+    display.setTextColor(BRUCE_PRICOLOR);
+    display.setTextSize(1);
+    for (var i = 0; i < lines.length; i++) display.drawString(lines[i], 4, 4 + i * 12);
+}
+
+function mbps(bytes, ms) {
+    if (ms <= 0) ms = 1;
+    return (bytes / 1048576 / (ms / 1000)).toFixed(2) + ' MB/s';
+}
+
+report('Storage benchmark (' + path.fs + ')');
+
+// Blocks of text lines so readLine() has something to chew on
+var block = new Uint8Array(BLOCK);
+var pattern = 'bruce storage benchmark line 0123456789\n';
+for (var i = 0; i < BLOCK; i++) block[i] = pattern.charCodeAt(i % pattern.length);
+
+var file = storage.open(path, 'w');
+var start = now();
+for (var written = 0; written < FILE_SIZE; written += BLOCK) file.write(block);
+file.close();
+report('write ' + mbps(FILE_SIZE, now() - start));
+
+file = storage.open(path, 'r');
+start = now();
+var total = 0;
+var n;
+while ((n = file.read(block)) > 0) total += n;
+report('read  ' + mbps(total, now() - start));
+
+file.seek(0);
+start = now();
+var count = 0;
+while (file.readLine() !== null) count++;
+report('readLine ' + count + ' lines ' + mbps(FILE_SIZE, now() - start));
+
+file.seek(0);
+start = now();
+var found = file.find('not in this file');
+report('find miss ' + mbps(FILE_SIZE, now() - start) + ' (' + found + ')');
+file.close();
+
+storage.remove(path);
+report('Done, press ESC');
+while (!keyboard.getEscPress()) delay(50);
@@ -0,0 +1,95 @@
+// Event loop timer jitter test.
+// Runs a 10 ms setInterval three times: on an idle loop, with a second interval doing 4 ms of busy
+// work every 25 ms, and with a background wifi.scan() in flight. Each tick is compared against its
+// ideal time (start + n * interval). Then a chain of 20 ms setTimeout calls measures one-shot lateness.
+// Results are shown on screen and printed to serial.
+var display = require('display');
+var wifi = require('wifi');
+var serialApi = require('serial');
+
+var INTERVAL = 10;
+var TICKS = 300;
+
+var lines = [];
+function report(text) {
+  lines.push(text);
+  serialApi.println(text);
+  display.fill(BRUCE_BGCOLOR);
+  display.setTextColor(BRUCE_PRICOLOR);
+  display.setTextSize(1);
+  for (var i = 0; i < lines.length; i++) display.drawString(lines[i], 4, 4 + i * 12);
+}
+
+function summary(name, errors) {
+  var min = errors[0];
+  var max = errors[0];
+  var sum = 0;
+  for (var i = 0; i < errors.length; i++) {
+    if (errors[i] < min) min = errors[i];
+    if (errors[i] > max) max = errors[i];
+    sum += errors[i];
+  }
+  var avg = sum / errors.length;
+  var variance = 0;
+  for (var i = 0; i < errors.length; i++) variance += (errors[i] - avg) * (errors[i] - avg);
+  report(
+    name +
+      ' min ' + min +
+      ' avg ' + avg.toFixed(2) +
+      ' max ' + max +
+      ' sd ' + Math.sqrt(variance / errors.length).toFixed(2) + ' ms'
+  );
+}
+
+function measureInterval(name, load, done) {
+  var errors = [];
+  var start = now();
+  var n = 0;
+  var loadTimer = null;
+  if (load) {
+    loadTimer = setInterval(function () {
+      var until = now() + 4;
+      while (now() < until) {}
+    }, 25);
+  }
+  var timer = setInterval(function () {
+    n++;
+    errors.push(now() - (start + n * INTERVAL));
+    if (n < TICKS) return;
+    clearInterval(timer);
+    if (loadTimer !== null) clearInterval(loadTimer);
+    summary(name, errors);
+    done();
+  }, INTERVAL);
+}
+
+function measureTimeouts(done) {
+  var errors = [];
+  var count = 0;
+  function arm() {
+    var expected = now() + 20;
+    setTimeout(function () {
+      errors.push(now() - expected);
+      if (++count < 50) return arm();
+      summary('timeout', errors);
+      done();
+    }, 20);
+  }
+  arm();
+}
+
+report('Timer jitter, ' + INTERVAL + ' ms interval');
+measureInterval('idle', false, function () {
+  measureInterval('load', true, function () {
+    var scanned = -1;
+    wifi.scan(function (error, networks) {
+      scanned = error ? 0 : networks.length;
+    });
+    measureInterval('scan', false, function () {
+      if (scanned >= 0) report('scan finished: ' + scanned + ' networks');
+      measureTimeouts(function () {
+        report('Done');
+      });
+    });
+  });
+});
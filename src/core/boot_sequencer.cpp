@@ -0,0 +1,49 @@
+#include "boot_sequencer.h"
+#include "boot_timeline.h"
+#include "profiler.h"
+
+bool BootSequencer::add(const char *name, Step run, bool background) {
+    uint8_t &count = background ? bgCount : fgCount;
+    if (count >= BOOT_SEQUENCER_MAX_STEPS) return false;
+    (background ? bg : fg)[count++] = {name, run};
+    return true;
+}
+
+void BootSequencer::run(const Entry &entry) {
+    BootPhaseScope phase(entry.name);
+    entry.run();
+}
+
+void BootSequencer::runBackground() {
+    for (uint8_t i = 0; i < bgCount; i++) run(bg[i]);
+    bgDone = true;
+}
+
+void BootSequencer::backgroundTask(void *parameter) {
+    ((BootSequencer *)parameter)->runBackground();
+    vTaskDelete(NULL);
+}
+
+void BootSequencer::start() {
+    if (bgCount == 0) {
+        bgDone = true;
+        return;
+    }
+    profilerTaskStack("bootSequencer", BOOT_SEQUENCER_STACK);
+    // Same priority as the setup task, they share the CPU while the splash plays
+    if (xTaskCreate(backgroundTask, "bootSequencer", BOOT_SEQUENCER_STACK, this, 1, NULL) != pdPASS) {
+        log_e("Boot sequencer task failed, running its steps in the foreground");
+        runBackground();
+    }
+}
+
+bool BootSequencer::step() {
+    if (fgPos == fgCount) return false;
+    run(fg[fgPos++]);
+    return true;
+}
+
+void BootSequencer::finish() {
+    while (step());
+    while (!bgDone) delay(1);
+}
@@ -0,0 +1,50 @@
+#ifndef __BOOT_SEQUENCER_H__
+#define __BOOT_SEQUENCER_H__
+
+// Runs the init steps the splash does not depend on while it plays, each one a phase of the boot
+// timeline.
+//  - foreground steps run on the setup task, one per step() call between two frames of the splash.
+//    They may use the display and the SD card, which share a SPI bus on many boards.
+//  - background steps run in order in a task of their own from start(), alongside the splash and the
+//    input task. They must not draw, read the SD card or use a bus the input task uses: the RTC shares
+//    Wire1 with the M5Unified input on some boards, so it runs before the input task instead.
+
+#include <Arduino.h>
+
+#define BOOT_SEQUENCER_MAX_STEPS 8 // of each kind
+#define BOOT_SEQUENCER_STACK 4096
+
+class BootSequencer {
+public:
+    typedef void (*Step)();
+
+    // False when there are already BOOT_SEQUENCER_MAX_STEPS of that kind
+    bool add(const char *name, Step run, bool background = false);
+    // Starts the background steps
+    void start();
+    // Runs the next foreground step, false when none was left
+    bool step();
+    // Every step ran
+    bool done() const { return fgPos == fgCount && bgDone; }
+    // Runs the foreground steps left and waits for the background ones
+    void finish();
+
+private:
+    struct Entry {
+        const char *name;
+        Step run;
+    };
+
+    Entry fg[BOOT_SEQUENCER_MAX_STEPS];
+    Entry bg[BOOT_SEQUENCER_MAX_STEPS];
+    uint8_t fgCount = 0;
+    uint8_t fgPos = 0;
+    uint8_t bgCount = 0;
+    volatile bool bgDone = false;
+
+    static void run(const Entry &entry);
+    void runBackground();
+    static void backgroundTask(void *parameter);
+};
+
+#endif
@@ -0,0 +1,81 @@
+#include "boot_timeline.h"
+#include <esp_timer.h>
+
+static portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED; // phases begin from more than one task
+static BootPhase phases[BOOT_TIMELINE_MAX];
+static uint8_t phaseCount = 0;
+static uint32_t totalUs = 0;
+
+static uint32_t nowUs() {
+    uint32_t us = esp_timer_get_time();
+    return us ? us : 1; // 0 is "still running"
+}
+
+int8_t bootPhaseBegin(const char *name) {
+    uint32_t start = nowUs();
+    int8_t index = -1;
+    portENTER_CRITICAL(&mux);
+    if (phaseCount < BOOT_TIMELINE_MAX) {
+        index = phaseCount++;
+        BootPhase &p = phases[index];
+        strncpy(p.name, name, BOOT_TIMELINE_NAME_LEN - 1);
+        p.name[BOOT_TIMELINE_NAME_LEN - 1] = '\0';
+        p.startUs = start;
+        p.endUs = 0;
+        p.core = xPortGetCoreID();
+    }
+    portEXIT_CRITICAL(&mux);
+    return index;
+}
+
+void bootPhaseEnd(int8_t phase) {
+    if (phase < 0 || phase >= BOOT_TIMELINE_MAX) return;
+    uint32_t end = nowUs();
+    portENTER_CRITICAL(&mux);
+    phases[phase].endUs = end;
+    portEXIT_CRITICAL(&mux);
+}
+
+void bootTimelineDone() { totalUs = nowUs(); }
+
+uint8_t bootPhases(BootPhase *out, uint8_t max) {
+    portENTER_CRITICAL(&mux);
+    uint8_t n = min(max, phaseCount);
+    memcpy(out, phases, n * sizeof(BootPhase));
+    portEXIT_CRITICAL(&mux);
+    return n;
+}
+
+uint32_t bootTimelineTotalUs() { return totalUs; }
+
+String bootTimelineReport() {
+    BootPhase copy[BOOT_TIMELINE_MAX];
+    uint8_t n = bootPhases(copy, BOOT_TIMELINE_MAX);
+    uint32_t total = totalUs ? totalUs : nowUs();
+    String out;
+    char line[48 + BOOT_TIMELINE_BAR];
+
+    snprintf(line, sizeof(line), "Boot timeline, %lu ms to the menu", total / 1000);
+    out += line;
+    out += totalUs ? "\n" : " so far\n";
+    out += "Phase            Core  Start ms   Time ms\n";
+    for (uint8_t i = 0; i < n; i++) {
+        const BootPhase &p = copy[i];
+        String time = p.endUs ? String((p.endUs - p.startUs) / 1000.0, 1) : "...";
+        int len = snprintf(
+            line, sizeof(line), "%-16s %4d  %8.1f  %8s |", p.name, p.core, p.startUs / 1000.0, time.c_str()
+        );
+        // Chart: one column per total / BOOT_TIMELINE_BAR, a phase gets at least one
+        uint32_t end = p.endUs ? p.endUs : total;
+        int from = (uint64_t)p.startUs * BOOT_TIMELINE_BAR / total;
+        int to = (uint64_t)end * BOOT_TIMELINE_BAR / total;
+        if (to <= from) to = from + 1;
+        for (int c = 0; c < to && c < BOOT_TIMELINE_BAR && len < (int)sizeof(line) - 2; c++) {
+            line[len++] = c >= from ? '#' : ' ';
+        }
+        line[len++] = '\n';
+        line[len] = '\0';
+        out += line;
+    }
+    return out;
+}
@@ -0,0 +1,45 @@
+#ifndef __BOOT_TIMELINE_H__
+#define __BOOT_TIMELINE_H__
+
+// Boot timeline: when each init phase of setup() started and how long it took, in microseconds since
+// the chip reset, so what ran before setup() (bootloader, PSRAM test...) shows as the start of the
+// first phase. Phases can overlap: the background steps of the boot sequencer run next to the splash.
+// The report goes to serial when setup() is done and to the "profiler boot" command.
+
+#include <Arduino.h>
+
+#define BOOT_TIMELINE_MAX 24
+#define BOOT_TIMELINE_NAME_LEN 16
+#define BOOT_TIMELINE_BAR 40 // columns of the report chart
+
+struct BootPhase {
+    char name[BOOT_TIMELINE_NAME_LEN];
+    uint32_t startUs;
+    uint32_t endUs; // 0 while running
+    int8_t core;
+};
+
+// Index of the phase for bootPhaseEnd(), -1 when the table is full
+int8_t bootPhaseBegin(const char *name);
+void bootPhaseEnd(int8_t phase);
+// End of setup(), what the total counts up to
+void bootTimelineDone();
+
+// Returns the number of entries written, in the order they began
+uint8_t bootPhases(BootPhase *out, uint8_t max);
+uint32_t bootTimelineTotalUs(); // 0 until bootTimelineDone()
+
+// Table with start, duration and core of each phase and a chart of where they fall
+String bootTimelineReport();
+
+// Times a scope as a phase
+class BootPhaseScope {
+public:
+    BootPhaseScope(const char *name) : phase(bootPhaseBegin(name)) {}
+    ~BootPhaseScope() { bootPhaseEnd(phase); }
+
+private:
+    int8_t phase;
+};
+
+#endif
@@ -51,6 +51,9 @@ JsonDocument BruceConfig::toJson() const {
 
     setting["evilWifiPasswordMode"] = evilPortalPasswordMode;
 
+    JsonObject _dnsOverrides = setting["dnsOverrides"].to<JsonObject>();
+    for (const auto &pair : dnsOverrides) { _dnsOverrides[pair.first] = pair.second; }
+
     JsonObject _wifi = setting["wifi"].to<JsonObject>();
     for (const auto &pair : wifi) { _wifi[pair.first] = pair.second; }
 
@@ -307,6 +310,15 @@ void BruceConfig::fromFile(bool checkFS) {
         log_e("Fail");
     }
 
+    if (!setting["dnsOverrides"].isNull()) {
+        dnsOverrides.clear();
+        JsonObject dnsObj = setting["dnsOverrides"].as<JsonObject>();
+        for (JsonPair kv : dnsObj) dnsOverrides[kv.key().c_str()] = kv.value().as<String>();
+    } else {
+        count++;
+        log_e("Fail");
+    }
+
     if (!setting["mifareKeys"].isNull()) {
         mifareKeys.clear();
         JsonArray _mifareKeys = setting["mifareKeys"].as<JsonArray>();
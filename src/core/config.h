@@ -65,6 +65,7 @@ public:
     // EvilPortal
     EvilPortalEndpoints evilPortalEndpoints = {"/creds", "/ssid", true, true, true};
     EvilPortalPasswordMode evilPortalPasswordMode = FULL_PASSWORD;
+    std::map<String, String> dnsOverrides = {}; // domain pattern -> IPv4, checked before the "*" record
 
     void setWifiMAC(const String &mac) {
         wifiMAC = mac;
@@ -2,6 +2,7 @@
 #include "core/wifi/webInterface.h" // for server
 #include "core/wifi/wg.h"           //for isConnectedWireguard to print wireguard lock
 #include "mykeyboard.h"
+#include "powerSave.h"
 #include "settings.h" //for timeStr
 #include "utils.h"
 #include <JPEGDecoder.h>
@@ -108,6 +109,7 @@ void turnOffDisplay() { setBrightness(0, false); }
 
 bool wakeUpScreen() {
     previousMillis = millis();
+    cancelScreenFade();
     if (isScreenOff) {
         isScreenOff = false;
         dimmer = false;
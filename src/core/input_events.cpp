@@ -0,0 +1,234 @@
+#include "input_events.h"
+#include "powerSave.h"
+#include <globals.h>
+
+// Indexed by InputButton
+static volatile bool *const inputFlags[INPUT_BUTTONS] = {
+    &NextPress,
+    &PrevPress,
+    &UpPress,
+    &DownPress,
+    &SelPress,
+    &EscPress,
+    &NextPagePress,
+    &PrevPagePress,
+    &AnyKeyPress,
+    &SerialCmdPress,
+};
+
+static SpscQueue<InputEvent, INPUT_QUEUE_SIZE> queue;
+static InputStats stats; // events and dropped are written by the producer, the rest by the consumer
+
+// Producer side
+static uint16_t latched = 0; // flags as last written by the producer
+static uint32_t latchedAt[INPUT_BUTTONS];
+static bool touchLatched = false;
+static uint32_t touchAt = 0;
+
+// Consumer side
+static uint8_t pending[INPUT_BUTTONS];
+static uint32_t pendingAt[INPUT_BUTTONS]; // newest pending press
+static InputKey keys[INPUT_KEY_BUFFER];
+static uint32_t keyTimes[INPUT_KEY_BUFFER];
+static uint8_t keyFirst = 0;
+static uint8_t keyCount = 0;
+
+static uint16_t readFlags() {
+    uint16_t mask = 0;
+    for (uint8_t b = 0; b < INPUT_BUTTONS; b++) {
+        if (*inputFlags[b]) mask |= 1 << b;
+    }
+    return mask;
+}
+
+/**********************************************************************
+**  Producer
+**********************************************************************/
+static void publish(InputEvent &event) {
+    event.time = micros();
+    if (queue.push(event)) stats.events++;
+    else stats.dropped++;
+}
+
+static void publishKey() {
+    InputEvent event;
+    event.type = INPUT_EVENT_KEY;
+    InputKey &key = event.key;
+    key.exit_key = KeyStroke.exit_key;
+    key.fn = KeyStroke.fn;
+    key.del = KeyStroke.del;
+    key.enter = KeyStroke.enter;
+    key.alt = KeyStroke.alt;
+    key.ctrl = KeyStroke.ctrl;
+    key.gui = KeyStroke.gui;
+    key.modifiers = KeyStroke.modifiers;
+    key.wordLen = min(KeyStroke.word.size(), (size_t)INPUT_KEY_WORD);
+    key.hidLen = min(KeyStroke.hid_keys.size(), (size_t)INPUT_KEY_WORD);
+    key.modifierLen = min(KeyStroke.modifier_keys.size(), (size_t)INPUT_KEY_WORD);
+    memcpy(key.word, KeyStroke.word.data(), key.wordLen);
+    memcpy(key.hid_keys, KeyStroke.hid_keys.data(), key.hidLen);
+    memcpy(key.modifier_keys, KeyStroke.modifier_keys.data(), key.modifierLen);
+    publish(event);
+}
+
+void inputPoll() {
+#ifndef USE_TFT_eSPI_TOUCH
+    // A second producer would break the queue, see input_events.h
+    static TaskHandle_t producer = xTaskGetCurrentTaskHandle();
+    configASSERT(producer == xTaskGetCurrentTaskHandle());
+#endif
+    uint32_t now = millis();
+
+    // Since the last pass: a latched flag that reads false was consumed (check() or cleared by hand),
+    // a flag that reads true without being latched was set by another task (serial or WebUI navigation)
+    uint16_t before = readFlags();
+    uint16_t taken = latched & ~before;
+    uint16_t external = before & ~latched;
+
+    // Touch is consumed along with AnyKeyPress, as it used to be
+    bool touchTaken = !touchPoint.pressed || (taken & (1 << INPUT_ANY));
+    if (touchLatched && (touchTaken || now - touchAt >= INPUT_HOLD_MS)) {
+        touchPoint.Clear();
+        touchLatched = false;
+    }
+
+    InputHandler();
+
+    // Board handlers also write false while their debounce runs, so the producer keeps the flags latched
+    // itself and writes them back
+    uint16_t after = readFlags();
+    uint16_t pressed = external | (after & ~before);
+    uint16_t state = latched & ~taken;
+    for (uint8_t b = 0; b < INPUT_BUTTONS; b++) {
+        uint16_t bit = 1 << b;
+        if (pressed & bit) latchedAt[b] = now;
+        else if ((state & bit) && now - latchedAt[b] >= INPUT_HOLD_MS) state &= ~bit;
+    }
+    state |= pressed;
+    for (uint8_t b = 0; b < INPUT_BUTTONS; b++) {
+        bool on = state & (1 << b);
+        if (((after >> b) & 1) != on) *inputFlags[b] = on;
+    }
+    latched = state;
+
+    if (pressed || KeyStroke.pressed || touchPoint.pressed) powerActivity(POWER_SOURCE_INPUT);
+
+    // Events go out after the flags, the consumer expects the flag of a pending press to be set
+    if (pressed) {
+        InputEvent event;
+        event.type = INPUT_EVENT_BUTTONS;
+        event.buttons = pressed;
+        publish(event);
+    }
+    if (KeyStroke.pressed) {
+        publishKey();
+        KeyStroke.Clear();
+    }
+    if (touchPoint.pressed && !touchLatched) {
+        touchLatched = true;
+        touchAt = now;
+        InputEvent event;
+        event.type = INPUT_EVENT_TOUCH;
+        event.touch.x = touchPoint.x;
+        event.touch.y = touchPoint.y;
+        publish(event);
+    }
+}
+
+/**********************************************************************
+**  Consumer
+**********************************************************************/
+static void countConsumed(uint32_t time) {
+    uint32_t latency = micros() - time;
+    stats.consumed++;
+    stats.latencySum += latency;
+    if (latency > stats.latencyMax) stats.latencyMax = latency;
+}
+
+static void drain() {
+#ifdef USE_TFT_eSPI_TOUCH
+    inputPoll(); // the touchscreen shares the display bus, it is read from the UI task
+#endif
+    InputEvent event;
+    while (queue.pop(event)) {
+        switch (event.type) {
+            case INPUT_EVENT_BUTTONS:
+                for (uint8_t b = 0; b < INPUT_BUTTONS; b++) {
+                    if (!(event.buttons & (1 << b))) continue;
+                    if (pending[b] < UINT8_MAX) pending[b]++;
+                    pendingAt[b] = event.time;
+                }
+                break;
+            case INPUT_EVENT_KEY: {
+                if (keyCount == INPUT_KEY_BUFFER) { // the oldest stroke gives way
+                    keyFirst = (keyFirst + 1) % INPUT_KEY_BUFFER;
+                    keyCount--;
+                    stats.expired++;
+                }
+                uint8_t i = (keyFirst + keyCount++) % INPUT_KEY_BUFFER;
+                keys[i] = event.key;
+                keyTimes[i] = event.time;
+                break;
+            }
+            case INPUT_EVENT_TOUCH:
+                // read from touchPoint, only counted here
+                countConsumed(event.time);
+                break;
+        }
+    }
+}
+
+bool inputTake(volatile bool &btn) {
+    int8_t b = INPUT_BUTTONS - 1;
+    while (b >= 0 && inputFlags[b] != &btn) b--;
+    if (b < 0) { // not a navigation flag
+        if (!btn) return false;
+        btn = false;
+        return true;
+    }
+
+    drain();
+    if (pending[b] == 0) return false;
+    // Too old, or the flag was cleared by hand since the press
+    if (micros() - pendingAt[b] >= INPUT_HOLD_MS * 1000UL || !btn) {
+        stats.expired += pending[b];
+        pending[b] = 0;
+        return false;
+    }
+    pending[b]--;
+    countConsumed(pendingAt[b]);
+    btn = false;
+    // a press also sets these two, they go with it
+    AnyKeyPress = false;
+    SerialCmdPress = false;
+    if (b != INPUT_ANY) pending[INPUT_ANY] = 0;
+    pending[INPUT_SERIAL] = 0;
+    return true;
+}
+
+bool inputTakeKey(InputKey &key) {
+    drain();
+    uint32_t now = micros();
+    while (keyCount > 0) {
+        uint32_t time = keyTimes[keyFirst];
+        bool fresh = now - time < INPUT_KEY_TTL_MS * 1000UL;
+        if (fresh) key = keys[keyFirst];
+        keyFirst = (keyFirst + 1) % INPUT_KEY_BUFFER;
+        keyCount--;
+        if (fresh) {
+            countConsumed(time);
+            return true;
+        }
+        stats.expired++;
+    }
+    return false;
+}
+
+void inputFlushKeys() {
+    drain();
+    keyCount = 0;
+}
+
+const InputStats &inputStats() { return stats; }
+
+void inputResetStats() { stats = InputStats(); }
@@ -0,0 +1,124 @@
+#ifndef __INPUT_EVENTS_H__
+#define __INPUT_EVENTS_H__
+
+// Input events between the input task and the UI.
+// The input task (producer) runs the board InputHandler() on every pass and turns new presses, key
+// strokes and touches into timestamped events in a lock-free single producer / single consumer queue.
+// The UI (consumer) drains it from check() and _getKeyPress(), neither side ever suspends the other.
+//
+// The navigation flags (NextPress, SelPress, ...) are still kept up to date for code that only reads
+// them: a press stays latched until it is consumed, its flag is cleared, or INPUT_HOLD_MS have passed.
+//
+// Producer: inputPoll() is only called by taskInputHandler in main.cpp, or from drain() on
+// USE_TFT_eSPI_TOUCH boards where there is no other producer. Consumer: whichever task owns the UI,
+// normally loopTask. The interpreter and SSH tasks take it over while loopTask waits for them, so there
+// is still only one reader at a time. Nothing else may call check() or _getKeyPress() concurrently.
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+#define INPUT_QUEUE_SIZE 32   // events between the tasks, power of two
+#define INPUT_KEY_BUFFER 16   // key strokes drained but not read yet
+#define INPUT_KEY_WORD 8      // characters kept per key stroke
+#define INPUT_HOLD_MS 75      // an unconsumed button press is dropped after this long
+#define INPUT_KEY_TTL_MS 1000 // same for key strokes, long enough for a burst of typing
+
+// Bits of InputEvent::buttons, same order as the flags table in input_events.cpp
+enum InputButton : uint8_t {
+    INPUT_NEXT,
+    INPUT_PREV,
+    INPUT_UP,
+    INPUT_DOWN,
+    INPUT_SEL,
+    INPUT_ESC,
+    INPUT_NEXT_PAGE,
+    INPUT_PREV_PAGE,
+    INPUT_ANY,
+    INPUT_SERIAL,
+    INPUT_BUTTONS
+};
+
+enum InputEventType : uint8_t { INPUT_EVENT_BUTTONS, INPUT_EVENT_KEY, INPUT_EVENT_TOUCH };
+
+// keyStroke without the vectors, so it can be copied through the queue
+struct InputKey {
+    bool exit_key, fn, del, enter, alt, ctrl, gui;
+    uint8_t modifiers;
+    uint8_t wordLen, hidLen, modifierLen;
+    char word[INPUT_KEY_WORD];
+    uint8_t hid_keys[INPUT_KEY_WORD];
+    uint8_t modifier_keys[INPUT_KEY_WORD];
+};
+
+struct InputEvent {
+    uint32_t time; // micros() when the producer saw it
+    InputEventType type;
+    union {
+        uint16_t buttons; // INPUT_EVENT_BUTTONS: bit per InputButton pressed on this pass
+        struct {
+            uint16_t x, y;
+        } touch;
+        InputKey key;
+    };
+};
+
+// Lock-free ring for one producer task and one consumer task. N must be a power of two, one slot is
+// left empty to tell a full ring from an empty one, so it holds N - 1 items. push() on a full ring
+// fails and leaves it untouched, the caller counts the drop.
+template <typename T, uint16_t N> class SpscQueue {
+    static_assert((N & (N - 1)) == 0, "SpscQueue size must be a power of two");
+
+public:
+    bool push(const T &item) {
+        uint16_t head = _head.load(std::memory_order_relaxed);
+        uint16_t next = (head + 1) & (N - 1);
+        if (next == _tail.load(std::memory_order_acquire)) return false;
+        items[head] = item;
+        _head.store(next, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T &item) {
+        uint16_t tail = _tail.load(std::memory_order_relaxed);
+        if (tail == _head.load(std::memory_order_acquire)) return false;
+        item = items[tail];
+        _tail.store((tail + 1) & (N - 1), std::memory_order_release);
+        return true;
+    }
+
+    uint16_t size() const {
+        return (_head.load(std::memory_order_acquire) - _tail.load(std::memory_order_acquire)) & (N - 1);
+    }
+
+private:
+    T items[N];
+    std::atomic<uint16_t> _head{0};
+    std::atomic<uint16_t> _tail{0};
+};
+
+struct InputStats {
+    uint32_t events;     // published by the producer
+    uint32_t dropped;    // the queue was full
+    uint32_t expired;    // never consumed
+    uint32_t consumed;   // taken by check() or _getKeyPress()
+    uint32_t latencyMax; // us between the producer seeing an input and the UI taking it
+    uint64_t latencySum;
+};
+
+// Producer: reads the board once and publishes what changed. Called by the input task on every pass.
+void inputPoll();
+
+// Consumer: true once per press of the button behind `btn` (one of the navigation flags)
+bool inputTake(volatile bool &btn);
+
+// Consumer: oldest key stroke not read yet. False when there is none.
+bool inputTakeKey(InputKey &key);
+
+// Consumer: forgets key strokes typed before now
+void inputFlushKeys();
+
+const InputStats &inputStats();
+void inputResetStats();
+
+#endif
@@ -1,6 +1,7 @@
 #include "led_control.h"
 
 #include "core/display.h"
+#include "core/profiler.h"
 #include "core/utils.h"
 #include <globals.h>
 #ifdef HAS_RGB_LED
@@ -11,6 +12,7 @@
 #include <driver/rmt_tx.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
+#include <freertos/timers.h>
 
 CRGB leds[LED_COUNT];
 
@@ -21,49 +23,8 @@ int previewLedEffectSpeed;
 int previewLedEffectDirection;
 
 CRGB hsvToRgb(uint16_t h, uint8_t s, uint8_t v) {
-    uint8_t f = (h % 60) * 255 / 60;
-    uint8_t p = (255 - s) * (uint16_t)v / 255;
-    uint8_t q = (255 - f * (uint16_t)s / 255) * (uint16_t)v / 255;
-    uint8_t t = (255 - (255 - f) * (uint16_t)s / 255) * (uint16_t)v / 255;
-    uint8_t r = 0, g = 0, b = 0;
-    switch ((h / 60) % 6) {
-        case 0:
-            r = v;
-            g = t;
-            b = p;
-            break;
-        case 1:
-            r = q;
-            g = v;
-            b = p;
-            break;
-        case 2:
-            r = p;
-            g = v;
-            b = t;
-            break;
-        case 3:
-            r = p;
-            g = q;
-            b = v;
-            break;
-        case 4:
-            r = t;
-            g = p;
-            b = v;
-            break;
-        case 5:
-            r = v;
-            g = p;
-            b = q;
-            break;
-    }
-
-    CRGB c;
-    c.red = r;
-    c.green = g;
-    c.blue = b;
-    return c;
+    LedRgb c = ledHsvToRgb(h, s, v);
+    return CRGB(c.r, c.g, c.b);
 }
 
 uint32_t alterOneColorChannel(uint32_t color, uint16_t newR, uint16_t newG, uint16_t newB) {
@@ -78,119 +39,81 @@ uint32_t alterOneColorChannel(uint32_t color, uint16_t newR, uint16_t newG, uint
     return ((r << 16) | (g << 8) | b);
 }
 
-TaskHandle_t ledEffectTaskHandle = NULL;
-
-void ledEffectTask(void *pvParameters) {
-    short hueStep = 360 / LED_COUNT;
-    short offset = 0;
-    int currentLED = 0;
-    int frame = 0;
-    uint64_t start_time = esp_timer_get_time() / 1000;
-    while (1) {
-        CRGB baseColor = isPreviewLed ? previewLedColor : bruceConfig.ledColor;
-        int ledEffect = isPreviewLed ? previewLedEffect : bruceConfig.ledEffect;
-        int ledEffectSpeed = isPreviewLed ? previewLedEffectSpeed : bruceConfig.ledEffectSpeed;
-        int ledEffectDirection = isPreviewLed ? previewLedEffectDirection : bruceConfig.ledEffectDirection;
-
-        if (ledEffect == LED_EFFECT_COLOR_CYCLE || ledEffect == LED_EFFECT_COLOR_WHEEL) {
-            short delayMs = 50;
-
-#ifdef HAS_ENCODER_LED
-            if ((ledEffectSpeed == 11 && EncoderLedChange != 0)) {
-                offset = (offset + (static_cast<short>(20 / 1000.0f * 360.0f)) * EncoderLedChange) % 360;
-                EncoderLedChange = 0;
-            } else if (ledEffectSpeed < 11) {
-                float speed = 0.2f * ledEffectSpeed;
-                offset = (offset + static_cast<short>(speed * delayMs / 1000.0f * 360.0f)) % 360;
-            }
-#else
-            float speed = 0.2f * ledEffectSpeed;
-            offset = (offset + static_cast<short>(speed * delayMs / 1000.0f * 360.0f)) % 360;
-#endif
-            if (ledEffect == LED_EFFECT_COLOR_CYCLE) {
-                short hue = ((offset * -ledEffectDirection) % 360 + 360) % 360;
-                // Serial.printf("LED Effect Cycle: hue=%d, offset=%d", hue, offset);
-                fill_solid(leds, LED_COUNT, hsvToRgb(hue, 255, 255));
-            } else if (ledEffect == LED_EFFECT_COLOR_WHEEL) {
-                for (uint16_t i = 0; i < LED_COUNT; ++i) {
-                    short hue = ((offset + i * -ledEffectDirection * hueStep) % 360 + 360) % 360;
-                    // Serial.printf("LED Effect Wheel: i=%d, hue=%d\n", i, hue);
-                    leds[i] = hsvToRgb(hue, 255, 255);
-                }
-            }
+/**********************************************************************
+**  Effect engine
+**  The task sleeps on a notification. Changes (config, preview, encoder)
+**  wake it once; animated effects also get a frame from a timer every
+**  LED_FRAME_MS, and the timer is stopped while nothing moves.
+**********************************************************************/
+#define LED_NOTIFY_FRAME 0x01
+#define LED_NOTIFY_CONFIG 0x02
 
-        } else if (ledEffect == LED_COLOR_BREATHE) {
-
-            float phase;
-#ifdef HAS_ENCODER_LED
-            if ((ledEffectSpeed == 11 && EncoderLedChange != 0) || (ledEffectSpeed < 11)) {
-                if ((ledEffectSpeed == 11 && EncoderLedChange != 0)) {
-                    phase = sinf(frame / 20.0f * PI);
-                    frame += EncoderLedChange;
-                    EncoderLedChange = 0;
-                } else {
-                    float time = millis() / 1000.0f;
-                    float speed = 0.2f * ledEffectSpeed;
-                    phase = sinf(time * speed * PI);
-                }
-#else
-            float time = millis() / 1000.0f;
-            float speed = 0.2f * ledEffectSpeed;
-            phase = sinf(time * speed * PI);
-#endif
-                uint8_t value = (uint8_t)((phase + 1.0f) * 127.5f);
+TaskHandle_t ledEffectTaskHandle = NULL;
+static TimerHandle_t ledFrameTimer = NULL;
+static SemaphoreHandle_t ledFrameLock = NULL; // held while a frame is rendered and shown
+static volatile bool ledEffectsEnabled = false;
+static LedEffectStats ledStats;
+static LedFrames ledFrames(LED_COUNT);
+
+static_assert(sizeof(CRGB) == sizeof(LedRgb), "frames are copied to the LEDs as they are");
+
+static void ledLoadParams() {
+    CRGB color = isPreviewLed ? previewLedColor : CRGB(bruceConfig.ledColor);
+    LedEffectParams params;
+    params.color = {color.r, color.g, color.b};
+    params.effect = isPreviewLed ? previewLedEffect : bruceConfig.ledEffect;
+    params.speed = isPreviewLed ? previewLedEffectSpeed : bruceConfig.ledEffectSpeed;
+    params.direction = isPreviewLed ? previewLedEffectDirection : bruceConfig.ledEffectDirection;
+    ledFrames.setParams(params);
+}
 
-                for (int i = 0; i < LED_COUNT; i++) {
-                    leds[i] = CRGB(
-                        (baseColor.r * value) / 255, (baseColor.g * value) / 255, (baseColor.b * value) / 255
-                    );
-                }
-#ifdef HAS_ENCODER_LED
-            }
-#endif
+static bool ledAnimating() {
+    return ledEffectsEnabled && FastLED.getBrightness() != 0 && ledFrames.animating();
+}
 
-#if LED_COUNT > 1
-        } else if (ledEffect == LED_EFFECT_CHASE || ledEffect == LED_EFFECT_CHASE_TAIL) {
-            uint8_t cycleFrames = 11 - ledEffectSpeed;
+static void ledFrameTimerCallback(TimerHandle_t timer) {
+    xTaskNotify(ledEffectTaskHandle, LED_NOTIFY_FRAME, eSetBits);
+}
 
+void ledEffectTask(void *pvParameters) {
+    LedRgb frame[LED_COUNT];
+    while (1) {
+        uint32_t events = 0;
+        xTaskNotifyWait(0, UINT32_MAX, &events, portMAX_DELAY);
+        uint64_t start = esp_timer_get_time();
+        ledStats.wakeups++;
+
+        xSemaphoreTake(ledFrameLock, portMAX_DELAY);
+        if (events & LED_NOTIFY_CONFIG) {
+            ledLoadParams();
+            if (ledAnimating()) xTimerStart(ledFrameTimer, 0);
+            else xTimerStop(ledFrameTimer, 0);
+        }
+        if (ledEffectsEnabled) {
 #ifdef HAS_ENCODER_LED
-            if ((ledEffectSpeed == 11 && EncoderLedChange != 0) ||
-                (ledEffectSpeed < 11 && frame % cycleFrames == 0)) {
-                if ((ledEffectSpeed == 11 && EncoderLedChange != 0)) {
-                    currentLED = (currentLED + EncoderLedChange + LED_COUNT) % LED_COUNT;
-                    EncoderLedChange = 0;
-                } else {
-                    currentLED = (currentLED + ledEffectDirection + LED_COUNT) % LED_COUNT;
-                }
-#else
-            if (frame % cycleFrames == 0) {
-                currentLED = (currentLED + ledEffectDirection + LED_COUNT) % LED_COUNT;
+            int steps = EncoderLedChange;
+            EncoderLedChange = 0;
+            if (ledFrames.params().speed == LED_SPEEDS + 1 && steps != 0) ledFrames.advance(true, steps);
 #endif
-
-                fill_solid(leds, LED_COUNT, CRGB::Black);
-
-                if (ledEffect == LED_EFFECT_CHASE) {
-                    leds[currentLED] = baseColor;
-                } else {
-                    for (int i = 1; i < LED_COUNT; ++i) {
-                        int index = (currentLED - ledEffectDirection * i + LED_COUNT) % LED_COUNT;
-
-                        float fade = powf(0.6f, i);
-                        leds[index].r = baseColor.r * fade;
-                        leds[index].g = baseColor.g * fade;
-                        leds[index].b = baseColor.b * fade;
-                    }
-                }
+            if ((events & LED_NOTIFY_FRAME) && ledAnimating()) ledFrames.advance(false, 1);
+            // Only pushed to the LEDs when it differs from what they show
+            if (ledFrames.render(frame) && memcmp(frame, leds, sizeof(frame)) != 0) {
+                memcpy(leds, frame, sizeof(frame));
+                FastLED.show();
+                ledStats.frames++;
             }
-            frame++;
-#endif
         }
-
-        FastLED.show();
-        vTaskDelay(pdMS_TO_TICKS(50));
+        xSemaphoreGive(ledFrameLock);
+        ledStats.cpuTimeUs += esp_timer_get_time() - start;
     }
 }
 
+void ledEffectsUpdate() {
+    if (ledEffectTaskHandle != NULL) xTaskNotify(ledEffectTaskHandle, LED_NOTIFY_CONFIG, eSetBits);
+}
+
+const LedEffectStats &ledEffectStats() { return ledStats; }
+
 void beginLed() {
 #ifdef RGB_LED_CLK
     FastLED.addLeds<LED_TYPE, RGB_LED, RGB_LED_CLK, LED_ORDER>(leds, LED_COUNT);
@@ -258,9 +181,7 @@ void blinkLed(int blinkTime) {
 void setLedColor(CRGB color) {
     if (isPreviewLed && previewLedEffect != LED_EFFECT_SOLID) {
         previewLedColor = color;
-#ifdef HAS_ENCODER_LED
-        EncoderLedChange = 1;
-#endif
+        ledEffectsUpdate();
     } else {
         for (int i = 0; i < LED_COUNT; i++) leds[i] = color;
         FastLED.show();
@@ -269,9 +190,7 @@ void setLedColor(CRGB color) {
 
 void setLedEffect(int effect) {
     previewLedEffect = effect;
-#ifdef HAS_ENCODER_LED
-    if (isPreviewLed && previewLedEffect != LED_EFFECT_SOLID) { EncoderLedChange = 1; }
-#endif
+    ledEffectsUpdate();
 }
 
 void setLedBrightness(int value) {
@@ -279,6 +198,7 @@ void setLedBrightness(int value) {
     int bright = 255 * value / 100;
     FastLED.setBrightness(bright);
     FastLED.show();
+    ledEffectsUpdate(); // the frame timer stops while the LEDs are off
 }
 
 #define BrucePurple 9830500 // Custom purple color for Bruce
@@ -376,8 +296,8 @@ void setCustomColorSettingMenu(int rgb, std::function<uint32_t(uint32_t, int)> c
 
     static auto hoverFunction = [](void *pointer, bool shouldRender) -> bool {
         uint32_t colorToSet = *static_cast<uint32_t *>(pointer);
-        setLedColor(colorToSet);
         previewLedColor = CRGB(colorToSet);
+        setLedColor(colorToSet);
         return false;
     };
 
@@ -498,12 +418,14 @@ void setLedEffectConfig() {
                  previewLedEffect = bruceConfig.ledEffect;
                  previewLedEffectSpeed = bruceConfig.ledEffectSpeed;
                  previewLedEffectDirection = bruceConfig.ledEffectDirection;
+                 ledEffectsUpdate();
                  return false;
              }                                                                    },
             {"Config - Direction", setLedEffectDirectionConfig,           false, [](void *pointer, bool shouldRender) {
                  previewLedEffect = bruceConfig.ledEffect;
                  previewLedEffectSpeed = bruceConfig.ledEffectSpeed;
                  previewLedEffectDirection = bruceConfig.ledEffectDirection;
+                 ledEffectsUpdate();
                  return false;
              }},
         };
@@ -525,6 +447,7 @@ void setLedEffectSpeedConfig() {
     static auto hoverFunction = [](void *pointer, bool shouldRender) -> bool {
         int speedToSet = *static_cast<int *>(pointer);
         previewLedEffectSpeed = speedToSet + 1;
+        ledEffectsUpdate();
         return false;
     };
 
@@ -566,6 +489,7 @@ void setLedEffectSpeedConfig() {
     int selectedOption = loopOptions(options, bruceConfig.ledEffectSpeed - 1);
     if (selectedOption == -1 || selectedOption == options.size() - 1) {
         previewLedEffectSpeed = bruceConfig.ledEffectSpeed;
+        ledEffectsUpdate();
         return;
     }
 }
@@ -577,6 +501,7 @@ void setLedEffectDirectionConfig() {
          bruceConfig.ledEffectDirection == 1,
          [](void *pointer, bool shouldRender) {
              previewLedEffectDirection = 1;
+             ledEffectsUpdate();
              return false;
          }},
         {"Anti-Clockwise",
@@ -584,6 +509,7 @@ void setLedEffectDirectionConfig() {
          bruceConfig.ledEffectDirection == -1,
          [](void *pointer, bool shouldRender) {
              previewLedEffectDirection = -1;
+             ledEffectsUpdate();
              return false;
          }},
     };
@@ -593,6 +519,7 @@ void setLedEffectDirectionConfig() {
     int selectedOption = loopOptions(options, (bruceConfig.ledEffectDirection == 1) ? 0 : 1);
     if (selectedOption == -1 || selectedOption == options.size() - 1) {
         previewLedEffectDirection = bruceConfig.ledEffectDirection;
+        ledEffectsUpdate();
         return;
     }
 }
@@ -606,15 +533,20 @@ void ledSetup() {
 }
 
 void ledEffects(bool enable) {
-    if (enable) {
-        if (ledEffectTaskHandle == NULL) {
-            xTaskCreate(ledEffectTask, "LedEffect", 2048, NULL, 1, &ledEffectTaskHandle);
-        }
-    } else {
-        if (ledEffectTaskHandle != NULL) {
-            vTaskDelete(ledEffectTaskHandle);
-            ledEffectTaskHandle = NULL;
-        }
+    if (ledEffectTaskHandle == NULL) {
+        if (!enable) return;
+        ledFrameLock = xSemaphoreCreateMutex();
+        ledFrameTimer =
+            xTimerCreate("LedFrame", pdMS_TO_TICKS(LED_FRAME_MS), pdTRUE, NULL, ledFrameTimerCallback);
+        profilerTaskStack("LedEffect", 2048);
+        xTaskCreate(ledEffectTask, "LedEffect", 2048, NULL, 1, &ledEffectTaskHandle);
+    }
+    ledEffectsEnabled = enable;
+    ledEffectsUpdate();
+    // a frame being drawn finishes before the caller sets the LEDs itself
+    if (!enable) {
+        xSemaphoreTake(ledFrameLock, portMAX_DELAY);
+        xSemaphoreGive(ledFrameLock);
     }
 }
 
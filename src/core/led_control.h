@@ -5,13 +5,13 @@
 #ifdef HAS_RGB_LED
 #include <Arduino.h>
 #include <FastLED.h>
+#include "core/led_frames.h"
 
-#define LED_EFFECT_SOLID 0
-#define LED_COLOR_BREATHE 1
-#define LED_EFFECT_COLOR_CYCLE 2
-#define LED_EFFECT_COLOR_WHEEL 3
-#define LED_EFFECT_CHASE 4
-#define LED_EFFECT_CHASE_TAIL 5
+struct LedEffectStats {
+    uint32_t wakeups;   // notifications handled by the effect task
+    uint32_t frames;    // frames sent to the LEDs
+    uint64_t cpuTimeUs; // spent in the effect task
+};
 
 CRGB hsvToRgb(uint16_t h, uint8_t s, uint8_t v);
 uint32_t alterOneColorChannel(uint32_t color, uint16_t newR, uint16_t newG, uint16_t newB);
@@ -31,6 +31,9 @@ void setLedEffectSpeedConfig();
 void setLedEffectDirectionConfig();
 void ledSetup();
 void ledEffects(bool enable);
+// Wakes the effect task after the effect, its settings or the preview changed
+void ledEffectsUpdate();
+const LedEffectStats &ledEffectStats();
 void ledPreviewMode(bool enable);
 void setLedBrightness(int value);
 void setLedBrightnessConfig();
@@ -0,0 +1,120 @@
+#include "led_frames.h"
+#include <math.h>
+
+#define LED_CHASE_FADE_STEPS 12 // 255 * 0.6^i is 0 from there on
+
+// Per speed, 1-10 (index 0 unused). Taken from the old float formulas at 50ms per frame:
+// cycle 0.2*speed turns/s, breathe period 10/speed s, chase moves every 11-speed frames.
+static uint8_t hueStepTable[LED_SPEEDS + 1];
+static uint16_t breatheStepTable[LED_SPEEDS + 1];
+static uint8_t sineTable[256]; // (sin + 1) * 127.5 over one turn
+static uint8_t chaseFadeTable[LED_CHASE_FADE_STEPS]; // 0.6^i
+static bool tablesBuilt = false;
+
+static void buildTables() {
+    for (int s = 1; s <= LED_SPEEDS; s++) {
+        hueStepTable[s] = s * 360 * LED_FRAME_MS / 5000;
+        breatheStepTable[s] = (uint32_t)s * 65536 * LED_FRAME_MS / 10000;
+    }
+    for (int i = 0; i < 256; i++) sineTable[i] = (sinf(i * 2 * (float)M_PI / 256) + 1.0f) * 127.5f;
+    chaseFadeTable[0] = 255;
+    for (int i = 1; i < LED_CHASE_FADE_STEPS; i++) chaseFadeTable[i] = chaseFadeTable[i - 1] * 3 / 5;
+    tablesBuilt = true;
+}
+
+static inline int wrap(int value, int range) { return (value % range + range) % range; }
+
+static inline LedRgb scale(const LedRgb &c, uint8_t value) {
+    return {(uint8_t)(c.r * value / 255), (uint8_t)(c.g * value / 255), (uint8_t)(c.b * value / 255)};
+}
+
+LedRgb ledHsvToRgb(uint16_t h, uint8_t s, uint8_t v) {
+    uint8_t f = (h % 60) * 255 / 60;
+    uint8_t p = (255 - s) * (uint16_t)v / 255;
+    uint8_t q = (255 - f * (uint16_t)s / 255) * (uint16_t)v / 255;
+    uint8_t t = (255 - (255 - f) * (uint16_t)s / 255) * (uint16_t)v / 255;
+    switch ((h / 60) % 6) {
+        case 0: return {v, t, p};
+        case 1: return {q, v, p};
+        case 2: return {p, v, t};
+        case 3: return {p, q, v};
+        case 4: return {t, p, v};
+        default: return {v, p, q};
+    }
+}
+
+LedFrames::LedFrames(int count) : _count(count > 0 ? count : 1) {
+    if (!tablesBuilt) buildTables();
+}
+
+bool LedFrames::animating() const {
+    if (_params.speed < 1 || _params.speed > LED_SPEEDS) return false;
+    bool lit = _params.color.r || _params.color.g || _params.color.b;
+    switch (_params.effect) {
+        case LED_EFFECT_COLOR_CYCLE:
+        case LED_EFFECT_COLOR_WHEEL: return true;
+        case LED_COLOR_BREATHE: return lit;
+        case LED_EFFECT_CHASE:
+        case LED_EFFECT_CHASE_TAIL: return _count > 1 && lit;
+        default: return false;
+    }
+}
+
+void LedFrames::advance(bool encoder, int steps) {
+    int speed = _params.speed;
+    if (!encoder && (speed < 1 || speed > LED_SPEEDS)) return; // no timed frames when following the encoder
+    switch (_params.effect) {
+        case LED_EFFECT_COLOR_CYCLE:
+        case LED_EFFECT_COLOR_WHEEL:
+            _hue = wrap(_hue + (encoder ? LED_ENCODER_HUE_STEP * steps : hueStepTable[speed]), 360);
+            break;
+        case LED_COLOR_BREATHE:
+            _phase += encoder ? LED_ENCODER_BREATHE * steps : breatheStepTable[speed];
+            break;
+        case LED_EFFECT_CHASE:
+        case LED_EFFECT_CHASE_TAIL:
+            if (encoder) _position += steps;
+            else if (_frame++ % (LED_SPEEDS + 1 - speed) == 0) _position += _params.direction;
+            _position = wrap(_position, _count);
+            break;
+    }
+}
+
+bool LedFrames::render(LedRgb *out) const {
+    const LedRgb &color = _params.color;
+    int direction = _params.direction;
+    switch (_params.effect) {
+        case LED_EFFECT_COLOR_CYCLE: {
+            LedRgb c = ledHsvToRgb(wrap(_hue * -direction, 360), 255, 255);
+            for (int i = 0; i < _count; i++) out[i] = c;
+            return true;
+        }
+        case LED_EFFECT_COLOR_WHEEL:
+            for (int i = 0; i < _count; i++) {
+                out[i] = ledHsvToRgb(wrap(_hue + i * -direction * (360 / _count), 360), 255, 255);
+            }
+            return true;
+        case LED_COLOR_BREATHE: {
+            LedRgb c = scale(color, sineTable[_phase >> 8]);
+            for (int i = 0; i < _count; i++) out[i] = c;
+            return true;
+        }
+        case LED_EFFECT_CHASE:
+        case LED_EFFECT_CHASE_TAIL:
+            // A single LED has nothing to chase, it shows the color and the timer stays off
+            if (_count == 1) {
+                out[0] = color;
+                return true;
+            }
+            for (int i = 0; i < _count; i++) out[i] = {0, 0, 0};
+            if (_params.effect == LED_EFFECT_CHASE) {
+                out[_position] = color;
+                return true;
+            }
+            for (int i = 1; i < _count && i < LED_CHASE_FADE_STEPS; i++) {
+                out[wrap(_position - direction * i, _count)] = scale(color, chaseFadeTable[i]);
+            }
+            return true;
+        default: return false;
+    }
+}
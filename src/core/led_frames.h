@@ -0,0 +1,67 @@
+#ifndef __LED_FRAMES_H__
+#define __LED_FRAMES_H__
+
+// Frame math of the LED effects: the animation state, how one frame timer tick or encoder step moves
+// it, and the color of every LED for that state. Integer math on tables built once, and no FastLED,
+// so the frames can be checked on the host. led_control.cpp owns the task, the timer and the LEDs.
+
+#include <stdint.h>
+
+#define LED_EFFECT_SOLID 0
+#define LED_COLOR_BREATHE 1
+#define LED_EFFECT_COLOR_CYCLE 2
+#define LED_EFFECT_COLOR_WHEEL 3
+#define LED_EFFECT_CHASE 4
+#define LED_EFFECT_CHASE_TAIL 5
+
+#define LED_FRAME_MS 50          // animation rate of the effects
+#define LED_SPEEDS 10            // timed speeds 1-10, 11 follows the encoder
+#define LED_ENCODER_HUE_STEP 7   // hue per encoder step (was 20ms of cycle time)
+#define LED_ENCODER_BREATHE 1638 // phase per encoder step, a breath in 40 steps
+
+// Same layout as CRGB
+struct LedRgb {
+    uint8_t r;
+    uint8_t g;
+    uint8_t b;
+};
+
+LedRgb ledHsvToRgb(uint16_t h, uint8_t s, uint8_t v);
+
+struct LedEffectParams {
+    LedRgb color;
+    int effect;
+    int speed;     // 1-LED_SPEEDS, LED_SPEEDS + 1 follows the encoder
+    int direction; // 1 clockwise, -1 anti-clockwise
+};
+
+// Not thread safe, the effect task holds the frame lock around every call
+class LedFrames {
+public:
+    explicit LedFrames(int count);
+
+    // The animation carries on from where it is
+    void setParams(const LedEffectParams &params) { _params = params; }
+    const LedEffectParams &params() const { return _params; }
+
+    // Effects that change on their own, the rest only change when the parameters do
+    bool animating() const;
+    // Moves the animation by one timer frame, or by `steps` encoder steps
+    void advance(bool encoder, int steps);
+    // Frame for the current state into `count` LEDs. False for effects not drawn here (solid).
+    bool render(LedRgb *out) const;
+
+    int hue() const { return _hue; }
+    uint16_t phase() const { return _phase; }
+    int position() const { return _position; }
+
+private:
+    int _count;
+    LedEffectParams _params = {};
+    int16_t _hue = 0; // 0-359
+    uint16_t _phase = 0;
+    int _position = 0;
+    uint32_t _frame = 0;
+};
+
+#endif
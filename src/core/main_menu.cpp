@@ -1,5 +1,6 @@
 #include "main_menu.h"
 #include "display.h"
+#include "profiler.h"
 #include "utils.h"
 #include <globals.h>
 
@@ -49,7 +50,10 @@ void MainMenu::begin(void) {
             options.push_back(
                 {// selected lambda
                  _menuItems[i]->getName(),
-                 [this, i]() { _menuItems[i]->optionsMenu(); },
+                 [this, i]() {
+                     ProfilerHeapScope scope(_menuItems[i]->getName().c_str());
+                     _menuItems[i]->optionsMenu();
+                 },
                  false,                                  // selected = false
                  [](void *menuItem, bool shouldRender) { // render lambda
                      if (!shouldRender) return false;
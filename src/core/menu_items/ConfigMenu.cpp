@@ -2,6 +2,7 @@
 #include "core/display.h"
 #include "core/i2c_finder.h"
 #include "core/main_menu.h"
+#include "core/powerSave.h"
 #include "core/settings.h"
 #include "core/utils.h"
 #include "core/wifi/wifi_common.h"
@@ -53,6 +54,7 @@ void ConfigMenu::optionsMenu() {
         {"BadUSB/BLE", setBadUSBBLEMenu},
         {"Clock", setClock},
         {"Sleep", setSleepMode},
+        {"Power Stats", showPowerStats},
         {"Factory Reset", [=]() { bruceConfig.factoryReset(); }},
         {"Restart", [=]() { ESP.restart(); }},
     };
@@ -114,21 +114,25 @@ struct box_t {
 
 #endif
 
-// Retrieves the current keyStroke from InputHandler, resets it after use.
-// This function is used in loopTask to get the latest key press.
+// Takes the oldest key stroke from the input event queue, empty when nothing was typed.
+// This function is used in loopTask to get the key presses.
 keyStroke _getKeyPress() {
-#ifndef USE_TFT_eSPI_TOUCH
-    vTaskSuspend(xHandle);
-    keyStroke key = KeyStroke;
-    KeyStroke.Clear();
-    delay(10);
-    vTaskResume(xHandle);
+    keyStroke key;
+    InputKey event;
+    if (!inputTakeKey(event)) return key;
+    key.pressed = true;
+    key.exit_key = event.exit_key;
+    key.fn = event.fn;
+    key.del = event.del;
+    key.enter = event.enter;
+    key.alt = event.alt;
+    key.ctrl = event.ctrl;
+    key.gui = event.gui;
+    key.modifiers = event.modifiers;
+    key.word.assign(event.word, event.word + event.wordLen);
+    key.hid_keys.assign(event.hid_keys, event.hid_keys + event.hidLen);
+    key.modifier_keys.assign(event.modifier_keys, event.modifier_keys + event.modifierLen);
     return key;
-#else
-    keyStroke key = KeyStroke;
-    KeyStroke.Clear();
-    return key;
-#endif
 } // Returns a keyStroke that the keyboards won't recognize by default
 
 /*********************************************************************
@@ -789,11 +793,12 @@ String generalKeyboard(
                 }
             }
 #elif defined(HAS_KEYBOARD)  // Cardputer, T-Deck and T-LoRa-Pager
-            if (KeyStroke.pressed) {
+            keyStroke key = _getKeyPress();
+            if (key.pressed) {
                 wakeUpScreen();
                 tft.setCursor(cursor_x, cursor_y);
                 String keyStr = "";
-                for (auto i : KeyStroke.word) {
+                for (auto i : key.word) {
                     if (keyStr != "") {
                         keyStr = keyStr + "+" + i;
                     } else {
@@ -801,7 +806,7 @@ String generalKeyboard(
                     }
                 }
 
-                if (current_text.length() < max_size && !KeyStroke.enter && !KeyStroke.del) {
+                if (current_text.length() < max_size && !key.enter && !key.del) {
                     current_text += keyStr;
                     if (current_text.length() != (max_FM_size + 1) &&
                         current_text.length() != (max_FM_size + 1))
@@ -811,7 +816,7 @@ String generalKeyboard(
                     if (current_text.length() == (max_FM_size + 1)) redraw = true;
                     if (current_text.length() == (max_FP_size + 1)) redraw = true;
                 }
-                if (KeyStroke.del && current_text.length() > 0) { // delete 0x08
+                if (key.del && current_text.length() > 0) { // delete 0x08
                     // Handle backspace key
                     current_text.remove(current_text.length() - 1);
                     int fontSize = FM;
@@ -829,8 +834,7 @@ String generalKeyboard(
                     if (current_text.length() == max_FM_size) redraw = true;
                     if (current_text.length() == max_FP_size) redraw = true;
                 }
-                if (KeyStroke.enter) { break; }
-                KeyStroke.Clear();
+                if (key.enter) { break; }
             }
 #if !defined(T_LORA_PAGER)   // T-LoRa-Pager does not have a select button
             if (check(SelPress)) break;
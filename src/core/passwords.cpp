@@ -8,8 +8,7 @@
 #include "type_convertion.h"
 #include <globals.h>
 
-String xorEncryptDecryptMD5(const String &input, const String &password, const int MD5_PASSES) {
-
+static void xorKeyMD5(const String &password, const int MD5_PASSES, uint8_t md5Hash[16]) {
     MD5Builder md5;
     String hash = password;
 
@@ -19,8 +18,12 @@ String xorEncryptDecryptMD5(const String &input, const String &password, const i
         md5.calculate();
     }
 
-    uint8_t md5Hash[16];
     md5.getBytes(md5Hash); // Store MD5 hash in the output array
+}
+
+String xorEncryptDecryptMD5(const String &input, const String &password, const int MD5_PASSES) {
+    uint8_t md5Hash[16];
+    xorKeyMD5(password, MD5_PASSES, md5Hash);
 
     String output = input; // Copy input to output for modification
     for (size_t i = 0; i < input.length(); i++) {
@@ -156,22 +159,50 @@ String readDecryptedFile(FS &fs, String filepath) {
 // void writeEncryptedFile(FS &fs, String filepath, String& plaintext)
 
 String encryptString(String &plaintext, const String &password_str) {
-    String dataStr = xorEncryptDecryptMD5(plaintext, password_str, 10);
-    String dataStrHex = "";
+    XorEncryptStream ctx;
+    String out = encryptStreamBegin(ctx, password_str);
+    out.reserve(out.length() + plaintext.length() * 3 + 1);
+
+    char hex[3 * 64 + 1];
+    const uint8_t *data = (const uint8_t *)plaintext.c_str();
+    for (size_t i = 0; i < plaintext.length(); i += 64) {
+        size_t n = encryptStreamUpdate(ctx, data + i, min((size_t)64, plaintext.length() - i), hex);
+        hex[n] = '\0';
+        out += hex;
+    }
+    out += encryptStreamEnd(ctx);
 
-    for (size_t i = 0; i < dataStr.length(); i++) dataStrHex += String(dataStr[i], HEX) + " ";
-    dataStrHex.toUpperCase();
-    dataStrHex.trim();
+    return out;
+}
+
+String encryptStreamBegin(XorEncryptStream &ctx, const String &password_str) {
+    xorKeyMD5(password_str, 10, ctx.key);
+    ctx.offset = 0;
 
     String out = "Filetype: Bruce Encrypted File\nVersion: 1\n";
     out += "Algo: XOR\n"; // TODO: add AES
     out += "KeyDerivationAlgo: MD5\n";
     out += "KeyDerivationPasses: 10\n";
-    out += "Data: " + dataStrHex + "\n";
-
+    out += "Data: ";
     return out;
 }
 
+size_t encryptStreamUpdate(XorEncryptStream &ctx, const uint8_t *data, size_t len, char *out) {
+    static const char digits[] = "0123456789ABCDEF";
+    size_t pos = 0;
+    for (size_t i = 0; i < len; i++) {
+        // "XX XX XX", always two digits as readDecryptedFile() reads them in steps of 3
+        uint8_t b = data[i] ^ ctx.key[ctx.offset % 16];
+        if (ctx.offset > 0) out[pos++] = ' ';
+        out[pos++] = digits[b >> 4];
+        out[pos++] = digits[b & 0x0F];
+        ctx.offset++;
+    }
+    return pos;
+}
+
+String encryptStreamEnd(XorEncryptStream &ctx) { return "\n"; }
+
 /* OLD:
 String decryptString(String& cypertext, const String& password_str)
 
@@ -6,6 +6,22 @@
 
 String encryptString(String &plaintext, const String &password_str);
 
+// Streaming form of encryptString(), same file format, for data that arrives in pieces.
+// Plain struct so it can be kept in malloc'd per-request state.
+struct XorEncryptStream {
+    uint8_t key[16];
+    size_t offset; // bytes encrypted so far
+};
+
+// Returns the file header, to be written before any data
+String encryptStreamBegin(XorEncryptStream &ctx, const String &password_str);
+
+// Encrypts len bytes as hex text into out (needs 3 * len bytes), returns the number of chars written
+size_t encryptStreamUpdate(XorEncryptStream &ctx, const uint8_t *data, size_t len, char *out);
+
+// Returns what goes after the last data byte
+String encryptStreamEnd(XorEncryptStream &ctx);
+
 String decryptString(String &cypertext, const String &password_str);
 
 String readDecryptedFile(FS &fs, String filepath);
@@ -1,22 +1,119 @@
 #include "powerSave.h"
 #include "display.h"
+#include "scrollableTextArea.h"
 #include "settings.h"
+#include <WiFi.h>
+#include <atomic>
 
 /* Check if it's time to put the device to sleep */
 #define SCREEN_OFF_DELAY 5000
 
-void fadeOutScreen(int startValue) {
-    for (int brightValue = startValue; brightValue >= 0; brightValue -= 1) {
-        setBrightness(max(brightValue, 0), false);
-        delay(5);
+static const char *powerStateNames[POWER_STATES] = {"Active", "Idle", "Dimmed", "Screen off", "Sleep"};
+static const char *powerSourceNames[POWER_SOURCES] = {"input", "radio", "script", "job"};
+
+// Written by the input task only, other tasks just read them
+static PowerState state = POWER_ACTIVE;
+static PowerStats stats;
+static uint32_t lastTick = 0;
+static volatile uint32_t lastActivity[POWER_SOURCES];
+static std::atomic<int> holds{0};
+
+static struct {
+    volatile bool active;
+    bool sleepPanel; // panel goes to sleep at the end (sleep mode)
+    int from;
+    uint32_t start;
+} fade;
+
+void powerActivity(PowerSource source) { lastActivity[source] = millis(); }
+
+void powerHold() {
+    holds++;
+    powerActivity(POWER_SOURCE_JOB);
+}
+
+void powerRelease() {
+    if (holds.fetch_sub(1) <= 0) holds++; // unbalanced release, keep the count at zero
+    powerActivity(POWER_SOURCE_JOB);
+}
+
+PowerState powerState() { return state; }
+
+const PowerStats &powerStats() { return stats; }
+
+static bool radioOn() {
+    if (WiFi.getMode() != WIFI_OFF) return true;
+#if defined(CONFIG_BT_ENABLED)
+    if (btStarted()) return true;
+#endif
+    return false;
+}
+
+// Screen, dimmer and sleep states come from the existing flags, the CPU follows the activity
+static void governorStep(uint32_t now) {
+    // Radio, scripts and held jobs are polled, they count as activity for as long as they run
+    if (radioOn()) powerActivity(POWER_SOURCE_RADIO);
+    if (interpreter_start) powerActivity(POWER_SOURCE_SCRIPT);
+    if (holds > 0) powerActivity(POWER_SOURCE_JOB);
+
+    // previousMillis is kept fresh by wakeUpScreen() and by modules that keep the screen on
+    uint32_t quiet = now - (uint32_t)previousMillis;
+    for (uint8_t i = 0; i < POWER_SOURCES; i++) quiet = min(quiet, now - lastActivity[i]);
+    bool busy = quiet < POWER_IDLE_MS;
+
+    PowerState next = POWER_ACTIVE;
+    if (isSleeping) next = POWER_SLEEP;
+    else if (isScreenOff) next = POWER_SCREEN_OFF;
+    else if (dimmer) next = POWER_DIMMED;
+    else if (!busy) next = POWER_IDLE;
+
+    uint32_t mhz = (busy && !isSleeping) ? CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ : POWER_IDLE_MHZ;
+    if (getCpuFrequencyMhz() != mhz) setCpuFrequencyMhz(mhz);
+
+    // Accounting for the state and speed of the pass that just ended
+    uint32_t elapsed = now - lastTick;
+    lastTick = now;
+    stats.stateMs[state] += elapsed;
+    bool lowCpu = getCpuFrequencyMhz() == POWER_IDLE_MHZ;
+    if (lowCpu) stats.lowCpuMs += elapsed;
+    int backlight = state == POWER_SLEEP ? 0 : max(currentScreenBrightness, 0);
+    int savedMa = (lowCpu ? POWER_CPU_FULL_MA - POWER_CPU_IDLE_MA : 0) +
+                  POWER_BACKLIGHT_MA * (bruceConfig.bright - backlight) / 100;
+    if (savedMa > 0) stats.savedMaMs += (uint64_t)savedMa * elapsed;
+    state = next;
+}
+
+// One step of the running fade. Goes through _setBrightness() directly, setBrightness() waits 10ms.
+static void fadeStep(uint32_t now) {
+    if (!fade.active) return;
+    uint32_t elapsed = now - fade.start;
+    int level = elapsed >= POWER_FADE_MS ? 0 : fade.from - fade.from * (int)elapsed / POWER_FADE_MS;
+    if (level != currentScreenBrightness) {
+        _setBrightness(level);
+        currentScreenBrightness = level;
     }
-    turnOffDisplay();
+    if (level > 0) return;
+    fade.active = false;
+    if (fade.sleepPanel && isSleeping) panelSleep(true); //  power down screen
 }
 
+void fadeOutScreen(int startValue) {
+    fade.from = max(startValue, 0);
+    fade.start = millis();
+    fade.sleepPanel = isSleeping;
+    fade.active = true;
+}
+
+void cancelScreenFade() { fade.active = false; }
+
 void checkPowerSaveTime() {
+    uint32_t now = millis();
+    fadeStep(now);
+    governorStep(now);
+
     if (bruceConfig.dimmerSet == 0) return;
 
-    unsigned long elapsed = millis() - previousMillis;
+    unsigned long elapsed = now - previousMillis;
     int startDimmerBright = bruceConfig.bright / 3;
     int dimmerSetMs = bruceConfig.dimmerSet * 1000;
 
@@ -30,14 +127,11 @@ void checkPowerSaveTime() {
 }
 
 void sleepModeOn() {
-    isSleeping = true;
-    setCpuFrequencyMhz(80);
+    isSleeping = true; // the governor drops the CPU to POWER_IDLE_MHZ on its next pass
 
     int startDimmerBright = bruceConfig.bright / 3;
 
-    fadeOutScreen(startDimmerBright);
-
-    panelSleep(true); //  power down screen
+    fadeOutScreen(startDimmerBright); // the panel is powered down when the fade ends
 
     disableCore0WDT();
 #if SOC_CPU_CORES_NUM > 1
@@ -48,7 +142,9 @@ void sleepModeOn() {
 }
 
 void sleepModeOff() {
+    cancelScreenFade();
     isSleeping = false;
+    powerActivity(POWER_SOURCE_INPUT);
     setCpuFrequencyMhz(CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ);
 
     panelSleep(false); // wake the screen back up
@@ -62,3 +158,41 @@ void sleepModeOff() {
     feedLoopWDT();
     delay(200);
 }
+
+static String formatDuration(uint32_t ms) {
+    uint32_t sec = ms / 1000;
+    char buffer[16];
+    snprintf(buffer, sizeof(buffer), "%02lu:%02lu:%02lu", sec / 3600, (sec / 60) % 60, sec % 60);
+    return buffer;
+}
+
+/*********************************************************************
+**  Function: showPowerStats
+**  Time spent in each power state and the estimated current saved
+**********************************************************************/
+void showPowerStats() {
+    ScrollableTextArea area = ScrollableTextArea("POWER");
+
+    uint32_t total = 0;
+    for (uint8_t i = 0; i < POWER_STATES; i++) total += stats.stateMs[i];
+    for (uint8_t i = 0; i < POWER_STATES; i++) {
+        uint32_t percent = total ? (uint64_t)stats.stateMs[i] * 100 / total : 0;
+        String time = formatDuration(stats.stateMs[i]);
+        area.addLine(String(powerStateNames[i]) + ": " + time + " (" + String(percent) + "%)");
+    }
+    area.addLine("");
+    area.addLine("CPU now: " + String(getCpuFrequencyMhz()) + " MHz");
+    area.addLine("CPU at " + String(POWER_IDLE_MHZ) + " MHz: " + formatDuration(stats.lowCpuMs));
+    area.addLine("Avg saved: " + String(total ? (float)stats.savedMaMs / total : 0, 1) + " mA");
+    area.addLine("Est. saved: " + String(stats.savedMaMs / 3600000.0, 2) + " mAh");
+    area.addLine("(estimate, not a measurement)");
+    area.addLine("");
+    uint32_t now = millis();
+    for (uint8_t i = 0; i < POWER_SOURCES; i++) {
+        if (lastActivity[i] == 0) continue;
+        String ago = formatDuration(now - lastActivity[i]);
+        area.addLine("Last " + String(powerSourceNames[i]) + ": " + ago + " ago");
+    }
+
+    area.show();
+}
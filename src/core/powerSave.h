@@ -1,10 +1,69 @@
+#ifndef __POWER_SAVE_H__
+#define __POWER_SAVE_H__
+
 #include "display.h"
 #include <globals.h>
 
+// Power governor, run from the input task by checkPowerSaveTime().
+// The CPU drops to POWER_IDLE_MHZ once nothing has happened for POWER_IDLE_MS: no input, no radio
+// (WiFi or Bluetooth on, or powerActivity(POWER_SOURCE_RADIO)), no script running, no job holding it.
+// Any activity brings it back to full speed on the next pass. Screen fades run a step per pass instead
+// of blocking.
+//
+// Jobs that run unattended for longer than POWER_IDLE_MS (jammers, sweeps, scans) and don't keep a WiFi
+// or Bluetooth radio on take powerHold() while they run, or call powerActivity(POWER_SOURCE_JOB) from
+// their loop when they can end without passing through a single exit.
+#define POWER_IDLE_MS 5000
+#define POWER_IDLE_MHZ 80
+#define POWER_FADE_MS 500
+
+// Rough currents for the saved energy estimate (ESP32 datasheet, modem sleep, and a typical backlight)
+#define POWER_CPU_FULL_MA 50
+#define POWER_CPU_IDLE_MA 22
+#define POWER_BACKLIGHT_MA 30 // at 100% brightness
+
+enum PowerState : uint8_t {
+    POWER_ACTIVE,     // full speed
+    POWER_IDLE,       // screen on, CPU scaled down
+    POWER_DIMMED,     // dimmer
+    POWER_SCREEN_OFF, // backlight off
+    POWER_SLEEP,      // sleep mode, panel asleep
+    POWER_STATES
+};
+
+enum PowerSource : uint8_t {
+    POWER_SOURCE_INPUT,
+    POWER_SOURCE_RADIO,
+    POWER_SOURCE_SCRIPT,
+    POWER_SOURCE_JOB,
+    POWER_SOURCES
+};
+
+struct PowerStats {
+    uint32_t stateMs[POWER_STATES];
+    uint32_t lowCpuMs;  // time spent at POWER_IDLE_MHZ
+    uint64_t savedMaMs; // estimated, against full speed and the configured brightness
+};
+
 void checkPowerSaveTime();
 
+// Keeps the CPU at full speed for another POWER_IDLE_MS
+void powerActivity(PowerSource source);
+
+// Keeps the CPU at full speed until the matching powerRelease(). Holds nest and may come from any task.
+void powerHold();
+void powerRelease();
+
+PowerState powerState();
+const PowerStats &powerStats();
+void showPowerStats();
+
 void sleepModeOn();
 
 void sleepModeOff();
 
+// Starts fading the backlight from startValue to off, returns right away
 void fadeOutScreen(int startValue);
+void cancelScreenFade();
+
+#endif
@@ -0,0 +1,319 @@
+#include "profiler.h"
+#include <ArduinoJson.h>
+#include <esp_heap_caps.h>
+#include <freertos/timers.h>
+#include <vector>
+
+#ifdef configRUN_TIME_COUNTER_TYPE
+typedef configRUN_TIME_COUNTER_TYPE RunTimeCounter;
+#else
+typedef uint32_t RunTimeCounter;
+#endif
+
+struct StackSize {
+    char name[PROFILER_NAME_LEN];
+    uint32_t size;
+};
+
+struct OpenScope {
+    uint8_t slot;
+    uint32_t freeBefore;
+};
+
+static SemaphoreHandle_t lock = NULL; // everything below, the sampler never waits for it
+static TimerHandle_t timer = NULL;
+
+static StackSize stackSizes[PROFILER_MAX_TASKS];
+static uint8_t stackSizeCount = 0;
+
+static ProfilerTask tasks[PROFILER_MAX_TASKS];
+static uint8_t taskCount = 0;
+
+static ProfilerHeap history[PROFILER_HISTORY];
+static uint8_t historyFirst = 0;
+static uint8_t historyCount = 0;
+
+static ProfilerTag tags[PROFILER_MAX_TAGS];
+static uint8_t tagCount = 0;
+static OpenScope scopes[PROFILER_SCOPE_DEPTH];
+static uint8_t scopeDepth = 0;
+static volatile bool tagging = false;
+
+#if configUSE_TRACE_FACILITY
+// Sampler only
+static TaskStatus_t status[PROFILER_MAX_TASKS];
+static struct {
+    TaskHandle_t handle;
+    RunTimeCounter counter;
+} lastRunTime[PROFILER_MAX_TASKS];
+static uint8_t lastRunTimeCount = 0;
+static RunTimeCounter lastTotal = 0;
+#endif
+
+static uint32_t stackSizeOf(const char *name) {
+    for (uint8_t i = 0; i < stackSizeCount; i++) {
+        if (strcmp(stackSizes[i].name, name) == 0) return stackSizes[i].size;
+    }
+    return 0;
+}
+
+static uint8_t fragmentation(uint32_t free, uint32_t largest) {
+    return free ? 100 - (uint64_t)largest * 100 / free : 0;
+}
+
+static ProfilerHeap readHeap() {
+    ProfilerHeap heap;
+    heap.time = millis();
+    heap.freeInternal = heap_caps_get_free_size(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    heap.largestInternal = heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    heap.minInternal = heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    heap.freePsram = heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
+    heap.largestPsram = heap_caps_get_largest_free_block(MALLOC_CAP_SPIRAM);
+    heap.fragInternal = fragmentation(heap.freeInternal, heap.largestInternal);
+    heap.fragPsram = fragmentation(heap.freePsram, heap.largestPsram);
+    return heap;
+}
+
+static uint32_t freeHeap() { return heap_caps_get_free_size(MALLOC_CAP_8BIT); }
+
+// Fills tasks[] from the system state. Called with the lock held.
+static void sampleTasks() {
+#if configUSE_TRACE_FACILITY
+    RunTimeCounter total = 0;
+    UBaseType_t count = uxTaskGetSystemState(status, PROFILER_MAX_TASKS, &total);
+    if (count == 0) return; // more tasks than PROFILER_MAX_TASKS
+    RunTimeCounter elapsed = (total - lastTotal) * portNUM_PROCESSORS;
+
+    taskCount = 0;
+    for (UBaseType_t i = 0; i < count; i++) {
+        const TaskStatus_t &s = status[i];
+        ProfilerTask &t = tasks[taskCount++];
+        strncpy(t.name, s.pcTaskName, PROFILER_NAME_LEN - 1);
+        t.name[PROFILER_NAME_LEN - 1] = '\0';
+        t.stackSize = stackSizeOf(t.name);
+        t.stackFree = s.usStackHighWaterMark; // bytes on ESP-IDF
+        t.priority = s.uxCurrentPriority;
+#if configTASKLIST_INCLUDE_COREID
+        t.core = s.xCoreID == tskNO_AFFINITY ? -1 : s.xCoreID;
+#else
+        t.core = -1;
+#endif
+        t.cpu = 0xFFFF;
+#if configGENERATE_RUN_TIME_STATS
+        if (lastTotal != 0 && elapsed > 0) {
+            for (uint8_t j = 0; j < lastRunTimeCount; j++) {
+                if (lastRunTime[j].handle != s.xHandle) continue;
+                t.cpu = (uint64_t)(s.ulRunTimeCounter - lastRunTime[j].counter) * 1000 / elapsed;
+                break;
+            }
+            if (t.cpu == 0xFFFF) t.cpu = (uint64_t)s.ulRunTimeCounter * 1000 / elapsed; // new task
+        }
+#endif
+    }
+#if configGENERATE_RUN_TIME_STATS
+    for (UBaseType_t i = 0; i < count; i++) {
+        lastRunTime[i].handle = status[i].xHandle;
+        lastRunTime[i].counter = status[i].ulRunTimeCounter;
+    }
+    lastRunTimeCount = count;
+    lastTotal = total;
+#else
+    (void)elapsed;
+#endif
+#else
+    // No system state: only the tasks we know the name of
+    taskCount = 0;
+    for (uint8_t i = 0; i < stackSizeCount; i++) {
+        TaskHandle_t handle = xTaskGetHandle(stackSizes[i].name);
+        if (!handle) continue;
+        ProfilerTask &t = tasks[taskCount++];
+        memcpy(t.name, stackSizes[i].name, PROFILER_NAME_LEN);
+        t.stackSize = stackSizes[i].size;
+        t.stackFree = uxTaskGetStackHighWaterMark(handle);
+        t.priority = uxTaskPriorityGet(handle);
+        t.core = -1;
+        t.cpu = 0xFFFF;
+    }
+#endif
+}
+
+static void sample(TimerHandle_t) {
+    ProfilerHeap heap = readHeap();
+    uint32_t free = freeHeap();
+    if (xSemaphoreTake(lock, 0) != pdTRUE) return; // a reader is copying, skip this one
+
+    sampleTasks();
+
+    uint8_t i = (historyFirst + historyCount) % PROFILER_HISTORY;
+    history[i] = heap;
+    if (historyCount < PROFILER_HISTORY) historyCount++;
+    else historyFirst = (historyFirst + 1) % PROFILER_HISTORY;
+
+    for (uint8_t d = 0; d < scopeDepth; d++) {
+        int64_t used = (int64_t)scopes[d].freeBefore - free;
+        ProfilerTag &tag = tags[scopes[d].slot];
+        if (used > (int64_t)tag.peak) tag.peak = used;
+    }
+    xSemaphoreGive(lock);
+}
+
+void profilerBegin() {
+    if (timer) return;
+    lock = xSemaphoreCreateMutex();
+    timer = xTimerCreate("Profiler", pdMS_TO_TICKS(PROFILER_PERIOD_MS), pdTRUE, NULL, sample);
+    if (timer) xTimerStart(timer, 0);
+}
+
+void profilerTaskStack(const char *name, uint32_t stackSize) {
+    if (lock) xSemaphoreTake(lock, portMAX_DELAY);
+    uint8_t i = 0;
+    while (i < stackSizeCount && strncmp(stackSizes[i].name, name, PROFILER_NAME_LEN - 1) != 0) i++;
+    if (i < PROFILER_MAX_TASKS) {
+        strncpy(stackSizes[i].name, name, PROFILER_NAME_LEN - 1);
+        stackSizes[i].name[PROFILER_NAME_LEN - 1] = '\0';
+        stackSizes[i].size = stackSize;
+        if (i == stackSizeCount) stackSizeCount++;
+    }
+    if (lock) xSemaphoreGive(lock);
+}
+
+uint8_t profilerTasks(ProfilerTask *out, uint8_t max) {
+    if (!lock) return 0;
+    xSemaphoreTake(lock, portMAX_DELAY);
+    uint8_t n = min(taskCount, max);
+    memcpy(out, tasks, n * sizeof(ProfilerTask));
+    xSemaphoreGive(lock);
+    return n;
+}
+
+uint8_t profilerHeapHistory(ProfilerHeap *out, uint8_t max) {
+    if (!lock) return 0;
+    xSemaphoreTake(lock, portMAX_DELAY);
+    uint8_t n = min(historyCount, max);
+    uint8_t skip = historyCount - n; // the newest ones are kept
+    for (uint8_t i = 0; i < n; i++) out[i] = history[(historyFirst + skip + i) % PROFILER_HISTORY];
+    xSemaphoreGive(lock);
+    return n;
+}
+
+uint8_t profilerTags(ProfilerTag *out, uint8_t max) {
+    if (!lock) return 0;
+    xSemaphoreTake(lock, portMAX_DELAY);
+    uint8_t n = min(tagCount, max);
+    memcpy(out, tags, n * sizeof(ProfilerTag));
+    xSemaphoreGive(lock);
+    return n;
+}
+
+void profilerTagging(bool enable) { tagging = enable; }
+
+bool profilerTaggingOn() { return tagging; }
+
+void profilerResetTags() {
+    if (!lock) return;
+    xSemaphoreTake(lock, portMAX_DELAY);
+    // names stay, open scopes still point at them
+    for (uint8_t i = 0; i < tagCount; i++) {
+        tags[i].calls = 0;
+        tags[i].retained = 0;
+        tags[i].peak = 0;
+    }
+    xSemaphoreGive(lock);
+}
+
+/*********************************************************************
+**  Allocation tagging
+**********************************************************************/
+ProfilerHeapScope::ProfilerHeapScope(const char *tag) {
+    if (!tagging || !lock) return;
+    xSemaphoreTake(lock, portMAX_DELAY);
+    uint8_t slot = 0;
+    while (slot < tagCount && strncmp(tags[slot].name, tag, PROFILER_NAME_LEN - 1) != 0) slot++;
+    if (slot == tagCount && tagCount < PROFILER_MAX_TAGS) {
+        memset(&tags[slot], 0, sizeof(ProfilerTag));
+        strncpy(tags[slot].name, tag, PROFILER_NAME_LEN - 1);
+        tagCount++;
+    }
+    if (slot < tagCount && scopeDepth < PROFILER_SCOPE_DEPTH) {
+        scopes[scopeDepth++] = {slot, freeHeap()};
+        tags[slot].calls++;
+        open = true;
+    }
+    xSemaphoreGive(lock);
+}
+
+ProfilerHeapScope::~ProfilerHeapScope() {
+    if (!open) return;
+    uint32_t free = freeHeap();
+    xSemaphoreTake(lock, portMAX_DELAY);
+    OpenScope &scope = scopes[--scopeDepth];
+    ProfilerTag &tag = tags[scope.slot];
+    tag.retained = (int32_t)(scope.freeBefore - free);
+    if (tag.retained > 0 && (uint32_t)tag.retained > tag.peak) tag.peak = tag.retained;
+    xSemaphoreGive(lock);
+}
+
+/*********************************************************************
+**  JSON
+**********************************************************************/
+String profilerJson() {
+    // on the heap, the async_tcp task has little stack
+    std::vector<ProfilerTask> t(PROFILER_MAX_TASKS);
+    std::vector<ProfilerHeap> h(PROFILER_HISTORY);
+    std::vector<ProfilerTag> g(PROFILER_MAX_TAGS);
+    uint8_t taskN = profilerTasks(t.data(), PROFILER_MAX_TASKS);
+    uint8_t heapN = profilerHeapHistory(h.data(), PROFILER_HISTORY);
+    uint8_t tagN = profilerTags(g.data(), PROFILER_MAX_TAGS);
+
+    JsonDocument doc;
+    doc["uptime"] = millis();
+    doc["cpuMhz"] = getCpuFrequencyMhz();
+    doc["periodMs"] = PROFILER_PERIOD_MS;
+
+    JsonArray taskList = doc["tasks"].to<JsonArray>();
+    for (uint8_t i = 0; i < taskN; i++) {
+        JsonObject task = taskList.add<JsonObject>();
+        task["name"] = t[i].name;
+        if (t[i].cpu != 0xFFFF) task["cpu"] = t[i].cpu / 10.0;
+        task["stackFree"] = t[i].stackFree;
+        if (t[i].stackSize) task["stackSize"] = t[i].stackSize;
+        task["priority"] = t[i].priority;
+        task["core"] = t[i].core;
+    }
+
+    JsonObject heap = doc["heap"].to<JsonObject>();
+    if (heapN > 0) {
+        const ProfilerHeap &last = h[heapN - 1];
+        heap["free"] = last.freeInternal;
+        heap["largest"] = last.largestInternal;
+        heap["min"] = last.minInternal;
+        heap["frag"] = last.fragInternal;
+        heap["psramFree"] = last.freePsram;
+        heap["psramLargest"] = last.largestPsram;
+        heap["psramFrag"] = last.fragPsram;
+    }
+    heap["total"] = heap_caps_get_total_size(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    heap["psramTotal"] = heap_caps_get_total_size(MALLOC_CAP_SPIRAM);
+    // history as plain arrays, oldest first
+    JsonArray freeHistory = heap["history"].to<JsonArray>();
+    JsonArray fragHistory = heap["fragHistory"].to<JsonArray>();
+    for (uint8_t i = 0; i < heapN; i++) {
+        freeHistory.add(h[i].freeInternal);
+        fragHistory.add(h[i].fragInternal);
+    }
+
+    JsonObject tagInfo = doc["tagging"].to<JsonObject>();
+    tagInfo["enabled"] = profilerTaggingOn();
+    JsonArray tagList = tagInfo["tags"].to<JsonArray>();
+    for (uint8_t i = 0; i < tagN; i++) {
+        JsonObject tag = tagList.add<JsonObject>();
+        tag["name"] = g[i].name;
+        tag["calls"] = g[i].calls;
+        tag["retained"] = g[i].retained;
+        tag["peak"] = g[i].peak;
+    }
+
+    String out;
+    serializeJson(doc, out);
+    return out;
+}
@@ -0,0 +1,76 @@
+#ifndef __PROFILER_H__
+#define __PROFILER_H__
+
+// Runtime profiler, sampled once per PROFILER_PERIOD_MS by a FreeRTOS timer:
+//  - per task: CPU share since the previous sample, stack high-water mark (and the stack size for the
+//    tasks that told it with profilerTaskStack()), priority and core
+//  - heap: free, largest free block, fragmentation and lowest free ever, internal RAM and PSRAM,
+//    with PROFILER_HISTORY samples kept
+//  - optional allocation tagging: ProfilerHeapScope attributes the heap used across a scope to a
+//    module. It works on free heap deltas, allocations from other tasks in the meantime count too.
+// Reported by the "profiler" serial command and /profiler on the WebUI.
+
+#include <Arduino.h>
+
+#define PROFILER_PERIOD_MS 1000
+#define PROFILER_MAX_TASKS 40
+#define PROFILER_HISTORY 60 // heap samples, one per period
+#define PROFILER_MAX_TAGS 16
+#define PROFILER_NAME_LEN 16
+#define PROFILER_SCOPE_DEPTH 4 // nested ProfilerHeapScope
+
+struct ProfilerTask {
+    char name[PROFILER_NAME_LEN];
+    uint32_t stackSize; // bytes, 0 when not known
+    uint32_t stackFree; // lowest free stack ever, bytes
+    uint16_t cpu;       // per mille of all cores over the last period, 0xFFFF without run time stats
+    uint8_t priority;
+    int8_t core; // -1: not pinned
+};
+
+struct ProfilerHeap {
+    uint32_t time; // millis()
+    uint32_t freeInternal;
+    uint32_t largestInternal;
+    uint32_t minInternal;
+    uint32_t freePsram;
+    uint32_t largestPsram;
+    uint8_t fragInternal; // % of the free heap not in the largest block
+    uint8_t fragPsram;
+};
+
+struct ProfilerTag {
+    char name[PROFILER_NAME_LEN];
+    uint32_t calls;
+    int32_t retained; // bytes still in use after the last scope ended
+    uint32_t peak;    // most bytes in use while a scope was open
+};
+
+// Starts the sampling timer
+void profilerBegin();
+
+// Stack size of a task, for the used/size readout. Call next to xTaskCreate.
+void profilerTaskStack(const char *name, uint32_t stackSize);
+
+// Copies of the last sample, return the number of entries written
+uint8_t profilerTasks(ProfilerTask *out, uint8_t max);
+uint8_t profilerHeapHistory(ProfilerHeap *out, uint8_t max); // oldest first
+uint8_t profilerTags(ProfilerTag *out, uint8_t max);
+
+void profilerTagging(bool enable);
+bool profilerTaggingOn();
+void profilerResetTags();
+
+// Whole state as JSON, for /profiler
+String profilerJson();
+
+class ProfilerHeapScope {
+public:
+    ProfilerHeapScope(const char *tag);
+    ~ProfilerHeapScope();
+
+private:
+    bool open = false;
+};
+
+#endif
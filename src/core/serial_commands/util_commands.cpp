@@ -1,5 +1,7 @@
 #include "util_commands.h"
 #include "core/main_menu.h"
+#include "core/boot_timeline.h"
+#include "core/profiler.h"
 #include "core/sd_functions.h"
 #include "core/utils.h" // to return optionsJSON
 #include "core/wifi/webInterface.h"
@@ -103,6 +105,93 @@ uint32_t freeCallback(cmd *c) {
     return true;
 }
 
+uint32_t profilerCallback(cmd *c) {
+    Command cmd(c);
+    String view = cmd.getArgument("view").getValue();
+    String value = cmd.getArgument("value").getValue();
+    view.toLowerCase();
+    value.toLowerCase();
+
+    if (view == "tasks") {
+        std::vector<ProfilerTask> tasks(PROFILER_MAX_TASKS);
+        uint8_t n = profilerTasks(tasks.data(), tasks.size());
+        serialDevice->println("Task              CPU%  Stack free/size  Prio Core");
+        for (uint8_t i = 0; i < n; i++) {
+            const ProfilerTask &t = tasks[i];
+            String cpu = t.cpu == 0xFFFF ? "  n/a" : String(t.cpu / 10.0, 1);
+            String size = t.stackSize ? String(t.stackSize) : "?";
+            serialDevice->printf(
+                "%-16s %5s  %6lu/%-8s  %4u %4d\n",
+                t.name,
+                cpu.c_str(),
+                t.stackFree,
+                size.c_str(),
+                t.priority,
+                t.core
+            );
+        }
+    } else if (view == "heap") {
+        std::vector<ProfilerHeap> history(PROFILER_HISTORY);
+        uint8_t n = profilerHeapHistory(history.data(), history.size());
+        if (n == 0) {
+            serialDevice->println("No sample yet");
+            return false;
+        }
+        const ProfilerHeap &last = history[n - 1];
+        uint32_t lowest = last.freeInternal, highest = last.freeInternal;
+        for (uint8_t i = 0; i < n; i++) {
+            lowest = min(lowest, history[i].freeInternal);
+            highest = max(highest, history[i].freeInternal);
+        }
+        serialDevice->printf(
+            "Internal: %lu free, %lu largest block, %u%% fragmented, %lu lowest ever\n",
+            last.freeInternal,
+            last.largestInternal,
+            last.fragInternal,
+            last.minInternal
+        );
+        serialDevice->printf("Last %us: %lu to %lu free\n", n * PROFILER_PERIOD_MS / 1000, lowest, highest);
+        if (psramFound()) {
+            serialDevice->printf(
+                "PSRAM: %lu free, %lu largest block, %u%% fragmented\n",
+                last.freePsram,
+                last.largestPsram,
+                last.fragPsram
+            );
+        }
+    } else if (view == "tags") {
+        if (value == "on" || value == "off") {
+            profilerTagging(value == "on");
+        } else if (value == "reset") {
+            profilerResetTags();
+        }
+        std::vector<ProfilerTag> tags(PROFILER_MAX_TAGS);
+        uint8_t n = profilerTags(tags.data(), tags.size());
+        serialDevice->printf("Allocation tagging: %s\n", profilerTaggingOn() ? "on" : "off");
+        serialDevice->println("Module           Calls  Retained      Peak");
+        for (uint8_t i = 0; i < n; i++) {
+            serialDevice->printf(
+                "%-16s %5lu  %8ld  %8lu\n", tags[i].name, tags[i].calls, tags[i].retained, tags[i].peak
+            );
+        }
+    } else if (view == "boot") {
+        serialDevice->print(bootTimelineReport());
+    } else if (view == "json") {
+        serialDevice->println(profilerJson());
+    } else {
+        serialDevice->println(
+            "Profiler command accept:\n"
+            "profiler tasks : CPU share and stack high-water marks\n"
+            "profiler heap : heap and PSRAM usage, fragmentation\n"
+            "profiler tags [on|off|reset] : heap used per module\n"
+            "profiler boot : time taken by each init phase at boot\n"
+            "profiler json : everything, as on /profiler\n"
+        );
+        return false;
+    }
+    return true;
+}
+
 uint32_t infoCallback(cmd *c) {
     serialDevice->print("Bruce v");
     serialDevice->println(BRUCE_VERSION);
@@ -261,10 +350,27 @@ uint32_t navCallback(cmd *c) {
     } else if (nav == "prevpage") {
         Serial.println("Prev Page Pressed");
         var = &PrevPagePress;
+    } else if (nav == "stats") {
+        // input event queue counters since the last "nav stats"
+        const InputStats &stats = inputStats();
+        serialDevice->printf(
+            "Input events: %lu, consumed: %lu, expired: %lu, dropped: %lu\n",
+            stats.events,
+            stats.consumed,
+            stats.expired,
+            stats.dropped
+        );
+        serialDevice->printf(
+            "Latency avg: %lu us, max: %lu us\n",
+            stats.consumed ? (uint32_t)(stats.latencySum / stats.consumed) : 0,
+            stats.latencyMax
+        );
+        inputResetStats();
+        return true;
     } else {
         serialDevice->println(
             "Unknown command, use: \n\"nav Next\" or \n\"nav Prev\" or \n\"nav Esc\" or \n\"nav Select\" or "
-            "\n\"nav Up\" or \n\"nav Down\" or \n\"nav NextPage\" or \n\"nav PrevPage\""
+            "\n\"nav Up\" or \n\"nav Down\" or \n\"nav NextPage\" or \n\"nav PrevPage\" or \n\"nav Stats\""
         );
         return false;
     }
@@ -416,6 +522,9 @@ void createUtilCommands(SimpleCLI *cli) {
     cli->addCommand("date", dateCallback);
     cli->addCommand("i2c", i2cCallback);
     cli->addCommand("free", freeCallback);
+    Command profiler = cli->addCommand("profiler,top", profilerCallback);
+    profiler.addPosArg("view", "tasks");
+    profiler.addPosArg("value", "none"); // optional
     cli->addCommand("info,!,device_info", infoCallback);
     cli->addCommand("help,?,halp", helpCallback);
     cli->addCommand("optionsJSON", optionsJsonCallback);
@@ -2,6 +2,7 @@
 #include "freertos/queue.h"
 #include "freertos/semphr.h"
 #include "freertos/task.h"
+#include "profiler.h"
 #include "utils.h"
 #include <globals.h>
 
@@ -64,6 +65,7 @@ void _serialCmdsTaskLoop(void *pvParameters) {
 void startSerialCommandsHandlerTask() {
     cmdQueue = xQueueCreate(2, sizeof(CmdPacket));
     rspQueue = xQueueCreate(2, sizeof(bool));
+    profilerTaskStack("serialcmds", SERIAL_CMDS_TASK_STACK_SIZE);
 
     xTaskCreatePinnedToCore(
         _serialCmdsTaskLoop,         // Function to implement the task
@@ -1,3 +1,4 @@
+#include "core/profiler.h"
 #include <globals.h>
 #include <tftLogger.h>
 
@@ -44,23 +45,9 @@ void tft_logger::asyncSerialTaskFunc(void *pv) {
     tftLog item;
     while (logger->async_serial || uxQueueMessagesWaiting(logger->asyncSerialQueue) > 0) {
         if (xQueueReceive(logger->asyncSerialQueue, &item, pdMS_TO_TICKS(100))) {
-            uint8_t *entry = item.data;
-            uint8_t fn = entry[2];
-            if (fn == DRAWIMAGE) {
-                uint8_t imageSlot = entry[12];
-                const char *imgPath = logger->images[imageSlot];
-                size_t baseLen = 12; // AA SS FN XX XX YY YY Ce Ce Ms Ms FS
-                size_t imgLen = strlen(imgPath);
-                uint8_t packet[MAX_LOG_SIZE];
-                memcpy(packet, entry, baseLen);
-                if (imgLen > MAX_LOG_SIZE - baseLen) imgLen = MAX_LOG_SIZE - baseLen;
-                memcpy(packet + baseLen, imgPath, imgLen);
-                packet[1] = baseLen + imgLen;
-                serialDevice->write(packet, baseLen + imgLen);
-            } else {
-                uint8_t size = entry[1];
-                serialDevice->write(entry, size);
-            }
+            uint8_t packet[MAX_LOG_SIZE];
+            uint8_t size = logger->getLogPacket(item, packet);
+            serialDevice->write(packet, size);
         }
     }
     logger->asyncSerialTask = NULL;
@@ -77,6 +64,7 @@ void tft_logger::startAsyncSerial() {
     setLogging(true);
     asyncSerialQueue = xQueueCreate(MAX_LOG_ENTRIES, sizeof(tftLog));
     getTftInfo();
+    profilerTaskStack("async_serial", 4096);
     xTaskCreate(asyncSerialTaskFunc, "async_serial", 4096, this, 1, &asyncSerialTask);
 }
 
@@ -98,6 +86,36 @@ void tft_logger::getTftInfo() {
     memcpy(l.data, buffer, pos);
     pushLogIfUnique(l);
 }
+uint8_t tft_logger::getLogPacket(const tftLog &entry, uint8_t *outBuffer) {
+    const uint8_t *data = entry.data;
+    if (data[2] != DRAWIMAGE) {
+        memcpy(outBuffer, data, data[1]);
+        return data[1];
+    }
+    uint8_t imageSlot = data[12];
+    const char *imgPath = images[imageSlot];
+    size_t baseLen = 12; // AA SS FN XX XX YY YY Ce Ce Ms Ms FS
+    size_t imgLen = strlen(imgPath);
+    if (imgLen > MAX_LOG_SIZE - baseLen) imgLen = MAX_LOG_SIZE - baseLen;
+    memcpy(outBuffer, data, baseLen);
+    memcpy(outBuffer + baseLen, imgPath, imgLen);
+    outBuffer[1] = baseLen + imgLen;
+    return baseLen + imgLen;
+}
+
+void tft_logger::setStreamQueue(QueueHandle_t queue) {
+    streamQueue = queue;
+    // A sender that counted itself before the swap may still hold the old handle
+    while (streamSenders > 0) vTaskDelay(1);
+    streamOverflow = false;
+}
+
+bool tft_logger::takeStreamOverflow() {
+    if (!streamOverflow) return false;
+    streamOverflow = false;
+    return true;
+}
+
 void tft_logger::getBinLog(uint8_t *outBuffer, size_t &outSize) {
     outSize = 0;
     // add Screen Info at the beginning of the Bin packet
@@ -161,6 +179,11 @@ void tft_logger::pushLogIfUnique(const tftLog &l) {
     logWriteIndex = (logWriteIndex + 1) % MAX_LOG_ENTRIES;
     if (logCount < MAX_LOG_ENTRIES) ++logCount;
     if (async_serial && asyncSerialQueue) { xQueueSend(asyncSerialQueue, &l, 0); }
+    // Counted before the handle is read, setStreamQueue() waits for the count to drop
+    streamSenders++;
+    QueueHandle_t queue = streamQueue;
+    if (queue && xQueueSend(queue, &l, 0) != pdTRUE) streamOverflow = true;
+    streamSenders--;
 }
 
 bool tft_logger::removeLogEntriesInsideRect(int rx, int ry, int rw, int rh) {
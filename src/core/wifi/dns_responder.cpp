@@ -0,0 +1,278 @@
+#include "dns_responder.h"
+#include <ctype.h>
+#include <string.h>
+
+#if defined(ESP_PLATFORM)
+#include "esp_timer.h"
+#include "lwip/sockets.h"
+#include "soc/soc_caps.h"
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+#define DNS_HEADER_LEN 12
+#define DNS_TYPE_A 1
+#define DNS_TYPE_ANY 255
+#define DNS_CLASS_IN 1
+#define DNS_RCODE_NXDOMAIN 3
+#define DNS_RCODE_NOTIMP 4
+
+static uint32_t monotonicUs() {
+#if defined(ESP_PLATFORM)
+    return (uint32_t)esp_timer_get_time();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)(ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000);
+#endif
+}
+
+DnsResponder::DnsResponder() {}
+
+DnsResponder::~DnsResponder() { end(); }
+
+/*********************************************************************
+**  Records
+**********************************************************************/
+bool DnsResponder::addRecord(const char *pattern, const uint8_t ip[4], uint32_t ttl) {
+    if (!pattern || !ip || _count >= DNS_RESPONDER_MAX_RECORDS) return false;
+    size_t len = strlen(pattern);
+    if (len == 0 || len >= sizeof(_records[0].pattern)) return false;
+
+    Record &r = _records[_count];
+    for (size_t i = 0; i < len; i++) r.pattern[i] = (char)tolower((unsigned char)pattern[i]);
+    r.pattern[len] = '\0';
+    if (len > 1 && r.pattern[len - 1] == '.') r.pattern[--len] = '\0'; // accept fully qualified names
+    r.len = (uint8_t)len;
+    r.wildcard = r.pattern[0] == '*' && (len == 1 || r.pattern[1] == '.');
+
+    const uint8_t rr[16] = {
+        0xC0, 0x0C, // pointer to the question name
+        0x00, DNS_TYPE_A,
+        0x00, DNS_CLASS_IN,
+        (uint8_t)(ttl >> 24), (uint8_t)(ttl >> 16), (uint8_t)(ttl >> 8), (uint8_t)ttl,
+        0x00, 0x04,
+        ip[0], ip[1], ip[2], ip[3],
+    };
+    memcpy(r.rr, rr, sizeof(rr));
+    _count++;
+    return true;
+}
+
+void DnsResponder::clearRecords() { _count = 0; }
+
+const DnsResponder::Record *DnsResponder::match(const char *name, size_t len) const {
+    const Record *best = nullptr;
+    size_t bestScore = 0;
+    for (size_t i = 0; i < _count; i++) {
+        const Record &r = _records[i];
+        size_t score = 0;
+        if (!r.wildcard) {
+            if (r.len == len && memcmp(r.pattern, name, len) == 0) return &r;
+        } else if (r.len == 1) {
+            score = 1;
+        } else {
+            // "*.example" -> suffix ".example" must end a longer name
+            const char *suffix = r.pattern + 1;
+            size_t slen = r.len - 1;
+            if (len > slen && memcmp(name + len - slen, suffix, slen) == 0) score = slen + 1;
+        }
+        if (score > bestScore) {
+            bestScore = score;
+            best = &r;
+        }
+    }
+    return best;
+}
+
+/*********************************************************************
+**  Packet handling
+**********************************************************************/
+size_t DnsResponder::handlePacket(const uint8_t *query, size_t len, uint8_t *reply, size_t replyCap) {
+    if (len < DNS_HEADER_LEN || replyCap < DNS_HEADER_LEN) {
+        _stats.malformed++;
+        return 0;
+    }
+    if (query[2] & 0x80) return 0; // a response, not a query
+
+    // Header template: ID copied, QR + AA, RD echoed
+    memset(reply, 0, DNS_HEADER_LEN);
+    reply[0] = query[0];
+    reply[1] = query[1];
+    reply[2] = 0x84 | (query[2] & 0x01);
+
+    uint8_t opcode = (query[2] >> 3) & 0x0F;
+    uint16_t qdcount = (query[4] << 8) | query[5];
+    if (opcode != 0) {
+        _stats.queries++;
+        reply[3] = DNS_RCODE_NOTIMP;
+        return DNS_HEADER_LEN;
+    }
+    if (qdcount != 1) {
+        _stats.malformed++;
+        return 0;
+    }
+
+    // Walk the question name, lowercasing it into a dotted string for matching
+    char name[256];
+    size_t nameLen = 0;
+    size_t pos = DNS_HEADER_LEN;
+    while (true) {
+        if (pos >= len) {
+            _stats.malformed++;
+            return 0;
+        }
+        uint8_t label = query[pos++];
+        if (label == 0) break;
+        if (label > 63 || pos + label > len || nameLen + label + 1 >= sizeof(name)) {
+            _stats.malformed++; // compression pointers are not valid in a question
+            return 0;
+        }
+        if (nameLen) name[nameLen++] = '.';
+        for (uint8_t i = 0; i < label; i++) name[nameLen++] = (char)tolower(query[pos + i]);
+        pos += label;
+    }
+    name[nameLen] = '\0';
+    if (pos + 4 > len) {
+        _stats.malformed++;
+        return 0;
+    }
+    uint16_t qtype = (query[pos] << 8) | query[pos + 1];
+    uint16_t qclass = (query[pos + 2] << 8) | query[pos + 3];
+    size_t questionEnd = pos + 4;
+    if (questionEnd + 16 > replyCap) {
+        _stats.malformed++;
+        return 0;
+    }
+
+    _stats.queries++;
+    reply[5] = 1; // QDCOUNT
+    memcpy(reply + DNS_HEADER_LEN, query + DNS_HEADER_LEN, questionEnd - DNS_HEADER_LEN);
+    size_t out = questionEnd;
+
+    const Record *r = match(name, nameLen);
+    if (!r) {
+        _stats.nxdomain++;
+        reply[3] = DNS_RCODE_NXDOMAIN;
+        return out;
+    }
+    // Known name but not an A query (AAAA, HTTPS...): empty NOERROR so clients fall back to A quickly
+    if ((qtype == DNS_TYPE_A || qtype == DNS_TYPE_ANY) && qclass == DNS_CLASS_IN) {
+        reply[7] = 1; // ANCOUNT
+        memcpy(reply + out, r->rr, sizeof(r->rr));
+        out += sizeof(r->rr);
+        _stats.answered++;
+    }
+    return out;
+}
+
+void DnsResponder::recordLatency(uint32_t us) {
+    _stats.lastUs = us;
+    _stats.totalUs += us;
+    if (_stats.minUs == 0 || us < _stats.minUs) _stats.minUs = us;
+    if (us > _stats.maxUs) _stats.maxUs = us;
+}
+
+void DnsResponder::resetStats() { _stats = DnsResponderStats(); }
+
+/*********************************************************************
+**  Socket
+**********************************************************************/
+bool DnsResponder::begin(uint16_t port) {
+    end();
+    _sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (_sock < 0) return false;
+
+    int yes = 1;
+    setsockopt(_sock, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (bind(_sock, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        close(_sock);
+        _sock = -1;
+        return false;
+    }
+
+#if defined(ESP_PLATFORM)
+    _stop = false;
+#if SOC_CPU_CORES_NUM > 1
+    // core 0 is where lwIP and the WiFi driver live, away from the UI loop
+    BaseType_t res = xTaskCreatePinnedToCore(taskEntry, "dns_responder", 3072, this, 3, &_task, 0);
+#else
+    BaseType_t res = xTaskCreate(taskEntry, "dns_responder", 3072, this, 3, &_task);
+#endif
+    if (res != pdPASS) {
+        _task = nullptr;
+        close(_sock);
+        _sock = -1;
+        return false;
+    }
+#endif
+    return true;
+}
+
+void DnsResponder::end() {
+    _stop = true;
+#if defined(ESP_PLATFORM)
+    for (int i = 0; _task && i < 50; i++) vTaskDelay(pdMS_TO_TICKS(10));
+    if (_task) {
+        vTaskDelete(_task);
+        _task = nullptr;
+    }
+#endif
+    if (_sock >= 0) {
+        close(_sock);
+        _sock = -1;
+    }
+}
+
+int DnsResponder::poll(uint32_t timeoutMs) {
+    if (_sock < 0) return 0;
+
+    fd_set readSet;
+    FD_ZERO(&readSet);
+    FD_SET(_sock, &readSet);
+    struct timeval tv;
+    tv.tv_sec = timeoutMs / 1000;
+    tv.tv_usec = (timeoutMs % 1000) * 1000;
+    if (select(_sock + 1, &readSet, nullptr, nullptr, &tv) <= 0) return 0;
+    // lwIP keeps no arrival time, the packets of this batch were all there by now: the latency below
+    // counts their wait behind the earlier ones
+    uint32_t arrival = monotonicUs();
+
+    // drain what is queued without going back to select() for every packet
+    int handled = 0;
+    while (handled < DNS_RESPONDER_BATCH) {
+        struct sockaddr_in from;
+        socklen_t fromLen = sizeof(from);
+        int n = recvfrom(_sock, _rx, sizeof(_rx), MSG_DONTWAIT, (struct sockaddr *)&from, &fromLen);
+        if (n <= 0) break;
+
+        size_t out = handlePacket(_rx, (size_t)n, _tx, sizeof(_tx));
+        if (out) {
+            sendto(_sock, _tx, out, 0, (struct sockaddr *)&from, fromLen);
+            recordLatency(monotonicUs() - arrival);
+        }
+        handled++;
+    }
+    if (handled) _stats.batches++;
+    return handled;
+}
+
+#if defined(ESP_PLATFORM)
+void DnsResponder::taskEntry(void *param) {
+    DnsResponder *self = static_cast<DnsResponder *>(param);
+    while (!self->_stop) self->poll(100);
+    self->_task = nullptr;
+    vTaskDelete(NULL);
+}
+#endif
@@ -0,0 +1,86 @@
+#ifndef __DNS_RESPONDER_H__
+#define __DNS_RESPONDER_H__
+
+// Small authoritative DNS responder used by the captive portal and the WebUI in AP mode.
+// On the device it runs in its own FreeRTOS task so name resolution does not depend on how busy
+// the UI loop is. Packet handling only uses BSD sockets, so it also builds on Linux where
+// poll() can be driven directly against a local test client.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(ESP_PLATFORM)
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#endif
+
+#define DNS_RESPONDER_MAX_RECORDS 16
+#define DNS_RESPONDER_MAX_PACKET 512
+#define DNS_RESPONDER_BATCH 8
+
+struct DnsResponderStats {
+    uint32_t queries = 0;
+    uint32_t answered = 0; // A answers sent
+    uint32_t nxdomain = 0;
+    uint32_t malformed = 0;
+    uint32_t batches = 0;
+    uint32_t lastUs = 0; // socket readable -> sendto, per packet, queueing in the batch included
+    uint32_t minUs = 0;
+    uint32_t maxUs = 0;
+    uint64_t totalUs = 0;
+
+    uint32_t avgUs() const { return queries ? (uint32_t)(totalUs / queries) : 0; }
+};
+
+class DnsResponder {
+public:
+    DnsResponder();
+    ~DnsResponder();
+
+    // Patterns: "host.example" (exact), "*.example" (any subdomain) or "*" (everything else).
+    // Lookups are case-insensitive; the most specific match wins.
+    bool addRecord(const char *pattern, const uint8_t ip[4], uint32_t ttl = 60);
+    void clearRecords();
+    size_t recordCount() const { return _count; }
+
+    // Opens the UDP socket. On the device a responder task is started as well.
+    bool begin(uint16_t port = 53);
+    void end();
+    bool running() const { return _sock >= 0; }
+
+    // Waits up to timeoutMs for traffic and answers up to DNS_RESPONDER_BATCH queued queries.
+    // Returns the number of packets handled.
+    int poll(uint32_t timeoutMs);
+
+    // Builds the reply for one query. Returns the reply size, or 0 when the packet must be dropped.
+    size_t handlePacket(const uint8_t *query, size_t len, uint8_t *reply, size_t replyCap);
+
+    const DnsResponderStats &stats() const { return _stats; }
+    void resetStats();
+
+private:
+    struct Record {
+        char pattern[64];
+        uint8_t len;
+        bool wildcard;   // pattern started with "*." or is "*"
+        uint8_t rr[16];  // preformatted answer: name pointer, type A, class IN, ttl, rdlength, ip
+    };
+
+    Record _records[DNS_RESPONDER_MAX_RECORDS];
+    size_t _count = 0;
+    int _sock = -1;
+    volatile bool _stop = false;
+    DnsResponderStats _stats;
+    uint8_t _rx[DNS_RESPONDER_MAX_PACKET];
+    uint8_t _tx[DNS_RESPONDER_MAX_PACKET];
+
+    const Record *match(const char *name, size_t len) const;
+    void recordLatency(uint32_t us);
+
+#if defined(ESP_PLATFORM)
+    TaskHandle_t _task = nullptr;
+    static void taskEntry(void *param);
+#endif
+};
+
+#endif
@@ -2,11 +2,14 @@
 #include "core/display.h"    // using displayRedStripe as error msg
 #include "core/mykeyboard.h" // using keyboard when calling rename
 #include "core/passwords.h"
+#include "core/profiler.h"
 #include "core/sd_functions.h" // using sd functions called to rename and manage sd files
 #include "core/serialcmds.h"
 #include "core/settings.h"
 #include "core/utils.h"
+#include "core/wifi/dns_responder.h"
 #include "core/wifi/wifi_common.h" // using common wifisetup
+#include "core/wifi/webScreen.h"
 #include "esp_task_wdt.h"
 #include "webFiles.h"
 #include <MD5Builder.h>
@@ -33,6 +36,7 @@ AsyncWebServer *server = nullptr; // initialise webserver
 const char *host = "bruce";
 String uploadFolder = "";
 static bool mdnsRunning = false;
+static DnsResponder *apDns = nullptr; // resolves the WebUI host name when running as AP
 
 // Generate random token
 String generateToken(int length = 24) {
@@ -47,6 +51,7 @@ String generateToken(int length = 24) {
 **  Turn off the WebUI
 **********************************************************************/
 void stopWebUi() {
+    webScreenEnd();
     tft.setLogging(false);
     isWebUIActive = false;
     server->end();
@@ -57,6 +62,10 @@ void stopWebUi() {
         MDNS.end();
         mdnsRunning = false;
     }
+    if (apDns) {
+        delete apDns;
+        apDns = nullptr;
+    }
 }
 /**********************************************************************
 **  Function: loopOptionsWebUi
@@ -144,19 +153,20 @@ String listFiles(FS fs, String folder) {
 ** used by server->on functions to discern whether a user has the correct
 ** httpapitoken OR is authenticated by username and password
 **********************************************************************/
+bool hasValidWebSession(AsyncWebServerRequest *request) {
+    if (!request->hasHeader("Cookie")) return false;
+    const AsyncWebHeader *cookie = request->getHeader("Cookie");
+    String c = cookie->value();
+    int idx = c.indexOf("BRUCESESSION=");
+    if (idx == -1) return false;
+    int start = idx + 13;
+    int end = c.indexOf(';', start);
+    if (end == -1) end = c.length();
+    return bruceConfig.isValidWebUISession(c.substring(start, end));
+}
+
 bool checkUserWebAuth(AsyncWebServerRequest *request, bool onFailureReturnLoginPage = false) {
-    if (request->hasHeader("Cookie")) {
-        const AsyncWebHeader *cookie = request->getHeader("Cookie");
-        String c = cookie->value();
-        int idx = c.indexOf("BRUCESESSION=");
-        if (idx != -1) {
-            int start = idx + 13;
-            int end = c.indexOf(';', start);
-            if (end == -1) end = c.length();
-            String token = c.substring(start, end);
-            if (bruceConfig.isValidWebUISession(token)) { return true; }
-        }
-    }
+    if (hasValidWebSession(request)) return true;
     if (onFailureReturnLoginPage) {
         serveWebUIFile(request, "login.html", "text/html", true, login_html, login_html_size);
     } else {
@@ -195,55 +205,147 @@ void createDirRecursive(String path, FS fs) {
 /**********************************************************************
 **  Function: handleUpload
 ** handles uploads to the filserver
+** With a "password" arg the file is encrypted chunk by chunk as it arrives
+** (see encryptStreamBegin) and saved with a .enc extension.
 **********************************************************************/
+#define UPLOAD_BUFFER_SIZE 4096 // writes go out in whole blocks of this size (LittleFS block, 8 SD sectors)
+#define UPLOAD_OPEN_RETRIES 3
+
+// Per-request upload state, kept in request->_tempObject which the server frees with free()
+struct WebUploadState {
+    uint32_t startMs;
+    uint32_t elapsedMs;
+    size_t received;
+    bool encrypt;
+    bool failed;
+    XorEncryptStream cipher;
+    size_t fill;
+    uint8_t buffer[UPLOAD_BUFFER_SIZE];
+};
+
+static bool flushUpload(AsyncWebServerRequest *request, WebUploadState *state) {
+    if (state->fill == 0) return true;
+    bool ok = request->_tempFile.write(state->buffer, state->fill) == state->fill;
+    state->fill = 0;
+    return ok;
+}
+
+static bool writeUpload(
+    AsyncWebServerRequest *request, WebUploadState *state, const uint8_t *data, size_t len
+) {
+    while (len > 0) {
+        size_t n = min(len, (size_t)UPLOAD_BUFFER_SIZE - state->fill);
+        memcpy(state->buffer + state->fill, data, n);
+        state->fill += n;
+        data += n;
+        len -= n;
+        if (state->fill == UPLOAD_BUFFER_SIZE && !flushUpload(request, state)) return false;
+    }
+    return true;
+}
+
+static bool encryptUpload(
+    AsyncWebServerRequest *request, WebUploadState *state, const uint8_t *data, size_t len
+) {
+    char hex[3 * 128];
+    for (size_t i = 0; i < len; i += 128) {
+        size_t n = encryptStreamUpdate(state->cipher, data + i, min((size_t)128, len - i), hex);
+        if (!writeUpload(request, state, (const uint8_t *)hex, n)) return false;
+    }
+    return true;
+}
+
 void handleUpload(
     AsyncWebServerRequest *request, String filename, size_t index, uint8_t *data, size_t len, bool final
 ) {
-    if (checkUserWebAuth(request)) {
-        if (uploadFolder == "/") uploadFolder = "";
-        if (!index) {
-            if (request->hasArg("password")) filename = filename + ".enc";
-            // Serial.println("File: " + uploadFolder + "/" + filename);
-            String relativePath = filename;
-            String fullPath = uploadFolder + "/" + relativePath;
-            String dirPath = fullPath.substring(0, fullPath.lastIndexOf("/"));
-            if (dirPath.length() > 0) { createDirRecursive(dirPath, _webFS); }
-            MOUNT_SD_CARD;
-        RETRY:
-            request->_tempFile = _webFS.open(uploadFolder + "/" + filename, "w");
-            if (!request->_tempFile) {
-                // Serial.println("Failed to open file for writing: " + uploadFolder + "/" + filename);
-                goto RETRY;
-            }
-        }
+    if (!index) {
+        if (!hasValidWebSession(request)) return; // answered by handleUploadDone
+        WebUploadState *state = (WebUploadState *)request->_tempObject;
+        if (state == NULL) state = (WebUploadState *)malloc(sizeof(WebUploadState));
+        if (state == NULL) return; // no state means failure for the completion handler
+        memset(state, 0, sizeof(WebUploadState));
+        request->_tempObject = state;
+        state->startMs = millis();
+        state->encrypt = request->hasArg("password");
 
-        if (len) {
-            if (request->hasArg("password")) {
-                // encryption requested
-                static int chunck_no = 0;
-                if (chunck_no != 0) {
-                    // TODO: handle multiple chunks
-                    request->send(404, "text/html", "file is too big");
-                    return;
-                } else chunck_no += 1;
-                String enc_password = request->arg("password");
-                String plaintext = String((char *)data).substring(0, len);
-                String cyphertxt = encryptString(plaintext, enc_password);
-                if (cyphertxt == "") { return; }
-                if (request->_tempFile)
-                    request->_tempFile.write((const uint8_t *)cyphertxt.c_str(), cyphertxt.length());
-            } else {
-                if (request->_tempFile) request->_tempFile.write(data, len);
-            }
+        if (uploadFolder == "/") uploadFolder = "";
+        if (state->encrypt) filename = filename + ".enc";
+        // Serial.println("File: " + uploadFolder + "/" + filename);
+        String relativePath = filename;
+        String fullPath = uploadFolder + "/" + relativePath;
+        String dirPath = fullPath.substring(0, fullPath.lastIndexOf("/"));
+        MOUNT_SD_CARD;
+        if (dirPath.length() > 0) { createDirRecursive(dirPath, _webFS); }
+        for (int i = 0; i < UPLOAD_OPEN_RETRIES && !request->_tempFile; i++) {
+            if (i > 0) vTaskDelay(pdMS_TO_TICKS(50));
+            request->_tempFile = _webFS.open(fullPath, "w");
         }
-        if (final) {
-            // close the file handle as the upload is now done
-            if (request->_tempFile) request->_tempFile.close();
+        if (!request->_tempFile) {
+            Serial.println("Failed to open file for writing: " + fullPath);
+            state->failed = true;
             UNMOUNT_SD_CARD;
+            return;
+        }
+        if (state->encrypt) {
+            String header = encryptStreamBegin(state->cipher, request->arg("password"));
+            state->failed = !writeUpload(request, state, (const uint8_t *)header.c_str(), header.length());
+        }
+    }
+
+    WebUploadState *state = (WebUploadState *)request->_tempObject;
+    if (state == NULL || !request->_tempFile) return;
+
+    if (len && !state->failed) {
+        state->received += len;
+        if (state->encrypt) state->failed = !encryptUpload(request, state, data, len);
+        else state->failed = !writeUpload(request, state, data, len);
+    }
+    if (final) {
+        if (!state->failed && state->encrypt) {
+            String trailer = encryptStreamEnd(state->cipher);
+            state->failed = !writeUpload(request, state, (const uint8_t *)trailer.c_str(), trailer.length());
         }
+        if (!flushUpload(request, state)) state->failed = true;
+        // close the file handle as the upload is now done
+        request->_tempFile.close();
+        UNMOUNT_SD_CARD;
+
+        uint32_t elapsed = state->elapsedMs = millis() - state->startMs;
+        Serial.printf(
+            "Upload %s: %u bytes in %lu ms (%.1f KB/s)%s\n",
+            filename.c_str(),
+            state->received,
+            elapsed,
+            elapsed ? state->received / 1.024f / elapsed : 0.0f,
+            state->failed ? ", write failed" : ""
+        );
     }
 }
 
+/**********************************************************************
+**  Function: handleUploadDone
+** sends the upload result, with the transfer rate
+**********************************************************************/
+void handleUploadDone(AsyncWebServerRequest *request) {
+    if (!checkUserWebAuth(request)) return;
+    WebUploadState *state = (WebUploadState *)request->_tempObject;
+    if (state == NULL) {
+        request->send(500, "text/plain", "File upload failed: no file received or out of memory");
+        return;
+    }
+    if (state->failed) {
+        request->send(500, "text/plain", "File upload failed: could not write the file");
+        return;
+    }
+    uint32_t elapsed = state->elapsedMs;
+    request->send(
+        200,
+        "text/plain",
+        "File upload completed: " + String(state->received) + " bytes in " + String(elapsed) + " ms (" +
+            String(elapsed ? state->received / 1.024f / elapsed : 0.0f, 1) + " KB/s)"
+    );
+}
+
 void notFound(AsyncWebServerRequest *request) { request->send(404, "text/plain", "Nothing in here Sharky"); }
 
 /**********************************************************************
@@ -472,14 +574,26 @@ void configureWebServer() {
         }
     });
 
+    // Tasks, heap and allocation tags sampled by the profiler
+    server->on("/profiler", HTTP_GET, [](AsyncWebServerRequest *request) {
+        if (checkUserWebAuth(request)) request->send(200, "application/json", profilerJson());
+    });
+
     // Get Screen
     server->on("/getscreen", HTTP_GET, [](AsyncWebServerRequest *request) {
         if (checkUserWebAuth(request)) {
-            uint8_t binData[MAX_LOG_ENTRIES * MAX_LOG_SIZE];
+            // 8 KB is too much for the async_tcp task stack
+            uint8_t *binData = (uint8_t *)malloc(MAX_LOG_ENTRIES * MAX_LOG_SIZE);
+            if (binData == NULL) {
+                request->send(503, "text/plain", "Out of memory");
+                return;
+            }
             size_t binSize = 0;
-
             tft.getBinLog(binData, binSize);
-            request->send(200, "application/octet-stream", (const uint8_t *)binData, binSize);
+            AsyncResponseStream *response = request->beginResponseStream("application/octet-stream", binSize);
+            response->write(binData, binSize);
+            free(binData);
+            request->send(response);
         }
     });
 
@@ -514,25 +628,9 @@ void configureWebServer() {
         if (request->hasArg("cmnd")) {
             String cmnd = request->arg("cmnd");
             if (cmnd.startsWith("nav")) {
-                volatile bool *var = &SelPress;
-                if (cmnd.startsWith("nav sel")) var = &SelPress;
-                if (cmnd.startsWith("nav esc")) var = &EscPress;
-                if (cmnd.startsWith("nav up")) var = &UpPress;
-                if (cmnd.startsWith("nav down")) var = &DownPress;
-                if (cmnd.startsWith("nav next")) var = &NextPress;
-                if (cmnd.startsWith("nav prev")) var = &PrevPress;
-                request->send(200, "text/plain", "command " + cmnd + " success");
-                int time;
-                if (cmnd.endsWith("0")) time = cmnd.substring(cmnd.lastIndexOf(' ')).toInt();
-                else time = 10;
-                auto tmp = millis() + time;
-                while (tmp > millis()) {
-                    AnyKeyPress = true;
-                    SerialCmdPress = true;
-                    *var = true;
-                    if (!LongPress) vTaskDelay(pdMS_TO_TICKS(190));
-                    else vTaskDelay(pdMS_TO_TICKS(50));
-                }
+                // Held by the input task, the web server is not blocked for the duration of the press
+                if (webScreenQueueNav(cmnd)) request->send(200, "text/plain", "command " + cmnd + " success");
+                else request->send(400, "text/plain", "unknown key or too many queued presses");
             } else {
                 MOUNT_SD_CARD;
                 if (parseSerialCommand(cmnd, false)) {
@@ -696,7 +794,7 @@ void configureWebServer() {
     server->on(
         "/upload",
         HTTP_POST,
-        [](AsyncWebServerRequest *request) { request->send(200, "text/plain", "File upload completed"); },
+        handleUploadDone,
         handleUpload
     );
 
@@ -715,6 +813,9 @@ void configureWebServer() {
             }
         }
     });
+
+    // Live screen and input for the navigator
+    webScreenBegin(server, hasValidWebSession);
     server->begin();
     Serial.println("Webserver started");
 }
@@ -747,6 +848,20 @@ void startWebUi(bool mode_ap) {
 
         configureWebServer();
 
+        // mDNS does not work for most phones connected to our AP, so answer "bruce" directly
+        if (WiFi.getMode() & WIFI_MODE_AP) {
+            IPAddress apIp = WiFi.softAPIP();
+            uint8_t ip[4] = {apIp[0], apIp[1], apIp[2], apIp[3]};
+            apDns = new DnsResponder();
+            apDns->addRecord(host, ip);
+            apDns->addRecord((String(host) + ".local").c_str(), ip);
+            apDns->addRecord((String("*.") + host).c_str(), ip);
+            if (!apDns->begin(53)) {
+                delete apDns;
+                apDns = nullptr;
+            }
+        }
+
         isWebUIActive = true;
     }
     tft.setLogging();
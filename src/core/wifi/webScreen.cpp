@@ -0,0 +1,284 @@
+#include "webScreen.h"
+#include <globals.h>
+#include <vector>
+
+#define WEBSCREEN_QUIET_MS 5 // a redraw is taken as finished once nothing new was logged for this long
+#define WEBSCREEN_KEYFRAME_BYTES (MAX_LOG_ENTRIES * MAX_LOG_SIZE)
+
+struct WebScreenClient {
+    uint32_t id;
+    bool needsKeyframe;
+};
+
+struct WebInputEvent {
+    uint8_t key; // index in webInputKeys
+    uint16_t holdMs;
+    uint32_t queuedAt;
+};
+
+static const struct {
+    const char *name;
+    volatile bool *flag;
+} webInputKeys[] = {
+    {"sel",      &SelPress     },
+    {"esc",      &EscPress     },
+    {"up",       &UpPress      },
+    {"down",     &DownPress    },
+    {"next",     &NextPress    },
+    {"prev",     &PrevPress    },
+    {"nextpage", &NextPagePress},
+    {"prevpage", &PrevPagePress},
+};
+
+static AsyncWebSocket *ws = nullptr; // owned by the server once added
+static TaskHandle_t senderTask = NULL;
+static QueueHandle_t deltaQueue = NULL;
+static QueueHandle_t inputQueue = NULL; // kept for good, the input task may poll it at any time
+static SemaphoreHandle_t clientsMutex = NULL;
+static std::vector<WebScreenClient> clients;
+static volatile bool streaming = false;
+
+// Reset with every stats message. Written from several tasks without locking, they are only indicative.
+static struct {
+    uint32_t frames;
+    uint32_t keyframes;
+    uint32_t bytes;
+    uint32_t skipped;
+    uint32_t inputs;
+    uint32_t inputLatencySum;
+    uint32_t inputLatencyMax;
+} stats;
+
+// Key currently being held by a remote press
+static volatile bool *heldKey = NULL;
+static uint32_t holdUntil = 0;
+static uint32_t nextPress = 0;
+
+/**********************************************************************
+**  Input
+**********************************************************************/
+bool webScreenQueueNav(const String &command) {
+    if (inputQueue == NULL) return false;
+    String args = command.startsWith("nav ") ? command.substring(4) : command;
+    args.trim();
+    args.toLowerCase();
+    int space = args.indexOf(' ');
+    String key = space < 0 ? args : args.substring(0, space);
+    long holdMs = space < 0 ? 10 : args.substring(space + 1).toInt();
+    if (holdMs < 10) holdMs = 10;
+    if (holdMs > 5000) holdMs = 5000;
+
+    for (uint8_t i = 0; i < sizeof(webInputKeys) / sizeof(webInputKeys[0]); i++) {
+        if (key != webInputKeys[i].name) continue;
+        WebInputEvent event = {i, (uint16_t)holdMs, millis()};
+        return xQueueSend(inputQueue, &event, 0) == pdTRUE;
+    }
+    return false;
+}
+
+void webScreenInputPoll() {
+    if (inputQueue == NULL) return;
+    uint32_t now = millis();
+    if (heldKey == NULL) {
+        WebInputEvent event;
+        if (xQueueReceive(inputQueue, &event, 0) != pdTRUE) return;
+        heldKey = webInputKeys[event.key].flag;
+        holdUntil = now + event.holdMs;
+        nextPress = now;
+
+        uint32_t latency = now - event.queuedAt;
+        stats.inputs++;
+        stats.inputLatencySum += latency;
+        if (latency > stats.inputLatencyMax) stats.inputLatencyMax = latency;
+    }
+    // Same timing as the serial "nav" command: pressed again every 190ms (50ms on long press) while held
+    if ((int32_t)(now - nextPress) >= 0) {
+        AnyKeyPress = true;
+        SerialCmdPress = true;
+        *heldKey = true;
+        nextPress = now + (LongPress ? 50 : 190);
+    }
+    if ((int32_t)(now - holdUntil) >= 0) heldKey = NULL;
+}
+
+/**********************************************************************
+**  Screen stream
+**********************************************************************/
+// The list is copied out so the library's own locks are never taken while holding clientsMutex
+static std::vector<WebScreenClient> snapshotClients() {
+    xSemaphoreTake(clientsMutex, portMAX_DELAY);
+    std::vector<WebScreenClient> copy = clients;
+    xSemaphoreGive(clientsMutex);
+    return copy;
+}
+
+static void setNeedsKeyframe(uint32_t id, bool value) {
+    xSemaphoreTake(clientsMutex, portMAX_DELAY);
+    for (auto &client : clients) {
+        if (client.id == id) client.needsKeyframe = value;
+    }
+    xSemaphoreGive(clientsMutex);
+}
+
+// Sends the delta frame to clients that are keeping up. A client with a full queue skips it and gets a
+// keyframe once its queue has room again; everyone gets one if the frame itself lost packets.
+static void sendFrame(const uint8_t *delta, size_t deltaLen, bool deltaComplete, uint8_t *keyframe) {
+    size_t keyframeLen = 0;
+    bool sent = false;
+    for (auto &client : snapshotClients()) {
+        if (!ws->availableForWrite(client.id)) {
+            if (deltaLen > 0 || !deltaComplete) {
+                setNeedsKeyframe(client.id, true);
+                stats.skipped++;
+            }
+            continue;
+        }
+        if (client.needsKeyframe || !deltaComplete) {
+            if (keyframeLen == 0) tft.getBinLog(keyframe, keyframeLen);
+            ws->binary(client.id, keyframe, keyframeLen);
+            setNeedsKeyframe(client.id, false);
+            stats.keyframes++;
+            stats.bytes += keyframeLen;
+            sent = true;
+        } else if (deltaLen > 0) {
+            ws->binary(client.id, delta, deltaLen);
+            stats.bytes += deltaLen;
+            sent = true;
+        }
+    }
+    if (sent) stats.frames++;
+}
+
+static void sendStats(uint32_t elapsedMs) {
+    size_t clientCount = snapshotClients().size();
+    if (clientCount == 0) return;
+    char message[256];
+    snprintf(
+        message,
+        sizeof(message),
+        "stats {\"fps\":%.1f,\"frames\":%u,\"keyframes\":%u,\"kbps\":%.1f,\"skipped\":%u,\"clients\":%u,"
+        "\"inputs\":%u,\"inputLatency\":%.1f,\"inputLatencyMax\":%u}",
+        stats.frames * 1000.0f / elapsedMs,
+        stats.frames,
+        stats.keyframes,
+        stats.bytes * 8.0f / elapsedMs,
+        stats.skipped,
+        clientCount,
+        stats.inputs,
+        stats.inputs ? (float)stats.inputLatencySum / stats.inputs : 0.0f,
+        stats.inputLatencyMax
+    );
+    memset(&stats, 0, sizeof(stats));
+    ws->textAll(message);
+}
+
+static void webScreenTask(void *pv) {
+    uint8_t *frame = (uint8_t *)malloc(WEBSCREEN_FRAME_BYTES);
+    uint8_t *keyframe =
+        (uint8_t *)(psramFound() ? ps_malloc(WEBSCREEN_KEYFRAME_BYTES) : malloc(WEBSCREEN_KEYFRAME_BYTES));
+    uint32_t lastFrame = 0;
+    uint32_t lastStats = millis();
+    tftLog entry;
+
+    while (streaming && frame != NULL && keyframe != NULL) {
+        size_t len = 0;
+        bool complete = true;
+        if (xQueueReceive(deltaQueue, &entry, pdMS_TO_TICKS(WEBSCREEN_FRAME_MS)) == pdTRUE) {
+            // Gather the whole redraw: until drawing pauses, but not before the frame interval has passed
+            // and never longer than one interval while the screen keeps changing
+            uint32_t first = millis();
+            while (true) {
+                if (len + MAX_LOG_SIZE > WEBSCREEN_FRAME_BYTES) complete = false;
+                else len += tft.getLogPacket(entry, frame + len);
+
+                uint32_t now = millis();
+                if (now - first >= WEBSCREEN_FRAME_MS) break;
+                int32_t wait = WEBSCREEN_QUIET_MS;
+                int32_t untilNextFrame = (int32_t)(lastFrame + WEBSCREEN_FRAME_MS - now);
+                if (untilNextFrame > wait) wait = untilNextFrame;
+                if (xQueueReceive(deltaQueue, &entry, pdMS_TO_TICKS(wait)) != pdTRUE) break;
+            }
+            lastFrame = millis();
+        }
+        if (tft.takeStreamOverflow()) complete = false;
+        // Runs when idle too, so clients waiting for a keyframe get it once their queue drains
+        sendFrame(frame, len, complete, keyframe);
+
+        if (millis() - lastStats >= WEBSCREEN_STATS_MS) {
+            sendStats(millis() - lastStats);
+            ws->cleanupClients(WEBSCREEN_MAX_CLIENTS);
+            lastStats = millis();
+        }
+    }
+    free(frame);
+    free(keyframe);
+    senderTask = NULL;
+    vTaskDelete(NULL);
+}
+
+static void onWebScreenEvent(
+    AsyncWebSocket *server, AsyncWebSocketClient *client, AwsEventType type, void *arg, uint8_t *data,
+    size_t len
+) {
+    if (type == WS_EVT_CONNECT) {
+        xSemaphoreTake(clientsMutex, portMAX_DELAY);
+        clients.push_back({client->id(), true}); // starts with a keyframe
+        xSemaphoreGive(clientsMutex);
+    } else if (type == WS_EVT_DISCONNECT) {
+        xSemaphoreTake(clientsMutex, portMAX_DELAY);
+        for (auto it = clients.begin(); it != clients.end(); ++it) {
+            if (it->id != client->id()) continue;
+            clients.erase(it);
+            break;
+        }
+        xSemaphoreGive(clientsMutex);
+    } else if (type == WS_EVT_DATA) {
+        // Commands are short, only complete single-frame text messages are expected
+        AwsFrameInfo *info = (AwsFrameInfo *)arg;
+        if (!info->final || info->index != 0 || info->len != len || info->opcode != WS_TEXT) return;
+        String message((const char *)data, len);
+        if (message.startsWith("ping ")) {
+            client->text("pong " + message.substring(5));
+        } else if (message.startsWith("nav ")) {
+            if (!webScreenQueueNav(message)) client->text("error unknown key or input queue full");
+        }
+    }
+}
+
+void webScreenBegin(AsyncWebServer *server, std::function<bool(AsyncWebServerRequest *)> authorize) {
+    if (ws != nullptr) return;
+    if (clientsMutex == NULL) clientsMutex = xSemaphoreCreateMutex();
+    if (inputQueue == NULL) inputQueue = xQueueCreate(WEBSCREEN_INPUT_QUEUE, sizeof(WebInputEvent));
+    deltaQueue = xQueueCreate(WEBSCREEN_DELTA_QUEUE, sizeof(tftLog));
+    if (clientsMutex == NULL || inputQueue == NULL || deltaQueue == NULL) {
+        Serial.println("WebUI screen stream: not enough memory");
+        return;
+    }
+
+    ws = new AsyncWebSocket("/ws");
+    ws->handleHandshake(authorize);
+    ws->onEvent(onWebScreenEvent);
+    server->addHandler(ws);
+
+    memset(&stats, 0, sizeof(stats));
+    streaming = true;
+    tft.setStreamQueue(deltaQueue);
+    xTaskCreate(webScreenTask, "webScreen", 4096, NULL, 1, &senderTask);
+}
+
+void webScreenEnd() {
+    if (ws == nullptr) return;
+    tft.setStreamQueue(NULL); // no drawing task sends to deltaQueue past this point
+    streaming = false;
+    while (senderTask != NULL) vTaskDelay(pdMS_TO_TICKS(10));
+    ws->closeAll();
+    ws = nullptr;
+
+    xSemaphoreTake(clientsMutex, portMAX_DELAY);
+    clients.clear();
+    xSemaphoreGive(clientsMutex);
+    // Producers and the sender task are both gone now
+    QueueHandle_t queue = deltaQueue;
+    deltaQueue = NULL;
+    vQueueDelete(queue);
+}
@@ -0,0 +1,36 @@
+#ifndef __WEB_SCREEN_H__
+#define __WEB_SCREEN_H__
+
+// WebSocket channel of the WebUI navigator.
+// Screen changes logged by tft_logger are pushed to the browser as they are drawn, in the same packet
+// format as /getscreen. Packets drawn close together are coalesced into one frame, and a client whose
+// send queue is full skips deltas and gets a full screen (keyframe) once it has caught up.
+// Key presses from the browser go into a queue that the input task drains without blocking the
+// web server.
+//
+// Browser -> device (text): "nav <sel|esc|up|down|next|prev|nextpage|prevpage> [holdMs]", "ping <t>"
+// Device -> browser: binary screen packets, text "pong <t>" and "stats {json}" once per second
+
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+#include <functional>
+
+#define WEBSCREEN_FRAME_MS 40        // coalescing window, caps the stream at 25 frames/s
+#define WEBSCREEN_FRAME_BYTES 4096   // a frame with more changes than this becomes a keyframe
+#define WEBSCREEN_DELTA_QUEUE 32     // log entries buffered between the drawing task and the sender
+#define WEBSCREEN_INPUT_QUEUE 16     // key presses waiting for the input task
+#define WEBSCREEN_MAX_CLIENTS 4
+#define WEBSCREEN_STATS_MS 1000
+
+// Adds the /ws endpoint to the server. `authorize` checks the handshake request (session cookie).
+void webScreenBegin(AsyncWebServer *server, std::function<bool(AsyncWebServerRequest *)> authorize);
+void webScreenEnd();
+
+// Queues a "nav <key> [holdMs]" command (the "nav " prefix is optional). False for an unknown key or a
+// full queue.
+bool webScreenQueueNav(const String &command);
+
+// Called by the input task on every pass: applies queued key presses, never blocks
+void webScreenInputPoll();
+
+#endif
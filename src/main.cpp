@@ -1,9 +1,13 @@
 #include "core/main_menu.h"
 #include <globals.h>
 
+#include "core/boot_sequencer.h"
+#include "core/boot_timeline.h"
 #include "core/powerSave.h"
+#include "core/profiler.h"
 #include "core/serial_commands/cli.h"
 #include "core/utils.h"
+#include "core/wifi/webScreen.h"
 #include "esp32-hal-psram.h"
 #include "esp_task_wdt.h"
 #include "esp_wifi.h"
@@ -52,31 +56,12 @@ keyStroke KeyStroke;
 
 TaskHandle_t xHandle;
 void __attribute__((weak)) taskInputHandler(void *parameter) {
-    auto timer = millis();
     while (true) {
         checkPowerSaveTime();
-        // Sometimes this task run 2 or more times before looptask,
-        // and navigation gets stuck, the idea here is run the input detection
-        // if AnyKeyPress is false, or rerun if it was not renewed within 75ms (arbitrary)
-        // because AnyKeyPress will be true if didn´t passed through a check(bool var)
-        if (!AnyKeyPress || millis() - timer > 75) {
-            NextPress = false;
-            PrevPress = false;
-            UpPress = false;
-            DownPress = false;
-            SelPress = false;
-            EscPress = false;
-            AnyKeyPress = false;
-            SerialCmdPress = false;
-            NextPagePress = false;
-            PrevPagePress = false;
-            touchPoint.pressed = false;
-            touchPoint.Clear();
+        webScreenInputPoll(); // key presses from the WebUI navigator, published by inputPoll()
 #ifndef USE_TFT_eSPI_TOUCH
-            InputHandler();
+        inputPoll();
 #endif
-            timer = millis();
-        }
         vTaskDelay(pdMS_TO_TICKS(10));
     }
 }
@@ -151,8 +136,13 @@ volatile int tftHeight = VECTOR_DISPLAY_DEFAULT_WIDTH;
  **  Config LittleFS and SD storage
  *********************************************************************/
 void begin_storage() {
-    if (!LittleFS.begin(true)) { LittleFS.format(), LittleFS.begin(); }
-    bool checkFS = setupSdCard();
+    bool checkFS;
+    {
+        BootPhaseScope phase("storage");
+        if (!LittleFS.begin(true)) { LittleFS.format(), LittleFS.begin(); }
+        checkFS = setupSdCard();
+    }
+    BootPhaseScope phase("config");
     bruceConfig.fromFile(checkFS);
     bruceConfigPins.fromFile(checkFS);
 }
@@ -232,15 +222,12 @@ void boot_screen() {
 }
 
 /*********************************************************************
- **  Function: boot_screen_anim
- **  Draw boot screen
+ **  Function: boot_assets
+ **  Checks for boot.jpg in SD and LittleFS for customization
  *********************************************************************/
-void boot_screen_anim() {
-    boot_screen();
-    int i = millis();
-    // checks for boot.jpg in SD and LittleFS for customization
-    int boot_img = 0;
-    bool drawn = false;
+static int boot_img = 0;
+void boot_assets() {
+    boot_img = 0;
     if (sdcardMounted) {
         if (SD.exists("/boot.jpg")) boot_img = 1;
         else if (SD.exists("/boot.gif")) boot_img = 3;
@@ -248,11 +235,24 @@ void boot_screen_anim() {
     if (boot_img == 0 && LittleFS.exists("/boot.jpg")) boot_img = 2;
     else if (boot_img == 0 && LittleFS.exists("/boot.gif")) boot_img = 4;
     if (bruceConfig.theme.boot_img) boot_img = 5; // override others
+}
 
-    tft.drawPixel(0, 0, 0);       // Forces back communication with TFT, to avoid ghosting
-                                  // Start image loop
-    while (millis() < i + 7000) { // boot image lasts for 5 secs
-        if ((millis() - i > 2000) && !drawn) {
+/*********************************************************************
+ **  Function: boot_screen_anim
+ **  Draw boot screen while the startup steps run, until they are done
+ *********************************************************************/
+#define BOOT_SPLASH_MIN_MS 2500 // even when the steps finish sooner, enough for the animation
+
+void boot_screen_anim(BootSequencer &startup) {
+    boot_screen();
+    int i = millis();
+    bool drawn = false;
+
+    tft.drawPixel(0, 0, 0); // Forces back communication with TFT, to avoid ghosting
+    // Start image loop
+    while (!startup.done() || millis() < i + BOOT_SPLASH_MIN_MS) {
+        startup.step(); // one foreground step per frame, boot_assets comes first
+        if ((millis() - i > 400) && !drawn) {
             tft.fillRect(0, 45, tftWidth, tftHeight - 45, bruceConfig.bgColor);
             if (boot_img > 0 && !drawn) {
                 tft.fillScreen(bruceConfig.bgColor);
@@ -284,11 +284,11 @@ void boot_screen_anim() {
             drawn = true;
         }
 #if !defined(LITE_VERSION)
-        if (!boot_img && (millis() - i > 2200) && (millis() - i) < 2700)
+        if (!boot_img && (millis() - i > 600) && (millis() - i) < 1100)
             tft.drawRect(2 * tftWidth / 3, tftHeight / 2, 2, 2, bruceConfig.priColor);
-        if (!boot_img && (millis() - i > 2700) && (millis() - i) < 2900)
+        if (!boot_img && (millis() - i > 1100) && (millis() - i) < 1300)
             tft.fillRect(0, 45, tftWidth, tftHeight - 45, bruceConfig.bgColor);
-        if (!boot_img && (millis() - i > 2900) && (millis() - i) < 3400)
+        if (!boot_img && (millis() - i > 1300) && (millis() - i) < 1800)
             tft.drawXBitmap(
                 2 * tftWidth / 3 - 30,
                 5 + tftHeight / 2,
@@ -298,8 +298,8 @@ void boot_screen_anim() {
                 bruceConfig.bgColor,
                 bruceConfig.priColor
             );
-        if (!boot_img && (millis() - i > 3400) && (millis() - i) < 3600) tft.fillScreen(bruceConfig.bgColor);
-        if (!boot_img && (millis() - i > 3600))
+        if (!boot_img && (millis() - i > 1800) && (millis() - i) < 2000) tft.fillScreen(bruceConfig.bgColor);
+        if (!boot_img && (millis() - i > 2000))
             tft.drawXBitmap(
                 (tftWidth - 238) / 2,
                 (tftHeight - 133) / 2,
@@ -345,6 +345,44 @@ void init_led() {
 #endif
 }
 
+/*********************************************************************
+ **  Function: begin_wifi
+ **  WiFi country and power
+ *********************************************************************/
+void begin_wifi() {
+    // Set WiFi country to avoid warnings and ensure max power
+    wifi_country_t country = {
+        .cc = "US",
+        .schan = 1,
+        .nchan = 14,
+        .max_tx_power = CONFIG_ESP_PHY_MAX_TX_POWER, // 20
+        .policy = WIFI_COUNTRY_POLICY_MANUAL
+    };
+
+    esp_wifi_set_max_tx_power(80); // 80 translates to 20dBm
+    esp_wifi_set_country(&country);
+}
+
+/*********************************************************************
+ **  Function: connect_wifi
+ **  WiFi connection at startup, once the splash is gone: the task draws the status bar
+ *********************************************************************/
+void connect_wifi() {
+#if defined(HAS_SCREEN)
+    if (bruceConfig.wifiAtStartup) {
+        log_i("Loading Wifi at Startup");
+        xTaskCreate(
+            wifiConnectTask,   // Task function
+            "wifiConnectTask", // Task Name
+            4096,              // Stack size
+            NULL,              // Task parameters
+            2,                 // Task priority (0 to 3), loopTask has priority 2.
+            NULL               // Task handle (not used)
+        );
+    }
+#endif
+}
+
 /*********************************************************************
  **  Function: startup_sound
  **  Play sound or tone depending on device hardware
@@ -388,6 +426,7 @@ void setup() {
     else log_d("PSRAM Not Found");
     log_d("Total PSRAM: %d", ESP.getPsramSize());
     log_d("Free PSRAM: %d", ESP.getFreePsram());
+    profilerBegin();
 
     // declare variables
     prog_handler = 0;
@@ -396,7 +435,10 @@ void setup() {
     BLEConnected = false;
     bruceConfig.bright = 100; // theres is no value yet
     bruceConfigPins.rotation = ROTATION;
+    int8_t phase = bootPhaseBegin("gpio");
     setup_gpio();
+    bootPhaseEnd(phase);
+    phase = bootPhaseBegin("display");
 #if defined(HAS_SCREEN)
     tft.init();
     tft.setRotation(bruceConfigPins.rotation);
@@ -407,29 +449,23 @@ void setup() {
 #else
     tft.begin();
 #endif
+    bootPhaseEnd(phase);
     begin_storage();
+    phase = bootPhaseBegin("tft config");
     begin_tft();
-    init_clock();
-    init_led();
-
-    // Set WiFi country to avoid warnings and ensure max power
-    wifi_country_t country = {
-        .cc = "US",
-        .schan = 1,
-        .nchan = 14,
-        .max_tx_power = CONFIG_ESP_PHY_MAX_TX_POWER, // 20
-        .policy = WIFI_COUNTRY_POLICY_MANUAL
-    };
-
-    esp_wifi_set_max_tx_power(80); // 80 translates to 20dBm
-    esp_wifi_set_country(&country);
-
     // Some GPIO Settings (such as CYD's brightness control must be set after tft and sdcard)
     _post_setup_gpio();
     // end of post gpio begin
+    bootPhaseEnd(phase);
+
+    // The RTC is on Wire1, which the input task uses through M5Unified on some boards (Core2)
+    phase = bootPhaseBegin("clock");
+    init_clock();
+    bootPhaseEnd(phase);
 
     // #ifndef USE_TFT_eSPI_TOUCH
     // This task keeps running all the time, will never stop
+    profilerTaskStack("InputHandler", INPUT_HANDLER_TASK_STACK_SIZE);
     xTaskCreate(
         taskInputHandler,              // Task function
         "InputHandler",                // Task Name
@@ -439,28 +475,44 @@ void setup() {
         &xHandle                       // Task handle (not used)
     );
     // #endif
+
+    // The splash needs the config and the theme (colors, rotation, boot image), the rest runs while it
+    // plays and it ends when they are done. The startup sound would stall the animation and the WiFi
+    // connect task draws the status bar, so both wait for the splash to end.
+    BootSequencer startup;
 #if defined(HAS_SCREEN)
+    phase = bootPhaseBegin("theme");
     bruceConfig.openThemeFile(bruceConfig.themeFS(), bruceConfig.themePath, false);
-    if (!bruceConfig.instantBoot) {
-        boot_screen_anim();
-        startup_sound();
+    bootPhaseEnd(phase);
+    bool splash = !bruceConfig.instantBoot;
+    if (splash) startup.add("boot assets", boot_assets);
+#endif
+    startup.add("led", init_led);
+    startup.add("wifi", begin_wifi, true);
+    startup.start();
+#if defined(HAS_SCREEN)
+    if (splash) {
+        phase = bootPhaseBegin("splash");
+        boot_screen_anim(startup);
+        bootPhaseEnd(phase);
     }
-    if (bruceConfig.wifiAtStartup) {
-        log_i("Loading Wifi at Startup");
-        xTaskCreate(
-            wifiConnectTask,   // Task function
-            "wifiConnectTask", // Task Name
-            4096,              // Stack size
-            NULL,              // Task parameters
-            2,                 // Task priority (0 to 3), loopTask has priority 2.
-            NULL               // Task handle (not used)
-        );
+#endif
+    startup.finish();
+#if defined(HAS_SCREEN)
+    if (splash) {
+        phase = bootPhaseBegin("sound");
+        startup_sound();
+        bootPhaseEnd(phase);
     }
 #endif
+    connect_wifi();
+
     //  start a task to handle serial commands while the webui is running
     startSerialCommandsHandlerTask();
 
     wakeUpScreen();
+    bootTimelineDone();
+    Serial.print(bootTimelineReport());
     if (bruceConfig.startupApp != "" && !startupApp.startApp(bruceConfig.startupApp)) {
         bruceConfig.setStartupApp("");
     }
@@ -479,6 +531,7 @@ void loop() {
         TaskHandle_t interpreterTaskHandler = NULL;
         vTaskDelete(serialcmdsTaskHandle); // stop serial commands while in interpreter
         vTaskDelay(pdMS_TO_TICKS(10));
+        profilerTaskStack("interpreterHandler", INTERPRETER_TASK_STACK_SIZE);
         xTaskCreate(
             interpreterHandler,          // Task function
             "interpreterHandler",        // Task Name
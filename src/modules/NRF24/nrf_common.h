@@ -23,6 +23,7 @@ enum NRF24_MODE {
 
 extern RF24 NRFradio;
 extern HardwareSerial NRFSerial; // Uses UART2 for External NRF's
+extern SPIClass *NRFSPI;         // bus picked by nrf_start(), may be the display one
 
 NRF24_MODE nrf_setMode();
 
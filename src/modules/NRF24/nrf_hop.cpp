@@ -0,0 +1,245 @@
+#include "nrf_hop.h"
+#include <stdio.h>
+#include <string.h>
+
+static const uint8_t test_channels[] = {50, 52, 54, 56, 58, 60, 62, 64, 66, 68, 70, 72, 74, 76,
+                                        78, 80, 2,  4,  6,  8,  10, 12, 14, 16, 18, 20, 22, 24,
+                                        26, 28, 30, 32, 34, 36, 38, 40, 42, 44, 46, 48};
+static const uint8_t wifi_channels[] = {2, 7, 12, 17, 22, 27, 32, 37, 42, 47, 52, 57, 62, 67, 72, 77};
+static const uint8_t ble_channels[] = {2,  3,  4,  5,  6,  7,  8,  9,  10, 11, 12, 13, 14, 15,
+                                       16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29,
+                                       30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40, 41};
+static const uint8_t ble_adv_priority[] = {37, 38, 39, 1, 2, 3, 25, 26, 27, 79, 80, 81};
+static const uint8_t bluetooth_channels[] = {2,  3,  4,  5,  6,  7,  8,  9,  10, 11, 12, 13, 14, 15,
+                                             16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29,
+                                             30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40, 41, 42, 43,
+                                             44, 45, 46, 47, 48, 49, 50, 51, 52, 53, 54, 55, 56, 57,
+                                             58, 59, 60, 61, 62, 63, 64, 65, 66, 67, 68, 69, 70, 71,
+                                             72, 73, 74, 75, 76, 77, 78, 79, 80};
+static const uint8_t usb_channels[] = {40, 50, 60};
+static const uint8_t video_channels[] = {70, 75, 80};
+static const uint8_t rc_channels[] = {1, 3, 5, 7};
+static const uint8_t full_channels[] = {
+    1,   2,   3,   4,   5,   6,   7,   8,   9,   10,  11,  12,  13,  14,  15,  16,  17,  18,
+    19,  20,  21,  22,  23,  24,  25,  26,  27,  28,  29,  30,  31,  32,  33,  34,  35,  36,
+    37,  38,  39,  40,  41,  42,  43,  44,  45,  46,  47,  48,  49,  50,  51,  52,  53,  54,
+    55,  56,  57,  58,  59,  60,  61,  62,  63,  64,  65,  66,  67,  68,  69,  70,  71,  72,
+    73,  74,  75,  76,  77,  78,  79,  80,  81,  82,  83,  84,  85,  86,  87,  88,  89,  90,
+    91,  92,  93,  94,  95,  96,  97,  98,  99,  100, 101, 102, 103, 104, 105, 106, 107, 108,
+    109, 110, 111, 112, 113, 114, 115, 116, 117, 118, 119, 120, 121, 122, 123, 124
+};
+
+#define MODE(name, table) {name, table, sizeof(table)}
+const NrfHopMode nrf_hop_modes[] = {
+    MODE("Test", test_channels),
+    MODE("WiFi", wifi_channels),
+    MODE("BLEch", ble_channels),
+    MODE("BLE Adv Pri", ble_adv_priority),
+    MODE("Bluetooth", bluetooth_channels),
+    MODE("USB", usb_channels),
+    MODE("Video Stream", video_channels),
+    MODE("RC", rc_channels),
+    MODE("Full", full_channels),
+};
+#undef MODE
+const uint8_t nrf_hop_mode_count = sizeof(nrf_hop_modes) / sizeof(nrf_hop_modes[0]);
+
+bool NrfHopEngine::setPlan(const uint8_t *channels, uint8_t count, uint32_t dwellUs) {
+    if (count == 0) return false;
+    if (count > NRF_HOP_MAX_CHANNELS) count = NRF_HOP_MAX_CHANNELS;
+    memcpy(table, channels, count);
+    tableLen = count;
+    pos = 0;
+    dwell = dwellUs < NRF_HOP_MIN_DWELL_US ? NRF_HOP_MIN_DWELL_US : dwellUs;
+    resetStats();
+    return true;
+}
+
+bool NrfHopEngine::setRange(uint8_t start, uint8_t stop, uint8_t step, uint32_t dwellUs) {
+    uint8_t channels[NRF_HOP_MAX_CHANNELS];
+    uint8_t count = 0;
+    if (step == 0) step = 1;
+    for (uint16_t ch = start; count == 0 || (ch <= stop && count < NRF_HOP_MAX_CHANNELS); ch += step) {
+        if (ch >= NRF_HOP_MAX_CHANNELS) break;
+        channels[count++] = ch;
+    }
+    return setPlan(channels, count, dwellUs);
+}
+
+void NrfHopEngine::resetStats() {
+    _stats = {};
+    hasLast = false;
+    windowHops = 0;
+    windowMin = UINT32_MAX;
+    windowMax = 0;
+    windowJitter = 0;
+}
+
+void NrfHopEngine::tick(uint32_t nowUs) {
+    if (tableLen == 0) return;
+    current = table[pos];
+    radio.setChannel(current);
+    if (++pos >= tableLen) pos = 0;
+
+    if (!hasLast) {
+        hasLast = true;
+        windowStart = nowUs;
+    } else {
+        uint32_t interval = nowUs - lastUs; // unsigned, survives the micros() wrap
+        if (interval < windowMin) windowMin = interval;
+        if (interval > windowMax) windowMax = interval;
+        uint32_t deviation = interval > dwell ? interval - dwell : dwell - interval;
+        if (deviation > windowJitter) windowJitter = deviation;
+        if (interval >= 2 * dwell) _stats.late++;
+        windowHops++;
+    }
+    lastUs = nowUs;
+    _stats.hops++;
+
+    uint32_t elapsed = nowUs - windowStart;
+    if (elapsed >= NRF_HOP_STATS_WINDOW_US) {
+        _stats.hopsPerSec = (uint32_t)((uint64_t)windowHops * 1000000ULL / elapsed);
+        _stats.dwellMinUs = windowHops ? windowMin : 0;
+        _stats.dwellMaxUs = windowMax;
+        _stats.jitterUs = windowJitter;
+        windowStart = nowUs;
+        windowHops = 0;
+        windowMin = UINT32_MAX;
+        windowMax = 0;
+        windowJitter = 0;
+    }
+}
+
+uint8_t nrfCrc8(const uint8_t *data, size_t len) {
+    uint8_t crc = 0;
+    while (len--) {
+        crc ^= *data++;
+        for (uint8_t i = 0; i < 8; i++) crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : crc << 1;
+    }
+    return crc;
+}
+
+size_t nrfFrameEncode(uint8_t cmd, const uint8_t *payload, size_t len, uint8_t *out) {
+    if (len > NRF_FRAME_MAX_PAYLOAD) return 0;
+    out[0] = NRF_FRAME_SYNC;
+    out[1] = cmd;
+    out[2] = len;
+    if (len) memcpy(&out[3], payload, len);
+    out[3 + len] = nrfCrc8(&out[1], len + 2);
+    return len + 4;
+}
+
+void NrfLink::sendFrame(uint8_t cmd, const uint8_t *payload, size_t len) {
+    uint8_t frame[NRF_FRAME_MAX];
+    size_t frameLen = nrfFrameEncode(cmd, payload, len, frame);
+    if (frameLen) port.write(frame, frameLen);
+}
+
+// CRLF like Serial.println(), which the text firmware was written against
+void NrfLink::sendLine(const char *text) {
+    port.write((const uint8_t *)text, strlen(text));
+    port.write((const uint8_t *)"\r\n", 2);
+}
+
+void NrfLink::query() {
+    sendFrame(NRF_CMD_QUERY, nullptr, 0);
+    sendLine(""); // ends the line the text firmware made of the frame
+    sendLine("RADIOS");
+}
+
+void NrfLink::plan(const uint8_t *channels, uint8_t count, uint32_t dwellUs, const char *legacy) {
+    if (!_binary) {
+        sendLine(legacy);
+        return;
+    }
+    if (count > NRF_HOP_MAX_CHANNELS) count = NRF_HOP_MAX_CHANNELS;
+    if (dwellUs > UINT16_MAX) dwellUs = UINT16_MAX;
+    uint8_t payload[NRF_FRAME_MAX_PAYLOAD];
+    payload[0] = dwellUs & 0xFF;
+    payload[1] = dwellUs >> 8;
+    memcpy(&payload[2], channels, count);
+    sendFrame(NRF_CMD_PLAN, payload, count + 2);
+}
+
+void NrfLink::channel(uint8_t channel) {
+    if (_binary) {
+        sendFrame(NRF_CMD_CHANNEL, &channel, 1);
+        return;
+    }
+    char text[8];
+    snprintf(text, sizeof(text), "CH_%u", channel);
+    sendLine(text);
+}
+
+void NrfLink::off() {
+    if (_binary) sendFrame(NRF_CMD_OFF, nullptr, 0);
+    else sendLine("OFF");
+}
+
+bool NrfLink::frameReceived() {
+    uint8_t check[2 + sizeof(rx)];
+    check[0] = rxCmd;
+    check[1] = rxLen;
+    memcpy(&check[2], rx, rxLen);
+    if (nrfCrc8(check, rxLen + 2) != rx[rxLen]) {
+        _badFrames++;
+        return false;
+    }
+    _binary = true;
+    if (rxCmd == NRF_CMD_RADIOS && rxLen == 1) {
+        _radios = rx[0];
+        return true;
+    }
+    return false;
+}
+
+bool NrfLink::lineReceived() {
+    uint8_t len = lineLen;
+    bool overflow = lineOverflow;
+    lineLen = 0;
+    lineOverflow = false;
+    while (len && (line[len - 1] == '\r' || line[len - 1] == ' ')) len--;
+    if (overflow || len != 1 || line[0] < '0' || line[0] > '9') return false;
+    _radios = line[0] - '0';
+    return true;
+}
+
+bool NrfLink::feed(uint8_t byte) {
+    switch (state) {
+        case RX_TEXT:
+            if (byte == NRF_FRAME_SYNC) {
+                lineLen = 0;
+                state = RX_CMD;
+            } else if (byte == '\n') {
+                return lineReceived();
+            } else if (lineLen < sizeof(line)) {
+                line[lineLen++] = byte;
+            } else {
+                lineOverflow = true;
+            }
+            return false;
+        case RX_CMD:
+            rxCmd = byte;
+            state = RX_LEN;
+            return false;
+        case RX_LEN:
+            rxLen = byte;
+            rxPos = 0;
+            if (rxLen >= sizeof(rx)) { // nothing that long is expected, resync on the next SYNC
+                _badFrames++;
+                state = RX_TEXT;
+                return false;
+            }
+            state = rxLen ? RX_PAYLOAD : RX_CRC;
+            return false;
+        case RX_PAYLOAD:
+            rx[rxPos++] = byte;
+            if (rxPos == rxLen) state = RX_CRC;
+            return false;
+        case RX_CRC:
+            rx[rxLen] = byte;
+            state = RX_TEXT;
+            return frameReceived();
+    }
+    return false;
+}
@@ -0,0 +1,147 @@
+#ifndef __NRF_HOP_H__
+#define __NRF_HOP_H__
+
+// Channel hopping for the NRF24 jammers, paced by a timer instead of the UI loop.
+// NrfHopEngine walks a channel table, one channel per tick(). The ticks come from a hardware timer
+// through a dedicated task, so the dwell on a channel is the timer period whatever the UI is doing,
+// and the tick timestamps give the measured hops/s and dwell jitter.
+// NrfLink sends the same plan to the UART co-processor in small binary frames, falling back to the
+// text lines of older co-processor firmware.
+// Nothing here depends on Arduino, a mock radio and a fake clock can drive it.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define NRF_HOP_MAX_CHANNELS 126
+#define NRF_HOP_MIN_DWELL_US 150 // nRF24 PLL settling is 130 us
+#define NRF_HOP_DEFAULT_DWELL_US 500
+#define NRF_HOP_STATS_WINDOW_US 1000000
+
+class NrfHopRadio {
+public:
+    virtual ~NrfHopRadio() {}
+    virtual void setChannel(uint8_t channel) = 0;
+};
+
+struct NrfHopMode {
+    const char *name;
+    const uint8_t *channels;
+    uint8_t count;
+};
+
+extern const NrfHopMode nrf_hop_modes[];
+extern const uint8_t nrf_hop_mode_count;
+
+struct NrfHopStats {
+    uint32_t hops;       // since the plan was set
+    uint32_t late;       // ticks that came two dwells or more after the previous one
+    uint32_t hopsPerSec; // over the last window, like the fields below
+    uint32_t dwellMinUs;
+    uint32_t dwellMaxUs;
+    uint32_t jitterUs; // largest distance between a measured dwell and the planned one
+};
+
+// Not thread safe, the caller serializes tick() and the setters
+class NrfHopEngine {
+public:
+    NrfHopEngine(NrfHopRadio &radio) : radio(radio) {}
+
+    // The table is copied. False when empty, the previous plan is kept then.
+    bool setPlan(const uint8_t *channels, uint8_t count, uint32_t dwellUs);
+    // start, start + step, ... up to stop. Only start when stop is below it.
+    bool setRange(uint8_t start, uint8_t stop, uint8_t step, uint32_t dwellUs);
+
+    // Moves to the next channel of the table, to be called every dwellUs()
+    void tick(uint32_t nowUs);
+
+    uint32_t dwellUs() const { return dwell; }
+    uint8_t channel() const { return current; }
+    uint8_t count() const { return tableLen; }
+    const uint8_t *channels() const { return table; }
+    const NrfHopStats &stats() const { return _stats; }
+
+private:
+    NrfHopRadio &radio;
+    uint8_t table[NRF_HOP_MAX_CHANNELS];
+    uint8_t tableLen = 0;
+    uint8_t pos = 0;
+    uint8_t current = 0;
+    uint32_t dwell = NRF_HOP_DEFAULT_DWELL_US;
+
+    NrfHopStats _stats = {};
+    bool hasLast = false;
+    uint32_t lastUs = 0;
+    uint32_t windowStart = 0;
+    uint32_t windowHops = 0;
+    uint32_t windowMin = 0;
+    uint32_t windowMax = 0;
+    uint32_t windowJitter = 0;
+
+    void resetStats();
+};
+
+// Co-processor framing: SYNC, command, payload length, payload, CRC-8 (poly 0x07) of command to payload
+#define NRF_FRAME_SYNC 0xA5
+#define NRF_FRAME_MAX_PAYLOAD (2 + NRF_HOP_MAX_CHANNELS)
+#define NRF_FRAME_MAX (NRF_FRAME_MAX_PAYLOAD + 4)
+
+enum NrfLinkCmd : uint8_t {
+    NRF_CMD_QUERY = 0x01,   // asks for the number of radios
+    NRF_CMD_PLAN = 0x02,    // dwell in us (16 bit little endian), then the channels
+    NRF_CMD_CHANNEL = 0x03, // constant carrier on one channel
+    NRF_CMD_OFF = 0x04,
+    NRF_CMD_RADIOS = 0x81, // reply to QUERY, one byte
+};
+
+uint8_t nrfCrc8(const uint8_t *data, size_t len);
+// Writes the frame into out (NRF_FRAME_MAX bytes) and returns its length, 0 if the payload is too long
+size_t nrfFrameEncode(uint8_t cmd, const uint8_t *payload, size_t len, uint8_t *out);
+
+class NrfLinkPort {
+public:
+    virtual ~NrfLinkPort() {}
+    virtual void write(const uint8_t *data, size_t len) = 0;
+};
+
+// Talks binary once the co-processor has answered a QUERY with a frame, text lines until then
+class NrfLink {
+public:
+    NrfLink(NrfLinkPort &port) : port(port) {}
+
+    // Sends a QUERY frame and the "RADIOS" line, the old firmware skips the frame as a bad line
+    void query();
+    // Feed every received byte, true when the radio count just arrived
+    bool feed(uint8_t byte);
+
+    int8_t radios() const { return _radios; } // -1 until the co-processor answered
+    bool binary() const { return _binary; }
+    uint16_t badFrames() const { return _badFrames; }
+
+    // legacy is the line the text firmware understands, like "WiFi" or "HOPPER_0_80_2"
+    void plan(const uint8_t *channels, uint8_t count, uint32_t dwellUs, const char *legacy);
+    void channel(uint8_t channel);
+    void off();
+
+private:
+    NrfLinkPort &port;
+    int8_t _radios = -1;
+    bool _binary = false;
+    uint16_t _badFrames = 0;
+
+    enum RxState : uint8_t { RX_TEXT, RX_CMD, RX_LEN, RX_PAYLOAD, RX_CRC };
+    RxState state = RX_TEXT;
+    uint8_t rxCmd = 0;
+    uint8_t rxLen = 0;
+    uint8_t rxPos = 0;
+    uint8_t rx[8];
+    char line[8];
+    uint8_t lineLen = 0;
+    bool lineOverflow = false;
+
+    void sendFrame(uint8_t cmd, const uint8_t *payload, size_t len);
+    void sendLine(const char *text);
+    bool frameReceived();
+    bool lineReceived();
+};
+
+#endif
@@ -1,252 +1,355 @@
 #include "nrf_jammer.h"
 #include "core/display.h"
 #include "core/mykeyboard.h"
+#include "core/powerSave.h"
+#include "core/profiler.h"
 #include "nrf_common.h"
+#include "nrf_hop.h"
 #include <globals.h>
 
-void nrf_jammer() {
-    int OnX = 0;
-    NRF24_MODE mode = nrf_setMode();
-    int NRFOnline = 1;
-    
-    byte Test_channels[] = {50, 52, 54, 56, 58, 60, 62, 64, 66, 68, 70, 72, 74, 76, 78, 80, 2,  4,  6,  8,
-                            10, 12, 14, 16, 18, 20, 22, 24, 26, 28, 30, 32, 34, 36, 38, 40, 42, 44, 46, 48};
-
-    byte wifi_channels[] = {2, 7, 12, 17, 22, 27, 32, 37, 42, 47, 52, 57, 62, 67, 72, 77};
-    
-    byte ble_channels[] = {2,  3,  4,  5,  6,  7,  8,  9,  10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21,
-                           22, 23, 24, 25, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40, 41};
-
-    byte ble_adv_priority[] = {37, 38, 39, 1, 2, 3, 25, 26, 27, 79, 80, 81};
-
-    byte bluetooth_channels[] = {2,  3,  4,  5,  6,  7,  8,  9,  10, 11, 12, 13, 14, 15, 16, 17,
-                                 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31, 32, 33,
-                                 34, 35, 36, 37, 38, 39, 40, 41, 42, 43, 44, 45, 46, 47, 48, 49,
-                                 50, 51, 52, 53, 54, 55, 56, 57, 58, 59, 60, 61, 62, 63, 64, 65,
-                                 66, 67, 68, 69, 70, 71, 72, 73, 74, 75, 76, 77, 78, 79, 80};
-    byte usb_channels[] = {40, 50, 60};
-    byte video_channels[] = {70, 75, 80};
-    byte rc_channels[] = {1, 3, 5, 7};
-    
-    byte full_channels[] = {1,   2,   3,   4,   5,   6,   7,   8,   9,   10,  11,  12,  13,  14,  15,  16,
-                            17,  18,  19,  20,  21,  22,  23,  24,  25,  26,  27,  28,  29,  30,  31,  32,
-                            33,  34,  35,  36,  37,  38,  39,  40,  41,  42,  43,  44,  45,  46,  47,  48,
-                            49,  50,  51,  52,  53,  54,  55,  56,  57,  58,  59,  60,  61,  62,  63,  64,
-                            65,  66,  67,  68,  69,  70,  71,  72,  73,  74,  75,  76,  77,  78,  79,  80,
-                            81,  82,  83,  84,  85,  86,  87,  88,  89,  90,  91,  92,  93,  94,  95,  96,
-                            97,  98,  99,  100, 101, 102, 103, 104, 105, 106, 107, 108, 109, 110, 111, 112,
-                            113, 114, 115, 116, 117, 118, 119, 120, 121, 122, 123, 124};
-
-    struct jamMode {
-        const char *name;
-        byte *channels;
-        size_t count;
-    };
-    
-    jamMode modes[] = {
-        {"Test        ", Test_channels,      sizeof(Test_channels)/sizeof(Test_channels[0])},
-        {"WiFi        ", wifi_channels,      sizeof(wifi_channels)/sizeof(wifi_channels[0])},
-        {"BLEch       ", ble_channels,       sizeof(ble_channels)/sizeof(ble_channels[0])},
-        {"BLE Adv Pri ", ble_adv_priority,   sizeof(ble_adv_priority)/sizeof(ble_adv_priority[0])},
-        {"Bluetooth   ", bluetooth_channels, sizeof(bluetooth_channels)/sizeof(bluetooth_channels[0])},
-        {"USB         ", usb_channels,       sizeof(usb_channels)/sizeof(usb_channels[0])},
-        {"Video Stream", video_channels,     sizeof(video_channels)/sizeof(video_channels[0])},
-        {"RC          ", rc_channels,        sizeof(rc_channels)/sizeof(rc_channels[0])},
-        {"Full        ", full_channels,      sizeof(full_channels)/sizeof(full_channels[0])}
-    };
-
-    if (nrf_start(mode)) {
-
-        int modeIndex = 0;
-        int hopIndex = 0;
-        bool redraw = true;
-        if (CHECK_NRF_SPI(mode)) {
-            NRFradio.setPALevel(RF24_PA_MAX);
-            NRFradio.startConstCarrier(RF24_PA_MAX, 50);
-            NRFradio.setAddressWidth(5);
-            NRFradio.setPayloadSize(2);
-            if (!NRFradio.setDataRate(RF24_2MBPS)) ;
-        }
+#define NRF_HOP_TASK_STACK 3072
+#define NRF_HOP_TASK_PRIORITY 3 // above the UI loop
+#define NRF_HOP_TASK_CORE 0
+#define NRF_QUERY_INTERVAL_MS 250 // RADIOS is asked again until the co-processor answers
+
+static const uint32_t dwellPresets[] = {250, 500, 1000, 2000, 5000};
+
+class Rf24HopRadio : public NrfHopRadio {
+public:
+    void setChannel(uint8_t channel) override { NRFradio.setChannel(channel); }
+};
+
+class NrfSerialPort : public NrfLinkPort {
+public:
+    void write(const uint8_t *data, size_t len) override { NRFSerial.write(data, len); }
+};
+
+static Rf24HopRadio hopRadio;
+static NrfHopEngine hopEngine(hopRadio);
+static NrfSerialPort linkPort;
+
+// The hop task owns the engine while it runs, everything else goes through hopLock. The lock also
+// keeps the display off the SPI bus during a hop when both share it.
+static SemaphoreHandle_t hopLock = NULL;
+static TaskHandle_t volatile hopTask = NULL;
+static hw_timer_t *hopTimer = NULL;
+static volatile bool hopRunning = false;
+static bool hopSharedBus = false;
+
+static void IRAM_ATTR hopTimerIsr() {
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(hopTask, &woken);
+    if (woken) portYIELD_FROM_ISR();
+}
 
-        drawMainBorder();
+static void hopTaskLoop(void *) {
+    while (hopRunning) {
+        // ticks that piled up while the task could not run are a single hop, counted as late
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        if (!hopRunning) break;
+        xSemaphoreTake(hopLock, portMAX_DELAY);
+        hopEngine.tick(micros());
+        xSemaphoreGive(hopLock);
+    }
+    hopTask = NULL;
+    vTaskDelete(NULL);
+}
 
-        NRFSerial.println("RADIOS");
-        vTaskDelay(50 / portTICK_PERIOD_MS);
+static void hopStop() {
+    if (hopTimer) {
+        timerEnd(hopTimer);
+        hopTimer = NULL;
+        powerRelease();
+    }
+    hopSharedBus = false;
+    if (!hopTask) return;
+    hopRunning = false;
+    xTaskNotifyGive(hopTask);
+    while (hopTask) vTaskDelay(1);
+}
 
-        while (!check(SelPress)) {
+// Hops on the SPI radio with the plan already set in hopEngine
+static bool hopStart() {
+    if (!hopLock) hopLock = xSemaphoreCreateMutex();
+#if TFT_MOSI > 0
+    hopSharedBus = NRFSPI == &tft.getSPIinstance();
+#endif
+    hopRunning = true;
+    TaskHandle_t task = NULL;
+    profilerTaskStack("nrf_hop", NRF_HOP_TASK_STACK);
+    if (xTaskCreatePinnedToCore(
+            hopTaskLoop, "nrf_hop", NRF_HOP_TASK_STACK, NULL, NRF_HOP_TASK_PRIORITY, &task, NRF_HOP_TASK_CORE
+        ) != pdPASS) {
+        hopRunning = false;
+        return false;
+    }
+    hopTask = task;
+    hopTimer = timerBegin(1000000);
+    if (!hopTimer) {
+        hopStop();
+        return false;
+    }
+    timerAttachInterrupt(hopTimer, &hopTimerIsr);
+    timerAlarm(hopTimer, hopEngine.dwellUs(), true, 0);
+    powerHold(); // hop timing is the whole point, released with the timer in hopStop()
+    return true;
+}
 
-            if ((CHECK_NRF_UART(mode)) || (CHECK_NRF_BOTH(mode))) {
+static void hopTake() {
+    if (hopLock) xSemaphoreTake(hopLock, portMAX_DELAY);
+}
 
-                if (OnX == 0) {
-                    NRFSerial.println("RADIOS");
-                    vTaskDelay(250 / portTICK_PERIOD_MS);
-                }
+static void hopGive() {
+    if (hopLock) xSemaphoreGive(hopLock);
+}
 
-                if (NRFSerial.available()) {
-                    String incomingNRFs = NRFSerial.readStringUntil('\n');
-                    incomingNRFs.trim();
-                    if (incomingNRFs.length() == 1 && isDigit(incomingNRFs.charAt(0))) {
-                        OnX = 1;
-                            NRFOnline = (incomingNRFs.toInt());
-                        if (CHECK_NRF_BOTH(mode)) {
-                            NRFOnline = (incomingNRFs.toInt()) + 1;
-                        }
-                        redraw = true;
-                    }
-                }
-            }
+static void hopPlan(const uint8_t *channels, uint8_t count, uint32_t dwellUs) {
+    hopTake();
+    hopEngine.setPlan(channels, count, dwellUs);
+    hopGive();
+    if (hopTimer) timerAlarm(hopTimer, hopEngine.dwellUs(), true, 0);
+}
 
-            if (redraw) {
-                tft.setCursor(10, 35);
-                tft.setTextSize(FM);
-                tft.println("NRF X Jammer");
-                tft.setCursor(10, tft.getCursorY() + 25);
-                tft.println("STATUS : " + String(NRFOnline) + " ACTIVE");
-                tft.setCursor(10, 100);
-                tft.fillRect(10, 100, tftWidth - 20, FM * LH, bruceConfig.bgColor);
-                tft.print("MODE : " + String(modes[modeIndex].name));
-                tft.drawRoundRect(5, 5, tftWidth - 10, tftHeight - 10, 5, bruceConfig.priColor);
-                if ((CHECK_NRF_UART(mode)) || (CHECK_NRF_BOTH(mode))) {
-                    String Mode = modes[modeIndex].name;
-                    Mode.replace(" " ,"");
-                    NRFSerial.println(Mode);
-                }
-                redraw = false;
-                vTaskDelay(200 / portTICK_PERIOD_MS);
-            }
+static NrfHopStats hopStats() {
+    hopTake();
+    NrfHopStats stats = hopEngine.stats();
+    hopGive();
+    return stats;
+}
 
-            hopIndex++;
-            if (hopIndex >= modes[modeIndex].count) hopIndex = 0;
-            if (CHECK_NRF_SPI(mode)) { NRFradio.setChannel(modes[modeIndex].channels[hopIndex]); }
+// Drawing waits for the hop in progress when the radio is on the display bus
+static void drawBegin() {
+    if (hopSharedBus) hopTake();
+}
 
-            if (check(NextPress)) {
-                modeIndex++;
-                if (modeIndex >= (int)(sizeof(modes) / sizeof(modes[0]))) modeIndex = 0;
-                hopIndex = 0;
-                redraw = true;
-            }
-            if (check(PrevPress)) {
-                modeIndex--;
-                if (modeIndex < 0) modeIndex = (sizeof(modes) / sizeof(modes[0])) - 1;
-                hopIndex = 0;
-                redraw = true;
-            }
-        }
+static void drawEnd() {
+    if (hopSharedBus) hopGive();
+}
 
-        if (CHECK_NRF_SPI(mode)) NRFradio.stopConstCarrier();
-        if ((CHECK_NRF_UART(mode)) || (CHECK_NRF_BOTH(mode))) {
-             NRFSerial.println("OFF");
-        }
+// Reads whatever the co-processor sent, true when it just told how many radios it has
+static bool pollLink(NrfLink &link, NRF24_MODE mode, uint32_t &lastQuery) {
+    if (!CHECK_NRF_UART(mode)) return false;
+    bool answered = false;
+    while (NRFSerial.available()) answered |= link.feed(NRFSerial.read());
+    if (link.radios() < 0 && millis() - lastQuery >= NRF_QUERY_INTERVAL_MS) {
+        link.query();
+        lastQuery = millis();
+    }
+    return answered;
+}
 
-    } else {
-        displayError("NRF24 not found");
-        vTaskDelay(500 / portTICK_PERIOD_MS);
+static int activeRadios(const NrfLink &link, NRF24_MODE mode) {
+    int radios = CHECK_NRF_SPI(mode) ? 1 : 0;
+    if (CHECK_NRF_UART(mode) && link.radios() > 0) radios += link.radios();
+    return radios;
+}
+
+static String dwellLabel(uint32_t us) { return us >= 1000 ? String(us / 1000) + " ms" : String(us) + " us"; }
+
+static uint32_t dwellMenu() {
+    uint32_t dwell = NRF_HOP_DEFAULT_DWELL_US;
+    int index = 0;
+    options = {};
+    for (size_t i = 0; i < sizeof(dwellPresets) / sizeof(dwellPresets[0]); i++) {
+        uint32_t us = dwellPresets[i];
+        if (us == NRF_HOP_DEFAULT_DWELL_US) index = i;
+        options.push_back({dwellLabel(us), [&dwell, us]() { dwell = us; }});
     }
+    loopOptions(options, MENU_TYPE_SUBMENU, "Dwell", index);
+    options.clear();
+    return dwell;
 }
 
-void nrf_channel_jammer() {
-    int OnX = 0;
+static uint32_t nextDwell(uint32_t dwell, int dir) {
+    const int count = sizeof(dwellPresets) / sizeof(dwellPresets[0]);
+    int i = 0;
+    while (i < count - 1 && dwellPresets[i] < dwell) i++;
+    return dwellPresets[(i + dir + count) % count];
+}
+
+static void drawHopStats(int y, NRF24_MODE mode) {
+    tft.setTextSize(FP);
+    tft.fillRect(10, y, tftWidth - 20, 2 * LH * FP, bruceConfig.bgColor);
+    tft.setCursor(10, y);
+    if (!CHECK_NRF_SPI(mode)) {
+        tft.print("Hopping on the co-processor");
+        return;
+    }
+    NrfHopStats stats = hopStats();
+    tft.printf("Hops/s: %lu  late: %lu", stats.hopsPerSec, stats.late);
+    tft.setCursor(10, y + LH * FP);
+    tft.printf("Dwell: %lu-%lu us  jitter: %lu us", stats.dwellMinUs, stats.dwellMaxUs, stats.jitterUs);
+}
+
+// The text firmware knows the modes by name, without spaces
+static void sendMode(NrfLink &link, const NrfHopMode &jamMode, uint32_t dwell) {
+    char legacy[16];
+    size_t len = 0;
+    for (const char *c = jamMode.name; *c && len < sizeof(legacy) - 1; c++)
+        if (*c != ' ') legacy[len++] = *c;
+    legacy[len] = '\0';
+    link.plan(jamMode.channels, jamMode.count, dwell, legacy);
+}
+
+void nrf_jammer() {
     NRF24_MODE mode = nrf_setMode();
-    uint8_t NRFOnline = 1;
-    uint8_t NRFSPI = 0;
-    if (nrf_start(mode)) {
-
-        int channel = 50;
-        bool redraw = true;
-        if (CHECK_NRF_SPI(mode)) {
-            NRFradio.setPALevel(RF24_PA_MAX);
-            NRFradio.startConstCarrier(RF24_PA_MAX, channel);
-            NRFradio.setAddressWidth(3);
-            NRFradio.setPayloadSize(2);
-            if (!NRFradio.setDataRate(RF24_2MBPS)) ;
-            NRFSPI = 1;
-        }
+    NrfLink link(linkPort);
 
-        drawMainBorder();
-        vTaskDelay(50 / portTICK_PERIOD_MS);
-        NRFSerial.println("RADIOS");
-        vTaskDelay(50 / portTICK_PERIOD_MS);
-
-        while (!check(SelPress)) {
-            if (CHECK_NRF_UART(mode) || CHECK_NRF_BOTH(mode)) {
-                if (OnX == 0) {
-                    NRFSerial.println("RADIOS");
-                    vTaskDelay(250 / portTICK_PERIOD_MS);
-                }
-                if (NRFSerial.available()) {
-                    String incomingNRFs = NRFSerial.readStringUntil('\n');
-                    incomingNRFs.trim();
-                    if (incomingNRFs.length() == 1 && isDigit(incomingNRFs.charAt(0))) {
-
-                        NRFOnline = (incomingNRFs.toInt());
-                        if (CHECK_NRF_BOTH(mode)) {
-                            NRFOnline = (incomingNRFs.toInt()) + NRFSPI;
-                        }
-                        redraw = true;
-                        OnX = 1;
-                    }
-                }
-            }
+    if (!nrf_start(mode)) {
+        displayError("NRF24 not found");
+        vTaskDelay(500 / portTICK_PERIOD_MS);
+        return;
+    }
+    uint32_t dwell = dwellMenu();
 
-            if (redraw) {
-                int freq = 2400 + channel;
-                tft.setCursor(10, 35);
-                tft.setTextSize(FM);
-                tft.println("NRF Channel Jammer");
-                tft.setCursor(10, tft.getCursorY() + 25);
-                tft.println("STATUS : " + String(NRFOnline) + " ACTIVE");
-                tft.fillRect(10, 100, tftWidth - 20, FM * LH, bruceConfig.bgColor);
-                tft.setCursor(10, 100);
-                tft.print("MODE : CH " + String(channel));
-                tft.setCursor(10, 116);
-                tft.fillRect(10, 116, tftWidth - 20, FM * LH, bruceConfig.bgColor);
-                tft.printf("Freq : %d MHz", freq);
-                if (CHECK_NRF_UART(mode) || CHECK_NRF_BOTH(mode)) {
-                     NRFSerial.println("CH_"+String(channel));
-                }
-                tft.drawRoundRect(5, 5, tftWidth - 10, tftHeight - 10, 5, bruceConfig.priColor);
-                redraw = false;
-                vTaskDelay(200 / portTICK_PERIOD_MS);
-            }
+    int modeIndex = 0;
+    const NrfHopMode *jamMode = &nrf_hop_modes[modeIndex];
+    if (CHECK_NRF_SPI(mode)) {
+        NRFradio.setPALevel(RF24_PA_MAX);
+        NRFradio.startConstCarrier(RF24_PA_MAX, 50);
+        NRFradio.setAddressWidth(5);
+        NRFradio.setPayloadSize(2);
+        NRFradio.setDataRate(RF24_2MBPS);
+        hopPlan(jamMode->channels, jamMode->count, dwell);
+        if (!hopStart()) {
+            NRFradio.stopConstCarrier();
+            displayError("Hop timer failed", true);
+            return;
+        }
+    }
 
-            if (check(NextPress)) {
+    drawBegin();
+    drawMainBorder();
+    drawEnd();
+    uint32_t lastQuery = 0;
+    uint32_t lastStats = 0;
+    bool redraw = true;
+    bool modeChanged = true;
 
-                channel++;
-                if (channel > 125) channel = 1;
-                if (CHECK_NRF_SPI(mode)) {
-                    NRFradio.setChannel(channel);
-                    NRFradio.startConstCarrier(RF24_PA_MAX, channel);
-                }
+    while (!check(SelPress)) {
+        if (pollLink(link, mode, lastQuery)) {
+            modeChanged = true; // the co-processor is up, resend (as a frame if it answered in binary)
+            redraw = true;
+        }
+        // Old text firmware may never answer RADIOS, so the mode goes out as a line right away
+        if (modeChanged) {
+            if (CHECK_NRF_UART(mode)) sendMode(link, *jamMode, dwell);
+            modeChanged = false;
+        }
 
-                redraw = true;
-            }
-            if (check(PrevPress)) {
-
-                channel--;
-                if (channel < 1) channel = 125;
-                if (CHECK_NRF_SPI(mode)) {
-                    NRFradio.setChannel(channel);
-                    NRFradio.startConstCarrier(RF24_PA_MAX, channel);
-                }
-                redraw = true;
-            }
+        if (redraw) {
+            drawBegin();
+            tft.setCursor(10, 35);
+            tft.setTextSize(FM);
+            tft.println("NRF X Jammer");
+            tft.setCursor(10, tft.getCursorY() + 25);
+            tft.println("STATUS : " + String(activeRadios(link, mode)) + " ACTIVE");
+            tft.fillRect(10, 100, tftWidth - 20, FM * LH, bruceConfig.bgColor);
+            tft.setCursor(10, 100);
+            tft.print("MODE : " + String(jamMode->name));
+            tft.drawRoundRect(5, 5, tftWidth - 10, tftHeight - 10, 5, bruceConfig.priColor);
+            drawEnd();
+            redraw = false;
+        }
+        if (millis() - lastStats >= 1000) {
+            drawBegin();
+            drawHopStats(100 + FM * LH + 4, mode);
+            drawEnd();
+            lastStats = millis();
         }
 
-        if (CHECK_NRF_SPI(mode)) NRFradio.stopConstCarrier();
-        if (CHECK_NRF_UART(mode) || CHECK_NRF_BOTH(mode)) {
-            NRFSerial.println("OFF");
+        int step = 0;
+        if (check(NextPress)) step = 1;
+        if (check(PrevPress)) step = -1;
+        if (step) {
+            modeIndex = (modeIndex + step + nrf_hop_mode_count) % nrf_hop_mode_count;
+            jamMode = &nrf_hop_modes[modeIndex];
+            if (CHECK_NRF_SPI(mode)) hopPlan(jamMode->channels, jamMode->count, dwell);
+            modeChanged = true;
+            redraw = true;
         }
+        vTaskDelay(20 / portTICK_PERIOD_MS);
+    }
+
+    hopStop();
+    if (CHECK_NRF_SPI(mode)) NRFradio.stopConstCarrier();
+    if (CHECK_NRF_UART(mode)) link.off();
+}
 
-    } else {
+void nrf_channel_jammer() {
+    NRF24_MODE mode = nrf_setMode();
+    NrfLink link(linkPort);
+    if (!nrf_start(mode)) {
         displayError("NRF24 not found");
         vTaskDelay(500 / portTICK_PERIOD_MS);
+        return;
+    }
+
+    int channel = 50;
+    if (CHECK_NRF_SPI(mode)) {
+        NRFradio.setPALevel(RF24_PA_MAX);
+        NRFradio.startConstCarrier(RF24_PA_MAX, channel);
+        NRFradio.setAddressWidth(3);
+        NRFradio.setPayloadSize(2);
+        NRFradio.setDataRate(RF24_2MBPS);
+    }
+
+    drawMainBorder();
+    uint32_t lastQuery = 0;
+    bool redraw = true;
+    bool channelChanged = true;
+
+    while (!check(SelPress)) {
+        if (pollLink(link, mode, lastQuery)) {
+            channelChanged = true;
+            redraw = true;
+        }
+        if (channelChanged) {
+            if (CHECK_NRF_UART(mode)) link.channel(channel);
+            channelChanged = false;
+        }
+
+        if (redraw) {
+            int freq = 2400 + channel;
+            tft.setCursor(10, 35);
+            tft.setTextSize(FM);
+            tft.println("NRF Channel Jammer");
+            tft.setCursor(10, tft.getCursorY() + 25);
+            tft.println("STATUS : " + String(activeRadios(link, mode)) + " ACTIVE");
+            tft.fillRect(10, 100, tftWidth - 20, FM * LH, bruceConfig.bgColor);
+            tft.setCursor(10, 100);
+            tft.print("MODE : CH " + String(channel));
+            tft.setCursor(10, 116);
+            tft.fillRect(10, 116, tftWidth - 20, FM * LH, bruceConfig.bgColor);
+            tft.printf("Freq : %d MHz", freq);
+            tft.drawRoundRect(5, 5, tftWidth - 10, tftHeight - 10, 5, bruceConfig.priColor);
+            redraw = false;
+        }
+
+        int step = 0;
+        if (check(NextPress)) step = 1;
+        if (check(PrevPress)) step = -1;
+        if (step) {
+            channel += step;
+            if (channel > 125) channel = 1;
+            if (channel < 1) channel = 125;
+            if (CHECK_NRF_SPI(mode)) {
+                NRFradio.setChannel(channel);
+                NRFradio.startConstCarrier(RF24_PA_MAX, channel);
+            }
+            channelChanged = true;
+            redraw = true;
+        }
+        vTaskDelay(20 / portTICK_PERIOD_MS);
     }
+
+    if (CHECK_NRF_SPI(mode)) NRFradio.stopConstCarrier();
+    if (CHECK_NRF_UART(mode)) link.off();
 }
 
 void nrf_channel_hopper() {
     NRF24_MODE mode = nrf_setMode();
-    uint8_t NRFOnline = 0;
-    uint8_t NRFSPI = 0;
+    NrfLink link(linkPort);
 
     if (!nrf_start(mode)) {
         displayError("NRF24 not found");
@@ -254,42 +357,19 @@ void nrf_channel_hopper() {
         return;
     }
 
-    if (CHECK_NRF_SPI(mode)) {
-        NRFradio.setPALevel(RF24_PA_MAX);
-        NRFradio.startConstCarrier(RF24_PA_MAX, 50);
-        if (!NRFradio.setDataRate(RF24_2MBPS)) ;
-        NRFSPI = 1;
-    }
-
     int startChannel = 0;
     int stopChannel = 80;
     int stepSize = 2;
+    uint32_t dwell = NRF_HOP_DEFAULT_DWELL_US;
 
+    const int menuItems = 6;
     int menuIndex = 0;
     bool redraw = true;
     bool editMode = false;
+    uint32_t lastQuery = 0;
 
-    bool runJammer = false;
-    bool hopmenu = true;
-
-    vTaskDelay(350 / portTICK_PERIOD_MS);
-    NRFSerial.println("RADIOS");
-    vTaskDelay(100 / portTICK_PERIOD_MS);
-
-    while (hopmenu) {
-        if (CHECK_NRF_UART(mode) || CHECK_NRF_BOTH(mode)) {
-            if (NRFSerial.available()) {
-                String incomingNRFs = NRFSerial.readStringUntil('\n');
-                incomingNRFs.trim();
-                if (incomingNRFs.length() == 1 && isDigit(incomingNRFs.charAt(0))) {
-                    NRFOnline = (incomingNRFs.toInt());
-                    if (CHECK_NRF_BOTH(mode)) {
-                         NRFOnline = (incomingNRFs.toInt()) + NRFSPI;
-                    }
-                    redraw = true;
-                }
-            }
-        }
+    while (true) {
+        if (pollLink(link, mode, lastQuery)) redraw = true;
 
         if (redraw) {
             drawMainBorder();
@@ -303,88 +383,83 @@ void nrf_channel_hopper() {
             tft.setCursor(10, 110);
             tft.printf("Step  : %d mhz", stepSize);
             tft.setCursor(10, 130);
-            tft.print("Start Jammer");
+            tft.print("Dwell : " + dwellLabel(dwell));
             tft.setCursor(10, 150);
+            tft.print("Start Jammer");
+            tft.setCursor(10, 170);
             tft.print("Exit");
-
-            int yHighlight;
-            if (menuIndex == 0) yHighlight = 70;
-            if (menuIndex == 1) yHighlight = 90;
-            if (menuIndex == 2) yHighlight = 110;
-            if (menuIndex == 3) yHighlight = 130;
-            if (menuIndex == 4) yHighlight = 150;
-
-            tft.drawRect(5, yHighlight - 2, tftWidth - 10, 18, bruceConfig.priColor);
-            if (CHECK_NRF_UART(mode) || CHECK_NRF_BOTH(mode)) {
-                 NRFSerial.println("HOPPER_" + String(startChannel) + "_" + String(stopChannel) + "_" + String(stepSize));
-            }
+            tft.drawRect(5, 70 + 20 * menuIndex - 2, tftWidth - 10, 18, bruceConfig.priColor);
             redraw = false;
         }
 
-        if (check(EscPress)) {
-            hopmenu = false;
-            return;
-        }
+        if (check(EscPress)) return;
 
-        if (check(NextPress)) {
+        int dir = 0;
+        if (check(NextPress)) dir = 1;
+        if (check(PrevPress)) dir = -1;
+        if (dir) {
             if (editMode) {
-                if (menuIndex == 0) startChannel = (startChannel % 125) + 1;
-                if (menuIndex == 1) stopChannel = (stopChannel % 125) + 1;
-                if (menuIndex == 2) stepSize = (stepSize % 10) + 1;
+                if (menuIndex == 0) startChannel = (startChannel - 1 + dir + 125) % 125 + 1;
+                if (menuIndex == 1) stopChannel = (stopChannel - 1 + dir + 125) % 125 + 1;
+                if (menuIndex == 2) stepSize = (stepSize - 1 + dir + 10) % 10 + 1;
+                if (menuIndex == 3) dwell = nextDwell(dwell, dir);
             } else {
-                menuIndex = (menuIndex + 1) % 5;
+                menuIndex = (menuIndex + dir + menuItems) % menuItems;
             }
             redraw = true;
-            vTaskDelay(150 / portTICK_PERIOD_MS);
-        }
-
-        if (check(PrevPress)) {
-            if (editMode) {
-                if (menuIndex == 0) startChannel = (startChannel - 2 + 125) % 125 + 1;
-                if (menuIndex == 1) stopChannel = (stopChannel - 2 + 125) % 125 + 1;
-                if (menuIndex == 2) stepSize = (stepSize - 2 + 10) % 10 + 1;
-            } else {
-                menuIndex = (menuIndex - 1 + 5) % 5;
-            }
-            redraw = true;
-            vTaskDelay(150 / portTICK_PERIOD_MS);
         }
 
         if (check(SelPress)) {
-            if (menuIndex == 3 && !editMode) {
-                runJammer = true;
-                hopmenu = false;
-            } else if (menuIndex == 4 && !editMode) {
-                hopmenu = false;
-                return;
-            } else {
-                if (menuIndex < 3) editMode = !editMode;
-            }
+            if (menuIndex == 4 && !editMode) break;
+            if (menuIndex == 5 && !editMode) return;
+            editMode = !editMode;
             redraw = true;
-            vTaskDelay(150 / portTICK_PERIOD_MS);
         }
+        vTaskDelay(20 / portTICK_PERIOD_MS);
     }
 
-    if (runJammer) {
-        int channel = startChannel;
-        drawMainBorder();
-        tft.setCursor(10, 35);
-        tft.setTextSize(FM);
-        tft.println("NRF Hopper Jammer");
-        tft.setCursor(10, 70);
-        tft.println("STATUS : " + String(NRFOnline) + " ACTIVE");
-        tft.setCursor(10, 90);
-        tft.printf("Range : %d - %d", startChannel, stopChannel);
-        tft.setCursor(10, 110);
-        tft.printf("Step  : %d", stepSize);
-
-        while (!check(EscPress)) {
-            channel += stepSize;
-            if (channel > stopChannel) channel = startChannel;
-            if (CHECK_NRF_SPI(mode)) NRFradio.setChannel(channel);
+    hopEngine.setRange(startChannel, stopChannel, stepSize, dwell);
+    if (CHECK_NRF_SPI(mode)) {
+        NRFradio.setPALevel(RF24_PA_MAX);
+        NRFradio.startConstCarrier(RF24_PA_MAX, hopEngine.channels()[0]);
+        NRFradio.setDataRate(RF24_2MBPS);
+        if (!hopStart()) {
+            NRFradio.stopConstCarrier();
+            displayError("Hop timer failed", true);
+            return;
         }
+    }
+    if (CHECK_NRF_UART(mode)) {
+        char legacy[24];
+        snprintf(legacy, sizeof(legacy), "HOPPER_%d_%d_%d", startChannel, stopChannel, stepSize);
+        link.plan(hopEngine.channels(), hopEngine.count(), hopEngine.dwellUs(), legacy);
+    }
 
-        if (CHECK_NRF_SPI(mode)) NRFradio.stopConstCarrier();
-        if (CHECK_NRF_UART(mode) || CHECK_NRF_BOTH(mode)) NRFSerial.println("OFF");
+    drawBegin();
+    drawMainBorder();
+    tft.setCursor(10, 35);
+    tft.setTextSize(FM);
+    tft.println("NRF Hopper Jammer");
+    tft.setCursor(10, 70);
+    tft.println("STATUS : " + String(activeRadios(link, mode)) + " ACTIVE");
+    tft.setCursor(10, 90);
+    tft.printf("Range : %d - %d", startChannel, stopChannel);
+    tft.setCursor(10, 110);
+    tft.printf("Step  : %d  Dwell : %s", stepSize, dwellLabel(dwell).c_str());
+    drawEnd();
+
+    uint32_t lastStats = 0;
+    while (!check(EscPress)) {
+        if (millis() - lastStats >= 1000) {
+            drawBegin();
+            drawHopStats(130, mode);
+            drawEnd();
+            lastStats = millis();
+        }
+        vTaskDelay(20 / portTICK_PERIOD_MS);
     }
+
+    hopStop();
+    if (CHECK_NRF_SPI(mode)) NRFradio.stopConstCarrier();
+    if (CHECK_NRF_UART(mode)) link.off();
 }
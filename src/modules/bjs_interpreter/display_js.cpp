@@ -5,6 +5,12 @@
 #include "helpers_js.h"
 #include "stdio.h"
 #include <vector>
+#if defined(HAS_SCREEN)
+#include <esp_heap_caps.h>
+#endif
+
+static void putPropDrawCommandCodes(duk_context *ctx, duk_idx_t obj_idx);
+static void clearFrameData();
 
 duk_ret_t putPropDisplayFunctions(duk_context *ctx, duk_idx_t obj_idx, uint8_t magic) {
     bduk_put_prop_c_lightfunc(ctx, obj_idx, "color", native_color, 4, magic);
@@ -40,6 +46,10 @@ duk_ret_t putPropDisplayFunctions(duk_context *ctx, duk_idx_t obj_idx, uint8_t m
     bduk_put_prop_c_lightfunc(ctx, obj_idx, "getBrightness", native_getBrightness, 0, magic);
     bduk_put_prop_c_lightfunc(ctx, obj_idx, "setBrightness", native_setBrightness, 2, magic);
     bduk_put_prop_c_lightfunc(ctx, obj_idx, "restoreBrightness", native_restoreBrightness, 0, magic);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "drawCommands", native_drawCommands, 2, magic);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "present", native_present, 2, magic);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "frameStats", native_frameStats, 0, magic);
+    if (magic == 0) putPropDrawCommandCodes(ctx, obj_idx);
 
     return 0;
 }
@@ -485,6 +495,7 @@ void clearGifsVector() {
 void clearDisplayModuleData() {
     clearGifsVector();
     clearSpritesVector();
+    clearFrameData();
 }
 
 duk_ret_t native_gifPlayFrame(duk_context *ctx) {
@@ -696,6 +707,340 @@ duk_ret_t native_createSprite(duk_context *ctx) {
     return 1;
 }
 
+/*********************************************************************
+**  Batched drawing
+**  drawCommands() runs a whole frame of primitives in one native call:
+**  either an Int16Array/Uint16Array of [op, args...] records, or an
+**  array of [op, args...] tuples. present() pushes a sprite to the
+**  panel and closes the frame for the frameStats() counters.
+**********************************************************************/
+enum DrawCommand : uint8_t {
+    CMD_FILL = 1,        // color
+    CMD_PIXEL,           // x, y, color
+    CMD_LINE,            // x, y, x2, y2, color
+    CMD_RECT,            // x, y, w, h, color
+    CMD_FILL_RECT,       // x, y, w, h, color
+    CMD_ROUND_RECT,      // x, y, w, h, r, color
+    CMD_FILL_ROUND_RECT, // x, y, w, h, r, color
+    CMD_CIRCLE,          // x, y, r, color
+    CMD_FILL_CIRCLE,     // x, y, r, color
+    CMD_TRIANGLE,        // x0, y0, x1, y1, x2, y2, color
+    CMD_FILL_TRIANGLE,   // x0, y0, x1, y1, x2, y2, color
+    CMD_HLINE,           // x, y, w, color
+    CMD_VLINE,           // x, y, h, color
+    CMD_TEXT_COLOR,      // fg, bg
+    CMD_TEXT_SIZE,       // size
+    CMD_TEXT_ALIGN,      // datum (align + baseline * 3, see setTextAlign)
+    CMD_TEXT,            // x, y, string (index into the strings array for typed arrays)
+    CMD_COUNT
+};
+
+static const uint8_t drawCommandArgs[CMD_COUNT] = {0, 1, 3, 5, 5, 5, 6, 6, 4, 4, 7, 7, 4, 4, 2, 1, 1, 3};
+static const char *const drawCommandNames[CMD_COUNT] = {
+    NULL, "FILL", "PIXEL", "LINE", "RECT", "FILL_RECT", "ROUND_RECT", "FILL_ROUND_RECT", "CIRCLE",
+    "FILL_CIRCLE", "TRIANGLE", "FILL_TRIANGLE", "HLINE", "VLINE", "TEXT_COLOR", "TEXT_SIZE", "TEXT_ALIGN",
+    "TEXT"
+};
+
+struct FrameStats {
+    uint32_t frames = 0;
+    uint32_t windowStart = 0;
+    uint32_t windowFrames = 0;
+    uint32_t lastPresent = 0;
+    uint32_t frameUs = 0;
+    uint32_t drawUs = 0;     // spent in drawCommands() since the last present()
+    uint32_t lastDrawUs = 0; // drawUs of the last finished frame
+    uint32_t presentUs = 0;
+    uint32_t commands = 0;
+    uint32_t lastCommands = 0;
+    float fps = 0;
+    bool dma = false;
+};
+static FrameStats frameStats;
+
+static void putPropDrawCommandCodes(duk_context *ctx, duk_idx_t obj_idx) {
+    duk_idx_t cmd_idx = duk_push_object(ctx);
+    for (uint8_t op = 1; op < CMD_COUNT; op++) {
+        bduk_put_prop(ctx, cmd_idx, drawCommandNames[op], duk_push_uint, op);
+    }
+    duk_put_prop_string(ctx, obj_idx, "CMD");
+}
+
+template <typename Display>
+static inline void
+runDrawCommand(Display *d, duk_int_t magic, uint8_t op, const int32_t *a, const char *text) {
+    switch (op) {
+        case CMD_FILL:
+#if defined(HAS_SCREEN)
+            if (magic != 0) {
+                ((TFT_eSprite *)d)->fillSprite((uint16_t)a[0]);
+                break;
+            }
+#endif
+            tft.fillScreen((uint16_t)a[0]);
+            break;
+        case CMD_PIXEL: d->drawPixel(a[0], a[1], (uint16_t)a[2]); break;
+        case CMD_LINE: d->drawLine(a[0], a[1], a[2], a[3], (uint16_t)a[4]); break;
+        case CMD_RECT: d->drawRect(a[0], a[1], a[2], a[3], (uint16_t)a[4]); break;
+        case CMD_FILL_RECT: d->fillRect(a[0], a[1], a[2], a[3], (uint16_t)a[4]); break;
+        case CMD_ROUND_RECT: d->drawRoundRect(a[0], a[1], a[2], a[3], a[4], (uint16_t)a[5]); break;
+        case CMD_FILL_ROUND_RECT: d->fillRoundRect(a[0], a[1], a[2], a[3], a[4], (uint16_t)a[5]); break;
+        case CMD_CIRCLE: d->drawCircle(a[0], a[1], a[2], (uint16_t)a[3]); break;
+        case CMD_FILL_CIRCLE: d->fillCircle(a[0], a[1], a[2], (uint16_t)a[3]); break;
+        case CMD_TRIANGLE: d->drawTriangle(a[0], a[1], a[2], a[3], a[4], a[5], (uint16_t)a[6]); break;
+        case CMD_FILL_TRIANGLE: d->fillTriangle(a[0], a[1], a[2], a[3], a[4], a[5], (uint16_t)a[6]); break;
+        case CMD_HLINE: d->drawFastHLine(a[0], a[1], a[2], (uint16_t)a[3]); break;
+        case CMD_VLINE: d->drawFastVLine(a[0], a[1], a[2], (uint16_t)a[3]); break;
+        case CMD_TEXT_COLOR: d->setTextColor((uint16_t)a[0], (uint16_t)a[1]); break;
+        case CMD_TEXT_SIZE: d->setTextSize(a[0]); break;
+        case CMD_TEXT_ALIGN: d->setTextDatum(a[0]); break;
+        case CMD_TEXT:
+            if (text != NULL) d->drawString(text, a[0], a[1]);
+            break;
+    }
+}
+
+// Typed array path: one contiguous int16 record stream, no per-value Duktape calls
+static duk_ret_t drawCommandBuffer(duk_context *ctx, duk_int_t magic, uint32_t *count) {
+    duk_get_prop_string(ctx, 0, "BYTES_PER_ELEMENT");
+    duk_int_t elementSize = duk_get_int(ctx, -1);
+    duk_pop(ctx);
+    duk_size_t byteLength;
+    const int16_t *data = (const int16_t *)duk_get_buffer_data(ctx, 0, &byteLength);
+    if (data == NULL || elementSize != 2) {
+        return duk_error(
+            ctx,
+            DUK_ERR_TYPE_ERROR,
+            "%s: Expected an Int16Array, Uint16Array or array of tuples.",
+            "drawCommands"
+        );
+    }
+
+    auto display = get_display(magic);
+    size_t length = byteLength / 2;
+    int32_t args[7];
+    size_t i = 0;
+    while (i < length) {
+        uint16_t op = (uint16_t)data[i];
+        if (op == 0 || op >= CMD_COUNT) {
+            return duk_error(
+                ctx,
+                DUK_ERR_RANGE_ERROR,
+                "%s: Unknown command %u at index %u.",
+                "drawCommands",
+                op,
+                (unsigned)i
+            );
+        }
+        uint8_t argc = drawCommandArgs[op];
+        if (i + 1 + argc > length) {
+            return duk_error(
+                ctx,
+                DUK_ERR_RANGE_ERROR,
+                "%s: Command %u at index %u is truncated.",
+                "drawCommands",
+                op,
+                (unsigned)i
+            );
+        }
+        for (uint8_t k = 0; k < argc; k++) args[k] = data[i + 1 + k];
+        i += 1 + argc;
+
+        if (op == CMD_TEXT) {
+            if (!duk_is_array(ctx, 1)) {
+                return duk_error(
+                    ctx,
+                    DUK_ERR_TYPE_ERROR,
+                    "%s: TEXT needs a strings array as second argument.",
+                    "drawCommands"
+                );
+            }
+            duk_get_prop_index(ctx, 1, args[2]);
+            const char *text = duk_is_undefined(ctx, -1) ? NULL : duk_to_string(ctx, -1);
+            runDrawCommand(display, magic, op, args, text);
+            duk_pop(ctx);
+        } else {
+            runDrawCommand(display, magic, op, args, NULL);
+        }
+        (*count)++;
+    }
+    return 0;
+}
+
+// Tuple path: [[op, args...], ...]; TEXT takes its string inline
+static duk_ret_t drawCommandTuples(duk_context *ctx, duk_int_t magic, uint32_t *count) {
+    auto display = get_display(magic);
+    int32_t args[7];
+    duk_size_t length = duk_get_length(ctx, 0);
+    for (duk_size_t i = 0; i < length; i++) {
+        duk_get_prop_index(ctx, 0, i);
+        if (!duk_is_array(ctx, -1)) {
+            return duk_error(
+                ctx, DUK_ERR_TYPE_ERROR, "%s: Entry %u is not an array.", "drawCommands", (unsigned)i
+            );
+        }
+        duk_get_prop_index(ctx, -1, 0);
+        duk_uint_t op = duk_get_uint(ctx, -1);
+        duk_pop(ctx);
+        if (op == 0 || op >= CMD_COUNT) {
+            return duk_error(
+                ctx,
+                DUK_ERR_RANGE_ERROR,
+                "%s: Unknown command %u in entry %u.",
+                "drawCommands",
+                op,
+                (unsigned)i
+            );
+        }
+        uint8_t argc = drawCommandArgs[op];
+        const char *text = NULL;
+        for (uint8_t k = 0; k < argc; k++) {
+            duk_get_prop_index(ctx, -1, k + 1);
+            if (op == CMD_TEXT && k == 2) {
+                // string stays on the stack until the command has run
+                text = duk_is_undefined(ctx, -1) ? NULL : duk_to_string(ctx, -1);
+                continue;
+            }
+            args[k] = duk_get_int(ctx, -1);
+            duk_pop(ctx);
+        }
+        runDrawCommand(display, magic, op, args, text);
+        duk_pop_n(ctx, op == CMD_TEXT ? 2 : 1);
+        (*count)++;
+    }
+    return 0;
+}
+
+duk_ret_t native_drawCommands(duk_context *ctx) {
+    // usage: drawCommands(commands: Int16Array | Uint16Array | number[][], strings?: string[])
+    // returns the number of commands executed
+    duk_int_t magic = duk_get_current_magic(ctx);
+    uint32_t start = micros();
+    uint32_t count = 0;
+
+    if (duk_is_array(ctx, 0)) drawCommandTuples(ctx, magic, &count);
+    else drawCommandBuffer(ctx, magic, &count);
+
+    frameStats.drawUs += micros() - start;
+    frameStats.commands += count;
+    duk_push_uint(ctx, count);
+    return 1;
+}
+
+#if defined(HAS_SCREEN) && defined(BOARD_HAS_PSRAM) && defined(ESP32_DMA)
+// Sprites live in PSRAM, which the SPI DMA can't read directly, so frames go out in strips
+// through two small internal buffers: the copy of one strip overlaps the transfer of the other.
+#define PRESENT_STRIP_ROWS 16
+static uint16_t *presentStrips[2] = {NULL, NULL};
+static size_t presentStripPixels = 0;
+
+static void freePresentStrips() {
+    for (auto &strip : presentStrips) {
+        if (strip != NULL) heap_caps_free(strip);
+        strip = NULL;
+    }
+    presentStripPixels = 0;
+}
+
+static bool presentSpriteDMA(TFT_eSprite *sprite, int32_t x, int32_t y) {
+    if (sprite->getColorDepth() != 16 || sprite->getPointer() == NULL) return false;
+    int32_t width = sprite->width();
+    int32_t height = sprite->height();
+    size_t pixels = width * PRESENT_STRIP_ROWS;
+
+    if (pixels > presentStripPixels) {
+        freePresentStrips();
+        for (auto &strip : presentStrips) {
+            strip = (uint16_t *)heap_caps_malloc(pixels * 2, MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL);
+            if (strip == NULL) {
+                freePresentStrips();
+                return false;
+            }
+        }
+        presentStripPixels = pixels;
+    }
+    if (!tft.DMA_Enabled && !tft.initDMA()) return false;
+
+    // The sprite already holds panel byte order, same as pushSprite()
+    uint16_t *image = (uint16_t *)sprite->getPointer();
+    bool swapBytes = tft.getSwapBytes();
+    tft.setSwapBytes(false);
+    // Bus is released again before returning: on some boards the SD card shares it
+    tft.startWrite();
+    uint8_t strip = 0;
+    for (int32_t row = 0; row < height; row += PRESENT_STRIP_ROWS, strip ^= 1) {
+        int32_t rows = height - row < PRESENT_STRIP_ROWS ? height - row : PRESENT_STRIP_ROWS;
+        tft.pushImageDMA(x, y + row, width, rows, image + row * width, presentStrips[strip]);
+    }
+    tft.dmaWait();
+    tft.endWrite();
+    tft.setSwapBytes(swapBytes);
+    return true;
+}
+#endif
+
+duk_ret_t native_present(duk_context *ctx) {
+    // usage: present(x?: number, y?: number)
+    // Pushes a sprite to the panel and closes the frame. On the display itself it only closes the frame.
+    duk_int_t magic = duk_get_current_magic(ctx);
+    uint32_t start = micros();
+
+#if defined(HAS_SCREEN) && defined(BOARD_HAS_PSRAM)
+    if (magic != 0) {
+        TFT_eSprite *sprite = sprites.at(magic - 1);
+        if (sprite != NULL) {
+            int32_t x = duk_get_int_default(ctx, 0, 0);
+            int32_t y = duk_get_int_default(ctx, 1, 0);
+#if defined(ESP32_DMA)
+            frameStats.dma = presentSpriteDMA(sprite, x, y);
+            if (!frameStats.dma) sprite->pushSprite(x, y);
+#else
+            sprite->pushSprite(x, y);
+#endif
+        }
+    }
+#endif
+
+    uint32_t now = micros();
+    frameStats.presentUs = now - start;
+    if (frameStats.frames > 0) frameStats.frameUs = now - frameStats.lastPresent;
+    else frameStats.windowStart = now;
+    frameStats.lastPresent = now;
+    frameStats.frames++;
+    frameStats.windowFrames++;
+    if (now - frameStats.windowStart >= 1000000) {
+        frameStats.fps = frameStats.windowFrames * 1000000.0f / (now - frameStats.windowStart);
+        frameStats.windowStart = now;
+        frameStats.windowFrames = 0;
+    }
+    frameStats.lastDrawUs = frameStats.drawUs;
+    frameStats.lastCommands = frameStats.commands;
+    frameStats.drawUs = 0;
+    frameStats.commands = 0;
+    return 0;
+}
+
+duk_ret_t native_frameStats(duk_context *ctx) {
+    // usage: frameStats(): { fps, frames, frameTime, drawTime, presentTime, commands, dma }
+    // times are in milliseconds and describe the last presented frame
+    duk_idx_t obj_idx = duk_push_object(ctx);
+    bduk_put_prop(ctx, obj_idx, "fps", duk_push_number, frameStats.fps);
+    bduk_put_prop(ctx, obj_idx, "frames", duk_push_uint, frameStats.frames);
+    bduk_put_prop(ctx, obj_idx, "frameTime", duk_push_number, frameStats.frameUs / 1000.0);
+    bduk_put_prop(ctx, obj_idx, "drawTime", duk_push_number, frameStats.lastDrawUs / 1000.0);
+    bduk_put_prop(ctx, obj_idx, "presentTime", duk_push_number, frameStats.presentUs / 1000.0);
+    bduk_put_prop(ctx, obj_idx, "commands", duk_push_uint, frameStats.lastCommands);
+    bduk_put_prop(ctx, obj_idx, "dma", duk_push_boolean, frameStats.dma);
+    return 1;
+}
+
+static void clearFrameData() {
+    frameStats = FrameStats();
+#if defined(HAS_SCREEN) && defined(BOARD_HAS_PSRAM) && defined(ESP32_DMA)
+    freePresentStrips();
+#endif
+}
+
 duk_ret_t native_getRotation(duk_context *ctx) {
     duk_push_int(ctx, bruceConfigPins.rotation);
     return 1;
@@ -45,6 +45,9 @@ duk_ret_t native_gifOpen(duk_context *ctx);
 duk_ret_t native_deleteSprite(duk_context *ctx);
 duk_ret_t native_pushSprite(duk_context *ctx);
 duk_ret_t native_createSprite(duk_context *ctx);
+duk_ret_t native_drawCommands(duk_context *ctx);
+duk_ret_t native_present(duk_context *ctx);
+duk_ret_t native_frameStats(duk_context *ctx);
 
 inline void internal_print(duk_context *ctx, uint8_t printTft, uint8_t newLine) {
     duk_int_t magic = duk_get_current_magic(ctx);
@@ -0,0 +1,268 @@
+#if !defined(LITE_VERSION) && !defined(DISABLE_INTERPRETER)
+#include "eventloop_js.h"
+
+#include "helpers_js.h"
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#define TIMERS_STORE DUK_HIDDEN_SYMBOL("timers")
+#define JOBS_STORE DUK_HIDDEN_SYMBOL("asyncJobs")
+#define EVENTLOOP_MAX_TIMERS 64
+// Poll-driven jobs (WiFi scan, serial, radios) are checked at least this often while idle
+#define EVENTLOOP_POLL_MS 5
+// Upper bound for a single idle sleep when only worker jobs are pending
+#define EVENTLOOP_MAX_SLEEP_MS 1000
+
+struct JsTimer {
+    uint32_t id;
+    uint32_t due;
+    uint32_t interval;
+    bool repeat;
+};
+
+struct JsWorker {
+    std::function<void()> work;
+    std::atomic<bool> done{false};
+};
+
+struct JsAsyncJob {
+    uint32_t id;
+    JsAsyncPoll poll;
+    JsAsyncResult result;
+    std::shared_ptr<JsWorker> worker; // null for poll-driven jobs
+};
+
+static std::vector<JsTimer> timers;
+static std::vector<JsAsyncJob> jobs;
+static uint32_t nextCallbackId = 1;
+// Workers signal completion here. Never deleted, so a worker outliving its script can still give it.
+static SemaphoreHandle_t wakeSemaphore = NULL;
+
+static inline bool timeReached(uint32_t due, uint32_t now) { return (int32_t)(now - due) >= 0; }
+
+duk_ret_t registerEventLoop(duk_context *ctx) {
+    bduk_register_c_lightfunc(ctx, "setTimeout", native_setTimeout, DUK_VARARGS, 0);
+    bduk_register_c_lightfunc(ctx, "setInterval", native_setTimeout, DUK_VARARGS, 1);
+    bduk_register_c_lightfunc(ctx, "clearTimeout", native_clearTimeout, 1);
+    bduk_register_c_lightfunc(ctx, "clearInterval", native_clearTimeout, 1);
+    return 0;
+}
+
+// Callbacks live in the global stash keyed by id, so the GC sees them while they are pending
+static void pushCallbackStore(duk_context *ctx, const char *name) {
+    duk_push_global_stash(ctx);
+    if (!duk_get_prop_string(ctx, -1, name)) {
+        duk_pop(ctx);
+        duk_push_object(ctx);
+        duk_dup_top(ctx);
+        duk_put_prop_string(ctx, -3, name);
+    }
+    duk_remove(ctx, -2);
+}
+
+duk_ret_t native_setTimeout(duk_context *ctx) {
+    // usage: setTimeout(callback: function, delay?: number, ...args): number
+    // usage: setInterval(callback: function, interval?: number, ...args): number
+    bool repeat = duk_get_current_magic(ctx) == 1;
+    const char *name = repeat ? "setInterval" : "setTimeout";
+    if (!duk_is_callable(ctx, 0)) {
+        return duk_error(ctx, DUK_ERR_TYPE_ERROR, "%s: callback must be a function.", name);
+    }
+    if (timers.size() >= EVENTLOOP_MAX_TIMERS) {
+        return duk_error(ctx, DUK_ERR_RANGE_ERROR, "%s: too many timers.", name);
+    }
+    duk_int_t delayMs = duk_get_int_default(ctx, 1, 0);
+    if (delayMs < 0) delayMs = 0;
+    if (repeat && delayMs == 0) delayMs = 1; // a 0 ms interval would never let the loop sleep
+
+    uint32_t id = nextCallbackId++;
+    duk_idx_t nargs = duk_get_top(ctx);
+
+    // Stored as [callback, ...args]
+    pushCallbackStore(ctx, TIMERS_STORE);
+    duk_idx_t entry_idx = duk_push_array(ctx);
+    duk_dup(ctx, 0);
+    duk_put_prop_index(ctx, entry_idx, 0);
+    for (duk_idx_t i = 2; i < nargs; i++) {
+        duk_dup(ctx, i);
+        duk_put_prop_index(ctx, entry_idx, i - 1);
+    }
+    duk_put_prop_index(ctx, -2, id);
+    duk_pop(ctx);
+
+    timers.push_back({id, millis() + delayMs, (uint32_t)delayMs, repeat});
+    duk_push_uint(ctx, id);
+    return 1;
+}
+
+duk_ret_t native_clearTimeout(duk_context *ctx) {
+    // usage: clearTimeout(id: number)
+    // usage: clearInterval(id: number)
+    if (!duk_is_number(ctx, 0)) return 0;
+    uint32_t id = duk_get_uint(ctx, 0);
+    for (auto it = timers.begin(); it != timers.end(); ++it) {
+        if (it->id != id) continue;
+        timers.erase(it);
+        pushCallbackStore(ctx, TIMERS_STORE);
+        duk_del_prop_index(ctx, -1, id);
+        duk_pop(ctx);
+        break;
+    }
+    return 0;
+}
+
+void js_async_poll(duk_context *ctx, duk_idx_t callbackIdx, JsAsyncPoll poll, JsAsyncResult result) {
+    if (!duk_is_callable(ctx, callbackIdx)) {
+        duk_error(ctx, DUK_ERR_TYPE_ERROR, "callback must be a function.");
+        return;
+    }
+    callbackIdx = duk_normalize_index(ctx, callbackIdx);
+    uint32_t id = nextCallbackId++;
+    pushCallbackStore(ctx, JOBS_STORE);
+    duk_dup(ctx, callbackIdx);
+    duk_put_prop_index(ctx, -2, id);
+    duk_pop(ctx);
+    jobs.push_back({id, poll, result, nullptr});
+}
+
+static void asyncWorkerTask(void *param) {
+    std::shared_ptr<JsWorker> *worker = static_cast<std::shared_ptr<JsWorker> *>(param);
+    (*worker)->work();
+    (*worker)->work = nullptr;
+    (*worker)->done = true;
+    xSemaphoreGive(wakeSemaphore);
+    delete worker;
+    vTaskDelete(NULL);
+}
+
+void js_async_worker(
+    duk_context *ctx, duk_idx_t callbackIdx, std::function<void()> work, JsAsyncResult result,
+    uint32_t stackSize
+) {
+    if (wakeSemaphore == NULL) wakeSemaphore = xSemaphoreCreateBinary();
+
+    js_async_poll(ctx, callbackIdx, nullptr, result);
+    std::shared_ptr<JsWorker> worker = std::make_shared<JsWorker>();
+    worker->work = work;
+    jobs.back().worker = worker;
+
+    // The task keeps its own reference: the job may be dropped first if the script ends
+    std::shared_ptr<JsWorker> *taskRef = new std::shared_ptr<JsWorker>(worker);
+    if (xTaskCreate(asyncWorkerTask, "jsAsyncWorker", stackSize, taskRef, 2, NULL) != pdPASS) {
+        delete taskRef;
+        // No room for another task, run it inline so the callback still fires
+        worker->work();
+        worker->work = nullptr;
+        worker->done = true;
+    }
+}
+
+// Calls the [callback, ...args] entry on top of the stack and pops it. On error the entry is replaced
+// by the error value.
+static duk_int_t callTimerEntry(duk_context *ctx) {
+    duk_idx_t entry_idx = duk_get_top_index(ctx);
+    duk_size_t length = duk_is_array(ctx, entry_idx) ? duk_get_length(ctx, entry_idx) : 0;
+    if (length == 0) {
+        duk_pop(ctx);
+        return DUK_EXEC_SUCCESS;
+    }
+    for (duk_size_t i = 0; i < length; i++) duk_get_prop_index(ctx, entry_idx, i);
+    duk_int_t rc = duk_pcall(ctx, length - 1);
+    if (rc != DUK_EXEC_SUCCESS) {
+        duk_remove(ctx, entry_idx);
+        return rc;
+    }
+    duk_pop_2(ctx);
+    return DUK_EXEC_SUCCESS;
+}
+
+static duk_int_t runDueTimers(duk_context *ctx) {
+    uint32_t now = millis();
+    // Timers created by these callbacks wait for the next turn, so jobs and the idle sleep still get a go
+    uint32_t lastId = nextCallbackId;
+    while (true) {
+        int next = -1;
+        for (size_t i = 0; i < timers.size(); i++) {
+            if (timers[i].id >= lastId || !timeReached(timers[i].due, now)) continue;
+            if (next < 0 || (int32_t)(timers[i].due - timers[next].due) < 0) next = i;
+        }
+        if (next < 0) return DUK_EXEC_SUCCESS;
+
+        JsTimer timer = timers[next];
+        pushCallbackStore(ctx, TIMERS_STORE);
+        duk_get_prop_index(ctx, -1, timer.id);
+        if (timer.repeat) {
+            // Stay on the original cadence; ticks missed while busy are skipped instead of bunched up
+            uint32_t late = now - timer.due;
+            timers[next].due += (late / timer.interval + 1) * timer.interval;
+        } else {
+            timers.erase(timers.begin() + next);
+            duk_del_prop_index(ctx, -2, timer.id);
+        }
+        duk_remove(ctx, -2);
+
+        duk_int_t rc = callTimerEntry(ctx);
+        if (rc != DUK_EXEC_SUCCESS) return rc;
+    }
+}
+
+static duk_int_t runFinishedJobs(duk_context *ctx) {
+    for (size_t i = 0; i < jobs.size();) {
+        bool finished = jobs[i].worker ? jobs[i].worker->done.load() : jobs[i].poll();
+        if (!finished) {
+            i++;
+            continue;
+        }
+        // The callback may queue new jobs, so take this one out first
+        JsAsyncJob job = jobs[i];
+        jobs.erase(jobs.begin() + i);
+
+        pushCallbackStore(ctx, JOBS_STORE);
+        duk_get_prop_index(ctx, -1, job.id);
+        duk_del_prop_index(ctx, -2, job.id);
+        duk_remove(ctx, -2);
+
+        duk_idx_t nargs = job.result(ctx);
+        duk_int_t rc = duk_pcall(ctx, nargs);
+        if (rc != DUK_EXEC_SUCCESS) return rc;
+        duk_pop(ctx);
+    }
+    return DUK_EXEC_SUCCESS;
+}
+
+// Sleeps until the next timer is due, a worker finishes or a poll-driven job needs checking
+static void idleWait() {
+    uint32_t now = millis();
+    uint32_t waitMs = EVENTLOOP_MAX_SLEEP_MS;
+    for (auto &timer : timers) {
+        int32_t left = timer.due - now;
+        if (left <= 0) return;
+        if ((uint32_t)left < waitMs) waitMs = left;
+    }
+    for (auto &job : jobs) {
+        if (job.worker == nullptr && waitMs > EVENTLOOP_POLL_MS) waitMs = EVENTLOOP_POLL_MS;
+    }
+    if (wakeSemaphore != NULL) xSemaphoreTake(wakeSemaphore, pdMS_TO_TICKS(waitMs));
+    else vTaskDelay(pdMS_TO_TICKS(waitMs));
+}
+
+duk_int_t runEventLoop(duk_context *ctx) {
+    while (!timers.empty() || !jobs.empty()) {
+        duk_int_t rc = runDueTimers(ctx);
+        if (rc != DUK_EXEC_SUCCESS) return rc;
+        rc = runFinishedJobs(ctx);
+        if (rc != DUK_EXEC_SUCCESS) return rc;
+        if (!timers.empty() || !jobs.empty()) idleWait();
+    }
+    return DUK_EXEC_SUCCESS;
+}
+
+void clearEventLoopData() {
+    // Running workers hold their own reference and finish on their own
+    timers.clear();
+    jobs.clear();
+    nextCallbackId = 1;
+}
+
+#endif
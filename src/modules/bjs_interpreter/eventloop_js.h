@@ -0,0 +1,32 @@
+#if !defined(LITE_VERSION) && !defined(DISABLE_INTERPRETER)
+#ifndef __EVENTLOOP_JS_H__
+#define __EVENTLOOP_JS_H__
+
+#include <duktape.h>
+#include <functional>
+
+// Polled on the interpreter task every loop turn; returns true once the operation has finished
+typedef std::function<bool()> JsAsyncPoll;
+// Pushes the callback arguments (error, result) and returns how many were pushed
+typedef std::function<duk_idx_t(duk_context *)> JsAsyncResult;
+
+duk_ret_t registerEventLoop(duk_context *ctx);
+
+// Runs timers and async callbacks until none are left. Returns DUK_EXEC_ERROR with the error on top of
+// the stack if a callback throws, leaving the stack untouched otherwise.
+duk_int_t runEventLoop(duk_context *ctx);
+void clearEventLoopData();
+
+// Queues an operation that is driven by `poll`; the function at callbackIdx gets the result once done
+void js_async_poll(duk_context *ctx, duk_idx_t callbackIdx, JsAsyncPoll poll, JsAsyncResult result);
+// Runs `work` on a worker task (it must not touch the Duktape heap), then calls back with `result`
+void js_async_worker(
+    duk_context *ctx, duk_idx_t callbackIdx, std::function<void()> work, JsAsyncResult result,
+    uint32_t stackSize = 8192
+);
+
+duk_ret_t native_setTimeout(duk_context *ctx);
+duk_ret_t native_clearTimeout(duk_context *ctx);
+
+#endif
+#endif
@@ -44,6 +44,7 @@ void interpreterHandler(void *pvParameters) {
 
     // Init containers
     clearDisplayModuleData();
+    clearEventLoopData();
 
     registerConsole(ctx);
 
@@ -58,6 +59,7 @@ void interpreterHandler(void *pvParameters) {
     // Deprecated
     bduk_register_c_lightfunc(ctx, "load", native_load, 1);
     registerGlobals(ctx);
+    registerEventLoop(ctx);
     registerMath(ctx);
 
     // registerAudio(ctx);
@@ -92,7 +94,11 @@ void interpreterHandler(void *pvParameters) {
 
     Serial.printf("Script length: %d\n", strlen(script));
 
-    if (duk_peval_string(ctx, script) != DUK_EXEC_SUCCESS) {
+    // Once the top level has run, keep going while timers or async callbacks are pending
+    duk_int_t evalResult = duk_peval_string(ctx, script);
+    if (evalResult == DUK_EXEC_SUCCESS) evalResult = runEventLoop(ctx);
+
+    if (evalResult != DUK_EXEC_SUCCESS) {
         tft.fillScreen(bruceConfig.bgColor);
         tft.setTextSize(FM);
         tft.setTextColor(TFT_RED, bruceConfig.bgColor);
@@ -155,9 +161,11 @@ void interpreterHandler(void *pvParameters) {
     duk_pop(ctx);
 
     // Clean up.
+    clearEventLoopData();
     duk_destroy_heap(ctx);
 
     clearDisplayModuleData();
+    clearWiFiModuleData();
 
     // delay(1000);
     interpreter_start = false;
@@ -16,6 +16,7 @@ extern char *scriptName;
 #include "device_js.h"
 #include "dialog_js.h"
 #include "display_js.h"
+#include "eventloop_js.h"
 #include "globals_js.h"
 #include "gpio_js.h"
 #include "helpers_js.h"
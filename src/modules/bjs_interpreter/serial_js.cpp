@@ -2,20 +2,22 @@
 #include "serial_js.h"
 
 #include "display_js.h"
+#include "eventloop_js.h"
 
 #include "helpers_js.h"
+#include <memory>
 
 duk_ret_t putPropSerialFunctions(duk_context *ctx, duk_idx_t obj_idx, uint8_t magic) {
     bduk_put_prop_c_lightfunc(ctx, obj_idx, "print", native_serialPrint, DUK_VARARGS, magic);
     bduk_put_prop_c_lightfunc(ctx, obj_idx, "println", native_serialPrintln, DUK_VARARGS, magic);
-    bduk_put_prop_c_lightfunc(ctx, obj_idx, "readln", native_serialReadln, 1, magic);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "readln", native_serialReadln, 2, magic);
     bduk_put_prop_c_lightfunc(ctx, obj_idx, "cmd", native_serialCmd, 1, magic);
     bduk_put_prop_c_lightfunc(ctx, obj_idx, "write", native_serialPrint, DUK_VARARGS, magic);
     return 0;
 }
 
 duk_ret_t registerSerial(duk_context *ctx) {
-    bduk_register_c_lightfunc(ctx, "serialReadln", native_serialReadln, 1);
+    bduk_register_c_lightfunc(ctx, "serialReadln", native_serialReadln, 2);
     bduk_register_c_lightfunc(ctx, "serialPrintln", native_serialPrintln, DUK_VARARGS);
     bduk_register_c_lightfunc(ctx, "serialCmd", native_serialCmd, 1);
     return 0;
@@ -41,13 +43,46 @@ duk_ret_t native_serialPrintln(duk_context *ctx) {
     return 0;
 }
 
+struct SerialLineRead {
+    String line;
+    uint32_t deadline;
+};
+
 duk_ret_t native_serialReadln(duk_context *ctx) {
     // usage: serialReadln();   // default to 10s timeout
     // usage: serialReadln(timeout_in_ms : number);
+    // usage: serialReadln(timeout_in_ms : number, callback : (error, line) => void);
     String line;
     int maxloops = 1000 * 10;
     if (duk_is_number(ctx, 0)) maxloops = duk_to_int(ctx, 0);
     Serial.flush();
+
+    if (duk_is_function(ctx, 1)) {
+        // Collected a character at a time from the event loop; calls back with the line or "" on timeout
+        std::shared_ptr<SerialLineRead> read = std::make_shared<SerialLineRead>();
+        read->deadline = millis() + maxloops;
+        js_async_poll(
+            ctx,
+            1,
+            [read]() {
+                while (Serial.available()) {
+                    char c = Serial.read();
+                    if (c == '\n') return true;
+                    if (c != '\r') read->line += c;
+                }
+                if ((int32_t)(millis() - read->deadline) < 0) return false;
+                read->line = "";
+                return true;
+            },
+            [read](duk_context *ctx) -> duk_idx_t {
+                duk_push_null(ctx);
+                duk_push_string(ctx, read->line.c_str());
+                return 2;
+            }
+        );
+        return 0;
+    }
+
     while (maxloops) {
         if (!Serial.available()) {
             maxloops -= 1;
@@ -15,6 +15,7 @@ duk_ret_t putPropStorageFunctions(duk_context *ctx, duk_idx_t obj_idx, uint8_t m
     bduk_put_prop_c_lightfunc(ctx, obj_idx, "rmdir", native_storageRmdir, 1, magic);
     bduk_put_prop_c_lightfunc(ctx, obj_idx, "spaceLittleFS", native_storageSpaceLittleFS, 0, magic);
     bduk_put_prop_c_lightfunc(ctx, obj_idx, "spaceSDCard", native_storageSpaceSDCard, 0, magic);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "open", native_storageOpen, 2, magic);
     return 0;
 }
 
@@ -26,6 +27,7 @@ duk_ret_t registerStorage(duk_context *ctx) {
     bduk_register_c_lightfunc(ctx, "storageRemove", native_storageRemove, 1);
     bduk_register_c_lightfunc(ctx, "storageSpaceLittleFS", native_storageSpaceLittleFS, 0);
     bduk_register_c_lightfunc(ctx, "storageSpaceSDCard", native_storageSpaceSDCard, 0);
+    bduk_register_c_lightfunc(ctx, "storageOpen", native_storageOpen, 2);
     return 0;
 }
 
@@ -104,8 +106,6 @@ duk_ret_t native_storageRead(duk_context *ctx) {
     // usage: storageRead(path: string | Path, binary: boolean): string |
     // Uint8Array returns: file contents as a string. Empty string on any error.
     bool binary = duk_get_boolean_default(ctx, 1, false);
-    size_t fileSize = 0;
-    char *fileContent = NULL;
     FileParamsJS fileParams = js_get_path_from_params(ctx, true);
     if (!fileParams.exist) {
         return duk_error(
@@ -114,27 +114,58 @@ duk_ret_t native_storageRead(duk_context *ctx) {
     }
     if (!fileParams.path.startsWith("/")) fileParams.path = "/" + fileParams.path; // add "/" if missing
 
-    // TODO: Change to use duk_push_fixed_buffer
-    fileContent = readBigFile(*fileParams.fs, fileParams.path, binary, &fileSize);
-
-    if (fileContent == NULL) {
+    File file = (fileParams.fs)->open(fileParams.path, FILE_READ);
+    if (!file) {
         return duk_error(
             ctx, DUK_ERR_ERROR, "%s: Could not read file: %s", "storageRead", fileParams.path.c_str()
         );
     }
 
+    // Read straight into Duktape-owned memory instead of a temporary heap copy
+    size_t fileSize = file.size();
+    void *buf = duk_push_fixed_buffer(ctx, fileSize);
+    size_t bytesRead = fileSize ? file.read((uint8_t *)buf, fileSize) : 0;
+    file.close();
+
     if (binary && fileSize != 0) {
-        void *buf = duk_push_fixed_buffer(ctx, fileSize);
-        memcpy(buf, fileContent, fileSize);
         // Convert buffer to Uint8Array
-        duk_push_buffer_object(ctx, -1, 0, fileSize, DUK_BUFOBJ_UINT8ARRAY);
+        duk_push_buffer_object(ctx, -1, 0, bytesRead, DUK_BUFOBJ_UINT8ARRAY);
     } else {
-        duk_push_string(ctx, fileContent);
+        duk_push_lstring(ctx, (const char *)buf, bytesRead);
     }
-    free(fileContent);
     return 1;
 }
 
+// Returns the offset of the first match at or after `from`, or -1. Reads in small chunks so
+// the file never has to fit in memory; the file position is left wherever the scan stopped.
+static int64_t findInFile(File &file, const uint8_t *needle, size_t needleLen, size_t from) {
+    if (needleLen == 0) return from;
+    if (!file.seek(from, SeekSet)) return -1;
+
+    size_t bufSize = 512 + needleLen;
+    uint8_t *buf = (uint8_t *)malloc(bufSize);
+    if (buf == NULL) return -1;
+
+    int64_t result = -1;
+    size_t keep = 0;    // tail of the previous chunk, in case a match straddles two reads
+    size_t base = from; // file offset of buf[0]
+    while (true) {
+        size_t n = file.read(buf + keep, bufSize - keep);
+        if (n == 0) break;
+        size_t avail = keep + n;
+        uint8_t *hit = (uint8_t *)memmem(buf, avail, needle, needleLen);
+        if (hit) {
+            result = base + (hit - buf);
+            break;
+        }
+        keep = avail < needleLen - 1 ? avail : needleLen - 1;
+        memmove(buf, buf + avail - keep, keep);
+        base += avail - keep;
+    }
+    free(buf);
+    return result;
+}
+
 duk_ret_t native_storageWrite(duk_context *ctx) {
     // usage: storageWrite(path: string | Path, data: string | Uint8Array, mode:
     // "write" | "append", position: number | string): boolean The write function
@@ -169,21 +200,15 @@ duk_ret_t native_storageWrite(duk_context *ctx) {
             file.seek(pos, SeekSet);
         }
     } else if (duk_is_string(ctx, 3)) {
-        // Get position as string
-        size_t fileSize = 0;
-        char *fileContent = readBigFile(*fileParams.fs, fileParams.path, false, &fileSize);
-
-        if (fileContent == NULL) {
-            return duk_error(
-                ctx, DUK_ERR_ERROR, "%s: Could not read file: %s", "storageWrite", fileParams.path.c_str()
-            );
-        }
-
-        char *foundPos = strstr(fileContent, duk_get_string(ctx, 3));
-        free(fileContent); // Free fileContent after usage
-
-        if (foundPos) {
-            file.seek(foundPos - fileContent, SeekSet);
+        // Get position as string, searched without loading the whole file
+        duk_size_t needleLen;
+        const char *needle = duk_get_lstring(ctx, 3, &needleLen);
+        File searchFile = (fileParams.fs)->open(fileParams.path, FILE_READ);
+        int64_t foundPos = searchFile ? findInFile(searchFile, (const uint8_t *)needle, needleLen, 0) : -1;
+        searchFile.close();
+
+        if (foundPos >= 0) {
+            file.seek(foundPos, SeekSet);
         } else {
             file.seek(0, SeekEnd); // Append if string is not found
         }
@@ -302,4 +327,206 @@ duk_ret_t native_storageSpaceSDCard(duk_context *ctx) {
 
     return 1;
 }
+
+/*********************************************************************
+**  storage.open(): streaming file handles
+**********************************************************************/
+static File *getFilePointer(duk_context *ctx) {
+    File *file = NULL;
+    duk_push_this(ctx);
+    if (duk_get_prop_string(ctx, -1, DUK_HIDDEN_SYMBOL("filePointer"))) {
+        file = (File *)duk_to_pointer(ctx, -1);
+    }
+    duk_pop_2(ctx);
+    if (file == NULL) duk_error(ctx, DUK_ERR_ERROR, "%s: file is closed", "storage.open");
+    return file;
+}
+
+duk_ret_t native_storageFileRead(duk_context *ctx) {
+    // usage: file.read(buffer: Uint8Array, length?: number): number
+    //        fills an existing buffer in place and returns the bytes read (0 at end of file)
+    // usage: file.read(length?: number): Uint8Array
+    //        new buffer with up to `length` bytes, by default the rest of the file
+    File *file = getFilePointer(ctx);
+
+    if (duk_is_buffer_data(ctx, 0)) {
+        duk_size_t bufSize;
+        uint8_t *buf = (uint8_t *)duk_get_buffer_data(ctx, 0, &bufSize);
+        size_t len = duk_get_uint_default(ctx, 1, bufSize);
+        if (len > bufSize) len = bufSize;
+        duk_push_uint(ctx, len ? file->read(buf, len) : 0);
+        return 1;
+    }
+
+    size_t remaining = file->size() - file->position();
+    size_t len = duk_get_uint_default(ctx, 0, remaining);
+    if (len > remaining) len = remaining;
+    void *buf = duk_push_fixed_buffer(ctx, len);
+    size_t bytesRead = len ? file->read((uint8_t *)buf, len) : 0;
+    duk_push_buffer_object(ctx, -1, 0, bytesRead, DUK_BUFOBJ_UINT8ARRAY);
+    return 1;
+}
+
+duk_ret_t native_storageFileReadLine(duk_context *ctx) {
+    // usage: file.readLine(): string | null
+    // returns the next line without its line ending, null at end of file
+    File *file = getFilePointer(ctx);
+
+    String line;
+    uint8_t chunk[128];
+    bool gotData = false;
+    while (true) {
+        size_t start = file->position();
+        size_t n = file->read(chunk, sizeof(chunk));
+        if (n == 0) break;
+        gotData = true;
+        uint8_t *nl = (uint8_t *)memchr(chunk, '\n', n);
+        size_t take = nl ? nl - chunk : n;
+        line.concat((const char *)chunk, take);
+        if (nl) {
+            file->seek(start + take + 1, SeekSet); // rewind to just after the newline
+            break;
+        }
+    }
+    if (!gotData) {
+        duk_push_null(ctx);
+        return 1;
+    }
+    if (line.endsWith("\r")) line.remove(line.length() - 1);
+    duk_push_lstring(ctx, line.c_str(), line.length());
+    return 1;
+}
+
+duk_ret_t native_storageFileWrite(duk_context *ctx) {
+    // usage: file.write(data: string | Uint8Array): number
+    File *file = getFilePointer(ctx);
+
+    duk_size_t dataSize = 0;
+    const uint8_t *data;
+    if (duk_is_buffer_data(ctx, 0)) {
+        data = (const uint8_t *)duk_get_buffer_data(ctx, 0, &dataSize);
+    } else {
+        data = (const uint8_t *)duk_to_lstring(ctx, 0, &dataSize);
+    }
+    duk_push_uint(ctx, dataSize ? file->write(data, dataSize) : 0);
+    return 1;
+}
+
+duk_ret_t native_storageFileSeek(duk_context *ctx) {
+    // usage: file.seek(offset: number, whence?: "set" | "cur" | "end"): boolean
+    File *file = getFilePointer(ctx);
+
+    int64_t offset = (int64_t)duk_get_number_default(ctx, 0, 0);
+    const char *whence = duk_get_string_default(ctx, 1, "set");
+    if (whence[0] == 'c') offset += file->position();
+    else if (whence[0] == 'e') offset += file->size();
+    if (offset < 0) offset = 0;
+
+    duk_push_boolean(ctx, file->seek(offset, SeekSet));
+    return 1;
+}
+
+duk_ret_t native_storageFilePosition(duk_context *ctx) {
+    // usage: file.position(): number
+    duk_push_uint(ctx, getFilePointer(ctx)->position());
+    return 1;
+}
+
+duk_ret_t native_storageFileSize(duk_context *ctx) {
+    // usage: file.size(): number
+    duk_push_uint(ctx, getFilePointer(ctx)->size());
+    return 1;
+}
+
+duk_ret_t native_storageFileFind(duk_context *ctx) {
+    // usage: file.find(needle: string | Uint8Array, from?: number): number
+    // offset of the next match (from the current position by default) or -1.
+    // The read position is left unchanged.
+    File *file = getFilePointer(ctx);
+
+    duk_size_t needleLen = 0;
+    const uint8_t *needle;
+    if (duk_is_buffer_data(ctx, 0)) {
+        needle = (const uint8_t *)duk_get_buffer_data(ctx, 0, &needleLen);
+    } else {
+        needle = (const uint8_t *)duk_to_lstring(ctx, 0, &needleLen);
+    }
+    size_t position = file->position();
+    size_t from = duk_get_uint_default(ctx, 1, position);
+
+    int64_t found = findInFile(*file, needle, needleLen, from);
+    file->seek(position, SeekSet);
+    duk_push_number(ctx, (duk_double_t)found);
+    return 1;
+}
+
+duk_ret_t native_storageFileClose(duk_context *ctx) {
+    // usage: file.close(): void
+    // also the finalizer, which receives the handle as its first argument
+    if (duk_is_object(ctx, 0)) {
+        duk_dup(ctx, 0);
+    } else {
+        duk_push_this(ctx);
+    }
+    duk_idx_t obj_idx = duk_get_top_index(ctx);
+
+    File *file = NULL;
+    if (duk_get_prop_string(ctx, obj_idx, DUK_HIDDEN_SYMBOL("filePointer"))) {
+        file = (File *)duk_get_pointer(ctx, -1);
+    }
+    duk_pop(ctx);
+    bduk_put_prop(ctx, obj_idx, DUK_HIDDEN_SYMBOL("filePointer"), duk_push_pointer, NULL);
+
+    if (file != NULL) {
+        file->close();
+        delete file;
+    }
+    return 0;
+}
+
+duk_ret_t native_storageOpen(duk_context *ctx) {
+    // usage: storageOpen(path: string | Path, mode?: "r" | "w" | "a" | "r+" | "w+" | "a+"): FileHandle
+    // The handle reads and writes in place instead of loading the whole file:
+    // read, readLine, write, seek, position, size, find, close
+    FileParamsJS fileParams = js_get_path_from_params(ctx, true);
+    if (!fileParams.path.startsWith("/")) fileParams.path = "/" + fileParams.path; // add "/" if missing
+
+    const char *mode = duk_get_string_default(ctx, 1, "r");
+    static const char *const modes[] = {"r", "w", "a", "r+", "w+", "a+"};
+    bool validMode = false;
+    for (const char *m : modes) {
+        if (strcmp(mode, m) == 0) validMode = true;
+    }
+    if (!validMode) return duk_error(ctx, DUK_ERR_TYPE_ERROR, "%s: Invalid mode: %s", "storageOpen", mode);
+    if (mode[0] == 'r' && !fileParams.exist) {
+        return duk_error(
+            ctx, DUK_ERR_ERROR, "%s: File: %s does not exist", "storageOpen", fileParams.path.c_str()
+        );
+    }
+
+    File *file = new File((fileParams.fs)->open(fileParams.path, mode, mode[0] != 'r'));
+    if (!*file) {
+        delete file;
+        return duk_error(
+            ctx, DUK_ERR_ERROR, "%s: Could not open file: %s", "storageOpen", fileParams.path.c_str()
+        );
+    }
+
+    duk_idx_t obj_idx = duk_push_object(ctx);
+    bduk_put_prop(ctx, obj_idx, DUK_HIDDEN_SYMBOL("filePointer"), duk_push_pointer, file);
+
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "read", native_storageFileRead, 2, 0);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "readLine", native_storageFileReadLine, 0, 0);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "write", native_storageFileWrite, 1, 0);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "seek", native_storageFileSeek, 2, 0);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "position", native_storageFilePosition, 0, 0);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "size", native_storageFileSize, 0, 0);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "find", native_storageFileFind, 2, 0);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "close", native_storageFileClose, 0, 0);
+
+    duk_push_c_lightfunc(ctx, native_storageFileClose, 1, 1, 0);
+    duk_set_finalizer(ctx, obj_idx);
+
+    return 1;
+}
 #endif
@@ -18,5 +18,16 @@ duk_ret_t native_storageRmdir(duk_context *ctx);
 duk_ret_t native_storageSpaceLittleFS(duk_context *ctx);
 duk_ret_t native_storageSpaceSDCard(duk_context *ctx);
 
+// storage.open() file handles
+duk_ret_t native_storageOpen(duk_context *ctx);
+duk_ret_t native_storageFileRead(duk_context *ctx);
+duk_ret_t native_storageFileReadLine(duk_context *ctx);
+duk_ret_t native_storageFileWrite(duk_context *ctx);
+duk_ret_t native_storageFileSeek(duk_context *ctx);
+duk_ret_t native_storageFilePosition(duk_context *ctx);
+duk_ret_t native_storageFileSize(duk_context *ctx);
+duk_ret_t native_storageFileFind(duk_context *ctx);
+duk_ret_t native_storageFileClose(duk_context *ctx);
+
 #endif
 #endif
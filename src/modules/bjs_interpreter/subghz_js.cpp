@@ -3,13 +3,15 @@
 
 #include "modules/rf/rf_scan.h"
 
+#include "eventloop_js.h"
 #include "helpers_js.h"
+#include <memory>
 
 duk_ret_t putPropSubGHzFunctions(duk_context *ctx, duk_idx_t obj_idx, uint8_t magic) {
     bduk_put_prop_c_lightfunc(ctx, obj_idx, "setFrequency", native_subghzSetFrequency, 1, magic);
     // TODO: getFrequency
-    bduk_put_prop_c_lightfunc(ctx, obj_idx, "read", native_subghzRead, 0, magic);
-    bduk_put_prop_c_lightfunc(ctx, obj_idx, "readRaw", native_subghzReadRaw, 0, magic);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "read", native_subghzRead, 2, magic);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "readRaw", native_subghzReadRaw, 2, magic);
     bduk_put_prop_c_lightfunc(ctx, obj_idx, "transmitFile", native_subghzTransmitFile, 1, magic);
     bduk_put_prop_c_lightfunc(ctx, obj_idx, "transmit", native_subghzTransmit, 4, magic);
     bduk_put_prop_c_lightfunc(ctx, obj_idx, "setup", native_noop, 0, magic);
@@ -18,8 +20,8 @@ duk_ret_t putPropSubGHzFunctions(duk_context *ctx, duk_idx_t obj_idx, uint8_t ma
 }
 
 duk_ret_t registerSubGHz(duk_context *ctx) {
-    bduk_register_c_lightfunc(ctx, "subghzRead", native_subghzRead, 0);
-    bduk_register_c_lightfunc(ctx, "subghzReadRaw", native_subghzReadRaw, 0);
+    bduk_register_c_lightfunc(ctx, "subghzRead", native_subghzRead, 2);
+    bduk_register_c_lightfunc(ctx, "subghzReadRaw", native_subghzReadRaw, 2);
     bduk_register_c_lightfunc(ctx, "subghzSetFrequency", native_subghzSetFrequency, 1);
     bduk_register_c_lightfunc(ctx, "subghzTransmitFile", native_subghzTransmitFile, 1);
     bduk_register_c_lightfunc(ctx, "subghzTransmit", native_subghzTransmit, 4);
@@ -56,11 +58,112 @@ duk_ret_t native_subghzTransmit(duk_context *ctx) {
     return 1;
 }
 
+// Receiver for the callback form of read()/readRaw(). RCSwitch decodes in its interrupt handler, so the
+// event loop only has to poll it, instead of blocking in RCSwitch_Read's UI loop.
+struct SubGhzAsyncRead {
+    RCSwitch rcswitch;
+    RfCodes received;
+    float frequency;
+    bool raw;
+    bool receiving = false;
+    uint32_t deadline;
+    String result;
+
+    ~SubGhzAsyncRead() { stop(); }
+
+    void stop() {
+        if (!receiving) return;
+        rcswitch.disableReceive();
+        deinitRfModule();
+        receiving = false;
+    }
+
+    bool poll() {
+        if (rcswitch.available()) {
+            if (rcswitch.getReceivedValue()) {
+                unsigned int *timings = rcswitch.getReceivedRawdata();
+                received.frequency = long(frequency * 1000000);
+                received.key = rcswitch.getReceivedValue();
+                received.protocol = "RcSwitch";
+                received.preset = rcswitch.getReceivedProtocol();
+                received.te = rcswitch.getReceivedDelay();
+                received.Bit = rcswitch.getReceivedBitlength();
+                received.filepath = "unsaved";
+                received.data = "";
+                for (int i = 0; i < received.Bit * 2; i++) {
+                    if (i > 0) received.data += " ";
+                    received.data += String((i % 2 == 0 ? 1 : -1) * (int)timings[i]);
+                }
+            }
+            rcswitch.resetAvailable();
+        }
+        if (raw && received.key == 0 && rcswitch.RAWavailable()) {
+            unsigned int *timings = rcswitch.getRAWReceivedRawdata();
+            String data = "";
+            int transitions = 0;
+            for (; transitions < RCSWITCH_RAW_MAX_CHANGES && timings[transitions] != 0; transitions++) {
+                if (transitions > 0) data += " ";
+                data += String((transitions % 2 == 0 ? 1 : -1) * (int)timings[transitions]);
+            }
+            if (transitions > 20) {
+                received.frequency = long(frequency * 1000000);
+                received.protocol = "RAW";
+                received.preset = "0";
+                received.filepath = "unsaved";
+                received.data = data;
+            }
+            rcswitch.resetAvailable();
+        }
+
+        if (received.key > 0 || received.data.length() > 20) {
+            result = RCSwitch_SubFile(received, frequency, raw);
+        } else if ((int32_t)(millis() - deadline) < 0) {
+            return false;
+        }
+        stop();
+        return true;
+    }
+};
+
+static void subghzReadAsync(duk_context *ctx, bool raw) {
+    std::shared_ptr<SubGhzAsyncRead> read = std::make_shared<SubGhzAsyncRead>();
+    read->frequency = bruceConfigPins.rfFreq;
+    read->raw = raw;
+    read->deadline = millis() + duk_get_int_default(ctx, 0, 10) * 1000;
+
+    if (!initRfModule("rx", read->frequency)) {
+        duk_error(ctx, DUK_ERR_ERROR, "%s: Failed to start the RF module.", raw ? "readRaw" : "read");
+        return;
+    }
+    if (bruceConfigPins.rfModule == CC1101_SPI_MODULE) {
+        read->rcswitch.enableReceive(bruceConfigPins.CC1101_bus.io0);
+    } else {
+        read->rcswitch.enableReceive(bruceConfigPins.rfRx);
+    }
+    read->receiving = true;
+
+    js_async_poll(
+        ctx,
+        1,
+        [read]() { return read->poll(); },
+        [read](duk_context *ctx) -> duk_idx_t {
+            duk_push_null(ctx);
+            duk_push_string(ctx, read->result.c_str());
+            return 2;
+        }
+    );
+}
+
 duk_ret_t native_subghzRead(duk_context *ctx) {
     // usage: subghzRead();
     // usage: subghzRead(timeout_in_seconds : number);
+    // usage: subghzRead(timeout_in_seconds : number, callback : (error, subFile) => void);
     // returns a string of the generated sub file, empty string on timeout or
     // other errors (decoding failed)
+    if (duk_is_function(ctx, 1)) {
+        subghzReadAsync(ctx, false);
+        return 0;
+    }
     String r = "";
     if (duk_is_number(ctx, 0))
         r = RCSwitch_Read(bruceConfigPins.rfFreq, duk_to_int(ctx, 0)); // custom timeout
@@ -70,6 +173,10 @@ duk_ret_t native_subghzRead(duk_context *ctx) {
 }
 
 duk_ret_t native_subghzReadRaw(duk_context *ctx) {
+    if (duk_is_function(ctx, 1)) {
+        subghzReadAsync(ctx, true);
+        return 0;
+    }
     String r = "";
     if (duk_is_number(ctx, 0))
         r = RCSwitch_Read(bruceConfigPins.rfFreq, duk_to_int(ctx, 0),
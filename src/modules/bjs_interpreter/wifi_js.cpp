@@ -1,18 +1,24 @@
 #if !defined(LITE_VERSION) && !defined(DISABLE_INTERPRETER)
 #include "wifi_js.h"
 
+#include "core/sd_functions.h"
 #include "core/wifi/wifi_common.h"
+#include "eventloop_js.h"
 #include "helpers_js.h"
 #include <HTTPClient.h>
 #include <WiFi.h>
+#include <WiFiClientSecure.h>
+#include <memory>
+#include <vector>
 
 duk_ret_t putPropWiFiFunctions(duk_context *ctx, duk_idx_t obj_idx, uint8_t magic) {
     bduk_put_prop_c_lightfunc(ctx, obj_idx, "connected", native_wifiConnected, 0, magic);
     bduk_put_prop_c_lightfunc(ctx, obj_idx, "connect", native_wifiConnect, 3, magic);
     bduk_put_prop_c_lightfunc(ctx, obj_idx, "connectDialog", native_wifiConnectDialog, 0, magic);
     bduk_put_prop_c_lightfunc(ctx, obj_idx, "disconnect", native_wifiDisconnect, 0, magic);
-    bduk_put_prop_c_lightfunc(ctx, obj_idx, "scan", native_wifiScan, 0, magic);
-    bduk_put_prop_c_lightfunc(ctx, obj_idx, "httpFetch", native_httpFetch, 2, magic);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "scan", native_wifiScan, 1, magic);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "httpFetch", native_httpFetch, 3, magic);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "httpOpen", native_httpOpen, 2, magic);
     bduk_put_prop_c_lightfunc(ctx, obj_idx, "getMACAddress", native_wifiMACAddress, 0, magic);
     bduk_put_prop_c_lightfunc(ctx, obj_idx, "getIPAddress", native_ipAddress, 0, magic);
     return 0;
@@ -22,9 +28,10 @@ duk_ret_t registerWiFi(duk_context *ctx) {
     bduk_register_c_lightfunc(ctx, "wifiConnect", native_wifiConnect, 3);
     bduk_register_c_lightfunc(ctx, "wifiConnectDialog", native_wifiConnectDialog, 0);
     bduk_register_c_lightfunc(ctx, "wifiDisconnect", native_wifiDisconnect, 0);
-    bduk_register_c_lightfunc(ctx, "wifiScan", native_wifiScan, 0);
-    bduk_register_c_lightfunc(ctx, "httpFetch", native_httpFetch, 2, 0);
-    bduk_register_c_lightfunc(ctx, "httpGet", native_httpFetch, 2, 0);
+    bduk_register_c_lightfunc(ctx, "wifiScan", native_wifiScan, 1);
+    bduk_register_c_lightfunc(ctx, "httpFetch", native_httpFetch, 3, 0);
+    bduk_register_c_lightfunc(ctx, "httpGet", native_httpFetch, 3, 0);
+    bduk_register_c_lightfunc(ctx, "httpOpen", native_httpOpen, 2, 0);
     bduk_register_c_lightfunc(ctx, "wifiMACAddress", native_wifiMACAddress, 0);
     bduk_register_c_lightfunc(ctx, "wifiIPAddress", native_ipAddress, 0);
     return 0;
@@ -96,9 +103,7 @@ const char *wifi_enc_types[] = {
     "MAX"
 };
 
-duk_ret_t native_wifiScan(duk_context *ctx) {
-    WiFi.mode(WIFI_MODE_STA);
-    int nets = WiFi.scanNetworks();
+static void pushScanResults(duk_context *ctx, int nets) {
     duk_idx_t arr_idx = duk_push_array(ctx);
     int arrayIndex = 0;
     duk_idx_t obj_idx;
@@ -114,6 +119,35 @@ duk_ret_t native_wifiScan(duk_context *ctx) {
         duk_put_prop_index(ctx, arr_idx, arrayIndex);
         arrayIndex++;
     }
+}
+
+duk_ret_t native_wifiScan(duk_context *ctx) {
+    // usage: wifiScan(): { encryptionType, SSID, MAC }[]
+    // usage: wifiScan(callback: (error, networks) => void), scans in the background
+    WiFi.mode(WIFI_MODE_STA);
+    if (duk_is_function(ctx, 0)) {
+        if (WiFi.scanNetworks(true) == WIFI_SCAN_FAILED) {
+            return duk_error(ctx, DUK_ERR_ERROR, "%s: Failed to start the scan.", "wifiScan");
+        }
+        js_async_poll(
+            ctx,
+            0,
+            []() { return WiFi.scanComplete() != WIFI_SCAN_RUNNING; },
+            [](duk_context *ctx) -> duk_idx_t {
+                int nets = WiFi.scanComplete();
+                if (nets < 0) {
+                    duk_push_string(ctx, "wifiScan: Scan failed.");
+                    return 1;
+                }
+                duk_push_null(ctx);
+                pushScanResults(ctx, nets);
+                return 2;
+            }
+        );
+        return 0;
+    }
+
+    pushScanResults(ctx, WiFi.scanNetworks());
     return 1;
 }
 
@@ -122,244 +156,832 @@ duk_ret_t native_wifiDisconnect(duk_context *ctx) {
     return 0;
 }
 
-duk_ret_t native_httpFetch(duk_context *ctx) {
-    HTTPClient http;
+/*********************************************************************
+**  HTTP: pooled keep-alive connections and streamed bodies
+**********************************************************************/
+// Idle connections kept per scheme://host:port. TLS sessions hold a lot of internal RAM, so only a few.
+#define HTTP_POOL_SIZE 2
+// Servers usually drop idle keep-alive connections after 5-60s
+#define HTTP_POOL_IDLE_MS 15000
+#define HTTP_READ_TIMEOUT_MS 30000
+#define HTTP_CHUNK_SIZE 4096
+
+struct HttpConnection {
+    String key; // scheme://host:port
+    bool secure = false;
+    bool tlsReady = false; // the TLS handshake went through, reconnects can't fall back to plain TCP
+    std::unique_ptr<WiFiClient> client;
+    // HTTPClient stops its client when destroyed, so it is kept alongside and declared after it
+    std::unique_ptr<HTTPClient> http;
+    uint32_t lastUsed = 0;
+    uint32_t generation = 0;
+};
 
-    http.setReuse(false);
+struct HttpTiming {
+    float dns = 0;
+    float connect = 0;
+    float tls = 0;
+    float firstByte = 0;
+    float total = 0;
+    bool reused = false;
+};
 
-    if (WiFi.status() != WL_CONNECTED) wifiConnectMenu();
+struct HttpRequest {
+    String url;
+    String method = "GET";
+    String body;
+    std::vector<std::pair<String, String>> headers;
+    bool asString = true;
+    bool keepAlive = true;
+    uint32_t timeoutMs = HTTP_READ_TIMEOUT_MS;
+    FS *bodyFs = NULL; // request body streamed from this file instead of `body`
+    String bodyPath;
+    FS *saveFs = NULL; // response body streamed to this file instead of memory
+    String savePath;
+};
 
-    if (WiFi.status() != WL_CONNECTED) { return duk_error(ctx, DUK_ERR_ERROR, "WIFI Not Connected"); }
+// Decodes a response body off the connection, identity or chunked, without holding it whole
+class HttpBodyReader {
+public:
+    void begin(WiFiClient *client, int contentLength, bool chunked, uint32_t timeoutMs);
+    // Reads up to len body bytes. Returns 0 once the body is complete, -1 if the connection stalls or drops.
+    int read(uint8_t *buffer, size_t len);
+    bool complete() const { return done; }
+    // Stops reading after the connection was dropped elsewhere
+    void abort() { failed = true; }
+
+private:
+    int readBody(uint8_t *buffer, size_t len);
+    bool waitForData();
+    bool readLine(String &line);
+
+    WiFiClient *client = NULL;
+    int64_t remaining = 0; // left in the body or current chunk; -1 reads until the connection closes
+    bool chunked = false;
+    bool done = true;
+    bool failed = false;
+    uint32_t timeoutMs = HTTP_READ_TIMEOUT_MS;
+};
 
-    // Your Domain name with URL path or IP address with path
-    http.begin(duk_to_string(ctx, 0));
+struct HttpResponse {
+    int status = 0;
+    String error;
+    std::vector<std::pair<String, String>> headers;
+    int contentLength = -1;
+    char *body = NULL;
+    size_t length = 0;
+    HttpTiming timing;
+    std::unique_ptr<HttpConnection> connection; // open while the body is still on it
+    HttpBodyReader reader;
+    ~HttpResponse() { free(body); }
+};
 
-    // Add Headers if headers are included.
-    if (duk_is_array(ctx, 1)) {
-        // Get the length of the array
-        duk_uint_t len = duk_get_length(ctx, 1);
-        for (duk_uint_t i = 0; i < len; i++) {
-            // Get each element in the array
-            duk_get_prop_index(ctx, 1, i);
+static std::vector<std::unique_ptr<HttpConnection>> httpPool;
+static SemaphoreHandle_t httpPoolMutex = NULL;
+static uint32_t httpPoolGeneration = 0;
 
-            // Ensure it's a string
-            if (!duk_is_string(ctx, -1)) {
-                duk_pop(ctx);
-                return duk_error(
-                    ctx, DUK_ERR_TYPE_ERROR, "%s: Header array elements must be strings.", "httpFetch"
-                );
-            }
+static inline float elapsedMs(uint32_t startMicros) { return (micros() - startMicros) / 1000.0f; }
 
-            // Get the string
-            const char *headerKey = duk_get_string(ctx, -1);
-            duk_pop(ctx);
-            i++;
-            duk_get_prop_index(ctx, 1, i);
+void HttpBodyReader::begin(WiFiClient *client, int contentLength, bool chunked, uint32_t timeoutMs) {
+    this->client = client;
+    this->chunked = chunked;
+    this->timeoutMs = timeoutMs;
+    remaining = chunked ? 0 : contentLength;
+    done = !chunked && contentLength == 0;
+    failed = false;
+}
 
-            // Ensure it's a string
-            if (!duk_is_string(ctx, -1)) {
-                return duk_error(
-                    ctx, DUK_ERR_TYPE_ERROR, "%s: Header array elements must be strings.", "httpFetch"
-                );
-            }
+bool HttpBodyReader::waitForData() {
+    uint32_t start = millis();
+    while (client->available() <= 0) {
+        if (!client->connected() || millis() - start > timeoutMs) return false;
+        delay(1);
+    }
+    return true;
+}
 
-            // Get the string
-            const char *headerValue = duk_get_string(ctx, -1);
-            duk_pop(ctx);
-            http.addHeader(headerKey, headerValue);
-        }
+bool HttpBodyReader::readLine(String &line) {
+    line = "";
+    while (true) {
+        if (!waitForData()) return false;
+        int c = client->read();
+        if (c == '\n') return true;
+        if (c != '\r' && line.length() < 128) line += (char)c;
     }
+}
 
-    const char *bodyRequest = NULL;
-    size_t bodyRequestLength = 0U;
-
-    const char *requestType = "GET";
-    uint8_t returnResponseType = 0;
-
-    if (duk_is_object(ctx, 1)) {
-        if (duk_get_prop_string(ctx, 1, "body")) {
-            duk_uint_t arg1Type = duk_get_type_mask(ctx, -1);
-            if (arg1Type & (DUK_TYPE_MASK_STRING | DUK_TYPE_MASK_NUMBER | DUK_TYPE_MASK_BOOLEAN)) {
-                bodyRequest = duk_to_string(ctx, -1);
-            } else if (arg1Type & DUK_TYPE_MASK_OBJECT) {
-                // JSON.stringify body if it's object type
-                duk_push_global_object(ctx);       /* -> [ global ] */
-                duk_push_string(ctx, "JSON");      /* -> [ global "JSON" ] */
-                duk_get_prop(ctx, -2);             /* -> [ global JSON ] */
-                duk_push_string(ctx, "stringify"); /* -> [ global Object "stringify" ] */
-                duk_get_prop(ctx, -2);             /* -> [ global Object stringify ] */
-
-                duk_dup(ctx, 1);
-                duk_pcall(ctx, 1);
-                bodyRequest = duk_to_string(ctx, -1);
-            }
-            bodyRequestLength = bodyRequest == NULL ? 0U : strlen(bodyRequest);
+int HttpBodyReader::read(uint8_t *buffer, size_t len) {
+    if (failed) return -1;
+    if (done || len == 0) return 0;
+    int n = readBody(buffer, len);
+    if (n < 0) failed = true;
+    return n;
+}
+
+int HttpBodyReader::readBody(uint8_t *buffer, size_t len) {
+    if (chunked && remaining == 0) {
+        String line;
+        if (!readLine(line)) return -1;
+        remaining = strtol(line.c_str(), NULL, 16); // stops at chunk extensions
+        if (remaining <= 0) {
+            // Skip any trailer headers up to the blank line that ends the message
+            do {
+                if (!readLine(line)) return -1;
+            } while (line.length() > 0);
+            done = true;
+            return 0;
         }
+    }
+    if (!waitForData()) {
+        if (remaining < 0 && !client->connected()) { // body delimited by the connection closing
+            done = true;
+            return 0;
+        }
+        return -1;
+    }
+    size_t toRead = len;
+    if (remaining > 0 && (int64_t)toRead > remaining) toRead = remaining;
+    int n = client->read(buffer, toRead);
+    if (n <= 0) return -1;
+    if (remaining > 0) {
+        remaining -= n;
+        if (remaining == 0) {
+            String crlf;
+            if (chunked && !readLine(crlf)) return -1; // CRLF closing the chunk
+            done = !chunked;
+        }
+    }
+    return n;
+}
+
+// Splits http(s)://[user@]host[:port]/... into the parts needed to open a connection
+static bool parseHttpUrl(const String &url, bool &secure, String &host, uint16_t &port) {
+    int schemeEnd = url.indexOf("://");
+    if (schemeEnd < 0) return false;
+    String scheme = url.substring(0, schemeEnd);
+    scheme.toLowerCase();
+    if (scheme != "http" && scheme != "https") return false;
+    secure = scheme == "https";
+    port = secure ? 443 : 80;
+
+    int start = schemeEnd + 3;
+    int end = start;
+    while (end < (int)url.length() && url[end] != '/' && url[end] != '?' && url[end] != '#') end++;
+    String authority = url.substring(start, end);
+    int at = authority.lastIndexOf('@');
+    if (at >= 0) authority = authority.substring(at + 1);
+
+    int colon = authority.lastIndexOf(':');
+    if (colon >= 0 && authority.indexOf(']', colon) < 0) {
+        port = authority.substring(colon + 1).toInt();
+        authority = authority.substring(0, colon);
+    }
+    if (authority.startsWith("[") && authority.endsWith("]")) {
+        authority = authority.substring(1, authority.length() - 1);
+    }
+    host = authority;
+    return host.length() > 0 && port > 0;
+}
+
+static void initHttpPool() {
+    if (httpPoolMutex == NULL) httpPoolMutex = xSemaphoreCreateMutex();
+}
 
-        if (duk_get_prop_string(ctx, 1, "method")) { requestType = duk_get_string_default(ctx, -1, "GET"); }
+static String httpPoolKey(bool secure, const String &host, uint16_t port) {
+    return String(secure ? "https://" : "http://") + host + ":" + port;
+}
 
-        if (duk_get_prop_string(ctx, 1, "responseType")) {
-            const char *returnResponseTypeString = duk_get_string_default(ctx, -1, "string");
-            returnResponseType = (strcmp(returnResponseTypeString, "string") == 0);
+// Takes an idle connection to `key` out of the pool, dropping any that sat idle for too long
+static std::unique_ptr<HttpConnection> takeHttpConnection(const String &key, bool secure) {
+    std::unique_ptr<HttpConnection> found;
+    std::vector<std::unique_ptr<HttpConnection>> expired;
+    xSemaphoreTake(httpPoolMutex, portMAX_DELAY);
+    for (auto it = httpPool.begin(); it != httpPool.end();) {
+        if (millis() - (*it)->lastUsed > HTTP_POOL_IDLE_MS) {
+            expired.push_back(std::move(*it));
+            it = httpPool.erase(it);
+        } else if (!found && (*it)->key == key && (*it)->secure == secure && (*it)->tlsReady == secure) {
+            found = std::move(*it);
+            it = httpPool.erase(it);
+        } else {
+            ++it;
         }
+    }
+    xSemaphoreGive(httpPoolMutex);
+    // Closing happens outside the lock, TLS teardown takes a moment
+    if (found && !found->client->connected()) found.reset();
+    return found;
+}
 
-        if (duk_get_prop_string(ctx, 1, "headers")) {
-            bool headersIsArray = duk_is_array(ctx, -1);
+// Returns a connection whose response was read to the end, evicting the oldest idle one if full
+static void releaseHttpConnection(std::unique_ptr<HttpConnection> connection) {
+    if (!connection || !connection->client->connected()) return;
+    std::unique_ptr<HttpConnection> evicted;
+    xSemaphoreTake(httpPoolMutex, portMAX_DELAY);
+    // Connections opened by a script that has since ended are not kept
+    if (connection->generation == httpPoolGeneration) {
+        connection->lastUsed = millis();
+        if (httpPool.size() >= HTTP_POOL_SIZE) {
+            evicted = std::move(httpPool.front());
+            httpPool.erase(httpPool.begin());
+        }
+        httpPool.push_back(std::move(connection));
+    }
+    xSemaphoreGive(httpPoolMutex);
+}
 
-            duk_enum(ctx, -1, 0);
-            while (duk_next(ctx, -1, 1)) {
-                const char *headerKey = NULL;
-                const char *headerValue = duk_get_string(ctx, -1);
-                if (!headersIsArray) { // If headers is object
-                    headerKey = duk_get_string(ctx, -2);
-                } else { // If headers is array
-                    if (duk_is_string(ctx, -1)) {
-                        headerKey = duk_get_string(ctx, -1);
-                        duk_pop_2(ctx);
-                        duk_bool_t isNextValue = duk_next(ctx, -1, 1);
-                        if (!isNextValue) break;
-                        headerValue = duk_get_string(ctx, -1);
-                    } else if (duk_is_array(ctx, -1)) {
-                        duk_get_prop_index(ctx, -1, 0);
-                        headerKey = duk_get_string(ctx, -1);
-                        duk_get_prop_index(ctx, -2, 1);
-                        headerValue = duk_get_string(ctx, -1);
-                        if (!duk_is_string(ctx, -1) || !duk_is_string(ctx, -2)) {
-                            duk_error(
-                                ctx,
-                                DUK_ERR_TYPE_ERROR,
-                                "%s: Header array elements must be strings.",
-                                "httpFetch"
-                            );
-                        }
-                        duk_pop_2(ctx);
-                    } else {
-                        duk_error(
-                            ctx, DUK_ERR_TYPE_ERROR, "%s: Header array elements must be strings.", "httpFetch"
-                        );
-                    }
-                }
-                duk_pop_2(ctx);
-                http.addHeader(headerKey, headerValue);
-            }
+void clearWiFiModuleData() {
+    if (httpPoolMutex == NULL) return;
+    std::vector<std::unique_ptr<HttpConnection>> closing;
+    xSemaphoreTake(httpPoolMutex, portMAX_DELAY);
+    closing.swap(httpPool);
+    httpPoolGeneration++;
+    xSemaphoreGive(httpPoolMutex);
+}
+
+// Resolves and connects by hand rather than leaving it to HTTPClient, so each step can be timed
+static std::unique_ptr<HttpConnection> openHttpConnection(
+    const String &key, bool secure, const String &host, uint16_t port, HttpTiming &timing, String &error
+) {
+    IPAddress ip;
+    uint32_t start = micros();
+    if (!WiFi.hostByName(host.c_str(), ip)) {
+        error = "httpFetch: DNS lookup failed for " + host;
+        return nullptr;
+    }
+    timing.dns = elapsedMs(start);
+
+    std::unique_ptr<HttpConnection> connection(new HttpConnection());
+    connection->key = key;
+    connection->secure = secure;
+    connection->generation = httpPoolGeneration;
+
+    start = micros();
+    if (secure) {
+        WiFiClientSecure *tls = new WiFiClientSecure();
+        connection->client.reset(tls);
+        tls->setInsecure();
+        // Plain TCP first, so the handshake can be timed on its own
+        tls->setPlainStart();
+        if (!tls->connect(ip, port, host.c_str(), NULL, NULL, NULL)) {
+            error = "httpFetch: Connection failed";
+            return nullptr;
+        }
+        timing.connect = elapsedMs(start);
+        start = micros();
+        if (!tls->startTLS()) {
+            error = "httpFetch: TLS handshake failed";
+            return nullptr;
+        }
+        timing.tls = elapsedMs(start);
+        connection->tlsReady = true;
+    } else {
+        connection->client.reset(new WiFiClient());
+        if (!connection->client->connect(ip, port)) {
+            error = "httpFetch: Connection failed";
+            return nullptr;
         }
+        timing.connect = elapsedMs(start);
     }
+    connection->http.reset(new HTTPClient());
+    return connection;
+}
+
+// Request body handed to HTTPClient as a stream, noting when its last byte went out so that
+// timing.firstByte leaves the upload out
+class HttpBodyStream : public Stream {
+public:
+    HttpBodyStream(Stream *file, const uint8_t *data, size_t size) : file(file), data(data), size(size) {}
+
+    uint32_t sentAt = micros();
+
+    int available() override { return size - pos; }
+    int read() override {
+        char c;
+        return readBytes(&c, 1) == 1 ? (uint8_t)c : -1;
+    }
+    int peek() override { return pos < size ? (file ? file->peek() : data[pos]) : -1; }
+    size_t readBytes(char *buffer, size_t length) override {
+        if (length > size - pos) length = size - pos;
+        size_t n = length;
+        if (file) n = file->readBytes(buffer, length);
+        else memcpy(buffer, data + pos, length);
+        pos += n;
+        if (pos == size) sentAt = micros();
+        return n;
+    }
+    size_t write(uint8_t) override { return 0; }
+
+private:
+    Stream *file;
+    const uint8_t *data;
+    size_t size;
+    size_t pos = 0;
+};
+
+// sentAt: when the request body was sent, what timing.firstByte counts from
+static int sendHttpRequest(
+    HttpConnection &connection, const HttpRequest &request, uint32_t &sentAt, String &error
+) {
+    HTTPClient &http = *connection.http;
+    http.setReuse(request.keepAlive);
+    if (!http.begin(*connection.client, request.url)) {
+        error = "httpFetch: Invalid URL";
+        return 0;
+    }
+    for (auto &header : request.headers) http.addHeader(header.first, header.second);
 
     // HTTPClient doesn't store headers unless you explicitly use collectHeaders
     // TODO: Collect all headers manually
     const char *headersKeys[] = {
-        "Content-Type", "Content-Length", "Transfer-Encoding", "Connection", "Cache-Control", "Date", "Server"
+        "Content-Type",
+        "Content-Length",
+        "Transfer-Encoding",
+        "Connection",
+        "Cache-Control",
+        "Date",
+        "Server"
     };
     http.collectHeaders(headersKeys, 7);
 
-    // Send HTTP request
     // MEMO: Docs is wrong: sendRequest returns httpResponseCode not
     // Content-Length
-    int httpResponseCode = http.sendRequest(requestType, (uint8_t *)bodyRequest, bodyRequestLength);
+    if (request.bodyFs == NULL) {
+        HttpBodyStream body(NULL, (const uint8_t *)request.body.c_str(), request.body.length());
+        int httpResponseCode = http.sendRequest(request.method.c_str(), &body, request.body.length());
+        sentAt = body.sentAt;
+        return httpResponseCode;
+    }
+    File file = request.bodyFs->open(request.bodyPath, FILE_READ);
+    if (!file) {
+        error = "httpFetch: Could not open body file: " + request.bodyPath;
+        return 0;
+    }
+    HttpBodyStream body(&file, NULL, file.size());
+    int httpResponseCode = http.sendRequest(request.method.c_str(), &body, file.size());
+    sentAt = body.sentAt;
+    file.close();
+    return httpResponseCode;
+}
 
+// Sends the request and reads the status line and headers. The body is left on response.connection
+// for response.reader. Doesn't touch the Duktape heap, so it can run on a worker.
+static void startHttpRequest(const HttpRequest &request, HttpResponse &response) {
+    uint32_t start = micros();
+    bool secure;
+    String host;
+    uint16_t port;
+    if (!parseHttpUrl(request.url, secure, host, port)) {
+        response.error = "httpFetch: Unsupported URL: " + request.url;
+        return;
+    }
+    String key = httpPoolKey(secure, host, port);
+
+    std::unique_ptr<HttpConnection> connection;
+    if (request.keepAlive) connection = takeHttpConnection(key, secure);
+    int httpResponseCode = 0;
+    for (int attempt = 0; attempt < 2; attempt++) {
+        response.timing.reused = connection != nullptr;
+        if (!connection) {
+            connection = openHttpConnection(key, secure, host, port, response.timing, response.error);
+            if (!connection) return;
+        }
+        uint32_t sent = micros();
+        httpResponseCode = sendHttpRequest(*connection, request, sent, response.error);
+        response.timing.firstByte = elapsedMs(sent);
+        if (httpResponseCode > 0 || !response.error.isEmpty() || !response.timing.reused) break;
+        // The server may have closed the pooled connection since, so try once more on a fresh one
+        connection.reset();
+    }
+    response.timing.total = elapsedMs(start);
     if (httpResponseCode <= 0) {
-        return duk_error(ctx, DUK_ERR_ERROR, http.errorToString(httpResponseCode).c_str());
+        if (response.error.isEmpty()) response.error = HTTPClient::errorToString(httpResponseCode);
+        return;
     }
 
-    WiFiClient *stream = http.getStreamPtr();
+    HTTPClient &http = *connection->http;
+    response.status = httpResponseCode;
+    for (int i = 0; i < http.headers(); i++) {
+        if (http.hasHeader(http.headerName(i).c_str())) {
+            response.headers.push_back({http.headerName(i), http.header(i)});
+        }
+    }
 
-    int contentLength = http.getSize();
-    bool isChunked = false;
-    if (contentLength == -1) {
-        String transferEncoding = http.header("transfer-encoding");
-        isChunked = transferEncoding.equalsIgnoreCase("chunked");
+    response.contentLength = http.getSize();
+    bool isChunked = http.header("Transfer-Encoding").equalsIgnoreCase("chunked");
+    // These never carry a body, whatever the headers say
+    if (request.method.equalsIgnoreCase("HEAD") || httpResponseCode == 204 || httpResponseCode == 304) {
+        response.contentLength = 0;
+        isChunked = false;
     }
+    response.reader.begin(connection->client.get(), response.contentLength, isChunked, request.timeoutMs);
+    response.connection = std::move(connection);
+}
 
-    duk_idx_t headersObjectIdx = duk_push_object(ctx);
-    for (size_t i = 0; i < http.headers(); i++) {
-        bduk_put_prop(
-            ctx, headersObjectIdx, http.headerName(i).c_str(), duk_push_string, http.header(i).c_str()
-        );
+// Hands the connection back to the pool once the body has been read to the end, closes it otherwise
+static void finishHttpResponse(HttpResponse &response) {
+    if (!response.connection) return;
+    if (response.reader.complete()) {
+        response.connection->http->end();
+        releaseHttpConnection(std::move(response.connection));
     }
+    response.connection.reset();
+}
 
-    bool psramFoundValue = psramFound();
-    int payloadSize = 1; // MEMO: 1 for null terminated string
-    char *payload = NULL;
-    duk_idx_t obj_idx = duk_push_object(ctx);
-    if (!isChunked) {
-        payloadSize = contentLength < 1 ? (psramFoundValue ? 16384 : 4096) : contentLength + 1;
-        payload = (char *)duk_push_fixed_buffer(ctx, payloadSize);
+static bool reserveHttpBody(HttpResponse &response, size_t &capacity, size_t needed) {
+    if (needed <= capacity) return true;
+    size_t newCapacity = capacity * 2 > needed ? capacity * 2 : needed;
+    char *body = (char *)(psramFound() ? ps_realloc(response.body, newCapacity)
+                                       : realloc(response.body, newCapacity));
+    if (body == NULL) return false;
+    response.body = body;
+    capacity = newCapacity;
+    return true;
+}
 
-        if (payload == NULL) {
-            return duk_error(ctx, DUK_ERR_ERROR, "%s: Memory allocation failed!", "httpFetch");
+static void readHttpBodyToMemory(HttpResponse &response) {
+    size_t capacity = 0;
+    size_t initial = response.contentLength >= 0 ? response.contentLength + 1 : 4096;
+    if (!reserveHttpBody(response, capacity, initial)) {
+        response.error = "httpFetch: Memory allocation failed!";
+        return;
+    }
+    while (true) {
+        if (response.length + 1 >= capacity && !reserveHttpBody(response, capacity, capacity + 1)) {
+            response.error = "httpFetch: Memory allocation failed!";
+            break;
         }
+        uint8_t *tail = (uint8_t *)response.body + response.length;
+        int n = response.reader.read(tail, capacity - 1 - response.length);
+        if (n < 0) Serial.println("Timeout while reading response!");
+        if (n <= 0) break;
+        response.length += n;
     }
+    response.body[response.length] = '\0';
+}
 
-    unsigned long startMillis = millis();
-    const unsigned long timeoutMillis = 30000;
-
-    size_t bytesRead = 0;
-    while (http.connected()) {
-        if (millis() - startMillis > timeoutMillis) {
-            Serial.println("Timeout while reading response!");
+static void readHttpBodyToFile(const HttpRequest &request, HttpResponse &response) {
+    File file = request.saveFs->open(request.savePath, FILE_WRITE, true);
+    if (!file) {
+        response.error = "httpFetch: Could not open file: " + request.savePath;
+        return;
+    }
+    uint8_t *chunk = (uint8_t *)malloc(HTTP_CHUNK_SIZE);
+    if (chunk == NULL) {
+        response.error = "httpFetch: Memory allocation failed!";
+        file.close();
+        return;
+    }
+    while (true) {
+        int n = response.reader.read(chunk, HTTP_CHUNK_SIZE);
+        if (n < 0) Serial.println("Timeout while reading response!");
+        if (n <= 0) break;
+        if (file.write(chunk, n) != (size_t)n) {
+            response.error = "httpFetch: Write failed: " + request.savePath;
             break;
         }
+        response.length += n;
+    }
+    free(chunk);
+    file.close();
+}
 
-        if (isChunked) { // if header Transfer-Encoding: chunked
-            // Read chunk size
-            String chunkSizeStr = stream->readStringUntil('\r');
-            stream->read();                                         // Consume '\n'
-            int chunkSize = strtol(chunkSizeStr.c_str(), NULL, 16); // Convert hex to int
-            if (chunkSize == 0) break;                              // Last chunk
-
-            payloadSize += chunkSize;
-            if (payload == NULL) {
-                payload = (char *)duk_push_dynamic_buffer(ctx, payloadSize);
-            } else {
-                payload = (char *)duk_resize_buffer(ctx, -1, payloadSize);
-            }
+// Runs the request and reads the whole body. Doesn't touch the Duktape heap, so it can run on a worker.
+static void performHttpRequest(const HttpRequest &request, HttpResponse &response) {
+    uint32_t start = micros();
+    startHttpRequest(request, response);
+    if (!response.error.isEmpty()) return;
 
-            if (payload == NULL) {
-                return duk_error(ctx, DUK_ERR_ERROR, "%s: Memory allocation failed!", "httpFetch");
-            }
+    if (request.saveFs != NULL) readHttpBodyToFile(request, response);
+    else readHttpBodyToMemory(response);
 
-            // Read chunk data
-            int toRead = chunkSize;
-            while (toRead > 0) {
-                int readNow = stream->readBytes(payload + bytesRead, toRead);
-                if (readNow <= 0) break;
-                bytesRead += readNow;
-                toRead -= readNow;
-            }
+    finishHttpResponse(response);
+    response.timing.total = elapsedMs(start);
+}
+
+static void addHttpHeader(duk_context *ctx, HttpRequest &request, duk_idx_t keyIdx, duk_idx_t valueIdx) {
+    if (!duk_is_string(ctx, keyIdx) || !duk_is_string(ctx, valueIdx)) {
+        duk_error(ctx, DUK_ERR_TYPE_ERROR, "%s: Header array elements must be strings.", "httpFetch");
+    }
+    request.headers.push_back({duk_get_string(ctx, keyIdx), duk_get_string(ctx, valueIdx)});
+}
 
-            // Consume trailing "\r\n" after chunk
-            stream->read();
-            stream->read();
+// Reads a file option given as a path or { fs, path }. Without fs, files to read are looked up on the
+// SD card first and files to write go to the SD card when it is mounted, like the storage module does.
+static bool readHttpFileOption(duk_context *ctx, const char *name, bool forWriting, FS *&fs, String &path) {
+    if (!duk_get_prop_string(ctx, 1, name) || duk_is_null_or_undefined(ctx, -1)) {
+        duk_pop(ctx);
+        return false;
+    }
+    String fsParam = "";
+    if (duk_is_object(ctx, -1)) {
+        duk_get_prop_string(ctx, -1, "fs");
+        fsParam = duk_get_string_default(ctx, -1, "");
+        duk_get_prop_string(ctx, -2, "path");
+        path = duk_to_string(ctx, -1);
+        duk_pop_2(ctx);
+    } else {
+        path = duk_to_string(ctx, -1);
+    }
+    duk_pop(ctx);
+    if (!path.startsWith("/")) path = "/" + path;
 
-        } else {
-            int streamSize = stream->available();
-            if (streamSize > 0) {
-                size_t toRead = (streamSize > 512) ? 512 : streamSize;
-                if ((bytesRead + toRead + 1) > payloadSize) break;
-                int bytesReceived = stream->readBytes(payload + bytesRead, toRead);
-
-                bytesRead += bytesReceived;
-            } else {
-                delay(1);
+    fsParam.toLowerCase();
+    if (fsParam == "sd") fs = &SD;
+    else if (fsParam == "littlefs") fs = &LittleFS;
+    else if (sdcardMounted && (forWriting || SD.exists(path))) fs = &SD;
+    else fs = &LittleFS;
+
+    if (!forWriting && !fs->exists(path)) {
+        duk_error(ctx, DUK_ERR_ERROR, "%s: File: %s does not exist", "httpFetch", path.c_str());
+    }
+    return true;
+}
+
+// Copies url and options out of the arguments, so the request can be performed after this call returns
+static void readHttpRequest(duk_context *ctx, HttpRequest &request) {
+    request.url = duk_to_string(ctx, 0);
+
+    // Legacy form: httpFetch(url, [key, value, key, value...])
+    if (duk_is_array(ctx, 1)) {
+        duk_uint_t len = duk_get_length(ctx, 1);
+        for (duk_uint_t i = 0; i < len; i += 2) {
+            duk_get_prop_index(ctx, 1, i);
+            duk_get_prop_index(ctx, 1, i + 1);
+            addHttpHeader(ctx, request, -2, -1);
+            duk_pop_2(ctx);
+        }
+        return;
+    }
+    if (!duk_is_object(ctx, 1) || duk_is_function(ctx, 1)) return;
+
+    if (duk_get_prop_string(ctx, 1, "body")) {
+        duk_uint_t bodyType = duk_get_type_mask(ctx, -1);
+        if (bodyType & (DUK_TYPE_MASK_STRING | DUK_TYPE_MASK_NUMBER | DUK_TYPE_MASK_BOOLEAN)) {
+            request.body = duk_to_string(ctx, -1);
+        } else if (bodyType & DUK_TYPE_MASK_OBJECT) {
+            // JSON.stringify body if it's object type
+            request.body = duk_json_encode(ctx, -1);
+        }
+    }
+    duk_pop(ctx);
+    readHttpFileOption(ctx, "bodyFile", false, request.bodyFs, request.bodyPath);
+    readHttpFileOption(ctx, "saveTo", true, request.saveFs, request.savePath);
+
+    if (duk_get_prop_string(ctx, 1, "method")) request.method = duk_get_string_default(ctx, -1, "GET");
+    duk_pop(ctx);
+
+    if (duk_get_prop_string(ctx, 1, "responseType")) {
+        request.asString = strcmp(duk_get_string_default(ctx, -1, "string"), "string") == 0;
+    }
+    duk_pop(ctx);
+
+    if (duk_get_prop_string(ctx, 1, "keepAlive")) request.keepAlive = duk_to_boolean(ctx, -1);
+    duk_pop(ctx);
+
+    if (duk_get_prop_string(ctx, 1, "timeout")) {
+        request.timeoutMs = duk_get_uint_default(ctx, -1, request.timeoutMs);
+    }
+    duk_pop(ctx);
+
+    if (duk_get_prop_string(ctx, 1, "headers")) {
+        if (duk_is_array(ctx, -1)) {
+            // [key, value, key, value...] or [[key, value], ...]
+            duk_uint_t len = duk_get_length(ctx, -1);
+            for (duk_uint_t i = 0; i < len; i++) {
+                duk_get_prop_index(ctx, -1, i);
+                if (duk_is_array(ctx, -1)) {
+                    duk_get_prop_index(ctx, -1, 0);
+                    duk_get_prop_index(ctx, -2, 1);
+                    addHttpHeader(ctx, request, -2, -1);
+                    duk_pop_3(ctx);
+                } else {
+                    duk_get_prop_index(ctx, -2, ++i);
+                    addHttpHeader(ctx, request, -2, -1);
+                    duk_pop_2(ctx);
+                }
+            }
+        } else if (duk_is_object(ctx, -1)) {
+            duk_enum(ctx, -1, 0);
+            while (duk_next(ctx, -1, 1)) {
+                request.headers.push_back({duk_get_string(ctx, -2), duk_to_string(ctx, -1)});
+                duk_pop_2(ctx);
             }
-            if ((bytesRead + 1) >= payloadSize) break;
+            duk_pop(ctx);
         }
-        startMillis = millis();
     }
-    if (payload != NULL) { payload[bytesRead] = '\0'; }
+    duk_pop(ctx);
+}
+
+// Common fields of httpFetch responses and httpOpen handles
+static void putHttpResponseInfo(duk_context *ctx, duk_idx_t obj_idx, const HttpResponse &response) {
+    duk_idx_t headersObjectIdx = duk_push_object(ctx);
+    for (auto &header : response.headers) {
+        bduk_put_prop(ctx, headersObjectIdx, header.first.c_str(), duk_push_string, header.second.c_str());
+    }
+    duk_put_prop_string(ctx, obj_idx, "headers");
+
+    bduk_put_prop(ctx, obj_idx, "response", duk_push_int, response.status);
+    bduk_put_prop(ctx, obj_idx, "status", duk_push_int, response.status);
+    bduk_put_prop(ctx, obj_idx, "ok", duk_push_boolean, response.status >= 200 && response.status < 300);
+
+    duk_idx_t timing_idx = duk_push_object(ctx);
+    bduk_put_prop(ctx, timing_idx, "dns", duk_push_number, response.timing.dns);
+    bduk_put_prop(ctx, timing_idx, "connect", duk_push_number, response.timing.connect);
+    bduk_put_prop(ctx, timing_idx, "tls", duk_push_number, response.timing.tls);
+    bduk_put_prop(ctx, timing_idx, "firstByte", duk_push_number, response.timing.firstByte);
+    bduk_put_prop(ctx, timing_idx, "total", duk_push_number, response.timing.total);
+    bduk_put_prop(ctx, timing_idx, "reused", duk_push_boolean, response.timing.reused);
+    duk_put_prop_string(ctx, obj_idx, "timing");
+}
+
+static void pushHttpResponse(duk_context *ctx, const HttpRequest &request, const HttpResponse &response) {
+    duk_idx_t obj_idx = duk_push_object(ctx);
+    if (request.saveFs != NULL) {
+        bduk_put_prop(ctx, obj_idx, "file", duk_push_string, request.savePath.c_str());
+    } else if (request.asString) {
+        duk_push_lstring(ctx, response.body != NULL ? response.body : "", response.length);
+        duk_put_prop_string(ctx, obj_idx, "body");
+    } else {
+        void *data = duk_push_fixed_buffer(ctx, response.length);
+        if (response.length > 0) memcpy(data, response.body, response.length);
+        duk_push_buffer_object(ctx, -1, 0, response.length, DUK_BUFOBJ_UINT8ARRAY);
+        duk_remove(ctx, -2);
+        duk_put_prop_string(ctx, obj_idx, "body");
+    }
+    bduk_put_prop(ctx, obj_idx, "length", duk_push_uint, response.length);
+    putHttpResponseInfo(ctx, obj_idx, response);
+}
+
+static bool ensureWiFiConnected() {
+    if (WiFi.status() != WL_CONNECTED) wifiConnectMenu();
+    return WiFi.status() == WL_CONNECTED;
+}
+
+duk_ret_t native_httpFetch(duk_context *ctx) {
+    // usage: httpFetch(url: string, options?: { method, body, headers, responseType, bodyFile, saveTo,
+    //        keepAlive, timeout }): Response
+    // usage: httpFetch(url: string, options?, callback: (error, response) => void), runs on a worker task
+    // bodyFile streams the request body from a file, saveTo streams the response body into one.
+    // Connections are kept alive and reused per host unless keepAlive is false.
+    if (!ensureWiFiConnected()) { return duk_error(ctx, DUK_ERR_ERROR, "WIFI Not Connected"); }
+    initHttpPool();
+
+    duk_idx_t callbackIdx = duk_is_function(ctx, 2) ? 2 : (duk_is_function(ctx, 1) ? 1 : -1);
+    if (callbackIdx >= 0) {
+        std::shared_ptr<HttpRequest> request = std::make_shared<HttpRequest>();
+        std::shared_ptr<HttpResponse> response = std::make_shared<HttpResponse>();
+        readHttpRequest(ctx, *request);
+        js_async_worker(
+            ctx,
+            callbackIdx,
+            [request, response]() { performHttpRequest(*request, *response); },
+            [request, response](duk_context *ctx) -> duk_idx_t {
+                if (!response->error.isEmpty()) {
+                    duk_push_string(ctx, response->error.c_str());
+                    return 1;
+                }
+                duk_push_null(ctx);
+                pushHttpResponse(ctx, *request, *response);
+                return 2;
+            },
+            12288 // TLS handshakes need the room
+        );
+        return 0;
+    }
+
+    HttpRequest request;
+    HttpResponse response;
+    readHttpRequest(ctx, request);
+    performHttpRequest(request, response);
+    if (!response.error.isEmpty()) return duk_error(ctx, DUK_ERR_ERROR, "%s", response.error.c_str());
+    pushHttpResponse(ctx, request, response);
+    return 1;
+}
+
+/*********************************************************************
+**  httpOpen(): streamed response bodies
+**********************************************************************/
+static HttpResponse *getHttpStreamPointer(duk_context *ctx) {
+    HttpResponse *response = NULL;
+    duk_push_this(ctx);
+    if (duk_get_prop_string(ctx, -1, DUK_HIDDEN_SYMBOL("httpStream"))) {
+        response = (HttpResponse *)duk_to_pointer(ctx, -1);
+    }
+    duk_pop_2(ctx);
+    if (response == NULL) duk_error(ctx, DUK_ERR_ERROR, "%s: stream is closed", "httpOpen");
+    return response;
+}
+
+static int readHttpStream(duk_context *ctx, HttpResponse *response, uint8_t *buf, size_t len) {
+    int n = response->reader.read(buf, len);
+    if (n < 0) {
+        response->reader.abort();
+        response->connection.reset();
+        duk_error(ctx, DUK_ERR_ERROR, "%s: Timeout while reading response", "httpOpen");
+    }
+    response->length += n;
+    // Done with the connection as soon as the body ends, so the next request can reuse it
+    if (response->reader.complete()) finishHttpResponse(*response);
+    return n;
+}
+
+duk_ret_t native_httpStreamRead(duk_context *ctx) {
+    // usage: stream.read(buffer: Uint8Array, length?: number): number
+    //        fills an existing buffer in place and returns the bytes read (0 at the end of the body)
+    // usage: stream.read(length?: number): Uint8Array
+    //        new buffer with up to `length` bytes (4096 by default), empty at the end of the body
+    HttpResponse *response = getHttpStreamPointer(ctx);
+
+    if (duk_is_buffer_data(ctx, 0)) {
+        duk_size_t bufSize;
+        uint8_t *buf = (uint8_t *)duk_get_buffer_data(ctx, 0, &bufSize);
+        size_t len = duk_get_uint_default(ctx, 1, bufSize);
+        if (len > bufSize) len = bufSize;
+        duk_push_uint(ctx, readHttpStream(ctx, response, buf, len));
+        return 1;
+    }
 
-    if (returnResponseType == 0) {
-        duk_buffer_to_string(ctx, -1);
+    size_t len = duk_get_uint_default(ctx, 0, HTTP_CHUNK_SIZE);
+    void *buf = duk_push_fixed_buffer(ctx, len);
+    int bytesRead = readHttpStream(ctx, response, (uint8_t *)buf, len);
+    duk_push_buffer_object(ctx, -1, 0, bytesRead, DUK_BUFOBJ_UINT8ARRAY);
+    return 1;
+}
+
+duk_ret_t native_httpStreamDone(duk_context *ctx) {
+    // usage: stream.done(): boolean
+    duk_push_boolean(ctx, getHttpStreamPointer(ctx)->reader.complete());
+    return 1;
+}
+
+duk_ret_t native_httpStreamClose(duk_context *ctx) {
+    // usage: stream.close(): void
+    // also the finalizer, which receives the handle as its first argument.
+    // Closing before the body was read to the end drops the connection instead of pooling it.
+    if (duk_is_object(ctx, 0)) {
+        duk_dup(ctx, 0);
     } else {
-        duk_push_buffer_object(ctx, -1, 0, payloadSize, DUK_BUFOBJ_UINT8ARRAY);
+        duk_push_this(ctx);
     }
-    duk_put_prop_string(ctx, obj_idx, "body");
-    bduk_put_prop(ctx, obj_idx, "response", duk_push_int, httpResponseCode);
-    bduk_put_prop(ctx, obj_idx, "status", duk_push_int, httpResponseCode);
-    bduk_put_prop(ctx, obj_idx, "ok", duk_push_boolean, httpResponseCode >= 200 && httpResponseCode < 300);
+    duk_idx_t obj_idx = duk_get_top_index(ctx);
+
+    HttpResponse *response = NULL;
+    if (duk_get_prop_string(ctx, obj_idx, DUK_HIDDEN_SYMBOL("httpStream"))) {
+        response = (HttpResponse *)duk_get_pointer(ctx, -1);
+    }
+    duk_pop(ctx);
+    bduk_put_prop(ctx, obj_idx, DUK_HIDDEN_SYMBOL("httpStream"), duk_push_pointer, NULL);
+
+    if (response != NULL) {
+        finishHttpResponse(*response);
+        delete response;
+    }
+    return 0;
+}
+
+duk_ret_t native_httpOpen(duk_context *ctx) {
+    // usage: httpOpen(url: string, options?: { method, body, headers, bodyFile, keepAlive, timeout }):
+    //        HttpStream
+    // Returns once the headers are in (timing.total stops there); the body is then pulled with read()
+    // in chunks of the script's choosing.
+    // The handle has status, ok, headers, length (Content-Length or -1), timing, read, done and close.
+    // The body is read by the script, so the options that decide where it goes don't apply
+    if (duk_is_object(ctx, 1) && !duk_is_array(ctx, 1)) {
+        for (const char *option : {"saveTo", "responseType"}) {
+            if (duk_has_prop_string(ctx, 1, option)) {
+                return duk_error(
+                    ctx, DUK_ERR_TYPE_ERROR, "%s: option %s is not supported", "httpOpen", option
+                );
+            }
+        }
+    }
+    if (!ensureWiFiConnected()) { return duk_error(ctx, DUK_ERR_ERROR, "WIFI Not Connected"); }
+    initHttpPool();
+
+    HttpRequest request;
+    readHttpRequest(ctx, request);
+    HttpResponse *response = new HttpResponse();
+    startHttpRequest(request, *response);
+    if (!response->error.isEmpty()) {
+        String error = response->error;
+        delete response;
+        return duk_error(ctx, DUK_ERR_ERROR, "%s", error.c_str());
+    }
+    if (response->reader.complete()) finishHttpResponse(*response);
+
+    duk_idx_t obj_idx = duk_push_object(ctx);
+    bduk_put_prop(ctx, obj_idx, DUK_HIDDEN_SYMBOL("httpStream"), duk_push_pointer, response);
+    bduk_put_prop(ctx, obj_idx, "length", duk_push_int, response->contentLength);
+    putHttpResponseInfo(ctx, obj_idx, *response);
+
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "read", native_httpStreamRead, 2, 0);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "done", native_httpStreamDone, 0, 0);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "close", native_httpStreamClose, 0, 0);
+
+    duk_push_c_lightfunc(ctx, native_httpStreamClose, 1, 1, 0);
+    duk_set_finalizer(ctx, obj_idx);
 
-    // Free resources
-    http.end();
     return 1;
 }
 
@@ -6,6 +6,7 @@
 
 duk_ret_t putPropWiFiFunctions(duk_context *ctx, duk_idx_t obj_idx, uint8_t magic);
 duk_ret_t registerWiFi(duk_context *ctx);
+void clearWiFiModuleData();
 
 duk_ret_t native_wifiConnected(duk_context *ctx);
 duk_ret_t native_wifiConnectDialog(duk_context *ctx);
@@ -13,6 +14,10 @@ duk_ret_t native_wifiConnect(duk_context *ctx);
 duk_ret_t native_wifiScan(duk_context *ctx);
 duk_ret_t native_wifiDisconnect(duk_context *ctx);
 duk_ret_t native_httpFetch(duk_context *ctx);
+duk_ret_t native_httpOpen(duk_context *ctx);
+duk_ret_t native_httpStreamRead(duk_context *ctx);
+duk_ret_t native_httpStreamDone(duk_context *ctx);
+duk_ret_t native_httpStreamClose(duk_context *ctx);
 duk_ret_t native_wifiMACAddress(duk_context *ctx);
 duk_ret_t native_ipAddress(duk_context *ctx);
 
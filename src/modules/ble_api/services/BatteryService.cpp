@@ -1,6 +1,7 @@
 #if !defined(LITE_VERSION)
 #include "BatteryService.hpp"
 #include "ArduinoJson.h"
+#include "core/profiler.h"
 #include <NimBLEDevice.h>
 #include <NimBLEUtils.h>
 #include <WiFi.h>
@@ -35,6 +36,7 @@ void BatteryService::setup(BLEServer *pServer) {
     pService->start();
     pServer->getAdvertising()->addServiceUUID(pService->getUUID());
 
+    profilerTaskStack("battery_ble_handler", 2048);
     xTaskCreate(
         battery_handler_task,
         "battery_ble_handler",
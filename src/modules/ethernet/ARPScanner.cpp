@@ -243,6 +243,9 @@ ScanHostMenu:
         if (host.ip == gateway) result += "(GTW)";
         options.push_back({result.c_str(), [this, host]() { afterScanOptions(host); }});
     }
+    if (wifiConnected && hostslist_eth.size() > 1) {
+        options.push_back({"Deauth all hosts", [this]() { stationDeauth(hostslist_eth); }});
+    }
     addOptionToMainMenu();
 
     loopOptions(options);
@@ -280,8 +283,6 @@ bool ARPScanner::macStringToByteArray(const std::string &macStr, uint8_t macArra
     return byteCount == 6;
 }
 void ARPScanner::afterScanOptions(const Host &host) {
-    int opt = 0;
-    IPAddress gw = gateway;
     options = {
         {"Host info",
          [=]() {
@@ -300,32 +301,35 @@ void ARPScanner::afterScanOptions(const Host &host) {
                  stationDeauth(host);
              }
          }},
-        {"ARP Spoofing",
-         [this, host, gw]() {
-             auto it = std::find_if(hostslist_eth.begin(), hostslist_eth.end(), [this](const Host &host) {
-                 return host.ip == gateway;
-             });
-
-             uint8_t mac[6];
-             esp_err_t err = esp_netif_get_mac(esp_net_interface, mac);
-             if (err == ESP_OK) {
-                 uint8_t gw_mac[6];
-                 macStringToByteArray((*it).mac.c_str(), gw_mac);
-                 ARPSpoofer(host, gw, gw_mac, mac, false);
-             } else {
-                 ESP_LOGE("MAC Address", "Failed to get MAC address: %s", esp_err_to_name(err));
-             }
-         }},
+        {"ARP Spoofing", [this, host]() { startSpoofer(host, false); }},
+        {"ARP MITM",     [this, host]() { startSpoofer(host, true); } },
 #if !defined(LITE_VERSION)
         {"ARP Poisoning", [this]() { ARPoisoner{gateway}; }},
         {"DHCP Starvation", [=]() { DHCPStarvation(); }      },
         {"MAC Flooding",    [=]() { MACFlooding(); }         },
 #endif
     };
-    // if(sdcardMounted && bruceConfig.devMode) options.push_back({"ARP MITM (WIP)",  [&](){ opt=5;  }});
     loopOptions(options);
-    if (opt == 5) {
-        Serial.println("Starting MITM");
-        // arpSpoofing(host, true);
+}
+
+void ARPScanner::startSpoofer(const Host &host, bool mitm) {
+    auto it = std::find_if(hostslist_eth.begin(), hostslist_eth.end(), [this](const Host &host) {
+        return host.ip == gateway;
+    });
+    if (it == hostslist_eth.end()) {
+        displayError("Gateway MAC not found");
+        return;
+    }
+
+    uint8_t mac[6];
+    esp_err_t err = esp_netif_get_mac(esp_net_interface, mac);
+    if (err == ESP_OK) {
+        uint8_t gw_mac[6];
+        macStringToByteArray((*it).mac.c_str(), gw_mac);
+        ARPSpoofer(
+            host, gateway, gw_mac, mac, mitm, (struct netif *)esp_netif_get_netif_impl(esp_net_interface)
+        );
+    } else {
+        ESP_LOGE("MAC Address", "Failed to get MAC address: %s", esp_err_to_name(err));
     }
 }
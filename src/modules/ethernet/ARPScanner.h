@@ -20,6 +20,7 @@ private:
 
     std::vector<Host> hostslist_eth;
     void afterScanOptions(const Host &host);
+    void startSpoofer(const Host &host, bool mitm);
     bool macStringToByteArray(const std::string &macStr, uint8_t macArray[6]);
 
 public:
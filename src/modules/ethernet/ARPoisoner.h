@@ -3,6 +3,7 @@
 
 #include "Arduino.h"
 #include "FS.h"
+#include "PacketEngine.h"
 
 class ARPoisoner {
 private:
@@ -11,12 +12,14 @@ private:
     uint8_t gatewayMAC[6]; // Gateway MAC
     uint8_t victimMAC[6];  // Victim MAC
     File pcapFile;
+    PacketEngine engine;
     void setup(IPAddress gateway);
     void loop();
     bool arpPCAPfile();
-    void sendARPPacket(
-        uint8_t *targetIP, uint8_t *targetMAC, uint8_t *spoofedIP, uint8_t *spoofedMAC, File pcapFile
-    );
+
+    // Template 0 tells host .N the gateway is at a random MAC, template 1 tells the gateway host .N is
+    // at another one; N walks .1-.254 as frames go out
+    static void patch_frame(uint8_t *frame, size_t len, uint8_t tmpl, uint32_t seq, void *ctx);
 
 public:
     // @brief Dummy default constructori
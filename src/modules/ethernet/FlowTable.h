@@ -0,0 +1,55 @@
+#ifndef FLOW_TABLE_H
+#define FLOW_TABLE_H
+
+// Fixed-size per-flow summary (IPv4 5-tuple -> packets/bytes) for traffic relayed by the ARP
+// spoofer. Both directions of a connection share one entry; once the table is full a new flow takes
+// the slot of the one idle the longest. No allocation after construction and no Arduino
+// dependencies, so it can be fed recorded frames on the host.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define FLOW_TABLE_SIZE 64 // power of two
+
+struct FlowKey {
+    uint8_t ipA[4];
+    uint8_t ipB[4];
+    uint16_t portA;
+    uint16_t portB;
+    uint8_t proto;
+};
+
+struct FlowEntry {
+    FlowKey key;
+    uint32_t packets;
+    uint32_t bytes;
+    uint32_t lastSeen; // caller's clock, ms
+    bool used;
+};
+
+class FlowTable {
+public:
+    FlowTable() { clear(); }
+
+    // Extracts the 5-tuple from an Ethernet II IPv4 frame; ports are 0 for non TCP/UDP or fragments
+    static bool parse(const uint8_t *frame, size_t len, FlowKey &key);
+
+    // Returns false when the table was full and the flow seen least recently was evicted for this one
+    bool update(const FlowKey &key, uint32_t bytes, uint32_t now);
+    void clear();
+
+    // Copies up to `max` entries with the most bytes, largest first
+    size_t top(FlowEntry *out, size_t max) const;
+
+    size_t size() const { return _size; }
+    uint32_t evicted() const { return _evicted; }
+
+    static const char *protoName(uint8_t proto);
+
+private:
+    FlowEntry _entries[FLOW_TABLE_SIZE];
+    size_t _size = 0;
+    uint32_t _evicted = 0;
+};
+
+#endif
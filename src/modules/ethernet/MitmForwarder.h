@@ -0,0 +1,80 @@
+#ifndef MITM_FORWARDER_H
+#define MITM_FORWARDER_H
+
+// Relays victim <-> gateway traffic once both sides have been ARP-spoofed to our MAC.
+// Frames are intercepted in the netif input hook, before they reach the TCP/IP task, re-addressed
+// and sent straight back out with linkoutput. Each relayed frame is teed into a PcapRing and
+// counted in a FlowTable; the caller drains the ring to a file from its own loop.
+// The input hook and record() both push to the ring, from different tasks, so pushes and flow
+// updates happen under a spinlock (portENTER_CRITICAL), as does topFlows(). poll() drains the ring
+// without taking it.
+
+#include "FlowTable.h"
+#include "PcapRing.h"
+#include <Arduino.h>
+#include <FS.h>
+#include <freertos/FreeRTOS.h>
+#include <lwip/err.h>
+
+struct netif;
+struct pbuf;
+
+class MitmForwarder {
+public:
+    struct Stats {
+        uint32_t forwarded = 0;
+        uint32_t fwdBytes = 0;
+        uint32_t failed = 0;    // linkoutput errors
+        uint32_t fwdPps = 0;    // relayed frames per second, updated by poll()
+        uint32_t writeBps = 0;  // PCAP bytes written per second, updated by poll()
+        uint32_t written = 0;   // PCAP bytes written in total
+    };
+
+    MitmForwarder();
+    ~MitmForwarder();
+
+    // Starts the capture side: writes the PCAP header and allocates the ring
+    bool begin(File pcap);
+    // Installs the input hook; frames addressed to myMAC are relayed between victim and gateway
+    bool startRelay(
+        struct netif *nif, const uint8_t myMAC[6], const uint8_t victimIP[4], const uint8_t victimMAC[6],
+        const uint8_t gatewayMAC[6]
+    );
+    void stopRelay();
+    // Stops relaying and writes out everything still queued
+    void end();
+
+    // Records a frame we sent ourselves (spoofed/restoring ARP replies) in the capture
+    void record(const uint8_t *frame, size_t len);
+
+    // Writes queued capture data in blocks and refreshes the rates. Call from the UI loop.
+    void poll(bool flushAll = false);
+
+    const Stats &stats() const { return _stats; }
+    uint32_t captureDropped() const { return _ring.dropped(); }
+    // Snapshot of the busiest flows, taken under the same lock the input hook uses
+    size_t topFlows(FlowEntry *out, size_t max, size_t *total = nullptr);
+
+private:
+    struct netif *_netif = nullptr;
+    uint8_t _myMAC[6];
+    uint8_t _victimIP[4];
+    uint8_t _victimMAC[6];
+    uint8_t _gatewayMAC[6];
+    File _pcap;
+    PcapRing _ring;
+    uint8_t *_ringStorage = nullptr;
+    FlowTable _flows;
+    portMUX_TYPE _lock = portMUX_INITIALIZER_UNLOCKED;
+    Stats _stats;
+    uint32_t _lastPoll = 0;
+    uint32_t _lastForwarded = 0;
+    uint32_t _lastWritten = 0;
+    uint32_t _lastFlush = 0;
+
+    bool relay(struct pbuf *p);
+    void capture(struct pbuf *p);
+    static err_t inputHook(struct pbuf *p, struct netif *nif);
+};
+
+#endif
@@ -0,0 +1,160 @@
+#include "PacketEngine.h"
+#include "core/powerSave.h"
+#include "esp_timer.h"
+#include "lwip/netif.h"
+#include "lwip/pbuf.h"
+#include "soc/soc_caps.h"
+
+PacketEngine::PacketEngine() { memset(_tmpl, 0, sizeof(_tmpl)); }
+
+PacketEngine::~PacketEngine() {
+    stop();
+    clearFrames();
+}
+
+int PacketEngine::addFrame(const uint8_t *frame, size_t len, PatchFn patch, void *ctx) {
+    if (running() || _count >= PACKET_ENGINE_MAX_TEMPLATES || len == 0 || len > PACKET_ENGINE_MAX_FRAME)
+        return -1;
+
+    Template &t = _tmpl[_count];
+    memset(&t, 0, sizeof(t));
+    for (int i = 0; i < PACKET_ENGINE_POOL_DEPTH; i++) {
+        t.pool[i] = pbuf_alloc(PBUF_RAW, len, PBUF_RAM);
+        if (!t.pool[i]) {
+            for (int j = 0; j < i; j++) pbuf_free(t.pool[j]);
+            memset(&t, 0, sizeof(t));
+            return -1;
+        }
+        memcpy(t.pool[i]->payload, frame, len);
+    }
+    t.len = len;
+    t.patch = patch;
+    t.ctx = ctx;
+    return _count++;
+}
+
+void PacketEngine::clearFrames() {
+    if (running()) return;
+    for (uint8_t i = 0; i < _count; i++) {
+        for (int j = 0; j < PACKET_ENGINE_POOL_DEPTH; j++) {
+            if (_tmpl[i].pool[j]) pbuf_free(_tmpl[i].pool[j]);
+        }
+    }
+    memset(_tmpl, 0, sizeof(_tmpl));
+    _count = 0;
+}
+
+bool PacketEngine::start(uint32_t ratePps, uint32_t limit, struct netif *nif) {
+    if (running() || _count == 0) return false;
+    _netif = nif ? nif : netif_list;
+    if (!_netif || !_netif->linkoutput) return false;
+
+    _rate = ratePps;
+    _limit = limit;
+    _stop = false;
+    _stats = Stats();
+#if SOC_CPU_CORES_NUM > 1
+    // core 0 keeps the UI loop responsive while the TX loop runs flat out
+    BaseType_t res = xTaskCreatePinnedToCore(taskEntry, "pkt_engine", 4096, this, 2, &_task, 0);
+#else
+    BaseType_t res = xTaskCreate(taskEntry, "pkt_engine", 4096, this, 2, &_task);
+#endif
+    if (res != pdPASS) {
+        _task = nullptr;
+        return false;
+    }
+    return true;
+}
+
+void PacketEngine::stop() {
+    // The task checks _stop at least every PACKET_ENGINE_SLEEP_SLICE_MS and deletes itself, so it is
+    // never killed in the middle of a send
+    _stop = true;
+    while (_task) vTaskDelay(pdMS_TO_TICKS(PACKET_ENGINE_SLEEP_SLICE_MS));
+}
+
+bool PacketEngine::sendNow(uint8_t tmpl) {
+    if (running() || tmpl >= _count) return false;
+    if (!_netif) _netif = netif_list;
+    if (!_netif) return false;
+    return transmit(_tmpl[tmpl]);
+}
+
+bool PacketEngine::transmit(Template &t) {
+    // Reuse a pbuf only once the driver has released it (zero-copy TX paths keep a reference)
+    struct pbuf *p = nullptr;
+    for (int i = 0; i < PACKET_ENGINE_POOL_DEPTH; i++) {
+        uint8_t slot = (t.next + i) % PACKET_ENGINE_POOL_DEPTH;
+        if (t.pool[slot]->ref == 1) {
+            p = t.pool[slot];
+            t.next = (slot + 1) % PACKET_ENGINE_POOL_DEPTH;
+            break;
+        }
+    }
+    if (!p) {
+        _stats.busy++;
+        return false;
+    }
+
+    if (t.patch) t.patch((uint8_t *)p->payload, t.len, &t - _tmpl, t.seq, t.ctx);
+    t.seq++;
+    if (_netif->linkoutput(_netif, p) != ERR_OK) {
+        _stats.failed++;
+        return false;
+    }
+    _stats.sent++;
+    return true;
+}
+
+void PacketEngine::run() {
+    int64_t now = esp_timer_get_time();
+    int64_t nextDue = now;
+    int64_t lastYield = now;
+    int64_t windowStart = now;
+    uint32_t windowSent = 0;
+    uint32_t total = 0;
+    uint8_t idx = 0;
+
+    powerHold(); // Ethernet is no radio to the governor
+    while (!_stop && (_limit == 0 || total < _limit)) {
+        uint32_t rate = _rate;
+        now = esp_timer_get_time();
+        if (rate) {
+            int64_t ahead = nextDue - now;
+            if (ahead > 2000) {
+                // slow rates wait up to a second, in slices so that stop() is seen
+                int64_t sleepMs = ahead / 1000;
+                if (sleepMs > PACKET_ENGINE_SLEEP_SLICE_MS) sleepMs = PACKET_ENGINE_SLEEP_SLICE_MS;
+                vTaskDelay(pdMS_TO_TICKS(sleepMs) ? pdMS_TO_TICKS(sleepMs) : 1);
+                lastYield = esp_timer_get_time();
+                continue;
+            }
+            if (ahead > 0) delayMicroseconds(ahead);
+            else if (ahead < -100000) nextDue = now; // fell far behind: don't burst to catch up
+            nextDue += 1000000 / rate;
+        }
+        if (now - lastYield > 10000) {
+            // let the idle task feed its watchdog when running unthrottled
+            vTaskDelay(1);
+            lastYield = esp_timer_get_time();
+        }
+
+        transmit(_tmpl[idx]);
+        idx = (idx + 1) % _count;
+        total++;
+
+        if (now - windowStart >= 1000000) {
+            _stats.pps = (uint64_t)(_stats.sent - windowSent) * 1000000 / (now - windowStart);
+            windowSent = _stats.sent;
+            windowStart = now;
+        }
+    }
+    powerRelease();
+}
+
+void PacketEngine::taskEntry(void *param) {
+    PacketEngine *self = static_cast<PacketEngine *>(param);
+    self->run();
+    self->_task = nullptr;
+    vTaskDelete(NULL);
+}
@@ -0,0 +1,77 @@
+#ifndef PACKET_ENGINE_H
+#define PACKET_ENGINE_H
+
+// Rate-controlled raw frame transmitter shared by the flooding/poisoning modules.
+// Frames are registered once as templates; each one is copied into a small pool of preallocated
+// pbufs and a patch callback rewrites only the varying fields (MAC, xid, IP...) right before the
+// frame is handed to netif->linkoutput from a dedicated task.
+
+#include "FrameBuilder.h"
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+struct pbuf;
+struct netif;
+
+#define PACKET_ENGINE_MAX_TEMPLATES 4
+#define PACKET_ENGINE_POOL_DEPTH 4 // pbufs per template, so one still held by the driver is skipped
+#define PACKET_ENGINE_MAX_FRAME 512
+#define PACKET_ENGINE_SLEEP_SLICE_MS 10 // longest wait between two checks for stop()
+
+class PacketEngine {
+public:
+    // Called from the TX task before each send. `seq` counts frames sent from this template.
+    typedef void (*PatchFn)(uint8_t *frame, size_t len, uint8_t tmpl, uint32_t seq, void *ctx);
+
+    struct Stats {
+        uint32_t sent = 0;
+        uint32_t failed = 0;   // linkoutput errors
+        uint32_t busy = 0;     // every pool slot of a template still in use by the driver
+        uint32_t pps = 0;      // frames sent during the last second
+    };
+
+    PacketEngine();
+    ~PacketEngine();
+
+    // Returns the template index, or -1 if the table is full or the pbufs can't be allocated
+    int addFrame(const uint8_t *frame, size_t len, PatchFn patch = nullptr, void *ctx = nullptr);
+    void clearFrames();
+
+    // ratePps = 0 sends as fast as the interface accepts; templates are sent round-robin.
+    // limit = 0 keeps sending until stop().
+    bool start(uint32_t ratePps, uint32_t limit = 0, struct netif *nif = nullptr);
+    void stop();
+    bool running() const { return _task != nullptr; }
+    void setRate(uint32_t ratePps) { _rate = ratePps; }
+
+    // Sends one template synchronously from the caller's task (e.g. restoring ARP caches on exit)
+    bool sendNow(uint8_t tmpl);
+
+    const Stats &stats() const { return _stats; }
+
+private:
+    struct Template {
+        struct pbuf *pool[PACKET_ENGINE_POOL_DEPTH];
+        uint16_t len;
+        uint8_t next;
+        uint32_t seq;
+        PatchFn patch;
+        void *ctx;
+    };
+
+    Template _tmpl[PACKET_ENGINE_MAX_TEMPLATES];
+    uint8_t _count = 0;
+    struct netif *_netif = nullptr;
+    volatile uint32_t _rate = 0;
+    uint32_t _limit = 0;
+    volatile bool _stop = false;
+    TaskHandle_t _task = nullptr;
+    Stats _stats;
+
+    bool transmit(Template &t);
+    void run();
+    static void taskEntry(void *param);
+};
+
+#endif
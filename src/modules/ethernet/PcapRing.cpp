@@ -0,0 +1,77 @@
+#include "PcapRing.h"
+#include <string.h>
+
+static void put32le(uint8_t *p, uint32_t v) {
+    p[0] = v;
+    p[1] = v >> 8;
+    p[2] = v >> 16;
+    p[3] = v >> 24;
+}
+
+void PcapRing::begin(uint8_t *storage, size_t capacity, uint32_t snaplen) {
+    // power of two, so offsets stay consistent when the 32-bit byte counters wrap
+    size_t cap = 1;
+    while (cap * 2 <= capacity) cap *= 2;
+    _buf = storage;
+    _cap = storage && capacity ? cap : 0;
+    _snaplen = snaplen;
+    _head.store(0);
+    _tail.store(0);
+    _records = 0;
+    _dropped = 0;
+}
+
+size_t PcapRing::fileHeader(uint8_t out[PCAP_FILE_HEADER_LEN], uint32_t linktype, uint32_t snaplen) {
+    put32le(out, 0xa1b2c3d4); // microsecond timestamps, little endian
+    out[4] = 2;               // version 2.4
+    out[5] = 0;
+    out[6] = 4;
+    out[7] = 0;
+    put32le(out + 8, 0);  // thiszone
+    put32le(out + 12, 0); // sigfigs
+    put32le(out + 16, snaplen);
+    put32le(out + 20, linktype);
+    return PCAP_FILE_HEADER_LEN;
+}
+
+void PcapRing::copyIn(uint32_t pos, const uint8_t *src, size_t len) {
+    size_t off = pos % _cap;
+    size_t first = len < _cap - off ? len : _cap - off;
+    memcpy(_buf + off, src, first);
+    if (first < len) memcpy(_buf, src + first, len - first);
+}
+
+bool PcapRing::push(const uint8_t *frame, uint32_t len, uint32_t tsSec, uint32_t tsUsec) {
+    if (!_buf) return false;
+    uint32_t incl = len < _snaplen ? len : _snaplen;
+    uint32_t head = _head.load(std::memory_order_relaxed);
+    uint32_t tail = _tail.load(std::memory_order_acquire);
+    if (_cap - (head - tail) < PCAP_RECORD_HEADER_LEN + incl) {
+        _dropped++;
+        return false;
+    }
+
+    uint8_t hdr[PCAP_RECORD_HEADER_LEN];
+    put32le(hdr, tsSec);
+    put32le(hdr + 4, tsUsec);
+    put32le(hdr + 8, incl);
+    put32le(hdr + 12, len);
+    copyIn(head, hdr, sizeof(hdr));
+    copyIn(head + sizeof(hdr), frame, incl);
+    _head.store(head + sizeof(hdr) + incl, std::memory_order_release);
+    _records++;
+    return true;
+}
+
+size_t PcapRing::peek(const uint8_t **data) const {
+    uint32_t tail = _tail.load(std::memory_order_relaxed);
+    size_t avail = _head.load(std::memory_order_acquire) - tail;
+    if (!avail) return 0;
+    size_t off = tail % _cap;
+    *data = _buf + off;
+    return avail < _cap - off ? avail : _cap - off;
+}
+
+void PcapRing::consume(size_t n) {
+    _tail.store(_tail.load(std::memory_order_relaxed) + n, std::memory_order_release);
+}
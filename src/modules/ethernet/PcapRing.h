@@ -0,0 +1,54 @@
+#ifndef PCAP_RING_H
+#define PCAP_RING_H
+
+// Single-producer/single-consumer byte ring holding PCAP records.
+// The capture path pushes whole records (header + frame) without touching the filesystem; the
+// UI task drains the ring in large contiguous blocks, which keeps SD writes few and aligned.
+// Only the index hand-off between the two sides is atomic: with more than one producer task the
+// pushes must be serialized by the caller (MitmForwarder takes a spinlock around them).
+// Plain C++ so the record layout and wrap-around handling can be tested on the host.
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+#define PCAP_LINKTYPE_ETHERNET 1
+#define PCAP_FILE_HEADER_LEN 24
+#define PCAP_RECORD_HEADER_LEN 16
+
+class PcapRing {
+public:
+    // `storage` is owned by the caller and must outlive the ring; only the largest power of two
+    // that fits in `capacity` is used
+    void begin(uint8_t *storage, size_t capacity, uint32_t snaplen = 1514);
+
+    static size_t fileHeader(uint8_t out[PCAP_FILE_HEADER_LEN], uint32_t linktype, uint32_t snaplen);
+
+    // Producer side. Frames longer than snaplen are truncated; returns false (and counts a drop)
+    // when the ring has no room for the record.
+    bool push(const uint8_t *frame, uint32_t len, uint32_t tsSec, uint32_t tsUsec);
+
+    // Consumer side: longest contiguous readable span, then release what was written out
+    size_t peek(const uint8_t **data) const;
+    void consume(size_t n);
+
+    size_t used() const {
+        return _head.load(std::memory_order_acquire) - _tail.load(std::memory_order_acquire);
+    }
+    size_t capacity() const { return _cap; }
+    uint32_t records() const { return _records; }
+    uint32_t dropped() const { return _dropped; }
+
+private:
+    uint8_t *_buf = nullptr;
+    size_t _cap = 0;
+    uint32_t _snaplen = 1514;
+    std::atomic<uint32_t> _head{0}; // total bytes ever written
+    std::atomic<uint32_t> _tail{0}; // total bytes ever consumed
+    uint32_t _records = 0;
+    uint32_t _dropped = 0;
+
+    void copyIn(uint32_t pos, const uint8_t *src, size_t len);
+};
+
+#endif
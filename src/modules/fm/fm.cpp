@@ -1,12 +1,28 @@
 #ifndef LITE_VERSION
 #include "fm.h"
+#include "core/powerSave.h"
+#include "core/profiler.h"
+#include "core/sd_functions.h"
 #include "core/utils.h"
+#include "fm_survey.h"
+#include <memory>
+
+#define FM_SURVEY_TASK_STACK 3072
+#define FM_SURVEY_TASK_PRIORITY 1
+#define FM_SURVEY_TASK_CORE 0
+#define FM_SURVEY_LEVEL_MAX 80 // dBuV at the top of the spectrum
+#define FM_SURVEY_RANKED 3
 
 bool auto_scan = false;
 bool is_running = false;
 uint16_t fm_station = 10230; // Default set to 102.30 MHz
 Adafruit_Si4713 radio = Adafruit_Si4713();
 
+// The survey task owns the radio while it runs, the table is shared through surveyLock
+static SemaphoreHandle_t surveyLock = NULL;
+static TaskHandle_t volatile surveyTask = NULL;
+static volatile bool surveyRunning = false;
+
 void set_auto_scan(bool new_value) { auto_scan = new_value; }
 
 void set_frq(uint16_t frq) { fm_station = frq; }
@@ -18,36 +34,35 @@ void fm_banner() {
     delay(500);
 }
 
+// Received level on a frequency, from the Si4713 receive power scan
+static uint8_t fm_measure(uint16_t freq) {
+    radio.readTuneMeasure(freq);
+    radio.readTuneStatus();
+    return radio.currNoiseLevel;
+}
+
 uint16_t fm_scan() {
     if (!fm_begin()) { return 0; }
-    char display_freq[16];
-    uint16_t f = 8750;
-    uint16_t min_noise;
-    uint16_t freq_candidate = f;
-
-    // Check for first noise level
-    radio.readTuneMeasure(f);
-    radio.readTuneStatus();
-    min_noise = radio.currNoiseLevel;
+    char display_freq[24];
+    std::unique_ptr<FmSurvey> survey(new FmSurvey());
+    uint16_t freq_candidate = FM_SURVEY_FIRST;
+    bool done = false;
 
     tft.fillScreen(bruceConfig.bgColor);
     displayTextLine("Scanning...");
-    for (f = 8750; f < 10800; f += 10) {
-        Serial.print("Measuring ");
-        Serial.print(f);
-        Serial.print("...");
-        radio.readTuneMeasure(f);
-        radio.readTuneStatus();
-        Serial.println(radio.currNoiseLevel);
-
-        // Set best freq candidate
-        if (radio.currNoiseLevel < min_noise) {
-            min_noise = radio.currNoiseLevel;
-            freq_candidate = f;
-        }
+    while (!done) {
+        uint16_t f = survey->next(millis());
+        done = survey->record(fm_measure(f), millis());
+        progressHandler(done ? FM_SURVEY_CHANNELS : survey->position(), FM_SURVEY_CHANNELS, "Scanning...");
     }
 
-    sprintf(display_freq, "Found %d MHz", freq_candidate);
+    // Clearest channel, its neighbours included
+    survey->rank(&freq_candidate, 1);
+    Serial.printf(
+        "FM scan: %lu ms, best %u.%02u MHz\n", survey->sweepMs(), freq_candidate / 100, freq_candidate % 100
+    );
+
+    sprintf(display_freq, "Found %u.%02u MHz", freq_candidate / 100, freq_candidate % 100);
     tft.fillScreen(bruceConfig.bgColor);
     displayTextLine(display_freq);
     while (!check(EscPress) && !check(SelPress)) { delay(100); }
@@ -175,45 +190,253 @@ void fm_ta_run() {
     while (!check(EscPress) && !check(SelPress)) { delay(100); }
 }
 
+static void fm_survey_loop(void *param) {
+    FmSurvey *survey = (FmSurvey *)param;
+    while (surveyRunning) {
+        xSemaphoreTake(surveyLock, portMAX_DELAY);
+        uint16_t freq = survey->next(millis());
+        xSemaphoreGive(surveyLock);
+
+        uint8_t level = fm_measure(freq); // tens of ms, the table stays readable meanwhile
+
+        xSemaphoreTake(surveyLock, portMAX_DELAY);
+        survey->record(level, millis());
+        xSemaphoreGive(surveyLock);
+    }
+    surveyTask = NULL;
+    vTaskDelete(NULL);
+}
+
+static bool fm_survey_start(FmSurvey *survey) {
+    if (!surveyLock) surveyLock = xSemaphoreCreateMutex();
+    surveyRunning = true;
+    TaskHandle_t task = NULL;
+    profilerTaskStack("fm_survey", FM_SURVEY_TASK_STACK);
+    if (xTaskCreatePinnedToCore(
+            fm_survey_loop,
+            "fm_survey",
+            FM_SURVEY_TASK_STACK,
+            survey,
+            FM_SURVEY_TASK_PRIORITY,
+            &task,
+            FM_SURVEY_TASK_CORE
+        ) != pdPASS) {
+        surveyRunning = false;
+        return false;
+    }
+    surveyTask = task;
+    powerHold(); // sweeps run unattended for as long as the screen is open
+    return true;
+}
+
+// Returns once the measurement in progress is done
+static void fm_survey_stop() {
+    surveyRunning = false;
+    while (surveyTask) delay(1);
+    powerRelease();
+}
+
+static void fm_survey_save(const FmSurvey &survey) {
+    FS *fs;
+    if (!getFsStorage(fs)) {
+        displayError("Storage error", true);
+        return;
+    }
+
+    File file = createNewFile(fs, "/BruceFM", "survey.csv");
+    if (!file) {
+        displayError("Error saving survey", true);
+        return;
+    }
+    String path = file.path();
+
+    file.printf("# Bruce FM survey, %lu sweeps, last sweep %lu ms\n", survey.sweeps(), survey.sweepMs());
+    file.println("MHz,level,peak,floor,average,samples,score");
+    for (uint8_t i = 0; i < FM_SURVEY_CHANNELS; i++) {
+        const FmChannel &ch = survey.channel(i);
+        if (ch.samples == 0) continue;
+        uint16_t f = FmSurvey::frequency(i);
+        file.printf(
+            "%u.%02u,%u,%u,%u,%u,%u,%u\n",
+            f / 100,
+            f % 100,
+            ch.level,
+            ch.peak,
+            ch.floor,
+            ch.average(),
+            ch.samples,
+            survey.score(i)
+        );
+    }
+
+    uint16_t ranked[FM_SURVEY_RANKED];
+    uint8_t count = survey.rank(ranked, FM_SURVEY_RANKED);
+    file.print("# clearest:");
+    for (uint8_t i = 0; i < count; i++) file.printf(" %u.%02u", ranked[i] / 100, ranked[i] % 100);
+    file.println();
+    file.close();
+
+    displaySuccess("Saved " + path, true);
+}
+
+struct FmPlot {
+    int x, y, w, h;
+};
+
+static int fm_level_height(const FmPlot &plot, uint8_t level) {
+    if (level > FM_SURVEY_LEVEL_MAX) level = FM_SURVEY_LEVEL_MAX;
+    return level * plot.h / FM_SURVEY_LEVEL_MAX;
+}
+
+// One pixel column: bar of the last level, dot of the peak-hold. On narrow screens a column holds
+// several channels and shows the highest.
+static void fm_draw_column(const FmSurvey &survey, const FmPlot &plot, int col) {
+    int first = col * FM_SURVEY_CHANNELS / plot.w;
+    int last = ((col + 1) * FM_SURVEY_CHANNELS + plot.w - 1) / plot.w;
+    if (last > FM_SURVEY_CHANNELS) last = FM_SURVEY_CHANNELS;
+    uint8_t level = 0;
+    uint8_t peak = 0;
+    for (int i = first; i < last; i++) {
+        const FmChannel &ch = survey.channel(i);
+        if (ch.level > level) level = ch.level;
+        if (ch.peak > peak) peak = ch.peak;
+    }
+
+    int x = plot.x + col;
+    int h = fm_level_height(plot, level);
+    int peakH = fm_level_height(plot, peak);
+    tft.drawFastVLine(x, plot.y, plot.h - h, bruceConfig.bgColor);
+    tft.drawFastVLine(x, plot.y + plot.h - h, h, bruceConfig.priColor);
+    if (peakH > h) tft.drawPixel(x, plot.y + plot.h - peakH, bruceConfig.secColor);
+}
+
+static void fm_draw_channel(const FmSurvey &survey, const FmPlot &plot, uint8_t index) {
+    int first = index * plot.w / FM_SURVEY_CHANNELS;
+    int last = ((index + 1) * plot.w + FM_SURVEY_CHANNELS - 1) / FM_SURVEY_CHANNELS;
+    if (last <= first) last = first + 1;
+    for (int col = first; col < last && col < plot.w; col++) fm_draw_column(survey, plot, col);
+}
+
+static void fm_draw_cursor(const FmPlot &plot, uint8_t index, uint16_t color) {
+    int x = plot.x + (2 * index + 1) * plot.w / (2 * FM_SURVEY_CHANNELS);
+    tft.drawFastVLine(x, plot.y + plot.h + 1, 3, color);
+}
+
+static void fm_draw_text(int y, const char *text) {
+    tft.fillRect(0, y, tftWidth, LH * FP, bruceConfig.bgColor);
+    tft.drawString(text, 4, y, 1);
+}
+
 void fm_spectrum() {
     // Test if FM is attached, if not, close menu
     if (!fm_begin()) { return; }
-    uint16_t f_min = 80;
-    uint16_t f_max = 110;
-    int noise_level = 0;
-    int SIGNAL_STRENGTH_THRESHOLD = 35;
 
-    tft.fillScreen(bruceConfig.bgColor);
-    tft.setTextSize(1);
+    FmSurvey *survey = new FmSurvey();
+    if (!fm_survey_start(survey)) {
+        delete survey;
+        displayError("Survey task failed", true);
+        return;
+    }
 
-    fm_options(f_min, f_max, false);
-    delay(10);
+    int lh = LH * FP;
+    FmPlot plot;
+    plot.x = 4;
+    plot.y = 2 * lh + 8;
+    plot.w = tftWidth - 8;
+    plot.h = tftHeight - plot.y - 3 * lh - 14;
+    int labelY = plot.y + plot.h + 5;
+    int cursorY = labelY + lh + 2;
+    int rankY = cursorY + lh + 2;
+
+    uint8_t cursor = FmSurvey::index(fm_station);
+    if (cursor >= FM_SURVEY_CHANNELS) cursor = 0;
+    bool redraw = true;
+    bool cursorMoved = true;
+    uint32_t shownSweeps = UINT32_MAX;
+    uint16_t shownSamples = 0;
+    char text[48];
+
+    while (!check(EscPress)) {
+        if (check(PrevPress) && cursor > 0) {
+            fm_draw_cursor(plot, cursor--, bruceConfig.bgColor);
+            cursorMoved = true;
+        }
+        if (check(NextPress) && cursor < FM_SURVEY_CHANNELS - 1) {
+            fm_draw_cursor(plot, cursor++, bruceConfig.bgColor);
+            cursorMoved = true;
+        }
 
-    if (!returnToMenu) {
-        fm_begin();
-        fm_banner();
-        while (!check(EscPress) && !check(SelPress)) {
-            radio.readTuneMeasure(fm_station);
-            radio.readTuneStatus();
-            noise_level = radio.currNoiseLevel;
-            if (noise_level != 0) {
-                // Clear the display area
-                tft.fillRect(0, 40, tftWidth, tftHeight, bruceConfig.bgColor);
-                // Draw waveform based on signal strength
-                for (size_t i = 0; i < noise_level; i++) {
-                    int lineHeight = map(noise_level, 0, SIGNAL_STRENGTH_THRESHOLD, 0, tftHeight / 2);
-                    int lineX =
-                        map(i, 0, noise_level - 1, 0, tftWidth - 1); // Map i to within the display width
-                    // Ensure drawing coordinates stay within the box bounds
-                    int startY = constrain(20 + tftHeight / 2 - lineHeight / 2, 20, 20 + tftHeight);
-                    int endY = constrain(20 + tftHeight / 2 + lineHeight / 2, 20, 20 + tftHeight);
-                    tft.drawLine(lineX, startY, lineX, endY, bruceConfig.priColor);
-                }
+        xSemaphoreTake(surveyLock, portMAX_DELAY);
+        if (check(SelPress)) {
+            fm_survey_save(*survey);
+            redraw = true;
+        }
+
+        if (redraw) {
+            tft.fillScreen(bruceConfig.bgColor);
+            tft.setTextSize(FP);
+            tft.setTextColor(bruceConfig.priColor, bruceConfig.bgColor);
+            tft.drawCentreString("FM Survey", tftWidth / 2, 2, 1);
+            tft.drawRect(plot.x - 1, plot.y - 1, plot.w + 2, plot.h + 2, bruceConfig.priColor);
+            tft.drawString("87.5", plot.x, labelY, 1);
+            tft.drawCentreString("97.8", plot.x + plot.w / 2, labelY, 1);
+            tft.drawRightString("108", plot.x + plot.w, labelY, 1);
+            shownSweeps = UINT32_MAX;
+            cursorMoved = true;
+        }
+
+        // Only the columns measured since the last pass
+        for (uint8_t i = 0; i < FM_SURVEY_CHANNELS; i++) {
+            if (survey->takeDirty(i) || redraw) fm_draw_channel(*survey, plot, i);
+        }
+        redraw = false;
+
+        const FmChannel &ch = survey->channel(cursor);
+        if (cursorMoved || ch.samples != shownSamples) {
+            uint16_t f = FmSurvey::frequency(cursor);
+            snprintf(
+                text, sizeof(text), "%u.%02u MHz L%u P%u F%u", f / 100, f % 100, ch.level, ch.peak, ch.floor
+            );
+            fm_draw_text(cursorY, text);
+            fm_draw_cursor(plot, cursor, bruceConfig.secColor);
+            cursorMoved = false;
+            shownSamples = ch.samples;
+        }
+
+        if (survey->sweeps() != shownSweeps) {
+            shownSweeps = survey->sweeps();
+            if (shownSweeps == 0) {
+                snprintf(text, sizeof(text), "First sweep...   Sel: save");
+            } else {
+                snprintf(
+                    text,
+                    sizeof(text),
+                    "Sweep %lu %lu.%lus   Sel: save",
+                    shownSweeps,
+                    survey->sweepMs() / 1000,
+                    survey->sweepMs() % 1000 / 100
+                );
+                Serial.printf("FM sweep %lu: %lu ms\n", shownSweeps, survey->sweepMs());
             }
+            fm_draw_text(2 + lh + 2, text);
+
+            uint16_t ranked[FM_SURVEY_RANKED];
+            uint8_t count = survey->rank(ranked, FM_SURVEY_RANKED);
+            int len = snprintf(text, sizeof(text), "Clear:");
+            for (uint8_t i = 0; i < count; i++) {
+                len += snprintf(text + len, sizeof(text) - len, " %u.%02u", ranked[i] / 100, ranked[i] % 100);
+            }
+            fm_draw_text(rankY, text);
         }
-        fm_stop();
-        delay(100);
+        xSemaphoreGive(surveyLock);
+
+        delay(50);
     }
+
+    fm_survey_stop();
+    delete survey;
+    fm_stop();
+    delay(100);
 }
 
 bool fm_begin() {
@@ -0,0 +1,84 @@
+#include "fm_survey.h"
+#include <string.h>
+
+void FmSurvey::reset() {
+    memset(table, 0, sizeof(table));
+    memset(dirty, 0xFF, sizeof(dirty));
+    pos = 0;
+    _sweeps = 0;
+    _sweepMs = 0;
+    sweepStart = 0;
+}
+
+uint8_t FmSurvey::index(uint16_t frequency) {
+    if (frequency < FM_SURVEY_FIRST || frequency > FM_SURVEY_LAST) return FM_SURVEY_CHANNELS;
+    if ((frequency - FM_SURVEY_FIRST) % FM_SURVEY_STEP) return FM_SURVEY_CHANNELS;
+    return (frequency - FM_SURVEY_FIRST) / FM_SURVEY_STEP;
+}
+
+uint16_t FmSurvey::next(uint32_t nowMs) {
+    if (pos == 0) sweepStart = nowMs;
+    return frequency(pos);
+}
+
+bool FmSurvey::record(uint8_t level, uint32_t nowMs) {
+    FmChannel &ch = table[pos];
+    if (ch.samples == 0 || level < ch.floor) ch.floor = level;
+    if (level > ch.peak) ch.peak = level;
+    ch.level = level;
+    if (ch.samples < UINT16_MAX) {
+        ch.samples++;
+        ch.sum += level;
+    }
+    dirty[pos / 8] |= 1 << (pos % 8);
+
+    if (++pos < FM_SURVEY_CHANNELS) return false;
+    pos = 0;
+    _sweeps++;
+    _sweepMs = nowMs - sweepStart;
+    return true;
+}
+
+bool FmSurvey::takeDirty(uint8_t index) {
+    if (index >= FM_SURVEY_CHANNELS) return false;
+    uint8_t bit = 1 << (index % 8);
+    if (!(dirty[index / 8] & bit)) return false;
+    dirty[index / 8] &= ~bit;
+    return true;
+}
+
+uint16_t FmSurvey::score(uint8_t index) const {
+    if (index >= FM_SURVEY_CHANNELS || table[index].samples == 0) return 0xFFFF;
+    int worst = table[index].peak;
+    for (int d = 1; d <= 2; d++) {
+        int penalty = d * FM_SURVEY_NEIGHBOUR_DB;
+        if (index >= d && table[index - d].peak - penalty > worst) worst = table[index - d].peak - penalty;
+        if (index + d < FM_SURVEY_CHANNELS && table[index + d].peak - penalty > worst)
+            worst = table[index + d].peak - penalty;
+    }
+    return worst;
+}
+
+uint8_t FmSurvey::rank(uint16_t *out, uint8_t max) const {
+    uint8_t taken[(FM_SURVEY_CHANNELS + 7) / 8] = {};
+    uint8_t count = 0;
+
+    while (count < max) {
+        uint8_t best = FM_SURVEY_CHANNELS;
+        uint16_t bestScore = 0xFFFF;
+        for (uint8_t i = 0; i < FM_SURVEY_CHANNELS; i++) {
+            if (taken[i / 8] & (1 << (i % 8))) continue;
+            uint16_t s = score(i);
+            if (s == 0xFFFF) continue;
+            // ties go to the lower average, then to the lower frequency
+            if (s < bestScore || (s == bestScore && table[i].average() < table[best].average())) {
+                best = i;
+                bestScore = s;
+            }
+        }
+        if (best == FM_SURVEY_CHANNELS) break;
+        taken[best / 8] |= 1 << (best % 8);
+        out[count++] = frequency(best);
+    }
+    return count;
+}
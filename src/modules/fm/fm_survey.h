@@ -0,0 +1,70 @@
+#ifndef __FM_SURVEY_H__
+#define __FM_SURVEY_H__
+
+// Band survey for the Si4713: every 100 kHz channel of 87.5-108 MHz is measured in turn, and the
+// readings are kept in a table of last, peak-hold and lowest level per channel.
+// The level is what the chip's receive power scan reports, in dBuV: a station reads high, a free
+// channel reads at the noise floor.
+// The caller does the measurement: next() gives the frequency, record() stores its level, so the
+// sweep can run in a task or in a plain loop. Nothing here depends on Arduino, synthetic levels can
+// drive it.
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Frequencies in 10 kHz units, like fm_station
+#define FM_SURVEY_FIRST 8750
+#define FM_SURVEY_LAST 10800
+#define FM_SURVEY_STEP 10
+#define FM_SURVEY_CHANNELS ((FM_SURVEY_LAST - FM_SURVEY_FIRST) / FM_SURVEY_STEP + 1)
+// A channel 100 kHz away counts this many dB below its level when ranking, twice that at 200 kHz
+#define FM_SURVEY_NEIGHBOUR_DB 6
+
+struct FmChannel {
+    uint8_t level; // last reading
+    uint8_t peak;  // highest reading since reset()
+    uint8_t floor; // lowest reading since reset()
+    uint16_t samples;
+    uint32_t sum;
+
+    uint8_t average() const { return samples ? sum / samples : 0; }
+};
+
+class FmSurvey {
+public:
+    FmSurvey() { reset(); }
+
+    void reset();
+
+    // Frequency to measure now. The sweep time starts when it is the first channel.
+    uint16_t next(uint32_t nowMs);
+    // Level of the frequency next() gave, true when it completed a sweep
+    bool record(uint8_t level, uint32_t nowMs);
+
+    static uint16_t frequency(uint8_t index) { return FM_SURVEY_FIRST + index * FM_SURVEY_STEP; }
+    // FM_SURVEY_CHANNELS when the frequency is not on the grid
+    static uint8_t index(uint16_t frequency);
+
+    const FmChannel &channel(uint8_t index) const { return table[index]; }
+    uint8_t position() const { return pos; }
+    uint32_t sweeps() const { return _sweeps; }
+    uint32_t sweepMs() const { return _sweepMs; } // duration of the last complete sweep
+
+    // Changed since the last call, for the spectrum to redraw only those columns
+    bool takeDirty(uint8_t index);
+
+    // Peak-hold of the channel and its neighbours, lower is clearer. 0xFFFF if never measured.
+    uint16_t score(uint8_t index) const;
+    // Frequencies of the clearest channels, clearest first. Returns how many were written.
+    uint8_t rank(uint16_t *out, uint8_t max) const;
+
+private:
+    FmChannel table[FM_SURVEY_CHANNELS];
+    uint8_t dirty[(FM_SURVEY_CHANNELS + 7) / 8];
+    uint8_t pos;
+    uint32_t _sweeps;
+    uint32_t _sweepMs;
+    uint32_t sweepStart;
+};
+
+#endif
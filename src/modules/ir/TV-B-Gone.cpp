@@ -13,6 +13,7 @@ Distributed under Creative Commons 2.5 -- Attribution & Share Alike
 #include "WORLD_IR_CODES.h"
 #include "core/display.h"
 #include "core/mykeyboard.h"
+#include "core/powerSave.h"
 #include "core/sd_functions.h"
 #include "core/settings.h"
 #include "core/utils.h"
@@ -51,32 +52,80 @@ void xmitCodeElement(uint16_t ontime, uint16_t offtime, uint8_t PWM_code);
 void quickflashLEDx(uint8_t x);
 void delay_ten_us(uint16_t us);
 void quickflashLED(void);
-uint8_t read_bits(uint8_t count);
 #define MAX_WAIT_TIME 65535 // tens of us (ie: 655.350ms)
 extern const IrCode *const NApowerCodes[];
 extern const IrCode *const EUpowerCodes[];
 uint8_t num_NAcodes = NUM_ELEM(NApowerCodes);
 uint8_t num_EUcodes = NUM_ELEM(EUpowerCodes);
-uint8_t bitsleft_r = 0;
-uint8_t bits_r = 0;
-uint8_t code_ptr;
-volatile const IrCode *powerCode;
-uint8_t read_bits(uint8_t count) {
-    uint8_t i;
-    uint8_t tmp = 0;
-    for (i = 0; i < count; i++) {
-        if (bitsleft_r == 0) {
-            bits_r = powerCode->codes[code_ptr++];
-            bitsleft_r = 8;
+uint8_t region;
+
+// Silence after each code. The original firmware waited 205ms, receivers only need the frame to end.
+#define TVBGONE_CODE_GAP_US 50000
+#define TVBGONE_MAX_PAIRS 160   // largest table entry has 136
+#define TVBGONE_MAX_SYMBOLS 160 // the tables need at most 137, gap included
+#define TVBGONE_SLOTS 3         // codes expanded ahead and queued on the RMT channel
+
+// Unpacks a power code into mark/space durations in us, returns the number of durations
+static size_t expandPowerCode(const IrCode *code, uint32_t *durations) {
+    return ir_unpack_pairs(code->codes, code->numpairs, code->bitcompression, code->times, durations);
+}
+
+struct TvBGoneSweep {
+    const IrCode *const *codes;
+    uint8_t numCodes;
+    volatile bool paused;
+    volatile bool stop;
+    volatile bool done;
+    volatile uint16_t sent;
+    SemaphoreHandle_t freeSlots;
+    rmt_symbol_word_t symbols[TVBGONE_SLOTS][TVBGONE_MAX_SYMBOLS];
+};
+
+static bool IRAM_ATTR tvbgoneCodeSent(rmt_channel_handle_t, const rmt_tx_done_event_data_t *, void *user) {
+    TvBGoneSweep *sweep = (TvBGoneSweep *)user;
+    BaseType_t highTaskWakeup = pdFALSE;
+    sweep->sent++;
+    xSemaphoreGiveFromISR(sweep->freeSlots, &highTaskWakeup);
+    return highTaskWakeup == pdTRUE;
+}
+
+// Expands the next code while the previous ones are on air, so codes go out back to back. The RMT channel
+// is only drained when the carrier frequency changes.
+static void tvbgoneTask(void *pv) {
+    TvBGoneSweep *sweep = (TvBGoneSweep *)pv;
+    IrRmtTx tx;
+    uint32_t durations[TVBGONE_MAX_PAIRS * 2];
+    uint8_t slot = 0;
+
+    if (ir_rmt_begin(tx, bruceConfigPins.irTx, 38000, TVBGONE_SLOTS, tvbgoneCodeSent, sweep)) {
+        for (uint8_t i = 0; i < sweep->numCodes && !sweep->stop; i++) {
+            while (sweep->paused && !sweep->stop) vTaskDelay(pdMS_TO_TICKS(20));
+            const IrCode *code = sweep->codes[i];
+            size_t count = expandPowerCode(code, durations);
+            durations[count - 1] += TVBGONE_CODE_GAP_US;
+
+            xSemaphoreTake(sweep->freeSlots, portMAX_DELAY);
+            size_t symbols =
+                ir_durations_to_symbols(durations, count, sweep->symbols[slot], TVBGONE_MAX_SYMBOLS);
+            if (symbols == 0 || !ir_rmt_set_carrier(tx, code->timer_val * 1000) ||
+                !ir_rmt_send(tx, sweep->symbols[slot], symbols)) {
+                Serial.printf("TV-B-Gone: could not send code %u\n", i);
+                sweep->sent++;
+                xSemaphoreGive(sweep->freeSlots);
+                continue;
+            }
+            slot = (slot + 1) % TVBGONE_SLOTS;
         }
-        bitsleft_r--;
-        tmp |= (((bits_r >> (bitsleft_r)) & 1) << (count - 1 - i));
+        if (!sweep->stop) rmt_tx_wait_all_done(tx.channel, -1);
+    } else {
+        Serial.println("TV-B-Gone: no RMT channel available");
     }
-    return tmp;
+    ir_rmt_end(tx, bruceConfigPins.irTx);
+    sweep->done = true;
+    vTaskDelete(NULL);
 }
-uint16_t ontime, offtime;
-uint8_t i, num_codes;
-uint8_t region;
+
+uint8_t num_codes;
 
 void delay_ten_us(uint16_t us) {
     uint8_t timer;
@@ -122,9 +171,6 @@ void StartTvBGone() {
     PPM.enableOTG();
 #endif
     checkIrTxPin();
-    IRsend irsend(bruceConfigPins.irTx); // Set the GPIO to be used to sending the message.
-    irsend.begin();
-    setup_ir_pin(bruceConfigPins.irTx, OUTPUT);
 
     // determine region
     options = {
@@ -134,42 +180,39 @@ void StartTvBGone() {
     addOptionToMainMenu();
 
     loopOptions(options);
-    uint16_t rawData[300];
 
     if (!returnToMenu) {
-        if (region) num_codes = num_NAcodes;
-        else num_codes = num_EUcodes;
+        TvBGoneSweep *sweep = (TvBGoneSweep *)calloc(1, sizeof(TvBGoneSweep));
+        if (sweep) sweep->freeSlots = xSemaphoreCreateCounting(TVBGONE_SLOTS, TVBGONE_SLOTS);
+        if (!sweep || !sweep->freeSlots) {
+            free(sweep);
+            displayError("Not enough memory", true);
+#ifdef USE_BOOST
+            PPM.disableOTG();
+#endif
+            return;
+        }
+        sweep->codes = region == NA ? NApowerCodes : EUpowerCodes;
+        sweep->numCodes = region == NA ? num_NAcodes : num_EUcodes;
+        num_codes = sweep->numCodes;
 
         bool endingEarly = false; // will be set to true if the user presses the button during code-sending
+        uint32_t startMs = millis();
 
         check(SelPress);
-        for (i = 0; i < num_codes; i++) {
-            if (region == NA) powerCode = NApowerCodes[i];
-            else powerCode = EUpowerCodes[i];
-
-            const uint8_t freq = powerCode->timer_val;
-            const uint8_t numpairs = powerCode->numpairs;
-            const uint8_t bitcompression = powerCode->bitcompression;
-
-            // For EACH pair in this code....
-            code_ptr = 0;
-            for (uint8_t k = 0; k < numpairs; k++) {
-                uint16_t ti;
-                ti = (read_bits(bitcompression)) * 2;
-                offtime = powerCode->times[ti];    // read word 1 - ontime
-                ontime = powerCode->times[ti + 1]; // read word 2 - offtime
-
-                rawData[k * 2] = offtime * 10;
-                rawData[(k * 2) + 1] = ontime * 10;
+        powerHold(); // a sweep takes over a minute without a key press
+        if (xTaskCreate(tvbgoneTask, "tvbgone", 4096, sweep, 2, NULL) != pdPASS) sweep->done = true;
+        uint16_t shown = UINT16_MAX;
+        while (!sweep->done) {
+            if (sweep->sent != shown) {
+                shown = sweep->sent;
+                progressHandler(shown, num_codes);
             }
-            progressHandler(i, num_codes);
-            irsend.sendRaw(rawData, (numpairs * 2), freq);
-            bitsleft_r = 0;
-            delay_ten_us(20500);
 
             // if user is pushing (holding down) TRIGGER button, stop transmission early
-            if (check(SelPress)) // Pause TV-B-Gone
+            if (check(SelPress)) // Pause TV-B-Gone, the codes already queued still go out
             {
+                sweep->paused = true;
                 while (check(SelPress)) yield();
                 displayTextLine("Paused");
 
@@ -178,27 +221,32 @@ void StartTvBGone() {
                         endingEarly = true;
                         break;
                     }
+                    vTaskDelay(pdMS_TO_TICKS(20));
                 }
                 while (check(SelPress)) { yield(); }
                 if (endingEarly) break; // Cancels  TV-B-Gone
                 displayTextLine("Running, Wait");
+                shown = UINT16_MAX;
+                sweep->paused = false;
             }
+            vTaskDelay(pdMS_TO_TICKS(20));
+        } // end of POWER code loop
 
-        } // end of POWER code for loop
+        sweep->stop = true;
+        while (!sweep->done) vTaskDelay(pdMS_TO_TICKS(10));
+        powerRelease();
+        Serial.printf("TV-B-Gone: %u of %u codes in %lu ms\n", sweep->sent, num_codes, millis() - startMs);
+        vSemaphoreDelete(sweep->freeSlots);
+        free(sweep);
 
         if (endingEarly == false) {
             displayTextLine("All codes sent!");
-            // pause for ~1.3 sec, then flash the visible LED 8 times to indicate that we're done
-            delay_ten_us(MAX_WAIT_TIME); // wait 655.350ms
-            delay_ten_us(MAX_WAIT_TIME); // wait 655.350ms
+            delay(1300);
         } else {
             displayRedStripe("User Stopped");
             delay(2000);
         }
 
-        // turnoff LED
-        digitalWrite(bruceConfigPins.irTx, LED_OFF);
-
 #ifdef USE_BOOST
 
         /// DISABLE 5V OUTPUT
@@ -0,0 +1,175 @@
+#include "ir_capture.h"
+#include <IRutils.h>
+
+void ir_capture_from_results(const decode_results &results, IrCapture &capture) {
+    capture.protocol = results.decode_type;
+    capture.repeat = results.repeat;
+    capture.overflow = results.overflow;
+    capture.bits = results.bits;
+    capture.value = results.value;
+    capture.address = results.address;
+    capture.command = results.command;
+    memcpy(capture.state, results.state, sizeof(capture.state));
+
+    // rawbuf[0] is the gap before the frame. Durations over 65535us become 65535, 0, rest.
+    uint16_t len = 0;
+    for (uint16_t i = 1; i < results.rawlen; i++) {
+        uint32_t usecs = results.rawbuf[i] * kRawTick;
+        while (usecs > UINT16_MAX && len + 2 < IR_CAPTURE_MAX_RAW) {
+            capture.raw[len++] = UINT16_MAX;
+            capture.raw[len++] = 0;
+            usecs -= UINT16_MAX;
+        }
+        if (len >= IR_CAPTURE_MAX_RAW || usecs > UINT16_MAX) {
+            capture.overflow = true;
+            break;
+        }
+        capture.raw[len++] = usecs;
+    }
+    capture.rawLen = len;
+}
+
+// "AA BB CC DD", least significant byte first unless msbFirst
+static void printHex32(Print &out, uint32_t value, bool msbFirst = false) {
+    char buffer[12];
+    uint8_t b[4] = {
+        (uint8_t)value, (uint8_t)(value >> 8), (uint8_t)(value >> 16), (uint8_t)(value >> 24)
+    };
+    if (msbFirst) snprintf(buffer, sizeof(buffer), "%02X %02X %02X %02X", b[3], b[2], b[1], b[0]);
+    else snprintf(buffer, sizeof(buffer), "%02X %02X %02X %02X", b[0], b[1], b[2], b[3]);
+    out.print(buffer);
+}
+
+static void printHexBytes(Print &out, const uint8_t *bytes, size_t len) {
+    char buffer[4];
+    for (size_t i = 0; i < len; i++) {
+        snprintf(buffer, sizeof(buffer), i == 0 ? "%02X" : " %02X", bytes[i]);
+        out.print(buffer);
+    }
+}
+
+// Timings are batched so a long frame is a few writes instead of one per number
+static void printTimings(Print &out, const uint16_t *raw, uint16_t len) {
+    char buffer[64];
+    size_t fill = 0;
+    for (uint16_t i = 0; i < len; i++) {
+        if (fill + 7 > sizeof(buffer)) { // " 65535" and the terminator
+            out.write((const uint8_t *)buffer, fill);
+            fill = 0;
+        }
+        fill += snprintf(buffer + fill, sizeof(buffer) - fill, i == 0 ? "%u" : " %u", raw[i]);
+    }
+    out.write((const uint8_t *)buffer, fill);
+}
+
+// Protocol names as used by Flipper files
+// https://github.com/jamisonderek/flipper-zero-tutorials/wiki/Infrared
+static String protocolName(const IrCapture &capture) {
+    switch (capture.protocol) {
+        case decode_type_t::RC5: return capture.command > 0x3F ? "RC5X" : "RC5";
+        case decode_type_t::RC6: return "RC6";
+        case decode_type_t::SAMSUNG: return "Samsung32";
+        case decode_type_t::SONY:
+            // check address and command ranges to find the exact protocol
+            if (capture.address > 0xFF) return "SIRC20";
+            if (capture.address > 0x1F) return "SIRC15";
+            return "SIRC";
+        case decode_type_t::NEC:
+            if (capture.address > 0xFFFF) return "NEC42ext";
+            if (capture.address > 0xFF1F) return "NECext";
+            if (capture.address > 0xFF) return "NEC42";
+            return "NEC";
+        default: return typeToString(capture.protocol, capture.repeat);
+    }
+}
+
+bool ir_capture_write(Print &out, const IrCapture &capture, const String &name, bool raw) {
+    if (!raw && capture.protocol == decode_type_t::UNKNOWN) return false;
+
+    out.printf("name: %s\n", name.c_str());
+    if (raw) {
+        out.printf(
+            "type: raw\nfrequency: %d\nduty_cycle: %.2f\ndata: ", IR_CAPTURE_FREQUENCY, IR_CAPTURE_DUTY_CYCLE
+        );
+        printTimings(out, capture.raw, capture.rawLen);
+    } else {
+        out.printf("type: parsed\nprotocol: %s\naddress: ", protocolName(capture).c_str());
+        printHex32(out, capture.address);
+        out.print("\ncommand: ");
+        printHex32(out, capture.command);
+
+        // extra fields not supported on flipper
+        out.printf("\nbits: %u\n", capture.bits);
+        if (hasACState(capture.protocol)) {
+            out.print("state: ");
+            printHexBytes(out, capture.state, min((size_t)capture.bits / 8, sizeof(capture.state)));
+        } else if (capture.bits > 32) {
+            out.print("value: ");
+            printHex32(out, capture.value);
+            out.print(" ");
+            printHex32(out, capture.value >> 32);
+        } else {
+            out.print("value: ");
+            printHex32(out, capture.value, true);
+        }
+    }
+    out.print("\n#\n");
+    return true;
+}
+
+/**********************************************************************
+**  Capture ring
+**********************************************************************/
+IrCaptureRing::~IrCaptureRing() { end(); }
+
+bool IrCaptureRing::begin() {
+    if (slots != NULL) return true;
+    size_t size = IR_CAPTURE_SLOTS * sizeof(IrCapture);
+    slots = (IrCapture *)heap_caps_malloc(size, MALLOC_CAP_8BIT | MALLOC_CAP_SPIRAM);
+    if (!slots) slots = (IrCapture *)heap_caps_malloc(size, MALLOC_CAP_8BIT);
+    freeSlots = xQueueCreate(IR_CAPTURE_SLOTS, sizeof(uint8_t));
+    readySlots = xQueueCreate(IR_CAPTURE_SLOTS, sizeof(uint8_t));
+    if (slots == NULL || freeSlots == NULL || readySlots == NULL) {
+        end();
+        return false;
+    }
+    for (uint8_t i = 0; i < IR_CAPTURE_SLOTS; i++) xQueueSend(freeSlots, &i, 0);
+    dropped = 0;
+    return true;
+}
+
+void IrCaptureRing::end() {
+    if (freeSlots != NULL) vQueueDelete(freeSlots);
+    if (readySlots != NULL) vQueueDelete(readySlots);
+    free(slots);
+    freeSlots = NULL;
+    readySlots = NULL;
+    slots = NULL;
+}
+
+IrCapture *IrCaptureRing::acquire() {
+    uint8_t i;
+    if (freeSlots == NULL || xQueueReceive(freeSlots, &i, 0) != pdTRUE) {
+        dropped++;
+        return NULL;
+    }
+    return &slots[i];
+}
+
+void IrCaptureRing::commit(IrCapture *capture) {
+    uint8_t i = capture - slots;
+    xQueueSend(readySlots, &i, 0);
+}
+
+IrCapture *IrCaptureRing::peek() {
+    uint8_t i;
+    if (readySlots == NULL || xQueuePeek(readySlots, &i, 0) != pdTRUE) return NULL;
+    return &slots[i];
+}
+
+void IrCaptureRing::release() {
+    uint8_t i;
+    if (readySlots != NULL && xQueueReceive(readySlots, &i, 0) == pdTRUE) xQueueSend(freeSlots, &i, 0);
+}
+
+UBaseType_t IrCaptureRing::pending() { return readySlots == NULL ? 0 : uxQueueMessagesWaiting(readySlots); }
@@ -0,0 +1,62 @@
+#ifndef __IR_CAPTURE_H
+#define __IR_CAPTURE_H
+#include <IRrecv.h>
+#include <globals.h>
+
+/**********************************************************************
+**  IR captures
+**  A received frame is copied out of the receiver into a fixed record so
+**  the receiver can listen again right away. Records go through a ring
+**  of preallocated slots and are written to .ir files field by field,
+**  without building the entry in a String first.
+**********************************************************************/
+#define IR_CAPTURE_SLOTS 4
+#define IR_CAPTURE_MAX_RAW 1024 // timings kept per capture, longer frames are truncated
+#define IR_CAPTURE_FREQUENCY 38000
+#define IR_CAPTURE_DUTY_CYCLE 0.330000
+
+struct IrCapture {
+    decode_type_t protocol;
+    bool repeat;
+    bool overflow; // the receiver buffer or rawLen was too small, the frame is truncated
+    uint16_t bits;
+    uint64_t value;
+    uint32_t address;
+    uint32_t command;
+    uint8_t state[kStateSizeMax];
+    uint16_t rawLen;
+    uint16_t raw[IR_CAPTURE_MAX_RAW]; // mark/space durations in us, starting with a mark
+};
+
+// Copies a decoded frame and its timings (same conversion as resultToRawArray, without the allocation)
+void ir_capture_from_results(const decode_results &results, IrCapture &capture);
+
+// Writes one "name: ... #" entry. Returns false, without writing, for a frame that can only be saved raw.
+bool ir_capture_write(Print &out, const IrCapture &capture, const String &name, bool raw);
+
+// Single producer, single consumer ring of capture slots.
+// The producer fills acquire() and hands it over with commit(); the consumer reads peek() and gives
+// it back with release(). Nothing blocks: a full ring drops the new frame and counts it.
+class IrCaptureRing {
+public:
+    ~IrCaptureRing();
+
+    bool begin();
+    void end();
+
+    IrCapture *acquire();
+    void commit(IrCapture *capture);
+
+    IrCapture *peek();
+    void release();
+
+    UBaseType_t pending();
+    uint32_t dropped = 0;
+
+private:
+    IrCapture *slots = NULL;
+    QueueHandle_t freeSlots = NULL;
+    QueueHandle_t readySlots = NULL;
+};
+
+#endif
@@ -16,6 +16,7 @@
 #include "TV-B-Gone.h" // for checkIrTxPin()
 #include "core/display.h"
 #include "core/mykeyboard.h"
+#include "core/powerSave.h"
 #include "core/settings.h"
 #include "core/utils.h"
 #include "ir_utils.h"
@@ -30,6 +31,118 @@ const int NUM_FREQS = sizeof(IR_FREQUENCIES) / sizeof(IR_FREQUENCIES[0]);
 // Human-readable mode names for display
 const char *IR_MODE_NAMES[] = {"BASIC", "ENH. BASIC", "SWEEP", "RANDOM", "EMPTY"};
 
+/**
+ * Jamming engine
+ * A background task keeps JAM_BUFFERS blocks queued on the RMT channel: while one
+ * is on air the next is filled, so the signal has no gaps whatever the UI does.
+ * The only pauses are carrier changes (RANDOM/EMPTY), where the queue is drained first.
+ */
+struct JamEngine {
+    JammerState *state;
+    IrRmtTx tx;
+    JamBlock blocks[JAM_BUFFERS];
+    SemaphoreHandle_t freeBlocks;
+    TaskHandle_t task;
+    uint8_t onAir; // oldest queued block, advanced as blocks complete
+    volatile bool stop;
+    volatile bool done;
+
+    // Totals of the completed blocks, updated from the RMT interrupt
+    volatile uint32_t blocksSent;
+    volatile uint32_t markUs;
+    volatile uint32_t pulses;
+};
+static JamEngine *engine = nullptr;
+
+static bool IRAM_ATTR jamBlockSent(rmt_channel_handle_t, const rmt_tx_done_event_data_t *, void *user) {
+    JamEngine *e = (JamEngine *)user;
+    BaseType_t highTaskWakeup = pdFALSE;
+    const JamBlock &block = e->blocks[e->onAir];
+    e->markUs += block.markUs;
+    e->pulses += block.pulses;
+    e->blocksSent++;
+    e->onAir = (e->onAir + 1) % JAM_BUFFERS;
+    xSemaphoreGiveFromISR(e->freeBlocks, &highTaskWakeup);
+    return highTaskWakeup == pdTRUE;
+}
+
+static void jamEngineTask(void *pv) {
+    JamEngine *e = (JamEngine *)pv;
+    uint8_t filling = 0;
+    while (!e->stop) {
+        if (!e->state->jamming_active) {
+            vTaskDelay(pdMS_TO_TICKS(20));
+            continue;
+        }
+        if (xSemaphoreTake(e->freeBlocks, pdMS_TO_TICKS(100)) != pdTRUE) continue;
+
+        JamBlock &block = e->blocks[filling];
+        fillJamBlock(*e->state, block);
+        if (block.count == 0 || !ir_rmt_set_carrier(e->tx, block.carrierHz) ||
+            !ir_rmt_send(e->tx, block.symbols, block.count)) {
+            xSemaphoreGive(e->freeBlocks);
+            vTaskDelay(pdMS_TO_TICKS(20));
+            continue;
+        }
+        filling = (filling + 1) % JAM_BUFFERS;
+    }
+    e->done = true;
+    vTaskDelete(NULL);
+}
+
+/**
+ * Block building helpers
+ * A mark/space pair is one symbol. Bursts take the share of the time given by
+ * the power setting (5% per step), followed by the matching silence.
+ */
+static void beginBlock(JamBlock &block, uint32_t carrierHz) {
+    block.count = 0;
+    block.carrierHz = carrierHz;
+    block.totalUs = 0;
+    block.markUs = 0;
+    block.pulses = 0;
+}
+
+static bool addPulse(JamBlock &block, uint32_t markUs, uint32_t spaceUs) {
+    if (block.count >= JAM_BLOCK_SYMBOLS) return false;
+    markUs = constrain(markUs, 1, IR_RMT_MAX_TICKS);
+    spaceUs = constrain(spaceUs, 1, IR_RMT_MAX_TICKS);
+    rmt_symbol_word_t &symbol = block.symbols[block.count++];
+    symbol.level0 = 1;
+    symbol.duration0 = markUs;
+    symbol.level1 = 0;
+    symbol.duration1 = spaceUs;
+    block.totalUs += markUs + spaceUs;
+    block.markUs += markUs;
+    block.pulses++;
+    return true;
+}
+
+static uint8_t jamPower(JammerState &state) { return constrain(state.jamDensity, 1, 20); }
+
+static uint32_t burstUs(JammerState &state) { return JAM_BLOCK_US * jamPower(state) / 20; }
+
+// Adds the silence that goes with the burst in the block. Based on the burst actually built, as short
+// timings can fill the symbols before burstUs() is reached.
+static void endBlock(JammerState &state, JamBlock &block) {
+    uint32_t targetUs = (uint64_t)block.totalUs * 20 / jamPower(state);
+    while (block.totalUs < targetUs && block.count < JAM_BLOCK_SYMBOLS) {
+        uint32_t left = targetUs - block.totalUs;
+        uint32_t half = min(left / 2, (uint32_t)IR_RMT_MAX_TICKS);
+        if (half == 0) break;
+        rmt_symbol_word_t &symbol = block.symbols[block.count++];
+        symbol.level0 = 0;
+        symbol.duration0 = half;
+        symbol.level1 = 0;
+        symbol.duration1 = half;
+        block.totalUs += 2 * half;
+    }
+}
+
+static void addSquareWave(JamBlock &block, uint32_t markUs, uint32_t spaceUs, uint32_t untilUs) {
+    while (block.totalUs + markUs + spaceUs <= untilUs && addPulse(block, markUs, spaceUs));
+}
+
 /**
  * Initialize the jammer state with safe default values
  * Sets up timing parameters, patterns, and resets statistics
@@ -46,19 +159,12 @@ void initJammerState(JammerState &state) {
     state.sweepDirection = 1;
     state.current_freq_idx = 3; // Start with 38kHz (most common)
 
-    // Initialize basic pattern
-    for (int i = 0; i < 20; i += 2) {
-        state.basicPattern[i] = state.markTiming;
-        state.basicPattern[i + 1] = state.spaceTiming;
-    }
-
-    // Initialize random pattern
     randomSeed(millis());
-    for (int i = 0; i < 30; i++) { state.randomPattern[i] = random(10, 1000); }
 
     // Reset stats
     state.jamCount = 0;
     state.startTime = millis();
+    state.statsTime = micros();
 
     // Update settings based on mode
     updateMaxSettings(state);
@@ -230,10 +336,7 @@ void displayStats(JammerState &state, int x, int y) {
     // Only update runtime if actively jamming
     if (state.jamming_active) { state.runtime = runtime; }
 
-    // Calculate jams per second (efficiency metric)
-    float jps = state.runtime > 0 ? (float)state.jamCount / state.runtime : 0;
-
-    // Display jam count
+    // Display block count
     tft.print("Jams : ");
     tft.println(state.jamCount);
 
@@ -241,9 +344,11 @@ void displayStats(JammerState &state, int x, int y) {
     tft.setCursor(tftWidth / 2, tft.getCursorY() + 5);
     tft.printf("Time : %02d:%02d", state.runtime / 60, state.runtime % 60);
 
-    // Display efficiency metric
+    // Display measured output: LED on time and pulse rate
+    tft.setCursor(tftWidth / 2, tft.getCursorY() + 12);
+    tft.printf("Duty : %.1f%%  ", state.dutyAchieved);
     tft.setCursor(tftWidth / 2, tft.getCursorY() + 12);
-    tft.printf("J/s  : %.1f", jps);
+    tft.printf("P/s  : %lu    ", state.pulsesPerSecond);
 }
 
 /**
@@ -299,6 +404,10 @@ void handleSettingChange(JammerState &state, bool nextPressed, bool prevPressed)
         case 1: // Frequency selection
             // Cycle through available frequencies with wrap-around
             state.current_freq_idx = (state.current_freq_idx + adjustment + NUM_FREQS) % NUM_FREQS;
+            // The square wave modes send no carrier, their timing is the frequency
+            if (state.currentMode == BASIC || state.currentMode == ENHANCED_BASIC) {
+                state.markTiming = state.spaceTiming = 500000 / getFrequency(state.current_freq_idx);
+            }
             break;
 
         case 2: // Jamming mode selection
@@ -306,37 +415,17 @@ void handleSettingChange(JammerState &state, bool nextPressed, bool prevPressed)
             state.currentMode = (JamMode)((state.currentMode + adjustment + 5) % 5);
             // Update available settings based on new mode
             updateMaxSettings(state);
-            updatePatterns(state);
             break;
 
         // Mode-specific settings (handled by the helper function)
         default: adjustModeSpecificSetting(state, state.settingIndex, adjustment); break;
     }
 
-    // Mark UI for redrawing and update pattern arrays
+    // Mark UI for redrawing, the engine picks the new values up with the next block
     state.redraw = true;
-    updatePatterns(state);
     delay(100); // Prevent too rapid changes when button is held
 }
 
-/**
- * Update pattern arrays based on current timing settings
- * These patterns are used by the IR library for signal generation
- *
- * @param state Current jammer state containing timing parameters
- */
-void updatePatterns(JammerState &state) {
-    // Update the basic pattern with current mark/space timings
-    // Even indices are mark durations, odd indices are space durations
-    for (int i = 0; i < 20; i += 2) {
-        state.basicPattern[i] = state.markTiming;
-        state.basicPattern[i + 1] = state.spaceTiming;
-    }
-
-    // Note: Random pattern is updated separately in the random jamming function
-    // because it needs to change with each transmission
-}
-
 /**
  * Update the maximum number of settings available based on the current mode
  * Different modes have different numbers of configurable parameters
@@ -366,22 +455,30 @@ void updateMaxSettings(JammerState &state) {
 }
 
 /**
- * Initialize the IR transmitter hardware
+ * Initialize the IR transmitter hardware and start the jamming engine
  *
- * @param irsend Reference to the IR transmitter object
+ * @param state Jammer state the engine reads its settings from
+ * @return false if the RMT channel or the engine task could not be created
  */
-void setupJammer(IRsend &irsend) {
+bool setupJammer(JammerState &state) {
     // Validate IR transmitter pin configuration
     checkIrTxPin();
 
-    // Initialize IR transmission library
-    irsend.begin();
-
-    // Configure IR LED pin as output
-    setup_ir_pin(bruceConfigPins.irTx, OUTPUT);
-
     // Draw UI border on the display
     drawMainBorder();
+
+    engine = (JamEngine *)calloc(1, sizeof(JamEngine));
+    if (engine == nullptr) return false;
+    engine->state = &state;
+    engine->tx = IrRmtTx();
+    engine->freeBlocks = xSemaphoreCreateCounting(JAM_BUFFERS, JAM_BUFFERS);
+    if (engine->freeBlocks == NULL ||
+        !ir_rmt_begin(engine->tx, bruceConfigPins.irTx, 0, JAM_BUFFERS, jamBlockSent, engine) ||
+        xTaskCreate(jamEngineTask, "irJammer", 4096, engine, 2, &engine->task) != pdPASS) {
+        cleanupJammer();
+        return false;
+    }
+    return true;
 }
 
 /**
@@ -476,213 +573,150 @@ void renderJammerUI(JammerState &state) {
 }
 
 /**
- * Update jamming statistics after transmitting signals
- * Increments jam count and triggers UI update when needed
+ * Update jamming statistics from the engine counters
+ * Duty cycle and pulse rate are measured over about one second of wall time,
+ * so any gap in the output shows up as a lower duty cycle.
  *
  * @param state Current jammer state to update
  */
 void updateStats(JammerState &state) {
-    // Increment jam count for each signal transmitted
-    state.jamCount++;
-
-    // Only update UI every 10 jams to reduce display flicker
-    if (state.jamCount % 10 == 0) { state.redraw = true; }
+    if (engine == nullptr) return;
+    uint32_t now = micros();
+    uint32_t elapsed = now - state.statsTime;
+    if (elapsed < 1000000) return;
+
+    uint32_t markUs = engine->markUs;
+    uint32_t pulses = engine->pulses;
+    state.dutyAchieved = (markUs - state.statsMarkUs) * 100.0f / elapsed;
+    state.pulsesPerSecond = (uint64_t)(pulses - state.statsPulses) * 1000000 / elapsed;
+    state.statsMarkUs = markUs;
+    state.statsPulses = pulses;
+    state.statsTime = now;
+    uint32_t blocks = engine->blocksSent;
+    state.jamCount += blocks - state.statsBlocks;
+    state.statsBlocks = blocks;
+    state.redraw = true;
 }
 
 /**
- * Execute jamming operations based on current mode and settings
- * Controls the frequency of signals based on jam density
+ * Fill the next block for the current mode
  *
  * @param state Current jammer configuration
- * @param irsend IR transmitter interface
+ * @param block Block to fill
  */
-void performJamming(JammerState &state, IRsend &irsend) {
-    // Skip if jamming is paused
-    if (!state.jamming_active) return;
-
-    uint32_t currentMillis = millis();
-
-    // Control signal frequency based on density setting
-    // Higher density = more frequent signals
-    if (currentMillis - state.lastJamTime >= (10 / state.jamDensity)) {
-        state.lastJamTime = currentMillis;
-
-        // Select appropriate jamming implementation based on mode
-        switch (state.currentMode) {
-            case BASIC: performBasicJamming(state, irsend); break;
-            case ENHANCED_BASIC: performEnhancedBasicJamming(state, irsend); break;
-            case SWEEP: performSweepJamming(state, irsend); break;
-            case RANDOM: performRandomJamming(state, irsend); break;
-            case EMPTY: performEmptyJamming(state, irsend); break;
-        }
-
-        // Update statistics after sending jam signals
-        updateStats(state);
+void fillJamBlock(JammerState &state, JamBlock &block) {
+    switch (state.currentMode) {
+        case BASIC: fillBasicBlock(state, block); break;
+        case ENHANCED_BASIC: fillEnhancedBasicBlock(state, block); break;
+        case SWEEP: fillSweepBlock(state, block); break;
+        case RANDOM: fillRandomBlock(state, block); break;
+        case EMPTY: fillEmptyBlock(state, block); break;
     }
+    endBlock(state, block);
 }
 
 /**
- * Implement basic jamming mode with fixed, equal mark/space timing
- * Uses both direct LED control and IR library for maximum effectiveness
+ * Basic jamming mode with fixed, equal mark/space timing
+ * The square wave itself is the signal, so it is sent without carrier
  *
  * @param state Current jammer configuration
- * @param irsend IR transmitter interface
+ * @param block Block to fill
  */
-void performBasicJamming(JammerState &state, IRsend &irsend) {
-    uint32_t currentMillis = millis();
-
-    // Throttle transmission rate to prevent hardware overload
-    if (currentMillis - state.last_update > 20) {
-        // Method 1: Direct LED control for precise timing
-        // Generates simple square wave with equal mark/space duration
-        for (int i = 0; i < 50 * state.jamDensity; i++) {
-            digitalWrite(bruceConfigPins.irTx, HIGH);
-            delayMicroseconds(state.markTiming);
-            digitalWrite(bruceConfigPins.irTx, LOW);
-            delayMicroseconds(state.markTiming);
-        }
-
-        // Method 2: Use IR library for compatibility with different protocols
-        irsend.sendRaw(state.basicPattern, 20, getFrequency(state.current_freq_idx));
-        state.last_update = currentMillis;
-    }
+void fillBasicBlock(JammerState &state, JamBlock &block) {
+    beginBlock(block, 0);
+    addSquareWave(block, state.markTiming, state.markTiming, burstUs(state));
 }
 
 /**
- * Implement enhanced basic jamming with separate mark/space timing control
- * This mode provides more precise control over IR signal characteristics
+ * Enhanced basic jamming with separate mark/space timing control
  *
  * @param state Current jammer configuration
- * @param irsend IR transmitter interface
+ * @param block Block to fill
  */
-void performEnhancedBasicJamming(JammerState &state, IRsend &irsend) {
-    uint32_t currentMillis = millis();
-
-    // Throttle transmission rate
-    if (currentMillis - state.last_update > 20) {
-        // Method 1: Direct LED control with separate mark/space timing
-        // Provides more flexibility to target specific IR protocols
-        for (int i = 0; i < 25 * state.jamDensity; i++) {
-            digitalWrite(bruceConfigPins.irTx, HIGH);
-            delayMicroseconds(state.markTiming);
-            digitalWrite(bruceConfigPins.irTx, LOW);
-            delayMicroseconds(state.spaceTiming);
-        }
-
-        // Method 2: Use IR library with custom pattern
-        irsend.sendRaw(state.basicPattern, 20, getFrequency(state.current_freq_idx));
-        state.last_update = currentMillis;
-    }
+void fillEnhancedBasicBlock(JammerState &state, JamBlock &block) {
+    beginBlock(block, 0);
+    addSquareWave(block, state.markTiming, state.spaceTiming, burstUs(state));
 }
 
 /**
- * Implement sweep jamming mode that varies timing continuously
- * Effective against IR protocols with dynamic timing adaptation
+ * Sweep jamming: the timing moves by one step per block, bouncing between min and max.
+ * The next block is filled while the current one is on air, so steps follow without a gap.
  *
  * @param state Current jammer configuration
- * @param irsend IR transmitter interface
+ * @param block Block to fill
  */
-void performSweepJamming(JammerState &state, IRsend &irsend) {
-    uint32_t currentMillis = millis();
-
-    // Faster update rate for smooth sweep
-    if (currentMillis - state.last_update > 30) {
-        // Update timing values based on current direction and speed
-        state.markTiming += state.sweepDirection * state.sweepSpeed;
-
-        // Change direction if we hit the min/max bounds
-        if (state.markTiming > state.maxTiming || state.markTiming < state.minTiming) {
-            state.sweepDirection *= -1; // Reverse direction
-            // Constrain to prevent exceeding bounds
-            state.markTiming = constrain(state.markTiming, state.minTiming, state.maxTiming);
-        }
-
-        // For sweep mode, keep mark and space timings equal
-        state.spaceTiming = state.markTiming;
+void fillSweepBlock(JammerState &state, JamBlock &block) {
+    // Update timing values based on current direction and speed
+    int timing = state.markTiming + state.sweepDirection * state.sweepSpeed;
+
+    // Change direction if we hit the min/max bounds
+    if (timing > state.maxTiming || timing < state.minTiming) {
+        state.sweepDirection *= -1; // Reverse direction
+        // Constrain to prevent exceeding bounds
+        timing = constrain(timing, state.minTiming, state.maxTiming);
+    }
 
-        // Update pattern array with new timings
-        updatePatterns(state);
+    // For sweep mode, keep mark and space timings equal
+    state.markTiming = state.spaceTiming = timing;
 
-        // Direct LED control for precise timing
-        for (int i = 0; i < 20 * state.jamDensity; i++) {
-            digitalWrite(bruceConfigPins.irTx, HIGH);
-            delayMicroseconds(state.markTiming);
-            digitalWrite(bruceConfigPins.irTx, LOW);
-            delayMicroseconds(state.markTiming);
-        }
-
-        // Also use IR library for protocol compatibility
-        irsend.sendRaw(state.basicPattern, 20, getFrequency(state.current_freq_idx));
-        state.last_update = currentMillis;
-    }
+    beginBlock(block, 0);
+    addSquareWave(block, timing, timing, burstUs(state));
 }
 
 /**
- * Implement random jamming mode with unpredictable patterns
+ * Random jamming: random marks and spaces on the carrier, which changes now and then
  * Most effective against smart/learning remotes and adaptive systems
  *
  * @param state Current jammer configuration
- * @param irsend IR transmitter interface
+ * @param block Block to fill
  */
-void performRandomJamming(JammerState &state, IRsend &irsend) {
-    uint32_t currentMillis = millis();
-
-    // Slower update rate to allow for more random pattern generation
-    if (currentMillis - state.last_update > 100) {
-        // Generate new random pattern for each transmission
-        for (int i = 0; i < 30; i++) {
-            state.randomPattern[i] = random(5, 1000); // Random durations between 5-1000µs
-        }
-
-        // Send multiple random patterns based on jam density
-        for (int i = 0; i < state.jamDensity / 2 + 1; i++) {
-            // Randomly change carrier frequency to disrupt more protocols
-            if (random(10) < 3) { state.current_freq_idx = random(NUM_FREQS); }
-
-            // Send the random pattern at the selected frequency
-            irsend.sendRaw(state.randomPattern, 30, getFrequency(state.current_freq_idx));
-        }
-
-        state.last_update = currentMillis;
+void fillRandomBlock(JammerState &state, JamBlock &block) {
+    // Randomly change carrier frequency to disrupt more protocols
+    if (random(10) < 3) { state.current_freq_idx = random(NUM_FREQS); }
+    beginBlock(block, getFrequency(state.current_freq_idx));
+
+    uint32_t until = burstUs(state);
+    while (block.totalUs < until) {
+        // Random durations between 5-1000µs
+        if (!addPulse(block, random(5, 1000), random(5, 1000))) break;
     }
 }
 
 /**
- * Implement empty packet jamming mode with minimal valid IR signals
- * Effective at confusing IR receivers while using minimal power
+ * Empty packet jamming: single carrier cycles, just enough to wake receivers up
  *
  * @param state Current jammer configuration
- * @param irsend IR transmitter interface
+ * @param block Block to fill
  */
-void performEmptyJamming(JammerState &state, IRsend &irsend) {
-    uint32_t currentMillis = millis();
-
-    // Medium update rate optimized for empty packet transmission
-    if (currentMillis - state.last_update > 50) {
-        // Send multiple empty packets at the current frequency
-        for (int i = 0; i < state.jamDensity; i++) {
-            irsend.sendRaw(state.emptyPattern, 4, getFrequency(state.current_freq_idx));
-        }
-
-        // Occasionally change frequency (40% chance)
-        if (random(5) < 2) { state.current_freq_idx = (state.current_freq_idx + 1) % NUM_FREQS; }
-
-        state.last_update = currentMillis;
-    }
+void fillEmptyBlock(JammerState &state, JamBlock &block) {
+    // Occasionally change frequency (40% chance)
+    if (random(5) < 2) { state.current_freq_idx = (state.current_freq_idx + 1) % NUM_FREQS; }
+    uint32_t freq = getFrequency(state.current_freq_idx);
+    beginBlock(block, freq);
+
+    uint32_t period = 1000000 / freq;
+    addSquareWave(block, period, 4 * period, burstUs(state));
 }
 
 /**
- * Clean up resources and show exit message when jammer is stopped
- *
- * @param irsend IR transmitter interface to reset
+ * Stop the engine, release the RMT channel and show exit message
  */
-void cleanupJammer(IRsend &irsend) {
+void cleanupJammer() {
+    if (engine != nullptr) {
+        if (engine->task != NULL) {
+            engine->stop = true;
+            while (!engine->done) vTaskDelay(pdMS_TO_TICKS(10));
+        }
+        // Also turns the IR LED off
+        ir_rmt_end(engine->tx, bruceConfigPins.irTx);
+        if (engine->freeBlocks != NULL) vSemaphoreDelete(engine->freeBlocks);
+        free(engine);
+        engine = nullptr;
+    }
 
 #ifdef USE_BOOST /// ENABLE 5V OUTPUT
     PPM.disableOTG();
 #endif
-    // Ensure IR LED is turned off
-    digitalWrite(bruceConfigPins.irTx, LOW);
 
     // Display exit message
     displayRedStripe("IR Jamming Stopped");
@@ -699,28 +733,30 @@ void startIrJammer() {
 #ifdef USE_BOOST /// ENABLE 5V OUTPUT
     PPM.enableOTG();
 #endif
-    // Initialize IR transmitter with configured pin
-    IRsend irsend(bruceConfigPins.irTx);
-
     // Initialize jammer state structure
     JammerState state;
-
-    // Set up hardware and state
-    setupJammer(irsend);
     initJammerState(state);
 
-    // Main jammer loop - runs until ESC is pressed
+    // Set up hardware and start the engine
+    if (!setupJammer(state)) {
+        displayError("IR TX not available", true);
+        return;
+    }
+    powerHold(); // the pulses are timed by the RMT, the blocks still have to keep up
+
+    // Main jammer loop - runs until ESC is pressed, the signal comes from the engine task
     while (!check(EscPress)) {
-        renderJammerUI(state);         // Update display
-        performJamming(state, irsend); // Execute jamming if active
-        handleJammerInput(state);      // Process user input
+        renderJammerUI(state);    // Update display
+        updateStats(state);       // Measured duty cycle and pulse rate
+        handleJammerInput(state); // Process user input
 
         // Small delay to prevent system overload
         delay(5);
     }
 
     // Clean up when exiting
-    cleanupJammer(irsend);
+    cleanupJammer();
+    powerRelease();
 }
 
 /**
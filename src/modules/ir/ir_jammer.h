@@ -1,17 +1,20 @@
 /**
  * IR Jammer Header File
- * Defines the structure and functions for IR signal jamming operations
- * on ESP8266-based hardware with IRremoteESP8266 library.
+ * Defines the structure and functions for IR signal jamming operations.
+ * Signals are generated by an RMT channel fed from a background task, so
+ * timing does not depend on the UI loop.
  */
 
 #include <Arduino.h>
 #include <FS.h>
-#include <IRremoteESP8266.h>
-#include <IRsend.h>
-#include <IRutils.h>
 #include <SD.h>
+#include <driver/rmt_tx.h>
 #include <globals.h>
 
+#define JAM_BLOCK_US 20000     // signal time in one queued block
+#define JAM_BLOCK_SYMBOLS 1024 // one mark/space pair per symbol
+#define JAM_BUFFERS 2          // one block on air while the next one is filled
+
 // Jamming modes available to the user
 enum JamMode {
     BASIC,          // Simple fixed-timing jamming
@@ -27,8 +30,6 @@ struct JammerState {
     JamMode currentMode = BASIC; // Current jamming algorithm
     bool jamming_active = true;  // Indicates if actively jamming
     uint8_t jamDensity = 5;      // Controls jamming intensity/frequency (1-10)
-    uint32_t lastJamTime = 0;    // Timestamp of last jam signal
-    uint32_t last_update = 0;    // Timestamp for timing control
 
     // Timing parameters for signal generation
     uint16_t markTiming = 12;  // Mark (ON) pulse duration in microseconds
@@ -49,14 +50,25 @@ struct JammerState {
     uint32_t lastUIUpdate = 0;    // For controlling UI update frequency
 
     // Performance statistics
-    uint32_t jamCount = 0;  // Total number of jamming signals sent
-    uint32_t startTime = 0; // Timestamp when jamming began
-    uint32_t runtime = 0;   // Total running time in seconds
-
-    // Jamming pattern arrays for different modes
-    uint16_t basicPattern[20];               // Pattern for basic/enhanced modes (alternating mark/space)
-    uint16_t emptyPattern[4] = {1, 1, 1, 1}; // Minimal pattern for maximum disruption
-    uint16_t randomPattern[30];              // Buffer for dynamically generated random patterns
+    uint32_t jamCount = 0;        // Total number of blocks sent
+    uint32_t startTime = 0;       // Timestamp when jamming began
+    uint32_t runtime = 0;         // Total running time in seconds
+    float dutyAchieved = 0;       // Share of time the LED was driven over the last second (%)
+    uint32_t pulsesPerSecond = 0; // Marks sent over the last second
+    uint32_t statsTime = 0;       // micros() of the last statistics sample
+    uint32_t statsMarkUs = 0;     // Engine counters at the last sample
+    uint32_t statsPulses = 0;
+    uint32_t statsBlocks = 0;
+};
+
+// One block of symbols for the RMT channel, with what it contains for the statistics
+struct JamBlock {
+    rmt_symbol_word_t symbols[JAM_BLOCK_SYMBOLS];
+    size_t count;       // Symbols used
+    uint32_t carrierHz; // 0 sends the marks unmodulated
+    uint32_t totalUs;   // Length of the block
+    uint32_t markUs;    // Time spent in marks
+    uint32_t pulses;    // Number of marks
 };
 
 // Function prototypes
@@ -68,10 +80,11 @@ struct JammerState {
 void initJammerState(JammerState &state);
 
 /**
- * Configure hardware for IR transmission
- * @param irsend Reference to IRsend object that controls the IR LED
+ * Configure hardware for IR transmission and start the jamming engine
+ * @param state Jammer state the engine reads its settings from
+ * @return false if the RMT channel or the engine task could not be created
  */
-void setupJammer(IRsend &irsend);
+bool setupJammer(JammerState &state);
 
 /**
  * Display the jammer interface on the device screen
@@ -86,58 +99,51 @@ void renderJammerUI(JammerState &state);
 void handleJammerInput(JammerState &state);
 
 /**
- * Execute the currently selected jamming mode
- * @param state Current jammer configuration
- * @param irsend IR transmitter interface
- */
-void performJamming(JammerState &state, IRsend &irsend);
-
-/**
- * Implement basic jamming mode with fixed timing
+ * Fill the next block for the currently selected jamming mode
  * @param state Current jammer configuration
- * @param irsend IR transmitter interface
+ * @param block Block to fill
  */
-void performBasicJamming(JammerState &state, IRsend &irsend);
+void fillJamBlock(JammerState &state, JamBlock &block);
 
 /**
- * Implement enhanced jamming with independent mark/space timing
+ * Basic jamming: square wave bursts with equal mark/space timing
  * @param state Current jammer configuration
- * @param irsend IR transmitter interface
+ * @param block Block to fill
  */
-void performEnhancedBasicJamming(JammerState &state, IRsend &irsend);
+void fillBasicBlock(JammerState &state, JamBlock &block);
 
 /**
- * Implement jamming with continuously varying timing values
+ * Enhanced jamming with independent mark/space timing
  * @param state Current jammer configuration
- * @param irsend IR transmitter interface
+ * @param block Block to fill
  */
-void performSweepJamming(JammerState &state, IRsend &irsend);
+void fillEnhancedBasicBlock(JammerState &state, JamBlock &block);
 
 /**
- * Implement jamming with randomized patterns
+ * Square wave whose timing moves one step per block between min and max
  * @param state Current jammer configuration
- * @param irsend IR transmitter interface
+ * @param block Block to fill
  */
-void performRandomJamming(JammerState &state, IRsend &irsend);
+void fillSweepBlock(JammerState &state, JamBlock &block);
 
 /**
- * Implement jamming with minimal empty packets
+ * Randomized marks and spaces on a carrier that changes from time to time
  * @param state Current jammer configuration
- * @param irsend IR transmitter interface
+ * @param block Block to fill
  */
-void performEmptyJamming(JammerState &state, IRsend &irsend);
+void fillRandomBlock(JammerState &state, JamBlock &block);
 
 /**
- * Update pattern arrays based on current settings
+ * Minimal carrier blips, stepping through the frequencies
  * @param state Current jammer configuration
+ * @param block Block to fill
  */
-void updatePatterns(JammerState &state);
+void fillEmptyBlock(JammerState &state, JamBlock &block);
 
 /**
- * Clean up resources when exiting jammer mode
- * @param irsend IR transmitter interface to reset
+ * Stop the jamming engine and release the RMT channel
  */
-void cleanupJammer(IRsend &irsend);
+void cleanupJammer();
 
 /**
  * Update the maxSettings value based on the current mode
@@ -146,7 +152,7 @@ void cleanupJammer(IRsend &irsend);
 void updateMaxSettings(JammerState &state);
 
 /**
- * Update jamming statistics (count, runtime)
+ * Update jamming statistics (count, duty cycle, pulses per second) from the engine counters
  * @param state Current jammer state to update
  */
 void updateStats(JammerState &state);
@@ -15,46 +15,19 @@
 #include "ir_utils.h"
 #include <IRrecv.h>
 #include <IRutils.h>
+#include <StreamString.h>
 #include <globals.h>
 
-/* Dont touch this */
-// #define MAX_RAWBUF_SIZE 300
-#define IR_FREQUENCY 38000
-#define DUTY_CYCLE 0.330000
-
-String uint32ToString(uint32_t value) {
-    char buffer[12] = {0}; // 8 hex digits + 3 spaces + 1 null terminator
-    snprintf(
-        buffer,
-        sizeof(buffer),
-        "%02lX %02lX %02lX %02lX",
-        value & 0xFF,
-        (value >> 8) & 0xFF,
-        (value >> 16) & 0xFF,
-        (value >> 24) & 0xFF
-    );
-    return String(buffer);
-}
-
-String uint32ToStringInverted(uint32_t value) {
-    char buffer[12] = {0}; // 8 hex digits + 3 spaces + 1 null terminator
-    snprintf(
-        buffer,
-        sizeof(buffer),
-        "%02lX %02lX %02lX %02lX",
-        (value >> 24) & 0xFF,
-        (value >> 16) & 0xFF,
-        (value >> 8) & 0xFF,
-        value & 0xFF
-    );
-    return String(buffer);
-}
-
 IrRead::IrRead(bool headless_mode, bool raw_mode) {
     headless = headless_mode;
     raw = raw_mode;
     setup();
 }
+
+IrRead::~IrRead() {
+    stop_capture();
+    if (captureFs) captureFs->remove(IR_CAPTURE_TMP);
+}
 bool quickloop = false;
 
 void IrRead::setup() {
@@ -111,8 +84,13 @@ void IrRead::setup() {
 }
 
 void IrRead::loop() {
+    if (!start_capture()) {
+        displayError("Not enough memory", true);
+        return;
+    }
     while (1) {
         if (check(EscPress)) {
+            stop_capture();
             returnToMenu = true;
             button_pos = 0;
             quickloop = false;
@@ -160,6 +138,9 @@ void IrRead::display_banner() {
     tft.setTextSize(FP);
     padprintln("--------------");
     padprintln("Signals captured: " + String(signals_read));
+    shownPending = captures.pending();
+    if (shownPending > 1) padprintln("Waiting to be saved: " + String(shownPending - 1));
+    if (captures.dropped > 0) padprintln("Missed, queue full: " + String(captures.dropped));
     tft.println("");
 }
 
@@ -174,41 +155,83 @@ void IrRead::display_btn_options() {
     padprintln("Press [ESC]  to exit");
 }
 
-void IrRead::read_signal() {
-    if (_read_signal) return;
+bool IrRead::start_capture() {
+    if (captureTask != NULL) return true;
+    if (!captures.begin()) return false;
+    while (captures.peek() != NULL) captures.release(); // left over from a previous loop
+    capturing = true;
+    if (xTaskCreate(capture_task, "irCapture", 4096, this, 2, &captureTask) != pdPASS) {
+        capturing = false;
+        captureTask = NULL;
+        return false;
+    }
+    return true;
+}
 
-    if (irrecv.decode(&results)) {
-        _read_signal = true;
-        raw = true;
-        display_banner();
-        tft.println("CAPTURED !"); 
-        delay(1000);
-        display_btn_options();
+void IrRead::stop_capture() {
+    capturing = false;
+    while (captureTask != NULL) vTaskDelay(pdMS_TO_TICKS(10));
+}
+
+// Copies every frame out of the receiver and resumes it straight away, so presses keep being
+// captured while the UI waits for the user (keyboard, file dialogs)
+void IrRead::capture_task(void *pv) {
+    IrRead *self = (IrRead *)pv;
+    self->irrecv.resume();
+    while (self->capturing) {
+        if (self->irrecv.decode(&self->results)) {
+            // repeat frames of a held button are not a new press
+            if (!self->results.repeat) {
+                IrCapture *capture = self->captures.acquire();
+                if (capture != NULL) {
+                    ir_capture_from_results(self->results, *capture);
+                    self->captures.commit(capture);
+                }
+            }
+            self->irrecv.resume();
+        }
+        vTaskDelay(pdMS_TO_TICKS(5));
     }
-    else if (results.rawlen > 20) {
-        _read_signal = true;
-        raw = true;
-        signals_read++;
-        display_banner();
-        tft.println("RAW FORCE !");
-        delay(1000);
-        display_btn_options();
+    self->captureTask = NULL;
+    vTaskDelete(NULL);
+}
+
+void IrRead::read_signal() {
+    if (captures.peek() == NULL) return;
+    if (_read_signal) {
+        // more presses came in while this one waits, keep the counter on screen current
+        if (captures.pending() != shownPending) {
+            display_banner();
+            tft.println("CAPTURED !");
+            display_btn_options();
+        }
+        return;
     }
+
+    _read_signal = true;
+    raw = true;
+    display_banner();
+    tft.println("CAPTURED !");
+    display_btn_options();
 }
 
 void IrRead::discard_signal() {
     if (!_read_signal) return;
-    irrecv.resume();
+    captures.release();
     begin();
 }
 
 void IrRead::save_signal() {
     if (!_read_signal) return;
-    if (!quickloop) {
-        String btn_name = keyboard("Btn" + String(signals_read), 30, "Btn name:");
-        append_to_file_str(btn_name);
-    } else {
-        append_to_file_str(quickButtons[button_pos]);
+    IrCapture *capture = captures.peek();
+    String btn_name;
+    if (!quickloop) btn_name = keyboard("Btn" + String(signals_read), 30, "Btn name:");
+    else btn_name = quickButtons[button_pos];
+
+    if (!append_capture(btn_name, *capture)) {
+        displayError("Error writing signal.", true);
+        begin(); // the capture stays first in the ring and is shown again
+        return;
     }
     signals_read++;
     if (quickloop) button_pos++;
@@ -216,114 +239,22 @@ void IrRead::save_signal() {
     delay(100);
 }
 
-String IrRead::parse_state_signal() {
-    String r = "";
-    uint16_t state_len = (results.bits) / 8;
-    for (uint16_t i = 0; i < state_len; i++) {
-        // r += uint64ToString(results.state[i], 16) + " ";
-        r += ((results.state[i] < 0x10) ? "0" : ""); // adds 0 padding if necessary
-        r += String(results.state[i], HEX) + " ";
-    }
-    r.toUpperCase();
-    return r;
-}
-
-String IrRead::parse_raw_signal() {
-
-    rawcode = resultToRawArray(&results);
-    raw_data_len = getCorrectedRawLength(&results);
-
-    String signal_code = "";
-
-    for (uint16_t i = 0; i < raw_data_len; i++) { signal_code += String(rawcode[i]) + " "; }
-
-    delete[] rawcode;
-    rawcode = nullptr;
-    signal_code.trim();
-
-    return signal_code;
-}
-
-void IrRead::append_to_file_str(String btn_name) {
-    strDeviceContent += "name: " + btn_name + "\n";
-
-    if (raw) {
-        strDeviceContent += "type: raw\n";
-        strDeviceContent += "frequency: " + String(IR_FREQUENCY) + "\n";
-        strDeviceContent += "duty_cycle: " + String(DUTY_CYCLE) + "\n";
-        strDeviceContent += "data: " + parse_raw_signal() + "\n";
-    } else {
-        // parsed signal  https://github.com/jamisonderek/flipper-zero-tutorials/wiki/Infrared
-        strDeviceContent += "type: parsed\n";
-        switch (results.decode_type) {
-            case decode_type_t::RC5: {
-                if (results.command > 0x3F) strDeviceContent += "protocol: RC5X\n";
-                else strDeviceContent += "protocol: RC5\n";
-                break;
-            }
-            case decode_type_t::RC6: {
-                strDeviceContent += "protocol: RC6\n";
-                break;
-            }
-            case decode_type_t::SAMSUNG: {
-                strDeviceContent += "protocol: Samsung32\n";
-                break;
-            }
-            case decode_type_t::SONY: {
-                // check address and command ranges to find the exact protocol
-                if (results.address > 0xFF) strDeviceContent += "protocol: SIRC20\n";
-                else if (results.address > 0x1F) strDeviceContent += "protocol: SIRC15\n";
-                else strDeviceContent += "protocol: SIRC\n";
-                break;
-            }
-            case decode_type_t::NEC: {
-                // check address and command ranges to find the exact protocol
-                if (results.address > 0xFFFF) strDeviceContent += "protocol: NEC42ext\n";
-                else if (results.address > 0xFF1F) strDeviceContent += "protocol: NECext\n";
-                else if (results.address > 0xFF) strDeviceContent += "protocol: NEC42\n";
-                else strDeviceContent += "protocol: NEC\n";
-                break;
-            }
-            case decode_type_t::UNKNOWN: {
-                Serial.print("unknown protocol, try raw mode");
-                return;
-            }
-            default: {
-                strDeviceContent += "protocol: " + typeToString(results.decode_type, results.repeat) + "\n";
-                break;
-            }
+// Saved signals are written to a temporary file as they come, the device file gets its name and header
+// in save_device()
+bool IrRead::append_capture(const String &btn_name, const IrCapture &capture) {
+    if (captureFs == nullptr) {
+        if (!getFsStorage(captureFs)) {
+            captureFs = nullptr;
+            return false;
         }
-
-        strDeviceContent += "address: " + uint32ToString(results.address) + "\n";
-        strDeviceContent += "command: " + uint32ToString(results.command) + "\n";
-
-        // extra fields not supported on flipper
-        strDeviceContent += "bits: " + String(results.bits) + "\n";
-        if (hasACState(results.decode_type)) strDeviceContent += "state: " + parse_state_signal() + "\n";
-        else if (results.bits > 32)
-            strDeviceContent += "value: " + uint32ToString(results.value) + " " +
-                                uint32ToString(results.value >> 32) + "\n"; // MEMO: from uint64_t
-        else strDeviceContent += "value: " + uint32ToStringInverted(results.value) + "\n";
-
-        /*
-        Serial.println(results.bits);
-        Serial.println(results.address);
-        Serial.println(results.command);
-        Serial.println(results.overflow);
-        Serial.println(results.repeat);
-        Serial.println("value:");
-        serialPrintUint64(results.address, HEX);
-        serialPrintUint64(results.command, HEX);
-        Serial.print("resultToHexidecimal: ");
-        Serial.println(resultToHexidecimal(&results));
-        Serial.println(results.value);
-        String value = uint32ToString(results.value ) + " " + uint32ToString(results.value>> 32);
-        value.replace(" ", "");
-        uint64_t value_int = strtoull(value.c_str(), nullptr, 16);
-        Serial.println(value_int);
-        */
+        if (!(*captureFs).exists("/BruceIR")) (*captureFs).mkdir("/BruceIR");
+        (*captureFs).remove(IR_CAPTURE_TMP); // left by a session that was interrupted
     }
-    strDeviceContent += "#\n";
+    File file = (*captureFs).open(IR_CAPTURE_TMP, FILE_APPEND);
+    if (!file) return false;
+    bool written = ir_capture_write(file, capture, btn_name, raw);
+    file.close();
+    return written;
 }
 
 void IrRead::save_device() {
@@ -355,25 +286,23 @@ void IrRead::save_device() {
     if (fs && write_file(filename, fs)) {
         displaySuccess("File saved to " + String((fs == &SD) ? "SD Card" : "LittleFS") + ".", true);
         signals_read = 0;
-        strDeviceContent = "";
+        (*captureFs).remove(IR_CAPTURE_TMP);
     } else displayError(fs ? "Error writing file." : "No storage available.", true);
 
     delay(1000);
 
-    irrecv.resume();
     begin();
 }
 
 String IrRead::loop_headless(int max_loops) {
-
-    while (!irrecv.decode(&results)) { // MEMO: default timeout is 15ms
-        max_loops -= 1;
-        if (max_loops <= 0) {
+    // max_loops is the timeout in seconds
+    uint32_t deadline = millis() + max_loops * 1000;
+    while (!irrecv.decode(&results)) {
+        if ((int32_t)(millis() - deadline) >= 0) {
             Serial.println("timeout");
             return ""; // nothing received
         }
-        delay(1000);
-        // delay(50);
+        delay(20);
     }
 
     irrecv.disableIRIn();
@@ -386,14 +315,14 @@ String IrRead::loop_headless(int max_loops) {
     if (results.overflow) displayWarning("buffer overflow, data may be truncated", true);
     // TODO: check results.repeat
 
-    String r = "Filetype: IR signals file\n";
-    r += "Version: 1\n";
-    r += "#\n";
-    r += "#\n";
+    IrCapture *capture = (IrCapture *)malloc(sizeof(IrCapture));
+    if (capture == NULL) return "";
+    ir_capture_from_results(results, *capture);
 
-    strDeviceContent = "";
-    append_to_file_str("Unknown"); // writes on strDeviceContent
-    r += strDeviceContent;
+    StreamString r;
+    r.print("Filetype: IR signals file\nVersion: 1\n#\n#\n");
+    ir_capture_write(r, *capture, "Unknown", raw);
+    free(capture);
 
     return r;
 }
@@ -452,9 +381,19 @@ bool IrRead::write_file(String filename, FS *fs) {
     file.println("Version: 1");
     file.println("#");
     file.println("# " + filename);
-    file.print(strDeviceContent);
+
+    File saved = (*captureFs).open(IR_CAPTURE_TMP, FILE_READ);
+    if (!saved) {
+        file.close();
+        return false;
+    }
+    uint8_t buffer[512];
+    size_t len;
+    bool ok = true;
+    while (ok && (len = saved.read(buffer, sizeof(buffer))) > 0) ok = file.write(buffer, len) == len;
+    saved.close();
 
     file.close();
     delay(100);
-    return true;
+    return ok;
 }
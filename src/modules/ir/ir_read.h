@@ -6,9 +6,12 @@
  * @date 2024-07-17
  */
 
+#include "ir_capture.h"
 #include <IRrecv.h>
 #include <globals.h>
 
+#define IR_CAPTURE_TMP "/BruceIR/.capture.tmp" // saved signals until the device file gets its name
+
 class IrRead {
 public:
     // IRrecv irrecv = IRrecv(bruceConfigPins.irRx);
@@ -18,6 +21,7 @@ public:
     // Constructor
     /////////////////////////////////////////////////////////////////////////////////////
     IrRead(bool headless_mode = false, bool raw_mode = false);
+    ~IrRead();
 
     ///////////////////////////////////////////////////////////////////////////////////
     // Arduino Life Cycle
@@ -31,11 +35,13 @@ public:
 private:
     bool _read_signal = false;
     decode_results results;
-    uint16_t *rawcode;
-    uint16_t raw_data_len;
+    IrCaptureRing captures;
+    TaskHandle_t captureTask = NULL;
+    volatile bool capturing = false;
+    UBaseType_t shownPending = 0;
+    FS *captureFs = nullptr; // where IR_CAPTURE_TMP lives
     int signals_read = 0;
     int button_pos = 0;
-    String strDeviceContent = "";
     bool headless = false;
     bool raw = false;
 
@@ -50,14 +56,15 @@ private:
     // Operations
     /////////////////////////////////////////////////////////////////////////////////////
     void begin();
+    bool start_capture();
+    void stop_capture();
+    static void capture_task(void *pv);
     void read_signal();
     void save_device();
     void save_signal();
     void discard_signal();
-    void append_to_file_str(String btn_name);
+    bool append_capture(const String &btn_name, const IrCapture &capture);
     bool write_file(String filename, FS *fs);
-    String parse_raw_signal();
-    String parse_state_signal();
     /////////////////////////////////////////////////////////////////////////////////////
     // Quick Remotes
     /////////////////////////////////////////////////////////////////////////////////////
@@ -5,3 +5,129 @@ void setup_ir_pin(int pin, uint8_t mode) {
     gpio_reset_pin((gpio_num_t)pin);
     pinMode(pin, mode);
 }
+
+bool ir_rmt_begin(
+    IrRmtTx &tx, int pin, uint32_t carrierHz, size_t queueDepth, rmt_tx_done_callback_t onDone, void *user
+) {
+    setup_ir_pin(pin, OUTPUT);
+    rmt_tx_channel_config_t tx_channel_cfg = {};
+    tx_channel_cfg.gpio_num = gpio_num_t(pin);
+    tx_channel_cfg.clk_src = RMT_CLK_SRC_DEFAULT;
+    tx_channel_cfg.resolution_hz = IR_RMT_RESOLUTION_HZ;
+    tx_channel_cfg.mem_block_symbols = 64; // refilled by the driver for longer frames
+    tx_channel_cfg.trans_queue_depth = queueDepth;
+    if (rmt_new_tx_channel(&tx_channel_cfg, &tx.channel) != ESP_OK) {
+        tx.channel = NULL;
+        return false;
+    }
+
+    rmt_copy_encoder_config_t encoder_cfg = {};
+    if (rmt_new_copy_encoder(&encoder_cfg, &tx.encoder) != ESP_OK) {
+        tx.encoder = NULL;
+        ir_rmt_end(tx, pin);
+        return false;
+    }
+    if (onDone != NULL) {
+        rmt_tx_event_callbacks_t cbs = {};
+        cbs.on_trans_done = onDone;
+        rmt_tx_register_event_callbacks(tx.channel, &cbs, user);
+    }
+    if (!ir_rmt_set_carrier(tx, carrierHz) || rmt_enable(tx.channel) != ESP_OK) {
+        ir_rmt_end(tx, pin);
+        return false;
+    }
+    tx.enabled = true;
+    return true;
+}
+
+bool ir_rmt_set_carrier(IrRmtTx &tx, uint32_t carrierHz, float duty) {
+    if (tx.channel == NULL) return false;
+    if (carrierHz == tx.carrierHz) return true;
+    if (tx.enabled) rmt_tx_wait_all_done(tx.channel, -1);
+    rmt_carrier_config_t carrier_cfg = {};
+    carrier_cfg.frequency_hz = carrierHz;
+    carrier_cfg.duty_cycle = duty;
+    // 0 Hz sends the marks unmodulated
+    if (rmt_apply_carrier(tx.channel, carrierHz ? &carrier_cfg : NULL) != ESP_OK) return false;
+    tx.carrierHz = carrierHz;
+    return true;
+}
+
+bool ir_rmt_send(IrRmtTx &tx, const rmt_symbol_word_t *symbols, size_t count) {
+    if (!tx.enabled) return false;
+    rmt_transmit_config_t tx_cfg = {};
+    tx_cfg.loop_count = 0;
+    size_t bytes = count * sizeof(rmt_symbol_word_t);
+    return rmt_transmit(tx.channel, tx.encoder, symbols, bytes, &tx_cfg) == ESP_OK;
+}
+
+void ir_rmt_end(IrRmtTx &tx, int pin) {
+    if (tx.enabled) rmt_disable(tx.channel);
+    if (tx.channel != NULL) rmt_del_channel(tx.channel);
+    if (tx.encoder != NULL) rmt_del_encoder(tx.encoder);
+    tx = IrRmtTx();
+    setup_ir_pin(pin, OUTPUT);
+    digitalWrite(pin, LOW);
+}
+
+size_t ir_durations_to_symbols(
+    const uint32_t *durations, size_t count, rmt_symbol_word_t *symbols, size_t maxSymbols
+) {
+    // Each symbol holds two (level, duration) halves. Durations are cut into pieces that fit a half, and
+    // the last piece is split in two when needed so no half is left empty (a 0 duration ends the frame).
+    size_t halves = 0;
+    for (size_t i = 0; i < count; i++) {
+        halves += durations[i] == 0 ? 0 : (durations[i] + IR_RMT_MAX_TICKS - 1) / IR_RMT_MAX_TICKS;
+    }
+    bool padded = halves % 2 != 0;
+    if (padded) halves++;
+    if (halves == 0 || halves / 2 > maxSymbols) return 0;
+
+    size_t half = 0;
+    for (size_t i = 0; i < count; i++) {
+        uint32_t left = durations[i];
+        uint32_t level = i % 2 == 0 ? 1 : 0;
+        while (left > 0) {
+            uint32_t ticks = left > IR_RMT_MAX_TICKS ? IR_RMT_MAX_TICKS : left;
+            // odd number of halves: the very last piece is shared between two halves
+            if (padded && half == halves - 2 && left == ticks && ticks > 1) ticks = left / 2;
+            rmt_symbol_word_t &symbol = symbols[half / 2];
+            if (half % 2 == 0) {
+                symbol.level0 = level;
+                symbol.duration0 = ticks;
+            } else {
+                symbol.level1 = level;
+                symbol.duration1 = ticks;
+            }
+            half++;
+            left -= ticks;
+        }
+    }
+    if (half < halves) { // last piece was a single tick
+        symbols[half / 2].level1 = 0;
+        symbols[half / 2].duration1 = 0;
+    }
+    return halves / 2;
+}
+
+size_t ir_unpack_pairs(
+    const uint8_t *codes, uint8_t numpairs, uint8_t bitcompression, const uint16_t *times, uint32_t *durations
+) {
+    uint8_t bits = 0;
+    uint8_t bitsLeft = 0;
+    size_t codePtr = 0;
+    for (uint8_t k = 0; k < numpairs; k++) {
+        uint16_t ti = 0;
+        for (uint8_t b = 0; b < bitcompression; b++) {
+            if (bitsLeft == 0) {
+                bits = codes[codePtr++];
+                bitsLeft = 8;
+            }
+            bitsLeft--;
+            ti = (ti << 1) | ((bits >> bitsLeft) & 1);
+        }
+        durations[k * 2] = times[ti * 2] * 10;         // on time
+        durations[k * 2 + 1] = times[ti * 2 + 1] * 10; // off time
+    }
+    return numpairs * 2;
+}
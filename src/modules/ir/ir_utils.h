@@ -1,7 +1,48 @@
 #ifndef __IR_UTILS_H
 #define __IR_UTILS_H
+#include <driver/rmt_tx.h>
 #include <globals.h>
 
 void setup_ir_pin(int pin, uint8_t mode);
 
+/**********************************************************************
+**  IR transmit on an RMT channel
+**  The carrier is generated by the peripheral and frames are queued, so the CPU
+**  is free while they go out. Marks are sent at level 1, 1 tick = 1us.
+**********************************************************************/
+#define IR_RMT_RESOLUTION_HZ 1000000
+#define IR_RMT_MAX_TICKS 32767 // longest half of a symbol, longer durations are split
+#define IR_RMT_CARRIER_DUTY 0.33f
+
+struct IrRmtTx {
+    rmt_channel_handle_t channel = NULL;
+    rmt_encoder_handle_t encoder = NULL;
+    uint32_t carrierHz = 0;
+    bool enabled = false;
+};
+
+// onDone, if given, runs in ISR context after every finished frame
+bool ir_rmt_begin(
+    IrRmtTx &tx, int pin, uint32_t carrierHz, size_t queueDepth = 4, rmt_tx_done_callback_t onDone = NULL,
+    void *user = NULL
+);
+// Waits for the queued frames before switching, the carrier applies to the whole channel. 0 turns it off.
+bool ir_rmt_set_carrier(IrRmtTx &tx, uint32_t carrierHz, float duty = IR_RMT_CARRIER_DUTY);
+// Queues a frame, symbols must stay valid until it has been sent
+bool ir_rmt_send(IrRmtTx &tx, const rmt_symbol_word_t *symbols, size_t count);
+// Stops right away, frames still queued are dropped. The pin is left low.
+void ir_rmt_end(IrRmtTx &tx, int pin);
+
+// Mark/space durations in us, starting with a mark, to RMT symbols.
+// Returns the number of symbols, or 0 if they don't fit in maxSymbols.
+size_t ir_durations_to_symbols(
+    const uint32_t *durations, size_t count, rmt_symbol_word_t *symbols, size_t maxSymbols
+);
+
+// TV-B-Gone compressed code: numpairs indexes into times (on/off pairs in tens of us), bitcompression
+// bits each, MSB first. Writes 2 * numpairs durations in us and returns that count.
+size_t ir_unpack_pairs(
+    const uint8_t *codes, uint8_t numpairs, uint8_t bitcompression, const uint16_t *times, uint32_t *durations
+);
+
 #endif
@@ -1,5 +1,6 @@
 #include "rf_bruteforce.h"
 
+#include "core/powerSave.h"
 #include "protocols/Ansonic.h"
 #include "protocols/Came.h"
 #include "protocols/Chamberlain.h"
@@ -110,6 +111,7 @@ bool rf_brute_start() {
         }
     };
 
+    powerHold(); // pulses are busy-wait timed and all codes take minutes
     for (int i = 0; i < (1 << bits); ++i) {
         for (int r = 0; r < brute_repeats; ++r) {
             for (const auto &pulse : protocol->pilot_period) { sendPulse(pulse); }
@@ -133,6 +135,7 @@ bool rf_brute_start() {
             );
         }
     }
+    powerRelease();
 
     deinitRfModule();
     delete protocol;
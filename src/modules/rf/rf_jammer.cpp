@@ -1,10 +1,18 @@
 #include "rf_jammer.h"
 #include "core/display.h"
+#include "core/powerSave.h"
 #include "rf_utils.h"
 
-RFJammer::RFJammer(bool full) : fullJammer(full) { setup(); }
+// The intermittent pattern is timed by busy waits, both run up to 20s without a key press
+RFJammer::RFJammer(bool full) : fullJammer(full) {
+    powerHold();
+    setup();
+}
 
-RFJammer::~RFJammer() { deinitRfModule(); }
+RFJammer::~RFJammer() {
+    deinitRfModule();
+    powerRelease();
+}
 
 void RFJammer::setup() {
     nTransmitterPin = bruceConfigPins.rfTx;
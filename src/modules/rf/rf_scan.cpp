@@ -1,14 +1,22 @@
 #include "rf_scan.h"
 #include "core/led_control.h"
+#include "core/powerSave.h"
 #include "core/sd_functions.h"
 #include "core/type_convertion.h"
 #include "rf_send.h"
 #include <globals.h>
 #include <sstream>
 
-RFScan::RFScan() { setup(); }
+// Scanning hops frequencies and decodes in a busy loop, waiting for a remote can take a while
+RFScan::RFScan() {
+    powerHold();
+    setup();
+}
 
-RFScan::~RFScan() { deinitRfModule(); }
+RFScan::~RFScan() {
+    deinitRfModule();
+    powerRelease();
+}
 
 void RFScan::setup() {
     if (!initRfModule("rx", bruceConfigPins.rfFreq)) { return; }
@@ -535,6 +543,7 @@ String rf_scan(float start_freq, float stop_freq, int max_loops) {
     int mark_rssi = -100;
     String out = "";
 
+    powerHold();
     while (max_loops || !check(EscPress)) {
         vTaskDelay(1 / portTICK_PERIOD_MS);
         max_loops -= 1;
@@ -575,11 +584,44 @@ String rf_scan(float start_freq, float stop_freq, int max_loops) {
             };
         }; // end of IF freq>stop frequency
     }; // End of While
+    powerRelease();
 
     deinitRfModule();
     return out;
 }
 
+// Formats a received code as a .sub file, same layout as the saved signals
+String RCSwitch_SubFile(RfCodes &received, float frequency, bool raw) {
+    char hexString[64];
+    decimalToHexString(received.key, hexString);
+
+    // switch to raw mode if decoding failed
+    if (received.preset == 0) {
+        Serial.println("signal decoding failed, switching to RAW mode");
+        // displayWarning("signal decoding failed, switching to RAW mode", true);
+        raw = true;
+        // TODO: show a dialog/warning?
+        // raw = yesNoDialog("decoding failed, save as RAW?");
+    }
+    String subfile_out = "Filetype: Bruce SubGhz File\nVersion 1\n";
+    subfile_out += "Frequency: " + String(int(frequency * 1000000)) + "\n";
+    if (!raw) {
+        subfile_out += "Preset: " + String(received.preset) + "\n";
+        subfile_out += "Protocol: RcSwitch\n";
+        subfile_out += "Bit: " + String(received.Bit) + "\n";
+        subfile_out += "Key: " + String(hexString) + "\n";
+        subfile_out += "TE: " + String(received.te) + "\n";
+    } else {
+        // save as raw
+        if (received.preset == "1") received.preset = "FuriHalSubGhzPresetOok270Async";
+        else if (received.preset == "2") received.preset = "FuriHalSubGhzPresetOok650Async";
+        subfile_out += "Preset: " + String(received.preset) + "\n";
+        subfile_out += "Protocol: RAW\n";
+        subfile_out += "RAW_Data: " + received.data;
+    }
+    return subfile_out;
+}
+
 String RCSwitch_Read(float frequency, int max_loops, bool raw) {
     RCSwitch rcswitch = RCSwitch();
     RfCodes received;
@@ -666,32 +708,8 @@ RestartRec:
 
         if (received.key > 0 ||
             received.data.length() > 20) { // RAW data does not have "key", 20 is more than 5 transitions
-            // switch to raw mode if decoding failed
-            if (received.preset == 0) {
-                Serial.println("signal decoding failed, switching to RAW mode");
-                // displayWarning("signal decoding failed, switching to RAW mode", true);
-                raw = true;
-                // TODO: show a dialog/warning?
-                // raw = yesNoDialog("decoding failed, save as RAW?");
-            }
-            String subfile_out = "Filetype: Bruce SubGhz File\nVersion 1\n";
-            subfile_out += "Frequency: " + String(int(frequency * 1000000)) + "\n";
-            if (!raw) {
-                subfile_out += "Preset: " + String(received.preset) + "\n";
-                subfile_out += "Protocol: RcSwitch\n";
-                subfile_out += "Bit: " + String(received.Bit) + "\n";
-                subfile_out += "Key: " + String(hexString) + "\n";
-                subfile_out += "TE: " + String(received.te) + "\n";
-            } else {
-                // save as raw
-                if (received.preset == "1") received.preset = "FuriHalSubGhzPresetOok270Async";
-                else if (received.preset == "2") received.preset = "FuriHalSubGhzPresetOok650Async";
-                subfile_out += "Preset: " + String(received.preset) + "\n";
-                subfile_out += "Protocol: RAW\n";
-                subfile_out += "RAW_Data: " + received.data;
-            }
             // headless mode
-            return subfile_out;
+            return RCSwitch_SubFile(received, frequency, raw);
 
             if (check(SelPress)) {
                 int chosen = 0;
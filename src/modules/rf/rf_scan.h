@@ -87,5 +87,6 @@ bool RCSwitch_SaveSignal(float frequency, RfCodes codes, bool raw, char *key, bo
 
 String rf_scan(float start_freq, float stop_freq, int max_loops = -1);
 String RCSwitch_Read(float frequency = 0, int max_loops = -1, bool raw = false);
+String RCSwitch_SubFile(RfCodes &received, float frequency, bool raw);
 
 #endif
@@ -59,6 +59,7 @@ int PN532::read(int cardBaudRate) {
     if (cardBaudRate == PN532_MIFARE_ISO14443A) {
         if (!nfc.startPassiveTargetIDDetection(cardBaudRate)) return TAG_NOT_PRESENT;
         if (!nfc.readDetectedPassiveTargetID()) return FAILURE;
+        dump.clear();
         format_data();
         set_uid();
     } else {
@@ -68,6 +69,7 @@ int PN532::read(int cardBaudRate) {
         uint8_t pmm[8];
         uint16_t sys_code_res;
         if (!nfc.felica_Polling(sys_code, req_code, idm, pmm, &sys_code_res)) { return TAG_NOT_PRESENT; }
+        dump.clear();
         format_data_felica(idm, pmm, sys_code_res);
     }
 
@@ -151,6 +153,7 @@ int PN532::load() {
     String filepath;
     File file;
     FS *fs;
+    loadError = "";
 
     if (!getFsStorage(fs)) return FAILURE;
     filepath = loopSD(*fs, true, "RFID|NFC", "/BruceRFID");
@@ -158,26 +161,15 @@ int PN532::load() {
 
     if (!file) { return FAILURE; }
 
-    String line;
-    String strData;
-    strAllPages = "";
-    pageReadSuccess = true;
-
-    while (file.available()) {
-        line = file.readStringUntil('\n');
-        strData = line.substring(line.indexOf(":") + 1);
-        strData.trim();
-        if (line.startsWith("Device type:")) printableUID.picc_type = strData;
-        if (line.startsWith("UID:")) printableUID.uid = strData;
-        if (line.startsWith("SAK:")) printableUID.sak = strData;
-        if (line.startsWith("ATQA:")) printableUID.atqa = strData;
-        if (line.startsWith("Pages total:")) dataPages = strData.toInt();
-        if (line.startsWith("Pages read:")) pageReadSuccess = false;
-        if (line.startsWith("Page ")) strAllPages += line + "\n";
+    uint32_t line = 0;
+    RfidDumpError error = rfidDumpLoad(file, dump, &line);
+    file.close();
+
+    if (error != RFID_DUMP_OK) {
+        loadError = String(rfidDumpErrorName(error)) + " at line " + String(line);
+        return FAILURE;
     }
 
-    file.close();
-    delay(100);
     parse_data();
 
     return SUCCESS;
@@ -191,27 +183,17 @@ int PN532::save(String filename) {
 
     if (!file) { return FAILURE; }
 
-    file.println("Filetype: Bruce RFID File");
-    file.println("Version 1");
-    file.println("Device type: " + printableUID.picc_type);
-    file.println("# UID, ATQA and SAK are common for all formats");
-    file.println("UID: " + printableUID.uid);
-    if (printableUID.picc_type != "FeliCa") {
-        file.println("SAK: " + printableUID.sak);
-        file.println("ATQA: " + printableUID.atqa);
-        file.println("# Memory dump");
-        file.println("Pages total: " + String(dataPages));
-        if (!pageReadSuccess) file.println("Pages read: " + String(dataPages));
-    } else {
-        file.println("Manufacture id: " + printableUID.sak);
-        file.println("Blocks total: " + String(totalPages));
-        file.println("Blocks read: " + String(dataPages));
-    }
-    file.print(strAllPages);
+    // FeliCa keeps its manufacture id in dump.pmm, set when the card was read or loaded
+    strlcpy(dump.type, printableUID.picc_type.c_str(), sizeof(dump.type));
+    dump.uidLen = uid.size;
+    memcpy(dump.uid, uid.uidByte, uid.size);
+    dump.sak = uid.sak;
+    memcpy(dump.atqa, uid.atqaByte, 2);
+    bool saved = rfidDumpSave(file, dump);
 
     file.close();
     delay(100);
-    return SUCCESS;
+    return saved ? SUCCESS : FAILURE;
 }
 
 String PN532::get_tag_type() {
@@ -267,27 +249,30 @@ void PN532::format_data_felica(uint8_t idm[8], uint8_t pmm[8], uint16_t sys_code
     printableUID.sak = hexToStr(pmm, 8);
     printableUID.atqa = String(sys_code, HEX);
 
+    uid.size = 8;
     memcpy(uid.uidByte, idm, 8);
+    memcpy(dump.pmm, pmm, 8);
+    dump.pmmLen = 8;
 }
 
 void PN532::parse_data() {
-    String strUID = printableUID.uid;
-    strUID.trim();
-    strUID.replace(" ", "");
-    uid.size = strUID.length() / 2;
-    for (size_t i = 0; i < strUID.length(); i += 2) {
-        uid.uidByte[i / 2] = strtoul(strUID.substring(i, i + 2).c_str(), NULL, 16);
+    uid.size = dump.uidLen;
+    memcpy(uid.uidByte, dump.uid, dump.uidLen);
+    uid.sak = dump.sak;
+    memcpy(uid.atqaByte, dump.atqa, 2);
+
+    printableUID.picc_type = dump.type;
+    printableUID.uid = hexToStr(dump.uid, dump.uidLen);
+    if (dump.isFelica()) {
+        printableUID.sak = hexToStr(dump.pmm, dump.pmmLen);
+        printableUID.atqa = "";
+    } else {
+        printableUID.sak = hexToStr(&dump.sak, 1);
+        printableUID.atqa = hexToStr(dump.atqa, 2);
     }
 
-    printableUID.sak.trim();
-    uid.sak = strtoul(printableUID.sak.c_str(), NULL, 16);
-
-    String strAtqa = printableUID.atqa;
-    strAtqa.trim();
-    strAtqa.replace(" ", "");
-    for (size_t i = 0; i < strAtqa.length(); i += 2) {
-        uid.atqaByte[i / 2] = strtoul(strAtqa.substring(i, i + 2).c_str(), NULL, 16);
-    }
+    dataPages = dump.total ? dump.total : dump.endPage();
+    pageReadSuccess = dump.complete();
 }
 
 int PN532::read_data_blocks() {
@@ -295,8 +280,6 @@ int PN532::read_data_blocks() {
     totalPages = 0;
     int readStatus = FAILURE;
 
-    strAllPages = "";
-
     if (printableUID.picc_type != "FeliCa") {
         switch (uid.sak) {
             case PICC_TYPE_MIFARE_MINI:
@@ -314,6 +297,7 @@ int PN532::read_data_blocks() {
         readStatus = read_felica_data();
     }
 
+    dump.total = totalPages;
     return readStatus;
 }
 
@@ -366,20 +350,16 @@ int PN532::read_mifare_classic_data_sector(byte sector) {
 
     byte buffer[18];
     byte blockAddr;
-    String strPage;
 
     int authStatus = authenticate_mifare_classic(firstBlock);
     if (authStatus != SUCCESS) return authStatus;
 
     for (int8_t blockOffset = 0; blockOffset < no_of_blocks; blockOffset++) {
-        strPage = "";
         blockAddr = firstBlock + blockOffset;
 
         if (!nfc.mifareclassic_ReadDataBlock(blockAddr, buffer)) return FAILURE;
 
-        strPage = hexToStr(buffer, 16);
-
-        strAllPages += "Page " + String(dataPages) + ": " + strPage + "\n";
+        dump.setPage(dataPages, buffer, 16);
         dataPages++;
     }
 
@@ -448,8 +428,6 @@ int PN532::authenticate_mifare_classic(byte block) {
 int PN532::read_mifare_ultralight_data_blocks() {
     uint8_t success;
     byte buffer[18];
-    byte i;
-    String strPage = "";
 
     uint8_t buf[4];
     nfc.mifareultralight_ReadPage(3, buf);
@@ -469,16 +447,7 @@ int PN532::read_mifare_ultralight_data_blocks() {
         if (!success) return FAILURE;
 
         for (byte offset = 0; offset < 4; offset++) {
-            strPage = "";
-            for (byte index = 0; index < 4; index++) {
-                i = 4 * offset + index;
-                strPage += buffer[i] < 0x10 ? F(" 0") : F(" ");
-                strPage += String(buffer[i], HEX);
-            }
-            strPage.trim();
-            strPage.toUpperCase();
-
-            strAllPages += "Page " + String(dataPages) + ": " + strPage + "\n";
+            dump.setPage(dataPages, &buffer[4 * offset], 4);
             dataPages++;
             if (dataPages >= totalPages) break;
         }
@@ -488,7 +457,6 @@ int PN532::read_mifare_ultralight_data_blocks() {
 }
 
 int PN532::read_felica_data() {
-    String strPage = "";
     totalPages = 14;
 
     for (uint16_t i = 0x8000; i < 0x8000 + totalPages; i++) {
@@ -499,109 +467,69 @@ int PN532::read_felica_data() {
         }; // Default service code for reading. Should works for every card
         int res = nfc.felica_ReadWithoutEncryption(1, default_service_code, 1, block_list, block_data);
 
-        for (size_t i = 0; i < 16; i++) {
-            if (res) { // If card block read successfully, copy data to string
-                strPage = hexToStr(block_data[0], 16);
-            }
-        }
-        if (res) { // If PN532 can't read the FeliCa tag, don't write the block to file
-            strAllPages += "Block " + String(dataPages++) + ": " + strPage + "\n";
-        }
-        strPage = ""; // Reset for the next block
+        // If PN532 can't read the FeliCa tag, don't write the block to file
+        if (res) dump.setPage(dataPages++, block_data[0], 16);
     }
 
     return SUCCESS;
 }
 
 int PN532::write_data_blocks() {
-    String pageLine = "";
-    String strBytes = "";
-    int lineBreakIndex;
-    int pageIndex;
     bool blockWriteSuccess;
-    int totalSize = strAllPages.length();
-
-    Serial.println(strAllPages);
-    while (strAllPages.length() > 0) {
-        lineBreakIndex = strAllPages.indexOf("\n");
-        pageLine = strAllPages.substring(0, lineBreakIndex);
-        strAllPages = strAllPages.substring(lineBreakIndex + 1);
-
-        pageIndex = pageLine.substring(5, pageLine.indexOf(":")).toInt();
-        strBytes = pageLine.substring(pageLine.indexOf(":") + 1);
-        strBytes.trim();
+    int lastPage = dump.endPage();
 
-        if (pageIndex == 0) continue;
+    for (int pageIndex = 1; pageIndex < lastPage; pageIndex++) {
+        const uint8_t *page = dump.page(pageIndex);
+        if (!page) continue;
 
         if (printableUID.picc_type != "FeliCa") {
             switch (uid.sak) {
                 case PICC_TYPE_MIFARE_MINI:
                 case PICC_TYPE_MIFARE_1K:
                 case PICC_TYPE_MIFARE_4K:
-                    if (pageIndex == 0 || (pageIndex + 1) % 4 == 0)
-                        continue; // Data blocks for MIFARE Classic
-                    blockWriteSuccess = write_mifare_classic_data_block(pageIndex, strBytes);
+                    if ((pageIndex + 1) % 4 == 0) continue; // Data blocks for MIFARE Classic
+                    blockWriteSuccess = write_mifare_classic_data_block(pageIndex, page, dump.pageSize);
                     break;
 
                 case PICC_TYPE_MIFARE_UL:
                     if (pageIndex < 4 || pageIndex >= dataPages - 5) continue; // Data blocks for NTAG21X
-                    blockWriteSuccess = write_mifare_ultralight_data_block(pageIndex, strBytes);
+                    blockWriteSuccess = write_mifare_ultralight_data_block(pageIndex, page, dump.pageSize);
                     break;
 
                 default: blockWriteSuccess = false; break;
             }
         } else {
-            blockWriteSuccess = write_felica_data_block(pageIndex, strBytes);
+            blockWriteSuccess = write_felica_data_block(pageIndex, page, dump.pageSize);
         }
 
         if (!blockWriteSuccess) return FAILURE;
 
-        progressHandler(totalSize - strAllPages.length(), totalSize, "Writing data blocks...");
+        progressHandler(pageIndex + 1, lastPage, "Writing data blocks...");
     }
 
     return SUCCESS;
 }
 
-bool PN532::write_mifare_classic_data_block(int block, String data) {
-    data.replace(" ", "");
-    byte size = data.length() / 2;
-    byte buffer[size];
-
+bool PN532::write_mifare_classic_data_block(int block, const uint8_t *data, byte size) {
     if (size != 16) return false;
 
-    for (size_t i = 0; i < data.length(); i += 2) {
-        buffer[i / 2] = strtoul(data.substring(i, i + 2).c_str(), NULL, 16);
-    }
-
     if (authenticate_mifare_classic(block) != SUCCESS) return false;
 
-    return nfc.mifareclassic_WriteDataBlock(block, buffer);
+    return nfc.mifareclassic_WriteDataBlock(block, (uint8_t *)data);
 }
 
-bool PN532::write_mifare_ultralight_data_block(int block, String data) {
-    data.replace(" ", "");
-    byte size = data.length() / 2;
-    byte buffer[size];
-
+bool PN532::write_mifare_ultralight_data_block(int block, const uint8_t *data, byte size) {
     if (size != 4) return false;
 
-    for (size_t i = 0; i < data.length(); i += 2) {
-        buffer[i / 2] = strtoul(data.substring(i, i + 2).c_str(), NULL, 16);
-    }
-
-    return nfc.ntag2xx_WritePage(block, buffer);
+    return nfc.ntag2xx_WritePage(block, (uint8_t *)data);
 }
 
-int PN532::write_felica_data_block(int block, String data) {
-    data.replace(" ", "");
-    byte size = data.length() / 2;
+int PN532::write_felica_data_block(int block, const uint8_t *data, byte size) {
     uint8_t block_data[1][16] = {0};
 
     if (size != 16) { return false; }
 
-    for (size_t i = 0; i < data.length(); i += 2) {
-        block_data[0][i / 2] = strtoul(data.substring(i, i + 2).c_str(), NULL, 16);
-    }
+    memcpy(block_data[0], data, 16);
 
     uint16_t block_list[1] = {(uint16_t)(block +
                                          0x8000)}; // Write the block i. Block in FeliCa start from 0x8000
@@ -614,6 +542,8 @@ int PN532::write_felica_data_block(int block, String data) {
 }
 
 int PN532::erase_data_blocks() {
+    const uint8_t zero[16] = {};
+    const uint8_t ndefEmpty[4] = {0x03, 0x00, 0xFE, 0x00};
     bool blockWriteSuccess;
 
     switch (uid.sak) {
@@ -622,19 +552,18 @@ int PN532::erase_data_blocks() {
         case PICC_TYPE_MIFARE_4K:
             for (byte i = 1; i < 64; i++) {
                 if ((i + 1) % 4 == 0) continue;
-                blockWriteSuccess =
-                    write_mifare_classic_data_block(i, "00 00 00 00 00 00 00 00 00 00 00 00 00 00 00 00");
+                blockWriteSuccess = write_mifare_classic_data_block(i, zero, 16);
                 if (!blockWriteSuccess) return FAILURE;
             }
             break;
 
         case PICC_TYPE_MIFARE_UL:
             // NDEF stardard
-            blockWriteSuccess = write_mifare_ultralight_data_block(4, "03 00 FE 00");
+            blockWriteSuccess = write_mifare_ultralight_data_block(4, ndefEmpty, 4);
             if (!blockWriteSuccess) return FAILURE;
 
             for (byte i = 5; i < 130; i++) {
-                blockWriteSuccess = write_mifare_ultralight_data_block(i, "00 00 00 00");
+                blockWriteSuccess = write_mifare_ultralight_data_block(i, zero, 4);
                 if (!blockWriteSuccess) return FAILURE;
             }
             break;
@@ -72,13 +72,13 @@ private:
     int read_mifare_ultralight_data_blocks();
 
     int write_data_blocks();
-    bool write_mifare_classic_data_block(int block, String data);
-    bool write_mifare_ultralight_data_block(int block, String data);
+    bool write_mifare_classic_data_block(int block, const uint8_t *data, byte size);
+    bool write_mifare_ultralight_data_block(int block, const uint8_t *data, byte size);
 
     int read_felica_data();
 
     int erase_data_blocks();
     int write_ndef_blocks();
 
-    int write_felica_data_block(int block, String data);
+    int write_felica_data_block(int block, const uint8_t *data, byte size);
 };
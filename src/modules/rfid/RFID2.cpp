@@ -10,6 +10,7 @@
 #include "core/display.h"
 #include "core/i2c_finder.h"
 #include "core/sd_functions.h"
+#include "core/type_convertion.h"
 #include <MFRC522DriverI2C.h>
 #include <MFRC522DriverSPI.h>
 #include <MFRC522Hack.h>
@@ -51,6 +52,10 @@ bool RFID2::PICC_IsNewCardPresent() {
         }
         printableUID.atqa.trim();
         printableUID.atqa.toUpperCase();
+        if (bufferSize == 2) { // most significant byte first, like format_data() prints it
+            uid.atqaByte[0] = bufferATQA[1];
+            uid.atqaByte[1] = bufferATQA[0];
+        }
     }
     return bl_result;
 }
@@ -116,6 +121,7 @@ int RFID2::load() {
     String filepath;
     File file;
     FS *fs;
+    loadError = "";
 
     if (!getFsStorage(fs)) return FAILURE;
     filepath = loopSD(*fs, true, "RFID|NFC", "/BruceRFID");
@@ -123,26 +129,15 @@ int RFID2::load() {
 
     if (!file) { return FAILURE; }
 
-    String line;
-    String strData;
-    strAllPages = "";
-    pageReadSuccess = true;
-
-    while (file.available()) {
-        line = file.readStringUntil('\n');
-        strData = line.substring(line.indexOf(":") + 1);
-        strData.trim();
-        if (line.startsWith("Device type:")) printableUID.picc_type = strData;
-        if (line.startsWith("UID:")) printableUID.uid = strData;
-        if (line.startsWith("SAK:")) printableUID.sak = strData;
-        if (line.startsWith("ATQA:")) printableUID.atqa = strData;
-        if (line.startsWith("Pages total:")) dataPages = strData.toInt();
-        if (line.startsWith("Pages read:")) pageReadSuccess = false;
-        if (line.startsWith("Page ")) strAllPages += line + "\n";
+    uint32_t line = 0;
+    RfidDumpError error = rfidDumpLoad(file, dump, &line);
+    file.close();
+
+    if (error != RFID_DUMP_OK) {
+        loadError = String(rfidDumpErrorName(error)) + " at line " + String(line);
+        return FAILURE;
     }
 
-    file.close();
-    delay(100);
     parse_data();
 
     return SUCCESS;
@@ -152,32 +147,20 @@ int RFID2::save(String filename) {
     FS *fs;
     if (!getFsStorage(fs)) return FAILURE;
 
-    if (!(*fs).exists("/BruceRFID")) (*fs).mkdir("/BruceRFID");
-    if ((*fs).exists("/BruceRFID/" + filename + ".rfid")) {
-        int i = 1;
-        filename += "_";
-        while ((*fs).exists("/BruceRFID/" + filename + String(i) + ".rfid")) i++;
-        filename += String(i);
-    }
-    File file = (*fs).open("/BruceRFID/" + filename + ".rfid", FILE_WRITE);
+    File file = createNewFile(fs, "/BruceRFID", filename + ".rfid");
 
     if (!file) { return FAILURE; }
 
-    file.println("Filetype: Bruce RFID File");
-    file.println("Version 1");
-    file.println("Device type: " + printableUID.picc_type);
-    file.println("# UID, ATQA and SAK are common for all formats");
-    file.println("UID: " + printableUID.uid);
-    file.println("SAK: " + printableUID.sak);
-    file.println("ATQA: " + printableUID.atqa);
-    file.println("# Memory dump");
-    file.println("Pages total: " + String(dataPages));
-    if (!pageReadSuccess) file.println("Pages read: " + String(dataPages));
-    file.print(strAllPages);
+    strlcpy(dump.type, printableUID.picc_type.c_str(), sizeof(dump.type));
+    dump.uidLen = uid.size;
+    memcpy(dump.uid, uid.uidByte, uid.size);
+    dump.sak = uid.sak;
+    memcpy(dump.atqa, uid.atqaByte, 2);
+    bool saved = rfidDumpSave(file, dump);
 
     file.close();
     delay(100);
-    return SUCCESS;
+    return saved ? SUCCESS : FAILURE;
 }
 
 String RFID2::get_tag_type() {
@@ -234,16 +217,18 @@ void RFID2::format_data() {
 }
 
 void RFID2::parse_data() {
-    String strUID = printableUID.uid;
-    strUID.trim();
-    strUID.replace(" ", "");
-    uid.size = strUID.length() / 2;
-    for (size_t i = 0; i < strUID.length(); i += 2) {
-        uid.uidByte[i / 2] = strtoul(strUID.substring(i, i + 2).c_str(), NULL, 16);
-    }
-
-    printableUID.sak.trim();
-    uid.sak = strtoul(printableUID.sak.c_str(), NULL, 16);
+    uid.size = dump.uidLen;
+    memcpy(uid.uidByte, dump.uid, dump.uidLen);
+    uid.sak = dump.sak;
+    memcpy(uid.atqaByte, dump.atqa, 2);
+
+    printableUID.picc_type = dump.type;
+    printableUID.uid = hexToStr(dump.uid, dump.uidLen);
+    printableUID.sak = hexToStr(&dump.sak, 1);
+    printableUID.atqa = hexToStr(dump.atqa, 2);
+
+    dataPages = dump.total ? dump.total : dump.endPage();
+    pageReadSuccess = dump.complete();
 }
 
 int RFID2::read_data_blocks() {
@@ -251,7 +236,7 @@ int RFID2::read_data_blocks() {
     totalPages = 0;
     int readStatus = FAILURE;
     byte piccType = mfrc522.PICC_GetType(mfrc522.uid.sak);
-    strAllPages = "";
+    dump.clear();
 
     switch (piccType) {
         case MFRC522::PICC_Type::PICC_TYPE_MIFARE_MINI:
@@ -262,13 +247,17 @@ int RFID2::read_data_blocks() {
 
         case MFRC522::PICC_Type::PICC_TYPE_MIFARE_UL:
             readStatus = read_mifare_ultralight_data_blocks();
-            dataPages = (readStatus == SUCCESS && dataPages > 0) ? dataPages - 1 : dataPages;
+            if (readStatus == SUCCESS && dataPages > 0) {
+                dataPages--;
+                dump.invalidate(dataPages); // page 0 again, the read wrapped around
+            }
             if (totalPages == 0) totalPages = dataPages;
             break;
 
         default: break;
     }
 
+    dump.total = totalPages;
     mfrc522.PICC_HaltA();
     return readStatus;
 }
@@ -326,28 +315,18 @@ int RFID2::read_mifare_classic_data_sector(byte sector) {
     byte byteCount;
     byte buffer[18];
     byte blockAddr;
-    String strPage;
 
     int authStatus = authenticate_mifare_classic(firstBlock);
     // if (authStatus != SUCCESS) return authStatus; 
 
     for (int8_t blockOffset = 0; blockOffset < no_of_blocks; blockOffset++) {
-        strPage = "";
         blockAddr = firstBlock + blockOffset;
         byteCount = sizeof(buffer);
 
         status = mfrc522.MIFARE_Read(blockAddr, buffer, &byteCount);
         if (status != MFRC522::StatusCode::STATUS_OK) { return FAILURE; }
 
-        for (byte index = 0; index < 16; index++) {
-            strPage += buffer[index] < 0x10 ? F(" 0") : F(" ");
-            strPage += String(buffer[index], HEX);
-        }
-
-        strPage.trim();
-        strPage.toUpperCase();
-
-        strAllPages += "Page " + String(dataPages) + ": " + strPage + "\n";
+        dump.setPage(dataPages, buffer, 16);
         dataPages++;
     }
 
@@ -406,9 +385,7 @@ int RFID2::read_mifare_ultralight_data_blocks() {
     byte status;
     byte byteCount;
     byte buffer[18];
-    byte i;
     byte cc;
-    String strPage = "";
 
     for (byte page = 0; page <= 252; page += 4) {
         byteCount = sizeof(buffer);
@@ -417,7 +394,6 @@ int RFID2::read_mifare_ultralight_data_blocks() {
             return status == MFRC522::StatusCode::STATUS_MIFARE_NACK ? SUCCESS : FAILURE;
         }
         for (byte offset = 0; offset < 4; offset++) {
-            strPage = "";
             if (page + offset == 3) {
                 cc = buffer[4 * offset + 2];
                 switch (cc) {
@@ -430,15 +406,7 @@ int RFID2::read_mifare_ultralight_data_blocks() {
                     default: break;
                 }
             }
-            for (byte index = 0; index < 4; index++) {
-                i = 4 * offset + index;
-                strPage += buffer[i] < 0x10 ? F(" 0") : F(" ");
-                strPage += String(buffer[i], HEX);
-            }
-            strPage.trim();
-            strPage.toUpperCase();
-
-            strAllPages += "Page " + String(dataPages) + ": " + strPage + "\n";
+            dump.setPage(dataPages, &buffer[4 * offset], 4);
             dataPages++;
         }
     }
@@ -448,35 +416,24 @@ int RFID2::read_mifare_ultralight_data_blocks() {
 
 int RFID2::write_data_blocks() {
     byte piccType = mfrc522.PICC_GetType(mfrc522.uid.sak);
-    String pageLine = "";
-    String strBytes = "";
-    int lineBreakIndex;
-    int pageIndex;
     bool blockWriteSuccess;
-    int totalSize = strAllPages.length();
-
-    while (strAllPages.length() > 0) {
-        lineBreakIndex = strAllPages.indexOf("\n");
-        pageLine = strAllPages.substring(0, lineBreakIndex);
-        strAllPages = strAllPages.substring(lineBreakIndex + 1);
-
-        pageIndex = pageLine.substring(5, pageLine.indexOf(":")).toInt();
-        strBytes = pageLine.substring(pageLine.indexOf(":") + 1);
-        strBytes.trim();
+    int lastPage = dump.endPage();
 
-        if (pageIndex == 0) continue;
+    for (int pageIndex = 1; pageIndex < lastPage; pageIndex++) {
+        const uint8_t *page = dump.page(pageIndex);
+        if (!page) continue;
 
         switch (piccType) {
             case MFRC522::PICC_Type::PICC_TYPE_MIFARE_MINI:
             case MFRC522::PICC_Type::PICC_TYPE_MIFARE_1K:
             case MFRC522::PICC_Type::PICC_TYPE_MIFARE_4K:
-                if (pageIndex == 0 || (pageIndex + 1) % 4 == 0) continue; // Data blocks for MIFARE Classic
-                blockWriteSuccess = write_mifare_classic_data_block(pageIndex, strBytes);
+                if ((pageIndex + 1) % 4 == 0) continue; // Data blocks for MIFARE Classic
+                blockWriteSuccess = write_mifare_classic_data_block(pageIndex, page, dump.pageSize);
                 break;
 
             case MFRC522::PICC_Type::PICC_TYPE_MIFARE_UL:
                 if (pageIndex < 4 || pageIndex >= dataPages - 5) continue; // Data blocks for NTAG21X
-                blockWriteSuccess = write_mifare_ultralight_data_block(pageIndex, strBytes);
+                blockWriteSuccess = write_mifare_ultralight_data_block(pageIndex, page, dump.pageSize);
                 break;
 
             default: blockWriteSuccess = false; break;
@@ -484,39 +441,23 @@ int RFID2::write_data_blocks() {
 
         if (!blockWriteSuccess) return FAILURE;
 
-        progressHandler(totalSize - strAllPages.length(), totalSize, "Writing data blocks...");
+        progressHandler(pageIndex + 1, lastPage, "Writing data blocks...");
     }
 
     return SUCCESS;
 }
 
-bool RFID2::write_mifare_classic_data_block(int block, String data) {
-    data.replace(" ", "");
-    byte size = data.length() / 2;
-    byte buffer[size];
-
-    for (size_t i = 0; i < data.length(); i += 2) {
-        buffer[i / 2] = strtoul(data.substring(i, i + 2).c_str(), NULL, 16);
-    }
-
+bool RFID2::write_mifare_classic_data_block(int block, const uint8_t *data, byte size) {
     if (authenticate_mifare_classic(block) != SUCCESS) return false;
 
-    byte status = mfrc522.MIFARE_Write((byte)block, buffer, size);
+    byte status = mfrc522.MIFARE_Write((byte)block, (byte *)data, size);
     if (status != MFRC522::StatusCode::STATUS_OK) return false;
 
     return true;
 }
 
-bool RFID2::write_mifare_ultralight_data_block(int block, String data) {
-    data.replace(" ", "");
-    byte size = data.length() / 2;
-    byte buffer[size];
-
-    for (size_t i = 0; i < data.length(); i += 2) {
-        buffer[i / 2] = strtoul(data.substring(i, i + 2).c_str(), NULL, 16);
-    }
-
-    byte status = mfrc522.MIFARE_Ultralight_Write((byte)block, buffer, size);
+bool RFID2::write_mifare_ultralight_data_block(int block, const uint8_t *data, byte size) {
+    byte status = mfrc522.MIFARE_Ultralight_Write((byte)block, (byte *)data, size);
     if (status != MFRC522::StatusCode::STATUS_OK) return false;
 
     return true;
@@ -524,6 +465,8 @@ bool RFID2::write_mifare_ultralight_data_block(int block, String data) {
 
 int RFID2::erase_data_blocks() {
     byte piccType = mfrc522.PICC_GetType(mfrc522.uid.sak);
+    const uint8_t zero[16] = {};
+    const uint8_t ndefEmpty[4] = {0x03, 0x00, 0xFE, 0x00};
     bool blockWriteSuccess;
 
     switch (piccType) {
@@ -532,19 +475,18 @@ int RFID2::erase_data_blocks() {
         case MFRC522::PICC_Type::PICC_TYPE_MIFARE_4K:
             for (byte i = 1; i < 64; i++) {
                 if ((i + 1) % 4 == 0) continue;
-                blockWriteSuccess =
-                    write_mifare_classic_data_block(i, "00 00 00 00 00 00 00 00 00 00 00 00 00 00 00 00");
+                blockWriteSuccess = write_mifare_classic_data_block(i, zero, 16);
                 if (!blockWriteSuccess) return FAILURE;
             }
             break;
 
         case MFRC522::PICC_Type::PICC_TYPE_MIFARE_UL:
             // NDEF stardard
-            blockWriteSuccess = write_mifare_ultralight_data_block(4, "03 00 FE 00");
+            blockWriteSuccess = write_mifare_ultralight_data_block(4, ndefEmpty, 4);
             if (!blockWriteSuccess) return FAILURE;
 
             for (byte i = 5; i < 130; i++) {
-                blockWriteSuccess = write_mifare_ultralight_data_block(i, "00 00 00 00");
+                blockWriteSuccess = write_mifare_ultralight_data_block(i, zero, 4);
                 if (!blockWriteSuccess) return FAILURE;
             }
             break;
@@ -62,8 +62,8 @@ private:
     int read_mifare_ultralight_data_blocks();
 
     int write_data_blocks();
-    bool write_mifare_classic_data_block(int block, String data);
-    bool write_mifare_ultralight_data_block(int block, String data);
+    bool write_mifare_classic_data_block(int block, const uint8_t *data, byte size);
+    bool write_mifare_ultralight_data_block(int block, const uint8_t *data, byte size);
 
     int erase_data_blocks();
     int write_ndef_blocks();
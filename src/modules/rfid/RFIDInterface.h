@@ -9,6 +9,7 @@
 #ifndef __RFID_INTERFACE_H__
 #define __RFID_INTERFACE_H__
 
+#include "rfid_dump.h"
 #include <globals.h>
 
 class RFIDInterface {
@@ -71,7 +72,8 @@ public:
     Uid uid;
     PrintableUID printableUID;
     NdefMessage ndefMessage;
-    String strAllPages = "";
+    RfidDump dump;
+    String loadError = ""; // why the last load() failed
     int totalPages = 0;
     int dataPages = 0;
     bool pageReadSuccess = false;
@@ -9,6 +9,8 @@
 #include "amiibo.h"
 #include "core/display.h"
 #include "core/mykeyboard.h"
+#include "rfid_dump.h"
+#include <memory>
 
 Amiibo::Amiibo() { setup(); }
 
@@ -134,39 +136,38 @@ bool Amiibo::openDumpFile() {
         return false;
     }
 
-    String line;
-    String strData;
-    bool pageReadSuccess = true;
-    strDump = "";
+    // Only needed until the pages are in strDump, the Amiibolink takes them as one hex string
+    std::unique_ptr<RfidDump> dump(new RfidDump());
+    uint32_t line = 0;
+    RfidDumpError error = rfidDumpLoad(file, *dump, &line);
+    file.close();
 
-    while (file.available()) {
-        line = file.readStringUntil('\n');
-        strData = line.substring(line.indexOf(":") + 1);
-        strData.trim();
-        if (line.startsWith("Device type:")) printableUID.picc_type = strData;
-        if (line.startsWith("UID:")) printableUID.uid = strData;
-        if (line.startsWith("SAK:")) printableUID.sak = strData;
-        if (line.startsWith("ATQA:")) printableUID.atqa = strData;
-        if (line.startsWith("Pages read:")) pageReadSuccess = false;
-        if (line.startsWith("Page ")) strDump += strData;
+    if (error != RFID_DUMP_OK) {
+        displayError(String(rfidDumpErrorName(error)) + " at line " + String(line), true);
+        return false;
     }
 
-    file.close();
-    vTaskDelay(pdMS_TO_TICKS(100));
-
-    if (!pageReadSuccess) {
+    if (!dump->complete()) {
         displayError("Incomplete dump file", true);
         return false;
     }
 
-    printableUID.uid.trim();
-    printableUID.uid.replace(" ", "");
-    printableUID.sak.trim();
-    printableUID.sak.replace(" ", "");
-    printableUID.atqa.trim();
-    printableUID.atqa.replace(" ", "");
-    strDump.trim();
-    strDump.replace(" ", "");
+    char hex[2 * 16 + 1]; // a page or the UID
+    printableUID.picc_type = dump->type;
+    rfidDumpHex(dump->uid, dump->uidLen, hex, 0);
+    printableUID.uid = hex;
+    rfidDumpHex(&dump->sak, 1, hex, 0);
+    printableUID.sak = hex;
+    rfidDumpHex(dump->atqa, 2, hex, 0);
+    printableUID.atqa = hex;
+
+    // Pages past the total, like the wrapped page 0 of older NTAG dumps, are not sent
+    strDump = "";
+    strDump.reserve(2 * dump->pageSize * dump->total);
+    for (uint16_t page = 0; page < dump->total; page++) {
+        rfidDumpHex(dump->page(page), dump->pageSize, hex, 0);
+        strDump += hex;
+    }
 
     Serial.print("Uid: ");
     Serial.println(printableUID.uid);
@@ -186,10 +187,6 @@ bool Amiibo::checkEmulationTagType() {
 
     if (sak != 0x00) return false;
 
-    if (strDump.substring(0, 8) == strDump.substring(strDump.length() - 8)) {
-        strDump = strDump.substring(0, strDump.length() - 8);
-    }
-
     if (strDump.length() / 2 != 540) return false; // Not an NTAG_215
 
     return true;
@@ -9,8 +9,9 @@
 #include "chameleon.h"
 #include "core/display.h"
 #include "core/mykeyboard.h"
+#include "core/type_convertion.h"
 
-Chameleon::Chameleon() { setup(); }
+Chameleon::Chameleon() : dump(new RfidDump()) { setup(); }
 
 Chameleon::~Chameleon() {
     if (_scanned_set.size() > 0) {
@@ -18,6 +19,7 @@ Chameleon::~Chameleon() {
         _scanned_set.clear();
         _scanned_tags.clear();
     }
+    delete dump;
 }
 
 void Chameleon::setup() {
@@ -611,27 +613,15 @@ void Chameleon::emulateHF() {
         return setMode(BATTERY_INFO_MODE);
     }
 
+    // cmdMfEload takes the card memory as one hex string
     String strDump = "";
-    String strData = "";
-    String line = "";
-    int startIndex = 0;
-    int finalIndex;
-
-    while (true) {
-        finalIndex = strAllPages.indexOf("\n", startIndex);
-        if (finalIndex == -1) finalIndex = strAllPages.length();
-
-        line = strAllPages.substring(startIndex, finalIndex);
-        if (line.length() < 5) break;
-
-        strData = line.substring(line.indexOf(":") + 1);
-        strData.trim();
-        strDump += strData;
-
-        startIndex = finalIndex + 1;
+    char hex[2 * 16 + 1];
+    strDump.reserve(2 * dump->pageSize * dump->validCount());
+    for (uint16_t page = 0; page < RFID_DUMP_MAX_PAGES; page++) {
+        if (!dump->isValid(page)) continue;
+        rfidDumpHex(dump->page(page), dump->pageSize, hex, 0);
+        strDump += hex;
     }
-    strDump.trim();
-    strDump.replace(" ", "");
 
     uint8_t slot = selectSlot();
 
@@ -668,7 +658,7 @@ void Chameleon::loadFileHF() {
         };
         loopOptions(options);
     } else {
-        displayError("Error loading file", true);
+        displayError(loadError.isEmpty() ? "Error loading file" : loadError, true);
         setMode(BATTERY_INFO_MODE);
     }
 }
@@ -694,6 +684,7 @@ bool Chameleon::readFileHF() {
     String filepath;
     File file;
     FS *fs;
+    loadError = "";
 
     if (!getFsStorage(fs)) return false;
     if (!(*fs).exists("/BruceRFID")) (*fs).mkdir("/BruceRFID");
@@ -702,26 +693,21 @@ bool Chameleon::readFileHF() {
 
     if (!file) { return false; }
 
-    String line;
-    String strData;
-    strAllPages = "";
-    pageReadSuccess = true;
+    uint32_t line = 0;
+    RfidDumpError error = rfidDumpLoad(file, *dump, &line);
+    file.close();
 
-    while (file.available()) {
-        line = file.readStringUntil('\n');
-        strData = line.substring(line.indexOf(":") + 1);
-        strData.trim();
-        if (line.startsWith("Device type:")) printableHFUID.piccType = strData;
-        if (line.startsWith("UID:")) printableHFUID.uid = strData;
-        if (line.startsWith("SAK:")) printableHFUID.sak = strData;
-        if (line.startsWith("ATQA:")) printableHFUID.atqa = strData;
-        if (line.startsWith("Pages total:")) dataPages = strData.toInt();
-        if (line.startsWith("Pages read:")) pageReadSuccess = false;
-        if (line.startsWith("Page ")) strAllPages += line + "\n";
+    if (error != RFID_DUMP_OK) {
+        loadError = String(rfidDumpErrorName(error)) + " at line " + String(line);
+        return false;
     }
 
-    file.close();
-    vTaskDelay(pdMS_TO_TICKS(100));
+    printableHFUID.piccType = dump->type;
+    printableHFUID.uid = hexToStr(dump->uid, dump->uidLen);
+    printableHFUID.sak = hexToStr(&dump->sak, 1);
+    printableHFUID.atqa = hexToStr(dump->atqa, 2);
+    dataPages = dump->total ? dump->total : dump->endPage();
+    pageReadSuccess = dump->complete();
     parseHFData();
 
     return true;
@@ -731,39 +717,27 @@ bool Chameleon::writeFileHF(String filename) {
     FS *fs;
     if (!getFsStorage(fs)) return false;
 
-    if (!(*fs).exists("/BruceRFID")) (*fs).mkdir("/BruceRFID");
-    if ((*fs).exists("/BruceRFID/" + filename + ".rfid")) {
-        int i = 1;
-        filename += "_";
-        while ((*fs).exists("/BruceRFID/" + filename + String(i) + ".rfid")) i++;
-        filename += String(i);
-    }
-    File file = (*fs).open("/BruceRFID/" + filename + ".rfid", FILE_WRITE);
+    File file = createNewFile(fs, "/BruceRFID", filename + ".rfid");
 
     if (!file) { return false; }
 
-    file.println("Filetype: Bruce RFID File");
-    file.println("Version 1");
-    file.println("Device type: " + printableHFUID.piccType);
-    file.println("# UID, ATQA and SAK are common for all formats");
-    file.println("UID: " + printableHFUID.uid);
-    file.println("SAK: " + printableHFUID.sak);
-    file.println("ATQA: " + printableHFUID.atqa);
-    file.println("# Memory dump");
-    file.println("Pages total: " + String(dataPages));
-    if (!pageReadSuccess) file.println("Pages read: " + String(dataPages));
-    file.print(strAllPages);
+    strlcpy(dump->type, printableHFUID.piccType.c_str(), sizeof(dump->type));
+    dump->uidLen = hfTagData.size;
+    memcpy(dump->uid, hfTagData.uidByte, hfTagData.size);
+    dump->sak = hfTagData.sak;
+    memcpy(dump->atqa, hfTagData.atqaByte, 2);
+    bool saved = rfidDumpSave(file, *dump);
 
     file.close();
     vTaskDelay(pdMS_TO_TICKS(100));
-    return true;
+    return saved;
 }
 
 bool Chameleon::readHFDataBlocks() {
     dataPages = 0;
     totalPages = 0;
     bool readSuccess = false;
-    strAllPages = "";
+    dump->clear();
 
     switch (chmUltra.hfTagData.sak) {
         case 0x08:
@@ -778,6 +752,7 @@ bool Chameleon::readHFDataBlocks() {
         default: break;
     }
 
+    dump->total = totalPages;
     return readSuccess;
 }
 
@@ -805,20 +780,10 @@ bool Chameleon::readMifareClassicDataBlocks(uint8_t *key) {
             break;
     }
 
-    String strPage;
-
-    for (byte i = 0; i < totalPages; i++) {
+    for (uint16_t i = 0; i < totalPages; i++) {
         if (!chmUltra.cmdMfReadBlock(i, key)) return false;
 
-        strPage = "";
-        for (byte index = 0; index < chmUltra.cmdResponse.dataSize; index++) {
-            strPage += chmUltra.cmdResponse.data[index] < 0x10 ? F(" 0") : F(" ");
-            strPage += String(chmUltra.cmdResponse.data[index], HEX);
-        }
-        strPage.trim();
-        strPage.toUpperCase();
-
-        strAllPages += "Page " + String(dataPages) + ": " + strPage + "\n";
+        dump->setPage(dataPages, chmUltra.cmdResponse.data, chmUltra.cmdResponse.dataSize);
         dataPages++;
     }
 
@@ -826,8 +791,6 @@ bool Chameleon::readMifareClassicDataBlocks(uint8_t *key) {
 }
 
 bool Chameleon::readMifareUltralightDataBlocks() {
-    String strPage;
-
     ChameleonUltra::TagType tagType = chmUltra.getTagType(chmUltra.hfTagData.sak);
 
     switch (tagType) {
@@ -841,19 +804,11 @@ bool Chameleon::readMifareUltralightDataBlocks() {
         default: totalPages = 256; break;
     }
 
-    for (byte i = 0; i < totalPages; i++) {
+    for (uint16_t i = 0; i < totalPages; i++) {
         if (!chmUltra.cmdMfuReadPage(i)) return false;
         if (chmUltra.cmdResponse.dataSize == 0) break;
 
-        strPage = "";
-        for (byte index = 0; index < chmUltra.cmdResponse.dataSize; index++) {
-            strPage += chmUltra.cmdResponse.data[index] < 0x10 ? F(" 0") : F(" ");
-            strPage += String(chmUltra.cmdResponse.data[index], HEX);
-        }
-        strPage.trim();
-        strPage.toUpperCase();
-
-        strAllPages += "Page " + String(dataPages) + ": " + strPage + "\n";
+        dump->setPage(dataPages, chmUltra.cmdResponse.data, chmUltra.cmdResponse.dataSize);
         dataPages++;
     }
 
@@ -861,34 +816,19 @@ bool Chameleon::readMifareUltralightDataBlocks() {
 }
 
 bool Chameleon::writeHFDataBlocks() {
-    String pageLine = "";
-    String strBytes = "";
-    int lineBreakIndex;
-    int pageIndex;
     bool blockWriteSuccess;
-    int totalSize = strAllPages.length();
-
-    while (strAllPages.length() > 0) {
-        lineBreakIndex = strAllPages.indexOf("\n");
-        pageLine = strAllPages.substring(0, lineBreakIndex);
-        strAllPages = strAllPages.substring(lineBreakIndex + 1);
+    int lastPage = dump->endPage();
+    byte buffer[16];
 
-        pageIndex = pageLine.substring(5, pageLine.indexOf(":")).toInt();
-        strBytes = pageLine.substring(pageLine.indexOf(":") + 1);
-        strBytes.trim();
-        strBytes.replace(" ", "");
+    for (int pageIndex = 1; pageIndex < lastPage; pageIndex++) {
+        if (!dump->isValid(pageIndex)) continue;
 
-        if (pageIndex == 0) continue;
-
-        byte size = strBytes.length() / 2;
-        byte buffer[size];
-        for (size_t i = 0; i < strBytes.length(); i += 2) {
-            buffer[i / 2] = strtoul(strBytes.substring(i, i + 2).c_str(), NULL, 16);
-        }
+        byte size = dump->pageSize;
+        memcpy(buffer, dump->page(pageIndex), size);
 
         blockWriteSuccess = false;
         if (isMifareClassic(chmUltra.hfTagData.sak)) {
-            if (pageIndex == 0 || (pageIndex + 1) % 4 == 0) continue; // Data blocks for MIFARE Classic
+            if ((pageIndex + 1) % 4 == 0) continue; // Data blocks for MIFARE Classic
             blockWriteSuccess = chmUltra.cmdMfWriteBlock(pageIndex, {}, buffer, size);
         } else if (chmUltra.hfTagData.sak == 0x00) {
             if (pageIndex < 4 || pageIndex >= dataPages - 5) continue; // Data blocks for NTAG21X
@@ -897,7 +837,7 @@ bool Chameleon::writeHFDataBlocks() {
 
         if (!blockWriteSuccess) return false;
 
-        progressHandler(totalSize - strAllPages.length(), totalSize, "Writing data blocks...");
+        progressHandler(pageIndex + 1, lastPage, "Writing data blocks...");
     }
 
     return true;
@@ -8,6 +8,7 @@
 
 #ifndef __CHAMELEON_H__
 #define __CHAMELEON_H__
+#include "rfid_dump.h"
 #include <chameleonUltra.h>
 #include <set>
 
@@ -80,7 +81,8 @@ private:
     bool _battery_set = false;
     bool pageReadSuccess = false;
     uint32_t _lastReadTime = 0;
-    String strAllPages = "";
+    RfidDump *dump; // on the heap, the app object lives on the caller's stack
+    String loadError = "";
     int totalPages = 0;
     int dataPages = 0;
     std::set<String> _scanned_set;
@@ -1,15 +1,133 @@
 #ifndef LITE_VERSION
 #include "emv_reader.hpp"
-#include <vector>
+#include "core/display.h"
+#include "core/type_convertion.h"
+#include <globals.h>
+
+bool Pn532EmvTransport::transceive(const uint8_t *cmd, size_t len, uint8_t *resp, size_t &respLen) {
+    uint8_t received = respLen > 255 ? 255 : respLen;
+    uint32_t start = micros();
+    bool ok = nfc.inDataExchange((uint8_t *)cmd, len, resp, &received);
+    exchangeUs += micros() - start;
+    respLen = received;
+    return ok;
+}
+
+static uint32_t clockUs() { return micros(); }
+
+// Only the PN532 speaks ISO 14443-4, the RC522 and RFID2 modules can not talk to payment cards
+bool EMVReader::set_rfid_module() {
+    switch (bruceConfigPins.rfidModule) {
+        case PN532_I2C_MODULE: _rfid = new PN532(PN532::CONNECTION_TYPE::I2C); return true;
+#ifdef M5STICK
+        case PN532_I2C_SPI_MODULE: _rfid = new PN532(PN532::CONNECTION_TYPE::I2C_SPI); return true;
+#endif
+        case PN532_SPI_MODULE: _rfid = new PN532(PN532::CONNECTION_TYPE::SPI); return true;
+        default: return false;
+    }
+}
 
 void EMVReader::setup() {
     returnToMenu = true;
+    if (!set_rfid_module()) {
+        displayError("EMV needs a PN532 module", true);
+        return;
+    }
+    if (!_rfid->begin()) {
+        displayError("RFID module not found!", true);
+        return;
+    }
+    loop();
+}
+
+void EMVReader::loop() {
+    Pn532EmvTransport transport(_rfid->nfc);
+    EmvSession session(transport, clockUs);
+    bool redraw = true;
+
+    while (!check(EscPress)) {
+        if (redraw) {
+            drawMainBorderWithTitle("EMV READER");
+            tft.setTextSize(FP);
+            padprintln("");
+            padprintln("Hold a payment card");
+            padprintln("near the reader.");
+            redraw = false;
+        }
+        if (!_rfid->nfc.inListPassiveTarget()) {
+            vTaskDelay(pdMS_TO_TICKS(50));
+            continue;
+        }
+
+        session.unpredictable = esp_random();
+        if (clock_set) {
+#if defined(HAS_RTC)
+            _rtc.GetDate(&_date);
+            session.setDate(_date.Year, _date.Month, _date.Date);
+#else
+            struct tm now = rtc.getTimeStruct();
+            session.setDate(now.tm_year + 1900, now.tm_mon + 1, now.tm_mday);
+#endif
+        }
+        transport.exchangeUs = 0;
+        EMVCard card;
+        EmvResult result = session.read(card);
+        display_emv(card, result, session.times(), transport.exchangeUs);
+
+        // Sel reads again, Esc leaves
+        while (!check(SelPress)) {
+            if (check(EscPress)) return;
+            vTaskDelay(pdMS_TO_TICKS(50));
+        }
+        redraw = true;
+    }
 }
 
-void EMVReader::display_emv(EMVCard card) {}
-void EMVReader::save_emv(const char* p, const char* f, const char* t, const char* a) {}
-void EMVReader::parse_pan(std::vector<uint8_t> *a, EMVCard *c) {}
-void EMVReader::parse_validfrom(std::vector<uint8_t> *a, EMVCard *c) {}
-void EMVReader::parse_validto(std::vector<uint8_t> *a, EMVCard *c) {}
+void EMVReader::display_emv(
+    const EMVCard &card, EmvResult result, const EmvTimes &times, uint32_t exchangeUs
+) {
+    drawMainBorderWithTitle(card.label[0] ? card.label : emvVendorName(card.vendor));
+    tft.setTextSize(FP);
+    padprintln("");
+
+    if (card.aid_len > 0) padprintln("AID: " + hexToStr((uint8_t *)card.aid, card.aid_len));
+    if (card.parsed) {
+        String pan;
+        for (uint8_t i = 0; card.pan[i]; i++) {
+            if (i > 0 && i % 4 == 0) pan += " ";
+            pan += card.pan[i];
+        }
+        padprintln("PAN: " + pan);
+        if (card.validfrom[0]) padprintln("Valid from: " + String(card.validfrom));
+        if (card.validto[0]) padprintln("Valid to: " + String(card.validto));
+        if (card.holder[0]) padprintln("Name: " + String(card.holder));
+    } else {
+        padprintln("Read failed: " + String(emvResultName(result)));
+    }
+
+    padprintln("");
+    padprintln(
+        "Read in " + String(times.total / 1000) + "ms, " + String(times.apdus) + " APDUs, " +
+        String(exchangeUs / 1000) + "ms on air"
+    );
+    padprintln(
+        "PPSE " + String(times.ppse / 1000) + " SEL " + String(times.select / 1000) + " GPO " +
+        String(times.gpo / 1000) + " REC " + String(times.records / 1000) + " ms"
+    );
+    Serial.printf(
+        "EMV: %s, %u records, %lu us total (ppse %lu, select %lu, gpo %lu, records %lu), %u APDUs\n",
+        emvResultName(result),
+        card.records,
+        times.total,
+        times.ppse,
+        times.select,
+        times.gpo,
+        times.records,
+        times.apdus
+    );
+
+    padprintln("");
+    padprintln("Sel: read again  Esc: back");
+}
 
 #endif
@@ -2,80 +2,32 @@
 #define EMV_READER_H
 
 #include "PN532.h"
+#include "emv_session.h"
 #include <Arduino.h>
 
-typedef enum emv_vendor {
-    EMV_VISA,
-    EMV_MASTERCARD,
-    EMV_UNKNOWN
-} EMV_Vendor;
-
-typedef struct EMVCard {
-    bool parsed = true;
-    uint8_t *aid = nullptr;
-    EMV_Vendor vendor = EMV_UNKNOWN;
-    size_t pan_len = 0;
-    uint8_t *pan = nullptr;
-   // uint8_t *afl_raw = nullptr;
-    uint8_t *validfrom = nullptr;
-    uint8_t *validto = nullptr;
-} EMVCard;
-
-typedef struct EMVAID {
-    uint8_t aid[7];
-    const char *name;
-    EMV_Vendor vendor;
-} EMVAID;
-
-#define AID_DICT_SIZE 11
+// APDUs through the PN532 (ISO 14443-4 is handled by the chip), with the time spent on the air
+class Pn532EmvTransport : public EmvTransport {
+public:
+    Pn532EmvTransport(Adafruit_PN532 &nfc) : nfc(nfc) {}
+    bool transceive(const uint8_t *cmd, size_t len, uint8_t *resp, size_t &respLen) override;
 
-// http://hartleyenterprises.com/listAID.html
-const EMVAID known_aid[AID_DICT_SIZE] = {
-    // MasterCard family
-    {.aid = {0xA0, 0x00, 0x00, 0x00, 0x04, 0x10, 0x10}, .name = "MasterCard", .vendor = EMV_MASTERCARD },
-    {.aid = {0xA0, 0x00, 0x00, 0x00, 0x04, 0x22, 0x03}, .name = "U.S Maestro", .vendor = EMV_MASTERCARD},
-    {.aid = {0xA0, 0x00, 0x00, 0x00, 0x04, 0x30, 0x60}, .name = "Maestro", .vendor = EMV_MASTERCARD    },
-    {.aid = {0xA0, 0x00, 0x00, 0x00, 0x04, 0x60, 0x00}, .name = "Cirrus", .vendor = EMV_MASTERCARD     },
-    {.aid = {0xA0, 0x00, 0x00, 0x00, 0x04, 0x99, 0x99}, .name = "MasterCard", .vendor = EMV_MASTERCARD },
+    uint32_t exchangeUs = 0;
 
-    // Visa family
-    {.aid = {0xA0, 0x00, 0x00, 0x00, 0x03, 0x10, 0x10}, .name = "Visa", .vendor = EMV_VISA       },
-    {.aid = {0xA0, 0x00, 0x00, 0x00, 0x03, 0x20, 0x10}, .name = "Electron", .vendor = EMV_VISA   },
-    {.aid = {0xA0, 0x00, 0x00, 0x00, 0x03, 0x20, 0x20}, .name = "V-Pay", .vendor = EMV_VISA      },
-    {.aid = {0xA0, 0x00, 0x00, 0x00, 0x03, 0x30, 0x10}, .name = "Visa", .vendor = EMV_VISA       },
-    {.aid = {0xA0, 0x00, 0x00, 0x00, 0x03, 0x80, 0x10}, .name = "Visa", .vendor = EMV_VISA       },
-    {.aid = {0xA0, 0x00, 0x00, 0x00, 0x98, 0x08, 0x40}, .name = "Visa", .vendor = EMV_VISA       }
+private:
+    Adafruit_PN532 &nfc;
 };
 
 class EMVReader {
 private:
+    PN532 *_rfid = nullptr;
 
-    // EMV methods created with the help of https://werner.rothschopf.net/201703_arduino_esp8266_nfc.htm
-    void parse_pan(std::vector<uint8_t> *afl_content, EMVCard *card);
-    void parse_validfrom(std::vector<uint8_t> *afl_content, EMVCard *card);
-    void parse_validto(std::vector<uint8_t> *afl_content, EMVCard *card);
-    void read_afl(EMVCard *card, std::vector<uint8_t> *afl);
-
-    // EMV methods created with the help of https://werner.rothschopf.net/201703_arduino_esp8266_nfc.htm
-    std::vector<uint8_t> emv_ask_for_aid();
-    std::vector<uint8_t> emv_ask_for_app_name();
-    std::vector<uint8_t> emv_ask_for_pdol(std::vector<uint8_t> *aid);
-    std::vector<uint8_t> emv_get_processing_options_no_pdol();
-
-    // VISA save the card details in tag 57 (Track 2 Equivalent Data) so we need a different read method
-    void emv_read_visa(std::vector<uint8_t> *pdol_data, EMVCard *card);
-    std::vector<uint8_t> emv_read_record(uint8_t p1, uint8_t p2);
-
-    PN532 *_rfid;
-    Adafruit_PN532 *nfc = nullptr;
-    bool _cancelled = false;
-    EMVCard read_emv_card();
-    void display_emv(EMVCard card);
-    void save_emv(const char *aid, const char *pan, const char *validfrom, const char *validto);
+    bool set_rfid_module();
+    void loop();
+    void display_emv(const EMVCard &card, EmvResult result, const EmvTimes &times, uint32_t exchangeUs);
 
 public:
     EMVReader() { setup(); };
-    ~EMVReader() {};
+    ~EMVReader() { delete _rfid; };
     void setup();
 };
 
@@ -0,0 +1,386 @@
+#ifndef LITE_VERSION
+#include "emv_session.h"
+#include <stdio.h>
+#include <string.h>
+
+// clang-format off
+const EMVAID known_aid[] = {
+    // MasterCard family
+    {{0xA0, 0x00, 0x00, 0x00, 0x04, 0x10, 0x10}, 7, "MasterCard", EMV_MASTERCARD},
+    {{0xA0, 0x00, 0x00, 0x00, 0x04, 0x22, 0x03}, 7, "U.S Maestro", EMV_MASTERCARD},
+    {{0xA0, 0x00, 0x00, 0x00, 0x04, 0x30, 0x60}, 7, "Maestro", EMV_MASTERCARD},
+    {{0xA0, 0x00, 0x00, 0x00, 0x04, 0x60, 0x00}, 7, "Cirrus", EMV_MASTERCARD},
+    {{0xA0, 0x00, 0x00, 0x00, 0x04, 0x99, 0x99}, 7, "MasterCard", EMV_MASTERCARD},
+
+    // Visa family
+    {{0xA0, 0x00, 0x00, 0x00, 0x03, 0x10, 0x10}, 7, "Visa", EMV_VISA},
+    {{0xA0, 0x00, 0x00, 0x00, 0x03, 0x20, 0x10}, 7, "Electron", EMV_VISA},
+    {{0xA0, 0x00, 0x00, 0x00, 0x03, 0x20, 0x20}, 7, "V-Pay", EMV_VISA},
+    {{0xA0, 0x00, 0x00, 0x00, 0x03, 0x30, 0x10}, 7, "Visa", EMV_VISA},
+    {{0xA0, 0x00, 0x00, 0x00, 0x03, 0x80, 0x10}, 7, "Visa", EMV_VISA},
+    {{0xA0, 0x00, 0x00, 0x00, 0x98, 0x08, 0x40}, 7, "Visa", EMV_VISA},
+
+    // Others
+    {{0xA0, 0x00, 0x00, 0x00, 0x25, 0x01}, 6, "American Express", EMV_AMEX},
+    {{0xA0, 0x00, 0x00, 0x01, 0x52, 0x30, 0x10}, 7, "Discover", EMV_DISCOVER},
+    {{0xA0, 0x00, 0x00, 0x00, 0x65, 0x10, 0x10}, 7, "JCB", EMV_JCB},
+    {{0xA0, 0x00, 0x00, 0x03, 0x33, 0x01, 0x01, 0x01}, 8, "UnionPay Debit", EMV_UNIONPAY},
+    {{0xA0, 0x00, 0x00, 0x03, 0x33, 0x01, 0x01, 0x02}, 8, "UnionPay Credit", EMV_UNIONPAY},
+    {{0xA0, 0x00, 0x00, 0x02, 0x77, 0x10, 0x10}, 7, "Interac", EMV_INTERAC},
+    {{0xA0, 0x00, 0x00, 0x05, 0x24, 0x10, 0x10}, 7, "RuPay", EMV_RUPAY},
+    {{0xA0, 0x00, 0x00, 0x06, 0x58, 0x10, 0x10}, 7, "Mir Credit", EMV_MIR},
+    {{0xA0, 0x00, 0x00, 0x06, 0x58, 0x20, 0x10}, 7, "Mir Debit", EMV_MIR},
+    {{0xA0, 0x00, 0x00, 0x03, 0x59, 0x10, 0x10, 0x02, 0x80, 0x01}, 10, "girocard", EMV_GIROCARD},
+};
+// clang-format on
+const size_t known_aid_count = sizeof(known_aid) / sizeof(known_aid[0]);
+
+static const char *vendorNames[] = {
+    "Visa", "MasterCard", "AmEx", "Discover", "JCB", "UnionPay", "Interac", "RuPay", "Mir", "girocard",
+    "Unknown",
+};
+
+const char *emvVendorName(EMV_Vendor vendor) { return vendorNames[vendor]; }
+
+const char *emvResultName(EmvResult result) {
+    switch (result) {
+        case EMV_OK: return "OK";
+        case EMV_NO_CARD: return "Card lost";
+        case EMV_NO_APP: return "No payment app";
+        case EMV_GPO_FAILED: return "GPO refused";
+        case EMV_NO_DATA: return "No card number";
+    }
+    return "";
+}
+
+// Terminal side of the PDOL, tags the card asks for and we know. Anything else is sent as zeros.
+struct EmvTerminalTag {
+    uint32_t tag;
+    uint8_t len;
+    uint8_t value[6];
+};
+
+static const EmvTerminalTag terminalData[] = {
+    {0x9F66, 4, {0x36, 0x00, 0x40, 0x00}},             // TTQ: contactless EMV and magstripe, online capable
+    {0x9F02, 6, {0x00, 0x00, 0x00, 0x00, 0x00, 0x00}}, // amount authorised: 0
+    {0x9F1A, 2, {0x08, 0x40}},                         // terminal country
+    {0x5F2A, 2, {0x08, 0x40}},                         // transaction currency
+    {0x9C, 1, {0x00}},                                 // transaction type: purchase
+    {0x9F35, 1, {0x22}},                               // terminal type: attended, online capable
+    {0x9F33, 3, {0xE0, 0x08, 0x08}},                   // terminal capabilities
+};
+
+static const uint8_t ppseName[] = {'2', 'P', 'A', 'Y', '.', 'S', 'Y', 'S', '.', 'D', 'D', 'F', '0', '1'};
+
+static EMV_Vendor vendorOf(const uint8_t *aid, size_t len) {
+    EMV_Vendor vendor = EMV_UNKNOWN;
+    size_t best = 0;
+    for (size_t i = 0; i < known_aid_count; i++) {
+        // same RID (first 5 bytes) at least, the longest match wins
+        size_t n = 0;
+        while (n < len && n < known_aid[i].len && aid[n] == known_aid[i].aid[n]) n++;
+        if (n >= 5 && n > best) {
+            best = n;
+            vendor = known_aid[i].vendor;
+        }
+    }
+    return vendor;
+}
+
+/**********************************************************************
+**  Card data
+**********************************************************************/
+// BCD digits up to the first nibble that is not one (F padding, D separator). Returns the nibbles used.
+static size_t bcdDigits(const uint8_t *data, size_t len, char *out, size_t outSize) {
+    size_t n = 0;
+    for (; n < len * 2 && n + 1 < outSize; n++) {
+        uint8_t nibble = (n & 1) ? data[n / 2] & 0x0F : data[n / 2] >> 4;
+        if (nibble > 9) break;
+        out[n] = '0' + nibble;
+    }
+    out[n] = '\0';
+    return n;
+}
+
+// YY MM [DD] in BCD to MM/YY
+static void bcdDate(const uint8_t *data, size_t len, char out[6]) {
+    if (len < 2) return;
+    char digits[5];
+    if (bcdDigits(data, 2, digits, sizeof(digits)) < 4) return;
+    out[0] = digits[2];
+    out[1] = digits[3];
+    out[2] = '/';
+    out[3] = digits[0];
+    out[4] = digits[1];
+    out[5] = '\0';
+}
+
+static void copyText(const uint8_t *data, size_t len, char *out, size_t outSize) {
+    size_t n = 0;
+    for (size_t i = 0; i < len && n + 1 < outSize; i++) {
+        if (data[i] >= 0x20 && data[i] < 0x7F) out[n++] = data[i];
+    }
+    while (n > 0 && out[n - 1] == ' ') n--;
+    out[n] = '\0';
+}
+
+// Track 2 equivalent data: PAN D YYMM service code...
+static void parseTrack2(const Tlv &tlv, EMVCard &card) {
+    char digits[40];
+    size_t n = bcdDigits(tlv.value, tlv.len, digits, sizeof(digits));
+    if (n == 0 || n >= tlv.len * 2) return;
+    uint8_t separator = (n & 1) ? tlv.value[n / 2] & 0x0F : tlv.value[n / 2] >> 4;
+    if (separator != 0x0D) return;
+    if (!card.pan[0] && n < sizeof(card.pan)) memcpy(card.pan, digits, n + 1);
+
+    // Expiry: the 4 nibbles after the separator
+    if (card.validto[0]) return;
+    char date[5];
+    size_t k = 0;
+    for (size_t i = n + 1; i < tlv.len * 2 && k < 4; i++, k++) {
+        uint8_t nibble = (i & 1) ? tlv.value[i / 2] & 0x0F : tlv.value[i / 2] >> 4;
+        if (nibble > 9) return;
+        date[k] = '0' + nibble;
+    }
+    if (k < 4) return;
+    snprintf(card.validto, sizeof(card.validto), "%c%c/%c%c", date[2], date[3], date[0], date[1]);
+}
+
+static void visitCardData(const Tlv &tlv, void *ctx) {
+    EMVCard &card = *(EMVCard *)ctx;
+    switch (tlv.tag) {
+        case 0x5A: bcdDigits(tlv.value, tlv.len, card.pan, sizeof(card.pan)); break;
+        case 0x57:
+        case 0x9F6B: parseTrack2(tlv, card); break; // 9F6B: MasterCard
+        case 0x5F24: bcdDate(tlv.value, tlv.len, card.validto); break;
+        case 0x5F25: bcdDate(tlv.value, tlv.len, card.validfrom); break;
+        case 0x5F20: copyText(tlv.value, tlv.len, card.holder, sizeof(card.holder)); break;
+        case 0x50:
+            if (!card.label[0]) copyText(tlv.value, tlv.len, card.label, sizeof(card.label));
+            break;
+    }
+}
+
+void EmvSession::parseCardData(EMVCard &card) { tlvWalk(data, dataLen, visitCardData, &card); }
+
+/**********************************************************************
+**  APDUs
+**********************************************************************/
+bool EmvSession::exchange(const uint8_t *cmd, size_t len) {
+    uint8_t retry[5 + 255 + 1];
+    for (uint8_t attempt = 0; attempt < 3; attempt++) {
+        size_t respLen = sizeof(rx);
+        _times.apdus++;
+        if (!transport.transceive(cmd, len, rx, respLen) || respLen < 2 || respLen > sizeof(rx)) {
+            lost = true;
+            return false;
+        }
+        data = rx;
+        dataLen = respLen - 2;
+        sw = (rx[respLen - 2] << 8) | rx[respLen - 1];
+
+        uint8_t sw1 = sw >> 8;
+        if (sw1 == 0x61) { // more data: GET RESPONSE
+            static const uint8_t getResponse[] = {0x00, 0xC0, 0x00, 0x00};
+            memcpy(retry, getResponse, 4);
+            retry[4] = sw & 0xFF;
+            cmd = retry;
+            len = 5;
+        } else if (sw1 == 0x6C && len <= sizeof(retry) && cmd != retry) { // wrong Le: same command again
+            memcpy(retry, cmd, len);
+            retry[len - 1] = sw & 0xFF;
+            cmd = retry;
+        } else {
+            return true;
+        }
+    }
+    return true;
+}
+
+bool EmvSession::select(const uint8_t *name, size_t len) {
+    uint8_t cmd[5 + EMV_AID_MAX + 1] = {0x00, 0xA4, 0x04, 0x00};
+    if (len > EMV_AID_MAX) return false;
+    cmd[4] = len;
+    memcpy(&cmd[5], name, len);
+    cmd[5 + len] = 0x00;
+    return exchange(cmd, 6 + len) && sw == 0x9000;
+}
+
+// Keeps what the FCI of the application just selected says about it
+static void takeApplication(
+    const uint8_t *aid, size_t aidLen, const uint8_t *fci, size_t fciLen, EMVCard &card, uint8_t *pdol,
+    size_t &pdolLen
+) {
+    memcpy(card.aid, aid, aidLen);
+    card.aid_len = aidLen;
+    card.vendor = vendorOf(aid, aidLen);
+    Tlv tlv;
+    if (tlvFind(fci, fciLen, 0x50, tlv)) copyText(tlv.value, tlv.len, card.label, sizeof(card.label));
+    pdolLen = 0;
+    if (tlvFind(fci, fciLen, 0x9F38, tlv) && tlv.len <= EMV_PDOL_MAX) {
+        memcpy(pdol, tlv.value, tlv.len);
+        pdolLen = tlv.len;
+    }
+}
+
+bool EmvSession::selectApplication(EMVCard &card) {
+    struct {
+        uint8_t aid[EMV_AID_MAX];
+        uint8_t len;
+        uint8_t priority;
+    } candidates[EMV_MAX_CANDIDATES];
+    uint8_t count = 0;
+
+    // Directory entries (61) of the PPSE: AID (4F) and priority (87, lower first, 0 = none)
+    uint32_t start = now();
+    if (select(ppseName, sizeof(ppseName))) {
+        Tlv directory;
+        if (tlvFind(data, dataLen, 0xBF0C, directory)) {
+            TlvReader entries(directory.value, directory.len);
+            Tlv entry, field;
+            while (count < EMV_MAX_CANDIDATES && entries.next(entry)) {
+                if (entry.tag != 0x61 || !tlvFind(entry.value, entry.len, 0x4F, field)) continue;
+                if (field.len == 0 || field.len > EMV_AID_MAX) continue;
+                memcpy(candidates[count].aid, field.value, field.len);
+                candidates[count].len = field.len;
+                uint8_t priority = 16;
+                bool prioritised = tlvFind(entry.value, entry.len, 0x87, field) && field.len == 1;
+                if (prioritised && (field.value[0] & 0x0F)) priority = field.value[0] & 0x0F;
+                candidates[count].priority = priority;
+                count++;
+            }
+        }
+    }
+    _times.ppse = now() - start;
+    if (lost) return false;
+
+    start = now();
+    // insertion sort by priority, stable for equal ones
+    for (uint8_t i = 1; i < count; i++) {
+        for (uint8_t j = i; j > 0 && candidates[j].priority < candidates[j - 1].priority; j--) {
+            auto tmp = candidates[j];
+            candidates[j] = candidates[j - 1];
+            candidates[j - 1] = tmp;
+        }
+    }
+    for (uint8_t i = 0; i < count && !lost; i++) {
+        if (!select(candidates[i].aid, candidates[i].len)) continue;
+        takeApplication(candidates[i].aid, candidates[i].len, data, dataLen, card, pdol, pdolLen);
+        _times.select = now() - start;
+        return true;
+    }
+
+    // No PPSE, or nothing in it answered: the known applications one by one
+    for (size_t i = 0; i < known_aid_count && !lost; i++) {
+        if (!select(known_aid[i].aid, known_aid[i].len)) continue;
+        takeApplication(known_aid[i].aid, known_aid[i].len, data, dataLen, card, pdol, pdolLen);
+        _times.select = now() - start;
+        return true;
+    }
+    _times.select = now() - start;
+    return false;
+}
+
+bool EmvSession::getProcessingOptions(EMVCard &card, uint8_t *afl, size_t &aflLen) {
+    // 80 A8 00 00 Lc 83 L <PDOL data> 00
+    uint8_t cmd[5 + 2 + 252 + 1] = {0x80, 0xA8, 0x00, 0x00};
+    size_t len = 0;
+    DolReader dol(pdol, pdolLen);
+    uint32_t tag;
+    size_t tagLen;
+    while (dol.next(tag, tagLen)) {
+        if (len + tagLen > 252) return false;
+        uint8_t *value = &cmd[7 + len];
+        memset(value, 0, tagLen);
+        if (tag == 0x9F37) { // unpredictable number
+            for (size_t i = 0; i < tagLen; i++) value[i] = unpredictable >> (8 * (i % 4));
+        } else if (tag == 0x9A) { // transaction date
+            memcpy(value, date, tagLen < sizeof(date) ? tagLen : sizeof(date));
+        }
+        for (const auto &t : terminalData) {
+            if (t.tag != tag) continue;
+            memcpy(value, t.value, tagLen < t.len ? tagLen : t.len);
+            break;
+        }
+        len += tagLen;
+    }
+    cmd[4] = len + 2;
+    cmd[5] = 0x83;
+    cmd[6] = len;
+    cmd[7 + len] = 0x00;
+    if (!exchange(cmd, 8 + len) || sw != 0x9000) return false;
+
+    // Format 1: 80 with AIP (2 bytes) then AFL. Format 2: 77 with 82 AIP and 94 AFL, maybe track 2 too.
+    Tlv tlv;
+    aflLen = 0;
+    if (tlvFind(data, dataLen, 0x80, tlv)) {
+        if (tlv.len < 2) return false;
+        aflLen = tlv.len - 2;
+        if (aflLen > EMV_PDOL_MAX) aflLen = EMV_PDOL_MAX;
+        memcpy(afl, tlv.value + 2, aflLen);
+        return true;
+    }
+    if (!tlvFind(data, dataLen, 0x77, tlv)) return false;
+    parseCardData(card);
+    if (tlvFind(tlv.value, tlv.len, 0x94, tlv)) {
+        aflLen = tlv.len > EMV_PDOL_MAX ? EMV_PDOL_MAX : tlv.len;
+        memcpy(afl, tlv.value, aflLen);
+    }
+    return true;
+}
+
+void EmvSession::readRecords(const uint8_t *afl, size_t aflLen, EMVCard &card) {
+    // 4 bytes per entry: SFI << 3, first record, last record, records for offline authentication
+    for (size_t i = 0; i + 4 <= aflLen && !lost; i += 4) {
+        uint8_t sfi = afl[i] >> 3;
+        uint8_t first = afl[i + 1];
+        uint8_t last = afl[i + 2];
+        if (sfi == 0 || sfi > 30 || first == 0 || first > last) continue;
+        for (uint16_t record = first; record <= last && !lost; record++) {
+            const uint8_t cmd[] = {0x00, 0xB2, (uint8_t)record, (uint8_t)((sfi << 3) | 0x04), 0x00};
+            if (!exchange(cmd, sizeof(cmd)) || sw != 0x9000) continue;
+            card.records++;
+            parseCardData(card);
+            // the rest is for offline authentication, not needed here
+            if (card.pan[0] && card.validto[0]) return;
+        }
+    }
+}
+
+static uint8_t toBcd(int v) { return ((v / 10 % 10) << 4) | (v % 10); }
+
+void EmvSession::setDate(int year, int month, int day) {
+    date[0] = toBcd(year % 100);
+    date[1] = toBcd(month);
+    date[2] = toBcd(day);
+}
+
+EmvResult EmvSession::read(EMVCard &card) {
+    card = EMVCard();
+    _times = EmvTimes();
+    lost = false;
+    uint32_t start = now();
+
+    EmvResult result = EMV_OK;
+    uint8_t afl[EMV_PDOL_MAX];
+    size_t aflLen = 0;
+    if (!selectApplication(card)) {
+        result = lost ? EMV_NO_CARD : EMV_NO_APP;
+    } else {
+        uint32_t gpoStart = now();
+        bool gpo = getProcessingOptions(card, afl, aflLen);
+        _times.gpo = now() - gpoStart;
+        if (!gpo) {
+            result = lost ? EMV_NO_CARD : EMV_GPO_FAILED;
+        } else {
+            uint32_t recordsStart = now();
+            readRecords(afl, aflLen, card);
+            _times.records = now() - recordsStart;
+        }
+    }
+    card.parsed = card.pan[0] != '\0';
+    if (result == EMV_OK && !card.parsed) result = lost ? EMV_NO_CARD : EMV_NO_DATA;
+    _times.total = now() - start;
+    return result;
+}
+#endif
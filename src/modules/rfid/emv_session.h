@@ -0,0 +1,123 @@
+#ifndef EMV_SESSION_H
+#define EMV_SESSION_H
+
+// EMV contactless read flow, independent of the reader hardware:
+//   SELECT PPSE -> candidate AIDs (or the known_aid table when there is no PPSE)
+//   SELECT AID  -> label and PDOL
+//   GET PROCESSING OPTIONS with the PDOL filled from terminal defaults -> AIP and AFL
+//   READ RECORD for every record of the AFL, until PAN and expiry are known
+// Responses go through a fixed buffer and the TLV parser, card data is copied into EMVCard.
+
+#include "emv_tlv.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#define EMV_RX_MAX 258 // 256 bytes of data and SW1 SW2
+#define EMV_AID_MAX 16
+#define EMV_PDOL_MAX 64
+#define EMV_MAX_CANDIDATES 4 // applications tried from the PPSE
+
+typedef enum emv_vendor {
+    EMV_VISA,
+    EMV_MASTERCARD,
+    EMV_AMEX,
+    EMV_DISCOVER,
+    EMV_JCB,
+    EMV_UNIONPAY,
+    EMV_INTERAC,
+    EMV_RUPAY,
+    EMV_MIR,
+    EMV_GIROCARD,
+    EMV_UNKNOWN
+} EMV_Vendor;
+
+typedef struct EMVCard {
+    bool parsed = false;
+    EMV_Vendor vendor = EMV_UNKNOWN;
+    uint8_t aid[EMV_AID_MAX];
+    uint8_t aid_len = 0;
+    char label[17] = "";     // application label (50)
+    char pan[20] = "";       // digits (5A or track 2)
+    char validfrom[6] = "";  // MM/YY (5F25)
+    char validto[6] = "";    // MM/YY (5F24 or track 2)
+    char holder[27] = "";    // cardholder name (5F20)
+    uint8_t records = 0;     // AFL records read
+} EMVCard;
+
+typedef struct EMVAID {
+    uint8_t aid[EMV_AID_MAX];
+    uint8_t len;
+    const char *name;
+    EMV_Vendor vendor;
+} EMVAID;
+
+// Tried in order when the card has no PPSE, also names the vendor of a PPSE entry (longest prefix)
+// http://hartleyenterprises.com/listAID.html
+extern const EMVAID known_aid[];
+extern const size_t known_aid_count;
+
+const char *emvVendorName(EMV_Vendor vendor);
+
+enum EmvResult : uint8_t {
+    EMV_OK,
+    EMV_NO_CARD, // the transport failed, card gone
+    EMV_NO_APP,  // nothing could be selected
+    EMV_GPO_FAILED,
+    EMV_NO_DATA, // application read but no PAN found
+};
+
+const char *emvResultName(EmvResult result);
+
+// One command APDU out, the response with SW1 SW2 back. respLen is the buffer size on the way in.
+class EmvTransport {
+public:
+    virtual ~EmvTransport() {}
+    virtual bool transceive(const uint8_t *cmd, size_t len, uint8_t *resp, size_t &respLen) = 0;
+};
+
+// Microseconds spent in each step of the last read()
+struct EmvTimes {
+    uint32_t ppse, select, gpo, records, total;
+    uint16_t apdus;
+};
+
+class EmvSession {
+public:
+    // clock returns microseconds, without one the times stay at 0
+    EmvSession(EmvTransport &transport, uint32_t (*clock)() = nullptr) : transport(transport), clock(clock) {}
+
+    // 9F37 of the PDOL, should change on every read
+    uint32_t unpredictable = 0;
+
+    // 9A of the PDOL, BCD YYMMDD. Cards only want a plausible date, so 2025-01-01 is sent unless the
+    // caller knows the real one.
+    uint8_t date[3] = {0x25, 0x01, 0x01};
+    void setDate(int year, int month, int day);
+
+    EmvResult read(EMVCard &card);
+    const EmvTimes &times() const { return _times; }
+
+private:
+    EmvTransport &transport;
+    uint32_t (*clock)();
+    EmvTimes _times;
+
+    uint8_t rx[EMV_RX_MAX];
+    const uint8_t *data = nullptr; // response without the status word
+    size_t dataLen = 0;
+    uint16_t sw = 0;
+    bool lost = false; // the transport failed, no point in going on
+
+    uint8_t pdol[EMV_PDOL_MAX];
+    size_t pdolLen = 0;
+
+    uint32_t now() const { return clock ? clock() : 0; }
+    bool exchange(const uint8_t *cmd, size_t len);
+    bool select(const uint8_t *name, size_t len);
+    bool selectApplication(EMVCard &card);
+    bool getProcessingOptions(EMVCard &card, uint8_t *afl, size_t &aflLen);
+    void readRecords(const uint8_t *afl, size_t aflLen, EMVCard &card);
+    void parseCardData(EMVCard &card);
+};
+
+#endif
@@ -0,0 +1,87 @@
+#ifndef LITE_VERSION
+#include "emv_tlv.h"
+
+static bool readTag(const uint8_t *&pos, const uint8_t *end, uint32_t &tag, bool *constructed) {
+    uint8_t first = *pos++;
+    tag = first;
+    if (constructed) *constructed = first & 0x20;
+    if ((first & 0x1F) != 0x1F) return true;
+    // subsequent bytes have bit 8 set while more follow
+    for (uint8_t i = 1; i < 4; i++) {
+        if (pos >= end) return false;
+        uint8_t b = *pos++;
+        tag = (tag << 8) | b;
+        if (!(b & 0x80)) return true;
+    }
+    return false;
+}
+
+static bool readLength(const uint8_t *&pos, const uint8_t *end, size_t &len) {
+    if (pos >= end) return false;
+    uint8_t first = *pos++;
+    if (first < 0x80) {
+        len = first;
+        return true;
+    }
+    uint8_t bytes = first & 0x7F;
+    if (bytes == 0 || bytes > 3 || end - pos < bytes) return false; // indefinite or too long
+    len = 0;
+    while (bytes--) len = (len << 8) | *pos++;
+    return true;
+}
+
+bool TlvReader::next(Tlv &tlv) {
+    while (pos < end && (*pos == 0x00 || *pos == 0xFF)) pos++;
+    if (pos >= end || _error) return false;
+
+    if (!readTag(pos, end, tlv.tag, &tlv.constructed) || !readLength(pos, end, tlv.len) ||
+        tlv.len > (size_t)(end - pos)) {
+        _error = true;
+        return false;
+    }
+    tlv.value = pos;
+    pos += tlv.len;
+    return true;
+}
+
+bool DolReader::next(uint32_t &tag, size_t &len) {
+    if (pos >= end || _error) return false;
+    if (!readTag(pos, end, tag, nullptr) || !readLength(pos, end, len)) {
+        _error = true;
+        return false;
+    }
+    return true;
+}
+
+static bool find(const uint8_t *data, size_t len, uint32_t tag, Tlv &out, uint8_t depth) {
+    if (depth >= EMV_TLV_MAX_DEPTH) return false;
+    TlvReader reader(data, len);
+    Tlv tlv;
+    while (reader.next(tlv)) {
+        if (tlv.tag == tag) {
+            out = tlv;
+            return true;
+        }
+        if (tlv.constructed && find(tlv.value, tlv.len, tag, out, depth + 1)) return true;
+    }
+    return false;
+}
+
+bool tlvFind(const uint8_t *data, size_t len, uint32_t tag, Tlv &out) { return find(data, len, tag, out, 0); }
+
+static bool walk(const uint8_t *data, size_t len, TlvVisitor fn, void *ctx, uint8_t depth) {
+    if (depth >= EMV_TLV_MAX_DEPTH) return false;
+    TlvReader reader(data, len);
+    Tlv tlv;
+    bool ok = true;
+    while (reader.next(tlv)) {
+        if (!tlv.constructed) fn(tlv, ctx);
+        else if (!walk(tlv.value, tlv.len, fn, ctx, depth + 1)) ok = false;
+    }
+    return ok && !reader.error();
+}
+
+bool tlvWalk(const uint8_t *data, size_t len, TlvVisitor fn, void *ctx) {
+    return walk(data, len, fn, ctx, 0);
+}
+#endif
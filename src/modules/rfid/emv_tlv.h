@@ -0,0 +1,55 @@
+#ifndef EMV_TLV_H
+#define EMV_TLV_H
+
+// BER-TLV as used by EMV, parsed in place: items point into the caller's buffer, nothing is copied or
+// allocated. Tags of up to 4 bytes and definite lengths of up to 3 bytes; 0x00 and 0xFF between items
+// are padding. Anything that does not fit in the buffer makes the reader stop with error() set.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define EMV_TLV_MAX_DEPTH 8 // nested templates followed by tlvFind() and tlvWalk()
+
+struct Tlv {
+    uint32_t tag; // as on the wire, 0x9F38 for 9F 38
+    bool constructed;
+    const uint8_t *value;
+    size_t len;
+};
+
+class TlvReader {
+public:
+    TlvReader(const uint8_t *data, size_t len) : pos(data), end(data + len) {}
+
+    // false at the end of the data, or on a malformed item
+    bool next(Tlv &tlv);
+    bool error() const { return _error; }
+
+private:
+    const uint8_t *pos;
+    const uint8_t *end;
+    bool _error = false;
+};
+
+// Data Object List (PDOL, CDOL...): tags and lengths without values
+class DolReader {
+public:
+    DolReader(const uint8_t *data, size_t len) : pos(data), end(data + len) {}
+
+    bool next(uint32_t &tag, size_t &len);
+    bool error() const { return _error; }
+
+private:
+    const uint8_t *pos;
+    const uint8_t *end;
+    bool _error = false;
+};
+
+// First item with this tag, depth first through the constructed ones
+bool tlvFind(const uint8_t *data, size_t len, uint32_t tag, Tlv &out);
+
+// Calls fn for every primitive item, nested ones included. False if the data is malformed or too deep.
+typedef void (*TlvVisitor)(const Tlv &tlv, void *ctx);
+bool tlvWalk(const uint8_t *data, size_t len, TlvVisitor fn, void *ctx);
+
+#endif
@@ -0,0 +1,327 @@
+#include "rfid_dump.h"
+#include <stdio.h>
+#include <string.h>
+
+const char *rfidDumpErrorName(RfidDumpError error) {
+    switch (error) {
+        case RFID_DUMP_OK: return "OK";
+        case RFID_DUMP_LINE_TOO_LONG: return "Line too long";
+        case RFID_DUMP_SYNTAX: return "Syntax error";
+        case RFID_DUMP_BAD_HEX: return "Bad hex data";
+        case RFID_DUMP_BAD_NUMBER: return "Bad number";
+        case RFID_DUMP_FIELD_SIZE: return "Wrong field size";
+        case RFID_DUMP_PAGE_RANGE: return "Page out of range";
+        case RFID_DUMP_PAGE_SIZE: return "Wrong page size";
+        case RFID_DUMP_DUPLICATE: return "Duplicate page";
+        case RFID_DUMP_NO_UID: return "No UID";
+    }
+    return "Unknown error";
+}
+
+void RfidDump::clear() { memset(this, 0, sizeof(RfidDump)); }
+
+bool RfidDump::isFelica() const { return strcmp(type, "FeliCa") == 0; }
+
+bool RfidDump::setPage(uint16_t page, const uint8_t *bytes, uint8_t len) {
+    if (page >= RFID_DUMP_MAX_PAGES || (len != 4 && len != 16)) return false;
+    if (pageSize == 0) pageSize = len;
+    if (len != pageSize) return false;
+    memcpy(&data[page * pageSize], bytes, len);
+    valid[page / 8] |= 1 << (page % 8);
+    return true;
+}
+
+void RfidDump::invalidate(uint16_t page) {
+    if (page < RFID_DUMP_MAX_PAGES) valid[page / 8] &= ~(1 << (page % 8));
+}
+
+uint16_t RfidDump::validCount() const {
+    uint16_t count = 0;
+    for (uint8_t b : valid) count += __builtin_popcount(b);
+    return count;
+}
+
+uint16_t RfidDump::endPage() const {
+    for (uint16_t page = RFID_DUMP_MAX_PAGES; page > 0; page--)
+        if (isValid(page - 1)) return page;
+    return 0;
+}
+
+bool RfidDump::complete() const {
+    if (total == 0) return false;
+    for (uint16_t page = 0; page < total; page++)
+        if (!isValid(page)) return false;
+    return true;
+}
+
+size_t RfidDump::copyPages(uint16_t first, uint16_t count, uint8_t *out, size_t outSize) const {
+    size_t written = 0;
+    for (uint16_t page = first; page < first + count && isValid(page); page++) {
+        if (written + pageSize > outSize) break;
+        memcpy(&out[written], &data[page * pageSize], pageSize);
+        written += pageSize;
+    }
+    return written;
+}
+
+uint32_t RfidDump::digest() const {
+    uint32_t hash = 2166136261UL;
+    auto mix = [&hash](const uint8_t *bytes, size_t len) {
+        while (len--) hash = (hash ^ *bytes++) * 16777619UL;
+    };
+    mix(&pageSize, 1);
+    for (uint16_t page = 0; page < RFID_DUMP_MAX_PAGES; page++) {
+        if (!isValid(page)) continue;
+        uint8_t index[2] = {(uint8_t)(page >> 8), (uint8_t)page};
+        mix(index, 2);
+        mix(&data[page * pageSize], pageSize);
+    }
+    return hash;
+}
+
+static int hexDigit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+// Hex bytes, in pairs, with or without spaces between them. "??" is taken as 0 and counted in unknown
+// when it is not null, an error otherwise.
+static RfidDumpError parseHex(const char *text, uint8_t *out, size_t max, size_t &count, size_t *unknown) {
+    count = 0;
+    while (*text) {
+        if (*text == ' ') {
+            text++;
+            continue;
+        }
+        if (!text[1] || text[1] == ' ') return RFID_DUMP_BAD_HEX; // odd number of digits
+        if (count >= max) return RFID_DUMP_FIELD_SIZE;
+        if (text[0] == '?' && text[1] == '?' && unknown) {
+            (*unknown)++;
+            out[count++] = 0;
+        } else {
+            int hi = hexDigit(text[0]);
+            int lo = hexDigit(text[1]);
+            if (hi < 0 || lo < 0) return RFID_DUMP_BAD_HEX;
+            out[count++] = (hi << 4) | lo;
+        }
+        text += 2;
+    }
+    return RFID_DUMP_OK;
+}
+
+static bool parseNumber(const char *text, uint32_t &value) {
+    value = 0;
+    if (!*text) return false;
+    for (; *text; text++) {
+        if (*text < '0' || *text > '9' || value > 100000) return false;
+        value = value * 10 + (*text - '0');
+    }
+    return true;
+}
+
+static bool keyIs(const char *key, size_t keyLen, const char *name) {
+    return strlen(name) == keyLen && memcmp(key, name, keyLen) == 0;
+}
+
+RfidDumpError RfidDumpParser::feed(const char *data, size_t dataLen) {
+    for (size_t i = 0; i < dataLen && _error == RFID_DUMP_OK; i++) {
+        char c = data[i];
+        if (c != '\n') {
+            if (len < RFID_DUMP_LINE_MAX) buf[len++] = c;
+            else overflow = true;
+            continue;
+        }
+        lineNo++;
+        if (overflow) _error = RFID_DUMP_LINE_TOO_LONG;
+        else _error = parseLine(buf, len);
+        len = 0;
+        overflow = false;
+    }
+    return _error;
+}
+
+RfidDumpError RfidDumpParser::finish() {
+    if (_error != RFID_DUMP_OK) return _error;
+    if (len > 0 || overflow) {
+        lineNo++;
+        _error = overflow ? RFID_DUMP_LINE_TOO_LONG : parseLine(buf, len);
+        len = 0;
+        if (_error != RFID_DUMP_OK) return _error;
+    }
+    if (dump.uidLen == 0) _error = RFID_DUMP_NO_UID;
+    return _error;
+}
+
+RfidDumpError RfidDumpParser::parseLine(char *text, size_t textLen) {
+    while (textLen && (text[textLen - 1] == '\r' || text[textLen - 1] == ' ' || text[textLen - 1] == '\t'))
+        textLen--;
+    text[textLen] = '\0';
+    while (*text == ' ' || *text == '\t') text++;
+
+    if (!*text || *text == '#') return RFID_DUMP_OK;
+
+    char *colon = strchr(text, ':');
+    if (!colon) return strncmp(text, "Version", 7) == 0 ? RFID_DUMP_OK : RFID_DUMP_SYNTAX;
+
+    size_t keyLen = colon - text;
+    while (keyLen && text[keyLen - 1] == ' ') keyLen--;
+    const char *value = colon + 1;
+    while (*value == ' ') value++;
+
+    // "Page 12" and "Block 12", not "Pages total"
+    const char *index = nullptr;
+    if (keyLen > 5 && strncmp(text, "Page ", 5) == 0) index = text + 5;
+    else if (keyLen > 6 && strncmp(text, "Block ", 6) == 0) index = text + 6;
+    if (index) {
+        text[keyLen] = '\0';
+        return parsePage(index, value);
+    }
+    return parseField(text, keyLen, value);
+}
+
+RfidDumpError RfidDumpParser::parseField(const char *key, size_t keyLen, const char *value) {
+    size_t count;
+    RfidDumpError err;
+    uint32_t number;
+
+    if (keyIs(key, keyLen, "Device type")) {
+        strncpy(dump.type, value, RFID_DUMP_TYPE_LEN - 1);
+        dump.type[RFID_DUMP_TYPE_LEN - 1] = '\0';
+    } else if (keyIs(key, keyLen, "UID")) {
+        if ((err = parseHex(value, dump.uid, RFID_DUMP_UID_MAX, count, nullptr)) != RFID_DUMP_OK) return err;
+        if (count == 0) return RFID_DUMP_FIELD_SIZE;
+        dump.uidLen = count;
+    } else if (keyIs(key, keyLen, "SAK")) {
+        if ((err = parseHex(value, &dump.sak, 1, count, nullptr)) != RFID_DUMP_OK) return err;
+        if (count != 1) return RFID_DUMP_FIELD_SIZE;
+        dump.hasSak = true;
+    } else if (keyIs(key, keyLen, "ATQA")) {
+        if ((err = parseHex(value, dump.atqa, 2, count, nullptr)) != RFID_DUMP_OK) return err;
+        if (count != 2) return RFID_DUMP_FIELD_SIZE;
+        dump.hasAtqa = true;
+    } else if (keyIs(key, keyLen, "Manufacture id")) {
+        if ((err = parseHex(value, dump.pmm, sizeof(dump.pmm), count, nullptr)) != RFID_DUMP_OK) return err;
+        dump.pmmLen = count;
+    } else if (keyIs(key, keyLen, "Pages total") || keyIs(key, keyLen, "Blocks total")) {
+        if (!parseNumber(value, number)) return RFID_DUMP_BAD_NUMBER;
+        if (number > RFID_DUMP_MAX_PAGES) return RFID_DUMP_PAGE_RANGE;
+        dump.total = number;
+    } else if (keyIs(key, keyLen, "Pages read") || keyIs(key, keyLen, "Blocks read")) {
+        if (!parseNumber(value, number)) return RFID_DUMP_BAD_NUMBER;
+        if (number > RFID_DUMP_MAX_PAGES) return RFID_DUMP_PAGE_RANGE;
+        dump.read = number;
+    } else if (!keyIs(key, keyLen, "Filetype") && !keyIs(key, keyLen, "Version")) {
+        _skipped++; // fields of other tools, like the Flipper signature and counters
+    }
+    return RFID_DUMP_OK;
+}
+
+RfidDumpError RfidDumpParser::parsePage(const char *index, const char *value) {
+    uint32_t page;
+    if (!parseNumber(index, page)) return RFID_DUMP_BAD_NUMBER;
+    if (page >= RFID_DUMP_MAX_PAGES) return RFID_DUMP_PAGE_RANGE;
+
+    uint8_t bytes[16];
+    size_t count;
+    size_t unknown = 0;
+    RfidDumpError err = parseHex(value, bytes, sizeof(bytes), count, &unknown);
+    if (err == RFID_DUMP_FIELD_SIZE) return RFID_DUMP_PAGE_SIZE;
+    if (err != RFID_DUMP_OK) return err;
+    if ((count != 4 && count != 16) || (dump.pageSize && count != dump.pageSize)) return RFID_DUMP_PAGE_SIZE;
+    if (seen[page / 8] & (1 << (page % 8))) return RFID_DUMP_DUPLICATE;
+    seen[page / 8] |= 1 << (page % 8);
+
+    dump.setPage(page, bytes, count);
+    if (unknown) dump.invalidate(page); // kept out of writes and comparisons
+    return RFID_DUMP_OK;
+}
+
+void rfidDumpHex(const uint8_t *bytes, size_t len, char *out, char separator) {
+    static const char digits[] = "0123456789ABCDEF";
+    for (size_t i = 0; i < len; i++) {
+        if (i && separator) *out++ = separator;
+        *out++ = digits[bytes[i] >> 4];
+        *out++ = digits[bytes[i] & 0x0F];
+    }
+    *out = '\0';
+}
+
+bool RfidDumpWriter::next(char *line, size_t size) {
+    char hex[3 * 16 + 1];
+    bool felica = dump.isFelica();
+
+    while (true) {
+        switch (step++) {
+            case 0: snprintf(line, size, "Filetype: Bruce RFID File"); return true;
+            case 1: snprintf(line, size, "Version 1"); return true;
+            case 2: snprintf(line, size, "Device type: %s", dump.type); return true;
+            case 3: snprintf(line, size, "# UID, ATQA and SAK are common for all formats"); return true;
+            case 4:
+                rfidDumpHex(dump.uid, dump.uidLen, hex);
+                snprintf(line, size, "UID: %s", hex);
+                return true;
+            case 5:
+                if (felica) {
+                    rfidDumpHex(dump.pmm, dump.pmmLen, hex);
+                    snprintf(line, size, "Manufacture id: %s", hex);
+                } else {
+                    snprintf(line, size, "SAK: %02X", dump.sak);
+                }
+                return true;
+            case 6:
+                if (felica) {
+                    snprintf(line, size, "Blocks total: %u", dump.total);
+                } else {
+                    rfidDumpHex(dump.atqa, 2, hex);
+                    snprintf(line, size, "ATQA: %s", hex);
+                }
+                return true;
+            case 7:
+                if (felica) snprintf(line, size, "Blocks read: %u", dump.validCount());
+                else snprintf(line, size, "# Memory dump");
+                return true;
+            case 8:
+                if (felica) continue;
+                snprintf(line, size, "Pages total: %u", dump.total);
+                return true;
+            case 9:
+                if (felica || dump.complete()) continue;
+                snprintf(line, size, "Pages read: %u", dump.validCount());
+                return true;
+            default:
+                step--; // stays on the pages
+                while (pagePos < RFID_DUMP_MAX_PAGES && !dump.isValid(pagePos)) pagePos++;
+                if (pagePos >= RFID_DUMP_MAX_PAGES) return false;
+                rfidDumpHex(dump.page(pagePos), dump.pageSize, hex);
+                snprintf(line, size, "%s %u: %s", felica ? "Block" : "Page", pagePos, hex);
+                pagePos++;
+                return true;
+        }
+    }
+}
+
+#ifdef ARDUINO
+RfidDumpError rfidDumpLoad(File &file, RfidDump &dump, uint32_t *line) {
+    RfidDumpParser parser(dump);
+    char chunk[256];
+    while (file.available() && parser.error() == RFID_DUMP_OK) {
+        int n = file.read((uint8_t *)chunk, sizeof(chunk));
+        if (n <= 0) break;
+        parser.feed(chunk, n);
+    }
+    RfidDumpError err = parser.finish();
+    if (line) *line = parser.line();
+    return err;
+}
+
+bool rfidDumpSave(File &file, const RfidDump &dump) {
+    RfidDumpWriter writer(dump);
+    char line[RFID_DUMP_LINE_MAX];
+    while (writer.next(line, sizeof(line))) {
+        if (file.println(line) == 0) return false;
+    }
+    return true;
+}
+#endif
@@ -0,0 +1,136 @@
+#ifndef __RFID_DUMP_H__
+#define __RFID_DUMP_H__
+
+// Codec for the .rfid dump files, shared by every HF reader.
+// The text format is line based:
+//   Filetype: Bruce RFID File
+//   Version 1
+//   Device type: NTAG215
+//   UID: 04 A1 B2 C3 D4 E5 F6
+//   SAK: 00
+//   ATQA: 00 44
+//   Pages total: 135
+//   Page 0: 04 A1 B2 9F
+// FeliCa dumps use "Manufacture id", "Blocks total", "Blocks read" and "Block N". Flipper .nfc files
+// are read too: their other fields are skipped and "??" bytes leave the page marked as not read.
+// RfidDumpParser fills an RfidDump from chunks of any size with a single line buffer,
+// RfidDumpWriter produces the file one line at a time. Neither allocates nor depends on Arduino.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define RFID_DUMP_MAX_PAGES 256  // MIFARE Classic 4K blocks
+#define RFID_DUMP_MAX_BYTES 4096 // 256 pages of 16 bytes
+#define RFID_DUMP_UID_MAX 10
+#define RFID_DUMP_TYPE_LEN 32
+#define RFID_DUMP_LINE_MAX 96 // "Page 255: " and 16 bytes is 58
+
+enum RfidDumpError : uint8_t {
+    RFID_DUMP_OK,
+    RFID_DUMP_LINE_TOO_LONG,
+    RFID_DUMP_SYNTAX,     // neither a comment, "Key: value" nor "Version N"
+    RFID_DUMP_BAD_HEX,    // not a hex byte, or bytes not separated
+    RFID_DUMP_BAD_NUMBER, // page index or count
+    RFID_DUMP_FIELD_SIZE, // UID longer than 10 bytes, SAK not one byte...
+    RFID_DUMP_PAGE_RANGE, // index past RFID_DUMP_MAX_PAGES or past the total
+    RFID_DUMP_PAGE_SIZE,  // not 4 or 16 bytes, or not the size of the previous pages
+    RFID_DUMP_DUPLICATE,  // same page twice
+    RFID_DUMP_NO_UID,
+};
+
+const char *rfidDumpErrorName(RfidDumpError error);
+
+struct RfidDump {
+    char type[RFID_DUMP_TYPE_LEN]; // "Device type"
+    uint8_t uid[RFID_DUMP_UID_MAX];
+    uint8_t uidLen;
+    uint8_t sak;
+    uint8_t atqa[2];
+    bool hasSak;
+    bool hasAtqa;
+    uint8_t pmm[8]; // FeliCa manufacture id
+    uint8_t pmmLen;
+
+    uint8_t pageSize; // 4 for Ultralight/NTAG, 16 for Classic and FeliCa, 0 before the first page
+    uint16_t total;   // pages on the card, 0 when not known
+    uint16_t read;    // pages the file says were read, 0 when it does not say
+    uint8_t valid[RFID_DUMP_MAX_PAGES / 8];
+    uint8_t data[RFID_DUMP_MAX_BYTES];
+
+    void clear();
+    bool isFelica() const;
+
+    bool isValid(uint16_t page) const {
+        return page < RFID_DUMP_MAX_PAGES && (valid[page / 8] >> (page % 8)) & 1;
+    }
+    // nullptr when the page was not read
+    const uint8_t *page(uint16_t page) const { return isValid(page) ? &data[page * pageSize] : nullptr; }
+    // Stores a page, the first one fixes the page size. False for another size or out of range.
+    bool setPage(uint16_t page, const uint8_t *bytes, uint8_t len);
+    void invalidate(uint16_t page);
+
+    uint16_t validCount() const;
+    // One past the last page read
+    uint16_t endPage() const;
+    // Every page of the total was read
+    bool complete() const;
+    // The pages read, consecutive from page first, as one byte array. Stops at the first missing page.
+    size_t copyPages(uint16_t first, uint16_t count, uint8_t *out, size_t outSize) const;
+    // FNV-1a of every page read, to compare the data of two cards
+    uint32_t digest() const;
+};
+
+class RfidDumpParser {
+public:
+    RfidDumpParser(RfidDump &dump) : dump(dump) { dump.clear(); }
+
+    // Parses what came in, stops at the first error and keeps returning it
+    RfidDumpError feed(const char *data, size_t len);
+    // Parses the last line and checks the dump as a whole
+    RfidDumpError finish();
+
+    RfidDumpError error() const { return _error; }
+    uint32_t line() const { return lineNo; } // line of the error, from 1
+    uint16_t skipped() const { return _skipped; }
+
+private:
+    RfidDump &dump;
+    char buf[RFID_DUMP_LINE_MAX + 1];
+    uint16_t len = 0;
+    bool overflow = false;
+    uint32_t lineNo = 0;
+    uint16_t _skipped = 0;
+    uint8_t seen[RFID_DUMP_MAX_PAGES / 8] = {}; // pages met so far, read or not
+    RfidDumpError _error = RFID_DUMP_OK;
+
+    RfidDumpError parseLine(char *text, size_t textLen);
+    RfidDumpError parseField(const char *key, size_t keyLen, const char *value);
+    RfidDumpError parsePage(const char *index, const char *value);
+};
+
+// Gives the file one line at a time, without the line ending
+class RfidDumpWriter {
+public:
+    RfidDumpWriter(const RfidDump &dump) : dump(dump) {}
+
+    // False when everything was written. Lines longer than size are cut.
+    bool next(char *line, size_t size);
+
+private:
+    const RfidDump &dump;
+    uint8_t step = 0;
+    uint16_t pagePos = 0;
+};
+
+// "04 A1 B2", uppercase, size of out is at least 3 * len
+void rfidDumpHex(const uint8_t *bytes, size_t len, char *out, char separator = ' ');
+
+#ifdef ARDUINO
+#include <FS.h>
+
+// Whole file through the parser. The error line goes to line when it is not null.
+RfidDumpError rfidDumpLoad(File &file, RfidDump &dump, uint32_t *line = nullptr);
+bool rfidDumpSave(File &file, const RfidDump &dump);
+#endif
+
+#endif
@@ -114,7 +114,7 @@ void TagOMatic::set_state(RFID_State state) {
         _scanned_tags.clear();
     }
     _sourceUID = "";
-    _sourcePages = "";
+    _sourceDigest = 0;
 
     switch (state) {
         case READ_MODE:
@@ -125,7 +125,7 @@ void TagOMatic::set_state(RFID_State state) {
             break;
         case CHECK_MODE:
             _sourceUID = _rfid->printableUID.uid;
-            _sourcePages = _rfid->strAllPages;
+            _sourceDigest = _rfid->dump.digest();
             padprintln("Source UID: " + _sourceUID);
             padprintln("");
             break;
@@ -191,7 +191,7 @@ void TagOMatic::dump_check_details() {
     padprintln("");
 
     padprintln("UID: " + String(_sourceUID == _rfid->printableUID.uid ? "OK" : "NOT OK"));
-    padprintln("Data: " + String(_sourcePages == _rfid->strAllPages ? "OK" : "NOT OK"));
+    padprintln("Data: " + String(_sourceDigest == _rfid->dump.digest() ? "OK" : "NOT OK"));
     padprintln("");
 
     if (_rfid->pageReadStatus != RFIDInterface::SUCCESS)
@@ -462,7 +462,7 @@ void TagOMatic::load_file() {
 
         loopOptions(options);
     } else {
-        displayError("Error loading file.", true);
+        displayError(_rfid->loadError.isEmpty() ? "Error loading file." : _rfid->loadError, true);
         set_state(READ_MODE);
     }
 }
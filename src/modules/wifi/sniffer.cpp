@@ -28,6 +28,7 @@
 #include "FS.h"
 #include "core/display.h"
 #include "core/mykeyboard.h"
+#include "core/profiler.h"
 #include "core/sd_functions.h"
 #include "core/wifi/wifi_common.h"
 #include <Arduino.h>
@@ -630,6 +631,7 @@ static bool ensureSnifferBackend() {
     if (!snifferQueue) { snifferQueue = xQueueCreate(SNIFFER_QUEUE_DEPTH, sizeof(SnifferQueueItem)); }
     if (!snifferQueue) { return false; }
     if (!snifferWriterHandle) {
+        profilerTaskStack("sniff_writer", 4096);
 #if SOC_CPU_CORES_NUM > 1
         BaseType_t res = xTaskCreatePinnedToCore(
             snifferWriterTask, "sniff_writer", 4096, nullptr, 4, &snifferWriterHandle, 1
@@ -0,0 +1,658 @@
+#include "vt_terminal.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+VtTerminal::VtTerminal(uint16_t cols, uint16_t rows, uint16_t scrollbackLines) : _cols(cols), _rows(rows) {
+    size_t cells = (size_t)cols * rows;
+    screen = (VtCell *)malloc(cells * 2 * sizeof(VtCell));
+    mainLines = (VtCell **)malloc(rows * 2 * sizeof(VtCell *));
+    dirtyFrom = (uint16_t *)malloc(rows * 2 * sizeof(uint16_t));
+    if (screen == nullptr || mainLines == nullptr || dirtyFrom == nullptr || cols == 0 || rows == 0) {
+        free(screen);
+        free(mainLines);
+        free(dirtyFrom);
+        screen = nullptr;
+        mainLines = nullptr;
+        dirtyFrom = nullptr;
+        return;
+    }
+    altLines = mainLines + rows;
+    dirtyTo = dirtyFrom + rows;
+    for (uint16_t y = 0; y < rows; y++) {
+        mainLines[y] = screen + y * cols;
+        altLines[y] = screen + cells + y * cols;
+    }
+    // Scrollback is optional, the terminal works without it when memory is short
+    if (scrollbackLines > 0) history = (VtCell *)malloc((size_t)scrollbackLines * cols * sizeof(VtCell));
+    if (history != nullptr) historySize = scrollbackLines;
+    reset();
+}
+
+VtTerminal::~VtTerminal() {
+    free(screen);
+    free(mainLines);
+    free(dirtyFrom);
+    free(history);
+}
+
+void VtTerminal::reset() {
+    if (!ready()) return;
+    pen = {' ', 7, 0, VT_ATTR_DEFAULT_FG | VT_ATTR_DEFAULT_BG};
+    state = GROUND;
+    utf8Remaining = 0;
+    lines = mainLines;
+    altScreen = false;
+    curX = curY = 0;
+    wrapPending = false;
+    cursorVisible = true;
+    autowrap = true;
+    lineDrawing = false;
+    appCursorKeys = false;
+    scrollTop = 0;
+    scrollBottom = _rows - 1;
+    saved = {0, 0, pen, false};
+    viewOffset = 0;
+    VtCell empty = blank();
+    for (size_t i = 0; i < (size_t)_cols * _rows * 2; i++) screen[i] = empty;
+    markAllDirty();
+}
+
+/**********************************************************************
+**  Input
+**********************************************************************/
+void VtTerminal::write(const char *text) { write((const uint8_t *)text, strlen(text)); }
+
+void VtTerminal::write(const uint8_t *data, size_t len) {
+    if (!ready()) return;
+    bytesProcessed += len;
+    for (size_t i = 0; i < len; i++) {
+        uint8_t c = data[i];
+        // Plain text is most of the stream, keep it off the state machine
+        if (state == GROUND && c >= 0x20 && c < 0x7F && utf8Remaining == 0 && !lineDrawing) put(c);
+        else consume(c);
+    }
+}
+
+// DEC special graphics, as selected by ESC ( 0
+static char decGraphic(uint8_t c) {
+    switch (c) {
+        case 'j':
+        case 'k':
+        case 'l':
+        case 'm':
+        case 'n':
+        case 't':
+        case 'u':
+        case 'v':
+        case 'w': return '+';
+        case 'q': return '-';
+        case 'x': return '|';
+        case 'a': return '#';
+        case '`': return '*';
+        case '~': return '.';
+        default: return c;
+    }
+}
+
+static char unicodeGlyph(uint32_t code) {
+    if (code >= 0x2500 && code <= 0x257F) {
+        switch (code) {
+            case 0x2500:
+            case 0x2501:
+            case 0x2504:
+            case 0x2505:
+            case 0x2508:
+            case 0x2509:
+            case 0x254C:
+            case 0x254D:
+            case 0x2550: return '-';
+            case 0x2502:
+            case 0x2503:
+            case 0x2506:
+            case 0x2507:
+            case 0x250A:
+            case 0x250B:
+            case 0x254E:
+            case 0x254F:
+            case 0x2551: return '|';
+            default: return '+';
+        }
+    }
+    if (code >= 0x2580 && code <= 0x259F) return '#'; // blocks and shades, bar graphs in htop
+    switch (code) {
+        case 0x00A0: return ' ';
+        case 0x2013:
+        case 0x2014: return '-';
+        case 0x2018:
+        case 0x2019: return '\'';
+        case 0x201C:
+        case 0x201D: return '"';
+        case 0x2022:
+        case 0x00B7: return '*';
+        case 0x2026: return '.';
+        default: return '?';
+    }
+}
+
+void VtTerminal::consume(uint8_t c) {
+    // Cancel and escape interrupt any sequence, other controls are executed even inside one
+    if (c == 0x18 || c == 0x1A) {
+        state = GROUND;
+        return;
+    }
+    if (c == 0x1B && state != OSC) {
+        state = ESCAPE;
+        return;
+    }
+    if (c < 0x20 && state != OSC) {
+        control(c);
+        return;
+    }
+
+    switch (state) {
+        case GROUND:
+            if (c < 0x80) {
+                if (utf8Remaining > 0) put('?'); // truncated sequence
+                utf8Remaining = 0;
+                put(lineDrawing ? decGraphic(c) : c);
+            } else if ((c & 0xC0) == 0x80) {
+                if (utf8Remaining == 0) {
+                    put('?');
+                    return;
+                }
+                utf8Code = (utf8Code << 6) | (c & 0x3F);
+                if (--utf8Remaining == 0) put(unicodeGlyph(utf8Code));
+            } else {
+                if (utf8Remaining > 0) put('?'); // truncated sequence
+                // Lead byte: the high bits give the length of the sequence
+                if ((c & 0xE0) == 0xC0) utf8Remaining = 1;
+                else if ((c & 0xF0) == 0xE0) utf8Remaining = 2;
+                else if ((c & 0xF8) == 0xF0) utf8Remaining = 3;
+                else utf8Remaining = 0;
+                utf8Code = c & (0x3F >> utf8Remaining);
+                if (utf8Remaining == 0) put('?');
+            }
+            break;
+        case ESCAPE: escape(c); break;
+        case ESCAPE_CHARSET:
+            if (charsetG0) lineDrawing = c == '0';
+            state = GROUND;
+            break;
+        case CSI:
+            if (c >= '0' && c <= '9') {
+                if (paramCount == 0) paramCount = 1;
+                int &p = params[paramCount - 1];
+                if (p < 10000) p = p * 10 + (c - '0');
+            } else if (c == ';' || c == ':') {
+                if (paramCount == 0) paramCount = 1;
+                if (paramCount < VT_MAX_PARAMS) params[paramCount++] = 0;
+            } else if (c >= '<' && c <= '?') {
+                csiPrivate = c;
+            } else if (c >= 0x20 && c <= 0x2F) {
+                csiIntermediate = true;
+            } else if (c >= 0x40 && c <= 0x7E) {
+                state = GROUND;
+                if (!csiIntermediate) csiDispatch(c);
+            } else {
+                state = GROUND;
+            }
+            break;
+        case OSC:
+            // Window titles and the like, skipped up to BEL or ST
+            if (c == 0x07) state = GROUND;
+            else if (c == 0x1B) state = OSC_ESCAPE;
+            break;
+        case OSC_ESCAPE:
+            state = GROUND;
+            if (c != '\\') escape(c);
+            break;
+    }
+}
+
+void VtTerminal::control(uint8_t c) {
+    switch (c) {
+        case 0x08: // BS
+            if (curX > 0) curX--;
+            wrapPending = false;
+            break;
+        case 0x09: // HT, stops every 8 columns
+            curX = (curX / 8 + 1) * 8;
+            if (curX >= _cols) curX = _cols - 1;
+            wrapPending = false;
+            break;
+        case 0x0A: // LF, VT, FF
+        case 0x0B:
+        case 0x0C: lineFeed(); break;
+        case 0x0D: // CR
+            curX = 0;
+            wrapPending = false;
+            break;
+        default: break; // BEL, SO/SI and the rest are ignored
+    }
+}
+
+void VtTerminal::escape(uint8_t c) {
+    state = GROUND;
+    switch (c) {
+        case '[':
+            state = CSI;
+            paramCount = 0;
+            memset(params, 0, sizeof(params));
+            csiPrivate = 0;
+            csiIntermediate = false;
+            break;
+        case ']':
+        case 'P': // DCS, PM and APC strings are skipped the same way
+        case '^':
+        case '_': state = OSC; break;
+        case '(':
+        case ')':
+        case '*':
+        case '+':
+        case '#':
+            charsetG0 = c == '(';
+            state = ESCAPE_CHARSET;
+            break;
+        case '7':
+            saved = {curX, curY, pen, lineDrawing};
+            break;
+        case '8':
+            pen = saved.pen;
+            lineDrawing = saved.lineDrawing;
+            moveCursor(saved.x, saved.y);
+            break;
+        case 'D': lineFeed(); break;
+        case 'E':
+            curX = 0;
+            lineFeed();
+            break;
+        case 'M': reverseLineFeed(); break;
+        case 'c': reset(); break;
+        default: break; // keypad modes and anything unknown
+    }
+}
+
+/**********************************************************************
+**  Grid
+**********************************************************************/
+VtCell VtTerminal::blank() const {
+    // Erased cells take the current background, like xterm
+    return {' ', pen.fg, pen.bg, (uint8_t)(pen.attr & (VT_ATTR_DEFAULT_FG | VT_ATTR_DEFAULT_BG))};
+}
+
+void VtTerminal::put(char ch) {
+    if (wrapPending) {
+        wrapPending = false;
+        if (autowrap) {
+            curX = 0;
+            lineFeed();
+        }
+    }
+    lines[curY][curX] = {ch, pen.fg, pen.bg, pen.attr};
+    markDirty(curY, curX, curX + 1);
+    lastChar = ch;
+    if (curX + 1 >= _cols) wrapPending = true;
+    else curX++;
+}
+
+void VtTerminal::lineFeed() {
+    wrapPending = false;
+    if (curY == scrollBottom) scrollUp(scrollTop, scrollBottom, 1, true);
+    else if (curY < _rows - 1) curY++;
+}
+
+void VtTerminal::reverseLineFeed() {
+    wrapPending = false;
+    if (curY == scrollTop) scrollDown(scrollTop, scrollBottom, 1);
+    else if (curY > 0) curY--;
+}
+
+void VtTerminal::scrollUp(uint16_t top, uint16_t bottom, uint16_t count, bool toHistory) {
+    if (count > bottom - top + 1) count = bottom - top + 1;
+    VtCell empty = blank();
+    for (uint16_t n = 0; n < count; n++) {
+        // Rows are pointers, scrolling moves them instead of the cells
+        VtCell *line = lines[top];
+        if (toHistory && top == 0 && !altScreen) pushHistory(line);
+        memmove(&lines[top], &lines[top + 1], (bottom - top) * sizeof(VtCell *));
+        lines[bottom] = line;
+        for (uint16_t x = 0; x < _cols; x++) line[x] = empty;
+    }
+    markRowsDirty(top, bottom);
+}
+
+void VtTerminal::scrollDown(uint16_t top, uint16_t bottom, uint16_t count) {
+    if (count > bottom - top + 1) count = bottom - top + 1;
+    VtCell empty = blank();
+    for (uint16_t n = 0; n < count; n++) {
+        VtCell *line = lines[bottom];
+        memmove(&lines[top + 1], &lines[top], (bottom - top) * sizeof(VtCell *));
+        lines[top] = line;
+        for (uint16_t x = 0; x < _cols; x++) line[x] = empty;
+    }
+    markRowsDirty(top, bottom);
+}
+
+void VtTerminal::pushHistory(const VtCell *line) {
+    if (historySize == 0) return;
+    uint16_t slot;
+    if (historyCount < historySize) {
+        slot = (historyHead + historyCount++) % historySize;
+    } else {
+        slot = historyHead;
+        historyHead = (historyHead + 1) % historySize;
+    }
+    memcpy(history + (size_t)slot * _cols, line, _cols * sizeof(VtCell));
+    // Someone reading the scrollback keeps looking at the same lines
+    if (viewOffset > 0) {
+        if (viewOffset < historyCount) viewOffset++;
+        else markAllDirty();
+    }
+}
+
+void VtTerminal::moveCursor(int x, int y) {
+    curX = x < 0 ? 0 : (x >= _cols ? _cols - 1 : x);
+    curY = y < 0 ? 0 : (y >= _rows ? _rows - 1 : y);
+    wrapPending = false;
+}
+
+void VtTerminal::eraseCells(uint16_t y, uint16_t from, uint16_t to) {
+    if (to > _cols) to = _cols;
+    if (from >= to) return;
+    VtCell empty = blank();
+    for (uint16_t x = from; x < to; x++) lines[y][x] = empty;
+    markDirty(y, from, to);
+}
+
+void VtTerminal::eraseDisplay(int mode) {
+    switch (mode) {
+        case 0:
+            eraseCells(curY, curX, _cols);
+            for (uint16_t y = curY + 1; y < _rows; y++) eraseCells(y, 0, _cols);
+            break;
+        case 1:
+            for (uint16_t y = 0; y < curY; y++) eraseCells(y, 0, _cols);
+            eraseCells(curY, 0, curX + 1);
+            break;
+        case 2:
+            for (uint16_t y = 0; y < _rows; y++) eraseCells(y, 0, _cols);
+            break;
+        case 3: // scrollback only
+            historyHead = historyCount = 0;
+            viewOffset = 0;
+            markAllDirty();
+            break;
+    }
+}
+
+void VtTerminal::insertCells(uint16_t count) {
+    if (count > _cols - curX) count = _cols - curX;
+    VtCell *line = lines[curY];
+    memmove(line + curX + count, line + curX, (_cols - curX - count) * sizeof(VtCell));
+    eraseCells(curY, curX, curX + count);
+    markDirty(curY, curX, _cols);
+}
+
+void VtTerminal::deleteCells(uint16_t count) {
+    if (count > _cols - curX) count = _cols - curX;
+    VtCell *line = lines[curY];
+    memmove(line + curX, line + curX + count, (_cols - curX - count) * sizeof(VtCell));
+    eraseCells(curY, _cols - count, _cols);
+    markDirty(curY, curX, _cols);
+}
+
+void VtTerminal::setAltScreen(bool on, bool saveCursor) {
+    if (on == altScreen) return;
+    if (on) {
+        if (saveCursor) saved = {curX, curY, pen, lineDrawing};
+        lines = altLines;
+        altScreen = true;
+        VtCell empty = blank();
+        for (uint16_t y = 0; y < _rows; y++) {
+            for (uint16_t x = 0; x < _cols; x++) lines[y][x] = empty;
+        }
+    } else {
+        lines = mainLines;
+        altScreen = false;
+        if (saveCursor) {
+            pen = saved.pen;
+            lineDrawing = saved.lineDrawing;
+            moveCursor(saved.x, saved.y);
+        }
+    }
+    viewOffset = 0;
+    markAllDirty();
+}
+
+/**********************************************************************
+**  Control sequences
+**********************************************************************/
+int VtTerminal::param(uint8_t i, int fallback) const {
+    return i < paramCount && params[i] != 0 ? params[i] : fallback;
+}
+
+void VtTerminal::sendReply(const char *text) {
+    size_t len = strlen(text);
+    if (replyLen + len > sizeof(reply)) return;
+    memcpy(reply + replyLen, text, len);
+    replyLen += len;
+}
+
+size_t VtTerminal::takeReply(char *out, size_t max) {
+    size_t len = replyLen < max ? replyLen : max;
+    memcpy(out, reply, len);
+    memmove(reply, reply + len, replyLen - len);
+    replyLen -= len;
+    return len;
+}
+
+void VtTerminal::csiDispatch(uint8_t c) {
+    if (csiPrivate == '?') {
+        if (c == 'h' || c == 'l') setMode(c == 'h');
+        return;
+    }
+    if (csiPrivate == '>') {
+        if (c == 'c') sendReply("\x1b[>0;0;0c"); // secondary device attributes
+        return;
+    }
+    if (csiPrivate != 0) return;
+
+    int n = param(0, 1);
+    // Vertical moves stop at the scroll region when they start inside it
+    uint16_t top = curY >= scrollTop ? scrollTop : 0;
+    uint16_t bottom = curY <= scrollBottom ? scrollBottom : _rows - 1;
+    switch (c) {
+        case '@': insertCells(n); break;
+        case 'A': moveCursor(curX, curY - n < top ? top : curY - n); break;
+        case 'B':
+        case 'e': moveCursor(curX, curY + n > bottom ? bottom : curY + n); break;
+        case 'C':
+        case 'a': moveCursor(curX + n, curY); break;
+        case 'D': moveCursor(curX - n, curY); break;
+        case 'E': moveCursor(0, curY + n > bottom ? bottom : curY + n); break;
+        case 'F': moveCursor(0, curY - n < top ? top : curY - n); break;
+        case 'G':
+        case '`': moveCursor(n - 1, curY); break;
+        case 'H':
+        case 'f': moveCursor(param(1, 1) - 1, n - 1); break;
+        case 'd': moveCursor(curX, n - 1); break;
+        case 'J': eraseDisplay(param(0, 0)); break;
+        case 'K': {
+            int mode = param(0, 0);
+            if (mode == 0) eraseCells(curY, curX, _cols);
+            else if (mode == 1) eraseCells(curY, 0, curX + 1);
+            else eraseCells(curY, 0, _cols);
+            break;
+        }
+        case 'L':
+            if (curY >= scrollTop && curY <= scrollBottom) scrollDown(curY, scrollBottom, n);
+            curX = 0;
+            break;
+        case 'M':
+            if (curY >= scrollTop && curY <= scrollBottom) scrollUp(curY, scrollBottom, n);
+            curX = 0;
+            break;
+        case 'P': deleteCells(n); break;
+        case 'S': scrollUp(scrollTop, scrollBottom, n); break;
+        case 'T': scrollDown(scrollTop, scrollBottom, n); break;
+        case 'X': eraseCells(curY, curX, curX + n); break;
+        case 'b': // REP
+            for (int i = 0; i < n && i < _cols * _rows; i++) put(lastChar);
+            break;
+        case 'm': selectGraphics(); break;
+        case 'r': {
+            int first = param(0, 1) - 1;
+            int last = param(1, _rows) - 1;
+            if (first < last && last < _rows) {
+                scrollTop = first;
+                scrollBottom = last;
+                moveCursor(0, 0);
+            }
+            break;
+        }
+        case 's': saved = {curX, curY, pen, lineDrawing}; break;
+        case 'u':
+            pen = saved.pen;
+            lineDrawing = saved.lineDrawing;
+            moveCursor(saved.x, saved.y);
+            break;
+        case 'n':
+            if (param(0, 0) == 5) {
+                sendReply("\x1b[0n");
+            } else if (param(0, 0) == 6) {
+                char position[16];
+                snprintf(position, sizeof(position), "\x1b[%u;%uR", curY + 1, curX + 1);
+                sendReply(position);
+            }
+            break;
+        case 'c': sendReply("\x1b[?1;2c"); break; // VT100 with advanced video
+        default: break;
+    }
+}
+
+void VtTerminal::setMode(bool on) {
+    for (uint8_t i = 0; i < paramCount; i++) {
+        switch (params[i]) {
+            case 1: appCursorKeys = on; break;
+            case 7: autowrap = on; break;
+            case 25:
+                cursorVisible = on;
+                markDirty(curY, curX, curX + 1);
+                break;
+            case 47:
+            case 1047: setAltScreen(on, false); break;
+            case 1049: setAltScreen(on, true); break;
+            default: break;
+        }
+    }
+}
+
+// 24 bit colors are matched to the 6x6x6 cube of the 256 color palette
+static uint8_t rgbToIndex(int r, int g, int b) {
+    auto level = [](int v) { return v < 48 ? 0 : (v < 115 ? 1 : (v - 35) / 40); };
+    return 16 + 36 * level(r) + 6 * level(g) + level(b);
+}
+
+void VtTerminal::selectGraphics() {
+    if (paramCount == 0) paramCount = 1; // ESC [ m is a reset
+    for (uint8_t i = 0; i < paramCount; i++) {
+        int p = params[i];
+        if (p == 0) {
+            pen.attr = VT_ATTR_DEFAULT_FG | VT_ATTR_DEFAULT_BG;
+        } else if (p == 1) {
+            pen.attr |= VT_ATTR_BOLD;
+        } else if (p == 2) {
+            pen.attr |= VT_ATTR_DIM;
+        } else if (p == 4) {
+            pen.attr |= VT_ATTR_UNDERLINE;
+        } else if (p == 7) {
+            pen.attr |= VT_ATTR_REVERSE;
+        } else if (p == 22) {
+            pen.attr &= ~(VT_ATTR_BOLD | VT_ATTR_DIM);
+        } else if (p == 24) {
+            pen.attr &= ~VT_ATTR_UNDERLINE;
+        } else if (p == 27) {
+            pen.attr &= ~VT_ATTR_REVERSE;
+        } else if ((p >= 30 && p <= 37) || (p >= 90 && p <= 97)) {
+            pen.fg = p >= 90 ? p - 90 + 8 : p - 30;
+            pen.attr &= ~VT_ATTR_DEFAULT_FG;
+        } else if ((p >= 40 && p <= 47) || (p >= 100 && p <= 107)) {
+            pen.bg = p >= 100 ? p - 100 + 8 : p - 40;
+            pen.attr &= ~VT_ATTR_DEFAULT_BG;
+        } else if (p == 39) {
+            pen.attr |= VT_ATTR_DEFAULT_FG;
+        } else if (p == 49) {
+            pen.attr |= VT_ATTR_DEFAULT_BG;
+        } else if (p == 38 || p == 48) {
+            uint8_t color;
+            if (i + 2 < paramCount && params[i + 1] == 5) {
+                color = params[i + 2];
+                i += 2;
+            } else if (i + 4 < paramCount && params[i + 1] == 2) {
+                color = rgbToIndex(params[i + 2], params[i + 3], params[i + 4]);
+                i += 4;
+            } else {
+                break;
+            }
+            if (p == 38) {
+                pen.fg = color;
+                pen.attr &= ~VT_ATTR_DEFAULT_FG;
+            } else {
+                pen.bg = color;
+                pen.attr &= ~VT_ATTR_DEFAULT_BG;
+            }
+        }
+    }
+}
+
+/**********************************************************************
+**  View
+**********************************************************************/
+const VtCell *VtTerminal::visibleRow(uint16_t y) const {
+    int index = (int)y - viewOffset;
+    if (index >= 0) return lines[index];
+    uint16_t slot = (historyHead + historyCount + index) % historySize;
+    return history + (size_t)slot * _cols;
+}
+
+void VtTerminal::scrollView(int count) {
+    int offset = viewOffset + count;
+    if (offset < 0) offset = 0;
+    if (offset > historyCount) offset = historyCount;
+    if (offset == viewOffset) return;
+    viewOffset = offset;
+    markAllDirty();
+}
+
+void VtTerminal::markDirty(uint16_t y, uint16_t from, uint16_t to) {
+    uint16_t row = y + viewOffset; // screen row to view row
+    if (row >= _rows) return;
+    if (from < dirtyFrom[row]) dirtyFrom[row] = from;
+    if (to > dirtyTo[row]) dirtyTo[row] = to > _cols ? _cols : to;
+}
+
+void VtTerminal::markRowsDirty(uint16_t from, uint16_t to) {
+    for (uint16_t y = from; y <= to; y++) markDirty(y, 0, _cols);
+}
+
+void VtTerminal::markAllDirty() {
+    for (uint16_t y = 0; y < _rows; y++) {
+        dirtyFrom[y] = 0;
+        dirtyTo[y] = _cols;
+    }
+}
+
+void VtTerminal::clearDirty() {
+    for (uint16_t y = 0; y < _rows; y++) {
+        dirtyFrom[y] = _cols;
+        dirtyTo[y] = 0;
+    }
+}
+
+bool VtTerminal::dirtySpan(uint16_t y, uint16_t &from, uint16_t &to) const {
+    if (dirtyFrom[y] >= dirtyTo[y]) return false;
+    from = dirtyFrom[y];
+    to = dirtyTo[y];
+    return true;
+}
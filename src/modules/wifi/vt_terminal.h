@@ -0,0 +1,147 @@
+#ifndef __VT_TERMINAL_H__
+#define __VT_TERMINAL_H__
+
+// Character-cell terminal for the SSH client.
+// Bytes from the remote side go through a VT100/xterm escape parser into a grid of cells, lines that
+// scroll off the top are kept in a scrollback ring, and every change marks a span of its row dirty so
+// the display only redraws what changed. No Arduino or display dependencies, the renderer lives with
+// the caller.
+//
+// Supported: C0 controls, cursor movement and positioning, erase in line/display, insert/delete of
+// lines and characters, scroll regions, SGR (bold, underline, reverse, 16/256/truecolor), DEC line
+// drawing, alternate screen (?47/?1047/?1049), cursor visibility (?25), autowrap (?7), DSR/DA replies.
+// UTF-8 is decoded; box drawing characters become + - |, anything else outside ASCII becomes '?'.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define VT_MAX_PARAMS 16
+#define VT_REPLY_SIZE 32
+
+// Cell attributes
+#define VT_ATTR_BOLD 0x01
+#define VT_ATTR_UNDERLINE 0x02
+#define VT_ATTR_REVERSE 0x04
+#define VT_ATTR_DIM 0x08
+#define VT_ATTR_DEFAULT_FG 0x10 // fg/bg hold no color, the renderer uses its own defaults
+#define VT_ATTR_DEFAULT_BG 0x20
+
+struct VtCell {
+    char ch;
+    uint8_t fg; // xterm 256 color index
+    uint8_t bg;
+    uint8_t attr;
+};
+
+class VtTerminal {
+public:
+    // Cells are allocated here, check ready() before use
+    VtTerminal(uint16_t cols, uint16_t rows, uint16_t scrollbackLines);
+    ~VtTerminal();
+    bool ready() const { return screen != nullptr; }
+
+    void write(const uint8_t *data, size_t len);
+    void write(const char *text);
+    void reset();
+
+    uint16_t cols() const { return _cols; }
+    uint16_t rows() const { return _rows; }
+
+    // Row y of the view: the live screen, or scrollback when the view is scrolled back
+    const VtCell *visibleRow(uint16_t y) const;
+    // Changed columns of a view row, [from, to). False when the row is clean.
+    bool dirtySpan(uint16_t y, uint16_t &from, uint16_t &to) const;
+    void clearDirty();
+    void markAllDirty();
+
+    // Cursor on the view, only meaningful when cursorShown()
+    uint16_t cursorX() const { return curX; }
+    uint16_t cursorY() const { return curY; }
+    bool cursorShown() const { return cursorVisible && viewOffset == 0; }
+    // Set by the remote side (DECCKM): arrow keys are sent as ESC O x instead of ESC [ x
+    bool applicationCursorKeys() const { return appCursorKeys; }
+
+    // Positive goes back in history. The view follows the output again once back at 0.
+    void scrollView(int lines);
+    uint16_t viewLines() const { return viewOffset; }
+    uint16_t historyLines() const { return historyCount; }
+
+    // Answers to queries (cursor position, device attributes) to be sent back to the remote side
+    size_t takeReply(char *out, size_t max);
+
+    uint32_t bytesProcessed = 0;
+
+private:
+    enum State : uint8_t { GROUND, ESCAPE, ESCAPE_CHARSET, CSI, OSC, OSC_ESCAPE };
+
+    uint16_t _cols, _rows;
+    VtCell *screen = nullptr;     // main and alternate screen cells, _rows * _cols each
+    VtCell **lines = nullptr;     // rows of the screen in use, reordered on scroll
+    VtCell **mainLines = nullptr;
+    VtCell **altLines = nullptr;
+    bool altScreen = false;
+
+    VtCell *history = nullptr; // scrollback ring, oldest line at historyHead once full
+    uint16_t historySize = 0;
+    uint16_t historyHead = 0;
+    uint16_t historyCount = 0;
+    uint16_t viewOffset = 0;
+
+    uint16_t *dirtyFrom = nullptr;
+    uint16_t *dirtyTo = nullptr;
+
+    uint16_t curX = 0, curY = 0;
+    bool wrapPending = false;
+    bool cursorVisible = true;
+    bool autowrap = true;
+    bool lineDrawing = false;
+    bool appCursorKeys = false;
+    uint16_t scrollTop = 0, scrollBottom = 0; // inclusive
+
+    VtCell pen; // ch unused, colors and attributes for new text
+    struct {
+        uint16_t x, y;
+        VtCell pen;
+        bool lineDrawing;
+    } saved = {};
+
+    State state = GROUND;
+    int params[VT_MAX_PARAMS];
+    uint8_t paramCount = 0;
+    char csiPrivate = 0;
+    bool csiIntermediate = false;
+    bool charsetG0 = false; // ESCAPE_CHARSET: the designation is for G0
+    char lastChar = ' ';    // for REP
+    uint32_t utf8Code = 0;
+    uint8_t utf8Remaining = 0;
+
+    char reply[VT_REPLY_SIZE];
+    size_t replyLen = 0;
+
+    void consume(uint8_t c);
+    void control(uint8_t c);
+    void put(char ch);
+    void lineFeed();
+    void reverseLineFeed();
+    void scrollUp(uint16_t top, uint16_t bottom, uint16_t count, bool toHistory = false);
+    void scrollDown(uint16_t top, uint16_t bottom, uint16_t count);
+    void pushHistory(const VtCell *line);
+    void moveCursor(int x, int y);
+    void eraseCells(uint16_t y, uint16_t from, uint16_t to);
+    void eraseDisplay(int mode);
+    void insertCells(uint16_t count);
+    void deleteCells(uint16_t count);
+    void setAltScreen(bool on, bool saveCursor);
+    void markDirty(uint16_t y, uint16_t from, uint16_t to);
+    void markRowsDirty(uint16_t from, uint16_t to);
+    VtCell blank() const;
+
+    void escape(uint8_t c);
+    void csiDispatch(uint8_t c);
+    void setMode(bool on);
+    void selectGraphics();
+    void sendReply(const char *text);
+    int param(uint8_t i, int fallback) const;
+};
+
+#endif
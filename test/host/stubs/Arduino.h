@@ -0,0 +1,68 @@
+#ifndef __HOST_ARDUINO_H__
+#define __HOST_ARDUINO_H__
+
+// The part of the Arduino core the tested code uses
+
+#include <algorithm>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+using std::max;
+using std::min;
+
+#define LOW 0x0
+#define HIGH 0x1
+#define INPUT 0x01
+#define OUTPUT 0x03
+
+inline void pinMode(int, uint8_t) {}
+inline void digitalWrite(int, uint8_t) {}
+
+// Time stands still unless a test moves it
+inline uint32_t hostMillis = 0;
+inline uint32_t millis() { return hostMillis; }
+inline uint32_t micros() { return hostMillis * 1000; }
+inline void delay(uint32_t ms) { hostMillis += ms; }
+
+class String : public std::string {
+public:
+    String(const char *s = "") : std::string(s) {}
+    String(const std::string &s) : std::string(s) {}
+    unsigned int length() const { return size(); }
+};
+
+class Print {
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) { return write(&c, 1); }
+    virtual size_t write(const uint8_t *buffer, size_t size) = 0;
+
+    size_t print(const char *s) { return write((const uint8_t *)s, strlen(s)); }
+    size_t print(const String &s) { return write((const uint8_t *)s.data(), s.size()); }
+    size_t println(const char *s = "") { return print(s) + print("\r\n"); }
+    size_t printf(const char *format, ...) {
+        char buffer[512];
+        va_list args;
+        va_start(args, format);
+        int n = vsnprintf(buffer, sizeof(buffer), format, args);
+        va_end(args);
+        return write((const uint8_t *)buffer, n < (int)sizeof(buffer) ? n : sizeof(buffer) - 1);
+    }
+};
+
+// Collects what is printed
+class StringPrint : public Print {
+public:
+    std::string text;
+    size_t write(const uint8_t *buffer, size_t size) override {
+        text.append((const char *)buffer, size);
+        return size;
+    }
+    using Print::write;
+};
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef __HOST_IRRECV_H__
+#define __HOST_IRRECV_H__
+
+// The part of IRremoteESP8266's IRrecv.h that ir_capture uses, with the library's values
+
+#include <Arduino.h>
+
+enum decode_type_t {
+    UNKNOWN = -1,
+    UNUSED = 0,
+    RC5,
+    RC6,
+    NEC,
+    SONY,
+    SAMSUNG = 7,
+    DAIKIN = 16,
+};
+
+const uint16_t kRawTick = 2;
+const uint16_t kStateSizeMax = 53;
+
+struct decode_results {
+    decode_type_t decode_type = UNKNOWN;
+    uint64_t value = 0;
+    uint32_t address = 0;
+    uint32_t command = 0;
+    uint8_t state[kStateSizeMax] = {};
+    uint16_t bits = 0;
+    volatile uint16_t *rawbuf = NULL;
+    uint16_t rawlen = 0;
+    bool overflow = false;
+    bool repeat = false;
+};
+
+#endif
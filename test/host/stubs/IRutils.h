@@ -0,0 +1,14 @@
+#ifndef __HOST_IRUTILS_H__
+#define __HOST_IRUTILS_H__
+
+#include <IRrecv.h>
+
+inline bool hasACState(const decode_type_t protocol) { return protocol == DAIKIN; }
+
+inline String typeToString(const decode_type_t protocol, const bool isRepeat = false) {
+    String name = protocol == DAIKIN ? "DAIKIN" : protocol == UNKNOWN ? "UNKNOWN" : "UNEXPECTED";
+    if (isRepeat) name += " (Repeat)";
+    return name;
+}
+
+#endif
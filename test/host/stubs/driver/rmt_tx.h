@@ -0,0 +1,72 @@
+#ifndef __HOST_RMT_TX_H__
+#define __HOST_RMT_TX_H__
+
+// RMT transmit API of ESP-IDF 5, accepting everything and sending nothing
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef int esp_err_t;
+#define ESP_OK 0
+
+typedef union {
+    struct {
+        uint16_t duration0 : 15;
+        uint16_t level0 : 1;
+        uint16_t duration1 : 15;
+        uint16_t level1 : 1;
+    };
+    uint32_t val;
+} rmt_symbol_word_t;
+
+typedef struct rmt_channel_t *rmt_channel_handle_t;
+typedef struct rmt_encoder_t *rmt_encoder_handle_t;
+typedef bool (*rmt_tx_done_callback_t)(rmt_channel_handle_t, const void *, void *);
+
+#define RMT_CLK_SRC_DEFAULT 0
+
+typedef struct {
+    int gpio_num;
+    int clk_src;
+    uint32_t resolution_hz;
+    size_t mem_block_symbols;
+    size_t trans_queue_depth;
+} rmt_tx_channel_config_t;
+typedef struct {
+} rmt_copy_encoder_config_t;
+typedef struct {
+    rmt_tx_done_callback_t on_trans_done;
+} rmt_tx_event_callbacks_t;
+typedef struct {
+    uint32_t frequency_hz;
+    float duty_cycle;
+} rmt_carrier_config_t;
+typedef struct {
+    int loop_count;
+} rmt_transmit_config_t;
+
+inline esp_err_t rmt_new_tx_channel(const rmt_tx_channel_config_t *, rmt_channel_handle_t *channel) {
+    *channel = (rmt_channel_handle_t)1;
+    return ESP_OK;
+}
+inline esp_err_t rmt_new_copy_encoder(const rmt_copy_encoder_config_t *, rmt_encoder_handle_t *encoder) {
+    *encoder = (rmt_encoder_handle_t)1;
+    return ESP_OK;
+}
+inline esp_err_t
+rmt_tx_register_event_callbacks(rmt_channel_handle_t, const rmt_tx_event_callbacks_t *, void *) {
+    return ESP_OK;
+}
+inline esp_err_t rmt_apply_carrier(rmt_channel_handle_t, const rmt_carrier_config_t *) { return ESP_OK; }
+inline esp_err_t rmt_enable(rmt_channel_handle_t) { return ESP_OK; }
+inline esp_err_t rmt_disable(rmt_channel_handle_t) { return ESP_OK; }
+inline esp_err_t rmt_del_channel(rmt_channel_handle_t) { return ESP_OK; }
+inline esp_err_t rmt_del_encoder(rmt_encoder_handle_t) { return ESP_OK; }
+inline esp_err_t rmt_tx_wait_all_done(rmt_channel_handle_t, int) { return ESP_OK; }
+inline esp_err_t rmt_transmit(
+    rmt_channel_handle_t, rmt_encoder_handle_t, const void *, size_t, const rmt_transmit_config_t *
+) {
+    return ESP_OK;
+}
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef __HOST_QUEUE_H__
+#define __HOST_QUEUE_H__
+
+// Single threaded FreeRTOS queue: sends fail when full, receives fail when empty, nothing waits
+
+#include "FreeRTOS.h"
+#include <deque>
+#include <string.h>
+#include <vector>
+
+struct HostQueue {
+    size_t length;
+    size_t itemSize;
+    std::deque<std::vector<uint8_t>> items;
+};
+typedef HostQueue *QueueHandle_t;
+
+inline QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize) {
+    return new HostQueue{length, itemSize, {}};
+}
+inline void vQueueDelete(QueueHandle_t queue) { delete queue; }
+
+inline BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t) {
+    if (queue->items.size() >= queue->length) return pdFALSE;
+    const uint8_t *bytes = (const uint8_t *)item;
+    queue->items.emplace_back(bytes, bytes + queue->itemSize);
+    return pdTRUE;
+}
+inline BaseType_t xQueuePeek(QueueHandle_t queue, void *item, TickType_t) {
+    if (queue->items.empty()) return pdFALSE;
+    memcpy(item, queue->items.front().data(), queue->itemSize);
+    return pdTRUE;
+}
+inline BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t wait) {
+    if (!xQueuePeek(queue, item, wait)) return pdFALSE;
+    queue->items.pop_front();
+    return pdTRUE;
+}
+inline UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue) { return queue->items.size(); }
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef __HOST_GLOBALS_H__
+#define __HOST_GLOBALS_H__
+
+// Stands in for include/globals.h: only what the tested modules reach through it
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include <Arduino.h>
+
+#define MALLOC_CAP_8BIT (1 << 2)
+#define MALLOC_CAP_SPIRAM (1 << 10)
+// No PSRAM on the host
+inline void *heap_caps_malloc(size_t size, uint32_t caps) {
+    return caps & MALLOC_CAP_SPIRAM ? NULL : malloc(size);
+}
+
+typedef int gpio_num_t;
+inline void gpio_reset_pin(gpio_num_t) {}
+
+struct HostSpiBus {
+    bool checkConflict(int) const { return false; }
+};
+struct HostPins {
+    HostSpiBus SDCARD_bus;
+};
+struct HostSpi {
+    void end() {}
+};
+inline HostPins bruceConfigPins;
+inline HostSpi sdcardSPI;
+
+#endif
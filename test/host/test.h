@@ -0,0 +1,36 @@
+#ifndef __HOST_TEST_H__
+#define __HOST_TEST_H__
+
+// Minimal checks for the host tests: a failed CHECK prints where and carries on, main() returns
+// testResult() so make stops on the first failing test binary.
+
+#include <stdio.h>
+
+static int testChecks = 0;
+static int testFailures = 0;
+
+#define CHECK(cond)                                                                                          \
+    do {                                                                                                     \
+        testChecks++;                                                                                        \
+        if (!(cond)) {                                                                                       \
+            testFailures++;                                                                                  \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond);                         \
+        }                                                                                                    \
+    } while (0)
+
+#define CHECK_EQ(a, b)                                                                                       \
+    do {                                                                                                     \
+        testChecks++;                                                                                        \
+        long long _a = (long long)(a), _b = (long long)(b);                                                  \
+        if (_a != _b) {                                                                                      \
+            testFailures++;                                                                                  \
+            fprintf(stderr, "%s:%d: %s == %s failed: %lld != %lld\n", __FILE__, __LINE__, #a, #b, _a, _b);   \
+        }                                                                                                    \
+    } while (0)
+
+static int testResult(const char *name) {
+    printf("%s: %d checks, %d failed\n", name, testChecks, testFailures);
+    return testFailures ? 1 : 0;
+}
+
+#endif
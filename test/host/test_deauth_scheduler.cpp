@@ -0,0 +1,202 @@
+// deauth_scheduler: frames, pacing, channel groups and rate measurement against a fake clock and sink
+
+#include "test.h"
+#include <modules/wifi/deauth_scheduler.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+struct Sent {
+    uint8_t channel;
+    uint32_t time;
+    uint8_t frame[DEAUTH_FRAME_LEN];
+};
+
+class MockSink : public DeauthSink {
+public:
+    uint8_t channel = 0;
+    uint32_t now = 0;
+    int channelChanges = 0;
+    bool accept = true;
+    std::vector<Sent> sent;
+
+    void setChannel(uint8_t ch) override {
+        channel = ch;
+        channelChanges++;
+    }
+    bool transmit(const uint8_t *frame, size_t len) override {
+        CHECK_EQ(len, DEAUTH_FRAME_LEN);
+        if (!accept) return false;
+        Sent s = {channel, now, {}};
+        memcpy(s.frame, frame, DEAUTH_FRAME_LEN);
+        sent.push_back(s);
+        return true;
+    }
+};
+
+static const uint8_t broadcast[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+static const uint8_t ap1[6] = {0x02, 0x11, 0x11, 0x11, 0x11, 0x11};
+static const uint8_t ap2[6] = {0x02, 0x22, 0x22, 0x22, 0x22, 0x22};
+static const uint8_t sta1[6] = {0x0A, 0x01, 0x02, 0x03, 0x04, 0x05};
+static const uint8_t sta2[6] = {0x0A, 0x06, 0x07, 0x08, 0x09, 0x0A};
+
+// Runs the scheduler every stepUs from the sink's current time for durationUs
+static void runFor(DeauthScheduler &s, MockSink &sink, uint32_t durationUs, uint32_t stepUs = 100) {
+    uint32_t end = sink.now + durationUs;
+    for (; (int32_t)(end - sink.now) > 0; sink.now += stepUs) s.run(sink.now);
+}
+
+static bool sameMac(const uint8_t *a, const uint8_t *b) { return memcmp(a, b, 6) == 0; }
+
+static void testFrames() {
+    MockSink sink;
+    DeauthScheduler s(sink);
+    s.addTarget(sta1, ap1, 6);
+    s.addTarget(broadcast, ap2, 6);
+    CHECK_EQ(s.size(), 2);
+    CHECK_EQ(s.target(0).frameCount, 4);
+    CHECK_EQ(s.target(1).frameCount, 2);
+    CHECK_EQ(s.target(0).rate, DEAUTH_DEFAULT_RATE);
+
+    // A station gets deauth and disassoc both ways, in that order
+    const DeauthTarget &t = s.target(0);
+    const uint8_t subtypes[4] = {0xc0, 0xa0, 0xc0, 0xa0};
+    const uint8_t *dst[4] = {sta1, sta1, ap1, ap1};
+    const uint8_t *src[4] = {ap1, ap1, sta1, sta1};
+    for (int i = 0; i < 4; i++) {
+        CHECK_EQ(t.frames[i][0], subtypes[i]);
+        CHECK(sameMac(&t.frames[i][4], dst[i]));
+        CHECK(sameMac(&t.frames[i][10], src[i]));
+        CHECK(sameMac(&t.frames[i][16], ap1));
+        CHECK_EQ(t.frames[i][24], 0x02); // reason 2
+    }
+    // A broadcast target only has the AP side
+    CHECK(sameMac(&s.target(1).frames[0][4], broadcast));
+    CHECK(sameMac(&s.target(1).frames[1][10], ap2));
+
+    // The frames go out in rotation, and a default target gets its default rate
+    runFor(s, sink, 2000000);
+    std::vector<int> order;
+    for (const auto &f : sink.sent) {
+        if (!sameMac(&f.frame[16], ap1)) continue;
+        int fromAp = sameMac(&f.frame[10], ap1) ? 0 : 2;
+        order.push_back(fromAp + (f.frame[0] == 0xa0));
+    }
+    CHECK(order.size() > 8);
+    for (size_t i = 0; i < order.size(); i++) CHECK_EQ(order[i], i % 4);
+    CHECK(abs(s.target(0).fps - DEAUTH_DEFAULT_RATE) <= 1); // the period is rounded down to whole us
+}
+
+static void testPacing() {
+    MockSink sink;
+    DeauthScheduler s(sink);
+    s.addTarget(sta1, ap1, 1, 100);
+    s.addTarget(sta2, ap1, 1, 25);
+    s.addTarget(broadcast, ap1, 1, 0); // a zero rate still sends, at 1/s
+
+    runFor(s, sink, 4000000);
+    CHECK_EQ(s.target(0).sent, 400);
+    CHECK_EQ(s.target(1).sent, 100);
+    CHECK_EQ(s.target(2).sent, 4);
+    CHECK_EQ(s.target(0).fps, 100);
+    CHECK_EQ(s.target(1).fps, 25);
+    CHECK_EQ(s.totalSent(), 504);
+    CHECK_EQ(s.totalFps(), 126);
+    CHECK_EQ(sink.channelChanges, 1); // one group, the channel is set once
+
+    // Frames of one target are a period apart
+    uint32_t last = 0;
+    bool first = true, even = true;
+    for (const auto &f : sink.sent) {
+        if (!sameMac(&f.frame[4], sta1) && !sameMac(&f.frame[10], sta1)) continue;
+        if (!first && f.time - last != 10000) even = false;
+        first = false;
+        last = f.time;
+    }
+    CHECK(even);
+}
+
+static void testNoCatchUpBurst() {
+    MockSink sink;
+    DeauthScheduler s(sink);
+    s.addTarget(sta1, ap1, 1, 1000);
+    runFor(s, sink, 10000);
+    size_t before = sink.sent.size();
+    // The caller stalls for 50 ms: one frame when it comes back, then the normal pace
+    sink.now += 50000;
+    s.run(sink.now);
+    s.run(sink.now);
+    CHECK_EQ(sink.sent.size(), before + 1);
+    runFor(s, sink, 10000);
+    CHECK(sink.sent.size() <= before + 11);
+}
+
+static void testChannelGroups() {
+    MockSink sink;
+    DeauthScheduler s(sink);
+    // Added out of order, grouped by channel
+    s.addTarget(broadcast, ap2, 11, 200);
+    s.addTarget(broadcast, ap1, 1, 200);
+    s.addTarget(sta1, ap2, 11, 200);
+    CHECK_EQ(s.groups(), 2);
+    CHECK_EQ(s.target(0).channel, 1);
+    CHECK_EQ(s.target(1).channel, 11);
+    CHECK_EQ(s.target(2).channel, 11);
+
+    runFor(s, sink, 2000000);
+    // DEAUTH_CHANNEL_DWELL_MS on each group in turn
+    CHECK_EQ(sink.channelChanges, 2000 / DEAUTH_CHANNEL_DWELL_MS);
+    // Every frame went out on its target's channel
+    bool onChannel = true;
+    for (const auto &f : sink.sent) {
+        uint8_t expected = sameMac(&f.frame[16], ap1) ? 1 : 11;
+        if (f.channel != expected) onChannel = false;
+    }
+    CHECK(onChannel);
+    // Each target only runs half the time
+    for (size_t i = 0; i < s.size(); i++) {
+        CHECK(s.target(i).sent >= 190);
+        CHECK(s.target(i).sent <= 210);
+    }
+
+    // Adding a target restarts on the first group
+    s.addTarget(sta2, ap1, 6);
+    CHECK_EQ(s.groups(), 3);
+    s.run(sink.now);
+    CHECK_EQ(sink.channel, 1);
+    s.clear();
+    CHECK_EQ(s.size(), 0);
+    CHECK_EQ(s.run(sink.now), 0);
+    CHECK_EQ(s.channel(), 0);
+}
+
+static void testSinkFailures() {
+    MockSink sink;
+    DeauthScheduler s(sink);
+    s.addTarget(sta1, ap1, 1, 100);
+    sink.accept = false;
+    runFor(s, sink, 1000000);
+    CHECK_EQ(s.target(0).sent, 0);
+    CHECK_EQ(s.target(0).failed, 100);
+    CHECK_EQ(s.target(0).fps, 0);
+}
+
+static void testClockWrap() {
+    // micros() wraps every 71 minutes, pacing must not stall or burst across it
+    MockSink sink;
+    DeauthScheduler s(sink);
+    s.addTarget(sta1, ap1, 1, 100);
+    sink.now = UINT32_MAX - 500000;
+    runFor(s, sink, 1000000);
+    CHECK_EQ(s.target(0).sent, 100);
+}
+
+int main() {
+    testFrames();
+    testPacing();
+    testNoCatchUpBurst();
+    testChannelGroups();
+    testSinkFailures();
+    testClockWrap();
+    return testResult("deauth_scheduler");
+}
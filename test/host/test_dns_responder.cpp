@@ -0,0 +1,218 @@
+// dns_responder: the socket loop on a loopback port, answers for the portal's override and catch-all
+// records, NXDOMAIN, TTLs and the batched recvfrom
+
+#include "test.h"
+#include <arpa/inet.h>
+#include <core/wifi/dns_responder.h>
+#include <netinet/in.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <vector>
+
+typedef std::vector<uint8_t> Bytes;
+
+static DnsResponder dns;
+static uint16_t port;
+static int client = -1;
+
+static const uint8_t portalIp[4] = {192, 168, 4, 1};
+static const uint8_t loginIp[4] = {10, 0, 0, 5};
+static const uint8_t adsIp[4] = {10, 0, 0, 6};
+
+static Bytes query(uint16_t id, const char *name, uint16_t type, uint16_t flags = 0x0100) {
+    Bytes q = {(uint8_t)(id >> 8), (uint8_t)id, (uint8_t)(flags >> 8), (uint8_t)flags, 0, 1};
+    q.resize(12, 0);
+    while (*name) {
+        const char *dot = strchr(name, '.');
+        size_t l = dot ? (size_t)(dot - name) : strlen(name);
+        q.push_back(l);
+        q.insert(q.end(), name, name + l);
+        name += l + (dot ? 1 : 0);
+    }
+    q.push_back(0);
+    q.push_back(type >> 8);
+    q.push_back(type & 0xFF);
+    q.push_back(0);
+    q.push_back(1);
+    return q;
+}
+
+static void send(const Bytes &q) {
+    struct sockaddr_in to;
+    memset(&to, 0, sizeof(to));
+    to.sin_family = AF_INET;
+    to.sin_port = htons(port);
+    to.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    sendto(client, q.data(), q.size(), 0, (struct sockaddr *)&to, sizeof(to));
+}
+
+// Empty when nothing comes back within the client's receive timeout
+static Bytes receive() {
+    uint8_t buf[DNS_RESPONDER_MAX_PACKET];
+    ssize_t n = recv(client, buf, sizeof(buf), 0);
+    return n > 0 ? Bytes(buf, buf + n) : Bytes();
+}
+
+static Bytes ask(const Bytes &q) {
+    send(q);
+    CHECK_EQ(dns.poll(1000), 1);
+    return receive();
+}
+
+static uint16_t be16(const Bytes &b, size_t at) { return (b[at] << 8) | b[at + 1]; }
+
+// Checks the header and the echoed question, returns the offset of the answer
+static size_t checkReply(const Bytes &r, const Bytes &q, uint8_t rcode, uint16_t answers) {
+    CHECK(r.size() >= q.size());
+    if (r.size() < q.size()) return 0;
+    CHECK_EQ(be16(r, 0), be16(q, 0));
+    CHECK_EQ(r[2], 0x85); // QR, AA, RD echoed
+    CHECK_EQ(r[3] & 0x0F, rcode);
+    CHECK_EQ(be16(r, 4), 1);
+    CHECK_EQ(be16(r, 6), answers);
+    CHECK(memcmp(r.data() + 12, q.data() + 12, q.size() - 12) == 0);
+    return q.size();
+}
+
+static void checkA(const char *name, const uint8_t ip[4], uint32_t ttl = 60) {
+    Bytes q = query(0x4242, name, 1);
+    Bytes r = ask(q);
+    size_t at = checkReply(r, q, 0, 1);
+    CHECK_EQ(r.size(), q.size() + 16);
+    if (r.size() != q.size() + 16) return;
+    CHECK_EQ(be16(r, at), 0xC00C);
+    CHECK_EQ(be16(r, at + 2), 1);
+    CHECK_EQ(be16(r, at + 4), 1);
+    CHECK_EQ(((uint32_t)be16(r, at + 6) << 16) | be16(r, at + 8), ttl);
+    CHECK_EQ(be16(r, at + 10), 4);
+    CHECK(memcmp(r.data() + at + 12, ip, 4) == 0);
+}
+
+static bool setUp() {
+    for (port = 15353; port < 15453 && !dns.begin(port); port++) {}
+    CHECK(dns.running());
+    client = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    struct timeval tv = {0, 200000};
+    setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    return dns.running() && client >= 0;
+}
+
+// Records as EvilPortal::startDns() adds them: the dnsOverrides entries, then "*" for the portal
+static void addPortalRecords() {
+    dns.clearRecords();
+    CHECK(dns.addRecord("Login.Example.com.", loginIp));
+    CHECK(dns.addRecord("*.ads.example", adsIp, 300));
+    CHECK(dns.addRecord("*", portalIp));
+    CHECK_EQ(dns.recordCount(), 3);
+}
+
+static void testOverrides() {
+    addPortalRecords();
+    dns.resetStats();
+    checkA("login.example.com", loginIp);
+    checkA("LOGIN.example.COM", loginIp);
+    checkA("x.ads.example", adsIp, 300);
+    checkA("a.b.ads.example", adsIp, 300);
+    checkA("ads.example", portalIp); // the wildcard needs a subdomain
+    checkA("connectivitycheck.gstatic.com", portalIp);
+    checkA("login.example.com.evil", portalIp);
+
+    // AAAA and other types of a known name: NOERROR without answers, so the client asks for A
+    for (uint16_t type : {28, 16, 65}) {
+        Bytes q = query(0x1000 + type, "login.example.com", type);
+        Bytes r = ask(q);
+        checkReply(r, q, 0, 0);
+        CHECK_EQ(r.size(), q.size());
+    }
+    // ANY is answered like A
+    Bytes q = query(7, "x.ads.example", 255);
+    checkReply(ask(q), q, 0, 1);
+
+    const DnsResponderStats &s = dns.stats();
+    CHECK_EQ(s.queries, 11);
+    CHECK_EQ(s.answered, 8);
+    CHECK_EQ(s.nxdomain, 0);
+    CHECK_EQ(s.batches, 11);
+    CHECK(s.minUs <= s.avgUs() && s.avgUs() <= s.maxUs);
+}
+
+static void testNxdomain() {
+    // Without the catch-all only the overrides resolve, the rest gets NXDOMAIN
+    dns.clearRecords();
+    dns.addRecord("login.example.com", loginIp);
+    dns.resetStats();
+    checkA("login.example.com", loginIp);
+    for (uint16_t type : {1, 28}) {
+        Bytes q = query(9, "example.com", type);
+        Bytes r = ask(q);
+        checkReply(r, q, 3, 0);
+        CHECK_EQ(r.size(), q.size());
+    }
+    CHECK_EQ(dns.stats().nxdomain, 2);
+
+    // Another opcode gets NOTIMP, the header alone
+    Bytes q = query(10, "login.example.com", 1, 0x1100); // opcode 2 (status)
+    Bytes r = ask(q);
+    CHECK_EQ(r.size(), 12);
+    if (r.size() == 12) CHECK_EQ(r[3] & 0x0F, 4);
+}
+
+static void testDropped() {
+    addPortalRecords();
+    dns.resetStats();
+    // A response, a compressed question name, two questions and a runt: no reply to any of them
+    Bytes response = query(1, "login.example.com", 1, 0x8000);
+    Bytes compressed = query(2, "a", 1);
+    compressed[12] = 0xC0;
+    compressed[13] = 0x0C;
+    Bytes twoQuestions = query(3, "a", 1);
+    twoQuestions[5] = 2;
+    Bytes runt = {0x00, 0x04, 0x01};
+    for (const Bytes *q : {&response, &compressed, &twoQuestions, &runt}) {
+        send(*q);
+        CHECK_EQ(dns.poll(1000), 1);
+        CHECK(receive().empty());
+    }
+    CHECK_EQ(dns.stats().malformed, 3);
+    CHECK_EQ(dns.stats().queries, 0);
+    CHECK_EQ(dns.poll(10), 0); // nothing queued
+}
+
+// A burst bigger than one batch: the first poll drains DNS_RESPONDER_BATCH, the next one the rest
+static void testBatch() {
+    addPortalRecords();
+    dns.resetStats();
+    const int burst = DNS_RESPONDER_BATCH + 4;
+    for (int i = 0; i < burst; i++) {
+        send(query(0x100 + i, i % 2 ? "login.example.com" : "captive.apple.com", 1));
+    }
+    CHECK_EQ(dns.poll(1000), DNS_RESPONDER_BATCH);
+    CHECK_EQ(dns.poll(1000), burst - DNS_RESPONDER_BATCH);
+    CHECK_EQ(dns.stats().batches, 2);
+
+    int got = 0;
+    bool inOrder = true;
+    for (Bytes r = receive(); !r.empty(); r = receive()) {
+        if (r.size() < 2 || be16(r, 0) != 0x100 + got) inOrder = false;
+        else if (memcmp(r.data() + r.size() - 4, got % 2 ? loginIp : portalIp, 4) != 0) inOrder = false;
+        got++;
+    }
+    CHECK_EQ(got, burst);
+    CHECK(inOrder);
+    CHECK_EQ(dns.stats().answered, burst);
+}
+
+int main() {
+    if (setUp()) {
+        testOverrides();
+        testNxdomain();
+        testDropped();
+        testBatch();
+    }
+    dns.end();
+    CHECK(!dns.running());
+    if (client >= 0) close(client);
+    return testResult("dns_responder");
+}
@@ -0,0 +1,211 @@
+// emv: recorded card transcripts through the session, mutated responses and random TLV
+
+#include "test.h"
+#include <modules/rfid/emv_session.h>
+#include <random>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+typedef std::vector<uint8_t> Bytes;
+
+static Bytes hex(const char *s) {
+    Bytes b;
+    while (*s) {
+        if (*s == ' ') {
+            s++;
+            continue;
+        }
+        unsigned v;
+        sscanf(s, "%2x", &v);
+        b.push_back(v);
+        s += 2;
+    }
+    return b;
+}
+
+// Plays back a transcript: each command must match the recorded one, the recorded response comes back
+class Replay : public EmvTransport {
+public:
+    std::vector<std::pair<Bytes, Bytes>> apdus;
+    size_t next = 0;
+    bool strict = true;
+
+    void add(const char *cmd, const char *resp) { apdus.push_back({hex(cmd), hex(resp)}); }
+
+    bool transceive(const uint8_t *cmd, size_t len, uint8_t *resp, size_t &respLen) override {
+        if (next >= apdus.size()) return false; // card gone
+        const auto &apdu = apdus[next++];
+        if (strict) CHECK(apdu.first.size() == len && memcmp(apdu.first.data(), cmd, len) == 0);
+        if (apdu.second.size() > respLen) return false;
+        memcpy(resp, apdu.second.data(), apdu.second.size());
+        respLen = apdu.second.size();
+        return true;
+    }
+};
+
+static uint32_t fakeClock() {
+    static uint32_t t = 0;
+    return t += 1000;
+}
+
+static const char *ppse = "00A404000E325041592E5359532E444446303100";
+
+// Visa: PPSE with one application, PDOL asking for TTQ, amount, unpredictable number and country,
+// GPO format 2 with track 2 and the name, so no records are read
+static Replay visa() {
+    Replay r;
+    r.add(ppse, "6F29840E325041592E5359532E4444463031A517BF0C1461124F07A00000000310105004564953418701019000");
+    r.add(
+        "00A4040007A000000003101000",
+        "6F208407A0000000031010A5155004564953419F380C9F66049F02069F37049F1A029000"
+    );
+    r.add(
+        "80A8000012 8310 36004000 000000000000 78563412 0840 00",
+        "77208202200057114761739001010010D2512201123400001F5F20064A4F484E20209000"
+    );
+    return r;
+}
+
+// MasterCard: no PPSE so the known AIDs are tried, 61xx on select, GPO format 1 and two AFL records
+static Replay mastercard() {
+    Replay r;
+    r.add(ppse, "6A82");
+    r.add("00A4040007A000000004101000", "6119");
+    r.add("00C0000019", "6F178407A0000000041010A50C500A4D4153544552434152449000");
+    r.add("80A800000283 0000", "80061980080102009000");
+    r.add("00B2010C00", "700B9F6C0200018C04010203049000");
+    r.add("00B2020C00", "70215A0854133300890100045F24032612315F25032101015F2008444F452F4A414E459000");
+    return r;
+}
+
+static void testVisa() {
+    Replay r = visa();
+    EmvSession s(r, fakeClock);
+    s.unpredictable = 0x12345678;
+    EMVCard card;
+    CHECK_EQ(s.read(card), EMV_OK);
+    CHECK_EQ(r.next, r.apdus.size());
+    CHECK_EQ(card.vendor, EMV_VISA);
+    CHECK(strcmp(card.label, "VISA") == 0);
+    CHECK(strcmp(card.pan, "4761739001010010") == 0);
+    CHECK(strcmp(card.validto, "12/25") == 0);
+    CHECK(strcmp(card.holder, "JOHN") == 0);
+    CHECK_EQ(card.records, 0);
+    CHECK_EQ(s.times().apdus, 3);
+    CHECK(s.times().total > 0);
+}
+
+static void testMastercard() {
+    Replay r = mastercard();
+    EmvSession s(r, fakeClock);
+    EMVCard card;
+    CHECK_EQ(s.read(card), EMV_OK);
+    CHECK_EQ(r.next, r.apdus.size());
+    CHECK_EQ(card.vendor, EMV_MASTERCARD);
+    CHECK(strcmp(card.label, "MASTERCARD") == 0);
+    CHECK(strcmp(card.pan, "5413330089010004") == 0);
+    CHECK(strcmp(card.validfrom, "01/21") == 0);
+    CHECK(strcmp(card.validto, "12/26") == 0);
+    CHECK(strcmp(card.holder, "DOE/JANE") == 0);
+    CHECK_EQ(card.records, 2);
+    CHECK_EQ(s.times().apdus, 6);
+}
+
+static void testDate() {
+    // A PDOL with only the transaction date: the default until the caller sets it, then BCD YYMMDD
+    const char *select = "6F168407A0000000041010A50B5004544553549F38029A039000";
+    const char *gpo = "77208202200057114761739001010010D2512201123400001F5F20064A4F484E20209000";
+    Replay r;
+    r.add(ppse, "6A82");
+    r.add("00A4040007A000000004101000", select);
+    r.add("80A8000005 8303 250101 00", gpo);
+    EmvSession s(r);
+    EMVCard card;
+    CHECK_EQ(s.read(card), EMV_OK);
+
+    r.next = 0;
+    r.apdus[2].first = hex("80A8000005 8303 261017 00");
+    s.setDate(2026, 10, 17);
+    CHECK_EQ(s.read(card), EMV_OK);
+    CHECK_EQ(r.next, r.apdus.size());
+}
+
+static void testNoCard() {
+    Replay r;
+    EmvSession s(r);
+    EMVCard card;
+    CHECK_EQ(s.read(card), EMV_NO_CARD);
+    CHECK(!card.parsed);
+}
+
+// Bit flips, truncated and padded responses: every read must end without touching memory it shouldn't
+// (ASan) and with the card strings terminated
+static void testMutatedResponses() {
+    std::mt19937 rng(1);
+    const Replay cards[2] = {visa(), mastercard()};
+    for (int i = 0; i < 100000; i++) {
+        Replay r = cards[i & 1];
+        r.strict = false;
+        for (auto &apdu : r.apdus) {
+            Bytes &resp = apdu.second;
+            int flips = rng() % 4;
+            for (int k = 0; k < flips && !resp.empty(); k++) resp[rng() % resp.size()] ^= 1 << (rng() % 8);
+            if (rng() % 8 == 0) resp.resize(rng() % (resp.size() + 1));
+            if (rng() % 16 == 0) {
+                size_t extra = rng() % 300;
+                for (size_t k = 0; k < extra; k++) resp.push_back(rng());
+            }
+        }
+        EmvSession s(r);
+        EMVCard card;
+        s.read(card);
+        if (strlen(card.pan) >= sizeof(card.pan) || strlen(card.holder) >= sizeof(card.holder) ||
+            strlen(card.label) >= sizeof(card.label)) {
+            CHECK(false);
+            break;
+        }
+    }
+}
+
+static void countValue(const Tlv &tlv, void *ctx) {
+    size_t *total = (size_t *)ctx;
+    for (size_t i = 0; i < tlv.len; i++) *total += tlv.value[i] & 1; // reads every byte under ASan
+}
+
+// Random buffers weighted towards template tags and long lengths, each one in an exact-size allocation
+static void testTlvFuzz() {
+    std::mt19937 rng(7);
+    size_t total = 0;
+    for (int i = 0; i < 500000; i++) {
+        size_t n = rng() % 64;
+        uint8_t *buf = new uint8_t[n];
+        for (size_t k = 0; k < n; k++) {
+            switch (rng() % 6) {
+                case 0: buf[k] = 0x6F; break;
+                case 1: buf[k] = 0x81; break;
+                case 2: buf[k] = 0x9F; break;
+                default: buf[k] = rng();
+            }
+        }
+        tlvWalk(buf, n, countValue, &total);
+        Tlv tlv;
+        if (tlvFind(buf, n, 0x5A, tlv)) CHECK(tlv.value >= buf && tlv.value + tlv.len <= buf + n);
+        DolReader dol(buf, n);
+        uint32_t tag;
+        size_t len;
+        while (dol.next(tag, len)) {}
+        delete[] buf;
+    }
+    CHECK(total > 0);
+}
+
+int main() {
+    testVisa();
+    testMastercard();
+    testDate();
+    testNoCard();
+    testMutatedResponses();
+    testTlvFuzz();
+    return testResult("emv");
+}
@@ -0,0 +1,152 @@
+// FlowTable: 5-tuples from frames, both directions on one entry, the top list and eviction of the
+// flow idle the longest once the table is full
+
+#include "test.h"
+#include <modules/ethernet/FlowTable.h>
+#include <string.h>
+
+static FlowTable table;
+
+static size_t ipv4Frame(
+    uint8_t *f, const uint8_t src[4], const uint8_t dst[4], uint8_t proto, uint16_t sport, uint16_t dport
+) {
+    memset(f, 0, 64);
+    f[12] = 0x08;
+    f[14] = 0x45;
+    f[23] = proto;
+    memcpy(f + 26, src, 4);
+    memcpy(f + 30, dst, 4);
+    f[34] = sport >> 8;
+    f[35] = sport & 0xFF;
+    f[36] = dport >> 8;
+    f[37] = dport & 0xFF;
+    return 64;
+}
+
+static FlowKey flow(int n) {
+    FlowKey k;
+    memset(&k, 0, sizeof(k));
+    const uint8_t a[4] = {10, 0, 0, 2}, b[4] = {93, 184, (uint8_t)(n >> 8), (uint8_t)n};
+    memcpy(k.ipA, a, 4);
+    memcpy(k.ipB, b, 4);
+    k.portA = 40000 + n;
+    k.portB = 443;
+    k.proto = 6;
+    return k;
+}
+
+static bool sameKey(const FlowKey &a, const FlowKey &b) {
+    return a.proto == b.proto && a.portA == b.portA && a.portB == b.portB && !memcmp(a.ipA, b.ipA, 4) &&
+           !memcmp(a.ipB, b.ipB, 4);
+}
+
+// The entry for `key` from the whole table, null when it isn't there
+static const FlowEntry *find(const FlowKey &key) {
+    static FlowEntry all[FLOW_TABLE_SIZE];
+    size_t n = table.top(all, FLOW_TABLE_SIZE);
+    for (size_t i = 0; i < n; i++) {
+        if (sameKey(all[i].key, key)) return &all[i];
+    }
+    return nullptr;
+}
+
+static void testParse() {
+    const uint8_t client[4] = {192, 168, 1, 20}, server[4] = {142, 250, 1, 1};
+    uint8_t f[64];
+    FlowKey out, in;
+    CHECK(FlowTable::parse(f, ipv4Frame(f, client, server, 6, 51000, 443), out));
+    CHECK(FlowTable::parse(f, ipv4Frame(f, server, client, 6, 443, 51000), in));
+    CHECK(sameKey(out, in));
+    CHECK(memcmp(out.ipA, server, 4) == 0);
+    CHECK_EQ(out.portA, 443);
+    CHECK_EQ(out.portB, 51000);
+
+    // A later fragment has no ports, ICMP neither; ARP and short frames are not IPv4 flows
+    ipv4Frame(f, client, server, 17, 5353, 53);
+    f[21] = 0x10;
+    CHECK(FlowTable::parse(f, 64, out));
+    CHECK_EQ(out.portA | out.portB, 0);
+    CHECK(FlowTable::parse(f, ipv4Frame(f, client, server, 1, 0x0800, 1), out));
+    CHECK_EQ(out.portA | out.portB, 0);
+    f[13] = 0x06;
+    CHECK(!FlowTable::parse(f, 64, out));
+    CHECK(!FlowTable::parse(f, 33, out));
+}
+
+static void testCounting() {
+    table.clear();
+    CHECK(table.update(flow(1), 100, 0));
+    CHECK(table.update(flow(2), 1500, 0));
+    CHECK(table.update(flow(1), 60, 10));
+    CHECK_EQ(table.size(), 2);
+    const FlowEntry *e = find(flow(1));
+    CHECK(e != nullptr);
+    if (e) {
+        CHECK_EQ(e->packets, 2);
+        CHECK_EQ(e->bytes, 160);
+        CHECK_EQ(e->lastSeen, 10);
+    }
+
+    FlowEntry top[2];
+    CHECK_EQ(table.top(top, 2), 2);
+    CHECK(sameKey(top[0].key, flow(2)));
+    CHECK(sameKey(top[1].key, flow(1)));
+}
+
+// A full table keeps taking new flows: each one replaces the flow seen least recently
+static void testEviction() {
+    table.clear();
+    uint32_t t = UINT32_MAX - 20; // across the millis() wrap
+    for (int i = 0; i < FLOW_TABLE_SIZE; i++) CHECK(table.update(flow(i), 1000, t + i));
+    CHECK_EQ(table.size(), FLOW_TABLE_SIZE);
+    CHECK_EQ(table.evicted(), 0);
+
+    // Flow 0 is busy again, flow 1 is now the oldest
+    t += FLOW_TABLE_SIZE;
+    CHECK(table.update(flow(0), 1000, t));
+    CHECK(!table.update(flow(100), 40, t + 1));
+    CHECK_EQ(table.size(), FLOW_TABLE_SIZE);
+    CHECK_EQ(table.evicted(), 1);
+    CHECK(find(flow(1)) == nullptr);
+    CHECK(find(flow(0)) != nullptr);
+    const FlowEntry *e = find(flow(100));
+    CHECK(e != nullptr);
+    if (e) {
+        CHECK_EQ(e->packets, 1);
+        CHECK_EQ(e->bytes, 40);
+    }
+    // and is found again rather than taking another slot
+    CHECK(table.update(flow(100), 40, t + 2));
+    CHECK_EQ(table.evicted(), 1);
+    e = find(flow(100));
+    CHECK(e && e->bytes == 80);
+
+    // A long run of new flows: every one is in the table right after its packet, the busy flow stays
+    bool allFound = true, busyKept = true;
+    for (int i = 200; i < 1200; i++) {
+        t += 2;
+        table.update(flow(i), 100, t);
+        table.update(flow(0), 100, t + 1);
+        if (!find(flow(i))) allFound = false;
+        if (!find(flow(0))) busyKept = false;
+    }
+    CHECK(allFound);
+    CHECK(busyKept);
+    CHECK_EQ(table.size(), FLOW_TABLE_SIZE);
+    CHECK_EQ(table.evicted(), 1001);
+    // The last 63 new flows are what is left besides the busy one
+    int recent = 0;
+    for (int i = 1200 - (FLOW_TABLE_SIZE - 1); i < 1200; i++) recent += find(flow(i)) != nullptr;
+    CHECK_EQ(recent, FLOW_TABLE_SIZE - 1);
+
+    table.clear();
+    CHECK_EQ(table.size(), 0);
+    CHECK_EQ(table.evicted(), 0);
+}
+
+int main() {
+    testParse();
+    testCounting();
+    testEviction();
+    return testResult("flow_table");
+}
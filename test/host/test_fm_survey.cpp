@@ -0,0 +1,117 @@
+// fm_survey: the channel grid, sweeps over a synthetic band, the level table and the ranking
+
+#include "test.h"
+#include <algorithm>
+#include <modules/fm/fm_survey.h>
+#include <stdlib.h>
+
+static FmSurvey survey;
+
+// Noise at 20 dBuV (21 on every 7th channel), stations at 88.1 and 101.5 MHz and one at 95.0 MHz that
+// is only on the air during the second sweep. A station leaks 15 dB less per 100 kHz up to 200 kHz.
+static uint8_t band(uint16_t f, int sweep) {
+    int level = 20 + (f % 7 == 0);
+    auto station = [&](uint16_t at, int power) {
+        int d = abs((int)f - (int)at) / FM_SURVEY_STEP;
+        if (d <= 2) level = std::max(level, power - 15 * d);
+    };
+    station(8810, 60);
+    if (sweep == 1) station(9500, 55);
+    station(10150, 50);
+    return level;
+}
+
+static void testGrid() {
+    CHECK_EQ(FM_SURVEY_CHANNELS, 206);
+    CHECK_EQ(FmSurvey::frequency(0), 8750);
+    CHECK_EQ(FmSurvey::frequency(205), 10800);
+    CHECK_EQ(FmSurvey::index(8750), 0);
+    CHECK_EQ(FmSurvey::index(10800), 205);
+    // Off the grid, below and above the band
+    CHECK_EQ(FmSurvey::index(10805), FM_SURVEY_CHANNELS);
+    CHECK_EQ(FmSurvey::index(8740), FM_SURVEY_CHANNELS);
+    CHECK_EQ(FmSurvey::index(10810), FM_SURVEY_CHANNELS);
+    for (uint8_t i = 0; i < FM_SURVEY_CHANNELS; i++) CHECK_EQ(FmSurvey::index(FmSurvey::frequency(i)), i);
+}
+
+static void testSweeps() {
+    survey.reset();
+    uint16_t ranked[5];
+    CHECK_EQ(survey.rank(ranked, 5), 0); // nothing measured yet
+    CHECK_EQ(survey.score(0), 0xFFFF);
+
+    // Three sweeps, 40 ms per channel
+    uint32_t t = 0;
+    bool inOrder = true, doneAtEnd = true;
+    for (int sweep = 0; sweep < 3; sweep++) {
+        for (int i = 0; i < FM_SURVEY_CHANNELS; i++) {
+            uint16_t f = survey.next(t);
+            if (f != FmSurvey::frequency(i)) inOrder = false;
+            t += 40;
+            if (survey.record(band(f, sweep), t) != (i == FM_SURVEY_CHANNELS - 1)) doneAtEnd = false;
+        }
+    }
+    CHECK(inOrder);
+    CHECK(doneAtEnd);
+    CHECK_EQ(survey.sweeps(), 3);
+    CHECK_EQ(survey.sweepMs(), FM_SURVEY_CHANNELS * 40);
+    CHECK_EQ(survey.position(), 0);
+
+    // The intermittent station: last reading back at the floor, peak-hold and average remember it
+    const FmChannel &c = survey.channel(FmSurvey::index(9500));
+    CHECK_EQ(c.samples, 3);
+    CHECK_EQ(c.level, 20);
+    CHECK_EQ(c.floor, 20);
+    CHECK_EQ(c.peak, 55);
+    CHECK_EQ(c.average(), (20 + 55 + 20) / 3);
+    const FmChannel &strong = survey.channel(FmSurvey::index(8810));
+    CHECK_EQ(strong.floor, 60);
+
+    // The clearest channels stay away from every station and its neighbours, even the one that went
+    // off the air, and from the slightly noisier channels
+    uint8_t n = survey.rank(ranked, 5);
+    CHECK_EQ(n, 5);
+    for (uint8_t i = 0; i < n; i++) {
+        CHECK(abs(ranked[i] - 8810) > 30);
+        CHECK(abs(ranked[i] - 9500) > 30);
+        CHECK(abs(ranked[i] - 10150) > 30);
+        CHECK(ranked[i] % 7 != 0);
+        if (i == 0) continue;
+        CHECK(survey.score(FmSurvey::index(ranked[i - 1])) <= survey.score(FmSurvey::index(ranked[i])));
+    }
+    // A station scores worse than a free channel, and so do its neighbours
+    uint16_t clearest = survey.score(FmSurvey::index(ranked[0]));
+    CHECK(survey.score(FmSurvey::index(8810)) > clearest);
+    CHECK(survey.score(FmSurvey::index(8820)) > clearest);
+    CHECK(survey.score(FmSurvey::index(9510)) > clearest);
+}
+
+static void testDirty() {
+    // Everything changed since the sweeps, then nothing until a channel is measured again
+    int dirty = 0;
+    for (int i = 0; i < FM_SURVEY_CHANNELS; i++) dirty += survey.takeDirty(i);
+    CHECK_EQ(dirty, FM_SURVEY_CHANNELS);
+    dirty = 0;
+    for (int i = 0; i < FM_SURVEY_CHANNELS; i++) dirty += survey.takeDirty(i);
+    CHECK_EQ(dirty, 0);
+
+    survey.next(0);
+    survey.record(1, 40);
+    CHECK(survey.takeDirty(0));
+    CHECK(!survey.takeDirty(1));
+    CHECK_EQ(survey.channel(0).floor, 1);
+    CHECK_EQ(survey.position(), 1);
+
+    // reset() forgets the table and marks every column for a redraw
+    survey.reset();
+    CHECK_EQ(survey.channel(0).samples, 0);
+    CHECK_EQ(survey.sweeps(), 0);
+    CHECK(survey.takeDirty(FM_SURVEY_CHANNELS - 1));
+}
+
+int main() {
+    testGrid();
+    testSweeps();
+    testDirty();
+    return testResult("fm_survey");
+}
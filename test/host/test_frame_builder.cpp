@@ -0,0 +1,191 @@
+// FrameBuilder: fixed layouts of the ARP, DHCP discover and flood frames, incremental checksums
+// against a full recompute
+
+#include "test.h"
+#include <modules/ethernet/FrameBuilder.h>
+#include <random>
+#include <string.h>
+
+using namespace frames;
+
+static std::mt19937 rng(1);
+
+static const uint8_t macA[6] = {0x02, 0x11, 0x22, 0x33, 0x44, 0x55};
+static const uint8_t macB[6] = {0x0A, 0xAA, 0xBB, 0xCC, 0xDD, 0xEE};
+static const uint8_t ipA[4] = {192, 168, 1, 1};
+static const uint8_t ipB[4] = {192, 168, 1, 23};
+
+static void randomMac(uint8_t *mac) {
+    for (int i = 0; i < 6; i++) mac[i] = rng();
+}
+
+static uint16_t ipChecksum(const uint8_t *frame) {
+    uint8_t header[IP4_HLEN];
+    memcpy(header, frame + ETH_HLEN, IP4_HLEN);
+    put16(header + 10, 0);
+    return checksum(header, IP4_HLEN);
+}
+
+static void testChecksum() {
+    // RFC 1071 example: 00 01 f2 03 f4 f5 f6 f7 sums to ddf2
+    const uint8_t data[] = {0x00, 0x01, 0xf2, 0x03, 0xf4, 0xf5, 0xf6, 0xf7};
+    CHECK_EQ(checksum(data, sizeof(data)), (uint16_t)~0xddf2);
+    // An odd byte is padded, chaining partial sums gives the same result
+    const uint8_t odd[] = {0x12, 0x34, 0x56};
+    CHECK_EQ(checksum(odd, 3), (uint16_t)~(0x1234 + 0x5600));
+    CHECK_EQ(checksum(data + 4, 4, 0x0001 + 0xf203), checksum(data, 8));
+}
+
+static void testArp() {
+    uint8_t frame[ARP_FRAME_LEN];
+    CHECK_EQ(buildArpReply(frame, sizeof(frame) - 1, macA, ipA, macB, ipB), 0);
+    CHECK_EQ(buildArpReply(frame, sizeof(frame), macA, ipA, macB, ipB), 42);
+    const uint8_t expected[42] = {
+        0x0A, 0xAA, 0xBB, 0xCC, 0xDD, 0xEE, 0x02, 0x11, 0x22, 0x33, 0x44, 0x55, 0x08, 0x06, // Ethernet
+        0x00, 0x01, 0x08, 0x00, 6,    4,    0x00, 0x02,                                     // reply
+        0x02, 0x11, 0x22, 0x33, 0x44, 0x55, 192,  168,  1,    1,                            // sender
+        0x0A, 0xAA, 0xBB, 0xCC, 0xDD, 0xEE, 192,  168,  1,    23,                           // target
+    };
+    CHECK(memcmp(frame, expected, sizeof(expected)) == 0);
+
+    // The setters keep the Ethernet and ARP addresses together
+    setArpSender(frame, macB, ipB);
+    setArpTarget(frame, macA, ipA);
+    CHECK(memcmp(frame + ETH_SRC, macB, 6) == 0);
+    CHECK(memcmp(frame + ETH_HLEN + 8, macB, 6) == 0);
+    CHECK(memcmp(frame + ETH_HLEN + 14, ipB, 4) == 0);
+    CHECK(memcmp(frame + ETH_DST, macA, 6) == 0);
+    CHECK(memcmp(frame + ETH_HLEN + 18, macA, 6) == 0);
+    CHECK(memcmp(frame + ETH_HLEN + 24, ipA, 4) == 0);
+}
+
+static void testDhcpDiscover() {
+    uint8_t frame[DHCP_DISCOVER_LEN];
+    CHECK_EQ(buildDhcpDiscover(frame, sizeof(frame) - 1, macA, 1), 0);
+    CHECK_EQ(buildDhcpDiscover(frame, sizeof(frame), macA, 0x12345678), 286);
+
+    const uint8_t ethernet[14] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x02, 0x11,
+                                  0x22, 0x33, 0x44, 0x55, 0x08, 0x00};
+    CHECK(memcmp(frame, ethernet, 14) == 0);
+    // 272 bytes from 0.0.0.0 to the broadcast address, TTL 16, UDP
+    const uint8_t ip[20] = {0x45, 0x10, 0x01, 0x10, 0, 0, 0, 0, 16, 17,
+                            0,    0,    0,    0,    0, 0, 0xFF, 0xFF, 0xFF, 0xFF};
+    CHECK(memcmp(frame + 14, ip, 10) == 0);
+    CHECK(memcmp(frame + 26, ip + 12, 8) == 0);
+    CHECK_EQ(get16(frame + IP4_CSUM), ipChecksum(frame));
+    CHECK_EQ(checksum(frame + ETH_HLEN, IP4_HLEN), 0); // a valid header sums to zero
+    const uint8_t udp[8] = {0, 68, 0, 67, 0, 0xFC, 0, 0}; // no UDP checksum
+    CHECK(memcmp(frame + 34, udp, 8) == 0);
+
+    const uint8_t *bootp = frame + 42;
+    CHECK_EQ(bootp[0], 1);
+    CHECK_EQ(bootp[1], 1);
+    CHECK_EQ(bootp[2], 6);
+    CHECK_EQ(get16(bootp + 4), 0x1234);
+    CHECK_EQ(get16(bootp + 6), 0x5678);
+    CHECK_EQ(get16(bootp + 10), 0x8000);
+    CHECK(memcmp(bootp + 28, macA, 6) == 0);
+    const uint8_t options[8] = {0x63, 0x82, 0x53, 0x63, 53, 1, 1, 0xFF};
+    CHECK(memcmp(bootp + 236, options, 8) == 0);
+
+    // A new client changes the source, chaddr and xid and nothing else
+    uint8_t before[DHCP_DISCOVER_LEN];
+    memcpy(before, frame, sizeof(before));
+    setDhcpClient(frame, macB, 0xCAFEBABE);
+    CHECK(memcmp(frame + ETH_SRC, macB, 6) == 0);
+    CHECK(memcmp(bootp + 28, macB, 6) == 0);
+    CHECK_EQ(get16(bootp + 4), 0xCAFE);
+    int changed = 0;
+    for (size_t i = 0; i < sizeof(before); i++) changed += frame[i] != before[i];
+    CHECK(changed <= 16);
+    CHECK(memcmp(frame + ETH_HLEN, before + ETH_HLEN, IP4_HLEN + UDP_HLEN) == 0);
+}
+
+// The MAC flooding frames: random addresses on every send, the IP checksum patched in place
+static void testRandomMacFlood() {
+    uint8_t frame[ETH_HLEN + IP4_HLEN + 64];
+    CHECK_EQ(buildIpv4Flood(frame, sizeof(frame) - 1, macA, macB, ipA, ipB, 64), 0);
+    CHECK_EQ(buildIpv4Flood(frame, sizeof(frame), macA, macB, ipA, ipB, 64), sizeof(frame));
+    CHECK(memcmp(frame + ETH_DST, macB, 6) == 0);
+    CHECK(memcmp(frame + ETH_SRC, macA, 6) == 0);
+    CHECK_EQ(get16(frame + ETH_TYPE), ETHTYPE_IPV4);
+    CHECK_EQ(frame[ETH_HLEN], 0x45);
+    CHECK_EQ(get16(frame + ETH_HLEN + 2), IP4_HLEN + 64);
+    CHECK_EQ(frame[ETH_HLEN + 8], 64);
+    CHECK_EQ(frame[ETH_HLEN + 9], 17);
+    CHECK_EQ(get16(frame + IP4_CSUM), ipChecksum(frame));
+
+    int mismatches = 0;
+    for (int i = 0; i < 100000; i++) {
+        uint8_t src[6], dst[6], ip[4];
+        randomMac(src);
+        randomMac(dst);
+        for (auto &b : ip) b = rng();
+        if (i % 1000 == 0) memset(ip, i % 2000 ? 0xFF : 0, 4); // the all-ones and all-zero corners
+        setFloodAddresses(frame, src, dst, ip);
+        if (memcmp(frame + ETH_SRC, src, 6) || memcmp(frame + ETH_DST, dst, 6)) mismatches++;
+        if (memcmp(frame + IP4_SRC, ip, 4)) mismatches++;
+        if (get16(frame + IP4_CSUM) != ipChecksum(frame)) mismatches++;
+    }
+    CHECK_EQ(mismatches, 0);
+}
+
+// UDP: the checksum covers a pseudo header (addresses, protocol, length) and the datagram. Ports,
+// payload words and the source address change incrementally, each must equal a full recompute.
+static uint16_t udpChecksum(const uint8_t *frame, size_t udpLen) {
+    uint8_t pseudo[12];
+    memcpy(pseudo, frame + IP4_SRC, 8);
+    pseudo[8] = 0;
+    pseudo[9] = 17;
+    put16(pseudo + 10, udpLen);
+    uint8_t udp[64];
+    memcpy(udp, frame + ETH_HLEN + IP4_HLEN, udpLen);
+    put16(udp + 6, 0);
+    uint32_t sum = 0;
+    for (int i = 0; i < 12; i += 2) sum += get16(pseudo + i);
+    return checksum(udp, udpLen, sum);
+}
+
+static void testUdpAdjust() {
+    const size_t udpLen = 40;
+    const size_t udpOff = ETH_HLEN + IP4_HLEN;
+    uint8_t frame[ETH_HLEN + IP4_HLEN + udpLen];
+    buildIpv4Flood(frame, sizeof(frame), macA, macB, ipA, ipB, udpLen);
+    put16(frame + udpOff, 1234);
+    put16(frame + udpOff + 2, 53);
+    put16(frame + udpOff + 4, udpLen);
+    for (size_t i = 8; i < udpLen; i++) frame[udpOff + i] = rng();
+    put16(frame + udpOff + 6, udpChecksum(frame, udpLen));
+
+    int ipMismatches = 0, udpMismatches = 0;
+    for (int i = 0; i < 100000; i++) {
+        uint8_t value[4];
+        for (auto &b : value) b = rng();
+        switch (rng() % 3) {
+            case 0: // a port
+                patch(frame, udpOff + 2 * (rng() % 2), value, 2, udpOff + 6);
+                break;
+            case 1: // a payload word
+                patch(frame, udpOff + 8 + 2 * (rng() % ((udpLen - 8) / 2)), value, 2, udpOff + 6);
+                break;
+            default: { // the source address is in both the IP header and the pseudo header
+                uint16_t udpSum = get16(frame + udpOff + 6);
+                put16(frame + udpOff + 6, checksumAdjust(udpSum, frame + IP4_SRC, value, 4));
+                patch(frame, IP4_SRC, value, 4, IP4_CSUM);
+            }
+        }
+        if (get16(frame + IP4_CSUM) != ipChecksum(frame)) ipMismatches++;
+        if (get16(frame + udpOff + 6) != udpChecksum(frame, udpLen)) udpMismatches++;
+    }
+    CHECK_EQ(ipMismatches, 0);
+    CHECK_EQ(udpMismatches, 0);
+}
+
+int main() {
+    testChecksum();
+    testArp();
+    testDhcpDiscover();
+    testRandomMacFlood();
+    testUdpAdjust();
+    return testResult("frame_builder");
+}
@@ -0,0 +1,116 @@
+// input_events: the single producer / single consumer ring between the input task and the UI
+
+#include "test.h"
+#include <core/input_events.h>
+#include <string.h>
+#include <thread>
+
+static void testFillAndDrain() {
+    SpscQueue<uint32_t, 8> q;
+    uint32_t v;
+    CHECK(!q.pop(v));
+    CHECK_EQ(q.size(), 0);
+
+    // One slot stays empty: 7 items fit, the 8th is dropped and the ring is unchanged
+    for (uint32_t i = 0; i < 7; i++) CHECK(q.push(i));
+    CHECK_EQ(q.size(), 7);
+    CHECK(!q.push(100));
+    CHECK(!q.push(101));
+    CHECK_EQ(q.size(), 7);
+    for (uint32_t i = 0; i < 7; i++) {
+        CHECK(q.pop(v));
+        CHECK_EQ(v, i);
+    }
+    CHECK(!q.pop(v));
+    CHECK_EQ(q.size(), 0);
+}
+
+static void testWraparound() {
+    // Head and tail go around the ring many times at every fill level
+    SpscQueue<uint32_t, 8> q;
+    uint32_t produced = 0, consumed = 0, dropped = 0, v;
+    for (int round = 0; round < 1000; round++) {
+        int pushes = round % 10, pops = (round * 7) % 9;
+        for (int k = 0; k < pushes; k++) {
+            if (q.push(produced)) produced++;
+            else dropped++;
+        }
+        CHECK(q.size() <= 7);
+        CHECK_EQ(q.size(), produced - consumed);
+        for (int k = 0; k < pops && q.pop(v); k++) {
+            CHECK_EQ(v, consumed);
+            consumed++;
+        }
+    }
+    while (q.pop(v)) {
+        CHECK_EQ(v, consumed);
+        consumed++;
+    }
+    CHECK_EQ(consumed, produced);
+    CHECK(dropped > 0);
+}
+
+static void testEvents() {
+    // Key strokes are the largest payload, they must come through the union intact
+    SpscQueue<InputEvent, INPUT_QUEUE_SIZE> q;
+    InputEvent in = {}, out = {};
+    in.time = 1234;
+    in.type = INPUT_EVENT_KEY;
+    in.key.enter = true;
+    in.key.wordLen = 3;
+    memcpy(in.key.word, "abc", 3);
+    in.key.modifier_keys[INPUT_KEY_WORD - 1] = 0xE1;
+    CHECK(q.push(in));
+    in.type = INPUT_EVENT_BUTTONS;
+    in.buttons = (1 << INPUT_SEL) | (1 << INPUT_ANY);
+    CHECK(q.push(in));
+
+    CHECK(q.pop(out));
+    CHECK_EQ(out.type, INPUT_EVENT_KEY);
+    CHECK_EQ(out.time, 1234);
+    CHECK(out.key.enter);
+    CHECK(memcmp(out.key.word, "abc", 3) == 0);
+    CHECK_EQ(out.key.modifier_keys[INPUT_KEY_WORD - 1], 0xE1);
+    CHECK(q.pop(out));
+    CHECK_EQ(out.buttons, (1 << INPUT_SEL) | (1 << INPUT_ANY));
+}
+
+// The input task and the UI on two threads. The producer retries a full ring here, so every item must
+// arrive exactly once and in order while head and tail wrap around thousands of times.
+static void testThreads() {
+    static SpscQueue<uint32_t, 32> q;
+    const uint32_t count = 200000;
+    uint32_t retries = 0;
+    std::thread producer([&] {
+        for (uint32_t i = 0; i < count; i++) {
+            while (!q.push(i)) {
+                retries++;
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    uint32_t received = 0, v;
+    bool ordered = true;
+    while (received < count) {
+        if (!q.pop(v)) {
+            std::this_thread::yield();
+            continue;
+        }
+        if (v != received) ordered = false;
+        received++;
+    }
+    producer.join();
+    CHECK(ordered);
+    CHECK_EQ(received, count);
+    CHECK_EQ(q.size(), 0);
+    printf("input_events: %u items between threads, the ring was full %u times\n", count, retries);
+}
+
+int main() {
+    testFillAndDrain();
+    testWraparound();
+    testEvents();
+    testThreads();
+    return testResult("input_events");
+}
@@ -0,0 +1,204 @@
+// ir_capture: frame copy, the .ir entry writer and the capture ring
+
+#include "test.h"
+#include <modules/ir/ir_capture.h>
+#include <vector>
+
+static IrCapture capture;
+
+static IrCapture fromTicks(const std::vector<uint16_t> &ticks) {
+    std::vector<uint16_t> rawbuf(ticks);
+    decode_results results;
+    results.rawbuf = rawbuf.data();
+    results.rawlen = rawbuf.size();
+    IrCapture c;
+    ir_capture_from_results(results, c);
+    return c;
+}
+
+static void testFromResults() {
+    // rawbuf[0] is the leading gap and is skipped, ticks become microseconds
+    capture = fromTicks({5000, 4500, 2250, 280, 845});
+    CHECK_EQ(capture.rawLen, 4);
+    CHECK_EQ(capture.raw[0], 9000);
+    CHECK_EQ(capture.raw[1], 4500);
+    CHECK_EQ(capture.raw[2], 560);
+    CHECK_EQ(capture.raw[3], 1690);
+    CHECK(!capture.overflow);
+
+    // 100000us is 65535, 0, 34465
+    capture = fromTicks({0, 300, 50000, 300});
+    CHECK_EQ(capture.rawLen, 5);
+    CHECK_EQ(capture.raw[1], UINT16_MAX);
+    CHECK_EQ(capture.raw[2], 0);
+    CHECK_EQ(capture.raw[3], 100000 - UINT16_MAX);
+    CHECK_EQ(capture.raw[4], 600);
+
+    // A frame longer than the record is cut at IR_CAPTURE_MAX_RAW and flagged
+    std::vector<uint16_t> ticks(IR_CAPTURE_MAX_RAW + 10, 100);
+    capture = fromTicks(ticks);
+    CHECK_EQ(capture.rawLen, IR_CAPTURE_MAX_RAW);
+    CHECK(capture.overflow);
+
+    // A split that doesn't fit stops before the partial pieces
+    ticks.assign(IR_CAPTURE_MAX_RAW - 1, 100);
+    ticks.push_back(50000);
+    capture = fromTicks(ticks);
+    CHECK_EQ(capture.rawLen, IR_CAPTURE_MAX_RAW - 2);
+    CHECK(capture.overflow);
+    CHECK_EQ(capture.raw[capture.rawLen - 1], 200);
+
+    // The receiver's own overflow carries over
+    std::vector<uint16_t> rawbuf = {0, 100};
+    decode_results results;
+    results.rawbuf = rawbuf.data();
+    results.rawlen = rawbuf.size();
+    results.overflow = true;
+    ir_capture_from_results(results, capture);
+    CHECK(capture.overflow);
+}
+
+static std::string written(const IrCapture &c, bool raw, bool *result = NULL) {
+    StringPrint out;
+    bool ok = ir_capture_write(out, c, "Power", raw);
+    if (result) *result = ok;
+    return out.text;
+}
+
+static void testWriter() {
+    capture = fromTicks({0, 4500, 2250, 280});
+    capture.protocol = NEC;
+    capture.address = 0x04;
+    capture.command = 0x08;
+    capture.bits = 32;
+    capture.value = 0x20DF10EF;
+    CHECK(
+        written(capture, false) == "name: Power\ntype: parsed\nprotocol: NEC\naddress: 04 00 00 00\n"
+                                   "command: 08 00 00 00\nbits: 32\nvalue: 20 DF 10 EF\n#\n"
+    );
+    CHECK(
+        written(capture, true) ==
+        "name: Power\ntype: raw\nfrequency: 38000\nduty_cycle: 0.33\ndata: 9000 4500 560\n#\n"
+    );
+
+    capture.address = 0xFF20;
+    CHECK(written(capture, false).find("protocol: NECext\n") != std::string::npos);
+    capture.protocol = RC5;
+    capture.command = 0x40;
+    CHECK(written(capture, false).find("protocol: RC5X\n") != std::string::npos);
+    capture.protocol = SONY;
+    capture.address = 0x20;
+    CHECK(written(capture, false).find("protocol: SIRC15\n") != std::string::npos);
+
+    // Over 32 bits: both halves, least significant byte first
+    capture.protocol = SAMSUNG;
+    capture.bits = 48;
+    capture.value = 0x123456789ABCull;
+    CHECK(written(capture, false).find("\nvalue: BC 9A 78 56 34 12 00 00\n") != std::string::npos);
+
+    // AC protocols save their state bytes instead of the value
+    capture.protocol = DAIKIN;
+    capture.bits = 24;
+    capture.state[0] = 0x11;
+    capture.state[1] = 0xDA;
+    capture.state[2] = 0x27;
+    std::string ac = written(capture, false);
+    CHECK(ac.find("protocol: DAIKIN\n") != std::string::npos);
+    CHECK(ac.find("\nstate: 11 DA 27\n#\n") != std::string::npos);
+
+    // Unknown frames can only be saved raw and nothing is written otherwise
+    bool ok = true;
+    capture.protocol = UNKNOWN;
+    CHECK(written(capture, false, &ok).empty());
+    CHECK(!ok);
+    written(capture, true, &ok);
+    CHECK(ok);
+
+    // Timings are written in batches; a full frame of the widest values must come out intact
+    for (uint16_t i = 0; i < IR_CAPTURE_MAX_RAW; i++) capture.raw[i] = i % 2 ? UINT16_MAX : i;
+    capture.rawLen = IR_CAPTURE_MAX_RAW;
+    std::string text = written(capture, true);
+    size_t start = text.find("data: ") + 6;
+    std::string data = text.substr(start, text.find('\n', start) - start);
+    std::string expected;
+    for (uint16_t i = 0; i < IR_CAPTURE_MAX_RAW; i++) {
+        if (i) expected += ' ';
+        expected += std::to_string(capture.raw[i]);
+    }
+    CHECK(data == expected);
+}
+
+static void testRing() {
+    IrCaptureRing ring;
+    CHECK(ring.acquire() == NULL); // not started
+    CHECK_EQ(ring.dropped, 1);
+    CHECK(ring.peek() == NULL);
+    CHECK_EQ(ring.pending(), 0);
+
+    CHECK(ring.begin());
+    CHECK_EQ(ring.dropped, 0);
+    CHECK(ring.peek() == NULL);
+
+    // Fill every slot, the next frame is dropped and counted
+    IrCapture *slots[IR_CAPTURE_SLOTS];
+    for (int i = 0; i < IR_CAPTURE_SLOTS; i++) {
+        slots[i] = ring.acquire();
+        CHECK(slots[i] != NULL);
+        slots[i]->bits = i;
+        ring.commit(slots[i]);
+    }
+    CHECK_EQ(ring.pending(), IR_CAPTURE_SLOTS);
+    CHECK(ring.acquire() == NULL);
+    CHECK(ring.acquire() == NULL);
+    CHECK_EQ(ring.dropped, 2);
+
+    // Frames come out in order and peek() doesn't consume
+    CHECK(ring.peek() == slots[0]);
+    CHECK(ring.peek() == slots[0]);
+    ring.release();
+    CHECK_EQ(ring.pending(), IR_CAPTURE_SLOTS - 1);
+
+    // Wrap around many times with the producer a slot or two ahead of the consumer
+    int produced = IR_CAPTURE_SLOTS, consumed = 1;
+    for (int round = 0; round < 100; round++) {
+        for (int k = 0; k < 1 + round % 2; k++) {
+            IrCapture *c = ring.acquire();
+            if (!c) continue;
+            c->bits = produced++;
+            ring.commit(c);
+        }
+        for (int k = 0; k < 1 + (round + 1) % 2; k++) {
+            IrCapture *c = ring.peek();
+            if (!c) continue;
+            CHECK_EQ(c->bits, consumed);
+            consumed++;
+            ring.release();
+        }
+        CHECK(ring.pending() <= IR_CAPTURE_SLOTS);
+    }
+    while (ring.peek()) {
+        CHECK_EQ(ring.peek()->bits, consumed);
+        consumed++;
+        ring.release();
+    }
+    CHECK_EQ(consumed, produced);
+    CHECK_EQ(ring.dropped, 2);
+
+    // release() with nothing queued is harmless, and every slot is free again
+    ring.release();
+    for (int i = 0; i < IR_CAPTURE_SLOTS; i++) CHECK(ring.acquire() != NULL);
+    CHECK(ring.acquire() == NULL);
+
+    ring.end();
+    CHECK_EQ(ring.pending(), 0);
+    CHECK(ring.begin()); // restarts with all slots free
+    CHECK_EQ(ring.dropped, 0);
+    CHECK(ring.acquire() != NULL);
+}
+
+int main() {
+    testFromResults();
+    testWriter();
+    testRing();
+    return testResult("ir_capture");
+}
@@ -0,0 +1,152 @@
+// ir_utils: TV-B-Gone code unpacking and the RMT symbol conversion
+
+#include "test.h"
+#include <modules/ir/ir_utils.h>
+#include <stdint.h>
+#include <vector>
+
+#include <modules/ir/WORLD_IR_CODES.h>
+
+#define COUNT_OF(x) (sizeof(x) / sizeof(*(x)))
+
+// The bit reader of the original firmware, as the reference for ir_unpack_pairs()
+static std::vector<uint32_t> referenceUnpack(const IrCode *code) {
+    uint8_t bitsleft = 0, bits = 0, codePtr = 0;
+    auto readBits = [&](uint8_t count) {
+        uint8_t tmp = 0;
+        for (uint8_t i = 0; i < count; i++) {
+            if (bitsleft == 0) {
+                bits = code->codes[codePtr++];
+                bitsleft = 8;
+            }
+            bitsleft--;
+            tmp |= ((bits >> bitsleft) & 1) << (count - 1 - i);
+        }
+        return tmp;
+    };
+    std::vector<uint32_t> out;
+    for (uint8_t k = 0; k < code->numpairs; k++) {
+        uint16_t ti = readBits(code->bitcompression) * 2;
+        out.push_back(code->times[ti] * 10);
+        out.push_back(code->times[ti + 1] * 10);
+    }
+    return out;
+}
+
+// Symbols back to alternating mark/space durations, adjacent halves of the same level merged.
+// Checks that only the very last half may be empty.
+static std::vector<uint32_t> decodeSymbols(const rmt_symbol_word_t *symbols, size_t count) {
+    std::vector<uint32_t> out;
+    int lastLevel = -1;
+    for (size_t i = 0; i < count; i++) {
+        uint32_t duration[2] = {symbols[i].duration0, symbols[i].duration1};
+        int level[2] = {symbols[i].level0, symbols[i].level1};
+        for (int h = 0; h < 2; h++) {
+            if (duration[h] == 0) {
+                CHECK(i == count - 1 && h == 1);
+                continue;
+            }
+            if (level[h] == lastLevel) out.back() += duration[h];
+            else out.push_back(duration[h]);
+            lastLevel = level[h];
+        }
+    }
+    return out;
+}
+
+// What the receiver sees: a zero duration (some codes have them) joins its neighbours
+static std::vector<uint32_t> onAir(const uint32_t *durations, size_t count) {
+    std::vector<uint32_t> out;
+    int lastLevel = -1;
+    for (size_t i = 0; i < count; i++) {
+        if (durations[i] == 0) continue;
+        int level = i % 2 == 0;
+        if (level == lastLevel) out.back() += durations[i];
+        else out.push_back(durations[i]);
+        lastLevel = level;
+    }
+    return out;
+}
+
+static void testUnpackAllCodes() {
+    const IrCode *const *tables[] = {NApowerCodes, EUpowerCodes};
+    size_t sizes[] = {COUNT_OF(NApowerCodes), COUNT_OF(EUpowerCodes)};
+    size_t codes = 0;
+    for (int t = 0; t < 2; t++) {
+        for (size_t c = 0; c < sizes[t]; c++) {
+            const IrCode *code = tables[t][c];
+            uint32_t durations[2 * 256];
+            size_t n =
+                ir_unpack_pairs(code->codes, code->numpairs, code->bitcompression, code->times, durations);
+            CHECK(std::vector<uint32_t>(durations, durations + n) == referenceUnpack(code));
+
+            // as TV-B-Gone sends it: the gap after the code goes on the last space
+            durations[n - 1] += 50000;
+            rmt_symbol_word_t symbols[160];
+            size_t count = ir_durations_to_symbols(durations, n, symbols, COUNT_OF(symbols));
+            CHECK(count > 0);
+            CHECK_EQ(symbols[0].level0, 1);
+            CHECK(decodeSymbols(symbols, count) == onAir(durations, n));
+            codes++;
+        }
+    }
+    CHECK(codes > 200);
+}
+
+static void testLongDurationsAreSplit() {
+    uint32_t durations[] = {70000, 10};
+    rmt_symbol_word_t symbols[4];
+    // 70000 needs 3 halves of at most IR_RMT_MAX_TICKS, then the space: 2 symbols
+    CHECK_EQ(ir_durations_to_symbols(durations, 2, symbols, 4), 2);
+    CHECK_EQ(symbols[0].duration0 + symbols[0].duration1 + symbols[1].duration0, 70000);
+    CHECK_EQ(symbols[1].level0, 1);
+    CHECK_EQ(symbols[1].level1, 0);
+    CHECK_EQ(symbols[1].duration1, 10);
+}
+
+static void testOddHalvesArePadded() {
+    // three halves: the last one is shared so no half but the final one is empty
+    uint32_t durations[] = {500, 600, 700};
+    rmt_symbol_word_t symbols[4];
+    size_t count = ir_durations_to_symbols(durations, 3, symbols, 4);
+    CHECK_EQ(count, 2);
+    CHECK(decodeSymbols(symbols, count) == std::vector<uint32_t>(durations, durations + 3));
+
+    // a single tick can't be shared, the frame ends with an empty half
+    uint32_t tick[] = {1};
+    CHECK_EQ(ir_durations_to_symbols(tick, 1, symbols, 4), 1);
+    CHECK_EQ(symbols[0].duration0, 1);
+    CHECK_EQ(symbols[0].duration1, 0);
+}
+
+static void testLimits() {
+    uint32_t durations[] = {100, 100, 100, 100, 100};
+    rmt_symbol_word_t symbols[2];
+    CHECK_EQ(ir_durations_to_symbols(durations, 5, symbols, 2), 0); // needs 3 symbols
+    CHECK_EQ(ir_durations_to_symbols(durations, 0, symbols, 2), 0);
+    uint32_t zeros[] = {0, 0};
+    CHECK_EQ(ir_durations_to_symbols(zeros, 2, symbols, 2), 0);
+}
+
+static void testTransmitter() {
+    IrRmtTx tx;
+    CHECK(ir_rmt_begin(tx, 4, 38000));
+    CHECK(tx.enabled);
+    CHECK_EQ(tx.carrierHz, 38000);
+    CHECK(ir_rmt_set_carrier(tx, 56000));
+    CHECK_EQ(tx.carrierHz, 56000);
+    rmt_symbol_word_t symbol = {};
+    CHECK(ir_rmt_send(tx, &symbol, 1));
+    ir_rmt_end(tx, 4);
+    CHECK(!tx.enabled);
+    CHECK(!ir_rmt_send(tx, &symbol, 1));
+}
+
+int main() {
+    testUnpackAllCodes();
+    testLongDurationsAreSplit();
+    testOddHalvesArePadded();
+    testLimits();
+    testTransmitter();
+    return testResult("ir_utils");
+}
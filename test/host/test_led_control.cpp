@@ -0,0 +1,175 @@
+// led_control: the effect frames (rainbow, breathe, chase, chase tail) at a fixed tick for every speed,
+// encoder steps and the single LED fallback
+
+#include "test.h"
+#include <core/led_frames.h>
+#include <initializer_list>
+#include <math.h>
+
+#define TICKS 100 // frames of the timer before each check
+
+static const LedRgb color = {200, 100, 50};
+static const LedRgb black = {0, 0, 0};
+
+static bool same(const LedRgb &a, const LedRgb &b) { return a.r == b.r && a.g == b.g && a.b == b.b; }
+
+static LedRgb scaled(const LedRgb &c, int value) {
+    return {(uint8_t)(c.r * value / 255), (uint8_t)(c.g * value / 255), (uint8_t)(c.b * value / 255)};
+}
+
+static LedFrames run(int count, int effect, int speed, int direction, int ticks, LedRgb c = color) {
+    LedFrames frames(count);
+    frames.setParams({c, effect, speed, direction});
+    for (int i = 0; i < ticks; i++) frames.advance(false, 1);
+    return frames;
+}
+
+static void testHsv() {
+    CHECK(same(ledHsvToRgb(0, 255, 255), {255, 0, 0}));
+    CHECK(same(ledHsvToRgb(30, 255, 255), {255, 127, 0}));
+    CHECK(same(ledHsvToRgb(60, 255, 255), {255, 255, 0}));
+    CHECK(same(ledHsvToRgb(120, 255, 255), {0, 255, 0}));
+    CHECK(same(ledHsvToRgb(240, 255, 255), {0, 0, 255}));
+    CHECK(same(ledHsvToRgb(300, 255, 255), {255, 0, 255}));
+    CHECK(same(ledHsvToRgb(200, 0, 128), {128, 128, 128})); // no saturation, grey
+}
+
+// Hue step per frame: speed * 0.2 turns/s at 50 ms per frame
+static int hueAt(int speed, int ticks) { return ticks * (speed * 360 * LED_FRAME_MS / 5000) % 360; }
+
+static void testRainbow() {
+    LedRgb out[8];
+    for (int speed = 1; speed <= LED_SPEEDS; speed++) {
+        int hue = hueAt(speed, TICKS);
+        // Color cycle: every LED the same hue, turning against the direction
+        LedFrames cycle = run(8, LED_EFFECT_COLOR_CYCLE, speed, 1, TICKS);
+        CHECK(cycle.animating());
+        CHECK_EQ(cycle.hue(), hue);
+        CHECK(cycle.render(out));
+        bool ok = true;
+        for (int i = 0; i < 8; i++) ok &= same(out[i], ledHsvToRgb((360 - hue) % 360, 255, 255));
+        CHECK(ok);
+
+        // Color wheel: the LEDs 45 degrees apart
+        LedFrames wheel = run(8, LED_EFFECT_COLOR_WHEEL, speed, -1, TICKS);
+        CHECK(wheel.render(out));
+        ok = true;
+        for (int i = 0; i < 8; i++) ok &= same(out[i], ledHsvToRgb((hue + 45 * i) % 360, 255, 255));
+        CHECK(ok);
+    }
+    // Speed 10 is a turn in 10 frames: back at red after 10, a third of the way at green
+    LedRgb one;
+    run(1, LED_EFFECT_COLOR_CYCLE, 10, -1, 10).render(&one);
+    CHECK(same(one, {255, 0, 0}));
+    LedFrames third(1);
+    third.setParams({color, LED_EFFECT_COLOR_CYCLE, LED_SPEEDS + 1, -1});
+    third.advance(false, 1); // following the encoder, timer frames don't move it
+    CHECK_EQ(third.hue(), 0);
+    third.advance(true, 120 / LED_ENCODER_HUE_STEP);
+    third.advance(true, -(120 / LED_ENCODER_HUE_STEP) * 2);
+    CHECK_EQ(third.hue(), 360 - 120 / LED_ENCODER_HUE_STEP * LED_ENCODER_HUE_STEP);
+}
+
+static void testBreathe() {
+    LedRgb out[4];
+    for (int speed = 1; speed <= LED_SPEEDS; speed++) {
+        // A breath every 10/speed seconds over 65536 phase steps, (sin + 1) / 2 of the color
+        uint16_t phase = TICKS * ((uint32_t)speed * 65536 * LED_FRAME_MS / 10000);
+        int value = (sinf((phase >> 8) * 2 * (float)M_PI / 256) + 1.0f) * 127.5f;
+        LedFrames frames = run(4, LED_COLOR_BREATHE, speed, 1, TICKS);
+        CHECK(frames.animating());
+        CHECK_EQ(frames.phase(), phase);
+        CHECK(frames.render(out));
+        CHECK(same(out[0], scaled(color, value)) && same(out[3], out[0]));
+    }
+    // Half brightness at the start, full a quarter breath later (10 encoder steps), off at three quarters
+    LedFrames frames(1);
+    frames.setParams({color, LED_COLOR_BREATHE, LED_SPEEDS + 1, 1});
+    frames.render(out);
+    CHECK(same(out[0], {99, 49, 24}));
+    frames.advance(true, 10);
+    frames.render(out);
+    CHECK(same(out[0], {199, 99, 49}));
+    frames.advance(true, 20);
+    frames.render(out);
+    CHECK(same(out[0], {0, 0, 0}));
+    // Nothing to breathe with black
+    CHECK(!run(4, LED_COLOR_BREATHE, 5, 1, 0, black).animating());
+}
+
+// The chase moves one LED every 11 - speed frames, starting with the first frame
+static int chaseAt(int speed, int direction, int ticks, int count) {
+    int moves = (ticks + LED_SPEEDS - speed) / (LED_SPEEDS + 1 - speed);
+    return ((direction * moves) % count + count) % count;
+}
+
+static void testChase() {
+    LedRgb out[8];
+    for (int speed = 1; speed <= LED_SPEEDS; speed++) {
+        LedFrames frames = run(8, LED_EFFECT_CHASE, speed, 1, TICKS);
+        CHECK(frames.animating());
+        int at = chaseAt(speed, 1, TICKS, 8);
+        CHECK_EQ(frames.position(), at);
+        CHECK(frames.render(out));
+        bool ok = true;
+        for (int i = 0; i < 8; i++) ok &= same(out[i], i == at ? color : black);
+        CHECK(ok);
+    }
+    CHECK_EQ(run(8, LED_EFFECT_CHASE, 10, 1, 3).position(), 3);
+    CHECK_EQ(run(8, LED_EFFECT_CHASE, 1, -1, 10).position(), 7);
+    CHECK_EQ(run(8, LED_EFFECT_CHASE, 1, -1, 11).position(), 6);
+}
+
+static void testChaseTail() {
+    // 0.6^i of the color behind the head, the head itself dark
+    const int fade[8] = {0, 153, 91, 54, 32, 19, 11, 6};
+    LedRgb out[8];
+    for (int speed = 1; speed <= LED_SPEEDS; speed++) {
+        for (int direction : {1, -1}) {
+            LedFrames frames = run(8, LED_EFFECT_CHASE_TAIL, speed, direction, TICKS);
+            int at = chaseAt(speed, direction, TICKS, 8);
+            CHECK_EQ(frames.position(), at);
+            CHECK(frames.render(out));
+            bool ok = true;
+            for (int i = 0; i < 8; i++) {
+                ok &= same(out[((at - direction * i) % 8 + 8) % 8], scaled(color, fade[i]));
+            }
+            CHECK(ok);
+        }
+    }
+    // A long strip: the tail fades out after a dozen LEDs
+    LedRgb strip[16];
+    LedFrames frames = run(16, LED_EFFECT_CHASE_TAIL, 10, 1, 0);
+    frames.render(strip);
+    CHECK(same(strip[15], scaled(color, 153)));
+    CHECK(same(strip[6], black)); // 10 behind
+    CHECK(same(strip[1], black));
+}
+
+static void testSingleLed() {
+    // Nothing to chase on one LED: the color, and no timer frames
+    LedRgb out;
+    for (int effect : {LED_EFFECT_CHASE, LED_EFFECT_CHASE_TAIL}) {
+        LedFrames frames = run(1, effect, 7, 1, TICKS);
+        CHECK(!frames.animating());
+        CHECK_EQ(frames.position(), 0);
+        CHECK(frames.render(&out));
+        CHECK(same(out, color));
+    }
+    // Solid is drawn by led_control itself, a speed out of range never animates
+    LedFrames solid = run(8, LED_EFFECT_SOLID, 5, 1, 0);
+    CHECK(!solid.animating());
+    CHECK(!solid.render(&out));
+    CHECK(!run(8, LED_EFFECT_COLOR_CYCLE, 0, 1, 0).animating());
+    CHECK(!run(8, LED_EFFECT_CHASE, LED_SPEEDS + 1, 1, 0).animating());
+}
+
+int main() {
+    testHsv();
+    testRainbow();
+    testBreathe();
+    testChase();
+    testChaseTail();
+    testSingleLed();
+    return testResult("led_control");
+}
@@ -0,0 +1,203 @@
+// nrf_hop: the hop schedule and its statistics against a fake clock, the co-processor link both ways
+
+#include "test.h"
+#include <modules/NRF24/nrf_hop.h>
+#include <random>
+#include <string.h>
+#include <string>
+#include <vector>
+
+class MockRadio : public NrfHopRadio {
+public:
+    std::vector<uint8_t> channels;
+    void setChannel(uint8_t channel) override { channels.push_back(channel); }
+};
+
+class MockPort : public NrfLinkPort {
+public:
+    std::string out;
+    void write(const uint8_t *data, size_t len) override { out.append((const char *)data, len); }
+};
+
+static void testModes() {
+    CHECK_EQ(nrf_hop_mode_count, 9);
+    for (uint8_t i = 0; i < nrf_hop_mode_count; i++) {
+        const NrfHopMode &m = nrf_hop_modes[i];
+        CHECK(m.count > 0 && m.count <= NRF_HOP_MAX_CHANNELS);
+        for (uint8_t k = 0; k < m.count; k++) CHECK(m.channels[k] < NRF_HOP_MAX_CHANNELS);
+    }
+    CHECK(strcmp(nrf_hop_modes[1].name, "WiFi") == 0);
+    CHECK_EQ(nrf_hop_modes[1].count, 16);
+    CHECK_EQ(nrf_hop_modes[8].count, 124);
+}
+
+static void testPlans() {
+    MockRadio radio;
+    NrfHopEngine e(radio);
+    CHECK(!e.setPlan(nrf_hop_modes[0].channels, 0, 500)); // nothing to hop on
+    CHECK_EQ(e.count(), 0);
+    e.tick(0);
+    CHECK(radio.channels.empty());
+
+    CHECK(e.setRange(0, 10, 3, 500));
+    CHECK_EQ(e.count(), 4);
+    CHECK_EQ(e.channels()[3], 9);
+    // Stop below start gives start alone, a dwell below the PLL settling time is raised
+    CHECK(e.setRange(50, 10, 3, 100));
+    CHECK_EQ(e.count(), 1);
+    CHECK_EQ(e.dwellUs(), NRF_HOP_MIN_DWELL_US);
+    // Channels past 125 don't exist, a zero step is one
+    CHECK(!e.setRange(200, 210, 1, 500));
+    CHECK_EQ(e.count(), 1); // the previous plan stays
+    CHECK(e.setRange(120, 125, 0, 500));
+    CHECK_EQ(e.count(), 6);
+}
+
+// Every channel of the table in order, then around again
+static void testSchedule() {
+    MockRadio radio;
+    NrfHopEngine e(radio);
+    const NrfHopMode &wifi = nrf_hop_modes[1];
+    CHECK(e.setPlan(wifi.channels, wifi.count, 500));
+    for (uint32_t i = 0; i < 3u * wifi.count; i++) e.tick(i * 500);
+    CHECK_EQ(radio.channels.size(), 3u * wifi.count);
+    bool inOrder = true;
+    for (size_t i = 0; i < radio.channels.size(); i++) {
+        if (radio.channels[i] != wifi.channels[i % wifi.count]) inOrder = false;
+    }
+    CHECK(inOrder);
+    CHECK_EQ(e.channel(), wifi.channels[wifi.count - 1]);
+
+    // A new plan starts at its first channel
+    radio.channels.clear();
+    e.setPlan(nrf_hop_modes[5].channels, nrf_hop_modes[5].count, 500);
+    e.tick(0);
+    CHECK_EQ(radio.channels[0], 40);
+}
+
+static void testStats() {
+    MockRadio radio;
+    NrfHopEngine e(radio);
+    e.setPlan(nrf_hop_modes[1].channels, nrf_hop_modes[1].count, 500);
+
+    // 500 us ticks across the micros() wrap, every 100th one 40 us late, then one stall of 1.2 ms
+    uint32_t t = UINT32_MAX - 4095;
+    NrfHopStats first = {};
+    for (int i = 0; i < 4000; i++) {
+        e.tick(t + (i % 100 == 0 ? 40 : 0));
+        t += 500;
+        if (i == 2000) {
+            first = e.stats(); // the first window just closed
+            t += 1200;
+        }
+    }
+    CHECK_EQ(first.late, 0);
+    CHECK(first.hopsPerSec >= 1990 && first.hopsPerSec <= 2001);
+    CHECK_EQ(first.dwellMinUs, 460);
+    CHECK_EQ(first.dwellMaxUs, 540);
+    CHECK_EQ(first.jitterUs, 40);
+
+    const NrfHopStats &s = e.stats();
+    CHECK_EQ(s.hops, 4000);
+    CHECK_EQ(s.late, 1);
+    CHECK_EQ(s.dwellMaxUs, 1660); // 500 + 1200, less the 40 the tick before it was late
+    CHECK_EQ(s.jitterUs, 1160);
+
+    // A new plan starts the statistics over
+    e.setPlan(nrf_hop_modes[1].channels, nrf_hop_modes[1].count, 1000);
+    CHECK_EQ(e.stats().hops, 0);
+    CHECK_EQ(e.stats().late, 0);
+}
+
+static void feed(NrfLink &link, const std::string &bytes, bool *answered = NULL) {
+    for (char c : bytes) {
+        bool got = link.feed(c);
+        if (answered) *answered |= got;
+    }
+}
+
+static void testTextLink() {
+    MockPort port;
+    NrfLink link(port);
+    CHECK_EQ(link.radios(), -1);
+
+    // The QUERY frame, an empty line ending it for the text firmware, then RADIOS, all CRLF
+    link.query();
+    CHECK_EQ((uint8_t)port.out[0], NRF_FRAME_SYNC);
+    CHECK_EQ((uint8_t)port.out[1], NRF_CMD_QUERY);
+    CHECK(port.out.substr(4) == "\r\nRADIOS\r\n");
+
+    bool answered = false;
+    feed(link, "junk\r\n", &answered);
+    CHECK(!answered);
+    feed(link, "3\r\n", &answered);
+    CHECK(answered);
+    CHECK_EQ(link.radios(), 3);
+    CHECK(!link.binary());
+    feed(link, "12345678901\r\n", &answered); // too long for a count
+    CHECK_EQ(link.radios(), 3);
+
+    const NrfHopMode &wifi = nrf_hop_modes[1];
+    port.out.clear();
+    link.plan(wifi.channels, wifi.count, 500, "WiFi");
+    CHECK(port.out == "WiFi\r\n");
+    port.out.clear();
+    link.channel(50);
+    CHECK(port.out == "CH_50\r\n");
+    port.out.clear();
+    link.off();
+    CHECK(port.out == "OFF\r\n");
+}
+
+static void testBinaryLink() {
+    MockPort port;
+    NrfLink link(port);
+    uint8_t frame[NRF_FRAME_MAX];
+    uint8_t two = 2;
+    size_t len = nrfFrameEncode(NRF_CMD_RADIOS, &two, 1, frame);
+    CHECK_EQ(len, 5);
+    std::string bytes((const char *)frame, len);
+
+    // A corrupted frame is counted and ignored
+    bytes[3] ^= 1;
+    bool answered = false;
+    feed(link, bytes, &answered);
+    CHECK(!answered);
+    CHECK_EQ(link.badFrames(), 1);
+    CHECK(!link.binary());
+    bytes[3] ^= 1;
+    feed(link, bytes, &answered);
+    CHECK(answered);
+    CHECK_EQ(link.radios(), 2);
+    CHECK(link.binary());
+
+    // PLAN: dwell little endian, then the channels
+    const NrfHopMode &wifi = nrf_hop_modes[1];
+    port.out.clear();
+    link.plan(wifi.channels, wifi.count, 500, "WiFi");
+    CHECK_EQ(port.out.size(), 4 + 2 + wifi.count);
+    CHECK_EQ((uint8_t)port.out[1], NRF_CMD_PLAN);
+    CHECK_EQ((uint8_t)port.out[2], 2 + wifi.count);
+    CHECK_EQ((uint8_t)port.out[3], 0xF4);
+    CHECK_EQ((uint8_t)port.out[4], 0x01);
+    CHECK(memcmp(&port.out[5], wifi.channels, wifi.count) == 0);
+    CHECK_EQ((uint8_t)port.out.back(), nrfCrc8((const uint8_t *)&port.out[1], port.out.size() - 2));
+    port.out.clear();
+    link.off();
+    CHECK_EQ(port.out.size(), 4);
+
+    // Random bytes never crash the receiver or produce an impossible count
+    std::mt19937 rng(1);
+    for (int i = 0; i < 1000000; i++) link.feed(rng());
+    CHECK(link.radios() >= -1);
+}
+
+int main() {
+    testModes();
+    testPlans();
+    testSchedule();
+    testStats();
+    testTextLink();
+    testBinaryLink();
+    return testResult("nrf_hop");
+}
@@ -0,0 +1,56 @@
+// portal_assets: Accept-Encoding negotiation for the pre-gzipped pages, the asset table
+
+#include "test.h"
+#include <modules/wifi/portal_assets.h>
+#include <string.h>
+
+using namespace portal_assets;
+
+static void testAcceptsGzip() {
+    // What browsers and captive portal sheets send
+    CHECK(acceptsGzip("gzip, deflate, br, zstd"));
+    CHECK(acceptsGzip("gzip, deflate"));
+    CHECK(acceptsGzip("br;q=1.0, gzip;q=0.8, *;q=0.1"));
+    CHECK(acceptsGzip("GZIP"));
+    CHECK(acceptsGzip("x-gzip"));
+    CHECK(acceptsGzip("*"));
+    CHECK(acceptsGzip("deflate,gzip"));
+    // Only identity, nothing, or gzip refused
+    CHECK(!acceptsGzip(NULL));
+    CHECK(!acceptsGzip(""));
+    CHECK(!acceptsGzip("identity"));
+    CHECK(!acceptsGzip("deflate, br"));
+    CHECK(!acceptsGzip("gzip;q=0"));
+    CHECK(!acceptsGzip("gzip; q=0.000, deflate"));
+    CHECK(!acceptsGzip("*;q=0"));
+    CHECK(!acceptsGzip("*, gzip;q=0")); // the explicit entry wins over the wildcard
+    CHECK(acceptsGzip("*;q=0, gzip"));
+    CHECK(!acceptsGzip("gzipped, xgzip"));
+}
+
+static void testTable() {
+    PortalAssetTable table;
+    const std::string page = "<html><body>" + std::string(2000, 'x') + "</body></html>";
+    CHECK(table.add("/", "text/html", page));
+    CHECK(!table.add("/empty", "text/html", std::string()));
+    const PortalAsset *a = table.find("/");
+    CHECK(a != NULL);
+    if (!a) return;
+    CHECK_EQ(a->rawLen, page.size());
+    CHECK(a->gzLen < page.size() / 4);
+    CHECK(a->gz[0] == 0x1F && a->gz[1] == 0x8B); // gzip magic
+    CHECK(a->etag[0] == '"');
+    CHECK(table.find("/loading") == NULL);
+
+    // Same path again replaces the entry, another body another ETag
+    std::string etag = a->etag;
+    CHECK(table.add("/", "text/html", page + "!"));
+    CHECK_EQ(table.count(), 1);
+    CHECK(etag != table.find("/")->etag);
+}
+
+int main() {
+    testAcceptsGzip();
+    testTable();
+    return testResult("portal_assets");
+}
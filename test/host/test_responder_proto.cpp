@@ -0,0 +1,545 @@
+// responder_proto: NBNS/LLMNR/mDNS answers, SMB1 and SMB2 sessions fed in pieces, the NTLMSSP
+// messages and the hashcat 5600 line against a known hash
+
+#include "test.h"
+#include <modules/wifi/responder_proto.h>
+#include <random>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+using namespace responder;
+
+typedef std::vector<uint8_t> Bytes;
+
+static const uint8_t ip[4] = {10, 0, 0, 1};
+
+static Bytes hex(const char *s) {
+    Bytes b;
+    for (; s[0] && s[1]; s += 2) {
+        unsigned v;
+        sscanf(s, "%2x", &v);
+        b.push_back(v);
+    }
+    return b;
+}
+
+static void add(Bytes &b, const void *data, size_t len) {
+    b.insert(b.end(), (const uint8_t *)data, (const uint8_t *)data + len);
+}
+static void addBe16(Bytes &b, uint16_t v) {
+    b.push_back(v >> 8);
+    b.push_back(v & 0xFF);
+}
+static void addLe16(Bytes &b, uint16_t v) {
+    b.push_back(v & 0xFF);
+    b.push_back(v >> 8);
+}
+static uint16_t le16(const uint8_t *p) { return p[0] | (p[1] << 8); }
+static uint32_t le32(const uint8_t *p) { return le16(p) | ((uint32_t)le16(p + 2) << 16); }
+static uint16_t be16(const uint8_t *p) { return (p[0] << 8) | p[1]; }
+
+// DNS style header: ID, flags, one question
+static Bytes dnsHeader(uint16_t id, uint16_t flags, uint16_t questions = 1) {
+    Bytes b;
+    addBe16(b, id);
+    addBe16(b, flags);
+    addBe16(b, questions);
+    addBe16(b, 0);
+    addBe16(b, 0);
+    addBe16(b, 0);
+    return b;
+}
+
+static Bytes nbnsQuery(const char *name, uint16_t flags = 0x0110, uint16_t type = 0x0020) {
+    Bytes q = dnsHeader(0x1234, flags);
+    uint8_t encoded[32];
+    encodeNetBIOSName(name, encoded);
+    q.push_back(0x20);
+    add(q, encoded, 32);
+    q.push_back(0x00);
+    addBe16(q, type);
+    addBe16(q, 0x0001);
+    return q;
+}
+
+static void testNbns() {
+    uint8_t encoded[32];
+    char name[32];
+    encodeNetBIOSName("fileserver", encoded);
+    CHECK(memcmp(encoded, "EGEJEMEFFDEFFCFGEFFCCACACACACACA", 32) == 0);
+    decodeNetBIOSLabel(encoded, name, sizeof(name));
+    CHECK(strcmp(name, "FILESERVER<20>") == 0);
+
+    Bytes q = nbnsQuery("wpad");
+    uint8_t reply[128];
+    CHECK_EQ(q.size(), 50);
+    CHECK_EQ(nbnsAnswer(q.data(), q.size(), ip, reply, 61, name, sizeof(name)), 0); // no room
+    CHECK_EQ(nbnsAnswer(q.data(), q.size(), ip, reply, sizeof(reply), name, sizeof(name)), 62);
+    CHECK(strcmp(name, "WPAD<20>") == 0);
+    CHECK_EQ(be16(reply), 0x1234);
+    CHECK_EQ(be16(reply + 2), 0x8400);
+    CHECK_EQ(be16(reply + 4), 0); // no question section in the answer
+    CHECK_EQ(be16(reply + 6), 1);
+    CHECK(memcmp(reply + 12, q.data() + 12, 34) == 0);
+    const uint8_t rr[16] = {0x00, 0x20, 0x00, 0x01, 0, 0, 0, 60, 0, 6, 0, 0, 10, 0, 0, 1};
+    CHECK(memcmp(reply + 46, rr, sizeof(rr)) == 0);
+
+    // Our own answers, node status requests and short packets are left alone
+    q = nbnsQuery("wpad", 0x8500);
+    CHECK_EQ(nbnsAnswer(q.data(), q.size(), ip, reply, sizeof(reply), name, sizeof(name)), 0);
+    q = nbnsQuery("wpad", 0x0110, 0x0021);
+    CHECK_EQ(nbnsAnswer(q.data(), q.size(), ip, reply, sizeof(reply), name, sizeof(name)), 0);
+    q = nbnsQuery("wpad");
+    CHECK_EQ(nbnsAnswer(q.data(), q.size() - 1, ip, reply, sizeof(reply), name, sizeof(name)), 0);
+}
+
+static Bytes llmnrQuery(const char *label, uint16_t type) {
+    Bytes q = dnsHeader(0xABCD, 0x0000);
+    q.push_back(strlen(label));
+    add(q, label, strlen(label));
+    q.push_back(0x00);
+    addBe16(q, type);
+    addBe16(q, 0x0001);
+    return q;
+}
+
+static void testLlmnr() {
+    char name[64];
+    uint8_t reply[128];
+    Bytes q = llmnrQuery("wpad", 0x0001);
+    CHECK_EQ(llmnrAnswer(q.data(), q.size(), ip, reply, 37, name, sizeof(name)), 0);
+    CHECK_EQ(llmnrAnswer(q.data(), q.size(), ip, reply, sizeof(reply), name, sizeof(name)), 38);
+    CHECK(strcmp(name, "wpad") == 0);
+    CHECK_EQ(be16(reply), 0xABCD);
+    CHECK_EQ(be16(reply + 2), 0x8400);
+    CHECK_EQ(be16(reply + 4), 1);
+    CHECK_EQ(be16(reply + 6), 1);
+    CHECK(memcmp(reply + 12, q.data() + 12, 10) == 0); // the question is echoed
+    const uint8_t a[16] = {0xC0, 0x0C, 0x00, 0x01, 0x00, 0x01, 0, 0, 0, 30, 0, 4, 10, 0, 0, 1};
+    CHECK(memcmp(reply + 22, a, sizeof(a)) == 0);
+
+    // AAAA gets the IPv4 mapped address
+    q = llmnrQuery("wpad", 0x001C);
+    CHECK_EQ(llmnrAnswer(q.data(), q.size(), ip, reply, sizeof(reply), name, sizeof(name)), 50);
+    const uint8_t aaaa[28] = {0xC0, 0x0C, 0x00, 0x1C, 0x00, 0x01, 0, 0, 0, 30, 0, 16, 0, 0,
+                              0,    0,    0,    0,    0,    0,    0, 0, 0xFF, 0xFF, 10, 0, 0, 1};
+    CHECK(memcmp(reply + 22, aaaa, sizeof(aaaa)) == 0);
+
+    // Other types, truncated questions and answers are ignored; the name is cut to fit
+    q = llmnrQuery("wpad", 0x0010);
+    CHECK_EQ(llmnrAnswer(q.data(), q.size(), ip, reply, sizeof(reply), name, sizeof(name)), 0);
+    q = llmnrQuery("wpad", 0x0001);
+    CHECK_EQ(llmnrAnswer(q.data(), q.size() - 1, ip, reply, sizeof(reply), name, sizeof(name)), 0);
+    q[2] = 0x80;
+    CHECK_EQ(llmnrAnswer(q.data(), q.size(), ip, reply, sizeof(reply), name, sizeof(name)), 0);
+    q = llmnrQuery("workstation", 0x0001);
+    CHECK_EQ(llmnrAnswer(q.data(), q.size(), ip, reply, sizeof(reply), name, 5), 45);
+    CHECK(strcmp(name, "work") == 0);
+}
+
+static void addLabels(Bytes &b, const char *dotted) {
+    while (*dotted) {
+        const char *dot = strchr(dotted, '.');
+        size_t l = dot ? (size_t)(dot - dotted) : strlen(dotted);
+        b.push_back(l);
+        add(b, dotted, l);
+        dotted += l + (dot ? 1 : 0);
+    }
+    b.push_back(0);
+}
+
+static void testMdns() {
+    char name[64];
+    uint8_t reply[128];
+    bool unicast = false;
+
+    // A PTR question first, then "printer" with ".local" compressed into the first name, QU bit set
+    Bytes q = dnsHeader(0x0000, 0x0000, 2);
+    addLabels(q, "_http._tcp.local");
+    addBe16(q, 0x000C);
+    addBe16(q, 0x0001);
+    q.push_back(7);
+    add(q, "printer", 7);
+    q.push_back(0xC0);
+    q.push_back(12 + 1 + 5 + 1 + 4); // the "local" label
+    addBe16(q, 0x0001);
+    addBe16(q, 0x8001);
+
+    size_t n = mdnsAnswer(q.data(), q.size(), 5353, ip, reply, sizeof(reply), name, sizeof(name), unicast);
+    CHECK_EQ(n, 12 + 15 + 10 + 4);
+    CHECK(strcmp(name, "printer.local") == 0);
+    CHECK(unicast);
+    CHECK_EQ(be16(reply), 0); // multicast answers carry no ID
+    CHECK_EQ(be16(reply + 2), 0x8400);
+    CHECK_EQ(be16(reply + 6), 1);
+    CHECK(memcmp(reply + 12, "\x07printer\x05local\x00", 15) == 0);
+    const uint8_t a[14] = {0x00, 0x01, 0x80, 0x01, 0, 0, 0, 120, 0, 4, 10, 0, 0, 1};
+    CHECK(memcmp(reply + 27, a, sizeof(a)) == 0);
+
+    // A legacy resolver on another port gets its ID back and a unicast answer even without QU
+    q[0] = 0xBE;
+    q[1] = 0xEF;
+    q[q.size() - 2] = 0x00; // QM
+    unicast = false;
+    CHECK_EQ(mdnsAnswer(q.data(), q.size(), 40000, ip, reply, sizeof(reply), name, sizeof(name), unicast), n);
+    CHECK_EQ(be16(reply), 0xBEEF);
+    CHECK(unicast);
+    unicast = true;
+    CHECK_EQ(mdnsAnswer(q.data(), q.size(), 5353, ip, reply, sizeof(reply), name, sizeof(name), unicast), n);
+    CHECK(!unicast);
+    CHECK_EQ(mdnsAnswer(q.data(), q.size(), 5353, ip, reply, n - 1, name, sizeof(name), unicast), 0);
+
+    // Names outside .local and pointers that loop
+    q = dnsHeader(0, 0);
+    addLabels(q, "printer.lan");
+    addBe16(q, 0x0001);
+    addBe16(q, 0x0001);
+    CHECK_EQ(mdnsAnswer(q.data(), q.size(), 5353, ip, reply, sizeof(reply), name, sizeof(name), unicast), 0);
+    q = dnsHeader(0, 0);
+    q.push_back(0xC0);
+    q.push_back(12);
+    addBe16(q, 0x0001);
+    addBe16(q, 0x0001);
+    CHECK_EQ(mdnsAnswer(q.data(), q.size(), 5353, ip, reply, sizeof(reply), name, sizeof(name), unicast), 0);
+}
+
+/*********************************************************************
+**  NTLM and SMB
+**********************************************************************/
+// hashcat's example hash for -m 5600, the NT response is the NTProofStr followed by the client blob
+static const char *hashcatLine = "admin::N46iSNekpT:08ca45b7d7ea58ee:88dcbe4446168966a153a0064958dac6:"
+                                 "5c7830315c7830310000000000000b45c67103d07d7b95acd12ffa11230e0000000052920b"
+                                 "85f78d013c31cdb3b92f5d765c783030";
+static const char *hashcatNtResponse = "88dcbe4446168966a153a0064958dac6"
+                                       "5c7830315c7830310000000000000b45c67103d07d7b95acd12ffa11230e"
+                                       "0000000052920b85f78d013c31cdb3b92f5d765c783030";
+
+// The formatter writes upper case hex, user and domain as they came
+static std::string expectedLine() {
+    std::string line = hashcatLine;
+    for (size_t i = strlen("admin::N46iSNekpT:"); i < line.size(); i++) line[i] = toupper(line[i]);
+    return line;
+}
+
+// The challenge 08ca45b7d7ea58ee comes out of the first two random32() calls after a type 1 message
+static const uint32_t *randoms;
+static size_t randomNext;
+static uint32_t fakeRandom() { return randoms[randomNext++]; }
+
+static Bytes ntlmNegotiate() {
+    Bytes m;
+    add(m, "NTLMSSP", 8);
+    addLe16(m, 1);
+    addLe16(m, 0);
+    add(m, "\x97\x82\x08\xE2", 4);
+    return m;
+}
+
+static void addField(Bytes &m, size_t at, size_t len) {
+    m[at] = len & 0xFF;
+    m[at + 1] = len >> 8;
+    m[at + 2] = len & 0xFF;
+    m[at + 3] = len >> 8;
+    size_t off = m.size();
+    for (int i = 0; i < 4; i++) m[at + 4 + i] = (off >> (8 * i)) & 0xFF;
+}
+
+// Domain, user and workstation as UTF-16LE then the NT response, all through their offsets
+static Bytes ntlmAuthenticate(const Bytes &ntResponse) {
+    Bytes m(64, 0);
+    memcpy(m.data(), "NTLMSSP", 8);
+    m[8] = 3;
+    auto utf16 = [&](size_t at, const char *s) {
+        addField(m, at, 2 * strlen(s));
+        for (; *s; s++) addLe16(m, *s);
+    };
+    utf16(28, "N46iSNekpT");
+    utf16(36, "admin");
+    utf16(44, "DESKTOP-01");
+    addField(m, 12, 0); // empty LM response
+    addField(m, 20, ntResponse.size());
+    add(m, ntResponse.data(), ntResponse.size());
+    return m;
+}
+
+static void testNtlm() {
+    ServerInfo info;
+    const uint8_t challenge[8] = {1, 2, 3, 4, 5, 6, 7, 8};
+    uint8_t blob[512];
+    CHECK_EQ(buildNtlmChallenge(info, challenge, blob, 100), 0);
+    size_t len = buildNtlmChallenge(info, challenge, blob, sizeof(blob));
+    CHECK(len > 48);
+    CHECK(memcmp(blob, "NTLMSSP", 8) == 0);
+    CHECK_EQ(le32(blob + 8), 2);
+    CHECK_EQ(le16(blob + 12), 10); // "BRUCE" as UTF-16
+    CHECK_EQ(le32(blob + 16), 48);
+    CHECK(memcmp(blob + 24, challenge, 8) == 0);
+    CHECK(memcmp(blob + 48, "B\0R\0U\0C\0E\0", 10) == 0);
+    CHECK_EQ(le32(blob + 44), 58);
+    CHECK_EQ(le32(blob + 44) + le16(blob + 40), len);
+    CHECK_EQ(le16(blob + 58), 0x0001); // first AV pair: the NetBIOS name
+    CHECK_EQ(le32(blob + len - 4), 0); // MsvAvEOL
+
+    Bytes nt = hex(hashcatNtResponse);
+    Bytes m = ntlmAuthenticate(nt);
+    NtlmAuth auth;
+    CHECK(parseNtlmAuth(m.data(), m.size(), auth));
+    CHECK(auth.user == "admin");
+    CHECK(auth.domain == "N46iSNekpT");
+    CHECK(auth.workstation == "DESKTOP-01");
+    CHECK_EQ(auth.ntResponseLen, nt.size());
+    CHECK(formatNetNtlmv2(auth, hex("08ca45b7d7ea58ee").data()) == expectedLine());
+
+    // A response running past the message, an NTLMv1 response and a type 1 message are refused
+    CHECK(!parseNtlmAuth(m.data(), m.size() - 1, auth));
+    Bytes v1 = ntlmAuthenticate(Bytes(24, 0x11));
+    CHECK(!parseNtlmAuth(v1.data(), v1.size(), auth));
+    Bytes negotiate = ntlmNegotiate();
+    negotiate.resize(64, 0);
+    CHECK(!parseNtlmAuth(negotiate.data(), negotiate.size(), auth));
+}
+
+static Bytes nbss(const Bytes &payload) {
+    Bytes f = {0x00, 0x00};
+    addBe16(f, payload.size());
+    add(f, payload.data(), payload.size());
+    return f;
+}
+
+static Bytes smb1(uint8_t command, uint8_t wordCount, const Bytes &bytes) {
+    Bytes p(32, 0);
+    p[0] = 0xFF;
+    memcpy(&p[1], "SMB", 3);
+    p[4] = command;
+    p[10] = 0x01; // FLAGS2: long names, extended security
+    p[11] = 0xC8;
+    p[30] = 0x2A; // MID
+    p.push_back(wordCount);
+    p.resize(p.size() + 2 * wordCount, 0);
+    addLe16(p, bytes.size());
+    add(p, bytes.data(), bytes.size());
+    return nbss(p);
+}
+
+static Bytes smb1SessionSetup(const Bytes &ntlm) {
+    // SPNEGO wrapping doesn't matter, the signature is searched for
+    Bytes blob = {0xA1, 0x81, 0x80, 0x30, 0x7E, 0xA2, 0x7C, 0x04, 0x7A};
+    add(blob, ntlm.data(), ntlm.size());
+    Bytes f = smb1(0x73, 12, blob);
+    f[4 + 33 + 14] = blob.size() & 0xFF; // SecurityBlobLength
+    f[4 + 33 + 15] = blob.size() >> 8;
+    return f;
+}
+
+static Bytes smb2(uint16_t command, const Bytes &body) {
+    Bytes p(64, 0);
+    p[0] = 0xFE;
+    memcpy(&p[1], "SMB", 3);
+    p[4] = 64;
+    p[12] = command;
+    p[14] = 31; // credits requested
+    p[24] = 7;  // MessageId
+    add(p, body.data(), body.size());
+    return nbss(p);
+}
+
+static Bytes smb2SessionSetup(const Bytes &ntlm) {
+    Bytes body = {25, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 64 + 24, 0};
+    addLe16(body, ntlm.size());
+    body.resize(24, 0);
+    add(body, ntlm.data(), ntlm.size());
+    return smb2(0x0001, body);
+}
+
+// The whole conversation in pieces: one byte at a time, random splits and all of it at once
+static SmbSession::Result play(SmbSession &s, const Bytes &stream, std::mt19937 &rng, int mode) {
+    SmbSession::Result res = SmbSession::Result::Continue;
+    for (size_t i = 0; i < stream.size();) {
+        size_t n = mode == 0 ? 1 : mode == 1 ? 1 + rng() % 97 : stream.size();
+        if (n > stream.size() - i) n = stream.size() - i;
+        res = s.feed(stream.data() + i, n);
+        i += n;
+        if (res != SmbSession::Result::Continue) break;
+    }
+    return res;
+}
+
+// Splits the tx buffer into NBSS payloads
+static std::vector<Bytes> frames(const SmbSession &s) {
+    std::vector<Bytes> out;
+    for (size_t i = 0; i + 4 <= s.txLen();) {
+        const uint8_t *f = s.tx() + i;
+        size_t len = ((size_t)f[1] << 16) | (f[2] << 8) | f[3];
+        out.push_back(Bytes(f + 4, f + 4 + len));
+        i += 4 + len;
+    }
+    return out;
+}
+
+static void testSmb1() {
+    static const uint32_t smb1Randoms[] = {0xB745CA08, 0xEE58EAD7};
+    ServerInfo info;
+    std::mt19937 rng(1);
+
+    Bytes dialects;
+    add(dialects, "\x02PC NETWORK PROGRAM 1.0\0\x02NT LM 0.12\0", 36);
+    Bytes stream = smb1(0x72, 0, dialects);
+    Bytes setup = smb1SessionSetup(ntlmNegotiate());
+    add(stream, setup.data(), setup.size());
+    Bytes keepAlive = {0x85, 0, 0, 0};
+    add(stream, keepAlive.data(), keepAlive.size());
+    Bytes auth = smb1SessionSetup(ntlmAuthenticate(hex(hashcatNtResponse)));
+    add(stream, auth.data(), auth.size());
+
+    Bytes firstTx;
+    for (int run = 0; run < 200; run++) {
+        SmbSession s;
+        s.begin(&info);
+        info.random32 = fakeRandom;
+        randoms = smb1Randoms;
+        randomNext = 0;
+        CHECK_EQ((int)play(s, stream, rng, run % 3), (int)SmbSession::Result::Close);
+        CHECK_EQ((int)s.state(), (int)SmbSession::State::Done);
+        std::string line, user, domain, client;
+        CHECK(s.takeCapture(line, user, domain, client));
+        CHECK(line == expectedLine());
+        CHECK(client == "DESKTOP-01");
+        CHECK(!s.takeCapture(line, user, domain, client));
+        if (run == 0) firstTx.assign(s.tx(), s.tx() + s.txLen());
+        else if (Bytes(s.tx(), s.tx() + s.txLen()) != firstTx) CHECK(false);
+    }
+
+    SmbSession s;
+    s.begin(&info);
+    randomNext = 0;
+    play(s, stream, rng, 2);
+    std::vector<Bytes> out = frames(s);
+    CHECK_EQ(out.size(), 2);
+    if (out.size() != 2) return;
+
+    // NEGOTIATE: NT LM 0.12 (index 1), extended security with the SPNEGO token as the only bytes
+    const uint8_t *r = out[0].data();
+    CHECK_EQ(r[4], 0x72);
+    CHECK_EQ(r[9], 0x80);
+    CHECK_EQ(r[30], 0x2A); // MID echoed
+    CHECK_EQ(r[32], 17);
+    CHECK_EQ(le16(r + 33), 1);
+    CHECK_EQ(le16(r + 33 + 34), out[0].size() - 33 - 34 - 2);
+
+    // SESSION SETUP: four words, the blob length then the byte count, the challenge blob after them
+    r = out[1].data();
+    CHECK_EQ(r[4], 0x73);
+    CHECK_EQ(le32(r + 5), 0xC0000016);
+    CHECK_EQ(r[32], 4);
+    CHECK_EQ(r[33], 0xFF);
+    uint16_t blobLen = le16(r + 39);
+    CHECK_EQ(le16(r + 41), blobLen);
+    CHECK_EQ(out[1].size(), 43 + blobLen);
+    CHECK(memcmp(r + 43, "NTLMSSP", 8) == 0);
+    CHECK_EQ(le32(r + 43 + 8), 2);
+    CHECK(memcmp(r + 43 + 24, hex("08ca45b7d7ea58ee").data(), 8) == 0);
+    CHECK_EQ(le32(r + 43 + 44) + le16(r + 43 + 40), blobLen);
+}
+
+static void testSmb2() {
+    static const uint32_t smb2Randoms[] = {1, 2, 3, 4, 0xB745CA08, 0xEE58EAD7, 0x01020304, 0x05060708};
+    ServerInfo info;
+    info.random32 = fakeRandom;
+    std::mt19937 rng(2);
+
+    Bytes negotiate = {36, 0, 2, 0, 1, 0, 0, 0, 0x7F, 0, 0, 0};
+    negotiate.resize(36, 0);
+    addLe16(negotiate, 0x0202);
+    addLe16(negotiate, 0x0210);
+    Bytes stream = smb2(0x0000, negotiate);
+    Bytes setup = smb2SessionSetup(ntlmNegotiate());
+    add(stream, setup.data(), setup.size());
+    Bytes auth = smb2SessionSetup(ntlmAuthenticate(hex(hashcatNtResponse)));
+    add(stream, auth.data(), auth.size());
+
+    for (int run = 0; run < 200; run++) {
+        SmbSession s;
+        s.begin(&info);
+        randoms = smb2Randoms;
+        randomNext = 0;
+        CHECK_EQ((int)play(s, stream, rng, run % 3), (int)SmbSession::Result::Close);
+        std::string line, user, domain, client;
+        CHECK(s.takeCapture(line, user, domain, client));
+        CHECK(line == expectedLine());
+        CHECK(user == "admin");
+        CHECK(domain == "N46iSNekpT");
+        if (run) continue;
+
+        std::vector<Bytes> out = frames(s);
+        CHECK_EQ(out.size(), 3);
+        if (out.size() != 3) return;
+        // NEGOTIATE: SMB 2.1, the GUID from random32()
+        CHECK_EQ(le32(out[0].data() + 8), 0);
+        CHECK_EQ(le16(out[0].data() + 64 + 4), 0x0210);
+        CHECK_EQ(le32(out[0].data() + 64 + 8), 1);
+        // SESSION SETUP: more processing, a session id, the security buffer at 72
+        const uint8_t *r = out[1].data();
+        CHECK_EQ(le32(r + 8), 0xC0000016);
+        CHECK_EQ(r[16] & 1, 1);
+        CHECK_EQ(le32(r + 24), 7); // MessageId echoed
+        CHECK_EQ(le32(r + 40), 0x05060708);
+        CHECK_EQ(le32(r + 44), 0x01020304);
+        CHECK_EQ(le16(r + 64), 9);
+        CHECK_EQ(le16(r + 64 + 4), 72);
+        CHECK_EQ(le16(r + 64 + 6), out[1].size() - 72);
+        CHECK(memcmp(r + 72 + 24, hex("08ca45b7d7ea58ee").data(), 8) == 0);
+        // then success on the same session
+        CHECK_EQ(le32(out[2].data() + 8), 0);
+        CHECK_EQ(le32(out[2].data() + 40), 0x05060708);
+    }
+}
+
+static void testFraming() {
+    ServerInfo info;
+    SmbSession s;
+
+    // A signature right at the end of a frame, without room for the message type, is ignored
+    s.begin(&info);
+    Bytes body(24, 0);
+    add(body, "NTLMSSP", 8);
+    Bytes f = smb2(0x0001, body);
+    CHECK_EQ((int)s.feed(f.data(), f.size()), (int)SmbSession::Result::Continue);
+    CHECK_EQ(s.txLen(), 0);
+    CHECK_EQ((int)s.state(), (int)SmbSession::State::Idle);
+
+    // Frames past MAX_FRAME end the session, a half frame waits for the rest
+    s.begin(&info);
+    const uint8_t huge[4] = {0x00, 0x00, 0x10, 0x01};
+    CHECK_EQ((int)s.feed(huge, 4), (int)SmbSession::Result::Error);
+    s.begin(&info);
+    f = smb2(0x0003, Bytes(8, 0));
+    CHECK_EQ((int)s.feed(f.data(), f.size() - 1), (int)SmbSession::Result::Continue);
+    CHECK_EQ((int)s.feed(f.data() + f.size() - 1, 1), (int)SmbSession::Result::Close); // TREE CONNECT
+
+    // Random bytes after a valid NBSS header never read past the frame (ASan)
+    std::mt19937 rng(3);
+    for (int i = 0; i < 20000; i++) {
+        s.begin(&info);
+        Bytes payload(rng() % 200);
+        for (auto &b : payload) b = rng();
+        if (payload.size() >= 4) memcpy(payload.data(), rng() % 2 ? "\xFESMB" : "\xFFSMB", 4);
+        if (payload.size() > 20 && rng() % 2) {
+            memcpy(payload.data() + rng() % (payload.size() - 8), "NTLMSSP", 8);
+        }
+        Bytes frame = nbss(payload);
+        s.feed(frame.data(), frame.size());
+    }
+}
+
+int main() {
+    testNbns();
+    testLlmnr();
+    testMdns();
+    testNtlm();
+    testSmb1();
+    testSmb2();
+    testFraming();
+    return testResult("responder_proto");
+}
@@ -0,0 +1,191 @@
+// rfid_dump: writer/parser round trips, Flipper and legacy files, error lines, mutated files, load time
+
+#include "test.h"
+#include <algorithm>
+#include <chrono>
+#include <modules/rfid/rfid_dump.h>
+#include <random>
+#include <string.h>
+#include <string>
+
+static RfidDump a, b, c; // too big for the stack under ASan
+static std::mt19937 rng(1);
+static const uint8_t uid[4] = {0xDE, 0xAD, 0xBE, 0xEF};
+
+static std::string write(const RfidDump &dump) {
+    RfidDumpWriter writer(dump);
+    char line[RFID_DUMP_LINE_MAX];
+    std::string text;
+    while (writer.next(line, sizeof(line))) {
+        text += line;
+        text += "\r\n";
+    }
+    return text;
+}
+
+// Fed in chunks of `chunk` bytes, lines get split anywhere
+static RfidDumpError parse(const std::string &text, RfidDump &dump, size_t chunk = 7, uint32_t *line = NULL) {
+    RfidDumpParser parser(dump);
+    for (size_t i = 0; i < text.size(); i += chunk) {
+        parser.feed(text.data() + i, std::min(chunk, text.size() - i));
+    }
+    RfidDumpError error = parser.finish();
+    if (line) *line = parser.line();
+    return error;
+}
+
+static void makeCard(RfidDump &dump, const char *type, uint16_t total, uint16_t read, uint8_t pageSize) {
+    dump.clear();
+    strcpy(dump.type, type);
+    memcpy(dump.uid, uid, sizeof(uid));
+    dump.uidLen = sizeof(uid);
+    dump.total = total;
+    for (uint16_t p = 0; p < read; p++) {
+        uint8_t bytes[16];
+        for (auto &x : bytes) x = rng();
+        CHECK(dump.setPage(p, bytes, pageSize));
+    }
+}
+
+static void testClassicRoundTrip() {
+    makeCard(a, "MIFARE 4KB", 256, 256, 16);
+    a.sak = 0x18;
+    a.hasSak = true;
+    a.atqa[1] = 0x02;
+    a.hasAtqa = true;
+    std::string text = write(a);
+    CHECK(text.find("Pages read") == std::string::npos); // only written for partial dumps
+    for (size_t chunk : {1, 3, 64, 4096}) {
+        CHECK_EQ(parse(text, b, chunk), RFID_DUMP_OK);
+        CHECK_EQ(b.digest(), a.digest());
+        CHECK_EQ(b.total, 256);
+        CHECK_EQ(b.sak, 0x18);
+        CHECK(b.hasAtqa);
+        CHECK(b.complete());
+        CHECK(strcmp(b.type, "MIFARE 4KB") == 0);
+        CHECK(write(b) == text);
+    }
+}
+
+static void testPartialNtag() {
+    makeCard(a, "NTAG215", 135, 100, 4);
+    std::string text = write(a);
+    CHECK(text.find("Pages read: 100\r\n") != std::string::npos);
+    CHECK_EQ(parse(text, b), RFID_DUMP_OK);
+    CHECK(!b.complete());
+    CHECK_EQ(b.validCount(), 100);
+    CHECK_EQ(b.endPage(), 100);
+    CHECK(b.page(100) == NULL);
+}
+
+static void testFelica() {
+    makeCard(a, "FeliCa", 14, 3, 16);
+    a.pmmLen = 8;
+    std::string text = write(a);
+    CHECK(text.find("Block 2:") != std::string::npos);
+    CHECK(text.find("Blocks read: 3") != std::string::npos);
+    CHECK(text.find("SAK:") == std::string::npos);
+    CHECK_EQ(parse(text, b), RFID_DUMP_OK);
+    CHECK(b.isFelica());
+    CHECK_EQ(b.pmmLen, 8);
+    CHECK_EQ(b.digest(), a.digest());
+    uint8_t out[64];
+    CHECK_EQ(b.copyPages(0, 14, out, sizeof(out)), 48); // stops at the first block not read
+}
+
+static void testOtherFiles() {
+    // Flipper: unknown fields are skipped, "??" leaves the page unread
+    const std::string flipper = "Filetype: Flipper NFC device\nVersion: 4\n# comment\n"
+                                "Device type: NTAG/Ultralight\nUID: 04 85 92 8A A0 61 81\n"
+                                "ATQA: 00 44\nSAK: 00\nSignature: 00 11\n"
+                                "Mifare version: 00 04 04 02 01 00 11 03\nPages total: 3\nPages read: 3\n"
+                                "Page 0: 04 85 92 9B\nPage 1: 8A A0 61 81\nPage 2: ?? ?? 00 00\n";
+    RfidDumpParser parser(b);
+    parser.feed(flipper.data(), flipper.size());
+    CHECK_EQ(parser.finish(), RFID_DUMP_OK);
+    CHECK_EQ(parser.skipped(), 2);
+    CHECK_EQ(b.uidLen, 7);
+    CHECK_EQ(b.validCount(), 2);
+    CHECK(!b.complete());
+
+    // Older Bruce files have the bytes without spaces
+    CHECK_EQ(parse("UID: DEADBEEF\nPage 0: 00112233\n", b), RFID_DUMP_OK);
+    CHECK_EQ(b.uidLen, 4);
+    CHECK_EQ(b.page(0)[3], 0x33);
+}
+
+static void testErrors() {
+    struct {
+        const char *text;
+        RfidDumpError error;
+        uint32_t line;
+    } bad[] = {
+        {"UID: 01 02\nPage 0: 00 11 22\n", RFID_DUMP_PAGE_SIZE, 2},
+        {"UID: 01 02\nPage 0: 00 11 22 33\nPage 1: 00 11 22 33 44 55 66 77 88 99 AA BB CC DD EE FF\n",
+         RFID_DUMP_PAGE_SIZE, 3},
+        {"UID: 01 02\nPage 0: 00 11 22 33\nPage 0: 00 11 22 33\n", RFID_DUMP_DUPLICATE, 3},
+        {"UID: 01 0\n", RFID_DUMP_BAD_HEX, 1},
+        {"UID: 01 0G\n", RFID_DUMP_BAD_HEX, 1},
+        {"UID: ??\n", RFID_DUMP_BAD_HEX, 1},
+        {"UID: 01 02 03 04 05 06 07 08 09 0A 0B\n", RFID_DUMP_FIELD_SIZE, 1},
+        {"SAK: 01 02\n", RFID_DUMP_FIELD_SIZE, 1},
+        {"garbage\n", RFID_DUMP_SYNTAX, 1},
+        {"UID: 01\nPage 256: 00 00 00 00\n", RFID_DUMP_PAGE_RANGE, 2},
+        {"UID: 01\nPage x: 00 00 00 00\n", RFID_DUMP_BAD_NUMBER, 2},
+        {"Page 0: 00 00 00 00\n", RFID_DUMP_NO_UID, 1},
+    };
+    for (const auto &t : bad) {
+        uint32_t line = 0;
+        CHECK_EQ(parse(t.text, b, 5, &line), t.error);
+        CHECK_EQ(line, t.line);
+    }
+    CHECK_EQ(parse(std::string(200, 'A') + "\n", b), RFID_DUMP_LINE_TOO_LONG);
+}
+
+// Mutated files either fail or load into a dump that writes and loads back the same
+static void testFuzz() {
+    makeCard(a, "NTAG215", 135, 135, 4);
+    const std::string text = write(a);
+    for (int i = 0; i < 100000; i++) {
+        std::string m = text;
+        for (int k = 1 + rng() % 8; k > 0; k--) {
+            size_t pos = rng() % m.size();
+            switch (rng() % 3) {
+                case 0: m[pos] = rng(); break;
+                case 1: m.erase(pos, 1 + rng() % 5); break;
+                default: m.insert(pos, 1, (char)rng());
+            }
+        }
+        if (parse(m, b, 1 + rng() % 50) != RFID_DUMP_OK) continue;
+        CHECK_EQ(parse(write(b), c), RFID_DUMP_OK);
+        CHECK_EQ(c.digest(), b.digest());
+    }
+    // Random text made of the characters the format uses
+    for (int i = 0; i < 50000; i++) {
+        std::string m(rng() % 300, 0);
+        for (auto &ch : m) ch = rng() % 4 ? " 0123456789ABCDEF:?\n"[rng() % 20] : rng();
+        parse(m, b, 1 + rng() % 50);
+    }
+}
+
+// Loading a full 4K Classic dump, for comparing parser changes (the sanitizers slow it down several times)
+static void benchmark() {
+    makeCard(a, "MIFARE 4KB", 256, 256, 16);
+    const std::string text = write(a);
+    const int loads = 1000;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < loads; i++) parse(text, b, 256);
+    double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    printf("rfid_dump: %.1f us to load a %zu byte 4K dump\n", us / loads, text.size());
+}
+
+int main() {
+    testClassicRoundTrip();
+    testPartialNtag();
+    testFelica();
+    testOtherFiles();
+    testErrors();
+    testFuzz();
+    benchmark();
+    return testResult("rfid_dump");
+}
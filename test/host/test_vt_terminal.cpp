@@ -0,0 +1,288 @@
+// vt_terminal: recorded escape sequences against the expected grid, random input, parser throughput
+
+#include "test.h"
+#include <chrono>
+#include <modules/wifi/vt_terminal.h>
+#include <random>
+#include <string>
+
+// Row y of the view, trailing blanks dropped
+static std::string row(VtTerminal &t, int y) {
+    std::string s;
+    const VtCell *r = t.visibleRow(y);
+    for (int x = 0; x < t.cols(); x++) s += r[x].ch;
+    while (!s.empty() && s.back() == ' ') s.pop_back();
+    return s;
+}
+
+static bool blankScreen(VtTerminal &t) {
+    for (int y = 0; y < t.rows(); y++) {
+        if (!row(t, y).empty()) return false;
+    }
+    return true;
+}
+
+static void testText() {
+    VtTerminal t(20, 5, 50);
+    CHECK(t.ready());
+    t.write("hello\r\nworld");
+    CHECK(row(t, 0) == "hello");
+    CHECK(row(t, 1) == "world");
+    CHECK_EQ(t.cursorX(), 5);
+    CHECK_EQ(t.cursorY(), 1);
+
+    // Autowrap happens on the character after the last column
+    t.write("\x1b[H\x1b[2J01234567890123456789");
+    CHECK_EQ(t.cursorY(), 0);
+    t.write("AB");
+    CHECK(row(t, 0) == "01234567890123456789");
+    CHECK(row(t, 1) == "AB");
+    t.write("\x1b[?7l\x1b[2;19Hxyz");
+    CHECK(row(t, 1) == "AB                xz");
+
+    // Tabs stop every 8 columns and at the last one
+    t.write("\x1b[2J\x1b[H\ta\tb\tc");
+    CHECK(row(t, 0) == "        a       b  c");
+}
+
+static void testColors() {
+    VtTerminal t(20, 5, 0);
+    t.write("\x1b[1;31mR\x1b[0m\x1b[38;5;200mP\x1b[48;2;255;0;0mQ\x1b[mD\x1b[7;94mB");
+    const VtCell *r = t.visibleRow(0);
+    CHECK(r[0].ch == 'R');
+    CHECK_EQ(r[0].fg, 1);
+    CHECK(r[0].attr & VT_ATTR_BOLD);
+    CHECK(!(r[0].attr & VT_ATTR_DEFAULT_FG));
+    CHECK_EQ(r[1].fg, 200);
+    CHECK(!(r[1].attr & VT_ATTR_BOLD));
+    CHECK_EQ(r[2].bg, 196);
+    CHECK(!(r[2].attr & VT_ATTR_DEFAULT_BG));
+    CHECK_EQ(r[3].attr, VT_ATTR_DEFAULT_FG | VT_ATTR_DEFAULT_BG);
+    CHECK_EQ(r[4].fg, 12);
+    CHECK(r[4].attr & VT_ATTR_REVERSE);
+
+    // Erased cells take the current background
+    t.write("\x1b[0;44m\x1b[2K");
+    CHECK_EQ(t.visibleRow(0)[0].bg, 4);
+    CHECK(!(t.visibleRow(0)[0].attr & VT_ATTR_DEFAULT_BG));
+}
+
+static void testEditing() {
+    VtTerminal t(20, 5, 0);
+    t.write("hello\x1b[1;3H\x1b[K");
+    CHECK(row(t, 0) == "he");
+    t.write("\x1b[2J\x1b[H");
+    CHECK(blankScreen(t));
+
+    // Scroll region, index at its bottom, insert line
+    t.write("a\r\nb\r\nc\r\nd\r\ne\x1b[2;4r\x1b[4;1H\n");
+    CHECK(row(t, 0) == "a");
+    CHECK(row(t, 1) == "c");
+    CHECK(row(t, 2) == "d");
+    CHECK(row(t, 3) == "");
+    CHECK(row(t, 4) == "e");
+    t.write("\x1b[r\x1b[2;1H\x1b[L");
+    CHECK(row(t, 1) == "");
+    CHECK(row(t, 2) == "c");
+    CHECK(row(t, 4) == "");
+    t.write("\x1b[2;1H\x1b[2M");
+    CHECK(row(t, 1) == "d");
+
+    // Insert and delete characters, erase characters, repeat
+    t.write("\x1b[H\x1b[2Kabcdef\x1b[1;3H\x1b[2P");
+    CHECK(row(t, 0) == "abef");
+    t.write("\x1b[2@");
+    CHECK(row(t, 0) == "ab  ef");
+    t.write("\x1b[1;6H\x1b[X");
+    CHECK(row(t, 0) == "ab  e");
+    t.write("\x1b[3;1Hx\x1b[4b");
+    CHECK(row(t, 2) == "xxxxx");
+
+    // Relative moves stop at the edges, save and restore cursor
+    t.write("\x1b[3;3H\x1b[10A\x1b[100D");
+    CHECK_EQ(t.cursorX(), 0);
+    CHECK_EQ(t.cursorY(), 0);
+    t.write("\x1b[4;7H\x1b" "7\x1b[H\x1b" "8");
+    CHECK_EQ(t.cursorX(), 6);
+    CHECK_EQ(t.cursorY(), 3);
+}
+
+static void testScrollback() {
+    VtTerminal t(20, 5, 50);
+    for (int i = 0; i < 12; i++) {
+        char line[24];
+        snprintf(line, sizeof(line), "line%d\r\n", i);
+        t.write(line);
+    }
+    CHECK_EQ(t.historyLines(), 8);
+    CHECK(row(t, 0) == "line8");
+    CHECK(row(t, 3) == "line11");
+    CHECK(row(t, 4) == "");
+
+    t.scrollView(3);
+    CHECK(row(t, 0) == "line5");
+    CHECK(row(t, 3) == "line8");
+    CHECK(!t.cursorShown());
+    t.write("x\r\n"); // the view stays on the same lines
+    CHECK(row(t, 0) == "line5");
+    t.scrollView(-100);
+    CHECK(row(t, 3) == "x");
+    CHECK(t.cursorShown());
+
+    // The ring keeps the newest lines once full
+    VtTerminal small(10, 2, 3);
+    for (int i = 0; i < 10; i++) {
+        char line[16];
+        snprintf(line, sizeof(line), "%d\r\n", i);
+        small.write(line);
+    }
+    CHECK_EQ(small.historyLines(), 3);
+    small.scrollView(100);
+    CHECK_EQ(small.viewLines(), 3);
+    CHECK(row(small, 0) == "6");
+    CHECK(row(small, 1) == "7");
+
+    // ED 3 clears it, the alternate screen never feeds it
+    small.write("\x1b[3J");
+    CHECK_EQ(small.historyLines(), 0);
+    CHECK_EQ(small.viewLines(), 0);
+    small.write("\x1b[?1049h\r\n\r\n\r\n\r\n");
+    CHECK_EQ(small.historyLines(), 0);
+}
+
+static void testAltScreen() {
+    VtTerminal t(20, 5, 50);
+    t.write("01234567890123456789AB");
+    t.write("\x1b[?1049h\x1b[Hvim");
+    CHECK(row(t, 0) == "vim");
+    CHECK(row(t, 1) == "");
+    t.write("\x1b[?1049l");
+    CHECK(row(t, 0) == "01234567890123456789");
+    CHECK(row(t, 1) == "AB");
+    CHECK_EQ(t.cursorX(), 2);
+    CHECK_EQ(t.cursorY(), 1);
+
+    t.write("\x1b[?1h\x1b[?25l");
+    CHECK(t.applicationCursorKeys());
+    CHECK(!t.cursorShown());
+    t.write("\x1b" "c"); // full reset
+    CHECK(!t.applicationCursorKeys());
+    CHECK(t.cursorShown());
+    CHECK(blankScreen(t));
+}
+
+static void testCharsets() {
+    VtTerminal t(20, 5, 0);
+    // UTF-8 box drawing, an accent, DEC line drawing, an OSC title with BEL and with ST
+    t.write("\xe2\x94\x8c\xe2\x94\x80\xc3\xa9\x1b(0lqx\x1b(B\x1b]0;title\x07ok\x1b]2;t\x1b\\!");
+    CHECK(row(t, 0) == "+-?+-|ok!");
+
+    // Stray continuation byte, truncated sequence, invalid lead byte
+    t.write("\x1b[2J\x1b[H\x80|\xe2\x94|\xff|");
+    CHECK(row(t, 0) == "?|?|?|");
+
+    // A sequence split over writes, CAN aborting one
+    t.write("\x1b[");
+    t.write("2");
+    t.write("J");
+    CHECK(blankScreen(t));
+    t.write("\x1b[H\x1b[5\x18X");
+    CHECK(row(t, 0) == "X");
+}
+
+static void testReplies() {
+    VtTerminal t(20, 5, 0);
+    char reply[VT_REPLY_SIZE];
+    t.write("\x1b[3;4H\x1b[6n");
+    size_t n = t.takeReply(reply, sizeof(reply));
+    CHECK(std::string(reply, n) == "\x1b[3;4R");
+    t.write("\x1b[5n\x1b[c\x1b[>c");
+    n = t.takeReply(reply, 4);
+    CHECK(std::string(reply, n) == "\x1b[0n");
+    n = t.takeReply(reply, sizeof(reply));
+    CHECK(std::string(reply, n) == "\x1b[?1;2c\x1b[>0;0;0c");
+    CHECK_EQ(t.takeReply(reply, sizeof(reply)), 0);
+
+    // Replies that don't fit are dropped rather than cut
+    for (int i = 0; i < 10; i++) t.write("\x1b[6n");
+    n = t.takeReply(reply, sizeof(reply));
+    CHECK(n % 6 == 0);
+}
+
+static void testDirty() {
+    VtTerminal t(20, 5, 10);
+    uint16_t from, to;
+    t.clearDirty();
+    t.write("\x1b[2;5Hz");
+    CHECK(t.dirtySpan(1, from, to));
+    CHECK_EQ(from, 4);
+    CHECK_EQ(to, 5);
+    CHECK(!t.dirtySpan(0, from, to));
+    t.write("\x1b[1;10H\x1b[P");
+    CHECK(t.dirtySpan(0, from, to));
+    CHECK_EQ(from, 9);
+    CHECK_EQ(to, 20);
+
+    t.clearDirty();
+    t.write("\x1b[5;1H\n"); // a scroll dirties every row
+    for (int y = 0; y < 5; y++) CHECK(t.dirtySpan(y, from, to));
+}
+
+// Random bytes weighted towards escape sequences must never leave the grid or the cursor out of bounds
+static void testFuzz() {
+    static const char *pieces[] = {"\x1b", "[", "?", ";", "1049", "h", "l", "r", "J", "K", "L", "M", "P", "@",
+                                   "b",    "S", "T", "m", "38;5;", "48;2;", "\r", "\n", "\t", "\x08", "(0",
+                                   "]",    "\x07", "\xe2\x94", "\x80", "999", "0", "H", "A", "B", "X", "M"};
+    std::mt19937 rng(1);
+    VtTerminal t(17, 7, 5);
+    char reply[VT_REPLY_SIZE];
+    for (int i = 0; i < 200000; i++) {
+        std::string chunk;
+        int count = rng() % 8;
+        for (int k = 0; k < count; k++) {
+            if (rng() % 3) chunk += pieces[rng() % (sizeof(pieces) / sizeof(*pieces))];
+            else chunk += (char)rng();
+        }
+        t.write((const uint8_t *)chunk.data(), chunk.size());
+        if (rng() % 50 == 0) t.scrollView((int)(rng() % 9) - 4);
+        t.takeReply(reply, sizeof(reply));
+        if (t.cursorX() >= t.cols() || t.cursorY() >= t.rows()) {
+            CHECK(false);
+            break;
+        }
+    }
+    for (int y = 0; y < t.rows(); y++) row(t, y); // reads every visible cell under ASan
+    CHECK(t.viewLines() <= t.historyLines());
+}
+
+// Coloured ls-like output, for comparing parser changes (the sanitizers slow it down several times)
+static void benchmark() {
+    VtTerminal t(53, 30, 200);
+    std::string chunk;
+    for (int i = 0; i < 200; i++) {
+        chunk += "\x1b[01;34mdirectory\x1b[0m  file.txt  \x1b[01;32mscript.sh\x1b[0m  "
+                 "some longer text here\r\n";
+    }
+    size_t total = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int k = 0; k < 200; k++) {
+        t.write((const uint8_t *)chunk.data(), chunk.size());
+        total += chunk.size();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("vt_terminal: %.1f MB/s parsing coloured text\n", total / seconds / 1e6);
+}
+
+int main() {
+    testText();
+    testColors();
+    testEditing();
+    testScrollback();
+    testAltScreen();
+    testCharsets();
+    testReplies();
+    testDirty();
+    testFuzz();
+    benchmark();
+    return testResult("vt_terminal");
+}